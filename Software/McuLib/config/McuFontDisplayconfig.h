@@ -1,6 +1,9 @@
 #ifndef __McuFontDisplay_CONFIG_H
 #define __McuFontDisplay_CONFIG_H
 
-/* no configuration supported yet */
+#ifndef McuFontDisplay_CONFIG_USE_GLYPH_BLIT
+  #define McuFontDisplay_CONFIG_USE_GLYPH_BLIT  (1)
+    /*!< 1: a character is drawn with one McuGDisplaySSD1306_DrawMonoBits() call; 0: character is drawn pixel by pixel */
+#endif
 
 #endif /* __McuFontDisplay_CONFIG_H */
@@ -58,4 +58,10 @@
     /*!< 1: use RTOS mutex for mutual access to display. 0: do not use mutex */
 #endif
 
+#ifndef McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT
+  #define McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT \
+    (1 && McuGDisplaySSD1306_CONFIG_NOF_BITS_PER_PIXEL==1 && !McuGDisplaySSD1306_CONFIG_USE_WINDOW_CAPABILITY && !McuGDisplaySSD1306_CONFIG_USE_DISPLAY_MEMORY_WRITE)
+    /*!< 1: boxes, lines and glyphs write whole bytes (8 vertical pixels) of the page organized display buffer; 0: draw pixel by pixel */
+#endif
+
 #endif /* __McuGDisplaySSD1306_CONFIG_H */
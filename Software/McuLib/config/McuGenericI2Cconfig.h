@@ -29,6 +29,13 @@
   void McuGenericI2C_CONFIG_ON_ERROR_EVENT(void); /* prototype */
 #endif
 
+#if !defined(McuGenericI2C_CONFIG_USE_ON_ASYNC_READY_EVENT)
+  #define McuGenericI2C_CONFIG_USE_ON_ASYNC_READY_EVENT    (1)
+    /*!< 1: user event from the interrupt if a queued asynchronous transfer waits for McuGenericI2C_ProcessAsync(); 0: no event, it is started when a task queues or waits */
+  #define McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT   McuGenericI2C_OnAsyncReady
+  void McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT(void); /* prototype */
+#endif
+
 #if !defined(McuGenericI2C_CONFIG_USE_MUTEX)
   #define McuGenericI2C_CONFIG_USE_MUTEX             (1)
     /*!< 1: Use a mutex to protect access to the bus; 0: no mutex used */
@@ -67,6 +74,15 @@
 #define McuGenericI2C_CONFIG_SELECT_SLAVE                      McuSTM32HALI2C_SelectSlave
 #define McuGenericI2C_CONFIG_RECV_BLOCK_CUSTOM                 McuSTM32HALI2C_RecvBlockCustom
 #define McuGenericI2C_CONFIG_RECV_BLOCK_CUSTOM_AVAILABLE       (defined(McuSTM32HALI2C_RECVBLOCKCUSTOM_AVAILABLE) && (McuSTM32HALI2C_RECVBLOCKCUSTOM_AVAILABLE==1))
+#define McuGenericI2C_CONFIG_WRITE_ADDRESS_ASYNC               McuSTM32HALI2C_WriteAddressAsync
+#if !defined(McuGenericI2C_CONFIG_USE_ASYNC)
+  #define McuGenericI2C_CONFIG_USE_ASYNC             McuSTM32HALI2C_CONFIG_USE_ASYNC
+#endif
+#endif
+
+#if !defined(McuGenericI2C_CONFIG_USE_ASYNC)
+  #define McuGenericI2C_CONFIG_USE_ASYNC             (0)
+    /*!< 1: queue for asynchronous write transfers, needs McuGenericI2C_CONFIG_WRITE_ADDRESS_ASYNC in the low level driver; 0: blocking transfers only */
 #endif
 
 #endif /* __McuGenericI2C_CONFIG_H */
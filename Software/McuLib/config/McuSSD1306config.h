@@ -88,4 +88,24 @@
   /*!< 1: Use RAM Buffer for display memory; 0: Do not use RAM buffer (write directly to display) */
 #endif
 
+#ifndef McuSSD1306_CONFIG_PARTIAL_UPDATE
+  #define McuSSD1306_CONFIG_PARTIAL_UPDATE (1 && McuSSD1306_CONFIG_USE_RAM_BUFFER)
+  /*!< 1: Track the changed columns of each page while drawing, UpdateDirty() only sends these; 0: UpdateDirty() sends the full buffer */
+#endif
+
+#ifndef McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+  #define McuSSD1306_CONFIG_USE_SHADOW_BUFFER (1 && McuSSD1306_CONFIG_PARTIAL_UPDATE)
+  /*!< 1: Keep a copy of the display memory, so only bytes which have changed since the last update are sent (needs another buffer of the display size); 0: send the changed columns */
+#endif
+
+#ifndef McuSSD1306_CONFIG_USE_ASYNC_I2C
+  #define McuSSD1306_CONFIG_USE_ASYNC_I2C (1 && McuSSD1306_CONFIG_USE_I2C_BLOCK_TRANSFER && McuSSD1306_CONFIG_USE_RAM_BUFFER)
+  /*!< 1: Queue the updates as asynchronous I2C transfers if the I2C driver has them (McuGenericI2C_CONFIG_USE_ASYNC), the caller does not wait for the bus; 0: blocking transfers */
+#endif
+
+#ifndef McuSSD1306_CONFIG_SHADOW_BUFFER_ATTRIBUTE
+  #define McuSSD1306_CONFIG_SHADOW_BUFFER_ATTRIBUTE __attribute__((section(".ccmram")))
+  /*!< Placement of the shadow buffer: it is never sent to the display, so it can be in the otherwise unused CCM RAM */
+#endif
+
 #endif /* __McuSSD1306_CONFIG_H */
@@ -13,4 +13,20 @@
 #include "stm32f3xx_hal.h"
 #include "stm32f3xx_hal_i2c.h"
 
+#ifndef McuSTM32HALI2C_CONFIG_USE_ASYNC
+  #define McuSTM32HALI2C_CONFIG_USE_ASYNC   (1)
+    /*!< 1: WriteAddressAsync() for asynchronous transfers, needs the I2C interrupts enabled; 0: blocking transfers only */
+#endif
+
+#ifndef McuSTM32HALI2C_CONFIG_USE_DMA
+  #define McuSTM32HALI2C_CONFIG_USE_DMA   (1 && McuSTM32HALI2C_CONFIG_USE_ASYNC)
+    /*!< 1: asynchronous transfers with DMA, needs a DMA channel linked to the I2C handle; 0: with interrupts only */
+#endif
+
+#if McuSTM32HALI2C_CONFIG_USE_ASYNC && !defined(McuSTM32HALI2C_CONFIG_ON_ASYNC_DONE_EVENT)
+  #define McuSTM32HALI2C_CONFIG_ON_ASYNC_DONE_EVENT   McuGenericI2C_OnAsyncDone
+    /*!< called from the interrupt when an asynchronous transfer is done */
+  void McuSTM32HALI2C_CONFIG_ON_ASYNC_DONE_EVENT(uint8_t res); /* prototype */
+#endif
+
 #endif /* __McuSTM32HALI2C_CONFIG_H */
@@ -92,11 +92,13 @@ void McuFontDisplay_WriteChar(uint8_t ch, McuFontDisplay_PixelColor color, McuFo
 {
   PGFONT_CharInfo charStruct;          /* font information */
   uint8_t *data;                       /* actual character of string text[] */
+#if !McuFontDisplay_CONFIG_USE_GLYPH_BLIT
   uint8_t w;                           /* counter variable row bits of character */
   uint8_t h;                           /* counter variable column bits of character */
+  signed char b;                       /* bit position in byte stream */
+#endif
   McuFontDisplay_PixelDim currY;
   McuFontDisplay_PixelDim currX;
-  signed char b;                       /* bit position in byte stream */
 
   if (ch=='\t') {                      /* tabulator */
    ch = ' ';                           /* use a space instead */
@@ -118,6 +120,10 @@ void McuFontDisplay_WriteChar(uint8_t ch, McuFontDisplay_PixelColor color, McuFo
            - charStruct->offsetY
            - charStruct->height);
     currX = (McuFontDisplay_PixelDim)(*xCursor + charStruct->offsetX);
+#if McuFontDisplay_CONFIG_USE_GLYPH_BLIT
+    /* the glyph rows have the bitmap format of the display: draw it in one go */
+    McuGDisplaySSD1306_DrawMonoBits(currX, currY, charStruct->width, charStruct->height, data, color);
+#else
     h = 0;
     for(;;) {                          /* breaks, process line by line */
       w = 0;                           /* width position */
@@ -144,6 +150,7 @@ void McuFontDisplay_WriteChar(uint8_t ch, McuFontDisplay_PixelColor color, McuFo
         break;
       }                                /* next row of character */
     } /* for */
+#endif
     *xCursor += charStruct->dwidth;    /* set next cursor position */
   } /* if printable character */
 }
@@ -25,6 +25,7 @@
 **         DrawFilledCircle  - void McuGDisplaySSD1306_DrawFilledCircle(McuGDisplaySSD1306_PixelDim x0,...
 **         DrawBarChart      - void McuGDisplaySSD1306_DrawBarChart(McuGDisplaySSD1306_PixelDim x,...
 **         DrawMonoBitmap    - void McuGDisplaySSD1306_DrawMonoBitmap(McuGDisplaySSD1306_PixelDim x,...
+**         DrawMonoBits      - void McuGDisplaySSD1306_DrawMonoBits(McuGDisplaySSD1306_PixelDim x,...
 **         DrawColorBitmap   - void McuGDisplaySSD1306_DrawColorBitmap(McuGDisplaySSD1306_PixelDim x,...
 **         Draw65kBitmap     - void McuGDisplaySSD1306_Draw65kBitmap(McuGDisplaySSD1306_PixelDim x1,...
 **         Draw256BitmapLow  - void McuGDisplaySSD1306_Draw256BitmapLow(McuGDisplaySSD1306_PixelDim x1,...
@@ -122,6 +123,45 @@ static const uint16_t c332to565[256] = { /* converts a 3-3-2 RBG value into a 5-
  0xFC80, 0xFC8A, 0xFC94, 0xFC9E, 0xFDA0, 0xFDAA, 0xFDB4, 0xFDBE,
  0xFEC0, 0xFECA, 0xFED4, 0xFEDE, 0xFFE0, 0xFFEA, 0xFFF4, 0xFFFE,
 };
+
+#if McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT
+/* TRUE if the color sets the pixel bit in the display buffer, see PutPixel() */
+#define McuGDisplaySSD1306_IS_SET_COLOR(color) \
+  (   ((color)==McuGDisplaySSD1306_COLOR_BLACK && McuGDisplaySSD1306_COLOR_BLACK==McuGDisplaySSD1306_COLOR_PIXEL_SET) \
+   || ((color)==McuGDisplaySSD1306_COLOR_WHITE && McuGDisplaySSD1306_COLOR_WHITE==McuGDisplaySSD1306_COLOR_PIXEL_SET) \
+  )
+
+/* sets or clears the mask bits in the columns x0..x1 of a page: one byte for 8 vertical pixels */
+static void McuGDisplaySSD1306_BlitPage(McuGDisplaySSD1306_PixelDim x0, McuGDisplaySSD1306_PixelDim x1, uint8_t page, uint8_t mask, bool set)
+{
+  uint8_t *p = &McuSSD1306_DisplayBuf[page][x0];
+  uint8_t *e = &McuSSD1306_DisplayBuf[page][x1];
+
+  if (set) {
+    while (p<=e) {
+      *p++ |= mask;
+    }
+  } else {
+    mask = (uint8_t)~mask;
+    while (p<=e) {
+      *p++ &= mask;
+    }
+  }
+  McuSSD1306_MarkDirty(x0, page);
+  McuSSD1306_MarkDirty(x1, page);
+}
+
+/* pixel without range check and locking, for callers which already did both */
+static inline void McuGDisplaySSD1306_BlitPixel(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD1306_PixelDim y, bool set)
+{
+  if (set) {
+    McuGDisplaySSD1306_BUF_BYTE(x,y) |= McuGDisplaySSD1306_BUF_BYTE_PIXEL_MASK(x,y);
+  } else {
+    McuGDisplaySSD1306_BUF_BYTE(x,y) &= ~McuGDisplaySSD1306_BUF_BYTE_PIXEL_MASK(x,y);
+  }
+  McuSSD1306_MarkDirty(x, y/8);
+}
+#endif /* McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT */
 /*
 ** ===================================================================
 **     Method      :  Clear (component GDisplay)
@@ -136,6 +176,7 @@ void McuGDisplaySSD1306_Clear(void)
 {
   uint8_t *p = (uint8_t*)(&McuSSD1306_DisplayBuf[0][0]); /* first element in display buffer */
 
+  McuSSD1306_WaitIdle(); /* buffer might be still in transfer */
   while (p<((uint8_t*)McuSSD1306_DisplayBuf)+sizeof(McuSSD1306_DisplayBuf)) {
  #if McuGDisplaySSD1306_CONFIG_NOF_BITS_PER_PIXEL==1
     *p++ = (uint8_t)(  (McuGDisplaySSD1306_COLOR_PIXEL_CLR<<7)
@@ -154,6 +195,7 @@ void McuGDisplaySSD1306_Clear(void)
     *p++ = McuGDisplaySSD1306_COLOR_WHITE;
  #endif
   }
+  McuSSD1306_MarkAllDirty();
 }
 
 /*
@@ -187,6 +229,7 @@ void McuGDisplaySSD1306_SetPixel(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD13
   McuGDisplaySSD1306_BUF_WORD(x,y) = McuGDisplaySSD1306_COLOR_BLACK;
 #else
   McuGDisplaySSD1306_BUF_BYTE(x,y) |= McuGDisplaySSD1306_BUF_BYTE_PIXEL_MASK(x,y);
+  McuSSD1306_MarkDirty(x, y/8);
 #endif
 #if McuGDisplaySSD1306_CONFIG_USE_MUTEX
   McuGDisplaySSD1306_GiveDisplay();
@@ -224,6 +267,7 @@ void McuGDisplaySSD1306_ClrPixel(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD13
   McuGDisplaySSD1306_BUF_WORD(x,y) = McuGDisplaySSD1306_COLOR_WHITE;
 #else
   McuGDisplaySSD1306_BUF_BYTE(x,y) &= ~McuGDisplaySSD1306_BUF_BYTE_PIXEL_MASK(x,y);
+  McuSSD1306_MarkDirty(x, y/8);
 #endif
 #if McuGDisplaySSD1306_CONFIG_USE_MUTEX
   McuGDisplaySSD1306_GiveDisplay();
@@ -323,6 +367,10 @@ void McuGDisplaySSD1306_DrawFilledBox(McuGDisplaySSD1306_PixelDim x, McuGDisplay
 #if McuGDisplaySSD1306_CONFIG_USE_WINDOW_CAPABILITY
   McuGDisplaySSD1306_PixelCount pixCnt;
   McuGDisplaySSD1306_PixelDim x1, y1;
+#elif McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT
+  McuGDisplaySSD1306_PixelDim xe, ye;
+  uint8_t page, mask;
+  bool set;
 #else
   McuGDisplaySSD1306_PixelDim x0, xe, y0, ye;
 #endif
@@ -364,6 +412,31 @@ void McuGDisplaySSD1306_DrawFilledBox(McuGDisplaySSD1306_PixelDim x, McuGDisplay
   #if McuGDisplaySSD1306_CONFIG_USE_MUTEX
   McuGDisplaySSD1306_GiveDisplay();
   #endif
+#elif McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT
+  xe = (McuGDisplaySSD1306_PixelDim)(x+width-1);
+  ye = (McuGDisplaySSD1306_PixelDim)(y+height-1);
+  set = McuGDisplaySSD1306_IS_SET_COLOR(color);
+  page = (uint8_t)(y/8);
+  #if McuGDisplaySSD1306_CONFIG_USE_MUTEX
+  McuGDisplaySSD1306_GetDisplay();
+  #endif
+  for(;;) { /* breaks, page by page */
+    mask = 0xff;
+    if (page==y/8) { /* first page: rows from y */
+      mask &= (uint8_t)(0xff<<(y%8));
+    }
+    if (page==ye/8) { /* last page: rows up to ye */
+      mask &= (uint8_t)(0xff>>(7-(ye%8)));
+    }
+    McuGDisplaySSD1306_BlitPage(x, xe, page, mask, set);
+    if (page==ye/8) {
+      break;
+    }
+    page++;
+  } /* for */
+  #if McuGDisplaySSD1306_CONFIG_USE_MUTEX
+  McuGDisplaySSD1306_GiveDisplay();
+  #endif
 #else
   y0 = y; ye = (McuGDisplaySSD1306_PixelDim)(y0+height-1);
   #if McuGDisplaySSD1306_CONFIG_USE_MUTEX
@@ -471,6 +544,98 @@ void McuGDisplaySSD1306_DrawMonoBitmap(McuGDisplaySSD1306_PixelDim x, McuGDispla
   } /* for */
 }
 
+/*
+** ===================================================================
+**     Method      :  DrawMonoBits (component GDisplay)
+**
+**     Description :
+**         Draws the set pixels of a B/W bitmap, the other pixels are
+**         not changed (e.g. a font character). Each row starts with a
+**         new byte, MSB first.
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**         x               - x position of left upper corner
+**         y               - y position of left upper corner
+**         width           - width in pixels
+**         height          - height in pixels
+**       * bits            - Pointer to the bitmap rows
+**         color           - Color to be used for the set pixels
+**     Returns     : Nothing
+** ===================================================================
+*/
+void McuGDisplaySSD1306_DrawMonoBits(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD1306_PixelDim y, McuGDisplaySSD1306_PixelDim width, McuGDisplaySSD1306_PixelDim height, const uint8_t *bits, McuGDisplaySSD1306_PixelColor color)
+{
+  unsigned int rowBytes, w, h, nofCols, nofRows;
+  const uint8_t *data;
+  uint8_t bitMask;
+#if McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT
+  unsigned int yc;
+  uint8_t pageBits;
+  bool set;
+#endif
+
+  if (width==0 || height==0 || x>=McuGDisplaySSD1306_GetWidth() || y>=McuGDisplaySSD1306_GetHeight()) {
+    return; /* nothing visible */
+  }
+  rowBytes = (width+7u)/8u;
+  nofCols = width;
+  if (x+nofCols>McuGDisplaySSD1306_GetWidth()) { /* clip right side */
+    nofCols = (unsigned int)(McuGDisplaySSD1306_GetWidth()-x);
+  }
+  nofRows = height;
+  if (y+nofRows>McuGDisplaySSD1306_GetHeight()) { /* clip bottom */
+    nofRows = (unsigned int)(McuGDisplaySSD1306_GetHeight()-y);
+  }
+#if McuGDisplaySSD1306_CONFIG_USE_MUTEX
+  McuGDisplaySSD1306_GetDisplay();
+#endif
+#if McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT
+  set = McuGDisplaySSD1306_IS_SET_COLOR(color);
+  for(w=0; w<nofCols; w++) { /* column by column: collect the pixels of a page, then write the byte */
+    data = bits+(w/8);
+    bitMask = (uint8_t)(0x80>>(w%8));
+    pageBits = 0;
+    yc = y;
+    for(h=0; h<nofRows; h++) {
+      if ((*data)&bitMask) {
+        pageBits |= (uint8_t)(1<<(yc%8));
+      }
+      data += rowBytes;
+      yc++;
+      if ((yc%8)==0 || h==nofRows-1) { /* end of page or of the bitmap */
+        if (pageBits!=0) {
+          if (set) {
+            McuSSD1306_DisplayBuf[(yc-1)/8][x+w] |= pageBits;
+          } else {
+            McuSSD1306_DisplayBuf[(yc-1)/8][x+w] &= (uint8_t)~pageBits;
+          }
+          McuSSD1306_MarkDirty(x+w, (yc-1)/8);
+          pageBits = 0;
+        }
+      }
+    } /* for */
+  } /* for */
+#else
+  for(h=0; h<nofRows; h++) {
+    data = bits+(h*rowBytes);
+    bitMask = 0x80;
+    for(w=0; w<nofCols; w++) {
+      if ((*data)&bitMask) {
+        McuGDisplaySSD1306_PutPixel((McuGDisplaySSD1306_PixelDim)(x+w), (McuGDisplaySSD1306_PixelDim)(y+h), color);
+      }
+      bitMask >>= 1;
+      if (bitMask==0) { /* next byte inside the row */
+        bitMask = 0x80;
+        data++;
+      }
+    } /* for */
+  } /* for */
+#endif
+#if McuGDisplaySSD1306_CONFIG_USE_MUTEX
+  McuGDisplaySSD1306_GiveDisplay();
+#endif
+}
+
 /*
 ** ===================================================================
 **     Method      :  DrawColorBitmap (component GDisplay)
@@ -625,6 +790,13 @@ void McuGDisplaySSD1306_DrawLine(McuGDisplaySSD1306_PixelDim xstart, McuGDisplay
 {
   /* Based on Bresenham algorithm and http://de.wikipedia.org/wiki/Bresenham-Algorithmus */
   #define sgn(x) ((x) > 0) ? 1 : ((x) < 0) ? -1 : 0
+#if McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT /* write the buffer directly, locked once for the whole line */
+  #define McuGDisplaySSD1306_LINE_PIXEL(x, y) \
+    if ((x)<McuGDisplaySSD1306_GetWidth() && (y)<McuGDisplaySSD1306_GetHeight()) { McuGDisplaySSD1306_BlitPixel(x, y, set); }
+  bool set = McuGDisplaySSD1306_IS_SET_COLOR(color);
+#else
+  #define McuGDisplaySSD1306_LINE_PIXEL(x, y)  McuGDisplaySSD1306_PutPixel(x, y, color)
+#endif
   McuGDisplaySSD1306_PixelDim x, y;
   int t, dx, dy, incx, incy, pdx, pdy, ddx, ddy, es, el, err;
 
@@ -648,7 +820,10 @@ void McuGDisplaySSD1306_DrawLine(McuGDisplaySSD1306_PixelDim xstart, McuGDisplay
   }
   /* Do some initialization first... */
   x = xstart; y = ystart; err = el/2;
-  McuGDisplaySSD1306_PutPixel(x, y, color); /* put first pixel */
+#if McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT && McuGDisplaySSD1306_CONFIG_USE_MUTEX
+  McuGDisplaySSD1306_GetDisplay();
+#endif
+  McuGDisplaySSD1306_LINE_PIXEL(x, y); /* put first pixel */
   /* calculate pixels */
   for(t=0; t<el; ++t) { /* t counts the pixels, el is the number of pixels */
     err -= es; /* adapt error */
@@ -662,8 +837,12 @@ void McuGDisplaySSD1306_DrawLine(McuGDisplaySSD1306_PixelDim xstart, McuGDisplay
       x += pdx;
       y += pdy;
     }
-    McuGDisplaySSD1306_PutPixel(x, y, color);
+    McuGDisplaySSD1306_LINE_PIXEL(x, y);
   }
+#if McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT && McuGDisplaySSD1306_CONFIG_USE_MUTEX
+  McuGDisplaySSD1306_GiveDisplay();
+#endif
+  #undef McuGDisplaySSD1306_LINE_PIXEL
 }
 
 /*
@@ -25,6 +25,7 @@
 **         DrawFilledCircle  - void McuGDisplaySSD1306_DrawFilledCircle(McuGDisplaySSD1306_PixelDim x0,...
 **         DrawBarChart      - void McuGDisplaySSD1306_DrawBarChart(McuGDisplaySSD1306_PixelDim x,...
 **         DrawMonoBitmap    - void McuGDisplaySSD1306_DrawMonoBitmap(McuGDisplaySSD1306_PixelDim x,...
+**         DrawMonoBits      - void McuGDisplaySSD1306_DrawMonoBits(McuGDisplaySSD1306_PixelDim x,...
 **         DrawColorBitmap   - void McuGDisplaySSD1306_DrawColorBitmap(McuGDisplaySSD1306_PixelDim x,...
 **         Draw65kBitmap     - void McuGDisplaySSD1306_Draw65kBitmap(McuGDisplaySSD1306_PixelDim x1,...
 **         Draw256BitmapLow  - void McuGDisplaySSD1306_Draw256BitmapLow(McuGDisplaySSD1306_PixelDim x1,...
@@ -236,6 +237,20 @@ void McuGDisplaySSD1306_ClrPixel(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD13
 ** ===================================================================
 */
 
+#define McuGDisplaySSD1306_UpdateDirty()  McuSSD1306_UpdateDirty()
+/*
+** ===================================================================
+**     Method      :  UpdateDirty (component GDisplay)
+**
+**     Description :
+**         Updates the parts of the display which have been drawn
+**         since the last update. Same as UpdateFull() if the display
+**         driver does not track the changes.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+
 void McuGDisplaySSD1306_DrawFilledBox(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD1306_PixelDim y, McuGDisplaySSD1306_PixelDim width, McuGDisplaySSD1306_PixelDim height, McuGDisplaySSD1306_PixelColor color);
 /*
 ** ===================================================================
@@ -310,6 +325,27 @@ void McuGDisplaySSD1306_DrawMonoBitmap(McuGDisplaySSD1306_PixelDim x, McuGDispla
 ** ===================================================================
 */
 
+void McuGDisplaySSD1306_DrawMonoBits(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD1306_PixelDim y, McuGDisplaySSD1306_PixelDim width, McuGDisplaySSD1306_PixelDim height, const uint8_t *bits, McuGDisplaySSD1306_PixelColor color);
+/*
+** ===================================================================
+**     Method      :  DrawMonoBits (component GDisplay)
+**
+**     Description :
+**         Draws the set pixels of a B/W bitmap, the other pixels are
+**         not changed (e.g. a font character). Each row starts with a
+**         new byte, MSB first.
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**         x               - x position of left upper corner
+**         y               - y position of left upper corner
+**         width           - width in pixels
+**         height          - height in pixels
+**       * bits            - Pointer to the bitmap rows
+**         color           - Color to be used for the set pixels
+**     Returns     : Nothing
+** ===================================================================
+*/
+
 void McuGDisplaySSD1306_DrawHLine(McuGDisplaySSD1306_PixelDim x, McuGDisplaySSD1306_PixelDim y, McuGDisplaySSD1306_PixelDim length, McuGDisplaySSD1306_PixelColor color);
 /*
 ** ===================================================================
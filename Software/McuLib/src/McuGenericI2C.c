@@ -87,6 +87,9 @@
 #include "McuWait.h"
 #include "McuRTOS.h"
 #include "McuGenericSWI2C.h"
+#if McuGenericI2C_CONFIG_USE_ASYNC
+  #include "McuCriticalSection.h"
+#endif
 
 #ifndef NULL
   #define NULL 0L
@@ -95,6 +98,85 @@
 #if McuGenericI2C_CONFIG_USE_MUTEX
 static xSemaphoreHandle McuGenericI2C_busSem = NULL; /* Semaphore to protect I2C bus access */
 #endif
+#if McuGenericI2C_CONFIG_USE_ASYNC
+static McuGenericI2C_AsyncTransfer *volatile McuGenericI2C_asyncHead = NULL; /* first queued transfer, on the bus if McuGenericI2C_asyncRunning */
+static McuGenericI2C_AsyncTransfer *McuGenericI2C_asyncTail = NULL; /* last queued transfer */
+static volatile bool McuGenericI2C_asyncRunning = FALSE; /* head transfer is on the bus */
+static uint8_t McuGenericI2C_asyncBlocked = 0; /* nesting of McuGenericI2C_RequestBus(): queued transfers wait for the blocking ones */
+static volatile bool McuGenericI2C_asyncInDone = FALSE; /* in McuGenericI2C_OnAsyncDone(): transfers queued by the callback are not started */
+
+/* removes the head transfer from the queue and notifies it */
+static void McuGenericI2C_AsyncFinish(uint8_t res)
+{
+  McuGenericI2C_AsyncTransfer *xfer;
+  McuGenericI2C_AsyncDoneFct done;
+  McuCriticalSection_CriticalVariable();
+
+  McuCriticalSection_EnterCritical();
+  xfer = McuGenericI2C_asyncHead;
+  McuGenericI2C_asyncHead = xfer->next;
+  if (McuGenericI2C_asyncHead==NULL) {
+    McuGenericI2C_asyncTail = NULL;
+  }
+  McuGenericI2C_asyncRunning = FALSE;
+  McuCriticalSection_ExitCritical();
+  xfer->next = NULL;
+  done = xfer->done;
+  xfer->res = res; /* descriptor can be reused by the caller from now on */
+  if (done!=NULL) {
+    done(xfer);
+  }
+}
+
+/* starts the head transfer, unless one is on the bus already or a blocking transfer is in progress. Task context only:
+   the low level driver may poll the address phase on the bus. */
+static void McuGenericI2C_AsyncStart(void)
+{
+  McuGenericI2C_AsyncTransfer *xfer;
+  McuCriticalSection_CriticalVariable();
+
+  for(;;) { /* breaks */
+    McuCriticalSection_EnterCritical();
+    if (McuGenericI2C_asyncRunning || McuGenericI2C_asyncHead==NULL || McuGenericI2C_asyncBlocked>0) {
+      McuCriticalSection_ExitCritical();
+      break;
+    }
+    McuGenericI2C_asyncRunning = TRUE; /* claim the bus */
+    xfer = McuGenericI2C_asyncHead;
+    McuCriticalSection_ExitCritical();
+    if (McuGenericI2C_CONFIG_WRITE_ADDRESS_ASYNC(xfer->i2cAddr, xfer->memAddr, xfer->data, xfer->dataSize)==ERR_OK) {
+      break; /* McuGenericI2C_OnAsyncDone() notifies the end */
+    }
+  #if McuGenericI2C_CONFIG_USE_ON_ERROR_EVENT
+    McuGenericI2C_CONFIG_ON_ERROR_EVENT();
+  #endif
+    McuGenericI2C_AsyncFinish(ERR_FAILED); /* and try the next one */
+  }
+}
+
+/* keeps the queued transfers from the bus and waits until the current one is done */
+static void McuGenericI2C_AsyncBlock(void)
+{
+  McuCriticalSection_CriticalVariable();
+
+  McuCriticalSection_EnterCritical();
+  McuGenericI2C_asyncBlocked++;
+  McuCriticalSection_ExitCritical();
+  while (McuGenericI2C_asyncRunning) {
+    McuWait_WaitOSms(1);
+  }
+}
+
+static void McuGenericI2C_AsyncUnblock(void)
+{
+  McuCriticalSection_CriticalVariable();
+
+  McuCriticalSection_EnterCritical();
+  McuGenericI2C_asyncBlocked--;
+  McuCriticalSection_ExitCritical();
+  McuGenericI2C_AsyncStart();
+}
+#endif /* McuGenericI2C_CONFIG_USE_ASYNC */
 /*
 ** ===================================================================
 **     Method      :  RequestBus (component GenericI2C)
@@ -115,6 +197,9 @@ void McuGenericI2C_RequestBus(void)
 #if McuGenericI2C_CONFIG_USE_MUTEX
   (void)xSemaphoreTakeRecursive(McuGenericI2C_busSem, portMAX_DELAY);
 #endif
+#if McuGenericI2C_CONFIG_USE_ASYNC
+  McuGenericI2C_AsyncBlock();
+#endif
 }
 
 /*
@@ -129,6 +214,9 @@ void McuGenericI2C_RequestBus(void)
 */
 void McuGenericI2C_ReleaseBus(void)
 {
+#if McuGenericI2C_CONFIG_USE_ASYNC
+  McuGenericI2C_AsyncUnblock();
+#endif
 #if McuGenericI2C_CONFIG_USE_MUTEX
   (void)xSemaphoreGiveRecursive(McuGenericI2C_busSem);
 #endif
@@ -750,6 +838,123 @@ uint8_t McuGenericI2C_WriteByte(uint8_t i2cAddr, uint8_t data)
   return McuGenericI2C_WriteAddress(i2cAddr, NULL, 0, &data, 1);
 }
 
+#if McuGenericI2C_CONFIG_USE_ASYNC
+/*
+** ===================================================================
+**     Method      :  WriteAddressAsync (component GenericI2C)
+**
+**     Description :
+**         Queues a write transfer and returns without waiting. The
+**         transfers are done in the order they have been queued. The
+**         completion is notified with xfer->res and xfer->done().
+**         Needs the interrupts, so use it only after the scheduler
+**         has been started. Can be called from a task or from the
+**         completion callback.
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**       * xfer            - Pointer to transfer descriptor
+**     Returns     :
+**         ---             - Error code, ERR_BUSY if the descriptor is
+**                           still in use
+** ===================================================================
+*/
+uint8_t McuGenericI2C_WriteAddressAsync(McuGenericI2C_AsyncTransfer *xfer)
+{
+  McuCriticalSection_CriticalVariable();
+
+  McuCriticalSection_EnterCritical();
+  if (xfer->res==ERR_BUSY) { /* still queued */
+    McuCriticalSection_ExitCritical();
+    return ERR_BUSY;
+  }
+  xfer->res = ERR_BUSY;
+  xfer->next = NULL;
+  if (McuGenericI2C_asyncTail==NULL) {
+    McuGenericI2C_asyncHead = xfer;
+  } else {
+    McuGenericI2C_asyncTail->next = xfer;
+  }
+  McuGenericI2C_asyncTail = xfer;
+  McuCriticalSection_ExitCritical();
+  if (!McuGenericI2C_asyncInDone) { /* from the callback, it is started after McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT */
+    McuGenericI2C_AsyncStart();
+  }
+  return ERR_OK;
+}
+
+/*
+** ===================================================================
+**     Method      :  IsAsyncIdle (component GenericI2C)
+**
+**     Description :
+**         Checks if all queued transfers are done.
+**     Parameters  : None
+**     Returns     :
+**         ---             - TRUE if no transfer is queued
+** ===================================================================
+*/
+bool McuGenericI2C_IsAsyncIdle(void)
+{
+  return McuGenericI2C_asyncHead==NULL;
+}
+
+/*
+** ===================================================================
+**     Method      :  OnAsyncDone (component GenericI2C)
+**
+**     Description :
+**         Called by the low level driver (usually from the interrupt)
+**         when the transfer started with
+**         McuGenericI2C_CONFIG_WRITE_ADDRESS_ASYNC is done. Notifies
+**         the transfer. The next one is not started here, as the low
+**         level driver might poll the bus while starting it: if one
+**         is queued, McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT asks a
+**         task to call McuGenericI2C_ProcessAsync().
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**         res             - ERR_OK or an error code
+**     Returns     : Nothing
+** ===================================================================
+*/
+void McuGenericI2C_OnAsyncDone(uint8_t res)
+{
+  if (!McuGenericI2C_asyncRunning) {
+    return; /* not started by us */
+  }
+  if (res!=ERR_OK) {
+  #if McuGenericI2C_CONFIG_USE_ON_ERROR_EVENT
+    McuGenericI2C_CONFIG_ON_ERROR_EVENT();
+  #endif
+    res = ERR_FAILED;
+  }
+  McuGenericI2C_asyncInDone = TRUE;
+  McuGenericI2C_AsyncFinish(res);
+  McuGenericI2C_asyncInDone = FALSE;
+#if McuGenericI2C_CONFIG_USE_ON_ASYNC_READY_EVENT
+  if (McuGenericI2C_asyncHead!=NULL && McuGenericI2C_asyncBlocked==0) { /* a blocking transfer starts the queue when done */
+    McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT();
+  }
+#endif
+}
+
+/*
+** ===================================================================
+**     Method      :  ProcessAsync (component GenericI2C)
+**
+**     Description :
+**         Starts the next queued transfer if the bus is free. Call it
+**         from a task, after McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT
+**         or while waiting for queued transfers.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+void McuGenericI2C_ProcessAsync(void)
+{
+  McuGenericI2C_AsyncStart();
+}
+#endif /* McuGenericI2C_CONFIG_USE_ASYNC */
+
 /* END McuGenericI2C. */
 
 /*!
@@ -42,6 +42,10 @@
 **         ScanDevice        - uint8_t McuGenericI2C_ScanDevice(uint8_t i2cAddr);
 **         Deinit            - void McuGenericI2C_Deinit(void);
 **         Init              - void McuGenericI2C_Init(void);
+**         WriteAddressAsync - uint8_t McuGenericI2C_WriteAddressAsync(McuGenericI2C_AsyncTransfer *xfer);
+**         IsAsyncIdle       - bool McuGenericI2C_IsAsyncIdle(void);
+**         OnAsyncDone       - void McuGenericI2C_OnAsyncDone(uint8_t res);
+**         ProcessAsync      - void McuGenericI2C_ProcessAsync(void);
 **
 ** * Copyright (c) 2013-2018, Erich Styger
 **  * Web:         https://mcuoneclipse.com
@@ -111,6 +115,26 @@ typedef enum McuGenericI2C_EnumAckFlags_ {
   McuGenericI2C_DO_NOT_LAST_ACK  /* Nack after last received byte is not sent */
 } McuGenericI2C_EnumAckFlags;
 
+#if McuGenericI2C_CONFIG_USE_ASYNC
+struct McuGenericI2C_AsyncTransfer_;
+
+typedef void (*McuGenericI2C_AsyncDoneFct)(struct McuGenericI2C_AsyncTransfer_ *xfer);
+  /*!< called from the interrupt when a transfer is done, must be short */
+
+/* Asynchronous write transfer: (S+i2cAddr+0), (memAddr), (data)...(data+P).
+   The descriptor and the data are owned by the caller and must not be changed until res is not ERR_BUSY any more. */
+typedef struct McuGenericI2C_AsyncTransfer_ {
+  struct McuGenericI2C_AsyncTransfer_ *next; /* used by the queue */
+  uint8_t i2cAddr;           /* I2C address of device */
+  uint8_t memAddr;           /* device memory address (8bit), sent before the data */
+  uint8_t *data;             /* data to write */
+  uint16_t dataSize;         /* number of data bytes, can be larger than McuGenericI2C_WRITE_BUFFER_SIZE */
+  McuGenericI2C_AsyncDoneFct done; /* completion notification, can be NULL */
+  void *arg;                 /* for the completion notification */
+  volatile uint8_t res;      /* ERR_BUSY while queued or on the bus, then ERR_OK or ERR_FAILED */
+} McuGenericI2C_AsyncTransfer;
+#endif
+
 void McuGenericI2C_Init(void);
 /*
 ** ===================================================================
@@ -437,6 +461,75 @@ uint8_t McuGenericI2C_WriteByte(uint8_t i2cAddr, uint8_t data);
 ** ===================================================================
 */
 
+#if McuGenericI2C_CONFIG_USE_ASYNC
+uint8_t McuGenericI2C_WriteAddressAsync(McuGenericI2C_AsyncTransfer *xfer);
+/*
+** ===================================================================
+**     Method      :  WriteAddressAsync (component GenericI2C)
+**
+**     Description :
+**         Queues a write transfer and returns without waiting. The
+**         transfers are done in the order they have been queued. The
+**         completion is notified with xfer->res and xfer->done().
+**         Needs the interrupts, so use it only after the scheduler
+**         has been started.
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**       * xfer            - Pointer to transfer descriptor
+**     Returns     :
+**         ---             - Error code, ERR_BUSY if the descriptor is
+**                           still in use
+** ===================================================================
+*/
+
+bool McuGenericI2C_IsAsyncIdle(void);
+/*
+** ===================================================================
+**     Method      :  IsAsyncIdle (component GenericI2C)
+**
+**     Description :
+**         Checks if all queued transfers are done.
+**     Parameters  : None
+**     Returns     :
+**         ---             - TRUE if no transfer is queued
+** ===================================================================
+*/
+
+void McuGenericI2C_OnAsyncDone(uint8_t res);
+/*
+** ===================================================================
+**     Method      :  OnAsyncDone (component GenericI2C)
+**
+**     Description :
+**         Called by the low level driver (usually from the interrupt)
+**         when the transfer started with
+**         McuGenericI2C_CONFIG_WRITE_ADDRESS_ASYNC is done. Notifies
+**         the transfer. The next one is not started here, as the low
+**         level driver might poll the bus while starting it: if one
+**         is queued, McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT asks a
+**         task to call McuGenericI2C_ProcessAsync().
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**         res             - ERR_OK or an error code
+**     Returns     : Nothing
+** ===================================================================
+*/
+
+void McuGenericI2C_ProcessAsync(void);
+/*
+** ===================================================================
+**     Method      :  ProcessAsync (component GenericI2C)
+**
+**     Description :
+**         Starts the next queued transfer if the bus is free. Call it
+**         from a task, after McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT
+**         or while waiting for queued transfers.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+#endif
+
 /* END McuGenericI2C. */
 
 #ifdef __cplusplus
@@ -97,10 +97,34 @@
 
 #include "McuSSD1306.h"
 #include "McuWait.h" /* Waiting routines */
+#include <string.h> /* for memcpy() */
 #include McuSSD1306_CONFIG_I2C_HEADER_FILE  /* I2C driver */
 
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C && !(defined(McuGenericI2C_CONFIG_USE_ASYNC) && McuGenericI2C_CONFIG_USE_ASYNC)
+  #undef McuSSD1306_CONFIG_USE_ASYNC_I2C
+  #define McuSSD1306_CONFIG_USE_ASYNC_I2C  (0) /* I2C driver has no asynchronous transfers */
+#endif
+
 uint8_t McuSSD1306_DisplayBuf[((McuSSD1306_DISPLAY_HW_NOF_ROWS-1)/8)+1][McuSSD1306_DISPLAY_HW_NOF_COLUMNS]; /* buffer for the display */
 
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+uint8_t McuSSD1306_DirtyColStart[McuSSD1306_DISPLAY_HW_NOF_PAGES]; /* first changed column of each page, McuSSD1306_DISPLAY_HW_NOF_COLUMNS if none */
+uint8_t McuSSD1306_DirtyColEnd[McuSSD1306_DISPLAY_HW_NOF_PAGES];   /* last changed column of each page */
+
+#define SSD1306_RUN_MERGE_GAP  (10) /* unchanged bytes between two changed runs of a page are sent too if not more than this: cheaper than a new window */
+#endif
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+static uint8_t SSD1306_ShadowBuf[((McuSSD1306_DISPLAY_HW_NOF_ROWS-1)/8)+1][McuSSD1306_DISPLAY_HW_NOF_COLUMNS] McuSSD1306_CONFIG_SHADOW_BUFFER_ATTRIBUTE; /* what has been sent to the display */
+static volatile bool SSD1306_ShadowValid = FALSE; /* set with the first full update, cleared if a transfer fails */
+#endif
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C
+#define SSD1306_NOF_ASYNC_XFERS  (8) /* transfers queued at the same time: the window and the data of a run need one each */
+#define SSD1306_MAX_ASYNC_CMDS   (6) /* command bytes of a transfer */
+static McuGenericI2C_AsyncTransfer SSD1306_xfers[SSD1306_NOF_ASYNC_XFERS];
+static uint8_t SSD1306_xferCmds[SSD1306_NOF_ASYNC_XFERS][SSD1306_MAX_ASYNC_CMDS]; /* the commands are built on the stack, so they are copied */
+static uint8_t SSD1306_xferIdx = 0; /* next descriptor to use, the oldest one */
+#endif
+
 #if McuSSD1306_CONFIG_DYNAMIC_DISPLAY_ORIENTATION
   static McuSSD1306_DisplayOrientation currentOrientation;
 #endif
@@ -266,7 +290,57 @@ static unsigned char font[] = {
 #define SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL 0x29
 #define SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL 0x2A
 
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C
+/* the asynchronous transfers need the interrupts, which are masked until the scheduler runs */
+static bool SSD1306_UseAsync(void) {
+#if McuLib_CONFIG_SDK_USE_FREERTOS
+  return xTaskGetSchedulerState()==taskSCHEDULER_RUNNING;
+#else
+  return TRUE;
+#endif
+}
+
+/* called from the interrupt */
+static void SSD1306_OnXferDone(McuGenericI2C_AsyncTransfer *xfer) {
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+  if (xfer->res!=ERR_OK) {
+    SSD1306_ShadowValid = FALSE; /* display content unknown: next update is a full one */
+  }
+#else
+  (void)xfer;
+#endif
+}
+
+/* queues a write of commands or of the display buffer, only waits if all descriptors are in use. Returns ERR_OK if queued */
+static uint8_t SSD1306_QueueWrite(uint8_t memAddr, uint8_t *data, size_t size) {
+  McuGenericI2C_AsyncTransfer *xfer = &SSD1306_xfers[SSD1306_xferIdx];
+
+  while (xfer->res==ERR_BUSY) { /* oldest transfer not done yet */
+    McuGenericI2C_ProcessAsync(); /* in case the task starting the queued transfers is blocked */
+    McuWait_WaitOSms(1);
+  }
+  if (memAddr==SSD1306_CMD_REG) {
+    memcpy(SSD1306_xferCmds[SSD1306_xferIdx], data, size); /* size<=SSD1306_MAX_ASYNC_CMDS */
+    data = SSD1306_xferCmds[SSD1306_xferIdx];
+  }
+  xfer->i2cAddr = McuSSD1306_CONFIG_SSD1306_I2C_ADDR;
+  xfer->memAddr = memAddr;
+  xfer->data = data;
+  xfer->dataSize = (uint16_t)size;
+  xfer->done = SSD1306_OnXferDone;
+  xfer->arg = NULL;
+  if (McuGenericI2C_WriteAddressAsync(xfer)!=ERR_OK) {
+    return ERR_FAILED; /* caller writes it blocking */
+  }
+  SSD1306_xferIdx = (uint8_t)((SSD1306_xferIdx+1)%SSD1306_NOF_ASYNC_XFERS);
+  return ERR_OK;
+}
+#endif /* McuSSD1306_CONFIG_USE_ASYNC_I2C */
+
 static void SSD1306_WriteCommand(uint8_t cmd) {
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C
+  McuSSD1306_WaitIdle(); /* keep the order with the queued transfers */
+#endif
   McuGenericI2C_WriteByteAddress8(McuSSD1306_CONFIG_SSD1306_I2C_ADDR, SSD1306_CMD_REG, cmd);
 #if McuSSD1306_CONFIG_SSD1306_I2C_DELAY_US>0
   McuWait_Waitus(McuSSD1306_CONFIG_SSD1306_I2C_DELAY_US);
@@ -274,6 +348,9 @@ static void SSD1306_WriteCommand(uint8_t cmd) {
 }
 
 static void SSD1306_WriteData(uint8_t data) {
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C
+  McuSSD1306_WaitIdle(); /* keep the order with the queued transfers */
+#endif
   McuGenericI2C_WriteByteAddress8(McuSSD1306_CONFIG_SSD1306_I2C_ADDR, SSD1306_DATA_REG, data);
 #if McuSSD1306_CONFIG_SSD1306_I2C_DELAY_US>0
   McuWait_Waitus(McuSSD1306_CONFIG_SSD1306_I2C_DELAY_US);
@@ -286,6 +363,14 @@ static void SSD1306_WriteDataBlock(uint8_t *data, size_t size) {
   uint8_t memAddr = SSD1306_DATA_REG;
   uint16_t txSize;
 
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C
+  if (SSD1306_UseAsync()) { /* one transfer, the data is read from the display buffer in the background */
+    if (SSD1306_QueueWrite(SSD1306_DATA_REG, data, size)==ERR_OK) {
+      return;
+    }
+    McuSSD1306_WaitIdle(); /* not queued: write it blocking, after the queued ones */
+  }
+#endif
   while(size>0) {
     if (size>SSD1306_I2C_BLOCK_SIZE-1) {
       txSize = SSD1306_I2C_BLOCK_SIZE-1; /* -1 because of memAddr */
@@ -309,6 +394,101 @@ static void SSD1306_WriteDataBlock(uint8_t *data, size_t size) {
 }
 
 
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+static void SSD1306_WriteCommands(uint8_t *cmds, size_t nof) {
+#if McuSSD1306_CONFIG_USE_I2C_BLOCK_TRANSFER
+  uint8_t memAddr = SSD1306_CMD_REG; /* Co bit cleared: all following bytes are commands */
+
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C
+  if (SSD1306_UseAsync()) {
+    if (SSD1306_QueueWrite(SSD1306_CMD_REG, cmds, nof)==ERR_OK) {
+      return;
+    }
+    McuSSD1306_WaitIdle(); /* not queued: write it blocking, after the queued ones */
+  }
+#endif
+  McuGenericI2C_WriteAddress(McuSSD1306_CONFIG_SSD1306_I2C_ADDR, &memAddr, sizeof(memAddr), cmds, nof);
+#if McuSSD1306_CONFIG_SSD1306_I2C_DELAY_US>0
+  McuWait_Waitus(McuSSD1306_CONFIG_SSD1306_I2C_DELAY_US);
+#endif
+#else
+  while (nof>0) {
+    SSD1306_WriteCommand(*cmds);
+    cmds++;
+    nof--;
+  }
+#endif
+}
+
+/* sets the display memory area written by the following data */
+static void SSD1306_SetWindow(uint8_t col0, uint8_t col1, uint8_t page0, uint8_t page1) {
+#if McuSSD1306_CONFIG_SSD1306_DRIVER_TYPE==1306 /* SSD1306, horizontal or vertical addressing mode */
+  uint8_t cmds[6];
+
+  cmds[0] = SSD1306_COLUMN_ADDR;
+  cmds[1] = col0;
+  cmds[2] = col1;
+  cmds[3] = SSD1306_PAGE_ADDR;
+  cmds[4] = page0;
+  cmds[5] = page1;
+  SSD1306_WriteCommands(cmds, sizeof(cmds));
+#elif McuSSD1306_CONFIG_SSD1306_DRIVER_TYPE==1106 /* SH1106, page addressing mode only: writes to the end of page0 */
+  uint8_t cmds[3];
+
+  (void)col1;
+  (void)page1;
+  cmds[0] = 0xB0 | page0;
+  cmds[1] = 0x10 | (col0>>4);
+  cmds[2] = col0 & 0x0F;
+  SSD1306_WriteCommands(cmds, sizeof(cmds));
+#else
+  #error "unknown display type?"
+#endif
+}
+
+/* sends the columns col0..col1 of a page */
+static void SSD1306_WriteRun(uint8_t page, uint8_t col0, uint8_t col1) {
+  SSD1306_SetWindow(col0, col1, page, page);
+  SSD1306_WriteDataBlock(&McuSSD1306_DisplayBuf[page][col0], col1-col0+1);
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+  memcpy(&SSD1306_ShadowBuf[page][col0], &McuSSD1306_DisplayBuf[page][col0], col1-col0+1);
+#endif
+}
+
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+/* sends the bytes of the columns col0..col1 of a page which differ from the display memory */
+static void SSD1306_WriteChanged(uint8_t page, uint8_t col0, uint8_t col1) {
+  uint8_t *buf = McuSSD1306_DisplayBuf[page];
+  uint8_t *shadow = SSD1306_ShadowBuf[page];
+  int col, runStart = -1, runEnd = 0;
+
+  for(col=col0; col<=col1; col++) {
+    if (buf[col]!=shadow[col]) {
+      if (runStart<0) {
+        runStart = col;
+      } else if (col-runEnd>SSD1306_RUN_MERGE_GAP+1) { /* gap too large: send the previous run */
+        SSD1306_WriteRun(page, runStart, runEnd);
+        runStart = col;
+      }
+      runEnd = col;
+    }
+  }
+  if (runStart>=0) {
+    SSD1306_WriteRun(page, runStart, runEnd);
+  }
+}
+#endif
+
+static void SSD1306_ClearDirty(void) {
+  unsigned int page;
+
+  for(page=0; page<McuSSD1306_DISPLAY_HW_NOF_PAGES; page++) {
+    McuSSD1306_DirtyColStart[page] = McuSSD1306_DISPLAY_HW_NOF_COLUMNS;
+    McuSSD1306_DirtyColEnd[page] = 0;
+  }
+}
+#endif /* McuSSD1306_CONFIG_PARTIAL_UPDATE */
+
 static uint8_t actCol = 0;
 static uint8_t actPage = 0;
 
@@ -389,10 +569,12 @@ void McuSSD1306_Clear(void)
   int i;
   uint8_t *p = &McuSSD1306_DisplayBuf[0][0];
 
+  McuSSD1306_WaitIdle();
   for(i=0; i<sizeof(McuSSD1306_DisplayBuf); i++) {
     *p = 0x00;
     p++;
   }
+  McuSSD1306_MarkAllDirty();
   McuSSD1306_UpdateFull();
 }
 
@@ -410,8 +592,12 @@ void McuSSD1306_Clear(void)
 void McuSSD1306_UpdateFull(void)
 {
 #if McuSSD1306_CONFIG_SSD1306_DRIVER_TYPE==1306 /* SSD1306 */
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+  SSD1306_SetWindow(0, McuSSD1306_DISPLAY_HW_NOF_COLUMNS-1, 0, McuSSD1306_DISPLAY_HW_NOF_PAGES-1); /* a partial update might have changed it */
+#else
   SSD1306_SetPageStartAddr(0);
   SSD1306_SetColStartAddr(0);
+#endif
   SSD1306_WriteDataBlock(&McuSSD1306_DisplayBuf[0][0], sizeof(McuSSD1306_DisplayBuf));
 #elif McuSSD1306_CONFIG_SSD1306_DRIVER_TYPE==1106 /* SH1306 */
   /* the SSH1306 has a 132x64 memory organization (compared to the 128x64 of the SSD1306) */
@@ -425,6 +611,102 @@ void McuSSD1306_UpdateFull(void)
 #else
   #error "unknown display type?"
 #endif
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+  memcpy(SSD1306_ShadowBuf, McuSSD1306_DisplayBuf, sizeof(SSD1306_ShadowBuf));
+  SSD1306_ShadowValid = TRUE;
+#endif
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+  SSD1306_ClearDirty();
+#endif
+}
+
+/*
+** ===================================================================
+**     Method      :  UpdateDirty (component SSD1306)
+**
+**     Description :
+**         Updates the parts of the display which have been changed in
+**         the RAM display buffer since the last update. Each changed
+**         page gets a window for the changed columns only.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+void McuSSD1306_UpdateDirty(void)
+{
+  unsigned int page;
+  uint8_t col0, col1;
+
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+  if (!SSD1306_ShadowValid) { /* display content unknown */
+    McuSSD1306_UpdateFull();
+    return;
+  }
+#endif
+  for(page=0; page<McuSSD1306_DISPLAY_HW_NOF_PAGES; page++) {
+    col0 = McuSSD1306_DirtyColStart[page];
+    col1 = McuSSD1306_DirtyColEnd[page];
+    McuSSD1306_DirtyColStart[page] = McuSSD1306_DISPLAY_HW_NOF_COLUMNS;
+    McuSSD1306_DirtyColEnd[page] = 0;
+    if (col0>col1) { /* page not changed */
+      continue;
+    }
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+    SSD1306_WriteChanged(page, col0, col1);
+#else
+    SSD1306_WriteRun(page, col0, col1);
+#endif
+  }
+}
+#endif
+
+/*
+** ===================================================================
+**     Method      :  MarkAllDirty (component SSD1306)
+**
+**     Description :
+**         Marks the whole display buffer as changed, e.g. after it
+**         has been written without the drawing functions.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+void McuSSD1306_MarkAllDirty(void)
+{
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+  unsigned int page;
+
+  for(page=0; page<McuSSD1306_DISPLAY_HW_NOF_PAGES; page++) {
+    McuSSD1306_DirtyColStart[page] = 0;
+    McuSSD1306_DirtyColEnd[page] = McuSSD1306_DISPLAY_HW_NOF_COLUMNS-1;
+  }
+#endif
+}
+
+/*
+** ===================================================================
+**     Method      :  WaitIdle (component SSD1306)
+**
+**     Description :
+**         Waits until the queued I2C transfers are done, so the
+**         display buffer can be changed again.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+void McuSSD1306_WaitIdle(void)
+{
+#if McuSSD1306_CONFIG_USE_ASYNC_I2C
+  int i;
+
+  for(i=0; i<SSD1306_NOF_ASYNC_XFERS; i++) {
+    while (SSD1306_xfers[i].res==ERR_BUSY) {
+      McuGenericI2C_ProcessAsync(); /* start the queued ones */
+      McuWait_WaitOSms(1);
+    }
+  }
+#endif
 }
 
 /*
@@ -432,8 +714,9 @@ void McuSSD1306_UpdateFull(void)
 **     Method      :  UpdateRegion (component SSD1306)
 **
 **     Description :
-**         Updates a region of the display. This is only a stub for
-**         this display as we are using windowing.
+**         Updates a region of the display from the RAM display buffer,
+**         using the column and page addressing of the display. Only a
+**         stub if partial updates are disabled.
 **     Parameters  :
 **         NAME            - DESCRIPTION
 **         x               - x coordinate
@@ -443,12 +726,34 @@ void McuSSD1306_UpdateFull(void)
 **     Returns     : Nothing
 ** ===================================================================
 */
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+void McuSSD1306_UpdateRegion(McuSSD1306_PixelDim x, McuSSD1306_PixelDim y, McuSSD1306_PixelDim w, McuSSD1306_PixelDim h)
+{
+  unsigned int page, pageEnd, colEnd;
+
+  if (w==0 || h==0 || x>=McuSSD1306_DISPLAY_HW_NOF_COLUMNS || y>=McuSSD1306_DISPLAY_HW_NOF_ROWS) {
+    return;
+  }
+  colEnd = x+w-1;
+  if (colEnd>=McuSSD1306_DISPLAY_HW_NOF_COLUMNS) {
+    colEnd = McuSSD1306_DISPLAY_HW_NOF_COLUMNS-1;
+  }
+  pageEnd = (y+h-1)/8;
+  if (pageEnd>=McuSSD1306_DISPLAY_HW_NOF_PAGES) {
+    pageEnd = McuSSD1306_DISPLAY_HW_NOF_PAGES-1;
+  }
+  for(page=y/8; page<=pageEnd; page++) {
+    SSD1306_WriteRun(page, x, colEnd);
+  }
+}
+#else
 /*
 void McuSSD1306_UpdateRegion(McuSSD1306_PixelDim x, McuSSD1306_PixelDim y, McuSSD1306_PixelDim w, McuSSD1306_PixelDim h)
 {
   implemented as macro in McuSSD1306.h
 }
 */
+#endif
 
 /*
 ** ===================================================================
@@ -762,6 +1067,9 @@ uint8_t McuSSD1306_DisplayInvert(bool invert)
 */
 void McuSSD1306_PrintString(uint8_t *str)
 {
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+  SSD1306_ShadowValid = FALSE; /* writes to the display memory, not to the buffer */
+#endif
   while(*str != '\0'){
     if(*str == '\n') {
       actPage++;
@@ -790,6 +1098,12 @@ void McuSSD1306_PrintString(uint8_t *str)
 */
 void McuSSD1306_Init(void)
 {
+#if McuSSD1306_CONFIG_USE_SHADOW_BUFFER
+  SSD1306_ShadowValid = FALSE;
+#endif
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+  SSD1306_ClearDirty();
+#endif
 #if McuSSD1306_CONFIG_INIT_DELAY_MS>0
   McuWait_Waitms(McuSSD1306_CONFIG_INIT_DELAY_MS);                   /* give hardware time to power up*/
 #endif
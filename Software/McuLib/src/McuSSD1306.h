@@ -46,6 +46,7 @@
 **         Clear                 - void McuSSD1306_Clear(void);
 **         UpdateFull            - void McuSSD1306_UpdateFull(void);
 **         UpdateRegion          - void McuSSD1306_UpdateRegion(McuSSD1306_PixelDim x, McuSSD1306_PixelDim y,...
+**         WaitIdle              - void McuSSD1306_WaitIdle(void);
 **         InitCommChannel       - void McuSSD1306_InitCommChannel(void);
 **         SetContrast           - uint8_t McuSSD1306_SetContrast(uint8_t contrast);
 **         DisplayOn             - uint8_t McuSSD1306_DisplayOn(bool on);
@@ -118,6 +119,19 @@ typedef uint16_t McuSSD1306_PixelCount; /* needed type to hold the number of pix
 
 extern uint8_t McuSSD1306_DisplayBuf[((McuSSD1306_DISPLAY_HW_NOF_ROWS-1)/8)+1][McuSSD1306_DISPLAY_HW_NOF_COLUMNS]; /* buffer for the display */
 
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+extern uint8_t McuSSD1306_DirtyColStart[McuSSD1306_DISPLAY_HW_NOF_PAGES]; /* first changed column of each page, McuSSD1306_DISPLAY_HW_NOF_COLUMNS if none */
+extern uint8_t McuSSD1306_DirtyColEnd[McuSSD1306_DISPLAY_HW_NOF_PAGES];   /* last changed column of each page */
+
+#define McuSSD1306_MarkDirty(col, page) /* a byte of the display buffer has been written */ \
+  do { \
+    if ((col)<McuSSD1306_DirtyColStart[page]) { McuSSD1306_DirtyColStart[page] = (col); } \
+    if ((col)>McuSSD1306_DirtyColEnd[page]) { McuSSD1306_DirtyColEnd[page] = (col); } \
+  } while(0)
+#else
+#define McuSSD1306_MarkDirty(col, page) /* nothing */
+#endif
+
 #define McuSSD1306_PIXEL_BLACK  0 /* 0 is a black pixel */
 #define McuSSD1306_PIXEL_WHITE  1 /* 1 is a color/white pixel */
 #define McuSSD1306_COLOR_PIXEL_SET      McuSSD1306_PIXEL_WHITE /* color for a pixel set */
@@ -202,17 +216,66 @@ void McuSSD1306_UpdateFull(void);
 ** ===================================================================
 */
 
-/* implemented as macro
-void McuSSD1306_UpdateRegion(McuSSD1306_PixelDim x, McuSSD1306_PixelDim y, McuSSD1306_PixelDim w, McuSSD1306_PixelDim h);
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+void McuSSD1306_UpdateDirty(void);
+#else
+#define McuSSD1306_UpdateDirty()  McuSSD1306_UpdateFull()
+#endif
+/*
+** ===================================================================
+**     Method      :  UpdateDirty (component SSD1306)
+**
+**     Description :
+**         Updates the parts of the display which have been changed in
+**         the RAM display buffer since the last update. Sends the full
+**         buffer if partial updates are disabled.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+
+void McuSSD1306_MarkAllDirty(void);
+/*
+** ===================================================================
+**     Method      :  MarkAllDirty (component SSD1306)
+**
+**     Description :
+**         Marks the whole display buffer as changed, e.g. after it
+**         has been written without the drawing functions.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
+*/
+
+void McuSSD1306_WaitIdle(void);
+/*
+** ===================================================================
+**     Method      :  WaitIdle (component SSD1306)
+**
+**     Description :
+**         Waits until the queued asynchronous updates have been sent.
+**         The I2C transfers read the RAM display buffer in the
+**         background, so call this before changing the buffer.
+**         McuGDisplaySSD1306_Clear() does it. Returns immediately with
+**         blocking transfers.
+**     Parameters  : None
+**     Returns     : Nothing
+** ===================================================================
 */
+
+#if McuSSD1306_CONFIG_PARTIAL_UPDATE
+void McuSSD1306_UpdateRegion(McuSSD1306_PixelDim x, McuSSD1306_PixelDim y, McuSSD1306_PixelDim w, McuSSD1306_PixelDim h);
+#else
 #define McuSSD1306_UpdateRegion(x,y,w,h) /* nothing to do, as this display type does not require a refresh */
+#endif
 /*
 ** ===================================================================
 **     Method      :  UpdateRegion (component SSD1306)
 **
 **     Description :
-**         Updates a region of the display. This is only a stub for
-**         this display as we are using windowing.
+**         Updates a region of the display from the RAM display buffer,
+**         using the column and page addressing of the display. Only a
+**         stub if partial updates are disabled.
 **     Parameters  :
 **         NAME            - DESCRIPTION
 **         x               - x coordinate
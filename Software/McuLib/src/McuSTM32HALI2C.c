@@ -463,6 +463,61 @@ uint8_t McuSTM32HALI2C_SetDeviceHandle(I2C_HandleTypeDef *handle)
   return ERR_OK;
 }
 
+#if McuSTM32HALI2C_CONFIG_USE_ASYNC
+/*
+** ===================================================================
+**     Method      :  WriteAddressAsync (component STM32CubeI2C)
+**
+**     Description :
+**         Starts a write transfer (S+i2cAddr+0), (memAddr), (data)...
+**         (data+P) with DMA or interrupts and returns. The end of the
+**         transfer is notified with
+**         McuSTM32HALI2C_CONFIG_ON_ASYNC_DONE_EVENT from the interrupt.
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**         i2cAddr         - I2C address of device
+**         memAddr         - Device memory address
+**       * data            - Pointer to data, must stay valid until done
+**         dataSize        - Number of data bytes
+**     Returns     :
+**         ---             - Error code, ERR_OK if the transfer has
+**                           been started
+** ===================================================================
+*/
+uint8_t McuSTM32HALI2C_WriteAddressAsync(uint8_t i2cAddr, uint8_t memAddr, uint8_t *data, uint16_t dataSize)
+{
+  HAL_StatusTypeDef res;
+
+  /* the HAL sends the device and memory address polling (a few ten us), then the data in the background:
+     McuGenericI2C calls this from a task only, never from the completion interrupt */
+#if McuSTM32HALI2C_CONFIG_USE_DMA
+  res = HAL_I2C_Mem_Write_DMA(McuSTM32HALI2C_device, (uint16_t)(i2cAddr<<1), memAddr, I2C_MEMADD_SIZE_8BIT, data, dataSize);
+#else
+  res = HAL_I2C_Mem_Write_IT(McuSTM32HALI2C_device, (uint16_t)(i2cAddr<<1), memAddr, I2C_MEMADD_SIZE_8BIT, data, dataSize);
+#endif
+  if (res!=HAL_OK) {
+    return ERR_FAILED;
+  }
+  return ERR_OK;
+}
+
+/* HAL callback (from the interrupt): asynchronous write done */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  if (hi2c==McuSTM32HALI2C_device) {
+    McuSTM32HALI2C_CONFIG_ON_ASYNC_DONE_EVENT(ERR_OK);
+  }
+}
+
+/* HAL callback (from the interrupt): NACK or bus error */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  if (hi2c==McuSTM32HALI2C_device) {
+    McuSTM32HALI2C_CONFIG_ON_ASYNC_DONE_EVENT(ERR_FAILED);
+  }
+}
+#endif /* McuSTM32HALI2C_CONFIG_USE_ASYNC */
+
 /* END McuSTM32HALI2C. */
 
 /*!
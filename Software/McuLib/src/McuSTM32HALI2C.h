@@ -24,6 +24,7 @@
 **         SelectSlave       - uint8_t McuSTM32HALI2C_SelectSlave(uint8_t Slv);
 **         GetSelected       - uint8_t McuSTM32HALI2C_GetSelected(uint8_t *Slv);
 **         SetDeviceHandle   - uint8_t McuSTM32HALI2C_SetDeviceHandle(I2C_HandleTypeDef *handle);
+**         WriteAddressAsync - uint8_t McuSTM32HALI2C_WriteAddressAsync(uint8_t i2cAddr, uint8_t memAddr,...
 **         Deinit            - void McuSTM32HALI2C_Deinit(void);
 **         Init              - void McuSTM32HALI2C_Init(void);
 **
@@ -426,6 +427,30 @@ uint8_t McuSTM32HALI2C_SetDeviceHandle(I2C_HandleTypeDef *handle);
 ** ===================================================================
 */
 
+#if McuSTM32HALI2C_CONFIG_USE_ASYNC
+uint8_t McuSTM32HALI2C_WriteAddressAsync(uint8_t i2cAddr, uint8_t memAddr, uint8_t *data, uint16_t dataSize);
+/*
+** ===================================================================
+**     Method      :  WriteAddressAsync (component STM32CubeI2C)
+**
+**     Description :
+**         Starts a write transfer (S+i2cAddr+0), (memAddr), (data)...
+**         (data+P) with DMA or interrupts and returns. The end of the
+**         transfer is notified with
+**         McuSTM32HALI2C_CONFIG_ON_ASYNC_DONE_EVENT from the interrupt.
+**     Parameters  :
+**         NAME            - DESCRIPTION
+**         i2cAddr         - I2C address of device
+**         memAddr         - Device memory address
+**       * data            - Pointer to data, must stay valid until done
+**         dataSize        - Number of data bytes
+**     Returns     :
+**         ---             - Error code, ERR_OK if the transfer has
+**                           been started
+** ===================================================================
+*/
+#endif
+
 /* END McuSTM32HALI2C. */
 
 #endif
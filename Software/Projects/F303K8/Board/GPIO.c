@@ -10,6 +10,9 @@
 #include "GPIO.h"
 #include "stm32f3xx_hal.h"
 #include "Pin.h"
+#if PL_CONFIG_HAS_QUADRATURE
+  #include "Quadrature.h"
+#endif
 
 /* Sumo:
  * PA0: PWMA
@@ -62,6 +65,9 @@ static void MX_GPIO_Init(void) {
 
   /* Encoder pins with pull-ups */
   GPIO_InitStruct.Pull = GPIO_PULLUP; /* pull-ups are DNP on board */
+#if PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING; /* decoder runs on every pin change */
+#endif
   GPIO_InitStruct.Pin = PIN_ENCL_A_PIN; HAL_GPIO_Init(PIN_ENCL_A_PORT, &GPIO_InitStruct); /* PTB0: ENCLA */
   GPIO_InitStruct.Pin = PIN_ENCL_B_PIN; HAL_GPIO_Init(PIN_ENCL_B_PORT, &GPIO_InitStruct); /* PTB1: ENCLB */
   GPIO_InitStruct.Pin = PIN_ENCR_A_PIN; HAL_GPIO_Init(PIN_ENCR_A_PORT, &GPIO_InitStruct); /* PTA6: ENCRA */
@@ -9,16 +9,21 @@
 #include "Platform.h"
 #include "Pin.h"
 #include <stdbool.h>
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_QUADRATURE
+  #include "Quadrature.h"
+#endif
 #if PL_CONFIG_BOARD==PL_CONFIG_BOARD_ID_STM32_NUCLEO
   #include "stm32f3xx_hal.h"
 #endif
+#if PL_CONFIG_HAS_CRITSEC
+  #include "CritSec.h"
+#endif
 
 #define SW3_Get()   (HAL_GPIO_ReadPin(PIN_SW3_PORT, PIN_SW3_PIN)==GPIO_PIN_SET)
 	/*!< returns the status of the SW3 switch */
-#define ENCL_A_Get()   (HAL_GPIO_ReadPin(PIN_ENCL_A_PORT, PIN_ENCL_A_PIN)==GPIO_PIN_SET)
-#define ENCL_B_Get()   (HAL_GPIO_ReadPin(PIN_ENCL_B_PORT, PIN_ENCL_B_PIN)==GPIO_PIN_SET)
-#define ENCR_A_Get()   (HAL_GPIO_ReadPin(PIN_ENCR_A_PORT, PIN_ENCR_A_PIN)==GPIO_PIN_SET)
-#define ENCR_B_Get()   (HAL_GPIO_ReadPin(PIN_ENCR_B_PORT, PIN_ENCR_B_PIN)==GPIO_PIN_SET)
 
 #define PROX_L_Get()   (HAL_GPIO_ReadPin(PIN_PROX_L_PORT, PIN_PROX_L_PIN)==GPIO_PIN_SET)
 #define PROX_M_Get()   (HAL_GPIO_ReadPin(PIN_PROX_M_PORT, PIN_PROX_M_PIN)==GPIO_PIN_SET)
@@ -28,10 +33,10 @@
 #define PROX_IR_SELECT_LOW()  	HAL_GPIO_WritePin(PIN_PROX_IR_SELECT_PORT, PIN_PROX_IR_SELECT_PIN, GPIO_PIN_RESET)
 #define PROX_IR_SELECT_TOGGLE()  HAL_GPIO_TogglePin(PIN_PROX_IR_SELECT_PORT, PIN_PROX_IR_SELECT_PIN)
 
-#define EDGE_L_Get()    (HAL_GPIO_ReadPin(PIN_EDGE_L_PORT, PIN_EDGE_L_PIN)==GPIO_PIN_SET)
-#define EDGE_ML_Get()   (HAL_GPIO_ReadPin(PIN_EDGE_ML_PORT, PIN_EDGE_ML_PIN)==GPIO_PIN_SET)
-#define EDGE_MR_Get()   (HAL_GPIO_ReadPin(PIN_EDGE_MR_PORT, PIN_EDGE_MR_PIN)==GPIO_PIN_SET)
-#define EDGE_R_Get()    (HAL_GPIO_ReadPin(PIN_EDGE_R_PORT, PIN_EDGE_R_PIN)==GPIO_PIN_SET)
+#define EDGE_L_HIGH()       HAL_GPIO_WritePin(PIN_EDGE_L_PORT, PIN_EDGE_L_PIN, GPIO_PIN_SET)
+#define EDGE_ML_HIGH()      HAL_GPIO_WritePin(PIN_EDGE_ML_PORT, PIN_EDGE_ML_PIN, GPIO_PIN_SET)
+#define EDGE_MR_HIGH()      HAL_GPIO_WritePin(PIN_EDGE_MR_PORT, PIN_EDGE_MR_PIN, GPIO_PIN_SET)
+#define EDGE_R_HIGH()       HAL_GPIO_WritePin(PIN_EDGE_R_PORT, PIN_EDGE_R_PIN, GPIO_PIN_SET)
 
 #define MOT_DIR_L_HIGH() 	HAL_GPIO_WritePin(PIN_DIRL_PORT, PIN_DIRL_PIN, GPIO_PIN_SET)
 #define MOT_DIR_L_LOW()  	HAL_GPIO_WritePin(PIN_DIRL_PORT, PIN_DIRL_PIN, GPIO_PIN_RESET)
@@ -63,6 +68,10 @@ void PIN_SetDirection(Pin_PinId pin, bool isOutput) {
 	  case PIN_I2C_SDA: port = PIN_I2C_SDA_PORT; pinNr = PIN_I2C_SDA_PIN; break;
 	  case PIN_I2C_SCL: port = PIN_I2C_SCL_PORT; pinNr = PIN_I2C_SCL_PIN; break;
 #endif
+	  case PIN_EDGE_L: port = PIN_EDGE_L_PORT; pinNr = PIN_EDGE_L_PIN; break;
+	  case PIN_EDGE_ML: port = PIN_EDGE_ML_PORT; pinNr = PIN_EDGE_ML_PIN; break;
+	  case PIN_EDGE_MR: port = PIN_EDGE_MR_PORT; pinNr = PIN_EDGE_MR_PIN; break;
+	  case PIN_EDGE_R: port = PIN_EDGE_R_PORT; pinNr = PIN_EDGE_R_PIN; break;
 	  default:
 		  for(;;) {} /* error! */
 		  break;
@@ -80,20 +89,88 @@ void PIN_SetDirection(Pin_PinId pin, bool isOutput) {
   HAL_GPIO_Init(port, &GPIO_InitStruct);
 }
 
+/* The edge interrupts do not use the RTOS API: the reflectance edges hand the end of the capture
+ * over to the TIM3 interrupt, see REF_OnFallingEdgeInterrupt() */
+#if PL_CONFIG_HAS_CRITSEC
+  #define PIN_QUAD_IRQ_PRIO     CRIT_IRQ_PRIO_QUAD    /* encoder pins, above the kernel: not masked by taskENTER_CRITICAL() */
+  #define PIN_CAPTURE_IRQ_PRIO  CRIT_IRQ_PRIO_CAPTURE /* reflectance edge pins */
+#else
+  #define PIN_QUAD_IRQ_PRIO     (5)
+  #define PIN_CAPTURE_IRQ_PRIO  (5)
+#endif
+
+static void EdgePortPin(Pin_PinId pin, GPIO_TypeDef **port, uint32_t *pinNr) {
+  switch(pin) {
+	  case PIN_EDGE_L: *port = PIN_EDGE_L_PORT; *pinNr = PIN_EDGE_L_PIN; break;
+	  case PIN_EDGE_ML: *port = PIN_EDGE_ML_PORT; *pinNr = PIN_EDGE_ML_PIN; break;
+	  case PIN_EDGE_MR: *port = PIN_EDGE_MR_PORT; *pinNr = PIN_EDGE_MR_PIN; break;
+	  case PIN_EDGE_R: *port = PIN_EDGE_R_PORT; *pinNr = PIN_EDGE_R_PIN; break;
+	  default:
+		  for(;;) {} /* error! */
+		  break;
+  }
+}
+
+void PIN_SetInputFallingEdgeInterrupt(Pin_PinId pin) {
+  GPIO_InitTypeDef GPIO_InitStruct;
+  uint32_t pinNr;
+  GPIO_TypeDef *port;
+
+  EdgePortPin(pin, &port, &pinNr);
+  __HAL_GPIO_EXTI_CLEAR_IT(pinNr); /* clear any pending edge from a previous measurement */
+  GPIO_InitStruct.Alternate = 0; /* init to default value */
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING; /* input with interrupt on falling edge */
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Pin = pinNr;
+  HAL_GPIO_Init(port, &GPIO_InitStruct);
+}
+
+void PIN_DisableEdgeInterrupt(Pin_PinId pin) {
+  uint32_t pinNr;
+  GPIO_TypeDef *port;
+
+  EdgePortPin(pin, &port, &pinNr);
+  EXTI->IMR &= ~pinNr; /* EXTI line number is the same as the pin number */
+  __HAL_GPIO_EXTI_CLEAR_IT(pinNr);
+}
+
+/*!
+ * \brief Called by HAL_GPIO_EXTI_IRQHandler() for each EXTI line with a pending interrupt.
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  /* all interrupt pins are on different EXTI lines, so the pin number is unique */
+  switch(GPIO_Pin) {
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
+    case PIN_EDGE_L_PIN:  REF_OnFallingEdgeInterrupt(0); break;
+    case PIN_EDGE_ML_PIN: REF_OnFallingEdgeInterrupt(1); break;
+    case PIN_EDGE_MR_PIN: REF_OnFallingEdgeInterrupt(2); break;
+    case PIN_EDGE_R_PIN:  REF_OnFallingEdgeInterrupt(3); break;
+#endif
+#if PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+    case PIN_ENCL_A_PIN:
+    case PIN_ENCL_B_PIN:  QUAD_OnEdgeInterrupt(true); break;
+    case PIN_ENCR_A_PIN:
+    case PIN_ENCR_B_PIN:  QUAD_OnEdgeInterrupt(false); break;
+#endif
+    default: break;
+  }
+}
+
 bool PIN_IsPinHigh(Pin_PinId pin) {
   switch(pin) {
     case PIN_SW3: return SW3_Get();
-    case PIN_ENCL_A: return ENCL_A_Get();
-    case PIN_ENCL_B: return ENCL_B_Get();
-    case PIN_ENCR_A: return ENCR_A_Get();
-    case PIN_ENCR_B: return ENCR_B_Get();
+    case PIN_ENCL_A: return PIN_ENCL_A_GET();
+    case PIN_ENCL_B: return PIN_ENCL_B_GET();
+    case PIN_ENCR_A: return PIN_ENCR_A_GET();
+    case PIN_ENCR_B: return PIN_ENCR_B_GET();
     case PIN_PROX_L: return PROX_L_Get();
     case PIN_PROX_M: return PROX_M_Get();
     case PIN_PROX_R: return PROX_R_Get();
-    case PIN_EDGE_L: return EDGE_L_Get();
-    case PIN_EDGE_ML: return EDGE_ML_Get();
-    case PIN_EDGE_MR: return EDGE_MR_Get();
-    case PIN_EDGE_R: return EDGE_R_Get();
+    case PIN_EDGE_L: return PIN_EDGE_L_GET();
+    case PIN_EDGE_ML: return PIN_EDGE_ML_GET();
+    case PIN_EDGE_MR: return PIN_EDGE_MR_GET();
+    case PIN_EDGE_R: return PIN_EDGE_R_GET();
 #if PL_CONFIG_HAS_I2C
     case PIN_I2C_SCL: return I2C_SCL_Get();
     case PIN_I2C_SDA: return I2C_SDA_Get();
@@ -112,6 +189,10 @@ void PIN_SetHigh(Pin_PinId pin) {
 	case PIN_PROX_IR_SELECT: PROX_IR_SELECT_HIGH(); break;
 	case PIN_DIR_L: MOT_DIR_L_HIGH(); break;
 	case PIN_DIR_R: MOT_DIR_R_HIGH(); break;
+	case PIN_EDGE_L: EDGE_L_HIGH(); break;
+	case PIN_EDGE_ML: EDGE_ML_HIGH(); break;
+	case PIN_EDGE_MR: EDGE_MR_HIGH(); break;
+	case PIN_EDGE_R: EDGE_R_HIGH(); break;
 #if PL_CONFIG_HAS_I2C
 	case PIN_I2C_SCL: I2C_SCL_HIGH(); break;
 	case PIN_I2C_SDA: I2C_SDA_HIGH(); break;
@@ -147,5 +228,21 @@ void PIN_Toggle(Pin_PinId pin) {
 }
 
 void PIN_Init(void) {
-  /* nothing required */
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
+  HAL_NVIC_SetPriority(EXTI4_IRQn, PIN_CAPTURE_IRQ_PRIO, 0); /* EdgeL */
+  HAL_NVIC_EnableIRQ(EXTI4_IRQn);
+  HAL_NVIC_SetPriority(EXTI9_5_IRQn, PIN_CAPTURE_IRQ_PRIO, 0); /* EdgeML, EdgeR */
+  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+  HAL_NVIC_SetPriority(EXTI15_10_IRQn, PIN_CAPTURE_IRQ_PRIO, 0); /* EdgeMR */
+  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+#endif
+#if PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+  HAL_NVIC_SetPriority(EXTI0_IRQn, PIN_QUAD_IRQ_PRIO, 0); /* ENCLA */
+  HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+  HAL_NVIC_SetPriority(EXTI1_IRQn, PIN_QUAD_IRQ_PRIO, 0); /* ENCLB */
+  HAL_NVIC_EnableIRQ(EXTI1_IRQn);
+  /* ENCRA, ENCRB: the vector is shared with EdgeML and EdgeR, so these two reflectance edges run at the encoder priority too */
+  HAL_NVIC_SetPriority(EXTI9_5_IRQn, PIN_QUAD_IRQ_PRIO, 0);
+  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+#endif
 }
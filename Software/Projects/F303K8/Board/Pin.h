@@ -63,6 +63,19 @@
 #define PIN_EDGE_R_PORT  	GPIOA
 #define PIN_EDGE_R_PIN   	GPIO_PIN_8
 
+/* Direct pin read access, for time critical code (sampling interrupts and measurement loops): one
+ * load of the input data register instead of the HAL call.
+ * Application modules shall use these macros instead of accessing the HAL directly. */
+#define PIN_ENCL_A_GET()  ((PIN_ENCL_A_PORT->IDR&PIN_ENCL_A_PIN)!=0u)
+#define PIN_ENCL_B_GET()  ((PIN_ENCL_B_PORT->IDR&PIN_ENCL_B_PIN)!=0u)
+#define PIN_ENCR_A_GET()  ((PIN_ENCR_A_PORT->IDR&PIN_ENCR_A_PIN)!=0u)
+#define PIN_ENCR_B_GET()  ((PIN_ENCR_B_PORT->IDR&PIN_ENCR_B_PIN)!=0u)
+
+#define PIN_EDGE_L_GET()  ((PIN_EDGE_L_PORT->IDR&PIN_EDGE_L_PIN)!=0u)
+#define PIN_EDGE_ML_GET() ((PIN_EDGE_ML_PORT->IDR&PIN_EDGE_ML_PIN)!=0u)
+#define PIN_EDGE_MR_GET() ((PIN_EDGE_MR_PORT->IDR&PIN_EDGE_MR_PIN)!=0u)
+#define PIN_EDGE_R_GET()  ((PIN_EDGE_R_PORT->IDR&PIN_EDGE_R_PIN)!=0u)
+
 #if PL_CONFIG_HAS_I2C
 #define PIN_I2C_SDA_PORT  	GPIOB
 #define PIN_I2C_SDA_PIN   	GPIO_PIN_7
@@ -110,6 +123,18 @@ void PIN_SetLow(Pin_PinId pin);
 void PIN_Toggle(Pin_PinId pin);
 void PIN_SetDirection(Pin_PinId pin, bool isOutput);
 
+/*!
+ * \brief Configures a pin as input with a falling edge interrupt. Only supported for the edge sensor pins.
+ * \param pin Pin to be used
+ */
+void PIN_SetInputFallingEdgeInterrupt(Pin_PinId pin);
+
+/*!
+ * \brief Masks the edge interrupt of a pin, configured with PIN_SetInputFallingEdgeInterrupt().
+ * \param pin Pin to be used
+ */
+void PIN_DisableEdgeInterrupt(Pin_PinId pin);
+
 /*!
  * \brief Pin driver initialization routine
  */
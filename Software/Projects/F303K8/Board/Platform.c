@@ -48,9 +48,24 @@
 #if PL_CONFIG_HAS_DRIVE
   #include "Drive.h"
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#if PL_CONFIG_HAS_TELEMETRY
+  #include "Telemetry.h"
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
+#if PL_CONFIG_HAS_SPAN
+  #include "Span.h"
+#endif
 #if PL_CONFIG_HAS_TURN
   #include "Turn.h"
 #endif
+#if PL_CONFIG_HAS_TRACKER
+  #include "Tracker.h"
+#endif
 #if PL_CONFIG_HAS_SHELL
   #include "McuShell.h"
   #include "Shell.h"
@@ -89,6 +104,15 @@
 #if PL_CONFIG_HAS_LINE
   #include "Line.h"
 #endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+#endif
+#if PL_CONFIG_HAS_DLOG
+  #include "DLog.h"
+#endif
+#if PL_CONFIG_HAS_CRITSEC
+  #include "CritSec.h"
+#endif
 #include "McuHardFault.h"
 
 #if McuGenericI2C_CONFIG_USE_ON_ERROR_EVENT
@@ -106,6 +130,14 @@ void McuGenericI2C_CONFIG_ON_RELEASE_BUS_EVENT(void) {
 }
 #endif
 
+#if McuGenericI2C_CONFIG_USE_ASYNC && McuGenericI2C_CONFIG_USE_ON_ASYNC_READY_EVENT
+void McuGenericI2C_CONFIG_ON_ASYNC_READY_EVENT(void) { /* from the interrupt: a task starts the next transfer */
+#if PL_CONFIG_HAS_LCD
+  LCD_OnI2CReady();
+#endif
+}
+#endif
+
 void PL_Init(void) {
 #if PL_CONFIG_USE_FREERTOS
   McuRTOS_Init(); /* must be first to disable the interrupts */
@@ -156,6 +188,18 @@ void PL_Init(void) {
 #if PL_CONFIG_HAS_SHELL
   SHELL_Init();
 #endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  NVMC_Init(); /* before the modules with stored values */
+#endif
+#if PL_CONFIG_HAS_SPAN
+  SPAN_Init(); /* before the modules with spans */
+#endif
+#if PL_CONFIG_HAS_DLOG
+  DLOG_Init(); /* before the modules which log */
+#endif
+#if PL_CONFIG_HAS_CRITSEC
+  CRIT_Init(); /* before the timer interrupt */
+#endif
 #if PL_CONFIG_HAS_MOTOR
   PWM_Init();
   MOT_Init();
@@ -181,9 +225,21 @@ void PL_Init(void) {
 #if PL_CONFIG_HAS_DRIVE
   DRV_Init();
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_Init();
+#endif
+#if PL_CONFIG_HAS_TELEMETRY
+  TELE_Init();
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  REC_Init();
+#endif
 #if PL_CONFIG_HAS_TURN
   TURN_Init();
 #endif
+#if PL_CONFIG_HAS_TRACKER
+  TRACK_Init();
+#endif
 #if PL_CONFIG_HAS_LINE
   LINE_Init();
 #endif
@@ -9,25 +9,63 @@
 #include "Timer.h"
 #include "stm32f3xx_hal.h"
 #include "Quadrature.h"
+#include "Reflectance.h"
+#include "Proximity.h"
 #include "Pin.h"
+#if PL_CONFIG_HAS_EXEC
+  #include "Exec.h"
+#endif
+#if PL_CONFIG_HAS_CRITSEC
+  #include "CritSec.h"
+#endif
+
+#if PL_CONFIG_HAS_QUADRATURE
+#if QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_SAMPLED
+  #define TMRQ_PERIOD_TICKS   (6400) /* 6400 ticks @ 64 MHz ==> 100us, samples the encoder pins */
+  #define TMRQ_USE_INTERRUPTS (1)
+#else /* the encoders are decoded in their pin interrupts */
+  /* Only a probe for the entry latency at the priority of the encoder interrupts (CritSec.c). The
+   * period of about 900 us is no multiple of the RTOS tick, so the probe hits all phases of it. */
+  #define TMRQ_PERIOD_TICKS   (9*6400+37)
+  #define TMRQ_USE_INTERRUPTS (PL_CONFIG_HAS_CRITSEC && CRIT_CONFIG_MEASURE_JITTER)
+#endif
+#endif
 
 #if PL_CONFIG_HAS_QUADRATURE
-TIM_HandleTypeDef htim1; /* quadrature sampling timer */
+TIM_HandleTypeDef htim1; /* quadrature sampling timer, or latency probe with the edge decoder */
 #endif
 #if PL_CONFIG_HAS_REFLECTANCE
 TIM_HandleTypeDef htim3; /* reflectance sensor measurement timer */
 #endif
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+TIM_HandleTypeDef htim17; /* proximity IR burst timer */
+#endif
+#if PL_CONFIG_HAS_EXEC
+TIM_HandleTypeDef htim6; /* cycle of the control executive */
+#endif
 
 void TMR_OnInterrupt(TIM_HandleTypeDef *htim) {
 #if PL_CONFIG_HAS_QUADRATURE
   if (htim==&htim1) {
+#if QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_SAMPLED
 	  QUAD_Sample();
+#endif
 	  //PIN_Toggle(PIN_DIR_L);
   }
 #endif
-#if PL_CONFIG_HAS_REFLECTANCE
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
   if (htim==&htim3) {
-	  //PIN_Toggle(PIN_DIR_R);
+	  REF_OnTimeoutInterrupt();
+  }
+#endif
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+  if (htim==&htim17) {
+    PROX_OnBurstTimerInterrupt();
+  }
+#endif
+#if PL_CONFIG_HAS_EXEC
+  if (htim==&htim6) {
+    EXEC_OnCycleInterrupt();
   }
 #endif
 }
@@ -43,7 +81,7 @@ static void MX_TIM1_Init(void)
   htim1.Instance = TIM1;
   htim1.Init.Prescaler = 0; /* APB1 peripheral clock should be 64 MHz. */
   htim1.Init.CounterMode = TIM_COUNTERMODE_DOWN;
-  htim1.Init.Period = (6400-1); /* 6400 ticks @ 64 MHz ==> 100us  */
+  htim1.Init.Period = (TMRQ_PERIOD_TICKS-1);
   htim1.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
   htim1.Init.RepetitionCounter = 0;
   htim1.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
@@ -101,6 +139,40 @@ static void MX_TIM3_Init(void)
 }
 #endif
 
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+/* TIM17 init function */
+static void MX_TIM17_Init(void)
+{
+  htim17.Instance = TIM17;
+  htim17.Init.Prescaler = (64-1); /* 64 MHz / 64 ==> 1 us per tick */
+  htim17.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim17.Init.Period = (1000-1); /* changed with each interrupt */
+  htim17.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim17.Init.RepetitionCounter = 0;
+  htim17.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE; /* new period is effective immediately */
+  if (HAL_TIM_Base_Init(&htim17) != HAL_OK)
+  {
+    _Error_Handler(__FILE__, __LINE__);
+  }
+}
+#endif
+
+#if PL_CONFIG_HAS_EXEC
+/* TIM6 init function */
+static void MX_TIM6_Init(void)
+{
+  htim6.Instance = TIM6;
+  htim6.Init.Prescaler = (64-1); /* 64 MHz / 64 ==> 1 us per tick */
+  htim6.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim6.Init.Period = (EXEC_CONFIG_CYCLE_US-1);
+  htim6.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim6) != HAL_OK)
+  {
+    _Error_Handler(__FILE__, __LINE__);
+  }
+}
+#endif
+
 /* Reflectance timer ***************************************/
 #if PL_CONFIG_HAS_REFLECTANCE
 void TMRR_Start(void) {
@@ -111,6 +183,19 @@ void TMRR_Stop(void) {
   HAL_TIM_Base_Stop(&htim3); /* stop timer interrupts */
 }
 
+void TMRR_StartInterrupts(void) {
+  __HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_UPDATE); /* clear flag set by the update event during init or a previous run */
+  HAL_TIM_Base_Start_IT(&htim3); /* start timer with interrupts */
+}
+
+void TMRR_StopInterrupts(void) {
+  HAL_TIM_Base_Stop_IT(&htim3); /* stop timer and interrupts */
+}
+
+void TMRR_TriggerInterrupt(void) {
+  htim3.Instance->EGR = TIM_EGR_UG; /* update event by software: sets the update flag like an overflow */
+}
+
 uint32_t TMRR_SetCounter(uint32_t value) {
   return __HAL_TIM_SET_COUNTER(&htim3, value); /* return timer counter */
 }
@@ -119,6 +204,23 @@ uint32_t TMRR_GetCounter(void) {
   return __HAL_TIM_GET_COUNTER(&htim3); /* return timer counter */
 }
 #endif
+/* Proximity timer ***************************************/
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+void TMRP_StartInterrupts(uint16_t us) {
+  __HAL_TIM_SET_COUNTER(&htim17, 0);
+  __HAL_TIM_SET_AUTORELOAD(&htim17, us-1);
+  __HAL_TIM_CLEAR_FLAG(&htim17, TIM_FLAG_UPDATE); /* clear flag set by the update event during init */
+  HAL_TIM_Base_Start_IT(&htim17); /* start timer with interrupts */
+}
+
+void TMRP_StopInterrupts(void) {
+  HAL_TIM_Base_Stop_IT(&htim17); /* stop timer and interrupts */
+}
+
+void TMRP_SetInterval(uint16_t us) {
+  __HAL_TIM_SET_AUTORELOAD(&htim17, us-1); /* counter has just restarted from 0 */
+}
+#endif
 /* Quadrature timer ***************************************/
 #if PL_CONFIG_HAS_QUADRATURE
 void TMRQ_Start(void) {
@@ -145,10 +247,20 @@ uint32_t TMRQ_GetCounter(void) {
 void TMR_Init(void) {
 #if PL_CONFIG_HAS_QUADRATURE
   MX_TIM1_Init();
+  #if TMRQ_USE_INTERRUPTS
   TMRQ_StartInterrupts();
+  #endif
 #endif
 #if PL_CONFIG_HAS_REFLECTANCE
   MX_TIM3_Init();
   //TMRR_Start();
 #endif
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+  MX_TIM17_Init(); /* started by the proximity task */
+#endif
+#if PL_CONFIG_HAS_EXEC
+  MX_TIM6_Init();
+  __HAL_TIM_CLEAR_FLAG(&htim6, TIM_FLAG_UPDATE); /* clear flag set by the update event during init */
+  HAL_TIM_Base_Start_IT(&htim6); /* the executive ignores releases until its task exists */
+#endif
 }
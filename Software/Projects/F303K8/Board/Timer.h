@@ -51,11 +51,45 @@ void TMRQ_Stop(void);
 /* reflectance sensor timer */
 void TMRR_Start(void);
 void TMRR_Stop(void);
+
+/*!
+ * \brief Start the reflectance timer with the overflow (timeout) interrupt enabled
+ */
+void TMRR_StartInterrupts(void);
+
+/*!
+ * \brief Stop the reflectance timer and its interrupts
+ */
+void TMRR_StopInterrupts(void);
+
+/*!
+ * \brief Makes the update (timeout) interrupt of the reflectance timer pending now. Used by the
+ * interrupts above the kernel level to hand over to an interrupt which can use the RTOS API.
+ */
+void TMRR_TriggerInterrupt(void);
 uint32_t TMRR_SetCounter(uint32_t value);
 uint32_t TMRR_GetCounter(void);
 
+/* proximity IR burst timer, counting microseconds */
+/*!
+ * \brief Start the proximity burst timer with the update interrupt enabled
+ * \param us Microseconds until the first interrupt
+ */
+void TMRP_StartInterrupts(uint16_t us);
+
+/*!
+ * \brief Stop the proximity burst timer and its interrupts
+ */
+void TMRP_StopInterrupts(void);
+
+/*!
+ * \brief Sets the time until the next interrupt, to be called from the timer interrupt
+ * \param us Microseconds until the next interrupt
+ */
+void TMRP_SetInterval(uint16_t us);
+
 /*!
- * \brief Timer initialization routine
+ * \brief Timer initialization routine. With the control executive, it starts its cycle timer (TIM6).
  */
 void TMR_Init(void);
 
@@ -43,9 +43,16 @@
 
 #define PL_CONFIG_HAS_DRIVE         (1 && PL_CONFIG_HAS_QUADRATURE)
 #define PL_CONFIG_HAS_TURN          (1 && PL_CONFIG_HAS_QUADRATURE)
+#define PL_CONFIG_HAS_ODOMETRY      (1 && PL_CONFIG_HAS_QUADRATURE && PL_CONFIG_HAS_DRIVE)
+#define PL_CONFIG_HAS_TRACKER       (1 && PL_CONFIG_HAS_PROXIMITY && PL_CONFIG_HAS_TURN)
+#define PL_CONFIG_HAS_TELEMETRY     (1 && PL_CONFIG_HAS_DRIVE)
+#define PL_CONFIG_HAS_RECORDER      (1 && PL_CONFIG_HAS_DRIVE)
+#define PL_CONFIG_HAS_SPAN          (1) /* timing of the hot paths, 0 removes all markers */
+#define PL_CONFIG_HAS_DLOG          (1) /* deferred binary log over RTT */
+#define PL_CONFIG_HAS_CRITSEC       (1 && PL_CONFIG_USE_FREERTOS) /* critical sections with BASEPRI, quadrature interrupt above the kernel */
 
 #define PL_CONFIG_HAS_UART          (0) /* NYI */
-#define PL_CONFIG_HAS_CONFIG_NVM    (0) /* NYI */
+#define PL_CONFIG_HAS_CONFIG_NVM    (1) /* calibration, PID and turn parameters in flash */
 
 #define PL_CONFIG_HAS_I2C           (1)
 #define PL_CONFIG_HAS_HW_I2C        (1 && PL_CONFIG_HAS_I2C) /* otherwise uses SW I2C */
@@ -58,6 +65,7 @@
 #define PL_CONFIG_HAS_LINE_FOLLOW   (0 && PL_CONFIG_HAS_MOTOR && PL_CONFIG_HAS_LINE && PL_CONFIG_HAS_LINE_PID)
 #define PL_CONFIG_HAS_LINE_MAZE     (0 && PL_CONFIG_HAS_LINE_FOLLOW)
 #define PL_CONFIG_HAS_SUMO          (1 && PL_CONFIG_HAS_DRIVE && PL_CONFIG_HAS_TURN)
+#define PL_CONFIG_HAS_EXEC          (1 && PL_CONFIG_USE_FREERTOS && PL_CONFIG_HAS_DRIVE) /* sensors, strategy and motors in one 1 ms executive instead of their tasks */
 
 #define PL_APP_LINE_FOLLOWING 1
 #define PL_APP_LINE_MAZE      0
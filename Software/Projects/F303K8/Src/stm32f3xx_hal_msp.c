@@ -41,7 +41,20 @@
 
 //extern void _Error_Handler(char *, int);
 /* USER CODE BEGIN 0 */
-
+#include "Platform.h"
+#if PL_CONFIG_HAS_CRITSEC
+  #include "CritSec.h"
+#endif
+#if PL_CONFIG_HAS_HW_I2C
+  #include "McuGenericI2C.h"
+#endif
+#if PL_CONFIG_HAS_HW_I2C && McuGenericI2C_CONFIG_USE_ASYNC
+  #define I2C_IRQ_PRIO   (6) /* completion calls the RTOS API, so must be numerically >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY */
+  #if McuSTM32HALI2C_CONFIG_USE_DMA
+    DMA_HandleTypeDef hdma_i2c1_tx;
+  #endif
+  extern void _Error_Handler(char *, int);
+#endif
 /* USER CODE END 0 */
 /**
   * Initializes the Global MSP.
@@ -101,7 +114,32 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef* hi2c)
     /* Peripheral clock enable */
     __HAL_RCC_I2C1_CLK_ENABLE();
   /* USER CODE BEGIN I2C1_MspInit 1 */
-
+#if PL_CONFIG_HAS_HW_I2C && McuGenericI2C_CONFIG_USE_ASYNC
+  #if McuSTM32HALI2C_CONFIG_USE_DMA
+    /* I2C1_TX on DMA1 channel 6 */
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdma_i2c1_tx.Instance = DMA1_Channel6;
+    hdma_i2c1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_i2c1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_i2c1_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_i2c1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_i2c1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_i2c1_tx.Init.Mode = DMA_NORMAL;
+    hdma_i2c1_tx.Init.Priority = DMA_PRIORITY_LOW;
+    if (HAL_DMA_Init(&hdma_i2c1_tx) != HAL_OK)
+    {
+      _Error_Handler(__FILE__, __LINE__);
+    }
+    __HAL_LINKDMA(hi2c, hdmatx, hdma_i2c1_tx);
+    HAL_NVIC_SetPriority(DMA1_Channel6_IRQn, I2C_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+  #endif
+    /* the HAL uses the I2C interrupts for the end of the transfer and errors, also with DMA */
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, I2C_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, I2C_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+#endif
   /* USER CODE END I2C1_MspInit 1 */
   }
 
@@ -125,7 +163,14 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef* hi2c)
     HAL_GPIO_DeInit(GPIOB, GPIO_PIN_6|GPIO_PIN_7);
 
   /* USER CODE BEGIN I2C1_MspDeInit 1 */
-
+#if PL_CONFIG_HAS_HW_I2C && McuGenericI2C_CONFIG_USE_ASYNC
+  #if McuSTM32HALI2C_CONFIG_USE_DMA
+    HAL_DMA_DeInit(hi2c->hdmatx);
+    HAL_NVIC_DisableIRQ(DMA1_Channel6_IRQn);
+  #endif
+    HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
+#endif
   /* USER CODE END I2C1_MspDeInit 1 */
   }
 
@@ -147,6 +192,11 @@ void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* htim_base)
     HAL_NVIC_SetPriority(TIM1_UP_TIM16_IRQn, 0, 0);
     HAL_NVIC_EnableIRQ(TIM1_UP_TIM16_IRQn);
   /* USER CODE BEGIN TIM1_MspInit 1 */
+#if PL_CONFIG_HAS_CRITSEC
+    /* priority 0 cannot be masked with BASEPRI: one level lower, still above the kernel */
+    HAL_NVIC_SetPriority(TIM1_BRK_TIM15_IRQn, CRIT_IRQ_PRIO_QUAD, 0);
+    HAL_NVIC_SetPriority(TIM1_UP_TIM16_IRQn, CRIT_IRQ_PRIO_QUAD, 0);
+#endif
 
   /* USER CODE END TIM1_MspInit 1 */
   }
@@ -169,9 +219,26 @@ void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* htim_base)
     /* Peripheral clock enable */
     __HAL_RCC_TIM3_CLK_ENABLE();
   /* USER CODE BEGIN TIM3_MspInit 1 */
+    /* TIM3 interrupt Init: reflectance measurement timeout, calls RTOS API */
+    HAL_NVIC_SetPriority(TIM3_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
 
   /* USER CODE END TIM3_MspInit 1 */
   }
+  else if(htim_base->Instance==TIM17)
+  {
+    __HAL_RCC_TIM17_CLK_ENABLE();
+    /* TIM17 interrupt Init: proximity IR bursts, calls RTOS API */
+    HAL_NVIC_SetPriority(TIM1_TRG_COM_TIM17_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(TIM1_TRG_COM_TIM17_IRQn);
+  }
+  else if(htim_base->Instance==TIM6)
+  {
+    __HAL_RCC_TIM6_CLK_ENABLE();
+    /* TIM6 interrupt Init: cycle of the control executive, calls RTOS API */
+    HAL_NVIC_SetPriority(TIM6_DAC1_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(TIM6_DAC1_IRQn);
+  }
 
 }
 
@@ -240,9 +307,20 @@ void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* htim_base)
     /* Peripheral clock disable */
     __HAL_RCC_TIM3_CLK_DISABLE();
   /* USER CODE BEGIN TIM3_MspDeInit 1 */
+    HAL_NVIC_DisableIRQ(TIM3_IRQn);
 
   /* USER CODE END TIM3_MspDeInit 1 */
   }
+  else if(htim_base->Instance==TIM17)
+  {
+    __HAL_RCC_TIM17_CLK_DISABLE();
+    HAL_NVIC_DisableIRQ(TIM1_TRG_COM_TIM17_IRQn);
+  }
+  else if(htim_base->Instance==TIM6)
+  {
+    __HAL_RCC_TIM6_CLK_DISABLE();
+    HAL_NVIC_DisableIRQ(TIM6_DAC1_IRQn);
+  }
 
 }
 
@@ -38,11 +38,30 @@
 /* USER CODE BEGIN 0 */
 #include "Platform.h"
 #include "Timer.h"
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_QUADRATURE
+  #include "Quadrature.h"
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  #include "Proximity.h"
+#endif
+#if PL_CONFIG_HAS_HW_I2C
+  #include "Board.h" /* hi2c1 */
+  #include "McuGenericI2C.h"
+#endif
+#if PL_CONFIG_HAS_CRITSEC
+  #include "CritSec.h"
+#endif
 
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
 extern TIM_HandleTypeDef htim1;
+extern TIM_HandleTypeDef htim3;
+extern TIM_HandleTypeDef htim17;
+extern TIM_HandleTypeDef htim6;
 
 /******************************************************************************/
 /*            Cortex-M4 Processor Interruption and Exception Handlers         */ 
@@ -95,7 +114,11 @@ void TIM1_BRK_TIM15_IRQHandler(void)
 void TIM1_UP_TIM16_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM1_UP_TIM16_IRQn 0 */
-
+#if PL_CONFIG_HAS_CRITSEC && CRIT_CONFIG_MEASURE_JITTER
+  /* down counter: ticks since the update event, which is when the interrupt got pending. TIM1 has
+   * the priority of the quadrature decoder, also when it is only a probe for the edge decoder. */
+  CRIT_OnQuadIsrEntry(__HAL_TIM_GET_AUTORELOAD(&htim1)-__HAL_TIM_GET_COUNTER(&htim1));
+#endif
   /* USER CODE END TIM1_UP_TIM16_IRQn 0 */
   HAL_TIM_IRQHandler(&htim1);
   /* USER CODE BEGIN TIM1_UP_TIM16_IRQn 1 */
@@ -104,6 +127,120 @@ void TIM1_UP_TIM16_IRQHandler(void)
 }
 #endif
 /* USER CODE BEGIN 1 */
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
+/**
+* @brief This function handles TIM3 global interrupt (reflectance measurement timeout).
+*/
+void TIM3_IRQHandler(void)
+{
+  HAL_TIM_IRQHandler(&htim3);
+  TMR_OnInterrupt(&htim3);
+}
+#endif
+
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+/**
+* @brief This function handles TIM17 global interrupt (proximity IR bursts).
+*/
+void TIM1_TRG_COM_TIM17_IRQHandler(void)
+{
+  HAL_TIM_IRQHandler(&htim17);
+  TMR_OnInterrupt(&htim17);
+}
+#endif
+
+#if PL_CONFIG_HAS_EXEC
+/**
+* @brief This function handles TIM6 global interrupt (cycle of the control executive).
+*/
+void TIM6_DAC1_IRQHandler(void)
+{
+  HAL_TIM_IRQHandler(&htim6);
+  TMR_OnInterrupt(&htim6);
+}
+#endif
+
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
+/**
+* @brief This function handles EXTI line 4 interrupt (EdgeL).
+*/
+void EXTI4_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4);
+}
+
+/**
+* @brief This function handles EXTI lines 10 to 15 interrupt (EdgeMR).
+*/
+void EXTI15_10_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_11);
+}
+#endif
 
+#if PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+/**
+* @brief This function handles EXTI line 0 interrupt (ENCLA).
+*/
+void EXTI0_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0);
+}
+
+/**
+* @brief This function handles EXTI line 1 interrupt (ENCLB).
+*/
+void EXTI1_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_1);
+}
+#endif
+
+#if (PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE) || (PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE)
+/**
+* @brief This function handles EXTI lines 5 to 9 interrupt (EdgeML, EdgeR, ENCRA, ENCRB).
+*/
+void EXTI9_5_IRQHandler(void)
+{
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_5);
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_8);
+#endif
+#if PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_6);
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_7);
+#endif
+}
+#endif
+
+#if PL_CONFIG_HAS_HW_I2C && McuGenericI2C_CONFIG_USE_ASYNC
+/**
+* @brief This function handles I2C1 event interrupt (asynchronous transfers).
+*/
+void I2C1_EV_IRQHandler(void)
+{
+  HAL_I2C_EV_IRQHandler(&hi2c1);
+}
+
+/**
+* @brief This function handles I2C1 error interrupt (asynchronous transfers).
+*/
+void I2C1_ER_IRQHandler(void)
+{
+  HAL_I2C_ER_IRQHandler(&hi2c1);
+}
+
+#if McuSTM32HALI2C_CONFIG_USE_DMA
+extern DMA_HandleTypeDef hdma_i2c1_tx;
+
+/**
+* @brief This function handles DMA1 channel 6 interrupt (I2C1_TX).
+*/
+void DMA1_Channel6_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_i2c1_tx);
+}
+#endif
+#endif /* PL_CONFIG_HAS_HW_I2C && McuGenericI2C_CONFIG_USE_ASYNC */
 /* USER CODE END 1 */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
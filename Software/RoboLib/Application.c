@@ -35,6 +35,9 @@
 #if PL_CONFIG_HAS_PID
   #include "Pid.h"
 #endif
+#if PL_CONFIG_HAS_EXEC
+  #include "Exec.h"
+#endif
 
 #if PL_CONFIG_USE_FREERTOS
 
@@ -114,6 +117,10 @@ static void ConfigurePID(void) {
     config->maxSpeedPercent = 40;
     config->lastError = 0;
     config->integral = 0;
+    config->ffFactor100 = 0;
+    config->outLimit = 0xffff/1000; /* position PID output gets scaled by 1000 */
+    config->dFilterShift = 0;
+    PID_ConfigChanged(config);
   }
   res = PID_GetPIDConfig(PID_CONFIG_POS_RIGHT, &config);
   if (res==ERR_OK) {
@@ -124,6 +131,10 @@ static void ConfigurePID(void) {
     config->maxSpeedPercent = 40;
     config->lastError = 0;
     config->integral = 0;
+    config->ffFactor100 = 0;
+    config->outLimit = 0xffff/1000; /* position PID output gets scaled by 1000 */
+    config->dFilterShift = 0;
+    PID_ConfigChanged(config);
   }
 #if PL_CONFIG_HAS_SPEED_PID
   res = PID_GetPIDConfig(PID_CONFIG_SPEED_LEFT, &config);
@@ -135,6 +146,10 @@ static void ConfigurePID(void) {
     config->maxSpeedPercent = 100;
     config->lastError = 0;
     config->integral = 0;
+    config->ffFactor100 = 0;
+    config->outLimit = 0xffff; /* PWM */
+    config->dFilterShift = 0;
+    PID_ConfigChanged(config);
   }
   res = PID_GetPIDConfig(PID_CONFIG_SPEED_RIGHT, &config);
   if (res==ERR_OK) {
@@ -145,6 +160,10 @@ static void ConfigurePID(void) {
     config->maxSpeedPercent = 100;
     config->lastError = 0;
     config->integral = 0;
+    config->ffFactor100 = 0;
+    config->outLimit = 0xffff; /* PWM */
+    config->dFilterShift = 0;
+    PID_ConfigChanged(config);
   }
 #endif
 #if PL_CONFIG_HAS_LINE_PID
@@ -157,8 +176,15 @@ static void ConfigurePID(void) {
     config->maxSpeedPercent = 50;
     config->lastError = 0;
     config->integral = 0;
+    config->ffFactor100 = 0;
+    config->outLimit = 0xffff; /* PWM */
+    config->dFilterShift = 0;
+    PID_ConfigChanged(config);
   }
 #endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  PID_LoadConfigs(); /* parameters stored with 'pid save' replace the defaults */
+#endif
 }
 #endif
 
@@ -167,6 +193,9 @@ void APP_Run(void) {
 #if PL_CONFIG_HAS_SUMO
   SUMO_Init();
 #endif
+#if PL_CONFIG_HAS_EXEC
+  EXEC_Init(); /* after the modules of its stages */
+#endif
 #if PL_CONFIG_HAS_PID
   ConfigurePID();
 #endif
@@ -0,0 +1,284 @@
+/**
+ * \file
+ * \brief Shell command registry
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The hash index has an entry for each group name and for each command path ("group command"),
+ * with open addressing. A command line is split into words, and the hashes of the first 1..n words
+ * are calculated in one pass. The longest path found in the index is the command, the remaining
+ * words are its arguments.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+#include "McuShell.h"
+#include "McuUtility.h"
+#include <string.h>
+
+#if (CMD_CONFIG_HASH_SIZE&(CMD_CONFIG_HASH_SIZE-1))!=0
+  #error "CMD_CONFIG_HASH_SIZE has to be a power of two"
+#endif
+
+#define CMD_ENTRY_GROUP   (0xFF) /* index entry of a group name */
+#define CMD_FNV_OFFSET    (2166136261u)
+#define CMD_FNV_PRIME     (16777619u)
+
+static const CMD_Group *const *CMD_groups = NULL; /* registered groups, NULL terminated */
+static uint16_t CMD_index[CMD_CONFIG_HASH_SIZE]; /* 0: empty, otherwise (group+1)<<8 | command or CMD_ENTRY_GROUP */
+static uint8_t CMD_maxPathWords; /* number of words of the longest registered path */
+
+static uint32_t CMD_HashWord(uint32_t hash, const unsigned char *word) {
+  while(*word!='\0' && *word!=' ') {
+    hash = (hash^*word)*CMD_FNV_PRIME;
+    word++;
+  }
+  return hash;
+}
+
+static uint32_t CMD_HashPath(uint32_t hash, const unsigned char *path, uint8_t *nofWords) {
+  for(;;) {
+    hash = CMD_HashWord(hash, path);
+    (*nofWords)++;
+    while(*path!='\0' && *path!=' ') {
+      path++;
+    }
+    if (*path=='\0') {
+      return hash;
+    }
+    path++; /* skip space */
+    hash = (hash^' ')*CMD_FNV_PRIME;
+  }
+}
+
+static uint8_t CMD_Insert(uint32_t hash, uint16_t entry) {
+  unsigned int i, n;
+
+  i = hash&(CMD_CONFIG_HASH_SIZE-1);
+  for(n=0; n<CMD_CONFIG_HASH_SIZE; n++) {
+    if (CMD_index[i]==0) {
+      CMD_index[i] = entry;
+      return ERR_OK;
+    }
+    i = (i+1)&(CMD_CONFIG_HASH_SIZE-1);
+  }
+  return ERR_OVERFLOW;
+}
+
+/* splits the line into zero terminated words, returns the number of words or CMD_CONFIG_MAX_TOKENS+1 if there are too many */
+static uint8_t CMD_Tokenize(unsigned char *line, unsigned char **tokens) {
+  uint8_t n = 0;
+
+  for(;;) {
+    while(*line==' ') {
+      line++;
+    }
+    if (*line=='\0') {
+      return n;
+    }
+    if (n==CMD_CONFIG_MAX_TOKENS) {
+      return CMD_CONFIG_MAX_TOKENS+1;
+    }
+    tokens[n++] = line;
+    while(*line!='\0' && *line!=' ') {
+      line++;
+    }
+    if (*line==' ') {
+      *line++ = '\0';
+    }
+  }
+}
+
+/* checks if the words of a path, separated by single spaces, are the tokens */
+static bool CMD_MatchWords(const char *path, unsigned char *const *tokens, uint8_t nofTokens) {
+  const unsigned char *t;
+  uint8_t i;
+
+  for(i=0; i<nofTokens; i++) {
+    if (i>0) {
+      if (*path!=' ') {
+        return FALSE;
+      }
+      path++;
+    }
+    t = tokens[i];
+    while(*t!='\0' && *t==(unsigned char)*path) {
+      t++;
+      path++;
+    }
+    if (*t!='\0') {
+      return FALSE;
+    }
+  }
+  return *path=='\0';
+}
+
+/* parses the arguments with the signature of the command and calls the handler */
+static uint8_t CMD_Call(const CMD_Command *cmd, unsigned char *const *tokens, uint8_t nofTokens, const McuShell_StdIOType *io) {
+  CMD_Arg args[CMD_CONFIG_MAX_ARGS];
+  const unsigned char *p;
+  uint8_t i, res;
+
+  for(i=0; cmd->args[i]!='\0'; i++) {
+    if (i>=nofTokens || i>=CMD_CONFIG_MAX_ARGS) {
+      break; /* missing argument */
+    }
+    p = tokens[i];
+    switch(cmd->args[i]) {
+      case CMD_ARG_INT:
+        res = McuUtility_xatoi(&p, &args[i].i);
+        break;
+      case CMD_ARG_UINT:
+        res = McuUtility_ScanDecimal32uNumber(&p, &args[i].u);
+        break;
+      case CMD_ARG_STRING:
+        args[i].str = p;
+        p += McuUtility_strlen((char*)p);
+        res = ERR_OK;
+        break;
+      default:
+        res = ERR_FAILED;
+        break;
+    }
+    if (res!=ERR_OK || *p!='\0') {
+      break; /* wrong argument */
+    }
+  }
+  if (cmd->args[i]!='\0' || i!=nofTokens) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return cmd->handler(args, io);
+}
+
+/* calls all parser callbacks, or help/status of all groups */
+static uint8_t CMD_IterateGroups(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io, bool isHelp, bool isStatus) {
+  const CMD_Group *const *g;
+  uint8_t res = ERR_OK;
+
+  for(g=CMD_groups; *g!=NULL; g++) {
+    if ((*g)->parser!=NULL) {
+      if ((*g)->parser(cmd, handled, io)!=ERR_OK) {
+        res = ERR_FAILED;
+      }
+    } else if (isHelp) {
+      (*g)->help(io);
+      *handled = TRUE;
+    } else if (isStatus && (*g)->status!=NULL) {
+      (*g)->status(io);
+      *handled = TRUE;
+    }
+  }
+  return res;
+}
+
+/* command of a group without command path: help, status, or the command with arguments only */
+static uint8_t CMD_ParseGroupCommand(const CMD_Group *group, const unsigned char *cmd, unsigned char *const *tokens, uint8_t nofTokens, bool *handled, const McuShell_StdIOType *io) {
+  uint8_t i;
+
+  if (group->parser!=NULL) {
+    return group->parser(cmd, handled, io);
+  }
+  if (nofTokens==2 && McuUtility_strcmp((char*)tokens[1], McuShell_CMD_HELP)==0) {
+    group->help(io);
+    *handled = TRUE;
+    return ERR_OK;
+  }
+  if (nofTokens==2 && group->status!=NULL && McuUtility_strcmp((char*)tokens[1], McuShell_CMD_STATUS)==0) {
+    group->status(io);
+    *handled = TRUE;
+    return ERR_OK;
+  }
+  for(i=0; i<group->nofCmds; i++) {
+    if (group->cmds[i].name[0]=='\0') {
+      *handled = TRUE;
+      return CMD_Call(&group->cmds[i], tokens+1, (uint8_t)(nofTokens-1), io);
+    }
+  }
+  return ERR_OK; /* not handled */
+}
+
+uint8_t CMD_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
+  unsigned char line[McuShell_DEFAULT_SHELL_BUFFER_SIZE];
+  unsigned char *tokens[CMD_CONFIG_MAX_TOKENS];
+  uint32_t hashes[CMD_CONFIG_MAX_TOKENS];
+  uint8_t nofTokens, k, c;
+  unsigned int i;
+  uint16_t entry;
+  const CMD_Group *group;
+
+  if (CMD_groups==NULL) {
+    return ERR_FAILED; /* not initialized */
+  }
+  if (McuUtility_strlen((char*)cmd)>=sizeof(line)) {
+    return CMD_IterateGroups(cmd, handled, io, FALSE, FALSE);
+  }
+  McuUtility_strcpy(line, sizeof(line), cmd);
+  nofTokens = CMD_Tokenize(line, tokens);
+  if (nofTokens==0 || nofTokens>CMD_CONFIG_MAX_TOKENS) {
+    return CMD_IterateGroups(cmd, handled, io, FALSE, FALSE);
+  }
+  if (nofTokens==1 && McuUtility_strcmp((char*)tokens[0], McuShell_CMD_HELP)==0) {
+    return CMD_IterateGroups(cmd, handled, io, TRUE, FALSE);
+  }
+  if (nofTokens==1 && McuUtility_strcmp((char*)tokens[0], McuShell_CMD_STATUS)==0) {
+    return CMD_IterateGroups(cmd, handled, io, FALSE, TRUE);
+  }
+  hashes[0] = CMD_HashWord(CMD_FNV_OFFSET, tokens[0]);
+  for(k=1; k<nofTokens && k<CMD_maxPathWords; k++) {
+    hashes[k] = CMD_HashWord((hashes[k-1]^' ')*CMD_FNV_PRIME, tokens[k]);
+  }
+  /* k: number of words of the path, longest first */
+  for(; k>0; k--) {
+    i = hashes[k-1]&(CMD_CONFIG_HASH_SIZE-1);
+    while((entry=CMD_index[i])!=0) {
+      group = CMD_groups[(entry>>8)-1];
+      c = (uint8_t)entry;
+      if (McuUtility_strcmp(group->name, (char*)tokens[0])==0) {
+        if (c==CMD_ENTRY_GROUP) {
+          if (k==1) {
+            return CMD_ParseGroupCommand(group, cmd, tokens, nofTokens, handled, io);
+          }
+        } else if (k>1 && CMD_MatchWords(group->cmds[c].name, tokens+1, (uint8_t)(k-1))) {
+          *handled = TRUE;
+          return CMD_Call(&group->cmds[c], tokens+k, (uint8_t)(nofTokens-k), io);
+        }
+      }
+      i = (i+1)&(CMD_CONFIG_HASH_SIZE-1);
+    }
+  }
+  /* unknown group: the parser callbacks might know it */
+  return CMD_IterateGroups(cmd, handled, io, FALSE, FALSE);
+}
+
+uint8_t CMD_Init(const CMD_Group *const *groups) {
+  const CMD_Group *const *g;
+  uint8_t c, nofWords, res = ERR_OK;
+  uint32_t hash;
+  uint16_t group;
+
+  memset(CMD_index, 0, sizeof(CMD_index));
+  CMD_maxPathWords = 1;
+  for(g=groups, group=1; *g!=NULL && group<0xFF; g++, group++) {
+    hash = CMD_HashWord(CMD_FNV_OFFSET, (const unsigned char*)(*g)->name);
+    if (CMD_Insert(hash, (uint16_t)((group<<8)|CMD_ENTRY_GROUP))!=ERR_OK) {
+      res = ERR_OVERFLOW;
+    }
+    for(c=0; c<(*g)->nofCmds && c<CMD_ENTRY_GROUP; c++) {
+      if ((*g)->cmds[c].name[0]=='\0') {
+        continue; /* command with arguments only, handled with the group */
+      }
+      nofWords = 1; /* group name */
+      if (CMD_Insert(CMD_HashPath((hash^' ')*CMD_FNV_PRIME, (const unsigned char*)(*g)->cmds[c].name, &nofWords), (uint16_t)((group<<8)|c))!=ERR_OK) {
+        res = ERR_OVERFLOW;
+      }
+      if (nofWords>CMD_maxPathWords) {
+        CMD_maxPathWords = nofWords;
+      }
+    }
+  }
+  CMD_groups = groups;
+  return res;
+}
+
+#endif /* PL_CONFIG_HAS_SHELL */
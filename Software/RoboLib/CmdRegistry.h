@@ -0,0 +1,93 @@
+/**
+ * \file
+ * \brief Shell command registry
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Modules describe their shell commands in a constant table: the command path, the types of the
+ * arguments and the handler. At startup a hash index over all command paths is built, so a command
+ * is found with a few hash probes instead of calling each module parser with its string compares.
+ * The command line is split into tokens once, and the arguments are parsed before calling the handler.
+ * Modules with a McuShell parser callback are registered with their group name, and only get
+ * called for commands of their group, for 'help' and 'status', and for commands no group knows.
+ */
+
+#ifndef SRC_CMDREGISTRY_H_
+#define SRC_CMDREGISTRY_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_SHELL
+#include "McuShell.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef CMD_CONFIG_HASH_SIZE
+  #define CMD_CONFIG_HASH_SIZE   (128) /* entries of the hash index, power of two and about twice the number of groups and commands */
+#endif
+#ifndef CMD_CONFIG_MAX_TOKENS
+  #define CMD_CONFIG_MAX_TOKENS  (8) /* maximum number of words of a command line, including the arguments */
+#endif
+#ifndef CMD_CONFIG_MAX_ARGS
+  #define CMD_CONFIG_MAX_ARGS    (4) /* maximum number of arguments of a command */
+#endif
+
+/* argument types used in the signature string of a command */
+#define CMD_ARG_INT     'i' /* int32_t, decimal or hexadecimal with 0x, can be negative */
+#define CMD_ARG_UINT    'u' /* uint32_t, decimal */
+#define CMD_ARG_STRING  's' /* a word, zero terminated */
+
+typedef union {
+  int32_t i;                /* CMD_ARG_INT */
+  uint32_t u;               /* CMD_ARG_UINT */
+  const unsigned char *str; /* CMD_ARG_STRING, valid during the call of the handler */
+} CMD_Arg;
+
+/*!
+ * \brief Handler of a command.
+ * \param args Parsed arguments, in the order of the signature
+ * \param io I/O stream to be used for input/output
+ * \return Error code, ERR_OK if everything was fine
+ */
+typedef uint8_t (*CMD_Handler)(const CMD_Arg *args, const McuShell_StdIOType *io);
+
+typedef struct {
+  const char *name;    /* command after the group name, words separated by one space, e.g. "pos reset". "" for a command with arguments only, e.g. 'turn -90' */
+  const char *args;    /* signature: one CMD_ARG_xxx character per argument, e.g. "ii", or "" */
+  CMD_Handler handler;
+} CMD_Command;
+
+typedef struct {
+  const char *name;    /* first word of the commands, e.g. "turn" */
+  void (*help)(const McuShell_StdIOType *io);   /* prints the help lines of the group */
+  void (*status)(const McuShell_StdIOType *io); /* prints the status lines of the group, or NULL */
+  const CMD_Command *cmds;
+  uint8_t nofCmds;
+  McuShell_ParseCommandCallback parser; /* McuShell parser of the group if it has no command table, otherwise NULL */
+} CMD_Group;
+
+/*! \brief Initializer of a group with a command table */
+#define CMD_GROUP(name, help, status, cmds) \
+  { name, help, status, cmds, (uint8_t)(sizeof(cmds)/sizeof(cmds[0])), NULL }
+
+/*! \brief Initializer of a group which is parsed by a McuShell parser callback */
+#define CMD_PARSER_GROUP(name, parser) \
+  { name, NULL, NULL, NULL, 0, parser }
+
+/*!
+ * \brief Parser for the registered groups, to be used in the McuShell command table after McuShell_ParseCommand().
+ * \param cmd Command string to be parsed
+ * \param handled Sets this variable to TRUE if command was handled
+ * \param io I/O stream to be used for input/output
+ * \return Error code, ERR_OK if everything was fine
+ */
+uint8_t CMD_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+
+/*!
+ * \brief Registers the groups and builds the hash index. Has to be called before the first command gets parsed.
+ * \param groups Table of pointers to the groups, terminated by NULL. Help and status are printed in this order.
+ * \return ERR_OK, or ERR_OVERFLOW if the hash index is too small
+ */
+uint8_t CMD_Init(const CMD_Group *const *groups);
+
+#endif /* PL_CONFIG_HAS_SHELL */
+
+#endif /* SRC_CMDREGISTRY_H_ */
@@ -0,0 +1,171 @@
+/**
+ * \file
+ * \brief Tiered critical sections with BASEPRI
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The critical sections themselves are inline in the header. This module has the measurement of
+ * the quadrature interrupt entry latency: the timer interrupt passes the timer ticks since its
+ * update event, which is the time the interrupt was pending. The statistics are kept for each
+ * mode, so both schemes can be compared on the running robot with 'crit mode basepri|primask'.
+ * The edge decoder has no timestamp of the pin change: TIM1 then runs as a probe with the priority
+ * of the encoder pin interrupts, so it is masked and delayed by the same critical sections.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_CRITSEC
+#include "CritSec.h"
+#include "Quadrature.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+  #include "McuUtility.h"
+#endif
+
+#if CRIT_CONFIG_MEASURE_JITTER
+#define CRIT_TICKS_PER_US   (64) /* TIM1 runs with the CPU clock */
+
+typedef enum {
+  CRIT_MODE_BASEPRI,
+  CRIT_MODE_PRIMASK,
+  CRIT_NOF_MODES
+} CRIT_Mode;
+
+typedef struct {
+  uint32_t min, max;  /*!< entry latency in timer ticks */
+  uint32_t sum;       /*!< for the mean, wraps after about 10 minutes */
+  uint32_t count;     /*!< number of interrupts */
+} CRIT_Stats;
+
+volatile bool CRIT_usePrimask;
+static CRIT_Stats CRIT_stats[CRIT_NOF_MODES]; /*!< written by the interrupt */
+static volatile bool CRIT_resetRequest; /*!< the interrupt clears the statistics */
+
+void CRIT_OnQuadIsrEntry(uint32_t ticks) {
+  CRIT_Stats *stats;
+
+  if (CRIT_resetRequest) {
+    CRIT_resetRequest = FALSE;
+    stats = &CRIT_stats[CRIT_MODE_BASEPRI];
+    stats->min = UINT32_MAX; stats->max = stats->sum = stats->count = 0;
+    stats = &CRIT_stats[CRIT_MODE_PRIMASK];
+    stats->min = UINT32_MAX; stats->max = stats->sum = stats->count = 0;
+  }
+  stats = &CRIT_stats[CRIT_usePrimask ? CRIT_MODE_PRIMASK : CRIT_MODE_BASEPRI];
+  if (ticks<stats->min) {
+    stats->min = ticks;
+  }
+  if (ticks>stats->max) {
+    stats->max = ticks;
+  }
+  stats->sum += ticks;
+  stats->count++;
+}
+#endif /* CRIT_CONFIG_MEASURE_JITTER */
+
+#if PL_CONFIG_HAS_SHELL
+#if CRIT_CONFIG_MEASURE_JITTER
+static void CRIT_strcatTicks(uint8_t *buf, size_t bufSize, uint32_t ticks) {
+  McuUtility_strcatNum32u(buf, bufSize, ticks);
+  McuUtility_strcat(buf, bufSize, (unsigned char*)" (");
+  McuUtility_strcatNum32u(buf, bufSize, ticks/CRIT_TICKS_PER_US);
+  McuUtility_chcat(buf, bufSize, '.');
+  McuUtility_strcatNum32uFormatted(buf, bufSize, (ticks%CRIT_TICKS_PER_US)*100/CRIT_TICKS_PER_US, '0', 2);
+  McuUtility_strcat(buf, bufSize, (unsigned char*)" us)");
+}
+
+static void CRIT_PrintStats(const unsigned char *name, CRIT_Mode mode, const McuShell_StdIOType *io) {
+  uint8_t buf[64];
+  CRIT_Stats stats;
+  CRIT_CriticalVariable()
+
+  CRIT_EnterCritical(CRIT_LEVEL_QUAD); /* consistent copy */
+  stats = CRIT_stats[mode];
+  CRIT_ExitCritical();
+  if (stats.count==0) {
+    McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"-\r\n");
+  } else {
+    McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"max ");
+    CRIT_strcatTicks(buf, sizeof(buf), stats.max);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", min ");
+    McuUtility_strcatNum32u(buf, sizeof(buf), stats.min);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", mean ");
+    McuUtility_strcatNum32u(buf, sizeof(buf), stats.sum/stats.count);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+    McuUtility_strcatNum32u(buf, sizeof(buf), stats.count);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  }
+  McuShell_SendStatusStr(name, buf, io->stdOut);
+}
+#endif /* CRIT_CONFIG_MEASURE_JITTER */
+
+static void CRIT_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"crit", (unsigned char*)"Group of critical section commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows help or the quadrature interrupt entry latency\r\n", io->stdOut);
+#if CRIT_CONFIG_MEASURE_JITTER
+  McuShell_SendHelpStr((unsigned char*)"  mode basepri|primask", (unsigned char*)"Masks by level or all interrupts in critical sections\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Clears the latency statistics\r\n", io->stdOut);
+#endif
+}
+
+static void CRIT_PrintStatus(const McuShell_StdIOType *io) {
+  uint8_t buf[48];
+
+  McuShell_SendStatusStr((unsigned char*)"crit", (unsigned char*)"\r\n", io->stdOut);
+  McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"quad ");
+  McuUtility_strcatNum8u(buf, sizeof(buf), CRIT_IRQ_PRIO_QUAD);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", capture ");
+  McuUtility_strcatNum8u(buf, sizeof(buf), CRIT_IRQ_PRIO_CAPTURE);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", kernel ");
+  McuUtility_strcatNum8u(buf, sizeof(buf), configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  priorities", buf, io->stdOut);
+#if CRIT_CONFIG_MEASURE_JITTER
+  McuShell_SendStatusStr((unsigned char*)"  mode", CRIT_usePrimask ? (unsigned char*)"primask\r\n" : (unsigned char*)"basepri\r\n", io->stdOut);
+#if QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+  McuShell_SendStatusStr((unsigned char*)"  measured", (unsigned char*)"TIM1 probe at the encoder pin priority\r\n", io->stdOut);
+#else
+  McuShell_SendStatusStr((unsigned char*)"  measured", (unsigned char*)"TIM1 sampling interrupt\r\n", io->stdOut);
+#endif
+  McuShell_SendStatusStr((unsigned char*)"  latency", (unsigned char*)"timer ticks, count\r\n", io->stdOut);
+  CRIT_PrintStats((unsigned char*)"    basepri", CRIT_MODE_BASEPRI, io);
+  CRIT_PrintStats((unsigned char*)"    primask", CRIT_MODE_PRIMASK, io);
+#endif
+}
+
+#if CRIT_CONFIG_MEASURE_JITTER
+static uint8_t CRIT_CmdMode(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (McuUtility_strcmp((const char*)args[0].str, "basepri")==0) {
+    CRIT_usePrimask = FALSE;
+  } else if (McuUtility_strcmp((const char*)args[0].str, "primask")==0) {
+    CRIT_usePrimask = TRUE;
+  } else {
+    McuShell_SendStr((unsigned char*)"Unknown mode\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return ERR_OK;
+}
+
+static uint8_t CRIT_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  CRIT_resetRequest = TRUE;
+  return ERR_OK;
+}
+
+static const CMD_Command CRIT_Cmds[] = {
+  {"mode",  "s", CRIT_CmdMode},
+  {"reset", "",  CRIT_CmdReset},
+};
+
+const CMD_Group CRIT_CmdGroup = CMD_GROUP("crit", CRIT_PrintHelp, CRIT_PrintStatus, CRIT_Cmds);
+#else
+const CMD_Group CRIT_CmdGroup = {"crit", CRIT_PrintHelp, CRIT_PrintStatus, NULL, 0, NULL}; /* status only */
+#endif
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void CRIT_Init(void) {
+#if CRIT_CONFIG_MEASURE_JITTER
+  CRIT_usePrimask = FALSE;
+  CRIT_resetRequest = TRUE; /* before the timer interrupt is enabled */
+#endif
+}
+
+#endif /* PL_CONFIG_HAS_CRITSEC */
@@ -0,0 +1,116 @@
+/**
+ * \file
+ * \brief Tiered critical sections with BASEPRI
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * A critical section masks only the interrupts up to the level of the data it protects, with the
+ * BASEPRI register, instead of all interrupts with PRIMASK:
+ * - CRIT_LEVEL_KERNEL: data shared with the tick hook and the interrupts which use the RTOS API,
+ *   the same level as taskENTER_CRITICAL(). The quadrature interrupt keeps running.
+ * - CRIT_LEVEL_CAPTURE: data shared with the capture interrupts (reflectance edges).
+ * - CRIT_LEVEL_QUAD: data written by the quadrature interrupt, only for the few writers which
+ *   must not run at the same time as the decoder.
+ * The quadrature and capture interrupts are above configMAX_SYSCALL_INTERRUPT_PRIORITY: they
+ * must not use the RTOS API, and they share data with the tasks only with lock-free structures
+ * (sequence locks, atomics). Critical sections can be nested and used in interrupts, as BASEPRI
+ * is only raised. Without PL_CONFIG_HAS_CRITSEC the macros use McuCriticalSection.
+ */
+
+#ifndef SRC_CRITSEC_H_
+#define SRC_CRITSEC_H_
+
+#include "Platform.h"
+
+#if PL_CONFIG_HAS_CRITSEC
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32f3xx.h" /* CMSIS register access */
+#include "FreeRTOS.h"
+
+#ifndef CRIT_CONFIG_MEASURE_JITTER
+  #define CRIT_CONFIG_MEASURE_JITTER  (1) /* 1: statistics of the quadrature interrupt entry latency, and PRIMASK mode for comparison */
+#endif
+
+/* interrupt priorities (0 is the most urgent one). BASEPRI cannot mask priority 0, so it is not used. */
+#define CRIT_IRQ_PRIO_QUAD      (1) /* quadrature decoder: encoder pin interrupts, or TIM1 sampling at 10 kHz */
+#define CRIT_IRQ_PRIO_CAPTURE   (2) /* capture interrupts: reflectance edge pins */
+#if CRIT_IRQ_PRIO_CAPTURE>=configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+  #error "the capture interrupts have to be above the RTOS interrupts"
+#endif
+
+/* BASEPRI values: interrupts with this priority and less urgent ones are masked */
+#define CRIT_LEVEL_QUAD         (CRIT_IRQ_PRIO_QUAD<<(8-configPRIO_BITS))
+#define CRIT_LEVEL_CAPTURE      (CRIT_IRQ_PRIO_CAPTURE<<(8-configPRIO_BITS))
+#define CRIT_LEVEL_KERNEL       (configMAX_SYSCALL_INTERRUPT_PRIORITY)
+
+#define CRIT_PRIMASK_MODE       (0x100u) /* flag in the saved state: critical section with PRIMASK */
+
+#if CRIT_CONFIG_MEASURE_JITTER
+extern volatile bool CRIT_usePrimask; /* TRUE: all critical sections mask all interrupts, like before */
+#endif
+
+/*!
+ * \brief Raises the interrupt masking to a level, used by CRIT_EnterCritical().
+ * \param level BASEPRI value, CRIT_LEVEL_xxx
+ * \return Previous state for CRIT_Restore()
+ */
+static inline uint32_t CRIT_Raise(uint32_t level) {
+  uint32_t prev;
+
+#if CRIT_CONFIG_MEASURE_JITTER
+  if (CRIT_usePrimask) {
+    prev = __get_PRIMASK()|CRIT_PRIMASK_MODE;
+    __disable_irq();
+    return prev;
+  }
+#endif
+  prev = __get_BASEPRI();
+  __set_BASEPRI_MAX(level); /* does not lower it in a nested section */
+  __ISB();
+  return prev;
+}
+
+/*!
+ * \brief Restores the interrupt masking, used by CRIT_ExitCritical().
+ * \param prev State returned by CRIT_Raise()
+ */
+static inline void CRIT_Restore(uint32_t prev) {
+#if CRIT_CONFIG_MEASURE_JITTER
+  if (prev&CRIT_PRIMASK_MODE) {
+    __set_PRIMASK(prev&1);
+    return;
+  }
+#endif
+  __set_BASEPRI(prev);
+}
+
+#define CRIT_CriticalVariable()     uint32_t critState;
+#define CRIT_EnterCritical(level)   do { critState = CRIT_Raise(level); } while(0)
+#define CRIT_ExitCritical()         CRIT_Restore(critState)
+
+#if CRIT_CONFIG_MEASURE_JITTER
+/*!
+ * \brief Adds a measurement of the quadrature interrupt entry latency. Called first in the TIM1
+ * interrupt, which samples the encoders or, with the edge decoder, is a probe at the same priority.
+ * \param ticks Timer ticks (CPU cycles) since the update event of the timer
+ */
+void CRIT_OnQuadIsrEntry(uint32_t ticks);
+#endif
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the critical sections, registered in Shell.c */
+extern const CMD_Group CRIT_CmdGroup;
+#endif
+
+/*! \brief Module initialization */
+void CRIT_Init(void);
+
+#else /* all interrupts are masked */
+  #include "McuCriticalSection.h"
+  #define CRIT_CriticalVariable()     McuCriticalSection_CriticalVariable()
+  #define CRIT_EnterCritical(level)   McuCriticalSection_EnterCritical()
+  #define CRIT_ExitCritical()         McuCriticalSection_ExitCritical()
+#endif /* PL_CONFIG_HAS_CRITSEC */
+
+#endif /* SRC_CRITSEC_H_ */
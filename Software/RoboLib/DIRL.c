@@ -8,9 +8,12 @@
 #include "McuLib.h"
 #include "DIRL.h"
 #include "Pin.h"
-#include "stm32f3xx_hal.h"
 
 uint8_t DIRL_PutVal(bool val) {
-	HAL_GPIO_WritePin(PIN_DIRL_PORT, PIN_DIRL_PIN,  val?GPIO_PIN_SET:GPIO_PIN_RESET);
+	if (val) {
+		PIN_SetHigh(PIN_DIR_L);
+	} else {
+		PIN_SetLow(PIN_DIR_L);
+	}
 	return ERR_OK; /*! \todo */
 }
@@ -0,0 +1,317 @@
+/**
+ * \file
+ * \brief Deferred binary log
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The ring buffer has any number of writers (tasks and interrupts) and one reader (DLOG_Drain()).
+ * A writer reserves the words of its record by moving the head with an exclusive load/store
+ * (compare and swap), so no lock is needed. It writes the time stamp and the arguments, and the
+ * header last: a word with the header is the commit of the record. The reader copies committed
+ * records to RTT, clears their words and then moves the tail. If the ring buffer is full, the
+ * record is dropped and counted; the reader reports the count with a DLOG_ID_DROPPED record.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_DLOG
+#include "DLog.h"
+#include "McuArmTools.h"
+#include "SEGGER_RTT.h"
+#include "McuXFormat.h"
+#include <string.h>
+#if DLOG_CONFIG_USE_TASK
+  #include "FreeRTOS.h"
+  #include "task.h"
+#endif
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+  #include "McuUtility.h"
+#endif
+
+#if (DLOG_CONFIG_RING_WORDS&(DLOG_CONFIG_RING_WORDS-1))!=0
+  #error "DLOG_CONFIG_RING_WORDS has to be a power of two"
+#endif
+
+#define DLOG_RING_MASK          (DLOG_CONFIG_RING_WORDS-1)
+#define DLOG_NO_SPACE           (0xFFFFFFFFu)
+#define DLOG_COMMIT(i, header)  __atomic_store_n(&DLOG_ring[(i)&DLOG_RING_MASK], (header), __ATOMIC_RELEASE) /* record content before the header */
+
+static uint32_t DLOG_ring[DLOG_CONFIG_RING_WORDS]; /* 0 is a free or not yet committed word */
+static uint32_t DLOG_head; /* next word to reserve, free running */
+static uint32_t DLOG_tail; /* next word to read, free running, only changed by the reader */
+static uint32_t DLOG_nofDropped; /* records dropped because the ring buffer was full */
+static uint32_t DLOG_nofReported; /* dropped records reported to the host */
+static uint32_t DLOG_nofRecords; /* records copied to RTT */
+static uint8_t DLOG_rttBuffer[DLOG_CONFIG_RTT_BUFFER_SIZE];
+
+/*!
+ * \brief Reserves words in the ring buffer.
+ * \param nofWords Number of words of the record
+ * \return Index of the first word (free running), or DLOG_NO_SPACE
+ */
+static uint32_t DLOG_Reserve(uint32_t nofWords) {
+  uint32_t head;
+
+  head = __atomic_load_n(&DLOG_head, __ATOMIC_RELAXED);
+  do {
+    if (head+nofWords-__atomic_load_n(&DLOG_tail, __ATOMIC_ACQUIRE)>DLOG_CONFIG_RING_WORDS) {
+      __atomic_fetch_add(&DLOG_nofDropped, 1, __ATOMIC_RELAXED);
+      return DLOG_NO_SPACE;
+    }
+  } while(!__atomic_compare_exchange_n(&DLOG_head, &head, head+nofWords, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  return head;
+}
+
+void DLOG_Write0(uint32_t id) {
+  uint32_t i;
+
+  i = DLOG_Reserve(2);
+  if (i!=DLOG_NO_SPACE) {
+    DLOG_ring[(i+1)&DLOG_RING_MASK] = McuArmTools_GetCycleCounter();
+    DLOG_COMMIT(i, DLOG_HEADER(id, 0));
+  }
+}
+
+void DLOG_Write1(uint32_t id, uint32_t a0) {
+  uint32_t i;
+
+  i = DLOG_Reserve(3);
+  if (i!=DLOG_NO_SPACE) {
+    DLOG_ring[(i+1)&DLOG_RING_MASK] = McuArmTools_GetCycleCounter();
+    DLOG_ring[(i+2)&DLOG_RING_MASK] = a0;
+    DLOG_COMMIT(i, DLOG_HEADER(id, 1));
+  }
+}
+
+void DLOG_Write2(uint32_t id, uint32_t a0, uint32_t a1) {
+  uint32_t i;
+
+  i = DLOG_Reserve(4);
+  if (i!=DLOG_NO_SPACE) {
+    DLOG_ring[(i+1)&DLOG_RING_MASK] = McuArmTools_GetCycleCounter();
+    DLOG_ring[(i+2)&DLOG_RING_MASK] = a0;
+    DLOG_ring[(i+3)&DLOG_RING_MASK] = a1;
+    DLOG_COMMIT(i, DLOG_HEADER(id, 2));
+  }
+}
+
+void DLOG_Write3(uint32_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+  uint32_t i;
+
+  i = DLOG_Reserve(5);
+  if (i!=DLOG_NO_SPACE) {
+    DLOG_ring[(i+1)&DLOG_RING_MASK] = McuArmTools_GetCycleCounter();
+    DLOG_ring[(i+2)&DLOG_RING_MASK] = a0;
+    DLOG_ring[(i+3)&DLOG_RING_MASK] = a1;
+    DLOG_ring[(i+4)&DLOG_RING_MASK] = a2;
+    DLOG_COMMIT(i, DLOG_HEADER(id, 3));
+  }
+}
+
+void DLOG_Write4(uint32_t id, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+  uint32_t i;
+
+  i = DLOG_Reserve(6);
+  if (i!=DLOG_NO_SPACE) {
+    DLOG_ring[(i+1)&DLOG_RING_MASK] = McuArmTools_GetCycleCounter();
+    DLOG_ring[(i+2)&DLOG_RING_MASK] = a0;
+    DLOG_ring[(i+3)&DLOG_RING_MASK] = a1;
+    DLOG_ring[(i+4)&DLOG_RING_MASK] = a2;
+    DLOG_ring[(i+5)&DLOG_RING_MASK] = a3;
+    DLOG_COMMIT(i, DLOG_HEADER(id, 4));
+  }
+}
+
+unsigned DLOG_Drain(void) {
+  uint32_t record[2+DLOG_CONFIG_MAX_ARGS];
+  uint32_t tail, header, dropped, i, n;
+  unsigned nofRecords = 0;
+
+  dropped = __atomic_load_n(&DLOG_nofDropped, __ATOMIC_RELAXED);
+  if (dropped!=DLOG_nofReported) {
+    record[0] = DLOG_HEADER(DLOG_ID_DROPPED, 1);
+    record[1] = McuArmTools_GetCycleCounter();
+    record[2] = dropped-DLOG_nofReported;
+    if (SEGGER_RTT_WriteSkipNoLock(DLOG_CONFIG_RTT_CHANNEL, record, 3*sizeof(uint32_t))==0) {
+      return 0; /* host is not reading */
+    }
+    DLOG_nofReported = dropped;
+  }
+  tail = DLOG_tail;
+  for(;;) {
+    header = __atomic_load_n(&DLOG_ring[tail&DLOG_RING_MASK], __ATOMIC_ACQUIRE);
+    if (header==0) {
+      break; /* empty, or the next record is not committed yet */
+    }
+    n = 2+(header&0xF);
+    if ((header&DLOG_HEADER_MAGIC_MASK)!=DLOG_HEADER_MAGIC || n>sizeof(record)/sizeof(record[0])) {
+      n = 1; /* cannot happen: skip the word */
+    }
+    for(i=0; i<n; i++) {
+      record[i] = DLOG_ring[(tail+i)&DLOG_RING_MASK];
+    }
+    if (n>1 && SEGGER_RTT_WriteSkipNoLock(DLOG_CONFIG_RTT_CHANNEL, record, n*sizeof(uint32_t))==0) {
+      break; /* RTT buffer full, keep the record */
+    }
+    for(i=0; i<n; i++) {
+      DLOG_ring[(tail+i)&DLOG_RING_MASK] = 0;
+    }
+    tail += n;
+    __atomic_store_n(&DLOG_tail, tail, __ATOMIC_RELEASE); /* writers can use the words again */
+    nofRecords++;
+  }
+  DLOG_nofRecords += nofRecords;
+  return nofRecords;
+}
+
+#define DLOG_BENCH_NOF_CALLS  (4) /* per kind, the records have to fit into the ring buffer */
+
+static void DLOG_BenchSprintf(char *buf, size_t bufSize, int32_t a, int32_t b) {
+  (void)McuXFormat_xsnprintf(buf, bufSize, "bench %d %d", a, b);
+}
+
+void DLOG_Bench(DLOG_BenchResult *result) {
+  uint32_t cycles, sum[4], dropped;
+  char buf[24];
+  int i;
+
+  memset(sum, 0, sizeof(sum));
+  dropped = __atomic_load_n(&DLOG_nofDropped, __ATOMIC_RELAXED);
+  for(i=0; i<DLOG_BENCH_NOF_CALLS; i++) {
+    cycles = McuArmTools_GetCycleCounter();
+    DLOG("bench");
+    sum[0] += McuArmTools_GetCycleCounter()-cycles;
+    cycles = McuArmTools_GetCycleCounter();
+    DLOG("bench %d %d", i, -i);
+    sum[1] += McuArmTools_GetCycleCounter()-cycles;
+    cycles = McuArmTools_GetCycleCounter();
+    DLOG("bench %d %d %d %d", i, -i, 2*i, -2*i);
+    sum[2] += McuArmTools_GetCycleCounter()-cycles;
+    cycles = McuArmTools_GetCycleCounter();
+    DLOG_BenchSprintf(buf, sizeof(buf), i, -i);
+    sum[3] += McuArmTools_GetCycleCounter()-cycles;
+  }
+  result->args0 = sum[0]/DLOG_BENCH_NOF_CALLS;
+  result->args2 = sum[1]/DLOG_BENCH_NOF_CALLS;
+  result->args4 = sum[2]/DLOG_BENCH_NOF_CALLS;
+  result->xsnprintf = sum[3]/DLOG_BENCH_NOF_CALLS;
+  result->dropped = __atomic_load_n(&DLOG_nofDropped, __ATOMIC_RELAXED)!=dropped;
+}
+
+void DLOG_LogBench(void) {
+  DLOG_BenchResult bench;
+
+  DLOG_Bench(&bench);
+  (void)DLOG_Drain(); /* records of the measurement, to have space for the result */
+  DLOG("log bench cycles/call: 0 args %u, 2 args %u, 4 args %u, xsnprintf %u", bench.args0, bench.args2, bench.args4, bench.xsnprintf);
+  if (bench.dropped) {
+    DLOG("log bench: some records were dropped, the ring buffer was not empty");
+  }
+}
+
+#if DLOG_CONFIG_USE_TASK
+static void DLogTask(void *pvParameters) {
+  (void)pvParameters; /* not used */
+#if DLOG_CONFIG_BENCH_AT_STARTUP
+  (void)DLOG_Drain(); /* records of the initialization */
+  DLOG_LogBench();
+#endif
+  for(;;) {
+    (void)DLOG_Drain();
+    vTaskDelay(pdMS_TO_TICKS(DLOG_CONFIG_DRAIN_PERIOD_MS));
+  }
+}
+#endif
+
+#if PL_CONFIG_HAS_SHELL
+static uint8_t DLOG_CmdBench(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  DLOG_BenchResult bench;
+
+  (void)args;
+  DLOG_Bench(&bench);
+  McuShell_SendStatusStr((unsigned char*)"log bench", (unsigned char*)"cycles/call\r\n", io->stdOut);
+  McuShell_SendStatusStr((unsigned char*)"  0 args", (unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(bench.args0, io->stdOut);
+  McuShell_SendStr((unsigned char*)"\r\n", io->stdOut);
+  McuShell_SendStatusStr((unsigned char*)"  2 args", (unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(bench.args2, io->stdOut);
+  McuShell_SendStr((unsigned char*)"\r\n", io->stdOut);
+  McuShell_SendStatusStr((unsigned char*)"  4 args", (unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(bench.args4, io->stdOut);
+  McuShell_SendStr((unsigned char*)"\r\n", io->stdOut);
+  McuShell_SendStatusStr((unsigned char*)"  xsnprintf", (unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(bench.xsnprintf, io->stdOut);
+  McuShell_SendStr((unsigned char*)" (2 args, formatting only)\r\n", io->stdOut);
+  if (bench.dropped) {
+    McuShell_SendStr((unsigned char*)"  some records were dropped, the ring buffer was not empty\r\n", io->stdOut);
+  }
+  return ERR_OK;
+}
+
+static uint8_t DLOG_CmdTest(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)io;
+  DLOG("log test %d 0x%x", args[0].i, args[0].i);
+  return ERR_OK;
+}
+
+static uint8_t DLOG_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  DLOG_nofRecords = 0;
+  return ERR_OK;
+}
+
+static void DLOG_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"log", (unsigned char*)"Group of deferred log commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Print help or status information\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  test <value>", (unsigned char*)"Logs a test message with the value\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  bench", (unsigned char*)"Measures the cycles of a log call\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Resets the record counter\r\n", io->stdOut);
+}
+
+static void DLOG_PrintStatus(const McuShell_StdIOType *io) {
+  unsigned char buf[32];
+  uint32_t used;
+
+  McuShell_SendStatusStr((unsigned char*)"log", (unsigned char*)"\r\n", io->stdOut);
+  McuUtility_Num32uToStr(buf, sizeof(buf), DLOG_CONFIG_RTT_CHANNEL);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), DLOG_CONFIG_RTT_BUFFER_SIZE);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" bytes\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  channel", buf, io->stdOut);
+
+  used = __atomic_load_n(&DLOG_head, __ATOMIC_RELAXED)-__atomic_load_n(&DLOG_tail, __ATOMIC_RELAXED);
+  McuUtility_Num32uToStr(buf, sizeof(buf), used);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" of ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), DLOG_CONFIG_RING_WORDS);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" words\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  ring", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), DLOG_nofRecords);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" sent, ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), DLOG_nofDropped);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" dropped\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  records", buf, io->stdOut);
+}
+
+static const CMD_Command DLOG_Cmds[] = {
+  {"test",  "i", DLOG_CmdTest},
+  {"bench", "",  DLOG_CmdBench},
+  {"reset", "",  DLOG_CmdReset},
+};
+
+const CMD_Group DLOG_CmdGroup = CMD_GROUP("log", DLOG_PrintHelp, DLOG_PrintStatus, DLOG_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void DLOG_Init(void) {
+  memset(DLOG_ring, 0, sizeof(DLOG_ring));
+  DLOG_head = DLOG_tail = 0;
+  DLOG_nofDropped = DLOG_nofReported = DLOG_nofRecords = 0;
+  if (SEGGER_RTT_ConfigUpBuffer(DLOG_CONFIG_RTT_CHANNEL, "Log", DLOG_rttBuffer, sizeof(DLOG_rttBuffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP)<0) {
+    for(;;){} /* channel not available, check SEGGER_RTT_MAX_NUM_UP_BUFFERS */
+  }
+#if DLOG_CONFIG_USE_TASK
+  if (xTaskCreate(DLogTask, "DLog", 300/sizeof(StackType_t), NULL, tskIDLE_PRIORITY, NULL) != pdPASS) {
+    for(;;){} /* error */
+  }
+#endif
+}
+#endif /* PL_CONFIG_HAS_DLOG */
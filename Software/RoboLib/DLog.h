@@ -0,0 +1,132 @@
+/**
+ * \file
+ * \brief Deferred binary log
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * DLOG("fmt", args) does not format anything on the target: it stores the ID of the format
+ * string, a cycle counter time stamp and up to DLOG_CONFIG_MAX_ARGS 32bit arguments into a ring
+ * buffer. A low priority task copies the records to the RTT up-buffer DLOG_CONFIG_RTT_CHANNEL.
+ * The format strings are placed into the section DLOG_CONFIG_FMT_SECTION, which is part of the
+ * ELF file but not of the flash image, and the ID is the offset of the string in this section.
+ * Tools/DLogDecoder reads the strings from the ELF file and prints the captured records.
+ * With DLOG_CONFIG_BENCH_AT_STARTUP the task logs the cycles of a log call once at startup,
+ * so the benchmark does not need the shell.
+ * Only integer conversions (%d, %u, %x, %c and the like) are supported, no strings.
+ */
+
+#ifndef SRC_DLOG_H_
+#define SRC_DLOG_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_DLOG
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef DLOG_CONFIG_RING_WORDS
+  #define DLOG_CONFIG_RING_WORDS       (64)  /* size of the ring buffer in 32bit words, power of two */
+#endif
+#ifndef DLOG_CONFIG_MAX_ARGS
+  #define DLOG_CONFIG_MAX_ARGS         (4)   /* maximum number of arguments of a log call */
+#endif
+#ifndef DLOG_CONFIG_RTT_CHANNEL
+  #define DLOG_CONFIG_RTT_CHANNEL      (3)   /* RTT up-buffer, 2 is the telemetry */
+#endif
+#ifndef DLOG_CONFIG_RTT_BUFFER_SIZE
+  #define DLOG_CONFIG_RTT_BUFFER_SIZE  (256) /* bytes of the RTT up-buffer */
+#endif
+#ifndef DLOG_CONFIG_DRAIN_PERIOD_MS
+  #define DLOG_CONFIG_DRAIN_PERIOD_MS  (10)  /* the task copies the records to RTT with this period */
+#endif
+#ifndef DLOG_CONFIG_USE_TASK
+  #define DLOG_CONFIG_USE_TASK         (PL_CONFIG_USE_FREERTOS) /* otherwise DLOG_Drain() has to be called by the application */
+#endif
+#ifndef DLOG_CONFIG_BENCH_AT_STARTUP
+  #define DLOG_CONFIG_BENCH_AT_STARTUP (1 && DLOG_CONFIG_USE_TASK) /* the task runs DLOG_Bench() once and logs the result */
+#endif
+#ifndef DLOG_CONFIG_FMT_SECTION
+  #define DLOG_CONFIG_FMT_SECTION      ".dlog_fmt" /* see the linker file: (INFO) section at address 0 */
+#endif
+#ifndef DLOG_CONFIG_FMT_BASE
+  #define DLOG_CONFIG_FMT_BASE         (0)   /* address of the format section */
+#endif
+
+/* record in the ring buffer and in the RTT stream, 32bit little endian words:
+ * header: format ID (bits 31..16), DLOG_HEADER_MAGIC (bits 15..4), number of arguments (bits 3..0)
+ * cycle counter
+ * arguments */
+#define DLOG_HEADER_MAGIC         (0xD10u<<4)
+#define DLOG_HEADER_MAGIC_MASK    (0xFFF0u)
+#define DLOG_HEADER(id, nofArgs)  (((uint32_t)(id)<<16)|DLOG_HEADER_MAGIC|(nofArgs))
+#define DLOG_ID_DROPPED           (0xFFFFu) /* record with the number of records dropped before */
+
+/*! \brief ID of a format string: offset in the format section */
+#define DLOG_ID(fmt)              ((uint32_t)((uintptr_t)(fmt)-(uintptr_t)(DLOG_CONFIG_FMT_BASE)))
+
+/* number of arguments, 0 to 4 */
+#define DLOG_NOF_ARGS(...)        DLOG_NOF_ARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define DLOG_NOF_ARGS_(_0, _1, _2, _3, _4, n, ...)  n
+#define DLOG_CAT(a, b)            DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b)           a##b
+
+/*!
+ * \brief Logs a message, e.g. DLOG("speed %d %d", left, right). The arguments are converted to uint32_t.
+ * \param fmt Format string literal
+ */
+#define DLOG(fmt, ...) \
+  do { \
+    static const char DLOG_fmt[] __attribute__((section(DLOG_CONFIG_FMT_SECTION), used)) = fmt; \
+    DLOG_CAT(DLOG_Write, DLOG_NOF_ARGS(__VA_ARGS__))(DLOG_ID(DLOG_fmt), ##__VA_ARGS__); \
+  } while(0)
+
+/* used by DLOG(), do not call directly */
+void DLOG_Write0(uint32_t id);
+void DLOG_Write1(uint32_t id, uint32_t a0);
+void DLOG_Write2(uint32_t id, uint32_t a0, uint32_t a1);
+void DLOG_Write3(uint32_t id, uint32_t a0, uint32_t a1, uint32_t a2);
+void DLOG_Write4(uint32_t id, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/*!
+ * \brief Copies the records from the ring buffer to RTT, as long as there is space. Called by the task,
+ * or by the application without the task. Only one caller at a time.
+ * \return Number of records copied
+ */
+unsigned DLOG_Drain(void);
+
+/*! \brief Result of DLOG_Bench(), in cycles per call */
+typedef struct {
+  uint32_t args0;     /*!< DLOG() without arguments */
+  uint32_t args2;     /*!< DLOG() with 2 arguments */
+  uint32_t args4;     /*!< DLOG() with 4 arguments */
+  uint32_t xsnprintf; /*!< McuXFormat_xsnprintf() with 2 arguments, formatting only */
+  bool dropped;       /*!< some records were dropped, the ring buffer was not empty */
+} DLOG_BenchResult;
+
+/*!
+ * \brief Measures the cycles of log calls against formatting with McuXFormat_xsnprintf(). The
+ * records of the measurement go into the log as well, so the ring buffer should be empty.
+ * \param[out] result Cycles per call
+ */
+void DLOG_Bench(DLOG_BenchResult *result);
+
+/*!
+ * \brief Runs DLOG_Bench() and logs the result, for a target without the shell. Called by the task at
+ * startup with DLOG_CONFIG_BENCH_AT_STARTUP. Drains the ring buffer, so only call it from the reader.
+ */
+void DLOG_LogBench(void);
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the deferred log, registered in Shell.c */
+extern const CMD_Group DLOG_CmdGroup;
+#endif
+
+/*!
+ * \brief Module initialization, call after the RTT initialization and before the modules which log.
+ */
+void DLOG_Init(void);
+
+#else
+  #define DLOG(fmt, ...)  do {} while(0)
+#endif /* PL_CONFIG_HAS_DLOG */
+
+#endif /* SRC_DLOG_H_ */
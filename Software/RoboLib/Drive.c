@@ -8,6 +8,7 @@
 #include "Platform.h"
 #if PL_CONFIG_HAS_DRIVE
 #include "Drive.h"
+#include <string.h>
 #include "FreeRTOS.h"
 #include "McuUtility.h"
 #if PL_CONFIG_HAS_MOTOR_TACHO
@@ -24,10 +25,26 @@
 #if PL_CONFIG_HAS_QUADRATURE
   #include "Quadrature.h"
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#if PL_CONFIG_HAS_TELEMETRY
+  #include "Telemetry.h"
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
+#if PL_CONFIG_HAS_EXEC
+  #include "Exec.h"
+#endif
+#include "Span.h"
+#include "DLog.h"
 #include "Shell.h"
 #include "McuWait.h"
+#include "McuArmTools.h"
+#include "CritSec.h"
 
-#define PRINT_DRIVE_INFO  0 /* if we print debug info */
+#define PRINT_DRIVE_INFO  (0 && PL_CONFIG_HAS_DLOG) /* deferred log of the drive commands, see DLog.h */
 
 struct {
   DRV_Mode mode;
@@ -41,11 +58,70 @@ struct {
 #endif
 } DRV_Status;
 
+#if PL_CONFIG_HAS_POS_PID
+/* Moves with a trapezoidal speed profile: the position setpoints are advanced in each DriveTask cycle
+   instead of jumping to the target and letting the position PID saturate. The profile is planned for
+   the wheel with the longer way, the other wheel is scaled so both wheels arrive at the same time. */
+#if PL_CONFIG_HIGH_RES_ENCODER
+  #define DRV_MOVE_SPEED_MAX    2000 /* default maximum speed, steps/sec */
+  #define DRV_MOVE_ACC          25000 /* default acceleration and deceleration, steps/sec^2 */
+  /* The duty limit of the position PID caps a setpoint jump at ~1600 steps/sec. A profile limits the
+     speed itself, so during a move the PID may use the full duty, with a D part to damp the higher gain. */
+  #define DRV_MOVE_PID_TUNED          1
+  #define DRV_MOVE_MAX_SPEED_PERCENT  100 /* position PID duty limit during a move */
+  #define DRV_MOVE_D_FACTOR100        300 /* position PID D part during a move */
+#else
+  #define DRV_MOVE_SPEED_MAX    100
+  #define DRV_MOVE_ACC          400
+  #define DRV_MOVE_PID_TUNED    0 /* keep the position PID configuration for moves */
+#endif
+#define DRV_MOVE_SETTLE_MS      200 /* time after the end of the profile to get into position */
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  /* A wheel still turning against a new move (e.g. stepping back at the border) is braked with the
+     reverse PWM first: the position PID would only reverse it once the error has left its dead band. */
+  #define DRV_MOVE_BRAKE_SPEED   200 /* steps/sec against the move to brake */
+  #define DRV_MOVE_BRAKE_PERCENT 100 /* reverse PWM duty */
+  #define DRV_MOVE_BRAKE_MS      100 /* maximum brake time, then the profile starts anyway */
+#endif
+
+static int32_t DRV_MoveSpeedMax = DRV_MOVE_SPEED_MAX;
+static int32_t DRV_MoveAcc = DRV_MOVE_ACC;
+
+static struct {
+  bool active;              /* profile running or settling */
+  bool braking;             /* wheels are braked before the profile starts */
+  int32_t startL, startR;   /* wheel positions at the start of the move */
+  int32_t stepsL, stepsR;   /* steps to move for each wheel */
+  int32_t dist;             /* steps of the wheel with the longer way, the profile is planned for it */
+  int32_t speed;            /* peak speed, steps/sec */
+  int32_t accMs;            /* time to accelerate to the peak speed, same as to decelerate */
+  int32_t accSteps;         /* steps during acceleration */
+  int32_t cruiseMs;         /* time at peak speed */
+  TickType_t startTicks;    /* tick count at the start of the move */
+  int32_t overshoot;        /* maximum steps past the target */
+  DRV_MoveDoneFct done;     /* completion callback, or NULL */
+#if DRV_MOVE_PID_TUNED
+  bool pidTuned;            /* the position PIDs run with the move settings */
+  int32_t pidDFactor100[2]; /* configured D part of the left and right position PID */
+  uint8_t pidMaxSpeedPercent[2]; /* configured duty limit of the left and right position PID */
+#endif
+} DRV_Profile;
+
+static struct { /* statistics of the last move, to tune speed and acceleration */
+  DRV_MoveResult result;
+  int32_t timeMs;       /* time from start to completion */
+  int32_t overshoot;    /* maximum steps past the target */
+  int32_t error;        /* position error at completion */
+} DRV_LastMove;
+#endif /* PL_CONFIG_HAS_POS_PID */
+
 typedef enum {
   DRV_SET_MODE,
   DRV_SET_SPEED,
 #if PL_CONFIG_HAS_POS_PID
   DRV_SET_POS,
+  DRV_START_MOVE,
+  DRV_CANCEL_MOVE,
 #endif
 } DRV_Commands;
 
@@ -60,13 +136,56 @@ typedef struct {
    struct {
       int32_t left, right;
     } pos; /* DRV_SET_POS */
+    struct {
+      int32_t left, right;
+      DRV_MoveDoneFct done;
+    } move; /* DRV_START_MOVE */
 #endif
   } u;
 } DRV_Command;
 
-#define QUEUE_LENGTH      4 /* number of items in queue, that's my buffer size */
-#define QUEUE_ITEM_SIZE   sizeof(DRV_Command) /* each item is a single drive command */
-static xQueueHandle DRV_Queue;
+/* Setpoint mailbox: the latest command of each kind wins. A command which is replaced before the
+   drive task has taken it is never applied, so the drive task does not work through stale commands.
+   The sequence numbers keep the order between the kinds, e.g. a position after a move cancels it. */
+typedef enum {
+  DRV_SLOT_MOTION, /* DRV_SET_MODE, DRV_START_MOVE and DRV_CANCEL_MOVE */
+  DRV_SLOT_SPEED,  /* DRV_SET_SPEED */
+#if PL_CONFIG_HAS_POS_PID
+  DRV_SLOT_POS,    /* DRV_SET_POS */
+#endif
+  DRV_NOF_SLOTS
+} DRV_Slot;
+
+static struct {
+  uint32_t seq;             /* incremented by each command */
+  uint32_t changed;         /* bit set of the slots written since the drive task has taken them */
+  uint32_t cycles;          /* cycle counter at the newest command */
+  struct {
+    uint32_t seq;           /* sequence number of the command in the slot */
+    DRV_Command cmd;
+  } slots[DRV_NOF_SLOTS];
+} DRV_Mailbox; /* written by any task, taken by the drive task, in a critical section */
+
+static struct {
+  uint32_t seq;             /* sequence number of the newest command taken */
+  uint32_t nofTaken;        /* commands applied */
+  uint32_t nofReplaced;     /* commands replaced by a newer one before they were taken */
+  bool pending;             /* setpoints taken, waiting for the PWM */
+  uint32_t cycles;          /* cycle counter of the newest command taken */
+  uint32_t lastUs, maxUs;   /* time from the newest command to the PWM */
+  uint32_t sumUs, nofLatencies;
+} DRV_CmdStats;
+
+#if !PL_CONFIG_HAS_EXEC
+static TaskHandle_t DRV_taskHndl;
+#endif
+
+#define DRV_PERIOD_MS       (5) /* control period of the drive task */
+#define DRV_CYCLES_PER_US   (configCPU_CLOCK_HZ/1000000)
+
+static bool DRV_HasPendingCmd(void) {
+  return DRV_Mailbox.changed!=0;
+}
 
 bool DRV_IsStopped(void) {
 #if PL_CONFIG_HAS_MOTOR_TACHO
@@ -74,8 +193,8 @@ bool DRV_IsStopped(void) {
   QUAD_QuadCntrType rightPos;
 #endif
 
-  if (uxQueueMessagesWaiting(DRV_Queue)>0) {
-    return FALSE; /* still messages in command queue, so there is something pending */
+  if (DRV_HasPendingCmd()) {
+    return FALSE; /* a command has not been taken yet, so there is something pending */
   }
 #if PL_CONFIG_HAS_MOTOR_TACHO
   /* do *not* use/calculate speed: too slow! Use position encoder instead */
@@ -145,37 +264,44 @@ static bool match(int16_t pos, int16_t target) {
 }
 #endif 
 
-bool DRV_HasTurned(void) {
 #if PL_CONFIG_HAS_POS_PID
+static bool DRV_IsInPosition(void) {
   int16_t pos;
-
-  if (uxQueueMessagesWaiting(DRV_Queue)>0) {
-    return FALSE; /* still messages in command queue, so there is something pending */
-  }
-  if (DRV_Status.mode==DRV_MODE_POS) {
 #if PL_CONFIG_HAS_MOTOR_TACHO
 #if PL_CONFIG_HIGH_RES_ENCODER
   #define DRV_TURN_SPEED_LOW 100
 #else
   #define DRV_TURN_SPEED_LOW 5
 #endif
-    int32_t speedL, speedR;
+  int32_t speedL, speedR;
 
-    speedL = TACHO_GetSpeed(TRUE);
-    speedR = TACHO_GetSpeed(FALSE);
-    if (speedL>-DRV_TURN_SPEED_LOW && speedL<DRV_TURN_SPEED_LOW && speedR>-DRV_TURN_SPEED_LOW && speedR<DRV_TURN_SPEED_LOW) { /* speed close to zero */
+  speedL = TACHO_GetSpeed(TRUE);
+  speedR = TACHO_GetSpeed(FALSE);
+  if (!(speedL>-DRV_TURN_SPEED_LOW && speedL<DRV_TURN_SPEED_LOW && speedR>-DRV_TURN_SPEED_LOW && speedR<DRV_TURN_SPEED_LOW)) {
+    return FALSE; /* still moving */
+  }
 #endif
-      pos = QUAD_GetLeftPos();
-      if (match(pos, DRV_Status.pos.left)) {
-        pos = QUAD_GetRightPos();
-        if (match(pos, DRV_Status.pos.right)) {
-          return TRUE;
-        }
-      }
-#if PL_CONFIG_HAS_MOTOR_TACHO
+  pos = QUAD_GetLeftPos();
+  if (match(pos, DRV_Status.pos.left)) {
+    pos = QUAD_GetRightPos();
+    if (match(pos, DRV_Status.pos.right)) {
+      return TRUE;
     }
+  }
+  return FALSE;
+}
 #endif
-    return FALSE;
+
+bool DRV_HasTurned(void) {
+#if PL_CONFIG_HAS_POS_PID
+  if (DRV_HasPendingCmd()) {
+    return FALSE; /* a command has not been taken yet, so there is something pending */
+  }
+  if (DRV_Status.mode==DRV_MODE_POS) {
+    if (DRV_Profile.active) {
+      return FALSE; /* move still running */
+    }
+    return DRV_IsInPosition();
   } /* if */
   return TRUE;
 #else
@@ -187,6 +313,66 @@ DRV_Mode DRV_GetMode(void) {
   return DRV_Status.mode;
 }
 
+void DRV_GetSetValues(int32_t *left, int32_t *right) {
+#if PL_CONFIG_HAS_QUADRATURE
+  if (DRV_Status.mode==DRV_MODE_POS) {
+    *left = DRV_Status.pos.left;
+    *right = DRV_Status.pos.right;
+    return;
+  }
+#endif
+  if (DRV_Status.mode==DRV_MODE_SPEED) {
+    *left = DRV_Status.speed.left;
+    *right = DRV_Status.speed.right;
+  } else {
+    *left = *right = 0;
+  }
+}
+
+static DRV_Slot DRV_GetSlot(DRV_Commands cmd) {
+  switch(cmd) {
+    case DRV_SET_SPEED: return DRV_SLOT_SPEED;
+#if PL_CONFIG_HAS_POS_PID
+    case DRV_SET_POS:   return DRV_SLOT_POS;
+#endif
+    default:            return DRV_SLOT_MOTION;
+  }
+}
+
+static uint8_t DRV_SendCmd(const DRV_Command *cmd) {
+  DRV_Slot slot = DRV_GetSlot(cmd->cmd);
+#if PL_CONFIG_HAS_POS_PID
+  DRV_MoveDoneFct replacedDone = NULL;
+#endif
+  CRIT_CriticalVariable()
+
+  CRIT_EnterCritical(CRIT_LEVEL_KERNEL);
+#if PL_CONFIG_HAS_POS_PID
+  if ((DRV_Mailbox.changed&(1u<<slot)) && DRV_Mailbox.slots[slot].cmd.cmd==DRV_START_MOVE) {
+    replacedDone = DRV_Mailbox.slots[slot].cmd.u.move.done; /* move replaced before it has been started */
+  }
+#endif
+  DRV_Mailbox.seq++;
+  DRV_Mailbox.slots[slot].seq = DRV_Mailbox.seq;
+  DRV_Mailbox.slots[slot].cmd = *cmd;
+  DRV_Mailbox.changed |= 1u<<slot;
+  DRV_Mailbox.cycles = McuArmTools_GetCycleCounter();
+  CRIT_ExitCritical();
+#if PL_CONFIG_HAS_POS_PID
+  if (replacedDone!=NULL) {
+    replacedDone(DRV_MOVE_CANCELLED); /* the drive task will never run it */
+  }
+#endif
+#if PL_CONFIG_HAS_EXEC
+  EXEC_RequestStage(EXEC_STAGE_CONTROL); /* in the same cycle if sent by the strategy */
+#else
+  if (DRV_taskHndl!=NULL) {
+    (void)xTaskNotifyGive(DRV_taskHndl); /* applies it now instead of at its next period */
+  }
+#endif
+  return ERR_OK;
+}
+
 uint8_t DRV_SetMode(DRV_Mode mode) {
   DRV_Command cmd;
 
@@ -199,11 +385,7 @@ uint8_t DRV_SetMode(DRV_Mode mode) {
 #endif
   cmd.cmd = DRV_SET_MODE;
   cmd.u.mode = mode;
-  if (xQueueSendToBack(DRV_Queue, &cmd, portMAX_DELAY)!=pdPASS) {
-    return ERR_FAILED;
-  }
-  taskYIELD(); /* yield so drive task has a chance to read message */
-  return ERR_OK;
+  return DRV_SendCmd(&cmd);
 }
 
 uint8_t DRV_SetSpeed(int32_t left, int32_t right) {
@@ -212,11 +394,7 @@ uint8_t DRV_SetSpeed(int32_t left, int32_t right) {
   cmd.cmd = DRV_SET_SPEED;
   cmd.u.speed.left = left;
   cmd.u.speed.right = right;
-  if (xQueueSendToBack(DRV_Queue, &cmd, portMAX_DELAY)!=pdPASS) {
-    return ERR_FAILED;
-  }
-  taskYIELD(); /* yield so drive task has a chance to read message */
-  return ERR_OK;
+  return DRV_SendCmd(&cmd);
 }
 
 #if PL_CONFIG_HAS_QUADRATURE
@@ -226,13 +404,268 @@ uint8_t DRV_SetPos(int32_t left, int32_t right) {
   cmd.cmd = DRV_SET_POS;
   cmd.u.pos.left = left;
   cmd.u.pos.right = right;
-  if (xQueueSendToBack(DRV_Queue, &cmd, portMAX_DELAY)!=pdPASS) {
-    return ERR_FAILED;
+  return DRV_SendCmd(&cmd);
+}
+#endif
+
+#if PL_CONFIG_HAS_POS_PID
+uint8_t DRV_StartMove(int32_t stepsL, int32_t stepsR, DRV_MoveDoneFct done) {
+  DRV_Command cmd;
+
+  cmd.cmd = DRV_START_MOVE;
+  cmd.u.move.left = stepsL;
+  cmd.u.move.right = stepsR;
+  cmd.u.move.done = done;
+  return DRV_SendCmd(&cmd);
+}
+
+uint8_t DRV_CancelMove(void) {
+  DRV_Command cmd;
+
+  cmd.cmd = DRV_CANCEL_MOVE;
+  return DRV_SendCmd(&cmd);
+}
+
+bool DRV_IsMoving(void) {
+  return DRV_Profile.active || DRV_HasPendingCmd();
+}
+
+void DRV_SetMoveLimits(int32_t speedMax, int32_t acc) {
+  if (speedMax>0) {
+    DRV_MoveSpeedMax = speedMax;
+  }
+  if (acc>0) {
+    DRV_MoveAcc = acc;
+  }
+}
+
+static int32_t DRV_Sqrt(uint64_t val) {
+  uint64_t res = 0, bit = 1ULL<<62;
+
+  while (bit>val) {
+    bit >>= 2;
+  }
+  while (bit!=0) {
+    if (val>=res+bit) {
+      val -= res+bit;
+      res = (res>>1)+bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (int32_t)res;
+}
+
+/*!
+ * \brief Returns the planned position of the leading wheel, relative to the start of the move.
+ * \param timeMs Time since the start of the move
+ */
+static int32_t DRV_ProfilePos(int32_t timeMs) {
+  int32_t t;
+
+  if (timeMs<DRV_Profile.accMs) { /* accelerating */
+    return (int32_t)(((int64_t)DRV_MoveAcc*timeMs*timeMs)/2000000);
+  }
+  t = timeMs-DRV_Profile.accMs;
+  if (t<DRV_Profile.cruiseMs) { /* peak speed */
+    return DRV_Profile.accSteps+(int32_t)(((int64_t)DRV_Profile.speed*t)/1000);
+  }
+  t = 2*DRV_Profile.accMs+DRV_Profile.cruiseMs-timeMs; /* time left */
+  if (t>0) { /* decelerating */
+    return DRV_Profile.dist-(int32_t)(((int64_t)DRV_MoveAcc*t*t)/2000000);
+  }
+  return DRV_Profile.dist;
+}
+
+/*!
+ * \brief Plans the profile of the leading wheel: accelerate, move with the peak speed and decelerate.
+ * If there is not enough way to reach the maximum speed, the profile is a triangle without the peak speed phase.
+ */
+static void DRV_CalcProfile(int32_t dist, int32_t *speed, int32_t *accMs, int32_t *accSteps, int32_t *cruiseMs) {
+  *speed = DRV_MoveSpeedMax;
+  if ((int64_t)(*speed)*(*speed)>(int64_t)dist*DRV_MoveAcc) { /* triangle profile */
+    *speed = DRV_Sqrt((uint64_t)dist*(uint64_t)DRV_MoveAcc); /* below DRV_MoveSpeedMax, the product does not fit into 32 bits for long moves */
+  }
+  *accMs = (int32_t)(((int64_t)(*speed)*1000)/DRV_MoveAcc);
+  *accSteps = (int32_t)(((int64_t)DRV_MoveAcc*(*accMs)*(*accMs))/2000000);
+  if (*speed>0 && dist>2*(*accSteps)) {
+    *cruiseMs = (int32_t)(((int64_t)(dist-2*(*accSteps))*1000)/(*speed));
+  } else {
+    *cruiseMs = 0;
   }
-  taskYIELD(); /* yield so drive task has a chance to read message */
-  return ERR_OK;
 }
+
+static int32_t DRV_MoveDist(int32_t stepsL, int32_t stepsR) {
+  if (stepsL<0) {
+    stepsL = -stepsL;
+  }
+  if (stepsR<0) {
+    stepsR = -stepsR;
+  }
+  return stepsL>stepsR?stepsL:stepsR;
+}
+
+int32_t DRV_GetMoveTimeMs(int32_t stepsL, int32_t stepsR) {
+  int32_t speed, accMs, accSteps, cruiseMs;
+
+  DRV_CalcProfile(DRV_MoveDist(stepsL, stepsR), &speed, &accMs, &accSteps, &cruiseMs);
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  return 2*accMs+cruiseMs+DRV_MOVE_SETTLE_MS+DRV_MOVE_BRAKE_MS;
+#else
+  return 2*accMs+cruiseMs+DRV_MOVE_SETTLE_MS;
+#endif
+}
+
+#if DRV_MOVE_PID_TUNED
+/*!
+ * \brief Switches the position PIDs between their configuration and the move settings
+ * \param move TRUE to apply the move settings, FALSE to restore the configuration
+ */
+static void DRV_TunePosPID(bool move) {
+  PID_Config *config;
+  int i;
+
+  if (move==DRV_Profile.pidTuned) {
+    return; /* already done, e.g. the move is planned again after braking */
+  }
+  for(i=0; i<2; i++) {
+    if (PID_GetPIDConfig(i==0?PID_CONFIG_POS_LEFT:PID_CONFIG_POS_RIGHT, &config)==ERR_OK) {
+      if (move) {
+        DRV_Profile.pidDFactor100[i] = config->dFactor100;
+        DRV_Profile.pidMaxSpeedPercent[i] = config->maxSpeedPercent;
+        config->dFactor100 = DRV_MOVE_D_FACTOR100;
+        config->maxSpeedPercent = DRV_MOVE_MAX_SPEED_PERCENT;
+      } else {
+        config->dFactor100 = DRV_Profile.pidDFactor100[i];
+        config->maxSpeedPercent = DRV_Profile.pidMaxSpeedPercent[i];
+      }
+      PID_ConfigChanged(config);
+    }
+  }
+  DRV_Profile.pidTuned = move;
+}
+#endif
+
+static void DRV_PlanMove(int32_t stepsL, int32_t stepsR, DRV_MoveDoneFct done) {
+  DRV_Profile.startL = (int32_t)QUAD_GetLeftPos();
+  DRV_Profile.startR = (int32_t)QUAD_GetRightPos();
+  DRV_Profile.stepsL = stepsL;
+  DRV_Profile.stepsR = stepsR;
+  DRV_Profile.dist = DRV_MoveDist(stepsL, stepsR);
+  DRV_CalcProfile(DRV_Profile.dist, &DRV_Profile.speed, &DRV_Profile.accMs, &DRV_Profile.accSteps, &DRV_Profile.cruiseMs);
+  DRV_Profile.startTicks = xTaskGetTickCount();
+  DRV_Profile.overshoot = 0;
+  DRV_Profile.done = done;
+  DRV_Profile.active = TRUE;
+#if DRV_MOVE_PID_TUNED
+  DRV_TunePosPID(TRUE);
+#endif
+  DRV_Status.pos.left = DRV_Profile.startL;
+  DRV_Status.pos.right = DRV_Profile.startR;
+}
+
+static void DRV_EndMove(DRV_MoveResult result) {
+  DRV_MoveDoneFct done;
+  int32_t errL, errR;
+
+  DRV_Profile.active = FALSE;
+  DRV_Profile.braking = FALSE;
+#if DRV_MOVE_PID_TUNED
+  DRV_TunePosPID(FALSE);
+#endif
+  errL = (DRV_Profile.startL+DRV_Profile.stepsL)-(int32_t)QUAD_GetLeftPos();
+  errR = (DRV_Profile.startR+DRV_Profile.stepsR)-(int32_t)QUAD_GetRightPos();
+  DRV_LastMove.result = result;
+  DRV_LastMove.timeMs = (int32_t)(xTaskGetTickCount()-DRV_Profile.startTicks)*portTICK_PERIOD_MS;
+  DRV_LastMove.overshoot = DRV_Profile.overshoot;
+  DRV_LastMove.error = (errL<0?-errL:errL)>(errR<0?-errR:errR)?errL:errR;
+  done = DRV_Profile.done;
+  DRV_Profile.done = NULL;
+  if (done!=NULL) {
+    done(result);
+  }
+}
+
+/*! \brief Returns the steps a wheel is past its target, in the direction of the move */
+static int32_t DRV_Overshoot(int32_t pos, int32_t start, int32_t steps) {
+  int32_t past;
+
+  past = pos-(start+steps);
+  if (steps<0) {
+    past = -past;
+  }
+  return past;
+}
+
+#if PL_CONFIG_HAS_MOTOR_TACHO
+/*! \brief Returns the brake duty for a wheel turning against the move, 0 if it does not */
+static MOT_SpeedPercent DRV_BrakePercent(int32_t speed, int32_t steps) {
+  if (steps>0 && speed<-DRV_MOVE_BRAKE_SPEED) {
+    return DRV_MOVE_BRAKE_PERCENT;
+  } else if (steps<0 && speed>DRV_MOVE_BRAKE_SPEED) {
+    return -DRV_MOVE_BRAKE_PERCENT;
+  }
+  return 0;
+}
+#endif
+
+/*!
+ * \brief Brakes the wheels which turn against the move that just started. The profile starts from the
+ * position where they have stopped.
+ * \return TRUE if braking, the PWM is set
+ */
+static bool DRV_BrakeMove(void) {
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  MOT_SpeedPercent left, right;
+
+  if (!DRV_Profile.braking) {
+    return FALSE;
+  }
+  left = DRV_BrakePercent(TACHO_GetSpeed(TRUE), DRV_Profile.stepsL);
+  right = DRV_BrakePercent(TACHO_GetSpeed(FALSE), DRV_Profile.stepsR);
+  if ((left!=0 || right!=0)
+      && (xTaskGetTickCount()-DRV_Profile.startTicks)*portTICK_PERIOD_MS<DRV_MOVE_BRAKE_MS)
+  {
+    MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), left);
+    MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), right);
+    return TRUE;
+  }
+  DRV_Profile.braking = FALSE;
+  DRV_PlanMove(DRV_Profile.stepsL, DRV_Profile.stepsR, DRV_Profile.done); /* from where the wheels are now */
+  PID_Start(); /* reset PID, especially integral counters */
 #endif
+  return FALSE;
+}
+
+static void DRV_UpdateMove(void) {
+  int32_t timeMs, pos, overshoot;
+
+  timeMs = (int32_t)(xTaskGetTickCount()-DRV_Profile.startTicks)*portTICK_PERIOD_MS;
+  pos = DRV_ProfilePos(timeMs);
+  if (DRV_Profile.dist!=0) {
+    DRV_Status.pos.left = DRV_Profile.startL+(int32_t)(((int64_t)DRV_Profile.stepsL*pos)/DRV_Profile.dist);
+    DRV_Status.pos.right = DRV_Profile.startR+(int32_t)(((int64_t)DRV_Profile.stepsR*pos)/DRV_Profile.dist);
+  }
+  if (pos<DRV_Profile.dist) {
+    return; /* profile still running */
+  }
+  /* settling: setpoints are at the target */
+  overshoot = DRV_Overshoot((int32_t)QUAD_GetLeftPos(), DRV_Profile.startL, DRV_Profile.stepsL);
+  if (overshoot>DRV_Profile.overshoot) {
+    DRV_Profile.overshoot = overshoot;
+  }
+  overshoot = DRV_Overshoot((int32_t)QUAD_GetRightPos(), DRV_Profile.startR, DRV_Profile.stepsR);
+  if (overshoot>DRV_Profile.overshoot) {
+    DRV_Profile.overshoot = overshoot;
+  }
+  if (DRV_IsInPosition()) {
+    DRV_EndMove(DRV_MOVE_DONE);
+  } else if (timeMs>2*DRV_Profile.accMs+DRV_Profile.cruiseMs+DRV_MOVE_SETTLE_MS) {
+    DRV_EndMove(DRV_MOVE_TIMEOUT);
+  }
+}
+#endif /* PL_CONFIG_HAS_POS_PID */
 
 #if PL_CONFIG_HAS_SHELL
 static uint8_t *DRV_GetModeStr(DRV_Mode mode) {
@@ -259,6 +692,10 @@ static void DRV_PrintHelp(const McuShell_StdIOType *io) {
 #if PL_CONFIG_HAS_POS_PID
   McuShell_SendHelpStr((unsigned char*)"  pos <left> <right>", (unsigned char*)"Move left and right wheels to given position\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  pos reset", (unsigned char*)"Reset drive and wheel position\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  move <left> <right>", (unsigned char*)"Move left and right wheels by given steps with a speed profile\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  move cancel", (unsigned char*)"Cancel the running move\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  move speed <steps>", (unsigned char*)"Maximum move speed in steps/sec\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  move acc <steps>", (unsigned char*)"Move acceleration in steps/sec^2\r\n", io->stdOut);
 #endif
 }
 
@@ -286,6 +723,20 @@ static void DRV_PrintStatus(const McuShell_StdIOType *io) {
 #endif
   McuShell_SendStatusStr((unsigned char*)"  speed right", buf, io->stdOut);
 
+  McuUtility_Num32uToStr(buf, sizeof(buf), DRV_CmdStats.nofTaken);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" taken, ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), DRV_CmdStats.nofReplaced);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" replaced\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  commands", buf, io->stdOut);
+
+  McuShell_SendStatusStr((unsigned char*)"  cmd to PWM", (unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(DRV_CmdStats.lastUs, io->stdOut);
+  McuShell_SendStr((unsigned char*)" us, max ", io->stdOut);
+  McuShell_SendNum32u(DRV_CmdStats.maxUs, io->stdOut);
+  McuShell_SendStr((unsigned char*)" us, mean ", io->stdOut);
+  McuShell_SendNum32u(DRV_CmdStats.nofLatencies==0 ? 0 : DRV_CmdStats.sumUs/DRV_CmdStats.nofLatencies, io->stdOut);
+  McuShell_SendStr((unsigned char*)" us\r\n", io->stdOut);
+
 #if PL_CONFIG_HAS_POS_PID
   McuUtility_Num32sToStr(buf, sizeof(buf), DRV_Status.pos.left);
   McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" (curr: ");
@@ -298,214 +749,345 @@ static void DRV_PrintStatus(const McuShell_StdIOType *io) {
   McuUtility_strcatNum32s(buf, sizeof(buf), (int32_t)QUAD_GetRightPos());
   McuUtility_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
   McuShell_SendStatusStr((unsigned char*)"  pos right", buf, io->stdOut);
+
+  McuUtility_Num32sToStr(buf, sizeof(buf), DRV_MoveSpeedMax);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" steps/sec, ");
+  McuUtility_strcatNum32s(buf, sizeof(buf), DRV_MoveAcc);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" steps/sec^2\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  move limits", buf, io->stdOut);
+
+  McuShell_SendStatusStr((unsigned char*)"  last move", (unsigned char*)"", io->stdOut);
+  switch(DRV_LastMove.result) {
+    case DRV_MOVE_DONE:      McuShell_SendStr((unsigned char*)"done", io->stdOut); break;
+    case DRV_MOVE_TIMEOUT:   McuShell_SendStr((unsigned char*)"timeout", io->stdOut); break;
+    case DRV_MOVE_CANCELLED: McuShell_SendStr((unsigned char*)"cancelled", io->stdOut); break;
+    default: break;
+  }
+  McuShell_SendStr((unsigned char*)", ", io->stdOut);
+  McuShell_SendNum32s(DRV_LastMove.timeMs, io->stdOut);
+  McuShell_SendStr((unsigned char*)" ms, overshoot ", io->stdOut);
+  McuShell_SendNum32s(DRV_LastMove.overshoot, io->stdOut);
+  McuShell_SendStr((unsigned char*)", error ", io->stdOut);
+  McuShell_SendNum32s(DRV_LastMove.error, io->stdOut);
+  McuShell_SendStr((unsigned char*)" steps\r\n", io->stdOut);
 #endif
 }
 
-uint8_t DRV_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-  uint8_t res = ERR_OK;
-  const unsigned char *p;
-  int32_t val1, val2;
-
-  if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_HELP)==0 || McuUtility_strcmp((char*)cmd, (char*)"drive help")==0) {
-    DRV_PrintHelp(io);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_STATUS)==0 || McuUtility_strcmp((char*)cmd, (char*)"drive status")==0) {
-    DRV_PrintStatus(io);
-    *handled = TRUE;
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"drive speed ", sizeof("drive speed ")-1)==0) {
-    p = cmd+sizeof("drive speed");
-    if (McuUtility_xatoi(&p, &val1)==ERR_OK) {
-      if (McuUtility_xatoi(&p, &val2)==ERR_OK) {
-        if (DRV_SetSpeed(val1, val2)!=ERR_OK) {
-          McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
-        }
-        *handled = TRUE;
-      } else {
-        McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
-      }
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument(s)\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-#if PL_CONFIG_HAS_POS_PID
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"drive pos reset", sizeof("drive pos reset")-1)==0) {
-    QUAD_SetLeftPos(0);
-    QUAD_SetRightPos(0);
-    if (DRV_SetPos(0, 0)!=ERR_OK) {
-      McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
-    }
-    *handled = TRUE;
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"drive pos ", sizeof("drive pos ")-1)==0) {
-    p = cmd+sizeof("drive pos");
-    if (McuUtility_xatoi(&p, &val1)==ERR_OK) {
-      if (McuUtility_xatoi(&p, &val2)==ERR_OK) {
-        if (DRV_SetPos(val1, val2)!=ERR_OK) {
-          McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
-        }
-        *handled = TRUE;
-      } else {
-        McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
-      }
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument(s)\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-#endif
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"drive mode ", sizeof("drive mode ")-1)==0) {
-    p = cmd+sizeof("drive mode");
-    if (McuUtility_strcmp((char*)p, (char*)"none")==0) {
-      if (DRV_SetMode(DRV_MODE_NONE)!=ERR_OK) {
-        res = ERR_FAILED;
-      }
-    } else if (McuUtility_strcmp((char*)p, (char*)"stop")==0) {
-      if (DRV_SetMode(DRV_MODE_STOP)!=ERR_OK) {
-        res = ERR_FAILED;
-      }
-    } else if (McuUtility_strcmp((char*)p, (char*)"speed")==0) {
-      if (DRV_SetMode(DRV_MODE_SPEED)!=ERR_OK) {
-        res = ERR_FAILED;
-      }
+static uint8_t DRV_CmdMode(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  const unsigned char *p = args[0].str;
+  uint8_t res = ERR_FAILED;
+
+  if (McuUtility_strcmp((char*)p, (char*)"none")==0) {
+    res = DRV_SetMode(DRV_MODE_NONE);
+  } else if (McuUtility_strcmp((char*)p, (char*)"stop")==0) {
+    res = DRV_SetMode(DRV_MODE_STOP);
+  } else if (McuUtility_strcmp((char*)p, (char*)"speed")==0) {
+    res = DRV_SetMode(DRV_MODE_SPEED);
 #if PL_CONFIG_HAS_QUADRATURE
-    } else if (McuUtility_strcmp((char*)p, (char*)"pos")==0) {
-      if (DRV_SetMode(DRV_MODE_POS)!=ERR_OK) {
-        res = ERR_FAILED;
-      }
+  } else if (McuUtility_strcmp((char*)p, (char*)"pos")==0) {
+    res = DRV_SetMode(DRV_MODE_POS);
 #endif
-    } else {
-      res = ERR_FAILED;
-    }
-    if (res!=ERR_OK) {
-      McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
-    }
-    *handled = TRUE;
   }
-  return res;
+  if (res!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return ERR_OK;
 }
-#endif /* PL_CONFIG_HAS_SHELL */
 
-static uint8_t GetCmd(void) {
-  DRV_Command cmd;
-  portBASE_TYPE res;
+static uint8_t DRV_CmdSpeed(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (DRV_SetSpeed(args[0].i, args[1].i)!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+  }
+  return ERR_OK;
+}
+
+#if PL_CONFIG_HAS_POS_PID
+static uint8_t DRV_CmdPosReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  QUAD_SetLeftPos(0);
+  QUAD_SetRightPos(0);
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_Reset(); /* pose back to zero, the jump of the counters is not integrated */
+#endif
+  if (DRV_SetPos(0, 0)!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+  }
+  return ERR_OK;
+}
+
+static uint8_t DRV_CmdPos(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (DRV_SetPos(args[0].i, args[1].i)!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+  }
+  return ERR_OK;
+}
+
+static uint8_t DRV_CmdMoveCancel(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  if (DRV_CancelMove()!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+  }
+  return ERR_OK;
+}
+
+static uint8_t DRV_CmdMoveSpeed(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (args[0].i<=0) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  DRV_SetMoveLimits(args[0].i, 0);
+  return ERR_OK;
+}
 
-  res = xQueueReceive(DRV_Queue, &cmd, 0);
-  if (res==errQUEUE_EMPTY) {
-    return ERR_RXEMPTY; /* no command */
-  } 
-  /* process command */
+static uint8_t DRV_CmdMoveAcc(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (args[0].i<=0) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  DRV_SetMoveLimits(0, args[0].i);
+  return ERR_OK;
+}
+
+static uint8_t DRV_CmdMove(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (DRV_StartMove(args[0].i, args[1].i, NULL)!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"failed\r\n", io->stdErr);
+  }
+  return ERR_OK;
+}
+#endif
+
+static const CMD_Command DRV_Cmds[] = {
+  {"mode",        "s",  DRV_CmdMode},
+  {"speed",       "ii", DRV_CmdSpeed},
+#if PL_CONFIG_HAS_POS_PID
+  {"pos reset",   "",   DRV_CmdPosReset},
+  {"pos",         "ii", DRV_CmdPos},
+  {"move cancel", "",   DRV_CmdMoveCancel},
+  {"move speed",  "i",  DRV_CmdMoveSpeed},
+  {"move acc",    "i",  DRV_CmdMoveAcc},
+  {"move",        "ii", DRV_CmdMove},
+#endif
+};
+
+const CMD_Group DRV_CmdGroup = CMD_GROUP("drive", DRV_PrintHelp, DRV_PrintStatus, DRV_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+static void DRV_ApplyCmd(const DRV_Command *cmd) {
+#if PL_CONFIG_HAS_POS_PID
+  if (DRV_Profile.active && cmd->cmd!=DRV_SET_SPEED) { /* a new mode, position or move replaces the running move */
+    DRV_EndMove(DRV_MOVE_CANCELLED);
+  }
+#endif
   taskENTER_CRITICAL();
-  if (cmd.cmd==DRV_SET_MODE) {
+  if (cmd->cmd==DRV_SET_MODE) {
 #if PL_HAS_PID
     PID_Start(); /* reset PID, especially integral counters */
 #endif
-    DRV_Status.mode = cmd.u.mode;
-  } else if (cmd.cmd==DRV_SET_SPEED) {
-    DRV_Status.speed.left = cmd.u.speed.left;
-    DRV_Status.speed.right = cmd.u.speed.right;
+    DRV_Status.mode = cmd->u.mode;
+  } else if (cmd->cmd==DRV_SET_SPEED) {
+    DRV_Status.speed.left = cmd->u.speed.left;
+    DRV_Status.speed.right = cmd->u.speed.right;
 #if PL_CONFIG_HAS_POS_PID
-  } else if (cmd.cmd==DRV_SET_POS) {
-    DRV_Status.pos.left = cmd.u.pos.left;
-    DRV_Status.pos.right = cmd.u.pos.right;
+  } else if (cmd->cmd==DRV_SET_POS) {
+    DRV_Status.pos.left = cmd->u.pos.left;
+    DRV_Status.pos.right = cmd->u.pos.right;
+  } else if (cmd->cmd==DRV_START_MOVE) {
+    PID_Start(); /* reset PID, especially integral counters */
+    DRV_PlanMove(cmd->u.move.left, cmd->u.move.right, cmd->u.move.done);
+    DRV_Profile.braking = TRUE; /* checked in the first control cycle of the move */
+    DRV_Status.mode = DRV_MODE_POS;
+  } else if (cmd->cmd==DRV_CANCEL_MOVE) {
+    /* nothing else to do: the position setpoints stay where the move has been cancelled */
 #endif
   }
   taskEXIT_CRITICAL();
 #if PRINT_DRIVE_INFO
-  {
-    uint8_t buf[32];
-
-    if (cmd.cmd==DRV_SET_MODE) {
-      McuUtility_strcpy(buf, sizeof(buf), "SETMODE: ");
-      McuUtility_strcat(buf, sizeof(buf), DRV_GetModeStr(DRV_Status.mode));
-    } else if (cmd.cmd==DRV_SET_SPEED) {
-      McuUtility_strcpy(buf, sizeof(buf), "SETSPEED: ");
-      McuUtility_strcatNum32s(buf, sizeof(buf), DRV_Status.speed.left);
-      McuUtility_strcat(buf, sizeof(buf), ", ");
-      McuUtility_strcatNum32s(buf, sizeof(buf), DRV_Status.speed.right);
-    } else if (cmd.cmd==DRV_SET_POS) {
-      McuUtility_strcpy(buf, sizeof(buf), "SETPOS: ");
-      McuUtility_strcatNum32s(buf, sizeof(buf), DRV_Status.pos.left);
-      McuUtility_strcat(buf, sizeof(buf), ", ");
-      McuUtility_strcatNum32s(buf, sizeof(buf), DRV_Status.pos.right);
-    } else {
-      McuUtility_strcpy(buf, sizeof(buf), "ERROR!");
-    }
-    McuUtility_strcat(buf, sizeof(buf), "\r\n");
-    SHELL_SendString(buf);
+  if (cmd->cmd==DRV_SET_MODE) {
+    DLOG("drive mode %u", DRV_Status.mode);
+  } else if (cmd->cmd==DRV_SET_SPEED) {
+    DLOG("drive speed %d %d", DRV_Status.speed.left, DRV_Status.speed.right);
+  } else if (cmd->cmd==DRV_SET_POS) {
+    DLOG("drive pos %d %d", DRV_Status.pos.left, DRV_Status.pos.right);
+  } else {
+    DLOG("drive command %u", cmd->cmd);
   }
 #endif
-  return ERR_OK;
 }
 
-static void DriveTask(void *pvParameters) {
-  portTickType xLastWakeTime;
-#if !PL_CONFIG_HAS_MOTOR_TACHO
-  DRV_Mode prevMode;
-#endif
-  
-  (void)pvParameters;
-  xLastWakeTime = xTaskGetTickCount();
-#if !PL_CONFIG_HAS_MOTOR_TACHO
-  prevMode = DRV_MODE_NONE;
-#endif
-  for(;;) {
-    while (GetCmd()==ERR_OK) { /* returns ERR_RXEMPTY if queue is empty */
-      /* process incoming commands */
+/*!
+ * \brief Takes the new commands from the mailbox and applies them in the order they have been sent.
+ * \return TRUE if there was a new command
+ */
+static bool DRV_TakeCmds(void) {
+  DRV_Command cmds[DRV_NOF_SLOTS], cmd;
+  uint32_t seqs[DRV_NOF_SLOTS], changed, seq, s;
+  int i, j, nof;
+  CRIT_CriticalVariable()
+
+  if (!DRV_HasPendingCmd()) {
+    return FALSE; /* the usual case, without critical section */
+  }
+  nof = 0;
+  CRIT_EnterCritical(CRIT_LEVEL_KERNEL);
+  changed = DRV_Mailbox.changed;
+  DRV_Mailbox.changed = 0;
+  seq = DRV_Mailbox.seq;
+  DRV_CmdStats.cycles = DRV_Mailbox.cycles;
+  for(i=0; i<DRV_NOF_SLOTS; i++) {
+    if (changed&(1u<<i)) {
+      cmds[nof] = DRV_Mailbox.slots[i].cmd;
+      seqs[nof] = DRV_Mailbox.slots[i].seq;
+      nof++;
     }
-#if PL_CONFIG_HAS_MOTOR_TACHO
-    TACHO_CalcSpeed();
+  }
+  CRIT_ExitCritical();
+  for(i=1; i<nof; i++) { /* sort by sequence number, at most DRV_NOF_SLOTS */
+    cmd = cmds[i];
+    s = seqs[i];
+    for(j=i; j>0 && (int32_t)(seqs[j-1]-s)>0; j--) {
+      cmds[j] = cmds[j-1];
+      seqs[j] = seqs[j-1];
+    }
+    cmds[j] = cmd;
+    seqs[j] = s;
+  }
+  for(i=0; i<nof; i++) {
+    DRV_ApplyCmd(&cmds[i]);
+  }
+  DRV_CmdStats.nofReplaced += (seq-DRV_CmdStats.seq)-(uint32_t)nof;
+  DRV_CmdStats.nofTaken += (uint32_t)nof;
+  DRV_CmdStats.seq = seq;
+  DRV_CmdStats.pending = TRUE;
+  return TRUE;
+}
+
+/*! \brief Time from the newest command taken to the PWM written for it */
+static void DRV_UpdateCmdLatency(void) {
+  uint32_t us;
+
+  if (!DRV_CmdStats.pending) {
+    return;
+  }
+  DRV_CmdStats.pending = FALSE;
+  us = (McuArmTools_GetCycleCounter()-DRV_CmdStats.cycles)/DRV_CYCLES_PER_US;
+  DRV_CmdStats.lastUs = us;
+  if (us>DRV_CmdStats.maxUs) {
+    DRV_CmdStats.maxUs = us;
+  }
+  DRV_CmdStats.sumUs += us;
+  DRV_CmdStats.nofLatencies++;
+}
+
+#if !PL_CONFIG_HAS_MOTOR_TACHO
+static DRV_Mode DRV_prevMode = DRV_MODE_NONE; /* to stop the motors only once */
 #endif
-    if (DRV_Status.mode==DRV_MODE_SPEED) {
+
+/*!
+ * \brief Runs the PID of the current mode, which writes the PWM
+ * \param step TRUE in the control period, FALSE for new setpoints in between: the PIDs only update the output
+ */
+static void DRV_RunControl(bool step) {
+  if (DRV_Status.mode==DRV_MODE_SPEED) {
 #if PL_CONFIG_HAS_SPEED_PID
-      PID_Speed(TACHO_GetSpeed(TRUE), DRV_Status.speed.left, TRUE);
-      PID_Speed(TACHO_GetSpeed(FALSE), DRV_Status.speed.right, FALSE);
+    PID_Speed(TACHO_GetSpeed(TRUE), DRV_Status.speed.left, TRUE, step);
+    PID_Speed(TACHO_GetSpeed(FALSE), DRV_Status.speed.right, FALSE, step);
 #else
-      {
-        MOT_SpeedPercent speedL, speedR;
-        
-        if (DRV_Status.speed.left<-100) {
-          speedL = -60; /* limit to avoid battery drop! */
-        } else if (DRV_Status.speed.left>100) {
-          speedL = 60; /* limit to avoid battery drop! */
-        } else {
-          speedL = DRV_Status.speed.left;
-        }
-        if (DRV_Status.speed.right<-100) {
-          speedR = -60;
-        } else if (DRV_Status.speed.right>100) {
-          speedR = 60;
-        } else {
-          speedR = DRV_Status.speed.right;
-        }
-        MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), speedL);
-        MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), speedR);
+    {
+      MOT_SpeedPercent speedL, speedR;
+      
+      if (DRV_Status.speed.left<-100) {
+        speedL = -60; /* limit to avoid battery drop! */
+      } else if (DRV_Status.speed.left>100) {
+        speedL = 60; /* limit to avoid battery drop! */
+      } else {
+        speedL = DRV_Status.speed.left;
+      }
+      if (DRV_Status.speed.right<-100) {
+        speedR = -60;
+      } else if (DRV_Status.speed.right>100) {
+        speedR = 60;
+      } else {
+        speedR = DRV_Status.speed.right;
       }
+      MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), speedL);
+      MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), speedR);
+    }
 #endif
-    } else if (DRV_Status.mode==DRV_MODE_STOP) {
+  } else if (DRV_Status.mode==DRV_MODE_STOP) {
 #if PL_CONFIG_HAS_SPEED_PID
-      PID_Speed(TACHO_GetSpeed(TRUE), 0, TRUE);
-      PID_Speed(TACHO_GetSpeed(FALSE), 0, FALSE);
+    PID_Speed(TACHO_GetSpeed(TRUE), 0, TRUE, step);
+    PID_Speed(TACHO_GetSpeed(FALSE), 0, FALSE, step);
 #elif !PL_CONFIG_HAS_MOTOR_TACHO
-      if (prevMode!=DRV_MODE_STOP) { /* stop motors */
-        MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), 0);
-        MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), 0);
-      }
+    if (DRV_prevMode!=DRV_MODE_STOP) { /* stop motors */
+      MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), 0);
+      MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), 0);
+    }
 #endif
 #if PL_CONFIG_HAS_POS_PID
-    } else if (DRV_Status.mode==DRV_MODE_POS) {
-      PID_Pos(QUAD_GetLeftPos(), DRV_Status.pos.left, TRUE);
-      PID_Pos(QUAD_GetRightPos(), DRV_Status.pos.right, FALSE);
-#endif
-    } else if (DRV_Status.mode==DRV_MODE_NONE) {
-      /* do nothing */
+  } else if (DRV_Status.mode==DRV_MODE_POS) {
+    if (!DRV_Profile.active || !DRV_BrakeMove()) {
+      if (DRV_Profile.active) {
+        DRV_UpdateMove(); /* advance the setpoints along the profile */
+      }
+      PID_Pos(QUAD_GetLeftPos(), DRV_Status.pos.left, TRUE, step);
+      PID_Pos(QUAD_GetRightPos(), DRV_Status.pos.right, FALSE, step);
     }
+#endif
+  } else if (DRV_Status.mode==DRV_MODE_NONE) {
+    /* do nothing */
+  }
 #if !PL_CONFIG_HAS_MOTOR_TACHO
-    prevMode = DRV_Status.mode;
+  DRV_prevMode = DRV_Status.mode;
+#endif
+  DRV_UpdateCmdLatency();
+}
+
+void DRV_Control(void) {
+  (void)DRV_TakeCmds();
+  DRV_RunControl(TRUE);
+}
+
+void DRV_ApplyCmds(void) {
+  if (DRV_TakeCmds()) {
+    DRV_RunControl(FALSE); /* PWM for the new setpoints now, the PIDs are stepped in the period only */
+  }
+}
+
+#if !PL_CONFIG_HAS_EXEC
+static void DriveTask(void *pvParameters) {
+  TickType_t lastWakeTime, ticks;
+
+  (void)pvParameters;
+  lastWakeTime = xTaskGetTickCount();
+  for(;;) {
+    ticks = lastWakeTime+pdMS_TO_TICKS(DRV_PERIOD_MS)-xTaskGetTickCount();
+    if ((int32_t)ticks>0 && ulTaskNotifyTake(pdTRUE, ticks)!=0) { /* woken up by a new command */
+      DRV_ApplyCmds(); /* the period stays */
+      continue;
+    }
+    lastWakeTime += pdMS_TO_TICKS(DRV_PERIOD_MS);
+    SPAN_BEGIN(SPAN_ID_DRIVE_TASK);
+#if PL_CONFIG_HAS_MOTOR_TACHO
+    TACHO_CalcSpeed();
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+    ODO_Update();
+#endif
+    DRV_Control();
+#if PL_CONFIG_HAS_TELEMETRY
+    TELE_Sample(); /* state after this control cycle */
 #endif
-    vTaskDelayUntil(&xLastWakeTime, 5/portTICK_PERIOD_MS);
+#if PL_CONFIG_HAS_RECORDER
+    REC_Sample();
+#endif
+    SPAN_END(SPAN_ID_DRIVE_TASK);
   } /* for */
 }
+#endif /* !PL_CONFIG_HAS_EXEC */
 
 void DRV_Deinit(void) {
-  vQueueDelete(DRV_Queue);
+  DRV_Mailbox.changed = 0; /* drop the commands not taken yet */
 }
 
 void DRV_Init(void) {
@@ -520,13 +1102,23 @@ void DRV_Init(void) {
   DRV_Status.pos.left = 0;
   DRV_Status.pos.right = 0;
 #endif
-  DRV_Queue = xQueueCreate(QUEUE_LENGTH, QUEUE_ITEM_SIZE);
-  if (DRV_Queue==NULL) {
-    for(;;){} /* out of memory? */
-  }
-  vQueueAddToRegistry(DRV_Queue, "Drive");
-  if (xTaskCreate(DriveTask, "Drive", 400/sizeof(StackType_t), NULL, tskIDLE_PRIORITY+3, NULL) != pdPASS) {
+#if PL_CONFIG_HAS_POS_PID
+  DRV_Profile.active = FALSE;
+  DRV_Profile.done = NULL;
+#if DRV_MOVE_PID_TUNED
+  DRV_Profile.pidTuned = FALSE;
+#endif
+  DRV_MoveSpeedMax = DRV_MOVE_SPEED_MAX;
+  DRV_MoveAcc = DRV_MOVE_ACC;
+#endif
+  memset(&DRV_Mailbox, 0, sizeof(DRV_Mailbox));
+  memset(&DRV_CmdStats, 0, sizeof(DRV_CmdStats));
+  McuArmTools_InitCycleCounter(); /* already done by Span or the executive if they are enabled */
+  McuArmTools_EnableCycleCounter();
+#if !PL_CONFIG_HAS_EXEC /* otherwise in the control stage of the executive */
+  if (xTaskCreate(DriveTask, "Drive", 400/sizeof(StackType_t), NULL, tskIDLE_PRIORITY+3, &DRV_taskHndl) != pdPASS) {
     for(;;){} /* error */
   }
+#endif
 }
 #endif /* PL_CONFIG_HAS_DRIVE */
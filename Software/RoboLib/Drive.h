@@ -13,16 +13,9 @@
 #if PL_CONFIG_HAS_DRIVE
 
 #if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
-
-/*!
- * \brief Parses a command
- * \param cmd Command string to be parsed
- * \param handled Sets this variable to TRUE if command was handled
- * \param io I/O stream to be used for input/output
- * \return Error code, ERR_OK if everything was fine
- */
-uint8_t DRV_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the drive, registered in Shell.c */
+extern const CMD_Group DRV_CmdGroup;
 #endif /* PL_CONFIG_HAS_SHELL */
 
 typedef enum {
@@ -38,9 +31,67 @@ uint8_t DRV_SetSpeed(int32_t left, int32_t right);
 #if PL_CONFIG_HAS_QUADRATURE
 uint8_t DRV_SetPos(int32_t left, int32_t right);
 #endif
+
+#if PL_CONFIG_HAS_POS_PID
+typedef enum {
+  DRV_MOVE_DONE,      /* wheels are in position */
+  DRV_MOVE_TIMEOUT,   /* end of the profile, but the wheels did not settle in time */
+  DRV_MOVE_CANCELLED, /* replaced by another move, mode or position command, or cancelled */
+} DRV_MoveResult;
+
+/*!
+ * \brief Move completion callback, called from the Drive task: must not block. A move replaced by
+ * another command before the Drive task has started it is cancelled in the task which sent that command.
+ */
+typedef void (*DRV_MoveDoneFct)(DRV_MoveResult result);
+
+/*!
+ * \brief Starts a move relative to the current wheel positions, using a trapezoidal speed profile.
+ * The drive task advances the position setpoints of both wheels each cycle, so both wheels arrive at the same time.
+ * \param stepsL Steps to move the left wheel
+ * \param stepsR Steps to move the right wheel
+ * \param done Callback at the end of the move, or NULL
+ * \return ERR_OK if the move has been posted
+ */
+uint8_t DRV_StartMove(int32_t stepsL, int32_t stepsR, DRV_MoveDoneFct done);
+
+/*!
+ * \brief Cancels the running move: the wheels stay at the current setpoints.
+ * \return ERR_OK if the cancel has been posted
+ */
+uint8_t DRV_CancelMove(void);
+
+/*!
+ * \brief Checks if a move is posted or running.
+ * \return TRUE if the move has not finished yet
+ */
+bool DRV_IsMoving(void);
+
+/*!
+ * \brief Returns the planned time for a move, including the time to settle in position.
+ * \param stepsL Steps to move the left wheel
+ * \param stepsR Steps to move the right wheel
+ * \return Time in milliseconds after which the move is finished or times out
+ */
+int32_t DRV_GetMoveTimeMs(int32_t stepsL, int32_t stepsR);
+
+/*!
+ * \brief Sets the limits for the move profiles.
+ * \param speedMax Maximum speed in steps/sec, ignored if not positive
+ * \param acc Acceleration and deceleration in steps/sec^2, ignored if not positive
+ */
+void DRV_SetMoveLimits(int32_t speedMax, int32_t acc);
+#endif
 bool DRV_IsDrivingBackward(void);
 uint8_t DRV_SetMode(DRV_Mode mode);
 DRV_Mode DRV_GetMode(void);
+
+/*!
+ * \brief Returns the set values of the current mode: the speed, or the position in position mode. Zero otherwise.
+ * \param left Where to store the value for the left motor
+ * \param right Where to store the value for the right motor
+ */
+void DRV_GetSetValues(int32_t *left, int32_t *right);
 bool DRV_IsStopped(void);
 bool DRV_HasTurned(void);
 
@@ -51,6 +102,19 @@ bool DRV_HasTurned(void);
  */
 uint8_t DRV_Stop(int32_t timeoutMs);
 
+/*!
+ * \brief One control step: takes the new setpoints and runs the PID for the current mode.
+ * Called by the drive task every 5 ms, or by the control stage of the executive.
+ */
+void DRV_Control(void);
+
+/*!
+ * \brief Applies new commands between the control steps: writes the PWM for the new setpoints
+ * without stepping the PIDs. Called by the drive task on a command, or by a requested run of the
+ * control stage of the executive.
+ */
+void DRV_ApplyCmds(void);
+
 /*!
  * \brief Driver initialization.
  */
@@ -6,87 +6,176 @@
  * This module implements a generic event driver. We are using numbered events starting with zero.
  * EVNT_HandleEvent() can be used to process the pending events. Note that the event with the number zero
  * has the highest priority and will be handled first.
+ * Event zero is the most significant bit of the first memory unit, so the pending event with the highest
+ * priority is the count of leading zeros. The bits are set and cleared with atomic read-modify-write
+ * operations (LDREX/STREX), so no critical section is needed, in tasks and in interrupts.
+ * The values of EVNT_SetEventData() are in a ring buffer of 32bit words with the event and the value.
+ * A writer reserves its word by moving the head with a compare and swap and then writes it: a non-zero
+ * word is valid. The single reader clears the word and then moves the tail.
  */
 
 #include "Platform.h"
 #if PL_CONFIG_HAS_EVENTS
 #include "Event.h" /* our own interface */
-#include "McuCriticalSection.h"
 
 typedef uint32_t EVNT_MemUnit; /*!< memory unit used to store events flags */
 #define EVNT_MEM_UNIT_NOF_BITS  (sizeof(EVNT_MemUnit)*8u)
   /*!< number of bits in memory unit */
+#define EVNT_NOF_MEM_UNITS  (((EVNT_NOF_EVENTS-1)/EVNT_MEM_UNIT_NOF_BITS)+1)
+  /*!< number of memory units for all events */
 
-static EVNT_MemUnit EVNT_Events[((EVNT_NOF_EVENTS-1)/EVNT_MEM_UNIT_NOF_BITS)+1]; /*!< Bit set of events */
+static EVNT_MemUnit EVNT_Events[EVNT_NOF_MEM_UNITS]; /*!< Bit set of events */
 
+#define EVENT_MASK(event) \
+  ((1u<<(EVNT_MEM_UNIT_NOF_BITS-1))>>(((event)%EVNT_MEM_UNIT_NOF_BITS))) /*!< Bit of the event in its memory unit */
 #define SET_EVENT(event) \
-  EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS] |= (1u<<(EVNT_MEM_UNIT_NOF_BITS-1))>>(((event)%EVNT_MEM_UNIT_NOF_BITS)) /*!< Set the event */
+  __atomic_fetch_or(&EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS], EVENT_MASK(event), __ATOMIC_RELEASE) /*!< Set the event, returns the previous bits */
 #define CLR_EVENT(event) \
-  EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS] &= ~((1u<<(EVNT_MEM_UNIT_NOF_BITS-1))>>(((event)%EVNT_MEM_UNIT_NOF_BITS))) /*!< Clear the event */
+  __atomic_fetch_and(&EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS], ~EVENT_MASK(event), __ATOMIC_ACQUIRE) /*!< Clear the event, returns the previous bits */
 #define GET_EVENT(event) \
-  (EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS]&(((1u<<(EVNT_MEM_UNIT_NOF_BITS-1))>>(((event)%EVNT_MEM_UNIT_NOF_BITS))))) /*!< Return TRUE if event is set */
+  (__atomic_load_n(&EVNT_Events[(event)/EVNT_MEM_UNIT_NOF_BITS], __ATOMIC_ACQUIRE)&EVENT_MASK(event)) /*!< Return TRUE if event is set */
+
+#if EVNT_CONFIG_QUEUE_SIZE>0
+#if (EVNT_CONFIG_QUEUE_SIZE&(EVNT_CONFIG_QUEUE_SIZE-1))!=0
+  #error "EVNT_CONFIG_QUEUE_SIZE has to be a power of two"
+#endif
+#define EVNT_QUEUE_VALID  (1u<<31) /*!< marks a written word in the queue */
+
+static uint32_t EVNT_Queue[EVNT_CONFIG_QUEUE_SIZE]; /*!< event values, 0 is a free or not yet written word */
+static uint32_t EVNT_QueueHead; /*!< next word to reserve, free running */
+static uint32_t EVNT_QueueTail; /*!< next word to read, free running, only changed by the reader */
+#endif
+
+#if EVNT_CONFIG_NOF_SUBSCRIBERS>0
+typedef struct {
+  TaskHandle_t task;       /*!< task to notify */
+  uint32_t notifyBits;     /*!< bits for xTaskNotify() */
+  EVNT_MemUnit events[EVNT_NOF_MEM_UNITS]; /*!< the events the task has subscribed to */
+} EVNT_Subscriber;
+
+static EVNT_Subscriber EVNT_Subscribers[EVNT_CONFIG_NOF_SUBSCRIBERS];
+static uint8_t EVNT_NofSubscribers;
+
+/*! \brief Notifies the tasks which have subscribed to the event. */
+static void EVNT_Notify(EVNT_Handle event) {
+  uint8_t i, nof;
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  nof = __atomic_load_n(&EVNT_NofSubscribers, __ATOMIC_ACQUIRE);
+  for(i=0; i<nof; i++) {
+    if (EVNT_Subscribers[i].events[event/EVNT_MEM_UNIT_NOF_BITS]&EVENT_MASK(event)) {
+      if (xPortIsInsideInterrupt()) {
+        (void)xTaskNotifyFromISR(EVNT_Subscribers[i].task, EVNT_Subscribers[i].notifyBits, eSetBits, &higherPriorityTaskWoken);
+      } else {
+        (void)xTaskNotify(EVNT_Subscribers[i].task, EVNT_Subscribers[i].notifyBits, eSetBits);
+      }
+    }
+  }
+  portYIELD_FROM_ISR(higherPriorityTaskWoken); /* only true inside an interrupt */
+}
 
-void EVNT_SetEvent(EVNT_Handle event) {
-  McuCriticalSection_CriticalVariable()
+uint8_t EVNT_Subscribe(EVNT_Handle event, TaskHandle_t task, uint32_t notifyBits) {
+  uint8_t i;
+  EVNT_Subscriber *sub;
+
+  if (event>=EVNT_NOF_EVENTS) {
+    return ERR_RANGE;
+  }
+  for(i=0; i<EVNT_NofSubscribers; i++) {
+    sub = &EVNT_Subscribers[i];
+    if (sub->task==task && sub->notifyBits==notifyBits) {
+      __atomic_fetch_or(&sub->events[event/EVNT_MEM_UNIT_NOF_BITS], EVENT_MASK(event), __ATOMIC_RELEASE);
+      return ERR_OK;
+    }
+  }
+  if (EVNT_NofSubscribers>=EVNT_CONFIG_NOF_SUBSCRIBERS) {
+    return ERR_OVERFLOW;
+  }
+  sub = &EVNT_Subscribers[EVNT_NofSubscribers];
+  sub->task = task;
+  sub->notifyBits = notifyBits;
+  sub->events[event/EVNT_MEM_UNIT_NOF_BITS] |= EVENT_MASK(event);
+  __atomic_store_n(&EVNT_NofSubscribers, EVNT_NofSubscribers+1, __ATOMIC_RELEASE); /* publish it for EVNT_Notify() */
+  return ERR_OK;
+}
+#endif /* EVNT_CONFIG_NOF_SUBSCRIBERS>0 */
 
-  McuCriticalSection_EnterCritical();
-  SET_EVENT(event);
-  McuCriticalSection_ExitCritical();
+void EVNT_SetEvent(EVNT_Handle event) {
+  (void)SET_EVENT(event);
+#if EVNT_CONFIG_NOF_SUBSCRIBERS>0
+  EVNT_Notify(event);
+#endif
 }
 
 void EVNT_ClearEvent(EVNT_Handle event) {
-  McuCriticalSection_CriticalVariable()
-
-  McuCriticalSection_EnterCritical();
-  CLR_EVENT(event);
-  McuCriticalSection_ExitCritical();
+  (void)CLR_EVENT(event);
 }
 
 bool EVNT_EventIsSet(EVNT_Handle event) {
-  bool isSet;
-  McuCriticalSection_CriticalVariable()
-
-  McuCriticalSection_EnterCritical();
-  isSet = GET_EVENT(event);
-  McuCriticalSection_ExitCritical();
-  return isSet;
+  return GET_EVENT(event)!=0;
 }
 
 bool EVNT_EventIsSetAutoClear(EVNT_Handle event) {
-  bool res;
-  McuCriticalSection_CriticalVariable()
-
-  McuCriticalSection_EnterCritical();
-  res = GET_EVENT(event);
-  if (res) {
-    CLR_EVENT(event); /* automatically clear event */
+  if (GET_EVENT(event)==0) {
+    return FALSE; /* the usual case when polling: no write needed */
   }
-  McuCriticalSection_ExitCritical();
-  return res;
+  return (CLR_EVENT(event)&EVENT_MASK(event))!=0; /* automatically clear event, unless someone else was faster */
 }
 
 void EVNT_HandleEvent(void (*callback)(EVNT_Handle), bool clearEvent) {
-   /* Handle the one with the highest priority. Zero is the event with the highest priority. */
-   EVNT_Handle event;
-   McuCriticalSection_CriticalVariable()
-
-   McuCriticalSection_EnterCritical();
-   for (event=(EVNT_Handle)0; event<EVNT_NOF_EVENTS; event++) { /* does a test on every event */
-     if (GET_EVENT(event)) { /* event present? */
-       if (clearEvent) {
-         CLR_EVENT(event); /* clear event */
-       }
-       break; /* get out of loop */
-     }
-   }
-   McuCriticalSection_ExitCritical();
-   if (event != EVNT_NOF_EVENTS) {
-     callback(event);
-     /* Note: if the callback sets the event, we will get out of the loop.
-      * We will catch it by the next iteration.
-      */
-   }
+  /* Handle the one with the highest priority. Zero is the event with the highest priority. */
+  uint8_t i;
+  EVNT_MemUnit bits, mask;
+
+  for(i=0; i<EVNT_NOF_MEM_UNITS; i++) {
+    bits = __atomic_load_n(&EVNT_Events[i], __ATOMIC_ACQUIRE);
+    while (bits!=0) {
+      mask = (1u<<(EVNT_MEM_UNIT_NOF_BITS-1))>>__builtin_clz(bits); /* CLZ instruction: highest priority pending */
+      if (!clearEvent) {
+        callback((EVNT_Handle)(i*EVNT_MEM_UNIT_NOF_BITS+__builtin_clz(bits)));
+        return;
+      }
+      bits = __atomic_fetch_and(&EVNT_Events[i], ~mask, __ATOMIC_ACQUIRE); /* clear event */
+      if (bits&mask) { /* still set, otherwise another task has handled it: try the next one */
+        callback((EVNT_Handle)(i*EVNT_MEM_UNIT_NOF_BITS+__builtin_clz(mask)));
+        /* Note: if the callback sets the event, we will catch it by the next call. */
+        return;
+      }
+    }
+  }
+}
+
+#if EVNT_CONFIG_QUEUE_SIZE>0
+uint8_t EVNT_SetEventData(EVNT_Handle event, uint16_t data) {
+  uint32_t head;
+
+  head = __atomic_load_n(&EVNT_QueueHead, __ATOMIC_RELAXED);
+  do {
+    if (head-__atomic_load_n(&EVNT_QueueTail, __ATOMIC_ACQUIRE)>=EVNT_CONFIG_QUEUE_SIZE) {
+      EVNT_SetEvent(event);
+      return ERR_OVERFLOW;
+    }
+  } while(!__atomic_compare_exchange_n(&EVNT_QueueHead, &head, head+1, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  __atomic_store_n(&EVNT_Queue[head&(EVNT_CONFIG_QUEUE_SIZE-1)], EVNT_QUEUE_VALID|((uint32_t)event<<16)|data, __ATOMIC_RELEASE);
+  EVNT_SetEvent(event); /* after the value, so the handler of the event finds it */
+  return ERR_OK;
+}
+
+bool EVNT_GetEventData(EVNT_Handle *event, uint16_t *data) {
+  uint32_t tail, word;
+
+  tail = EVNT_QueueTail;
+  word = __atomic_load_n(&EVNT_Queue[tail&(EVNT_CONFIG_QUEUE_SIZE-1)], __ATOMIC_ACQUIRE);
+  if (word==0) {
+    return FALSE; /* empty, or the writer has not written it yet */
+  }
+  EVNT_Queue[tail&(EVNT_CONFIG_QUEUE_SIZE-1)] = 0;
+  __atomic_store_n(&EVNT_QueueTail, tail+1, __ATOMIC_RELEASE); /* writers can use the word again */
+  *event = (EVNT_Handle)((word>>16)&0x7FFF);
+  *data = (uint16_t)word;
+  return TRUE;
 }
+#endif /* EVNT_CONFIG_QUEUE_SIZE>0 */
 
 void EVNT_Init(void) {
   uint8_t i;
@@ -96,6 +185,15 @@ void EVNT_Init(void) {
     EVNT_Events[i] = 0; /* initialize data structure */
     i++;
   } while(i<sizeof(EVNT_Events)/sizeof(EVNT_Events[0]));
+#if EVNT_CONFIG_QUEUE_SIZE>0
+  for(i=0; i<EVNT_CONFIG_QUEUE_SIZE; i++) {
+    EVNT_Queue[i] = 0;
+  }
+  EVNT_QueueHead = EVNT_QueueTail = 0;
+#endif
+#if EVNT_CONFIG_NOF_SUBSCRIBERS>0
+  EVNT_NofSubscribers = 0;
+#endif
 }
 
 void EVNT_Deinit(void) {
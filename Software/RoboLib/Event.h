@@ -6,6 +6,10 @@
  * This module implements a generic event driver. We are using numbered events starting with zero.
  * EVNT_HandleEvent() can be used to process the pending events. Note that the event with the number zero
  * has the highest priority and will be handled first
+ * The events can be set and cleared from interrupts: the bit set is changed with atomic operations, and
+ * the pending event with the highest priority is found with a count leading zeros (CLZ) instruction.
+ * An event can carry a 16bit value in a small queue, and a task can subscribe to events to be woken up
+ * by a task notification.
  */
 
 #ifndef EVENT_H_
@@ -13,6 +17,18 @@
 
 #include "Platform.h"
 #if PL_CONFIG_HAS_EVENTS
+#include <stdint.h>
+#if PL_CONFIG_USE_FREERTOS
+  #include "FreeRTOS.h"
+  #include "task.h"
+#endif
+
+#ifndef EVNT_CONFIG_QUEUE_SIZE
+  #define EVNT_CONFIG_QUEUE_SIZE        (8) /*!< number of event values in the queue, power of two, 0 to disable */
+#endif
+#ifndef EVNT_CONFIG_NOF_SUBSCRIBERS
+  #define EVNT_CONFIG_NOF_SUBSCRIBERS   (2 && PL_CONFIG_USE_FREERTOS) /*!< number of tasks which can subscribe to events */
+#endif
 
 typedef enum EVNT_Handle {
   EVNT_STARTUP,            /*!< System startup Event */
@@ -57,6 +73,10 @@ typedef enum EVNT_Handle {
   #endif
 #endif
   /*!< \todo Your extra events here */
+#ifdef EVNT_CONFIG_NOF_APP_EVENTS
+  EVNT_APP_FIRST, /*!< first of EVNT_CONFIG_NOF_APP_EVENTS events of the application, e.g. for a host test */
+  EVNT_APP_LAST = EVNT_APP_FIRST+EVNT_CONFIG_NOF_APP_EVENTS-1,
+#endif
   EVNT_NOF_EVENTS       /*!< Must be last one! */
 } EVNT_Handle;
 
@@ -93,6 +113,36 @@ bool EVNT_EventIsSetAutoClear(EVNT_Handle event);
  */
 void EVNT_HandleEvent(void (*callback)(EVNT_Handle), bool clearEvent);
 
+#if EVNT_CONFIG_QUEUE_SIZE>0
+/*!
+ * \brief Sets an event and adds a value for it to the queue. Can be called from interrupts.
+ * \param[in] event The handle of the event to set.
+ * \param[in] data Value for the event, see EVNT_GetEventData().
+ * \return ERR_OK, or ERR_OVERFLOW if the queue is full: the event is set, but the value is lost.
+ */
+uint8_t EVNT_SetEventData(EVNT_Handle event, uint16_t data);
+
+/*!
+ * \brief Removes the oldest value from the queue. Only one task may read the queue.
+ * \param[out] event Event of the value.
+ * \param[out] data Value.
+ * \return TRUE if there has been a value in the queue, FALSE otherwise.
+ */
+bool EVNT_GetEventData(EVNT_Handle *event, uint16_t *data);
+#endif
+
+#if EVNT_CONFIG_NOF_SUBSCRIBERS>0
+/*!
+ * \brief Wakes up a task with a notification each time the event gets set. Call it after creating the task,
+ * before the event is used.
+ * \param[in] event The handle of the event.
+ * \param[in] task Task to be notified.
+ * \param[in] notifyBits Bits set in the notification value of the task.
+ * \return ERR_OK, or ERR_OVERFLOW if there are more than EVNT_CONFIG_NOF_SUBSCRIBERS tasks with different bits.
+ */
+uint8_t EVNT_Subscribe(EVNT_Handle event, TaskHandle_t task, uint32_t notifyBits);
+#endif
+
 /*! \brief Event module initialization */
 void EVNT_Init(void);
 
@@ -0,0 +1,316 @@
+/**
+ * \file
+ * \brief Control executive: sense, plan and act in one task with a fixed cycle
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The cycle timer interrupt gives a notification to the executive task, which has the highest
+ * application priority. The timer is not synchronous to the RTOS tick, so the cycle does not queue
+ * behind the tick hook and the tasks it makes ready. Each cycle runs the due stages in their
+ * order. The notification value counts the releases, so a cycle which took longer than the period
+ * shows up as missed cycles. The stage times are measured with the cycle counter.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_EXEC
+#include "Exec.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "McuArmTools.h"
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  #include "Tacho.h"
+#endif
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  #include "Proximity.h"
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#if PL_CONFIG_HAS_LINE
+  #include "Line.h"
+#endif
+#if PL_CONFIG_HAS_SUMO
+  #include "Sumo.h"
+#endif
+#if PL_CONFIG_HAS_DRIVE
+  #include "Drive.h"
+#endif
+#if PL_CONFIG_HAS_TELEMETRY
+  #include "Telemetry.h"
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+  #include "McuUtility.h"
+#endif
+
+#if EXEC_CONFIG_CYCLE_US!=1000 || configTICK_RATE_HZ!=1000
+  #error "the rates and the tacho sampling (counting RTOS ticks per call) expect a 1 ms cycle"
+#endif
+
+#define EXEC_CYCLES_PER_US  (configCPU_CLOCK_HZ/1000000)
+
+/*! \brief Sensor sampling, for the estimators and the strategy in this cycle */
+static void EXEC_Sense(void) {
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  TACHO_Sample();
+#endif
+#if PL_CONFIG_HAS_REFLECTANCE
+  REF_Sample();
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  PROX_Process();
+#endif
+}
+
+static void EXEC_Estimate(void) {
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  TACHO_CalcSpeed();
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_Update();
+#endif
+#if PL_CONFIG_HAS_LINE
+  LINE_StateMachine();
+#endif
+}
+
+static void EXEC_Plan(void) {
+#if PL_CONFIG_HAS_SUMO
+  SUMO_Step();
+#endif
+}
+
+static void EXEC_Control(void) {
+#if PL_CONFIG_HAS_DRIVE
+  DRV_Control();
+#endif
+}
+
+/*! \brief Requested between the control periods: new drive commands, without stepping the PIDs */
+static void EXEC_ControlRequested(void) {
+#if PL_CONFIG_HAS_DRIVE
+  DRV_ApplyCmds();
+#endif
+}
+
+static void EXEC_Record(void) {
+#if PL_CONFIG_HAS_TELEMETRY
+  TELE_Sample(); /* state after the control */
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  REC_Sample();
+#endif
+}
+
+typedef struct {
+  const unsigned char *name;
+  void (*fct)(void);
+  void (*requestFct)(void); /*!< for a requested run between the periodic ones, NULL to run fct */
+  uint8_t rate;       /*!< runs every rate cycles */
+  uint16_t budgetUs;  /*!< longer runs are counted as overruns */
+} EXEC_StageDesc;
+
+static const EXEC_StageDesc EXEC_stageDescs[EXEC_NOF_STAGES] = {
+  {(const unsigned char*)"sense",    EXEC_Sense,    NULL,                  EXEC_CONFIG_SENSE_RATE,    EXEC_CONFIG_SENSE_BUDGET_US},
+  {(const unsigned char*)"estimate", EXEC_Estimate, NULL,                  EXEC_CONFIG_ESTIMATE_RATE, EXEC_CONFIG_ESTIMATE_BUDGET_US},
+  {(const unsigned char*)"plan",     EXEC_Plan,     NULL,                  EXEC_CONFIG_PLAN_RATE,     EXEC_CONFIG_PLAN_BUDGET_US},
+  {(const unsigned char*)"control",  EXEC_Control,  EXEC_ControlRequested, EXEC_CONFIG_CONTROL_RATE,  EXEC_CONFIG_CONTROL_BUDGET_US},
+  {(const unsigned char*)"record",   EXEC_Record,   NULL,                  EXEC_CONFIG_RECORD_RATE,   EXEC_CONFIG_RECORD_BUDGET_US},
+};
+
+typedef struct {
+  uint8_t countdown;    /*!< cycles until the next run */
+  uint32_t maxCycles;   /*!< longest run, CPU cycles */
+  uint64_t sumCycles;   /*!< for the mean */
+  uint32_t nofRuns;     /*!< number of runs */
+  uint32_t nofOverruns; /*!< runs longer than the budget */
+} EXEC_StageData;
+
+static EXEC_StageData EXEC_stageData[EXEC_NOF_STAGES];
+static uint32_t EXEC_requests; /*!< bit set of stages requested out of their rate */
+static TaskHandle_t EXEC_taskHndl;
+static uint32_t EXEC_releaseCycles; /*!< cycle counter at the interrupt which released the cycle */
+static uint32_t EXEC_nofCycles, EXEC_nofMissed; /*!< cycles run, and releases missed while a cycle was running */
+static uint32_t EXEC_maxCycleCycles; /*!< longest time from the release to the end of a cycle, CPU cycles */
+static volatile bool EXEC_resetRequest; /*!< the task clears the statistics */
+
+void EXEC_RequestStage(EXEC_Stage stage) {
+  if (stage<EXEC_NOF_STAGES) {
+    (void)__atomic_fetch_or(&EXEC_requests, 1u<<stage, __ATOMIC_RELEASE);
+  }
+}
+
+bool EXEC_IsExecutive(void) {
+  return EXEC_taskHndl!=NULL && xTaskGetCurrentTaskHandle()==EXEC_taskHndl;
+}
+
+void EXEC_OnCycleInterrupt(void) {
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  if (EXEC_taskHndl!=NULL) {
+    EXEC_releaseCycles = McuArmTools_GetCycleCounter();
+    vTaskNotifyGiveFromISR(EXEC_taskHndl, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+  }
+}
+
+static bool EXEC_TakeRequest(EXEC_Stage stage) {
+  uint32_t mask = 1u<<stage;
+
+  if ((__atomic_load_n(&EXEC_requests, __ATOMIC_RELAXED)&mask)==0) {
+    return FALSE; /* the usual case: no write needed */
+  }
+  return (__atomic_fetch_and(&EXEC_requests, ~mask, __ATOMIC_ACQUIRE)&mask)!=0;
+}
+
+static void EXEC_RunCycle(void) {
+  int stage;
+  EXEC_StageData *data;
+  uint32_t start, cycles;
+  void (*fct)(void);
+
+  for(stage=0; stage<EXEC_NOF_STAGES; stage++) {
+    data = &EXEC_stageData[stage];
+    fct = EXEC_stageDescs[stage].fct;
+    if (data->countdown>1) {
+      data->countdown--;
+      if (!EXEC_TakeRequest((EXEC_Stage)stage)) {
+        continue;
+      }
+      if (EXEC_stageDescs[stage].requestFct!=NULL) { /* between the periodic runs, which keep their rate */
+        fct = EXEC_stageDescs[stage].requestFct;
+      }
+    } else {
+      (void)EXEC_TakeRequest((EXEC_Stage)stage); /* done by the periodic run */
+      data->countdown = EXEC_stageDescs[stage].rate;
+    }
+    start = McuArmTools_GetCycleCounter();
+    fct();
+    cycles = McuArmTools_GetCycleCounter()-start;
+    if (cycles>data->maxCycles) {
+      data->maxCycles = cycles;
+    }
+    data->sumCycles += cycles;
+    data->nofRuns++;
+    if (cycles>EXEC_stageDescs[stage].budgetUs*EXEC_CYCLES_PER_US) {
+      data->nofOverruns++;
+    }
+  }
+}
+
+static void EXEC_ResetStatistics(void) {
+  int i;
+
+  for(i=0; i<EXEC_NOF_STAGES; i++) {
+    EXEC_stageData[i].maxCycles = 0;
+    EXEC_stageData[i].sumCycles = 0;
+    EXEC_stageData[i].nofRuns = 0;
+    EXEC_stageData[i].nofOverruns = 0;
+  }
+  EXEC_nofCycles = EXEC_nofMissed = 0;
+  EXEC_maxCycleCycles = 0;
+}
+
+static void ExecTask(void *pvParameters) {
+  uint32_t nofReleases, cycles;
+
+  (void)pvParameters; /* not used */
+  for(;;) {
+    nofReleases = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (EXEC_resetRequest) {
+      EXEC_resetRequest = FALSE;
+      EXEC_ResetStatistics();
+    } else if (nofReleases>1) {
+      EXEC_nofMissed += nofReleases-1; /* the previous cycle was too long */
+    }
+    EXEC_RunCycle();
+    cycles = McuArmTools_GetCycleCounter()-EXEC_releaseCycles;
+    if (cycles>EXEC_maxCycleCycles) {
+      EXEC_maxCycleCycles = cycles;
+    }
+    EXEC_nofCycles++;
+  }
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void EXEC_strcatUs(uint8_t *buf, size_t bufSize, uint32_t cycles) {
+  McuUtility_strcatNum32u(buf, bufSize, cycles/EXEC_CYCLES_PER_US);
+  McuUtility_chcat(buf, bufSize, '.');
+  McuUtility_strcatNum32uFormatted(buf, bufSize, ((cycles%EXEC_CYCLES_PER_US)*10)/EXEC_CYCLES_PER_US, '0', 1);
+}
+
+static void EXEC_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"exec", (unsigned char*)"Group of control executive commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows help or the stage times\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Clears the statistics\r\n", io->stdOut);
+}
+
+static void EXEC_PrintStatus(const McuShell_StdIOType *io) {
+  uint8_t buf[64], name[16];
+  EXEC_StageData data;
+  int i;
+
+  McuShell_SendStatusStr((unsigned char*)"exec", (unsigned char*)"\r\n", io->stdOut);
+  McuUtility_Num32uToStr(buf, sizeof(buf), EXEC_nofCycles);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" of 1 ms, ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), EXEC_nofMissed);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" missed, max ");
+  EXEC_strcatUs(buf, sizeof(buf), EXEC_maxCycleCycles);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" us from release\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  cycles", buf, io->stdOut);
+  McuShell_SendStatusStr((unsigned char*)"  stages", (unsigned char*)"rate, budget/max/mean us, runs, overruns\r\n", io->stdOut);
+  for(i=0; i<EXEC_NOF_STAGES; i++) {
+    data = EXEC_stageData[i]; /* a copy: the executive has a higher priority */
+    McuUtility_strcpy(name, sizeof(name), (unsigned char*)"    ");
+    McuUtility_strcat(name, sizeof(name), EXEC_stageDescs[i].name);
+    McuUtility_Num8uToStr(buf, sizeof(buf), EXEC_stageDescs[i].rate);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+    McuUtility_strcatNum16u(buf, sizeof(buf), EXEC_stageDescs[i].budgetUs);
+    McuUtility_chcat(buf, sizeof(buf), '/');
+    EXEC_strcatUs(buf, sizeof(buf), data.maxCycles);
+    McuUtility_chcat(buf, sizeof(buf), '/');
+    EXEC_strcatUs(buf, sizeof(buf), data.nofRuns==0 ? 0 : (uint32_t)(data.sumCycles/data.nofRuns));
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+    McuUtility_strcatNum32u(buf, sizeof(buf), data.nofRuns);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+    McuUtility_strcatNum32u(buf, sizeof(buf), data.nofOverruns);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+    McuShell_SendStatusStr(name, buf, io->stdOut);
+  }
+}
+
+static uint8_t EXEC_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  EXEC_resetRequest = TRUE;
+  return ERR_OK;
+}
+
+static const CMD_Command EXEC_Cmds[] = {
+  {"reset", "", EXEC_CmdReset},
+};
+
+const CMD_Group EXEC_CmdGroup = CMD_GROUP("exec", EXEC_PrintHelp, EXEC_PrintStatus, EXEC_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void EXEC_Init(void) {
+  int i;
+
+  McuArmTools_InitCycleCounter(); /* already done by McuWait or Span if they use the cycle counter */
+  McuArmTools_EnableCycleCounter();
+  for(i=0; i<EXEC_NOF_STAGES; i++) {
+    EXEC_stageData[i].countdown = 1; /* all stages in the first cycle */
+  }
+  EXEC_ResetStatistics();
+  EXEC_requests = 0;
+  EXEC_resetRequest = FALSE;
+  if (xTaskCreate(ExecTask, "Exec", 600/sizeof(StackType_t), NULL, tskIDLE_PRIORITY+4, &EXEC_taskHndl) != pdPASS) {
+    for(;;){} /* error */
+  }
+}
+
+#endif /* PL_CONFIG_HAS_EXEC */
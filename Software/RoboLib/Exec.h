@@ -0,0 +1,106 @@
+/**
+ * \file
+ * \brief Control executive: sense, plan and act in one task with a fixed cycle
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The executive runs the control pipeline of the robot in one task, released every cycle by the
+ * interrupt of its own timer (TIM6), at the priority of the other interrupts using the RTOS API.
+ * The stages run in a fixed order, each with its sub-rate in cycles:
+ * - sense: tacho sampling, reflectance and proximity sensors
+ * - estimate: speed, odometry and line calibration
+ * - plan: the sumo strategy
+ * - control: drive commands, PID and PWM
+ * - record: telemetry and recorder
+ * A sensor value is handled by the strategy in the same cycle, and a new drive command requests
+ * the control stage right after the plan. That gives one cycle from a border to the brake, as long
+ * as the command acts on its own: a move which depends on the speed estimate (DRV_BrakeMove()) or
+ * settles in the position PID dead band can wait for the next estimate and control run, up to one
+ * control period. The RoboSim bouts measure 1.1 to 1.9 ms from the border to the reversal.
+ * The time of each stage is measured against its budget.
+ */
+
+#ifndef SRC_EXEC_H_
+#define SRC_EXEC_H_
+
+#include "Platform.h"
+
+#if PL_CONFIG_HAS_EXEC
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef EXEC_CONFIG_CYCLE_US
+  #define EXEC_CONFIG_CYCLE_US       (1000) /* period of the cycle timer */
+#endif
+
+/* sub-rates in cycles */
+#ifndef EXEC_CONFIG_SENSE_RATE
+  #define EXEC_CONFIG_SENSE_RATE     (1)
+#endif
+#ifndef EXEC_CONFIG_ESTIMATE_RATE
+  #define EXEC_CONFIG_ESTIMATE_RATE  (5) /* the speed and odometry filters are tuned for 5 ms */
+#endif
+#ifndef EXEC_CONFIG_PLAN_RATE
+  #define EXEC_CONFIG_PLAN_RATE      (1)
+#endif
+#ifndef EXEC_CONFIG_CONTROL_RATE
+  #define EXEC_CONFIG_CONTROL_RATE   (5) /* the PID parameters are tuned for 5 ms */
+#endif
+#ifndef EXEC_CONFIG_RECORD_RATE
+  #define EXEC_CONFIG_RECORD_RATE    (5)
+#endif
+
+/* budgets in micro seconds, the sum has to fit into a cycle */
+#ifndef EXEC_CONFIG_SENSE_BUDGET_US
+  #define EXEC_CONFIG_SENSE_BUDGET_US     (120) /* includes charging the reflectance sensors */
+#endif
+#ifndef EXEC_CONFIG_ESTIMATE_BUDGET_US
+  #define EXEC_CONFIG_ESTIMATE_BUDGET_US  (80)
+#endif
+#ifndef EXEC_CONFIG_PLAN_BUDGET_US
+  #define EXEC_CONFIG_PLAN_BUDGET_US      (80)
+#endif
+#ifndef EXEC_CONFIG_CONTROL_BUDGET_US
+  #define EXEC_CONFIG_CONTROL_BUDGET_US   (100)
+#endif
+#ifndef EXEC_CONFIG_RECORD_BUDGET_US
+  #define EXEC_CONFIG_RECORD_BUDGET_US    (100)
+#endif
+
+typedef enum {
+  EXEC_STAGE_SENSE,
+  EXEC_STAGE_ESTIMATE,
+  EXEC_STAGE_PLAN,
+  EXEC_STAGE_CONTROL,
+  EXEC_STAGE_RECORD,
+  EXEC_NOF_STAGES
+} EXEC_Stage;
+
+/*!
+ * \brief Runs a stage out of its rate: in the current cycle if it has not passed yet, otherwise
+ * in the next one. The periodic runs keep their rate, so the control stage only applies the new
+ * drive commands in a requested run. Can be called from any task.
+ * \param stage Stage to run
+ */
+void EXEC_RequestStage(EXEC_Stage stage);
+
+/*!
+ * \brief Tells if the caller is the executive, which must not wait for itself.
+ * \return TRUE if called from a stage
+ */
+bool EXEC_IsExecutive(void);
+
+/*! \brief Releases the next cycle, called from the interrupt of the cycle timer. */
+void EXEC_OnCycleInterrupt(void);
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the executive, registered in Shell.c */
+extern const CMD_Group EXEC_CmdGroup;
+#endif
+
+/*! \brief Module initialization, creates the task. Call after the modules of the stages. */
+void EXEC_Init(void);
+
+#endif /* PL_CONFIG_HAS_EXEC */
+
+#endif /* SRC_EXEC_H_ */
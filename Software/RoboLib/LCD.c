@@ -12,6 +12,7 @@
 #include "McuSSD1306.h"
 #include "McuGDisplaySSD1306.h"
 #include "McuUtility.h"
+#include McuSSD1306_CONFIG_I2C_HEADER_FILE /* I2C driver of the display */
 #if PL_CONFIG_HAS_LCD_MENU
   #include "LCDMenu.h"
 #endif
@@ -27,6 +28,12 @@
 #if PL_CONFIG_HAS_PROXIMITY
   #include "Proximity.h"
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#if PL_CONFIG_HAS_SPAN
+  #include "Span.h"
+#endif
 #if PL_CONFIG_HAS_SUMO
   #include "Sumo.h"
 #endif
@@ -35,6 +42,18 @@
 #include "McuFontCour08Normal.h"
 #include "Event.h"
 
+#define LCD_USE_KEY_NOTIFICATION   (PL_CONFIG_HAS_LCD_MENU && EVNT_CONFIG_NOF_SUBSCRIBERS>0) /* key events wake up the task */
+#define LCD_NOTIFY_KEY             (1<<0) /* notification bit for the key events */
+#if defined(McuGenericI2C_CONFIG_USE_ON_ASYNC_READY_EVENT) && McuGenericI2C_CONFIG_USE_ASYNC && McuGenericI2C_CONFIG_USE_ON_ASYNC_READY_EVENT
+  #define LCD_USE_ASYNC_I2C        (1) /* the task starts the queued display transfers */
+#else
+  #define LCD_USE_ASYNC_I2C        (0) /* blocking transfers, or an I2C driver without them */
+#endif
+#define LCD_NOTIFY_I2C             (1<<1) /* notification bit for a queued I2C transfer */
+#define LCD_UPDATE_PERIOD_MS       (50)   /* screen update period */
+
+static TaskHandle_t LCD_taskHndl;
+
 #if PL_CONFIG_HAS_LCD_MENU
 
 #define GET_FONT()          McuFontHelv08Normal_GetFont()
@@ -70,6 +89,9 @@ typedef enum {
 #if PL_CONFIG_HAS_PROXIMITY
     LCD_MENU_ID_ROBOT_PROXIMITY,
 #endif
+#if PL_CONFIG_HAS_SPAN
+    LCD_MENU_ID_ROBOT_TIMING,
+#endif
 } LCD_MenuIDs;
 
 typedef enum {
@@ -96,6 +118,9 @@ typedef enum {
 #if PL_CONFIG_HAS_PROXIMITY
   ROBOT_MENU_POS_PROXIMITY,
 #endif
+#if PL_CONFIG_HAS_SPAN
+  ROBOT_MENU_POS_TIMING,
+#endif
 } RobotMenuPos_e;
 
 /* IDs for different screens with status information */
@@ -116,6 +141,9 @@ typedef enum {
 #if PL_CONFIG_HAS_SUMO
     LCD_MENU_SCREEN_SUMO,
 #endif
+#if PL_CONFIG_HAS_SPAN
+    LCD_MENU_SCREEN_TIMING,
+#endif
 } LCD_MenuScreenIDs;
 
 static LCD_MenuScreenIDs LCD_CurrentScreen = LCD_MENU_SCREEN_NONE;
@@ -199,10 +227,32 @@ static void ShowEncoderScreen(void) {
 
   McuUtility_strcpy(buf, sizeof(buf), (uint8_t*)"R: ");
   McuUtility_strcatNum32sFormatted(buf, sizeof(buf), QUAD_GetRightPos(), ' ', 8);
+#if PL_CONFIG_HAS_ODOMETRY
+  McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\n");
+#endif
   x = 2;
   McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+#if PL_CONFIG_HAS_ODOMETRY
+  {
+    ODO_Pose pose;
+
+    ODO_GetPose(&pose);
+    McuUtility_strcpy(buf, sizeof(buf), (uint8_t*)"x,y: ");
+    McuUtility_strcatNum32s(buf, sizeof(buf), pose.x);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)", ");
+    McuUtility_strcatNum32s(buf, sizeof(buf), pose.y);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)" mm\n");
+    x = 2;
+    McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+    McuUtility_strcpy(buf, sizeof(buf), (uint8_t*)"hdg: ");
+    McuUtility_strcatNum32s(buf, sizeof(buf), pose.heading/100);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)" deg");
+    x = 2;
+    McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+  }
+#endif
 
-  McuGDisplaySSD1306_UpdateFull();
+  McuGDisplaySSD1306_UpdateDirty();
 }
 #endif
 
@@ -210,8 +260,10 @@ static void ShowEncoderScreen(void) {
 static void ShowReflectanceScreen(void) {
   McuFontDisplay_PixelDim x, y;
   uint8_t buf[24];
+  REF_Snapshot ref;
   int i;
 
+  (void)REF_GetSnapshot(&ref, NULL);
   McuGDisplaySSD1306_Clear();
   McuGDisplaySSD1306_DrawBox(0, 0, McuGDisplaySSD1306_GetWidth(), McuGDisplaySSD1306_GetHeight(), 1, McuGDisplaySSD1306_COLOR_BLUE);
 
@@ -219,7 +271,7 @@ static void ShowReflectanceScreen(void) {
   McuFontDisplay_WriteString((uint8_t*)"Reflectance:\n", McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT());
   buf[0] = '\0';
   for(i=0;i<REF_NOF_SENSORS;i++) {
-    McuUtility_strcatNum16Hex(buf, sizeof(buf), REF_GetRawValue(i));
+    McuUtility_strcatNum16Hex(buf, sizeof(buf), ref.raw[i]);
     McuUtility_chcat(buf, sizeof(buf), ' ');
   }
   McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\n");
@@ -244,7 +296,7 @@ static void ShowReflectanceScreen(void) {
   x = 2;
   McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
 #endif
-  McuGDisplaySSD1306_UpdateFull();
+  McuGDisplaySSD1306_UpdateDirty();
 }
 #endif
 
@@ -298,7 +350,7 @@ static void ShowLineCalibrateScreen(void) {
   x = 2;
   McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
 #endif
-  McuGDisplaySSD1306_UpdateFull();
+  McuGDisplaySSD1306_UpdateDirty();
 }
 #endif
 
@@ -351,15 +403,18 @@ static void ShowProxDataGraph(McuFontDisplay_PixelDim x, McuFontDisplay_PixelDim
 static void ShowProximityScreen(void) {
   McuFontDisplay_PixelDim x, y;
   uint8_t buf[32];
+  PROX_Result prox;
   int i;
+
+  (void)PROX_GetResult(&prox, NULL); /* use one consistent measurement for the whole screen */
   McuGDisplaySSD1306_Clear();
   McuGDisplaySSD1306_DrawBox(0, 0, McuGDisplaySSD1306_GetWidth(), McuGDisplaySSD1306_GetHeight(), 1, McuGDisplaySSD1306_COLOR_BLUE);
 
   x = 2; y = 2;
   McuFontDisplay_WriteString((uint8_t*)"Proximity:\n", McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT());
-  if (PROX_HasTarget()) {
+  if (prox.proximityFound) {
     McuUtility_strcpy(buf, sizeof(buf), (uint8_t*)"Target: yes, at ");
-    McuUtility_strcatNum32s(buf, sizeof(buf), PROX_GetTargetAngle());
+    McuUtility_strcatNum32s(buf, sizeof(buf), prox.proximityAngle);
     McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\n");
   } else {
     McuUtility_strcpy(buf, sizeof(buf), (uint8_t*)"Target: no\n");
@@ -371,24 +426,24 @@ static void ShowProximityScreen(void) {
   McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
 
   McuUtility_strcpy(buf, sizeof(buf), (uint8_t*)"L#: ");
-  McuUtility_strcatNum8u(buf, sizeof(buf), PROX_GetNofWithLeftLeds(0));
+  McuUtility_strcatNum8u(buf, sizeof(buf), prox.countsLeft[0]);
   McuUtility_strcat(buf, sizeof(buf), (uint8_t*)", ");
-  McuUtility_strcatNum8u(buf, sizeof(buf), PROX_GetNofWithLeftLeds(1));
+  McuUtility_strcatNum8u(buf, sizeof(buf), prox.countsLeft[1]);
   McuUtility_strcat(buf, sizeof(buf), (uint8_t*)", ");
-  McuUtility_strcatNum8u(buf, sizeof(buf), PROX_GetNofWithLeftLeds(2));
+  McuUtility_strcatNum8u(buf, sizeof(buf), prox.countsLeft[2]);
   McuUtility_strcat(buf, sizeof(buf), (uint8_t*)" R#: ");
-  McuUtility_strcatNum8u(buf, sizeof(buf), PROX_GetNofWithRightLeds(0));
+  McuUtility_strcatNum8u(buf, sizeof(buf), prox.countsRight[0]);
   McuUtility_strcat(buf, sizeof(buf), (uint8_t*)", ");
-  McuUtility_strcatNum8u(buf, sizeof(buf), PROX_GetNofWithRightLeds(1));
+  McuUtility_strcatNum8u(buf, sizeof(buf), prox.countsRight[1]);
   McuUtility_strcat(buf, sizeof(buf), (uint8_t*)", ");
-  McuUtility_strcatNum8u(buf, sizeof(buf), PROX_GetNofWithRightLeds(2));
+  McuUtility_strcatNum8u(buf, sizeof(buf), prox.countsRight[2]);
   McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\n");
   x = 2;
   McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
 
   ShowProxDataGraph(x, y);
 
-  McuGDisplaySSD1306_UpdateFull();
+  McuGDisplaySSD1306_UpdateDirty();
 }
 #endif
 
@@ -421,7 +476,40 @@ static void ShowSumoScreen(void) {
   x = 2;
   ShowProxDataGraph(x, y);
 #endif
-  McuGDisplaySSD1306_UpdateFull();
+  McuGDisplaySSD1306_UpdateDirty();
+}
+#endif
+
+#if PL_CONFIG_HAS_SPAN
+static void ShowTimingScreen(void) {
+  McuFontDisplay_PixelDim x, y, h;
+  uint8_t buf[24];
+  SPAN_Stats stats;
+  int i;
+
+  McuGDisplaySSD1306_Clear();
+  McuGDisplaySSD1306_DrawBox(0, 0, McuGDisplaySSD1306_GetWidth(), McuGDisplaySSD1306_GetHeight(), 1, McuGDisplaySSD1306_COLOR_BLUE);
+
+  x = 2; y = 2;
+  McuFontDisplay_WriteString((uint8_t*)"Timing (mean/max us):\n", McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT());
+#if LCDMENU_CONFIG_LCD_HEADER_HEIGHT>0
+  y = LCDMENU_CONFIG_LCD_HEADER_HEIGHT;
+#endif
+  h = McuFontDisplay_GetStringHeight((uint8_t*)"X", GET_FONT_FIXED(), NULL);
+  for(i=0; i<SPAN_NOF_IDS && y+h<=McuGDisplaySSD1306_GetHeight(); i++) { /* as many as fit on the display */
+    if (!SPAN_GetStats((SPAN_Id)i, &stats)) {
+      continue;
+    }
+    McuUtility_strcpy(buf, sizeof(buf), SPAN_GetName((SPAN_Id)i));
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)": ");
+    McuUtility_strcatNum32u(buf, sizeof(buf), stats.meanNs/1000);
+    McuUtility_chcat(buf, sizeof(buf), '/');
+    McuUtility_strcatNum32u(buf, sizeof(buf), stats.maxNs/1000);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\n");
+    x = 2;
+    McuFontDisplay_WriteString(buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+  }
+  McuGDisplaySSD1306_UpdateDirty();
 }
 #endif
 
@@ -465,6 +553,16 @@ static LCDMenu_StatusFlags RobotMenuHandler(const struct LCDMenu_MenuItem_ *item
         LCD_CurrentScreen = LCD_MENU_SCREEN_PROXIMITY;
     }
 #endif
+#if PL_CONFIG_HAS_SPAN
+    if (item->id==LCD_MENU_ID_ROBOT_TIMING) {
+        flags |= LCDMENU_STATUS_FLAGS_HANDLED;
+      #if LCD_USE_ENCODER_AS_INPUT
+        LCD_useEncoderForMenuNavigation = FALSE;
+      #endif
+        ShowTimingScreen();
+        LCD_CurrentScreen = LCD_MENU_SCREEN_TIMING;
+    }
+#endif
 #if PL_CONFIG_HAS_LINE
     if (item->id==LCD_MENU_ID_ROBOT_CALIBRATE) {
     #if LCD_USE_ENCODER_AS_INPUT
@@ -571,6 +669,9 @@ static const LCDMenu_MenuItem menus[] =
 #if PL_CONFIG_HAS_PROXIMITY
       {LCD_MENU_ID_ROBOT_PROXIMITY,   LCD_MENU_GRP_ID_ROBOT,     ROBOT_MENU_POS_PROXIMITY,        LCD_MENU_ID_NONE,         LCD_MENU_ID_NONE,                "Proximity",    RobotMenuHandler,             LCDMENU_MENU_FLAGS_NONE},
 #endif
+#if PL_CONFIG_HAS_SPAN
+      {LCD_MENU_ID_ROBOT_TIMING,      LCD_MENU_GRP_ID_ROBOT,     ROBOT_MENU_POS_TIMING,           LCD_MENU_ID_NONE,         LCD_MENU_ID_NONE,                "Timing",       RobotMenuHandler,             LCDMENU_MENU_FLAGS_NONE},
+#endif
 };
 
 static void OnLCDExitScreen(void) {
@@ -597,6 +698,44 @@ static void OnLCDExitScreen(void) {
 
 #endif /* PL_CONFIG_HAS_LCD_MENU */
 
+#if LCD_USE_ASYNC_I2C
+void LCD_OnI2CReady(void) {
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  if (LCD_taskHndl!=NULL) {
+    (void)xTaskNotifyFromISR(LCD_taskHndl, LCD_NOTIFY_I2C, eSetBits, &higherPriorityTaskWoken);
+  }
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+#endif
+
+#if LCD_USE_KEY_NOTIFICATION || LCD_USE_ASYNC_I2C
+/* waits for the next screen update, starting the queued display transfers in between */
+static void LCD_WaitUpdate(void) {
+  TickType_t start = xTaskGetTickCount(), elapsed;
+  uint32_t bits;
+
+  for(;;) {
+    elapsed = xTaskGetTickCount()-start;
+    if (elapsed>=pdMS_TO_TICKS(LCD_UPDATE_PERIOD_MS)) {
+      return;
+    }
+    bits = 0;
+    if (xTaskNotifyWait(0UL, LCD_NOTIFY_KEY|LCD_NOTIFY_I2C, &bits, pdMS_TO_TICKS(LCD_UPDATE_PERIOD_MS)-elapsed)!=pdTRUE) {
+      return; /* timeout */
+    }
+  #if LCD_USE_ASYNC_I2C
+    if (bits&LCD_NOTIFY_I2C) {
+      McuGenericI2C_ProcessAsync();
+    }
+  #endif
+    if (bits&LCD_NOTIFY_KEY) {
+      return; /* update now */
+    }
+  }
+}
+#endif
+
 static void LCD_Task(void *param) {
   (void)param; /* not used */
 #if LCD_USE_ENCODER_AS_INPUT
@@ -615,6 +754,7 @@ static void LCD_Task(void *param) {
   lastCntrRight = cntrRight = QUAD_GetRightPos();
 #endif
   for(;;) {
+    McuGDisplaySSD1306_GetDisplay(); /* once for the frame: the drawing functions below only nest into it */
 #if PL_CONFIG_HAS_LCD_MENU
   #if LCD_USE_ENCODER_AS_INPUT
     /* handling encoder/wheels as input device */
@@ -686,20 +826,35 @@ static void LCD_Task(void *param) {
       ShowSumoScreen();
     }
 #endif
+#if PL_CONFIG_HAS_SPAN
+    if (LCD_CurrentScreen==LCD_MENU_SCREEN_TIMING) {
+      ShowTimingScreen();
+    }
+#endif
 #if PL_CONFIG_HAS_LINE
     if (LCD_CurrentScreen==LCD_MENU_SCREEN_LINE_CALIBRATE) {
       ShowLineCalibrateScreen();
     }
 #endif
 #endif /* PL_CONFIG_HAS_LCD_MENU */
-    vTaskDelay(pdMS_TO_TICKS(50));
+    McuGDisplaySSD1306_GiveDisplay();
+#if LCD_USE_KEY_NOTIFICATION || LCD_USE_ASYNC_I2C
+    LCD_WaitUpdate(); /* screen update period, or earlier for a key */
+#else
+    vTaskDelay(pdMS_TO_TICKS(LCD_UPDATE_PERIOD_MS));
+#endif
   } /* for */
 }
 
 void LCD_Init(void) {
   McuSSD1306_Clear();
-  if (xTaskCreate(LCD_Task, "LCD", 600/sizeof(StackType_t), NULL, tskIDLE_PRIORITY, NULL) != pdPASS) {
+  if (xTaskCreate(LCD_Task, "LCD", 600/sizeof(StackType_t), NULL, tskIDLE_PRIORITY, &LCD_taskHndl) != pdPASS) {
     for(;;){} /* error! probably out of memory */
   }
+#if LCD_USE_KEY_NOTIFICATION
+  (void)EVNT_Subscribe(EVNT_SW1_RELEASED, LCD_taskHndl, LCD_NOTIFY_KEY);
+  (void)EVNT_Subscribe(EVNT_SW1_LRELEASED, LCD_taskHndl, LCD_NOTIFY_KEY);
+  (void)EVNT_Subscribe(EVNT_SW1_LLRELEASED, LCD_taskHndl, LCD_NOTIFY_KEY);
+#endif
 }
 #endif /* PL_CONFIG_HAS_LCD */
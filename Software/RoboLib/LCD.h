@@ -9,6 +9,11 @@
 #ifndef SRC_LCD_H_
 #define SRC_LCD_H_
 
+/*!
+ * \brief Called from the I2C interrupt if a queued display transfer waits to be started: the LCD task starts it.
+ */
+void LCD_OnI2CReady(void);
+
 /*! \brief LCD Driver initialization */
 void LCD_Init(void);
 
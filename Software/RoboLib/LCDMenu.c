@@ -188,7 +188,7 @@ static void LCDMenu_Draw(void) {
     }
     pos++;
   }
-  McuGDisplaySSD1306_UpdateFull();
+  McuGDisplaySSD1306_UpdateDirty();
 }
 
 static void LCDMenu_CursorUp(void) {
@@ -4,11 +4,18 @@
  * \author Erich Styger, erich.styger@hslu.ch
  *
  * This module implements the driver a line sensor based on the IR reflectance sensor.
+ * The state machine runs in the sensor cycle, so the calibration is stored to the flash by a
+ * task with a low priority: erasing a page takes longer than a cycle.
  */
 
 #include "Platform.h"
 #if PL_CONFIG_HAS_LINE
 #include "Reflectance.h"
+#include "Span.h"
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+  #include <string.h>
+#endif
 
 #define LINE_USE_WHITE_LINE     (0)
 #define LINE_MIN_NOISE_VAL      0x20   /* values below this are not added to the weighted sum */
@@ -22,7 +29,6 @@ typedef enum {
   LINE_STATE_START_CALIBRATION,
   LINE_STATE_CALIBRATING,
   LINE_STATE_STOP_CALIBRATION,
-  LINE_STATE_SAVE_CALIBRATION,
   LINE_STATE_READY
 } lineStateType;
 
@@ -36,6 +42,16 @@ typedef struct {
 
 static REF_SensorVal_t   SensorValues; /* values from calibration */
 
+#if PL_CONFIG_HAS_CONFIG_NVM
+typedef struct {
+  REF_SensorTimeType minVal[REF_NOF_SENSORS];
+  REF_SensorTimeType maxVal[REF_NOF_SENSORS];
+} LINE_CalibData; /* calibration values stored in the flash */
+
+static LINE_CalibData LINE_saveData; /* handed over to the save task */
+static TaskHandle_t LINE_saveTaskHndl;
+#endif
+
 REF_SensorTimeType LINE_Get1kValue(unsigned int idx) {
   if (idx<REF_NOF_SENSORS) {
     return SensorValues.oneKVal[idx];
@@ -160,17 +176,22 @@ static void LINE_CalcLineValue(void) {
 void LINE_StateMachine(void) {
   int i;
 
+  SPAN_BEGIN(SPAN_ID_LINE_STATE);
   switch (lineState) {
     case LINE_STATE_INIT:
     #if PL_CONFIG_HAS_CONFIG_NVM
     {
-      SensorCalibT *ptr;
-
-      ptr = (SensorCalibT*)NVMC_GetReflectanceData();
-      if (ptr!=NULL) { /* valid data */
-        SensorCalibMinMax = *ptr; /* struct copy */
+      const LINE_CalibData *calib;
+      size_t size;
+
+      calib = NVMC_Get(NVMC_KEY_REFLECTANCE, &size);
+      if (calib!=NULL && size==sizeof(LINE_CalibData)) { /* valid data, no need to calibrate */
+        memcpy(SensorValues.minVal, calib->minVal, sizeof(SensorValues.minVal));
+        memcpy(SensorValues.maxVal, calib->maxVal, sizeof(SensorValues.maxVal));
+        McuShell_SendStr((unsigned char*)"INFO: Using stored calibration data.\r\n", McuShell_GetStdio()->stdOut);
         lineState = LINE_STATE_READY;
       } else {
+        McuShell_SendStr((unsigned char*)"INFO: No calibration data present.\r\n", McuShell_GetStdio()->stdOut);
         lineState = LINE_STATE_NOT_CALIBRATED;
       }
     }
@@ -207,11 +228,11 @@ void LINE_StateMachine(void) {
     case LINE_STATE_STOP_CALIBRATION:
       McuShell_SendStr((unsigned char*)"...stopped calibration.\r\n", McuShell_GetStdio()->stdOut);
 #if PL_CONFIG_HAS_CONFIG_NVM
-      if (NVMC_SaveReflectanceData(&SensorCalibMinMax, sizeof(SensorCalibMinMax))!=ERR_OK) {
-        SHELL_SendString((unsigned char*)"Flashing calibration data FAILED!\r\n");
-      } else {
-        SHELL_SendString((unsigned char*)"Stored calibration data.\r\n");
-      }
+      taskENTER_CRITICAL(); /* the save task can run in between */
+      memcpy(LINE_saveData.minVal, SensorValues.minVal, sizeof(LINE_saveData.minVal));
+      memcpy(LINE_saveData.maxVal, SensorValues.maxVal, sizeof(LINE_saveData.maxVal));
+      taskEXIT_CRITICAL();
+      (void)xTaskNotifyGive(LINE_saveTaskHndl);
 #endif
       lineState = LINE_STATE_READY;
       break;
@@ -223,6 +244,7 @@ void LINE_StateMachine(void) {
       }
       break;
   } /* switch */
+  SPAN_END(SPAN_ID_LINE_STATE);
 }
 
 #if PL_CONFIG_HAS_SHELL
@@ -233,7 +255,6 @@ static unsigned char*GetStateString(void) {
     case LINE_STATE_START_CALIBRATION:   return (unsigned char*)"START CALIBRATION";
     case LINE_STATE_CALIBRATING:         return (unsigned char*)"CALIBRATING";
     case LINE_STATE_STOP_CALIBRATION:    return (unsigned char*)"STOP CALIBRATION";
-    case LINE_STATE_SAVE_CALIBRATION:    return (unsigned char*)"SAVE CALIBRATION";
     case LINE_STATE_READY:               return (unsigned char*)"READY";
     default:
       break;
@@ -243,7 +264,7 @@ static unsigned char*GetStateString(void) {
 #endif
 
 #if PL_CONFIG_HAS_SHELL
-static uint8_t PrintStatus(const McuShell_StdIOType *io) {
+static void PrintStatus(const McuShell_StdIOType *io) {
   unsigned char buf[32];
   int i;
 
@@ -298,42 +319,60 @@ static uint8_t PrintStatus(const McuShell_StdIOType *io) {
   buf[0] = '\0'; McuUtility_strcatNum16s(buf, sizeof(buf), LINE_linePos);
   McuShell_SendStr(buf, io->stdOut);
   McuShell_SendStr((unsigned char*)"\r\n", io->stdOut);
+}
 
+static void PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((const unsigned char*)"line", (const unsigned char*)"Line command group\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  calib (start|stop)", (unsigned char*)"Start/Stop calibration\r\n", io->stdOut);
+}
+
+static uint8_t CmdCalibStart(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  if (lineState==LINE_STATE_NOT_CALIBRATED || lineState==LINE_STATE_READY) {
+    LINE_CalibrateStartStop();
+  } else {
+    McuShell_SendStr((unsigned char*)"ERROR: cannot start calibration, must not be calibrating or be ready.\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
   return ERR_OK;
 }
 
-uint8_t LINE_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-    uint8_t res=ERR_OK;
-    uint8_t buf[24];
-
-    if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_HELP)==0 || McuUtility_strcmp((const char *)cmd, "line help")==0) {
-      McuShell_SendHelpStr((const unsigned char*)"line", (const unsigned char*)"Line command group\r\n", io->stdOut);
-      McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
-      McuShell_SendHelpStr((const unsigned char*)"  calib (start|stop)", (unsigned char*)"Start/Stop calibration\r\n", io->stdOut);
-      *handled = TRUE;
-    } else if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_STATUS)==0 || McuUtility_strcmp((const char*)cmd, "line status")==0) {
-      *handled = TRUE;
-      return PrintStatus(io);
-    } else if (McuUtility_strcmp((char*)cmd, "line calib start")==0) {
-      if (lineState==LINE_STATE_NOT_CALIBRATED || lineState==LINE_STATE_READY) {
-        LINE_CalibrateStartStop();
-      } else {
-        McuShell_SendStr((unsigned char*)"ERROR: cannot start calibration, must not be calibrating or be ready.\r\n", io->stdErr);
-        return ERR_FAILED;
-      }
-      *handled = TRUE;
-      return ERR_OK;
-    } else if (McuUtility_strcmp((char*)cmd, "line calib stop")==0) {
-      if (lineState==LINE_STATE_CALIBRATING) {
-        LINE_CalibrateStartStop();
-      } else {
-        McuShell_SendStr((unsigned char*)"ERROR: can only stop if calibrating.\r\n", io->stdErr);
-        return ERR_FAILED;
-      }
-      *handled = TRUE;
-      return ERR_OK;
+static uint8_t CmdCalibStop(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  if (lineState==LINE_STATE_CALIBRATING) {
+    LINE_CalibrateStartStop();
+  } else {
+    McuShell_SendStr((unsigned char*)"ERROR: can only stop if calibrating.\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return ERR_OK;
+}
+
+static const CMD_Command LINE_Cmds[] = {
+  {"calib start", "", CmdCalibStart},
+  {"calib stop",  "", CmdCalibStop},
+};
+
+const CMD_Group LINE_CmdGroup = CMD_GROUP("line", PrintHelp, PrintStatus, LINE_Cmds);
+#endif
+
+#if PL_CONFIG_HAS_CONFIG_NVM
+static void LineSaveTask(void *pvParameters) {
+  LINE_CalibData calib;
+
+  (void)pvParameters; /* not used */
+  for(;;) {
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    taskENTER_CRITICAL();
+    calib = LINE_saveData;
+    taskEXIT_CRITICAL();
+    if (NVMC_Save(NVMC_KEY_REFLECTANCE, &calib, sizeof(calib))!=ERR_OK) {
+      McuShell_SendStr((unsigned char*)"Flashing calibration data FAILED!\r\n", McuShell_GetStdio()->stdErr);
+    } else {
+      McuShell_SendStr((unsigned char*)"Stored calibration data.\r\n", McuShell_GetStdio()->stdOut);
     }
-    return res;
+  }
 }
 #endif
 
@@ -346,6 +385,11 @@ void LINE_Init(void) {
   }
   (void)xSemaphoreTake(LINE_StartStopCalibSem, 0); /* empty token */
   vQueueAddToRegistry(LINE_StartStopCalibSem, "LineStartStopCalibSem");
+#if PL_CONFIG_HAS_CONFIG_NVM
+  if (xTaskCreate(LineSaveTask, "LineSave", 400/sizeof(StackType_t), NULL, tskIDLE_PRIORITY, &LINE_saveTaskHndl) != pdPASS) {
+    for(;;){} /* error */
+  }
+#endif
 }
 
 #endif /* PL_CONFIG_HAS_LINE */
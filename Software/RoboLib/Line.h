@@ -16,15 +16,9 @@
 #include <stdbool.h>
 
 #if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
-/*!
- * \brief Parses a command
- * \param cmd Command string to be parsed
- * \param handled Sets this variable to TRUE if command was handled
- * \param io I/O stream to be used for input/output
- * \return Error code, ERR_OK if everything was fine
- */
-uint8_t LINE_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the line sensor, registered in Shell.c */
+extern const CMD_Group LINE_CmdGroup;
 #endif
 
 uint16_t LINE_GetLinePos(void);
@@ -34,7 +34,7 @@ void McuRTOS_vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName
 void McuRTOS_vApplicationTickHook(void)
 {
   /* Called for every RTOS tick (configTICK_RATE_HZ). */
-#if PL_CONFIG_HAS_MOTOR_TACHO
+#if PL_CONFIG_HAS_MOTOR_TACHO && !PL_CONFIG_HAS_EXEC /* the executive samples it first in its cycle */
   TACHO_Sample();
 #endif
 #if PL_CONFIG_HAS_TRIGGER
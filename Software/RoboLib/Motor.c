@@ -14,6 +14,7 @@
 #include "PWMR.h"
 #include "PWML.h"
 #include "McuUtility.h"
+#include "McuArmTools.h"
 
 #define MOTOR_PWM_IS_LOW_ACTIVE  (0)
 
@@ -103,6 +104,10 @@ void MOT_ChangeSpeedPercent(MOT_MotorDevice *motor, MOT_SpeedPercent relPercent)
 }
 
 void MOT_SetDirection(MOT_MotorDevice *motor, MOT_Direction dir) {
+  if (dir==MOT_DIR_BACKWARD && motor->currDir!=MOT_DIR_BACKWARD) { /* reversing, also for the PID paths which only set the direction */
+    motor->reverseCycles = McuArmTools_GetCycleCounter();
+  }
+  motor->currDir = dir;
   if (dir==MOT_DIR_FORWARD ) {
 #if MOTOR_HAS_INVERT
     motor->DirPutVal(motor->inverted?0:1);
@@ -124,6 +129,10 @@ void MOT_SetDirection(MOT_MotorDevice *motor, MOT_Direction dir) {
   }
 }
 
+uint32_t MOT_GetReverseCycles(MOT_MotorDevice *motor) {
+  return motor->reverseCycles;
+}
+
 MOT_Direction MOT_GetDirection(MOT_MotorDevice *motor) {
   if (motor->currSpeedPercent<0) {
     return MOT_DIR_BACKWARD;
@@ -164,50 +173,57 @@ static void MOT_PrintStatus(const McuShell_StdIOType *io) {
   McuShell_SendStr((unsigned char*)"\r\n", io->stdOut);
 }
 
-uint8_t MOT_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-  uint8_t res = ERR_OK;
-  int32_t val;
-  const unsigned char *p;
-
-  if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_HELP)==0 || McuUtility_strcmp((char*)cmd, (char*)"motor help")==0) {
-    MOT_PrintHelp(io);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_STATUS)==0 || McuUtility_strcmp((char*)cmd, (char*)"motor status")==0) {
-    MOT_PrintStatus(io);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)"motor L forward")==0) {
-    MOT_SetDirection(&motorL, MOT_DIR_FORWARD);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)"motor R forward")==0) {
-    MOT_SetDirection(&motorR, MOT_DIR_FORWARD);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)"motor L backward")==0) {
-    MOT_SetDirection(&motorL, MOT_DIR_BACKWARD);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)"motor R backward")==0) {
-    MOT_SetDirection(&motorR, MOT_DIR_BACKWARD);
-    *handled = TRUE;
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"motor L duty ", sizeof("motor L duty ")-1)==0) {
-    p = cmd+sizeof("motor L duty");
-    if (McuUtility_xatoi(&p, &val)==ERR_OK && val >=-100 && val<=100) {
-      MOT_SetSpeedPercent(&motorL, (MOT_SpeedPercent)val);
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument, must be in the range -100..100\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"motor R duty ", sizeof("motor R duty ")-1)==0) {
-    p = cmd+sizeof("motor R duty");
-    if (McuUtility_xatoi(&p, &val)==ERR_OK && val >=-100 && val<=100) {
-      MOT_SetSpeedPercent(&motorR, (MOT_SpeedPercent)val);
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument, must be in the range -100..100\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
+static uint8_t MOT_SetDuty(MOT_MotorDevice *motor, const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (args[0].i<-100 || args[0].i>100) {
+    McuShell_SendStr((unsigned char*)"Wrong argument, must be in the range -100..100\r\n", io->stdErr);
+    return ERR_FAILED;
   }
-  return res;
+  MOT_SetSpeedPercent(motor, (MOT_SpeedPercent)args[0].i);
+  return ERR_OK;
 }
+
+static uint8_t MOT_CmdLeftForward(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  MOT_SetDirection(&motorL, MOT_DIR_FORWARD);
+  return ERR_OK;
+}
+
+static uint8_t MOT_CmdLeftBackward(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  MOT_SetDirection(&motorL, MOT_DIR_BACKWARD);
+  return ERR_OK;
+}
+
+static uint8_t MOT_CmdLeftDuty(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  return MOT_SetDuty(&motorL, args, io);
+}
+
+static uint8_t MOT_CmdRightForward(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  MOT_SetDirection(&motorR, MOT_DIR_FORWARD);
+  return ERR_OK;
+}
+
+static uint8_t MOT_CmdRightBackward(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  MOT_SetDirection(&motorR, MOT_DIR_BACKWARD);
+  return ERR_OK;
+}
+
+static uint8_t MOT_CmdRightDuty(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  return MOT_SetDuty(&motorR, args, io);
+}
+
+static const CMD_Command MOT_Cmds[] = {
+  {"L forward",  "",  MOT_CmdLeftForward},
+  {"L backward", "",  MOT_CmdLeftBackward},
+  {"L duty",     "i", MOT_CmdLeftDuty},
+  {"R forward",  "",  MOT_CmdRightForward},
+  {"R backward", "",  MOT_CmdRightBackward},
+  {"R duty",     "i", MOT_CmdRightDuty},
+};
+
+const CMD_Group MOT_CmdGroup = CMD_GROUP("motor", MOT_PrintHelp, MOT_PrintStatus, MOT_Cmds);
 #endif /* PL_CONFIG_HAS_SHELL */
 
 void MOT_Deinit(void) {
@@ -223,6 +239,8 @@ void MOT_Init(void) {
   motorR.DirPutVal = DirRPutVal;
   motorL.SetRatio16 = PWMLSetRatio16;
   motorR.SetRatio16 = PWMRSetRatio16;
+  motorL.currDir = MOT_DIR_FORWARD;
+  motorR.currDir = MOT_DIR_FORWARD;
   MOT_SetSpeedPercent(&motorL, 0);
   MOT_SetSpeedPercent(&motorR, 0);
   (void)PWML_Enable();
@@ -27,6 +27,8 @@ typedef struct MOT_MotorDevice_ {
 #endif
   MOT_SpeedPercent currSpeedPercent; /*!< our current speed in %, negative percent means backward */
   uint16_t currPWMvalue; /*!< current PWM value used */
+  MOT_Direction currDir; /*!< direction set with MOT_SetDirection() */
+  uint32_t reverseCycles; /*!< cycle counter value when the motor has been switched to backward the last time */
   uint8_t (*SetRatio16)(uint16_t); /*!< function to set the ratio */
   void (*DirPutVal)(bool); /*!< function to set direction bit */
 } MOT_MotorDevice;
@@ -102,15 +104,17 @@ void MOT_SetDirection(MOT_MotorDevice *motor, MOT_Direction dir);
  */
 MOT_Direction MOT_GetDirection(MOT_MotorDevice *motor);
 
-#if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
 /*!
- * \brief Shell command line parser.
- * \param[in] cmd Pointer to command string
- * \param[out] handled If command is handled by the parser
- * \param[in] io Std I/O handler of shell
+ * \brief Returns the time when the motor has been switched to backward, e.g. to measure reaction times.
+ * \param[in] motor Motor handle
+ * \return Cycle counter value of the last direction change to backward, by MOT_SetSpeedPercent() or MOT_SetDirection()
  */
-uint8_t MOT_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+uint32_t MOT_GetReverseCycles(MOT_MotorDevice *motor);
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the motors, registered in Shell.c */
+extern const CMD_Group MOT_CmdGroup;
 #endif /* PL_CONFIG_HAS_SHELL */
 
 /*!
@@ -0,0 +1,428 @@
+/**
+ * \file
+ * \brief Non-volatile configuration storage
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Layout of a page: a page header, followed by the records appended one after each other.
+ * A record is a record header with the key, the size, the CRC and the commit marker, followed by
+ * the data padded to 4 bytes. The commit marker of a record and the magic of a page header are
+ * programmed last, so a record or a page is only used once it has been completely written.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_CONFIG_NVM
+#include "NVM_Config.h"
+#include <string.h>
+#if PL_CONFIG_USE_FREERTOS
+  #include "McuRTOS.h"
+#endif
+#if NVMC_CONFIG_USE_HAL_FLASH
+  #include "stm32f3xx_hal.h"
+#endif
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+  #include "McuUtility.h"
+#endif
+
+#if NVMC_CONFIG_NOF_PAGES<2
+  #error "need at least two pages to copy the records"
+#endif
+
+#define NVMC_PAGE_MAGIC       (0x4E56) /* 'NV', programmed last if a page becomes the active one */
+#define NVMC_PAGE_LAYOUT      (1)      /* version of the record layout */
+#define NVMC_RECORD_COMMIT    (0x5AA5) /* programmed last if a record is complete */
+#define NVMC_ERASED_16        (0xFFFF)
+#define NVMC_NO_PAGE          (0xFF)
+
+#define NVMC_ALIGN4(size)     (((size)+3u)&~3u)
+#define NVMC_PAGE_ADDR(page)  ((uintptr_t)(NVMC_CONFIG_FLASH_START_ADDR)+(uintptr_t)(page)*NVMC_CONFIG_PAGE_SIZE)
+
+typedef struct {
+  uint16_t magic;   /* NVMC_PAGE_MAGIC if the page is valid */
+  uint16_t layout;  /* NVMC_PAGE_LAYOUT */
+  uint16_t seqLow;  /* sequence number, the valid page with the highest number is the active one */
+  uint16_t seqHigh;
+} NVMC_PageHeader;
+
+typedef struct {
+  uint16_t key;     /* NVMC_Key, NVMC_ERASED_16 is the end of the records */
+  uint16_t size;    /* number of data bytes following the header */
+  uint16_t crc;     /* CRC-16 over key, size and data */
+  uint16_t commit;  /* NVMC_RECORD_COMMIT if the record is complete */
+} NVMC_RecordHeader;
+
+static uint8_t NVMC_activePage = NVMC_NO_PAGE; /* page with the records, NVMC_NO_PAGE if nothing is stored */
+static uint32_t NVMC_activeSeq; /* sequence number of the active page */
+static size_t NVMC_writeOffset; /* offset of the next record in the active page */
+static bool NVMC_tailDirty; /* the area after the last record is not erased (e.g. power failure while writing), next record needs a new page */
+static const NVMC_RecordHeader *NVMC_records[NVMC_KEY_NOF]; /* latest record of each key, NULL if not stored */
+#if PL_CONFIG_USE_FREERTOS
+static xSemaphoreHandle NVMC_mutex; /* serializes the writes */
+#endif
+
+#if NVMC_CONFIG_USE_HAL_FLASH
+static uint8_t NVMC_ErasePage(uintptr_t pageAddr) {
+  FLASH_EraseInitTypeDef erase;
+  uint32_t pageError;
+  HAL_StatusTypeDef status;
+
+  erase.TypeErase = FLASH_TYPEERASE_PAGES;
+  erase.PageAddress = pageAddr;
+  erase.NbPages = 1;
+  (void)HAL_FLASH_Unlock();
+  status = HAL_FLASHEx_Erase(&erase, &pageError);
+  (void)HAL_FLASH_Lock();
+  return status==HAL_OK ? ERR_OK : ERR_FAILED;
+}
+
+static uint8_t NVMC_ProgramHalfWord(uintptr_t addr, uint16_t data) {
+  HAL_StatusTypeDef status;
+
+  (void)HAL_FLASH_Unlock();
+  status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, addr, data);
+  (void)HAL_FLASH_Lock();
+  return status==HAL_OK ? ERR_OK : ERR_FAILED;
+}
+#else
+  #define NVMC_ErasePage(pageAddr)          NVMC_OnErasePage(pageAddr)
+  #define NVMC_ProgramHalfWord(addr, data)  NVMC_OnProgramHalfWord(addr, data)
+#endif
+
+/* CRC-16/CCITT */
+static uint16_t NVMC_Crc16(uint16_t crc, const uint8_t *data, size_t size) {
+  int i;
+
+  while(size>0) {
+    crc ^= (uint16_t)(*data<<8);
+    for(i=0; i<8; i++) {
+      if (crc&0x8000) {
+        crc = (uint16_t)((crc<<1)^0x1021);
+      } else {
+        crc = (uint16_t)(crc<<1);
+      }
+    }
+    data++;
+    size--;
+  }
+  return crc;
+}
+
+static uint16_t NVMC_RecordCrc(uint16_t key, uint16_t size, const uint8_t *data) {
+  uint8_t hdr[4];
+
+  hdr[0] = (uint8_t)key; hdr[1] = (uint8_t)(key>>8);
+  hdr[2] = (uint8_t)size; hdr[3] = (uint8_t)(size>>8);
+  return NVMC_Crc16(NVMC_Crc16(0xFFFF, hdr, sizeof(hdr)), data, size);
+}
+
+static bool NVMC_IsErased(uintptr_t addr, size_t size) {
+  const uint32_t *p = (const uint32_t*)addr; /* addr and size are 4 byte aligned */
+
+  while(size>0) {
+    if (*p!=0xFFFFFFFFu) {
+      return FALSE;
+    }
+    p++;
+    size -= sizeof(uint32_t);
+  }
+  return TRUE;
+}
+
+static uint32_t NVMC_PageSeq(const NVMC_PageHeader *hdr) {
+  return ((uint32_t)hdr->seqHigh<<16)|hdr->seqLow;
+}
+
+static bool NVMC_IsValidPage(const NVMC_PageHeader *hdr) {
+  return hdr->magic==NVMC_PAGE_MAGIC && hdr->layout==NVMC_PAGE_LAYOUT;
+}
+
+/* Programs a record at addr, which needs to be erased. The commit marker is programmed last. */
+static uint8_t NVMC_WriteRecord(uintptr_t addr, uint16_t key, const uint8_t *data, uint16_t size) {
+  uintptr_t p;
+  uint16_t i, val;
+
+  if (NVMC_ProgramHalfWord(addr+offsetof(NVMC_RecordHeader, key), key)!=ERR_OK) {
+    return ERR_FAILED;
+  }
+  if (NVMC_ProgramHalfWord(addr+offsetof(NVMC_RecordHeader, size), size)!=ERR_OK) {
+    return ERR_FAILED;
+  }
+  if (NVMC_ProgramHalfWord(addr+offsetof(NVMC_RecordHeader, crc), NVMC_RecordCrc(key, size, data))!=ERR_OK) {
+    return ERR_FAILED;
+  }
+  p = addr+sizeof(NVMC_RecordHeader);
+  for(i=0; i<size; i+=2) {
+    val = data[i];
+    if (i+1<size) {
+      val |= (uint16_t)(data[i+1]<<8);
+    } else {
+      val |= 0xFF00; /* padding */
+    }
+    if (NVMC_ProgramHalfWord(p+i, val)!=ERR_OK) {
+      return ERR_FAILED;
+    }
+  }
+  return NVMC_ProgramHalfWord(addr+offsetof(NVMC_RecordHeader, commit), NVMC_RECORD_COMMIT);
+}
+
+/* Reads the records of a page into the table, and returns the offset after the last record */
+static size_t NVMC_ScanPage(uint8_t page, const NVMC_RecordHeader **records) {
+  uintptr_t base = NVMC_PAGE_ADDR(page);
+  size_t offset = sizeof(NVMC_PageHeader);
+  const NVMC_RecordHeader *rec;
+
+  while (offset+sizeof(NVMC_RecordHeader)<=NVMC_CONFIG_PAGE_SIZE) {
+    rec = (const NVMC_RecordHeader*)(base+offset);
+    if (rec->key==NVMC_ERASED_16) {
+      break; /* end of records */
+    }
+    if (rec->size>NVMC_CONFIG_PAGE_SIZE-offset-sizeof(NVMC_RecordHeader)) {
+      break; /* header not completely written: the rest of the page is not erased */
+    }
+    if (   rec->commit==NVMC_RECORD_COMMIT
+        && rec->key<NVMC_KEY_NOF
+        && rec->crc==NVMC_RecordCrc(rec->key, rec->size, (const uint8_t*)(rec+1))
+       )
+    {
+      records[rec->key] = rec; /* later records replace the earlier ones */
+    } /* else: incomplete record or from another firmware, skip it */
+    offset += sizeof(NVMC_RecordHeader)+NVMC_ALIGN4(rec->size);
+  }
+  return offset;
+}
+
+static void NVMC_Mount(void) {
+  const NVMC_PageHeader *hdr;
+  uint8_t page;
+
+  NVMC_activePage = NVMC_NO_PAGE;
+  NVMC_activeSeq = 0;
+  for(page=0; page<NVMC_CONFIG_NOF_PAGES; page++) {
+    hdr = (const NVMC_PageHeader*)NVMC_PAGE_ADDR(page);
+    if (NVMC_IsValidPage(hdr) && (NVMC_activePage==NVMC_NO_PAGE || NVMC_PageSeq(hdr)>NVMC_activeSeq)) {
+      NVMC_activePage = page;
+      NVMC_activeSeq = NVMC_PageSeq(hdr);
+    }
+  }
+  memset(NVMC_records, 0, sizeof(NVMC_records));
+  NVMC_writeOffset = NVMC_CONFIG_PAGE_SIZE;
+  NVMC_tailDirty = FALSE;
+  if (NVMC_activePage!=NVMC_NO_PAGE) {
+    NVMC_writeOffset = NVMC_ScanPage(NVMC_activePage, NVMC_records);
+    if (NVMC_writeOffset<NVMC_CONFIG_PAGE_SIZE) {
+      NVMC_tailDirty = !NVMC_IsErased(NVMC_PAGE_ADDR(NVMC_activePage)+NVMC_writeOffset, NVMC_CONFIG_PAGE_SIZE-NVMC_writeOffset);
+    }
+  }
+}
+
+/* Copies the latest records and the new value to the next page in the ring, which becomes the active page */
+static uint8_t NVMC_MoveToNextPage(NVMC_Key key, const uint8_t *data, uint16_t size) {
+  const NVMC_RecordHeader *records[NVMC_KEY_NOF];
+  const NVMC_RecordHeader *rec;
+  uint8_t page;
+  uintptr_t base;
+  size_t offset;
+  uint32_t seq;
+  uint16_t recSize;
+  int i;
+
+  page = NVMC_activePage==NVMC_NO_PAGE ? 0 : (uint8_t)((NVMC_activePage+1)%NVMC_CONFIG_NOF_PAGES);
+  seq = NVMC_activeSeq+1;
+  base = NVMC_PAGE_ADDR(page);
+  if (NVMC_ErasePage(base)!=ERR_OK || !NVMC_IsErased(base, NVMC_CONFIG_PAGE_SIZE)) {
+    return ERR_FAILED;
+  }
+  if (   NVMC_ProgramHalfWord(base+offsetof(NVMC_PageHeader, layout), NVMC_PAGE_LAYOUT)!=ERR_OK
+      || NVMC_ProgramHalfWord(base+offsetof(NVMC_PageHeader, seqLow), (uint16_t)seq)!=ERR_OK
+      || NVMC_ProgramHalfWord(base+offsetof(NVMC_PageHeader, seqHigh), (uint16_t)(seq>>16))!=ERR_OK
+     )
+  {
+    return ERR_FAILED;
+  }
+  offset = sizeof(NVMC_PageHeader);
+  for(i=0; i<NVMC_KEY_NOF; i++) {
+    rec = NVMC_records[i];
+    records[i] = NULL;
+    if ((NVMC_Key)i==key) { /* new value */
+      rec = NULL;
+      if (data==NULL) {
+        continue;
+      }
+    } else if (rec==NULL) {
+      continue;
+    }
+    recSize = rec!=NULL ? rec->size : size;
+    if (offset+sizeof(NVMC_RecordHeader)+NVMC_ALIGN4(recSize)>NVMC_CONFIG_PAGE_SIZE) {
+      return ERR_OVERFLOW;
+    }
+    if (NVMC_WriteRecord(base+offset, (uint16_t)i, rec!=NULL ? (const uint8_t*)(rec+1) : data, recSize)!=ERR_OK) {
+      return ERR_FAILED;
+    }
+    records[i] = (const NVMC_RecordHeader*)(base+offset);
+    offset += sizeof(NVMC_RecordHeader)+NVMC_ALIGN4(recSize);
+  }
+  /* the magic makes the page valid, and with the higher sequence number it replaces the old page */
+  if (NVMC_ProgramHalfWord(base+offsetof(NVMC_PageHeader, magic), NVMC_PAGE_MAGIC)!=ERR_OK) {
+    return ERR_FAILED;
+  }
+  NVMC_activePage = page;
+  NVMC_activeSeq = seq;
+  NVMC_writeOffset = offset;
+  NVMC_tailDirty = FALSE;
+  memcpy(NVMC_records, records, sizeof(NVMC_records));
+  return ERR_OK;
+}
+
+const void *NVMC_Get(NVMC_Key key, size_t *size) {
+  const NVMC_RecordHeader *rec;
+
+  if ((unsigned int)key>=NVMC_KEY_NOF) {
+    return NULL;
+  }
+  rec = NVMC_records[key];
+  if (rec==NULL) {
+    return NULL;
+  }
+  if (size!=NULL) {
+    *size = rec->size;
+  }
+  return rec+1;
+}
+
+uint8_t NVMC_Save(NVMC_Key key, const void *data, size_t size) {
+  const NVMC_RecordHeader *rec;
+  uint8_t res;
+
+  if ((unsigned int)key>=NVMC_KEY_NOF || data==NULL || size==0 || size>NVMC_CONFIG_MAX_DATA_SIZE) {
+    return ERR_RANGE;
+  }
+#if PL_CONFIG_USE_FREERTOS
+  (void)xSemaphoreTake(NVMC_mutex, portMAX_DELAY);
+#endif
+  rec = NVMC_records[key];
+  if (rec!=NULL && rec->size==size && memcmp(rec+1, data, size)==0) {
+    res = ERR_OK; /* same value already stored, save the erase cycles */
+  } else if (   NVMC_activePage==NVMC_NO_PAGE || NVMC_tailDirty
+             || NVMC_writeOffset+sizeof(NVMC_RecordHeader)+NVMC_ALIGN4(size)>NVMC_CONFIG_PAGE_SIZE
+            )
+  {
+    res = NVMC_MoveToNextPage(key, data, (uint16_t)size);
+  } else {
+    rec = (const NVMC_RecordHeader*)(NVMC_PAGE_ADDR(NVMC_activePage)+NVMC_writeOffset);
+    res = NVMC_WriteRecord((uintptr_t)rec, (uint16_t)key, data, (uint16_t)size);
+    if (res==ERR_OK) {
+      NVMC_records[key] = rec;
+      NVMC_writeOffset += sizeof(NVMC_RecordHeader)+NVMC_ALIGN4(size);
+    } else {
+      NVMC_tailDirty = TRUE; /* write the next record into a new page */
+    }
+  }
+#if PL_CONFIG_USE_FREERTOS
+  (void)xSemaphoreGive(NVMC_mutex);
+#endif
+  return res;
+}
+
+uint8_t NVMC_EraseAll(void) {
+  uint8_t page, res = ERR_OK;
+
+#if PL_CONFIG_USE_FREERTOS
+  (void)xSemaphoreTake(NVMC_mutex, portMAX_DELAY);
+#endif
+  for(page=0; page<NVMC_CONFIG_NOF_PAGES; page++) {
+    if (NVMC_ErasePage(NVMC_PAGE_ADDR(page))!=ERR_OK) {
+      res = ERR_FAILED;
+    }
+  }
+  NVMC_Mount();
+#if PL_CONFIG_USE_FREERTOS
+  (void)xSemaphoreGive(NVMC_mutex);
+#endif
+  return res;
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void NVMC_PrintStatus(const McuShell_StdIOType *io) {
+  unsigned char buf[32];
+  size_t size;
+  int i;
+
+  McuShell_SendStatusStr((unsigned char*)"nvm", (unsigned char*)"\r\n", io->stdOut);
+  if (NVMC_activePage==NVMC_NO_PAGE) {
+    McuShell_SendStatusStr((unsigned char*)"  page", (unsigned char*)"none, nothing stored\r\n", io->stdOut);
+    return;
+  }
+  McuUtility_Num8uToStr(buf, sizeof(buf), NVMC_activePage);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" of ");
+  McuUtility_strcatNum8u(buf, sizeof(buf), NVMC_CONFIG_NOF_PAGES);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", seq ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), NVMC_activeSeq);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  page", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), NVMC_writeOffset);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" of ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), NVMC_CONFIG_PAGE_SIZE);
+  McuUtility_strcat(buf, sizeof(buf), NVMC_tailDirty ? (unsigned char*)" bytes, dirty\r\n" : (unsigned char*)" bytes\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  used", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), NVMC_activeSeq/NVMC_CONFIG_NOF_PAGES+1);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" per page\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  erases", buf, io->stdOut);
+
+  McuShell_SendStatusStr((unsigned char*)"  keys", (unsigned char*)"", io->stdOut);
+  for(i=0; i<NVMC_KEY_NOF; i++) {
+    if (NVMC_Get((NVMC_Key)i, &size)!=NULL) {
+      buf[0] = '\0';
+      McuUtility_strcatNum8u(buf, sizeof(buf), (uint8_t)i);
+      McuUtility_chcat(buf, sizeof(buf), ':');
+      McuUtility_strcatNum32u(buf, sizeof(buf), size);
+      McuUtility_chcat(buf, sizeof(buf), ' ');
+      McuShell_SendStr(buf, io->stdOut);
+    }
+  }
+  McuShell_SendStr((unsigned char*)"(key:bytes)\r\n", io->stdOut);
+}
+
+static void NVMC_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"nvm", (unsigned char*)"Group of configuration storage commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Print help or status information\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  erase", (unsigned char*)"Erase all stored values, the next start uses the defaults\r\n", io->stdOut);
+}
+
+static uint8_t NVMC_CmdErase(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  if (NVMC_EraseAll()!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"ERROR: failed erasing flash\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return ERR_OK;
+}
+
+static const CMD_Command NVMC_Cmds[] = {
+  {"erase", "", NVMC_CmdErase},
+};
+
+const CMD_Group NVMC_CmdGroup = CMD_GROUP("nvm", NVMC_PrintHelp, NVMC_PrintStatus, NVMC_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void NVMC_Deinit(void) {
+#if PL_CONFIG_USE_FREERTOS
+  vQueueUnregisterQueue(NVMC_mutex);
+  vSemaphoreDelete(NVMC_mutex);
+  NVMC_mutex = NULL;
+#endif
+}
+
+void NVMC_Init(void) {
+#if PL_CONFIG_USE_FREERTOS
+  NVMC_mutex = xSemaphoreCreateMutex();
+  if (NVMC_mutex==NULL) {
+    for(;;){} /* out of memory? */
+  }
+  vQueueAddToRegistry(NVMC_mutex, "NvmMutex");
+#endif
+  NVMC_Mount();
+}
+
+#endif /* PL_CONFIG_HAS_CONFIG_NVM */
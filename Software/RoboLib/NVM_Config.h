@@ -0,0 +1,113 @@
+/**
+ * \file
+ * \brief Non-volatile configuration storage
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This module stores configuration data (line sensor calibration, PID and turn parameters) as
+ * key/value records in the last pages of the flash. New values are appended to the active page,
+ * so a page only gets erased if it is full: then the latest records are copied to the next page
+ * in the ring, which spreads the erase cycles over all pages. Each record has a CRC and a commit
+ * marker which is programmed last, and the page header is programmed after the copied records:
+ * a power failure keeps either the old or the new value. A table in RAM points to the latest
+ * record of each key, so reading a value does not search the flash.
+ */
+
+#ifndef SRC_NVM_CONFIG_H_
+#define SRC_NVM_CONFIG_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_CONFIG_NVM
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef NVMC_CONFIG_FLASH_START_ADDR
+  #define NVMC_CONFIG_FLASH_START_ADDR  (0x0800F000) /* last two pages of the 64 KB flash, not used by the linker file */
+#endif
+#ifndef NVMC_CONFIG_PAGE_SIZE
+  #define NVMC_CONFIG_PAGE_SIZE         (2048) /* erase unit of the STM32F303K8 flash */
+#endif
+#ifndef NVMC_CONFIG_NOF_PAGES
+  #define NVMC_CONFIG_NOF_PAGES         (2) /* pages used in a ring, at least 2 */
+#endif
+#ifndef NVMC_CONFIG_MAX_DATA_SIZE
+  #define NVMC_CONFIG_MAX_DATA_SIZE     (128) /* maximum size of a value in bytes */
+#endif
+#ifndef NVMC_CONFIG_USE_HAL_FLASH
+  #define NVMC_CONFIG_USE_HAL_FLASH     (1) /* 1: STM32 HAL flash driver, 0: NVMC_OnErasePage() and NVMC_OnProgramHalfWord() provided by the application */
+#endif
+
+/* Keys of the stored values. The numbers are stored in the flash, so do not change them. */
+typedef enum {
+  NVMC_KEY_REFLECTANCE = 0,  /* min/max calibration values of the line sensor */
+  NVMC_KEY_TURN = 1,         /* steps for turning and stepping over the line */
+  NVMC_KEY_PID_LINE_FW = 2,  /* PID parameters, same order as PID_ConfigType */
+  NVMC_KEY_PID_LINE_BW = 3,
+  NVMC_KEY_PID_POS_LEFT = 4,
+  NVMC_KEY_PID_POS_RIGHT = 5,
+  NVMC_KEY_PID_SPEED_LEFT = 6,
+  NVMC_KEY_PID_SPEED_RIGHT = 7,
+  NVMC_KEY_NOF               /* sentinel, number of keys */
+} NVMC_Key;
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the configuration storage, registered in Shell.c */
+extern const CMD_Group NVMC_CmdGroup;
+#endif
+
+/*!
+ * \brief Returns the stored value of a key. Does not access the flash to find the value.
+ * \param key Key of the value
+ * \param[out] size Size of the value in bytes, can be NULL
+ * \return Pointer to the value in the flash, NULL if there is no value stored. The value is 4 byte aligned
+ * and needs to be copied before the next NVMC_Save(), as that can move it to another page.
+ */
+const void *NVMC_Get(NVMC_Key key, size_t *size);
+
+/*!
+ * \brief Stores a value. Nothing is written if the stored value is the same. The flash is not
+ * accessible while programming or erasing, so this blocks the CPU for up to 40 ms if the page is full.
+ * \param key Key of the value
+ * \param data Pointer to the data
+ * \param size Size of the data in bytes, up to NVMC_CONFIG_MAX_DATA_SIZE
+ * \return ERR_OK if stored, ERR_RANGE for a wrong key or size, ERR_OVERFLOW if the values do not fit into a page, ERR_FAILED for a flash error
+ */
+uint8_t NVMC_Save(NVMC_Key key, const void *data, size_t size);
+
+/*!
+ * \brief Erases all pages, so all values are gone.
+ * \return ERR_OK if the pages are erased, ERR_FAILED otherwise
+ */
+uint8_t NVMC_EraseAll(void);
+
+#if !NVMC_CONFIG_USE_HAL_FLASH
+/*!
+ * \brief Flash driver: erases a page, provided by the application (e.g. the host simulation).
+ * \param pageAddr Address of the page
+ * \return ERR_OK or ERR_FAILED
+ */
+uint8_t NVMC_OnErasePage(uintptr_t pageAddr);
+
+/*!
+ * \brief Flash driver: programs a half word which is erased, provided by the application.
+ * \param addr Address of the half word
+ * \param data Value to program
+ * \return ERR_OK or ERR_FAILED
+ */
+uint8_t NVMC_OnProgramHalfWord(uintptr_t addr, uint16_t data);
+#endif
+
+/*!
+ * \brief Module de-initialization.
+ */
+void NVMC_Deinit(void);
+
+/*!
+ * \brief Module initialization, reads the pages and builds the table of the latest records.
+ */
+void NVMC_Init(void);
+
+#endif /* PL_CONFIG_HAS_CONFIG_NVM */
+
+#endif /* SRC_NVM_CONFIG_H_ */
@@ -0,0 +1,276 @@
+/**
+ * \file
+ * \brief Odometry
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Dead reckoning with the quadrature counters. Distances are in 1/65536 mm, the heading is a
+ * binary angle (2^32 is a full turn) so it wraps around without extra code. Sine and cosine come
+ * from a quarter wave table with linear interpolation, the update needs no floating point and
+ * no 64bit division.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_ODOMETRY
+#include "Odometry.h"
+#include "Quadrature.h"
+#include "SensorBus.h"
+#include "FreeRTOS.h"
+#include "McuArmTools.h"
+#include "McuUtility.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+#endif
+
+/* calibration: drive a known distance straight for the ticks, and turn on the spot for the wheel base */
+#define ODO_CONFIG_TICKS_PER_M       8985   /* encoder ticks per meter driven */
+#define ODO_CONFIG_WHEEL_BASE_UM     85000  /* distance between the wheels in micrometers */
+
+#define ODO_SPEED_FILTER_SHIFT       2      /* IIR filter for speed and turn rate: new = old + (raw-old)/4 */
+
+typedef struct {
+  int64_t x, y;          /* position in 1/65536 mm */
+  uint32_t heading;      /* binary angle, counter-clockwise */
+  int32_t speed;         /* filtered speed in mm/s */
+  int32_t turnRate;      /* filtered turn rate in centi-degrees/s */
+  int32_t lastL, lastR;  /* quadrature counters of the last update */
+  uint32_t lastGen;      /* generation of the quadrature counters for lastL and lastR */
+  uint32_t lastCycles;   /* cycle counter of the last update */
+  bool valid;            /* if the last values are set */
+} ODO_State;
+
+static ODO_State ODO_state; /* only used by the Drive task */
+static SBUS_Channel ODO_channel; /* pose published for the other tasks */
+static ODO_Pose ODO_channelBuf[2];
+static volatile bool ODO_resetRequest; /* set by ODO_Reset(), handled by the Drive task */
+
+static volatile int32_t ODO_ticksPerM, ODO_wheelBaseUm; /* calibration, set by the shell */
+static volatile bool ODO_calibChanged; /* factors need to be recalculated */
+static int32_t ODO_tickLen; /* length of a tick in 1/65536 mm */
+static int32_t ODO_headingFactor; /* binary angle per 1/65536 mm wheel difference, scaled by 2^16 */
+
+static uint32_t ODO_updateCycles, ODO_updateCyclesMax; /* execution time of ODO_Update() */
+
+/* sin(0..90 degree) in Q15, 64 steps */
+static const int16_t ODO_SinTable[65] = {
+  0, 804, 1608, 2411, 3212, 4011, 4808, 5602,
+  6393, 7180, 7962, 8740, 9512, 10279, 11039, 11793,
+  12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531,
+  18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+  23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791,
+  27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+  30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972,
+  32138, 32286, 32413, 32522, 32610, 32679, 32729, 32758,
+  32767,
+};
+
+/*!
+ * \brief Sine of a binary angle.
+ * \param angle Angle, 2^32 is 360 degree
+ * \return Sine in Q15
+ */
+static int32_t ODO_Sin(uint32_t angle) {
+  uint32_t quadrant, r, idx, frac;
+  int32_t val;
+
+  quadrant = angle>>30;
+  r = angle&0x3FFFFFFF;
+  if (quadrant&1) { /* falling part of the quadrant */
+    r = 0x40000000-r;
+  }
+  idx = r>>24; /* 0..64 */
+  if (idx>=64) {
+    val = ODO_SinTable[64];
+  } else {
+    frac = (r>>8)&0xFFFF;
+    val = ODO_SinTable[idx]+(int32_t)(((ODO_SinTable[idx+1]-ODO_SinTable[idx])*(int32_t)frac)>>16);
+  }
+  if (quadrant&2) {
+    val = -val;
+  }
+  return val;
+}
+
+static int32_t ODO_Cos(uint32_t angle) {
+  return ODO_Sin(angle+0x40000000);
+}
+
+/*! \brief Binary angle to centi-degrees, -18000..18000 */
+static int32_t ODO_AngleToCentiDeg(uint32_t angle) {
+  return (int32_t)(((int64_t)(int32_t)angle*36000)>>32);
+}
+
+static void ODO_CalcFactors(void) {
+  ODO_tickLen = (int32_t)((65536000LL+ODO_ticksPerM/2)/ODO_ticksPerM); /* 1000 mm per meter */
+  ODO_headingFactor = (int32_t)(683565276000LL/ODO_wheelBaseUm); /* 2^32/(2*pi) per mm, with 1000 um/mm */
+}
+
+static void ODO_Publish(void) {
+  ODO_Pose pose;
+
+  pose.x = (int32_t)(ODO_state.x>>16);
+  pose.y = (int32_t)(ODO_state.y>>16);
+  pose.heading = ODO_AngleToCentiDeg(ODO_state.heading);
+  pose.speed = ODO_state.speed;
+  pose.turnRate = ODO_state.turnRate;
+  SBUS_Publish(&ODO_channel, &pose);
+}
+
+void ODO_Update(void) {
+  uint32_t cycles, dtUs;
+  int32_t posL, posR, dsL, dsR, ds, dHeading, raw;
+  uint32_t mid, gen;
+
+  cycles = McuArmTools_GetCycleCounter();
+  do { /* both counters from the same generation: a reset can run from a task with a higher priority */
+    gen = QUAD_GetPosGeneration();
+    posL = (int32_t)QUAD_GetLeftPos();
+    posR = (int32_t)QUAD_GetRightPos();
+  } while (gen!=QUAD_GetPosGeneration());
+  if (ODO_calibChanged) {
+    ODO_calibChanged = FALSE;
+    ODO_CalcFactors();
+  }
+  if (ODO_resetRequest || !ODO_state.valid) {
+    ODO_resetRequest = FALSE;
+    ODO_state.x = ODO_state.y = 0;
+    ODO_state.heading = 0;
+    ODO_state.speed = ODO_state.turnRate = 0;
+    ODO_state.valid = TRUE;
+  } else if (gen!=ODO_state.lastGen) {
+    /* counters have been set since the last update: no movement to integrate, only take the new values */
+  } else {
+    dsL = (posL-ODO_state.lastL)*ODO_tickLen;
+    dsR = (posR-ODO_state.lastR)*ODO_tickLen;
+    ds = (dsL+dsR)/2;
+    dHeading = (int32_t)(((int64_t)(dsR-dsL)*ODO_headingFactor)>>16);
+    mid = ODO_state.heading+(uint32_t)(dHeading/2); /* the robot moved on an arc: use the heading in the middle */
+    ODO_state.x += ((int64_t)ds*ODO_Cos(mid))>>15;
+    ODO_state.y += ((int64_t)ds*ODO_Sin(mid))>>15;
+    ODO_state.heading += (uint32_t)dHeading;
+    dtUs = (cycles-ODO_state.lastCycles)/(configCPU_CLOCK_HZ/1000000);
+    if (dtUs>0) {
+      raw = (int32_t)(((int64_t)ds*1000000)>>16)/(int32_t)dtUs;
+      ODO_state.speed += (raw-ODO_state.speed)>>ODO_SPEED_FILTER_SHIFT;
+      raw = (int32_t)(((int64_t)dHeading*3600000)>>32)*10000/(int32_t)dtUs; /* 1/10000 degree per update to centi-degrees/s */
+      ODO_state.turnRate += (raw-ODO_state.turnRate)>>ODO_SPEED_FILTER_SHIFT;
+    }
+  }
+  ODO_state.lastL = posL;
+  ODO_state.lastR = posR;
+  ODO_state.lastGen = gen;
+  ODO_state.lastCycles = cycles;
+  ODO_Publish();
+  ODO_updateCycles = McuArmTools_GetCycleCounter()-cycles;
+  if (ODO_updateCycles>ODO_updateCyclesMax) {
+    ODO_updateCyclesMax = ODO_updateCycles;
+  }
+}
+
+void ODO_GetPose(ODO_Pose *pose) {
+  (void)SBUS_Read(&ODO_channel, pose, NULL);
+}
+
+void ODO_Reset(void) {
+  ODO_resetRequest = TRUE;
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void ODO_PrintStatus(const McuShell_StdIOType *io) {
+  ODO_Pose pose;
+  uint8_t buf[32];
+
+  ODO_GetPose(&pose);
+  McuShell_SendStatusStr((unsigned char*)"odo", (unsigned char*)"\r\n", io->stdOut);
+
+  McuUtility_Num32sToStr(buf, sizeof(buf), pose.x);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" mm, ");
+  McuUtility_strcatNum32s(buf, sizeof(buf), pose.y);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" mm\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  x, y", buf, io->stdOut);
+
+  if (pose.heading<0) {
+    McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"-");
+    pose.heading = -pose.heading;
+  } else {
+    buf[0] = '\0';
+  }
+  McuUtility_strcatNum32s(buf, sizeof(buf), pose.heading/100);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)".");
+  McuUtility_strcatNum16uFormatted(buf, sizeof(buf), (uint16_t)(pose.heading%100), '0', 2);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" deg\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  heading", buf, io->stdOut);
+
+  McuUtility_Num32sToStr(buf, sizeof(buf), pose.speed);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" mm/s, ");
+  McuUtility_strcatNum32s(buf, sizeof(buf), pose.turnRate/100);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" deg/s\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  speed", buf, io->stdOut);
+
+  McuUtility_Num32sToStr(buf, sizeof(buf), ODO_ticksPerM);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" ticks/m, base ");
+  McuUtility_strcatNum32s(buf, sizeof(buf), ODO_wheelBaseUm);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" um\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  calib", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), ODO_updateCycles);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" cycles (max ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), ODO_updateCyclesMax);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  update", buf, io->stdOut);
+}
+
+static void ODO_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"odo", (unsigned char*)"Group of odometry commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows odometry help or status\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Sets the pose to zero at the current position\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  ticks <n>", (unsigned char*)"Calibration: encoder ticks per meter\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  base <um>", (unsigned char*)"Calibration: wheel base in micrometers\r\n", io->stdOut);
+}
+
+static uint8_t ODO_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  ODO_Reset();
+  ODO_updateCyclesMax = 0;
+  return ERR_OK;
+}
+
+static uint8_t ODO_CmdTicks(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (args[0].i<=0) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  ODO_ticksPerM = args[0].i;
+  ODO_calibChanged = TRUE;
+  return ERR_OK;
+}
+
+static uint8_t ODO_CmdBase(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (args[0].i<=0) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  ODO_wheelBaseUm = args[0].i;
+  ODO_calibChanged = TRUE;
+  return ERR_OK;
+}
+
+static const CMD_Command ODO_Cmds[] = {
+  {"reset", "", ODO_CmdReset},
+  {"ticks", "i", ODO_CmdTicks},
+  {"base",  "i", ODO_CmdBase},
+};
+
+const CMD_Group ODO_CmdGroup = CMD_GROUP("odo", ODO_PrintHelp, ODO_PrintStatus, ODO_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void ODO_Init(void) {
+  ODO_ticksPerM = ODO_CONFIG_TICKS_PER_M;
+  ODO_wheelBaseUm = ODO_CONFIG_WHEEL_BASE_UM;
+  ODO_CalcFactors();
+  ODO_calibChanged = FALSE;
+  ODO_state.valid = FALSE; /* first update sets the origin */
+  ODO_resetRequest = FALSE;
+  ODO_updateCycles = ODO_updateCyclesMax = 0;
+  SBUS_InitChannel(&ODO_channel, &ODO_channelBuf[0], &ODO_channelBuf[1], sizeof(ODO_Pose));
+}
+#endif /* PL_CONFIG_HAS_ODOMETRY */
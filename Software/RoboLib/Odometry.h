@@ -0,0 +1,55 @@
+/**
+ * \file
+ * \brief Odometry
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This module integrates the wheel movements into the pose (position and heading) of the robot.
+ * The pose is updated by the Drive task with each control cycle, using fixed point arithmetic.
+ * The coordinate system is set by ODO_Reset(): x is forward, y is to the left, and the heading
+ * is counter-clockwise.
+ */
+
+#ifndef SRC_ODOMETRY_H_
+#define SRC_ODOMETRY_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_ODOMETRY
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the odometry, registered in Shell.c */
+extern const CMD_Group ODO_CmdGroup;
+#endif
+
+typedef struct {
+  int32_t x;         /*!< position in mm, forward at the time of the reset */
+  int32_t y;         /*!< position in mm, to the left at the time of the reset */
+  int32_t heading;   /*!< heading in centi-degrees, counter-clockwise, -18000..18000 */
+  int32_t speed;     /*!< speed in mm/s, positive is forward */
+  int32_t turnRate;  /*!< turn rate in centi-degrees/s, counter-clockwise */
+} ODO_Pose;
+
+/*!
+ * \brief Returns the latest pose, can be called from any task.
+ * \param pose Where to store the pose
+ */
+void ODO_GetPose(ODO_Pose *pose);
+
+/*!
+ * \brief Sets the pose to zero at the current position. Done with the next update of the Drive task.
+ */
+void ODO_Reset(void);
+
+/*!
+ * \brief Integrates the wheel movements since the last call, called periodically by the Drive task.
+ */
+void ODO_Update(void);
+
+/*!
+ * \brief Module initialization.
+ */
+void ODO_Init(void);
+
+#endif /* PL_CONFIG_HAS_ODOMETRY */
+
+#endif /* SRC_ODOMETRY_H_ */
@@ -10,8 +10,18 @@
 #include "Motor.h"
 #include "McuUtility.h"
 #include "Reflectance.h"
+#include "McuArmTools.h"
+#include "Span.h"
+#include "DLog.h"
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+  #include <string.h>
+#endif
 
-#define PID_DEBUG 0 /* careful: this will slow down the PID loop frequency! */
+#define PID_DEBUG (0 && PL_CONFIG_HAS_DLOG) /* deferred log of the line PID, see DLog.h */
+#define PID_DRIVE_PERIOD_US  (5000) /* position and speed PID are called by the drive task every 5 ms */
+#define PID_LINE_PERIOD_US   (PID_REF_PERIOD_US)
+#define PID_CONFIG_BENCHMARK (1 && PL_CONFIG_HAS_SHELL) /* 'pid bench' command comparing the previous and the current PID implementation */
 
 #if PL_CONFIG_HAS_LINE_PID
   static PID_Config lineFwConfig;
@@ -51,35 +61,153 @@ uint8_t PID_GetPIDConfig(PID_ConfigType config, PID_Config **confP) {
   return ERR_OK;
 }
 
+#if PL_CONFIG_HAS_CONFIG_NVM
+typedef struct {
+  int32_t pFactor100;
+  int32_t iFactor100;
+  int32_t dFactor100;
+  int32_t ffFactor100;
+  int32_t iAntiWindup;
+  int32_t outLimit;
+  uint8_t dFilterShift;
+  uint8_t maxSpeedPercent;
+} PID_StoredParams; /* parameters of a configuration stored in the flash */
+
+uint8_t PID_SaveConfigs(void) {
+  PID_ConfigType type;
+  PID_Config *config;
+  PID_StoredParams params;
+  uint8_t res = ERR_OK;
+
+  for(type=PID_CONFIG_LINE_FW; type<=PID_CONFIG_SPEED_RIGHT; type++) {
+    if (PID_GetPIDConfig(type, &config)==ERR_OK) {
+      memset(&params, 0, sizeof(params)); /* padding bytes get stored too */
+      params.pFactor100 = config->pFactor100;
+      params.iFactor100 = config->iFactor100;
+      params.dFactor100 = config->dFactor100;
+      params.ffFactor100 = config->ffFactor100;
+      params.iAntiWindup = config->iAntiWindup;
+      params.outLimit = config->outLimit;
+      params.dFilterShift = config->dFilterShift;
+      params.maxSpeedPercent = config->maxSpeedPercent;
+      if (NVMC_Save((NVMC_Key)(NVMC_KEY_PID_LINE_FW+type), &params, sizeof(params))!=ERR_OK) {
+        res = ERR_FAILED;
+      }
+    }
+  }
+  return res;
+}
+
+void PID_LoadConfigs(void) {
+  PID_ConfigType type;
+  PID_Config *config;
+  const PID_StoredParams *params;
+  size_t size;
+
+  for(type=PID_CONFIG_LINE_FW; type<=PID_CONFIG_SPEED_RIGHT; type++) {
+    params = NVMC_Get((NVMC_Key)(NVMC_KEY_PID_LINE_FW+type), &size);
+    if (params!=NULL && size==sizeof(PID_StoredParams) && PID_GetPIDConfig(type, &config)==ERR_OK) {
+      config->pFactor100 = params->pFactor100;
+      config->iFactor100 = params->iFactor100;
+      config->dFactor100 = params->dFactor100;
+      config->ffFactor100 = params->ffFactor100;
+      config->iAntiWindup = params->iAntiWindup;
+      config->outLimit = params->outLimit;
+      config->dFilterShift = params->dFilterShift;
+      config->maxSpeedPercent = params->maxSpeedPercent;
+      PID_ConfigChanged(config);
+    }
+  }
+}
+#endif /* PL_CONFIG_HAS_CONFIG_NVM */
+
 #if PL_CONFIG_HAS_SPEED_PID || PL_CONFIG_HAS_POS_PID || PL_CONFIG_HAS_LINE_PID
-static int32_t PID(int32_t currVal, int32_t setVal, PID_Config *config) {
-  int32_t error;
-  int32_t pid;
-  
+#define PID_Q16_MUL(a, b)  ((int32_t)(((int64_t)(a)*(int64_t)(b))>>16)) /* multiply with a Q16.16 value */
+
+void PID_ConfigChanged(PID_Config *config) {
+  config->gains.dtUs = 0; /* recalculate gains with the next PID iteration */
+}
+
+static void PID_CalcGains(PID_Config *config, uint32_t dtUs) {
+  /* divisions are done here, only if the configuration or the sample period changes */
+  config->gains.dtRatio = (int32_t)(((int64_t)dtUs<<16)/PID_REF_PERIOD_US);
+  config->gains.kp = (int32_t)(((int64_t)config->pFactor100<<16)/100);
+  config->gains.ki = (int32_t)(((int64_t)config->iFactor100<<16)/100);
+  config->gains.kd = (int32_t)(((int64_t)config->dFactor100<<16)*PID_REF_PERIOD_US/(100*(int64_t)dtUs));
+  config->gains.kff = (int32_t)(((int64_t)config->ffFactor100<<16)/100);
+  if (config->iFactor100!=0) {
+    config->gains.kaw = (int32_t)(((int64_t)100<<16)/config->iFactor100);
+  } else {
+    config->gains.kaw = 0;
+  }
+  config->gains.dtUs = dtUs;
+}
+
+/*!
+ * \brief PID closed loop calculation, in fixed point without divisions.
+ * \param currVal Current (measured) value
+ * \param setVal Desired value
+ * \param dtUs Sample period in micro seconds
+ * \param step TRUE for a run in the sample period. FALSE for a new set value in between: the output is
+ * updated, the integral and the D part are not advanced, as no sample period has passed.
+ * \param config PID configuration and state
+ * \return PID output value
+ */
+static int32_t PID(int32_t currVal, int32_t setVal, uint32_t dtUs, bool step, PID_Config *config) {
+  int32_t error, pid, d, sat;
+  uint32_t cycles;
+
+  cycles = McuArmTools_GetCycleCounter();
+  if (config->gains.dtUs!=dtUs) {
+    PID_CalcGains(config, dtUs);
+    config->lastValue = currVal; /* avoid a derivative kick in the first iteration */
+  }
   /* perform PID closed control loop calculation */
   error = setVal-currVal; /* calculate error */
-  pid = (error*config->pFactor100)/100; /* P part */
-  config->integral += error; /* integrate error */
-  if (config->integral>config->iAntiWindup) {
-    config->integral = config->iAntiWindup;
-  } else if (config->integral<-config->iAntiWindup) {
-    config->integral = -config->iAntiWindup;
+  pid = PID_Q16_MUL(error, config->gains.kp); /* P part */
+  if (step) {
+    config->integral += PID_Q16_MUL(error, config->gains.dtRatio); /* integrate error, scaled by the sample period */
+    if (config->integral>config->iAntiWindup) {
+      config->integral = config->iAntiWindup;
+    } else if (config->integral<-config->iAntiWindup) {
+      config->integral = -config->iAntiWindup;
+    }
+    /* see http://brettbeauregard.com/blog/2011/04/improving-the-beginner%E2%80%99s-pid-reset-windup/ */
+    if (config->integral > 0xffff) { /* max value of PWM */
+      config->integral = 0xffff;
+    } else if (config->integral < -0xffff) {
+      config->integral = -0xffff;
+    }
   }
-#if 1 /* see http://brettbeauregard.com/blog/2011/04/improving-the-beginner%E2%80%99s-pid-reset-windup/ */
-  {
-    int32_t max;
-
-    max = 0xffff; /* max value of PWM */
-    if (config->integral > max) {
-      config->integral = max;
-    } else if (config->integral < -max) {
-      config->integral = -max;
+  pid += PID_Q16_MUL(config->integral, config->gains.ki); /* add I part */
+  if (step) {
+    /* D part on the measurement (no kick on set value changes), with a low pass filter */
+    d = PID_Q16_MUL(config->lastValue-currVal, config->gains.kd);
+    config->dFiltered += (d-config->dFiltered)>>config->dFilterShift;
+  }
+  pid += config->dFiltered; /* add D part */
+  pid += PID_Q16_MUL(setVal, config->gains.kff); /* add feed-forward part */
+  if (config->outLimit!=0) { /* saturate output, feed back the excess into the integral (back-calculation) */
+    if (pid>config->outLimit) {
+      sat = config->outLimit;
+    } else if (pid<-config->outLimit) {
+      sat = -config->outLimit;
+    } else {
+      sat = pid;
     }
+    if (step) {
+      config->integral -= PID_Q16_MUL(pid-sat, config->gains.kaw);
+    }
+    pid = sat;
+  }
+  config->lastError = error; /* remember for status */
+  if (step) {
+    config->lastValue = currVal; /* remember for next iteration of D part */
+  }
+  cycles = McuArmTools_GetCycleCounter()-cycles;
+  if (cycles>config->maxCycles) {
+    config->maxCycles = cycles;
   }
-#endif
-  pid += (config->integral*config->iFactor100)/100; /* add I part */
-  pid += ((error-config->lastError)*config->dFactor100)/100; /* add D part */
-  config->lastError = error; /* remember for next iteration of D part */
   return pid;
 }
 #endif
@@ -121,16 +249,12 @@ static uint8_t errorWithinPercent(int32_t error) {
 #if PL_APP_LINE_FOLLOWING || PL_APP_LINE_MAZE
 static void PID_LineCfg(uint16_t currLine, uint16_t setLine, uint16_t currLineWidth, bool forward, PID_Config *config) {
   int32_t pid, speed, speedL, speedR;
-#if PID_DEBUG
-  unsigned char buf[16];
-  static uint8_t cnt = 0;
-#endif
 //  uint8_t errorPercent;
   MOT_Direction directionL=MOT_DIR_FORWARD, directionR=MOT_DIR_FORWARD;
   
   (void)currLineWidth;
 
-  pid = PID(currLine, setLine, config);
+  pid = PID(currLine, setLine, PID_LINE_PERIOD_US, TRUE, config);
   //errorPercent = errorWithinPercent(currLine-setLine);
   
   /* transform into different speed for motors. The PID is used as difference value to the motor PWM */
@@ -247,38 +371,9 @@ static void PID_LineCfg(uint16_t currLine, uint16_t setLine, uint16_t currLineWi
   MOT_SetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT), directionL);
   MOT_SetVal(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), 0xFFFF-speedR); /* PWM is low active */
   MOT_SetDirection(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), directionR);
-#if PID_DEBUG /* debug diagnostic */
-  {
-    cnt++;
-    if (cnt>10) { /* limit number of messages to the console */
-      McuShell_StdIO_OutErr_FctType ioOut = SHELL_GetStdio()->stdOut;
-      cnt = 0;
-      
-      McuShell_SendStr((unsigned char*)"line:", ioOut);
-      buf[0] = '\0';
-      McuUtility_strcatNum16u(buf, sizeof(buf), currLine);
-      McuShell_SendStr(buf, ioOut);
-  
-      McuShell_SendStr((unsigned char*)" sum:", ioOut);
-      buf[0] = '\0';
-      McuUtility_strcatNum32Hex(buf, sizeof(buf), integral);
-      McuShell_SendStr(buf, ioOut);
-      
-      McuShell_SendStr((unsigned char*)" left:", ioOut);
-      McuShell_SendStr(directionL==MOT_DIR_FORWARD?(unsigned char*)"fw ":(unsigned char*)"bw ", ioOut);
-      buf[0] = '\0';
-      McuUtility_strcatNum16Hex(buf, sizeof(buf), speedL);
-      McuShell_SendStr(buf, ioOut);
-  
-      McuShell_SendStr((unsigned char*)" right:", ioOut);
-      McuShell_SendStr(directionR==MOT_DIR_FORWARD?(unsigned char*)"fw ":(unsigned char*)"bw ", ioOut);
-      buf[0] = '\0';
-      McuUtility_strcatNum16Hex(buf, sizeof(buf), speedR);
-      McuShell_SendStr(buf, ioOut);
-      
-      McuShell_SendStr((unsigned char*)"\r\n", ioOut);
-    }
-  }
+#if PID_DEBUG /* debug diagnostic: negative speed is backward */
+  DLOG("pid line %u sum %d left %d right %d", currLine, config->integral,
+    directionL==MOT_DIR_FORWARD?speedL:-speedL, directionR==MOT_DIR_FORWARD?speedR:-speedR);
 #endif
 }
 #endif //PL_APP_LINE_FOLLOWING || PL_APP_LINE_MAZE
@@ -288,6 +383,7 @@ static void PID_LineCfg(uint16_t currLine, uint16_t setLine, uint16_t currLineWi
 #if PL_APP_LINE_FOLLOWING || PL_APP_LINE_MAZE
 void PID_Line(uint16_t currLinePos, uint16_t setLinePos, uint16_t currLineWidth, bool forward) {
 #if PL_CONFIG_HAS_LINE_PID
+  SPAN_BEGIN(SPAN_ID_PID_LINE);
 #if PL_CONFIG_GO_DEADEND_BW
   if (forward) {
     PID_LineCfg(currLinePos, setLinePos, forward, &lineFwConfig);
@@ -298,12 +394,13 @@ void PID_Line(uint16_t currLinePos, uint16_t setLinePos, uint16_t currLineWidth,
   (void)forward; /* not used */
   PID_LineCfg(currLinePos, setLinePos, currLineWidth, forward, &lineFwConfig);
 #endif
+  SPAN_END(SPAN_ID_PID_LINE);
 #endif
 }
 #endif
 
 #if PL_CONFIG_HAS_POS_PID
-static void PID_PosCfg(int32_t currPos, int32_t setPos, bool isLeft, PID_Config *config) {
+static void PID_PosCfg(int32_t currPos, int32_t setPos, bool isLeft, bool step, PID_Config *config) {
   int32_t speed;
   MOT_Direction direction=MOT_DIR_FORWARD;
   MOT_MotorDevice *motHandle;
@@ -316,7 +413,7 @@ static void PID_PosCfg(int32_t currPos, int32_t setPos, bool isLeft, PID_Config
     setPos = currPos;
   }
 #endif
-  speed = PID(currPos, setPos, config);
+  speed = PID(currPos, setPos, PID_DRIVE_PERIOD_US, step, config);
   /* transform into motor speed */
   speed *= 1000; /* scale PID, otherwise we need high PID constants */
   if (speed>=0) {
@@ -346,17 +443,19 @@ static void PID_PosCfg(int32_t currPos, int32_t setPos, bool isLeft, PID_Config
   MOT_UpdatePercent(motHandle, direction);
 }
 
-void PID_Pos(int32_t currPos, int32_t setPos, bool isLeft) {
+void PID_Pos(int32_t currPos, int32_t setPos, bool isLeft, bool step) {
+  SPAN_BEGIN(SPAN_ID_PID_POS);
   if (isLeft) {
-    PID_PosCfg(currPos, setPos, isLeft, &posLeftConfig);
+    PID_PosCfg(currPos, setPos, isLeft, step, &posLeftConfig);
   } else {
-    PID_PosCfg(currPos, setPos, isLeft, &posRightConfig);
+    PID_PosCfg(currPos, setPos, isLeft, step, &posRightConfig);
   }
+  SPAN_END(SPAN_ID_PID_POS);
 }
 #endif /* PL_CONFIG_HAS_POS_PID */
 
 #if PL_CONFIG_HAS_SPEED_PID
-static void PID_SpeedCfg(int32_t currSpeed, int32_t setSpeed, bool isLeft, PID_Config *config) {
+static void PID_SpeedCfg(int32_t currSpeed, int32_t setSpeed, bool isLeft, bool step, PID_Config *config) {
   int32_t speed;
   MOT_Direction direction=MOT_DIR_FORWARD;
   MOT_MotorDevice *motHandle;
@@ -366,8 +465,10 @@ static void PID_SpeedCfg(int32_t currSpeed, int32_t setSpeed, bool isLeft, PID_C
     /* reset PID I and D values */
     config->integral = 0;
     config->lastError = 0;
+    config->lastValue = currSpeed;
+    config->dFiltered = 0;
   } else {
-    speed = PID(currSpeed, setSpeed, config);
+    speed = PID(currSpeed, setSpeed, PID_DRIVE_PERIOD_US, step, config);
   }
   if (speed>=0) {
     direction = MOT_DIR_FORWARD;
@@ -394,12 +495,14 @@ static void PID_SpeedCfg(int32_t currSpeed, int32_t setSpeed, bool isLeft, PID_C
   MOT_UpdatePercent(motHandle, direction);
 }
 
-void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft) {
+void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft, bool step) {
+  SPAN_BEGIN(SPAN_ID_PID_SPEED);
   if (isLeft) {
-    PID_SpeedCfg(currSpeed, setSpeed, isLeft, &speedLeftConfig);
+    PID_SpeedCfg(currSpeed, setSpeed, isLeft, step, &speedLeftConfig);
   } else {
-    PID_SpeedCfg(currSpeed, setSpeed, isLeft, &speedRightConfig);
+    PID_SpeedCfg(currSpeed, setSpeed, isLeft, step, &speedRightConfig);
   }
+  SPAN_END(SPAN_ID_PID_SPEED);
 }
 #endif /* PL_CONFIG_HAS_SPEED_PID */
 
@@ -407,28 +510,42 @@ void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft) {
 static void PID_PrintHelp(const McuShell_StdIOType *io) {
   McuShell_SendHelpStr((unsigned char*)"pid", (unsigned char*)"Group of PID commands\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows PID help or status\r\n", io->stdOut);
+#if PL_CONFIG_HAS_CONFIG_NVM
+  McuShell_SendHelpStr((unsigned char*)"  save", (unsigned char*)"Stores the parameters in flash, used with the next start\r\n", io->stdOut);
+#endif
+#if PID_CONFIG_BENCHMARK
+  McuShell_SendHelpStr((unsigned char*)"  bench", (unsigned char*)"Measures cycles of the previous integer and the fixed point PID\r\n", io->stdOut);
+#endif
 #if PL_CONFIG_HAS_POS_PID
   McuShell_SendHelpStr((unsigned char*)"  pos (p|i|d|w) <value>", (unsigned char*)"Sets P, I, D or anti-Windup position value\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  pos speed <value>", (unsigned char*)"Maximum speed % value\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  pos (ff|limit) <value>", (unsigned char*)"Sets feed-forward factor or output limit for anti-windup\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  pos filter <value>", (unsigned char*)"Sets derivative filter shift (0-8, 0: no filter)\r\n", io->stdOut);
 #endif
 #if PL_CONFIG_HAS_SPEED_PID
   McuShell_SendHelpStr((unsigned char*)"  speed (L|R) (p|i|d|w) <value>", (unsigned char*)"Sets P, I, D or anti-Windup position value\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  speed (L|R) speed <value>", (unsigned char*)"Maximum speed % value\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  speed (L|R) (ff|limit) <value>", (unsigned char*)"Sets feed-forward factor or output limit for anti-windup\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  speed (L|R) filter <value>", (unsigned char*)"Sets derivative filter shift (0-8, 0: no filter)\r\n", io->stdOut);
 #endif
 #if PL_CONFIG_HAS_LINE_PID
   McuShell_SendHelpStr((unsigned char*)"  fw (p|i|d|w) <value>", (unsigned char*)"Sets P, I, D or anti-Windup line value\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  fw speed <value>", (unsigned char*)"Maximum speed % value\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  fw (ff|limit) <value>", (unsigned char*)"Sets feed-forward factor or output limit for anti-windup\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  fw filter <value>", (unsigned char*)"Sets derivative filter shift (0-8, 0: no filter)\r\n", io->stdOut);
 #endif
 #if PL_CONFIG_GO_DEADEND_BW
   McuShell_SendHelpStr((unsigned char*)"  bw (p|i|d|w) <value>", (unsigned char*)"Sets P, I, D or anti-Windup backward value\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  bw speed <value>", (unsigned char*)"Maximum backward speed % value\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  bw (ff|limit) <value>", (unsigned char*)"Sets feed-forward factor or output limit for anti-windup\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  bw filter <value>", (unsigned char*)"Sets derivative filter shift (0-8, 0: no filter)\r\n", io->stdOut);
 #endif
 }
 
 #if PL_CONFIG_HAS_SPEED_PID || PL_CONFIG_HAS_POS_PID || PL_CONFIG_HAS_LINE_PID
 static void PrintPIDstatus(PID_Config *config, const unsigned char *kindStr, const McuShell_StdIOType *io) {
   unsigned char buf[48];
-  unsigned char kindBuf[16];
+  unsigned char kindBuf[24];
 
   McuUtility_strcpy(kindBuf, sizeof(buf), (unsigned char*)"  ");
   McuUtility_strcat(kindBuf, sizeof(buf), kindStr);
@@ -442,6 +559,25 @@ static void PrintPIDstatus(PID_Config *config, const unsigned char *kindStr, con
   McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
   McuShell_SendStatusStr(kindBuf, buf, io->stdOut);
 
+  McuUtility_strcpy(kindBuf, sizeof(buf), (unsigned char*)"  ");
+  McuUtility_strcat(kindBuf, sizeof(buf), kindStr);
+  McuUtility_strcat(kindBuf, sizeof(buf), (unsigned char*)" ff");
+  McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"ff: ");
+  McuUtility_strcatNum32s(buf, sizeof(buf), config->ffFactor100);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" limit: ");
+  McuUtility_strcatNum32s(buf, sizeof(buf), config->outLimit);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" filter: ");
+  McuUtility_strcatNum8u(buf, sizeof(buf), config->dFilterShift);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  McuShell_SendStatusStr(kindBuf, buf, io->stdOut);
+
+  McuUtility_strcpy(kindBuf, sizeof(buf), (unsigned char*)"  ");
+  McuUtility_strcat(kindBuf, sizeof(buf), kindStr);
+  McuUtility_strcat(kindBuf, sizeof(buf), (unsigned char*)" cycles");
+  McuUtility_Num32uToStr(buf, sizeof(buf), config->maxCycles);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" max\r\n");
+  McuShell_SendStatusStr(kindBuf, buf, io->stdOut);
+
   McuUtility_strcpy(kindBuf, sizeof(buf), (unsigned char*)"  ");
   McuUtility_strcat(kindBuf, sizeof(buf), kindStr);
   McuUtility_strcat(kindBuf, sizeof(buf), (unsigned char*)" windup");
@@ -472,6 +608,84 @@ static void PrintPIDstatus(PID_Config *config, const unsigned char *kindStr, con
 }
 #endif
 
+#if PID_CONFIG_BENCHMARK
+#define PID_BENCH_NOF_ITERATIONS  (100)
+
+/* previous PID implementation with division by 100 for each part, only used for comparison */
+static int32_t PID_Integer(int32_t currVal, int32_t setVal, PID_Config *config) {
+  int32_t error;
+  int32_t pid;
+
+  error = setVal-currVal; /* calculate error */
+  pid = (error*config->pFactor100)/100; /* P part */
+  config->integral += error; /* integrate error */
+  if (config->integral>config->iAntiWindup) {
+    config->integral = config->iAntiWindup;
+  } else if (config->integral<-config->iAntiWindup) {
+    config->integral = -config->iAntiWindup;
+  }
+  if (config->integral > 0xffff) {
+    config->integral = 0xffff;
+  } else if (config->integral < -0xffff) {
+    config->integral = -0xffff;
+  }
+  pid += (config->integral*config->iFactor100)/100; /* add I part */
+  pid += ((error-config->lastError)*config->dFactor100)/100; /* add D part */
+  config->lastError = error; /* remember for next iteration of D part */
+  return pid;
+}
+
+static void PID_BenchConfig(PID_Config *orig, const unsigned char *kindStr, int32_t amplitude, uint32_t dtUs, const McuShell_StdIOType *io) {
+  PID_Config config;
+  uint32_t cycles, cyclesInteger, cyclesFixed;
+  int32_t val, sum;
+  int i;
+
+  config = *orig; /* work on a copy, do not disturb the running loops */
+  config.integral = 0;
+  config.lastError = 0;
+  cyclesInteger = 0;
+  cyclesFixed = 0;
+  sum = 0;
+  for(i=0; i<PID_BENCH_NOF_ITERATIONS; i++) {
+    val = ((i*37)%(2*amplitude+1))-amplitude; /* synthetic measurement around the set value 0 */
+    cycles = McuArmTools_GetCycleCounter();
+    sum += PID_Integer(val, 0, &config);
+    cyclesInteger += McuArmTools_GetCycleCounter()-cycles;
+  }
+  config.integral = 0;
+  config.lastError = 0;
+  config.dFiltered = 0;
+  PID_ConfigChanged(&config); /* calculate gains outside of the measurement */
+  (void)PID(0, 0, dtUs, TRUE, &config);
+  for(i=0; i<PID_BENCH_NOF_ITERATIONS; i++) {
+    val = ((i*37)%(2*amplitude+1))-amplitude;
+    cycles = McuArmTools_GetCycleCounter();
+    sum += PID(val, 0, dtUs, TRUE, &config);
+    cyclesFixed += McuArmTools_GetCycleCounter()-cycles;
+  }
+  (void)sum; /* only used so the calculation is not optimized away */
+  McuShell_SendStatusStr(kindStr, (unsigned char*)"integer ", io->stdOut);
+  McuShell_SendNum32u(cyclesInteger/PID_BENCH_NOF_ITERATIONS, io->stdOut);
+  McuShell_SendStr((unsigned char*)", fixed point ", io->stdOut);
+  McuShell_SendNum32u(cyclesFixed/PID_BENCH_NOF_ITERATIONS, io->stdOut);
+  McuShell_SendStr((unsigned char*)" cycles/iteration\r\n", io->stdOut);
+}
+
+static void PID_Benchmark(const McuShell_StdIOType *io) {
+  McuShell_SendStatusStr((unsigned char*)"pid bench", (unsigned char*)"\r\n", io->stdOut);
+#if PL_CONFIG_HAS_POS_PID
+  PID_BenchConfig(&posLeftConfig, (unsigned char*)"  pos", 500, PID_DRIVE_PERIOD_US, io);
+#endif
+#if PL_CONFIG_HAS_SPEED_PID
+  PID_BenchConfig(&speedLeftConfig, (unsigned char*)"  speed", 3000, PID_DRIVE_PERIOD_US, io);
+#endif
+#if PL_CONFIG_HAS_LINE_PID
+  PID_BenchConfig(&lineFwConfig, (unsigned char*)"  line", 2000, PID_LINE_PERIOD_US, io);
+#endif
+}
+#endif /* PID_CONFIG_BENCHMARK */
+
 static void PID_PrintStatus(const McuShell_StdIOType *io) {
 #if PL_CONFIG_HAS_LINE_PID || PL_CONFIG_GO_DEADEND_BW || PL_CONFIG_HAS_POS_PID || PL_CONFIG_HAS_SPEED_PID
   McuShell_SendStatusStr((unsigned char*)"pid", (unsigned char*)"\r\n", io->stdOut);
@@ -493,117 +707,141 @@ static void PID_PrintStatus(const McuShell_StdIOType *io) {
 }
 
 #if PL_CONFIG_HAS_SPEED_PID || PL_CONFIG_HAS_POS_PID || PL_CONFIG_HAS_LINE_PID
-static uint8_t ParsePidParameter(PID_Config *config, const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-  const unsigned char *p;
-  uint32_t val32u;
-  uint8_t val8u;
-  uint8_t res = ERR_OK;
+/* sets one parameter, e.g. 'i' for 'pid pos i 300' */
+static uint8_t PID_SetParameter(PID_Config *config, const unsigned char *name, uint32_t val, const McuShell_StdIOType *io) {
+  if (McuUtility_strcmp((char*)name, (char*)"p")==0) {
+    config->pFactor100 = val;
+  } else if (McuUtility_strcmp((char*)name, (char*)"i")==0) {
+    config->iFactor100 = val;
+  } else if (McuUtility_strcmp((char*)name, (char*)"d")==0) {
+    config->dFactor100 = val;
+  } else if (McuUtility_strcmp((char*)name, (char*)"w")==0) {
+    config->iAntiWindup = val;
+  } else if (McuUtility_strcmp((char*)name, (char*)"speed")==0 && val<=100) {
+    config->maxSpeedPercent = (uint8_t)val;
+  } else if (McuUtility_strcmp((char*)name, (char*)"ff")==0) {
+    config->ffFactor100 = val;
+  } else if (McuUtility_strcmp((char*)name, (char*)"limit")==0) {
+    config->outLimit = val;
+  } else if (McuUtility_strcmp((char*)name, (char*)"filter")==0 && val<=8) {
+    config->dFilterShift = (uint8_t)val;
+  } else {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  PID_ConfigChanged(config);
+  return ERR_OK;
+}
+#endif
 
-  if (McuUtility_strncmp((char*)cmd, (char*)"p ", sizeof("p ")-1)==0) {
-    p = cmd+sizeof("p");
-    if (McuUtility_ScanDecimal32uNumber(&p, &val32u)==ERR_OK) {
-      config->pFactor100 = val32u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"i ", sizeof("i ")-1)==0) {
-    p = cmd+sizeof("i");
-    if (McuUtility_ScanDecimal32uNumber(&p, &val32u)==ERR_OK) {
-      config->iFactor100 = val32u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"d ", sizeof("d ")-1)==0) {
-    p = cmd+sizeof("d");
-    if (McuUtility_ScanDecimal32uNumber(&p, &val32u)==ERR_OK) {
-      config->dFactor100 = val32u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"w ", sizeof("w ")-1)==0) {
-    p = cmd+sizeof("w");
-    if (McuUtility_ScanDecimal32uNumber(&p, &val32u)==ERR_OK) {
-      config->iAntiWindup = val32u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"speed ", sizeof("speed ")-1)==0) {
-    p = cmd+sizeof("speed");
-    if (McuUtility_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u<=100) {
-      config->maxSpeedPercent = val8u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
+#if PL_CONFIG_HAS_CONFIG_NVM
+static uint8_t PID_CmdSave(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  if (PID_SaveConfigs()!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"ERROR: failed storing parameters\r\n", io->stdErr);
+    return ERR_FAILED;
   }
-  return res;
+  return ERR_OK;
 }
 #endif
 
-uint8_t PID_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-  uint8_t res = ERR_OK;
+#if PID_CONFIG_BENCHMARK
+static uint8_t PID_CmdBench(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  PID_Benchmark(io);
+  return ERR_OK;
+}
+#endif
 
-  if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_HELP)==0 || McuUtility_strcmp((char*)cmd, (char*)"pid help")==0) {
-    PID_PrintHelp(io);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_STATUS)==0 || McuUtility_strcmp((char*)cmd, (char*)"pid status")==0) {
-    PID_PrintStatus(io);
-    *handled = TRUE;
 #if PL_CONFIG_HAS_LINE_PID
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"pid fw ", sizeof("pid fw ")-1)==0) {
-    res = ParsePidParameter(&lineFwConfig, cmd+sizeof("pid fw ")-1, handled, io);
+static uint8_t PID_CmdFw(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  return PID_SetParameter(&lineFwConfig, args[0].str, args[1].u, io);
+}
 #endif
+
 #if PL_CONFIG_GO_DEADEND_BW
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"pid bw ", sizeof("pid bw ")-1)==0) {
-    res = ParsePidParameter(&lineBwConfig, cmd+sizeof("pid bw ")-1, handled, io);
+static uint8_t PID_CmdBw(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  return PID_SetParameter(&lineBwConfig, args[0].str, args[1].u, io);
+}
 #endif
+
 #if PL_CONFIG_HAS_POS_PID
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"pid pos ", sizeof("pid pos ")-1)==0) {
-    res = ParsePidParameter(&posLeftConfig, cmd+sizeof("pid pos ")-1, handled, io);
-    if (res==ERR_OK) {
-      res = ParsePidParameter(&posRightConfig, cmd+sizeof("pid pos ")-1, handled, io);
-    }
+static uint8_t PID_CmdPos(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (PID_SetParameter(&posLeftConfig, args[0].str, args[1].u, io)!=ERR_OK) {
+    return ERR_FAILED;
+  }
+  return PID_SetParameter(&posRightConfig, args[0].str, args[1].u, io);
+}
 #endif
+
 #if PL_CONFIG_HAS_SPEED_PID
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"pid speed L ", sizeof("pid speed L ")-1)==0) {
-    res = ParsePidParameter(&speedLeftConfig, cmd+sizeof("pid speed L ")-1, handled, io);
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"pid speed R ", sizeof("pid speed R ")-1)==0) {
-    res = ParsePidParameter(&speedRightConfig, cmd+sizeof("pid speed R ")-1, handled, io);
-#endif
-  }
-  return res;
+static uint8_t PID_CmdSpeedLeft(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  return PID_SetParameter(&speedLeftConfig, args[0].str, args[1].u, io);
 }
+
+static uint8_t PID_CmdSpeedRight(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  return PID_SetParameter(&speedRightConfig, args[0].str, args[1].u, io);
+}
+#endif
+
+/* the parameter name is the first argument, so one command per PID */
+static const CMD_Command PID_Cmds[] = {
+#if PL_CONFIG_HAS_CONFIG_NVM
+  {"save",    "",   PID_CmdSave},
+#endif
+#if PID_CONFIG_BENCHMARK
+  {"bench",   "",   PID_CmdBench},
+#endif
+#if PL_CONFIG_HAS_LINE_PID
+  {"fw",      "su", PID_CmdFw},
+#endif
+#if PL_CONFIG_GO_DEADEND_BW
+  {"bw",      "su", PID_CmdBw},
+#endif
+#if PL_CONFIG_HAS_POS_PID
+  {"pos",     "su", PID_CmdPos},
+#endif
+#if PL_CONFIG_HAS_SPEED_PID
+  {"speed L", "su", PID_CmdSpeedLeft},
+  {"speed R", "su", PID_CmdSpeedRight},
+#endif
+};
+
+const CMD_Group PID_CmdGroup = CMD_GROUP("pid", PID_PrintHelp, PID_PrintStatus, PID_Cmds);
 #endif /* PL_CONFIG_HAS_SHELL */
 
 void PID_Start(void) {
 #if PL_CONFIG_HAS_LINE_PID
   lineFwConfig.lastError = 0;
   lineFwConfig.integral = 0;
+  lineFwConfig.dFiltered = 0;
+  PID_ConfigChanged(&lineFwConfig);
 #endif
 #if PL_CONFIG_GO_DEADEND_BW
   lineBwConfig.lastError = 0;
   lineBwConfig.integral = 0;
+  lineBwConfig.dFiltered = 0;
+  PID_ConfigChanged(&lineBwConfig);
 #endif
 #if PL_CONFIG_HAS_POS_PID
   posLeftConfig.lastError = 0;
   posLeftConfig.integral = 0;
+  posLeftConfig.dFiltered = 0;
+  PID_ConfigChanged(&posLeftConfig);
   posRightConfig.lastError = 0;
   posRightConfig.integral = 0;
+  posRightConfig.dFiltered = 0;
+  PID_ConfigChanged(&posRightConfig);
 #endif
 #if PL_CONFIG_HAS_SPEED_PID
   speedLeftConfig.lastError = 0;
   speedLeftConfig.integral = 0;
+  speedLeftConfig.dFiltered = 0;
+  PID_ConfigChanged(&speedLeftConfig);
   speedRightConfig.lastError = 0;
   speedRightConfig.integral = 0;
+  speedRightConfig.dFiltered = 0;
+  PID_ConfigChanged(&speedRightConfig);
 #endif
 }
 
@@ -619,8 +857,10 @@ void PID_Init(void) {
   lineFwConfig.maxSpeedPercent = 0;
   lineFwConfig.lastError = 0;
   lineFwConfig.integral = 0;
-  lineFwConfig.lastError = 0;
-  lineFwConfig.integral = 0;
+  lineFwConfig.ffFactor100 = 0;
+  lineFwConfig.outLimit = 0;
+  lineFwConfig.dFilterShift = 0;
+  PID_ConfigChanged(&lineFwConfig);
 #if PL_CONFIG_GO_DEADEND_BW
   lineBwConfig.param = 0;
   lineBwConfig.pFactor100 = 0;
@@ -641,6 +881,10 @@ void PID_Init(void) {
   posLeftConfig.maxSpeedPercent = 0;
   posLeftConfig.lastError = 0;
   posLeftConfig.integral = 0;
+  posLeftConfig.ffFactor100 = 0;
+  posLeftConfig.outLimit = 0;
+  posLeftConfig.dFilterShift = 0;
+  PID_ConfigChanged(&posLeftConfig);
   posRightConfig.pFactor100 = posLeftConfig.pFactor100;
   posRightConfig.iFactor100 = posLeftConfig.iFactor100;
   posRightConfig.dFactor100 = posLeftConfig.dFactor100;
@@ -648,6 +892,10 @@ void PID_Init(void) {
   posRightConfig.maxSpeedPercent = posLeftConfig.maxSpeedPercent;
   posRightConfig.lastError = posLeftConfig.lastError;
   posRightConfig.integral = posLeftConfig.integral;
+  posRightConfig.ffFactor100 = posLeftConfig.ffFactor100;
+  posRightConfig.outLimit = posLeftConfig.outLimit;
+  posRightConfig.dFilterShift = posLeftConfig.dFilterShift;
+  PID_ConfigChanged(&posRightConfig);
 #endif
 #if PL_CONFIG_HAS_SPEED_PID
   speedLeftConfig.pFactor100 = 0;
@@ -657,6 +905,10 @@ void PID_Init(void) {
   speedLeftConfig.maxSpeedPercent = 0;
   speedLeftConfig.lastError = 0;
   speedLeftConfig.integral = 0;
+  speedLeftConfig.ffFactor100 = 0;
+  speedLeftConfig.outLimit = 0;
+  speedLeftConfig.dFilterShift = 0;
+  PID_ConfigChanged(&speedLeftConfig);
   speedRightConfig.pFactor100 = speedLeftConfig.pFactor100;
   speedRightConfig.iFactor100 = speedLeftConfig.iFactor100;
   speedRightConfig.dFactor100 = speedLeftConfig.dFactor100;
@@ -664,6 +916,10 @@ void PID_Init(void) {
   speedRightConfig.maxSpeedPercent = speedLeftConfig.maxSpeedPercent;
   speedRightConfig.lastError = speedLeftConfig.lastError;
   speedRightConfig.integral = speedLeftConfig.integral;
+  speedRightConfig.ffFactor100 = speedLeftConfig.ffFactor100;
+  speedRightConfig.outLimit = speedLeftConfig.outLimit;
+  speedRightConfig.dFilterShift = speedLeftConfig.dFilterShift;
+  PID_ConfigChanged(&speedRightConfig);
 #endif
 }
 #endif /* PL_HAS_PID */
@@ -19,27 +19,61 @@ typedef enum {
   PID_CONFIG_SPEED_RIGHT
 } PID_ConfigType;
 
+#define PID_REF_PERIOD_US  (5000)
+  /*!< sample period in micro seconds the I and D factors are specified for. For other sample periods they get scaled */
+
+typedef struct {
+  int32_t kp;      /*!< proportional gain, Q16.16 */
+  int32_t ki;      /*!< integral gain, Q16.16 */
+  int32_t kd;      /*!< derivative gain, scaled for the sample period, Q16.16 */
+  int32_t kff;     /*!< feed-forward gain, Q16.16 */
+  int32_t kaw;     /*!< back-calculation gain (inverse of ki), output to integral units, Q16.16 */
+  int32_t dtRatio; /*!< sample period relative to PID_REF_PERIOD_US, Q16.16 */
+  uint32_t dtUs;   /*!< sample period the gains are calculated for, 0 if they need to be calculated */
+} PID_FixedGains;
+
 typedef struct {
   int32_t pFactor100;
   int32_t iFactor100;
   int32_t dFactor100;
+  int32_t ffFactor100;     /* feed-forward factor for the set value, e.g. speed to PWM */
   int32_t iAntiWindup;
+  int32_t outLimit;        /* output saturation used for back-calculation anti-windup, 0 for no limit */
+  uint8_t dFilterShift;    /* low pass filter of the derivative: 0 for no filter, n for a filter factor of 1/(2^n) */
   uint8_t maxSpeedPercent; /* max speed if 100% on the line, 0xffff would be full speed */
   int32_t lastError;
   int32_t integral;
+  int32_t lastValue;       /* measured value of the previous iteration, for derivative on measurement */
+  int32_t dFiltered;       /* filtered derivative part */
+  PID_FixedGains gains;    /* fixed point gains, calculated from the factors */
+  uint32_t maxCycles;      /* longest PID calculation, in CPU cycles */
 } PID_Config;
 
 uint8_t PID_GetPIDConfig(PID_ConfigType config, PID_Config **confP);
 
-#if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
 /*!
- * \brief Shell command line parser.
- * \param[in] cmd Pointer to command string
- * \param[out] handled If command is handled by the parser
- * \param[in] io Std I/O handler of shell
+ * \brief Has to be called after changing the factors of a configuration, so the fixed point gains get updated.
+ * \param config Configuration which has been changed
+ */
+void PID_ConfigChanged(PID_Config *config);
+
+#if PL_CONFIG_HAS_CONFIG_NVM
+/*!
+ * \brief Stores the parameters of all configurations in the flash.
+ * \return ERR_OK if all have been stored
  */
-uint8_t PID_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+uint8_t PID_SaveConfigs(void);
+
+/*!
+ * \brief Sets the parameters of the configurations which have been stored in the flash.
+ */
+void PID_LoadConfigs(void);
+#endif
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the PID controllers, registered in Shell.c */
+extern const CMD_Group PID_CmdGroup;
 #endif
 
 /*!
@@ -56,16 +90,18 @@ void PID_Line(uint16_t currLinePos, uint16_t setLinePos, uint16_t currLineWidth,
  * \param currSpeed Current speed of motor
  * \param setSpeed desired speed of motor
  * \param isLeft TRUE if is for the left motor, otherwise for the right motor
+ * \param step TRUE in the 5 ms control period, FALSE for a new setpoint in between: only the output is updated
  */
-void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft);
+void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft, bool step);
 
 /*!
  * \brief Performs PID closed loop calculation for the line position
  * \param currPos Current position of wheel
  * \param setPos Desired wheel position
  * \param isLeft TRUE if is for the left wheel, otherwise for the right wheel
+ * \param step TRUE in the 5 ms control period, FALSE for a new setpoint in between: only the output is updated
  */
-void PID_Pos(int32_t currPos, int32_t setPos, bool isLeft);
+void PID_Pos(int32_t currPos, int32_t setPos, bool isLeft, bool step);
 
 /*! \brief Driver initialization */
 void PID_Start(void);
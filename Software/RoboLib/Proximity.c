@@ -4,162 +4,299 @@
  * \author Erich Styger, erich.styger@hslu.ch
  *
  * This module handles the proximity (IR) sensors to detect an obstacle or another robot.
+ * A scan turns on the left and right IR sender alternately, with increasing burst durations.
+ * The longer a sender has to be on until a receiver sees the reflection, the weaker the reflection.
+ * The number of burst levels seen by each receiver gives the intensity and the bearing of the target.
  */
 
 #include "McuLib.h"
 #include "Proximity.h"
 #include "McuUtility.h"
+#include "McuArmTools.h"
 #include "Pin.h"
+#include "SensorBus.h"
+#include <string.h>
+#if PROX_CONFIG_USE_BURST_TIMER
+  #include "Timer.h"
+#endif
+#if PL_CONFIG_HAS_TRACKER
+  #include "Tracker.h"
+#endif
+#if PL_CONFIG_HAS_SUMO
+  #include "Sumo.h"
+#endif
 
 #define PROX_NOF_LEVELS    5
-static const int PROX_durationBurstUs[PROX_NOF_LEVELS] = {50, 100, 200, 350, 500};
-
-static struct {
-  bool proximityFound;
-  PROX_Bits proximityBits;
-  int proximityAngle;
-  uint8_t countsLeft[PROX_NOF_SENSORS];
-  uint8_t countsRight[PROX_NOF_SENSORS];
-} PROX_status;
-
-static const int16_t PROX_Angles[] = {
-		      /* LL LM LR RL RM RR */
-	360,	  /* 0  0  0  0  0  0  */
-	 90,	  /* 0  0  0  0  0  1  */
-	 10,	  /* 0  0  0  0  1  0  */
-	 45,	  /* 0  0  0  0  1  1  */
-	-10,	  /* 0  1  0  0  0  0  */
-	  0,    /* 0  1  0  0  0  1  */
-	  0,    /* 0  1  0  0  1  0  */
-	 30,    /* 0  1  0  0  1  1  */
-	-90,    /* 1  0  0  0  0  0  */
-	360,    /* 1  0  0  0  0  1  */
-	-30,    /* 1  0  0  0  1  0  */
-	 45,    /* 1  0  0  0  1  1  */
-	-45,    /* 1  1  0  0  0  0  */
-	-45,    /* 1  1  0  0  0  1  */
-	-30,    /* 1  1  0  0  1  0  */
-	  0,    /* 1  1  0  0  1  1  */
-};
-
-static void CheckProx(bool isLeft, PROX_Bits *proxBits) {
-	/* Signal is active LOW: low means we have a reflection */
-	if (isLeft) {
-		if (PIN_IsPinLow(PIN_PROX_L)) {
-			*proxBits |= PROX_L_LEFT_BIT;
-		}
-		if (PIN_IsPinLow(PIN_PROX_M)) {
-			*proxBits |= PROX_L_MIDDLE_BIT;
-		}
-    if (PIN_IsPinLow(PIN_PROX_R)) {
-      *proxBits |= PROX_L_RIGHT_BIT;
-    }
-	} else {
-    if (PIN_IsPinLow(PIN_PROX_L)) {
-      *proxBits |= PROX_R_LEFT_BIT;
-    }
-		if (PIN_IsPinLow(PIN_PROX_M)) {
-			*proxBits |= PROX_R_MIDDLE_BIT;
-		}
-		if (PIN_IsPinLow(PIN_PROX_R)) {
-			*proxBits |= PROX_R_RIGHT_BIT;
-		}
-	}
-}
+static const uint16_t PROX_durationBurstUs[PROX_NOF_LEVELS] = {50, 100, 200, 350, 500};
 
-uint8_t PROX_GetNofWithLeftLeds(uint8_t sensorIdx) {
-  if (sensorIdx>=PROX_NOF_SENSORS) {
-    return 0; /* error */
+#define PROX_SLOT_US       1000 /* time for each burst: sender on, sample at the end of the burst, then switch to the other sender */
+#define PROX_SCAN_PERIOD_MS  100 /* scan period without the burst timer */
+
+/* Bearing of the reflection for each sender/receiver pair used. Left sender with right receiver and
+   right sender with left receiver are ignored, as they see 'strange' reflections. */
+#define PROX_ANGLE_LL     (-90)
+#define PROX_ANGLE_LM     (-10)
+#define PROX_ANGLE_RM     (10)
+#define PROX_ANGLE_RR     (90)
+
+#define PROX_FILTER_SHIFT   2 /* low pass filter for the intensities: new = old+(raw-old)/4 */
+
+typedef struct {
+  uint8_t left[PROX_NOF_SENSORS];  /* burst levels seen with the left sender */
+  uint8_t right[PROX_NOF_SENSORS]; /* burst levels seen with the right sender */
+  uint32_t timestamp;              /* cycle counter at the end of the scan */
+} PROX_Counts;
+
+static SBUS_Channel PROX_resultChannel; /* results published by ProxTask or the executive */
+static PROX_Result PROX_resultBuf[2]; /* buffers of the channel */
+#if PL_CONFIG_HAS_EXEC
+#if !PROX_CONFIG_USE_BURST_TIMER
+  #error "the executive cannot wait for the bursts"
+#endif
+static bool PROX_scanning; /* if the burst timer has been started */
+static uint32_t PROX_handledTimestamp; /* timestamp of the last scan handled by the executive */
+#else
+static TaskHandle_t PROX_taskHndl;
+#endif
+
+static struct { /* filter state */
+  uint32_t scanNo;
+  bool found;       /* target found in previous scan */
+  int angle;        /* filtered bearing */
+  int32_t intensity[PROX_NOF_SENSORS]; /* filtered intensity, scaled by (1<<PROX_FILTER_SHIFT) */
+} PROX_Filter;
+
+#if PROX_CONFIG_USE_BURST_TIMER
+/* The burst timer interrupt runs the scan: each slot selects a sender, samples the receivers after the
+   burst duration of the slot and keeps the sender on for the rest of the slot. Slots alternate between
+   left and right sender, so each sender burst starts after the other sender has been on for a while. */
+#define PROX_NOF_SLOTS     (2*PROX_NOF_LEVELS)
+
+static PROX_Counts PROX_scanCounts;  /* counts of the scan in progress, only used by the interrupt */
+static PROX_Counts PROX_lastCounts;  /* counts of the last complete scan */
+static SBUS_SeqLock PROX_lastCountsLock;
+static uint8_t PROX_slot;            /* current slot, even: left sender, odd: right sender */
+static bool PROX_inBurst;            /* if waiting for the end of the burst, otherwise for the end of the slot */
+
+static void PROX_StartSlot(void) {
+  if ((PROX_slot&1)==0) {
+    PIN_SetHigh(PIN_PROX_IR_SELECT); /* HIGH: select left IR sender */
+  } else {
+    PIN_SetLow(PIN_PROX_IR_SELECT); /* LOW: select right IR sender */
   }
-  return PROX_status.countsLeft[sensorIdx];
+  PROX_inBurst = TRUE;
 }
 
-uint8_t PROX_GetNofWithRightLeds(uint8_t sensorIdx) {
-  if (sensorIdx>=PROX_NOF_SENSORS) {
-    return 0; /* error */
+void PROX_OnBurstTimerInterrupt(void) {
+  uint8_t *counts;
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  if (PROX_inBurst) { /* end of burst: sample the receivers, signal is active LOW */
+    counts = (PROX_slot&1)==0?PROX_scanCounts.left:PROX_scanCounts.right;
+    if (PIN_IsPinLow(PIN_PROX_L)) {
+      counts[0]++;
+    }
+    if (PIN_IsPinLow(PIN_PROX_M)) {
+      counts[1]++;
+    }
+    if (PIN_IsPinLow(PIN_PROX_R)) {
+      counts[2]++;
+    }
+    PROX_inBurst = FALSE;
+    TMRP_SetInterval(PROX_SLOT_US-PROX_durationBurstUs[PROX_slot/2]);
+    return;
   }
-  return PROX_status.countsRight[sensorIdx];
+  /* end of slot */
+  PROX_slot++;
+  if (PROX_slot==PROX_NOF_SLOTS) { /* scan complete */
+    PROX_scanCounts.timestamp = McuArmTools_GetCycleCounter();
+    SBUS_WriteBegin(&PROX_lastCountsLock);
+    PROX_lastCounts = PROX_scanCounts;
+    SBUS_WriteEnd(&PROX_lastCountsLock);
+    memset(&PROX_scanCounts, 0, sizeof(PROX_scanCounts));
+    PROX_slot = 0;
+#if !PL_CONFIG_HAS_EXEC /* the executive checks the timestamp in each cycle */
+    vTaskNotifyGiveFromISR(PROX_taskHndl, &higherPriorityTaskWoken);
+#endif
+  }
+  PROX_StartSlot();
+  TMRP_SetInterval(PROX_durationBurstUs[PROX_slot/2]);
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
 }
 
-static bool PROX_CheckProximity(int *pAngle, uint8_t *pBits) {
-	uint8_t bits;
-  int i;
+static void PROX_GetLastCounts(PROX_Counts *counts) {
+  uint32_t seq;
 
-  for(i=0;i<PROX_NOF_SENSORS;i++) { /* init */
-    PROX_status.countsLeft[i] = 0;
-    PROX_status.countsRight[i] = 0;
-  }
+  do {
+    seq = SBUS_ReadBegin(&PROX_lastCountsLock);
+    *counts = PROX_lastCounts;
+  } while (SBUS_ReadRetry(&PROX_lastCountsLock, seq));
+}
 
+static void PROX_StartScanning(void) {
+  memset(&PROX_scanCounts, 0, sizeof(PROX_scanCounts));
+  PROX_slot = 0;
+  PROX_StartSlot();
+  TMRP_StartInterrupts(PROX_durationBurstUs[0]);
+}
+#else
+static void PROX_Scan(PROX_Counts *counts) {
+  int i;
+
+  memset(counts, 0, sizeof(PROX_Counts));
   /* check left side */
   for(i=0;i<PROX_NOF_LEVELS;i++) {
     PIN_SetHigh(PIN_PROX_IR_SELECT); /* HIGH: select left IR sender */
     McuWait_Waitus(PROX_durationBurstUs[i]);
     if (PIN_IsPinLow(PIN_PROX_L)) {
-      PROX_status.countsLeft[0]++;
+      counts->left[0]++;
     }
     if (PIN_IsPinLow(PIN_PROX_M)) {
-      PROX_status.countsLeft[1]++;
+      counts->left[1]++;
     }
     if (PIN_IsPinLow(PIN_PROX_R)) {
-      PROX_status.countsLeft[2]++;
+      counts->left[2]++;
     }
     PIN_SetLow(PIN_PROX_IR_SELECT); /* LOW: select Right IR sender */
     vTaskDelay(pdMS_TO_TICKS(1));
   }
   /* check right side */
   for(i=0;i<PROX_NOF_LEVELS;i++) {
-    PIN_SetLow(PIN_PROX_IR_SELECT); /* HIGH: select left IR sender */
+    PIN_SetLow(PIN_PROX_IR_SELECT); /* LOW: select right IR sender */
     McuWait_Waitus(PROX_durationBurstUs[i]);
     if (PIN_IsPinLow(PIN_PROX_L)) {
-      PROX_status.countsRight[0]++;
+      counts->right[0]++;
     }
     if (PIN_IsPinLow(PIN_PROX_M)) {
-      PROX_status.countsRight[1]++;
+      counts->right[1]++;
     }
     if (PIN_IsPinLow(PIN_PROX_R)) {
-      PROX_status.countsRight[2]++;
+      counts->right[2]++;
     }
     PIN_SetHigh(PIN_PROX_IR_SELECT); /* High: select left IR sender */
     vTaskDelay(pdMS_TO_TICKS(1));
   }
+  counts->timestamp = McuArmTools_GetCycleCounter();
+}
+#endif /* PROX_CONFIG_USE_BURST_TIMER */
 
-	*pBits = 0;
-#if 1
-	PIN_SetHigh(PIN_PROX_IR_SELECT); /* HIGH: select left IR sender */
-	vTaskDelay(pdMS_TO_TICKS(5)); /* give the LED some time */
-	CheckProx(true, pBits);
-#endif
-	PIN_SetLow(PIN_PROX_IR_SELECT); /* LOW: select right IR sender */
-	vTaskDelay(pdMS_TO_TICKS(5)); /* give the LED some time */
-	CheckProx(false, pBits);
-	bits = *pBits;
-#if 1 /* ignore the 'strange' bits */
-	bits = ((bits&(PROX_L_LEFT_BIT|PROX_L_MIDDLE_BIT))>>2) | (bits&(PROX_R_MIDDLE_BIT|PROX_R_RIGHT_BIT));
-#endif
-	if (bits<sizeof(PROX_Angles)/sizeof(PROX_Angles[0])) {
-		*pAngle = PROX_Angles[bits];
-		return (*pAngle!=360);
-	} else {
-		return FALSE;
-	}
+/*!
+ * \brief Decodes the counts of a scan into sensor bits and the bearing of the target.
+ * \param counts Counts of the scan
+ * \param result Where to store bits, counts, rawAngle and if a target has been found
+ */
+static void PROX_Decode(const PROX_Counts *counts, PROX_Result *result) {
+  static const PROX_Bits leftBits[PROX_NOF_SENSORS] = {PROX_L_LEFT_BIT, PROX_L_MIDDLE_BIT, PROX_L_RIGHT_BIT};
+  static const PROX_Bits rightBits[PROX_NOF_SENSORS] = {PROX_R_LEFT_BIT, PROX_R_MIDDLE_BIT, PROX_R_RIGHT_BIT};
+  int32_t weight, sum;
+  int bits = 0;
+  int i;
+
+  for(i=0;i<PROX_NOF_SENSORS;i++) {
+    result->countsLeft[i] = counts->left[i];
+    result->countsRight[i] = counts->right[i];
+    if (counts->left[i]>0) {
+      bits |= leftBits[i];
+    }
+    if (counts->right[i]>0) {
+      bits |= rightBits[i];
+    }
+  }
+  result->proximityBits = (PROX_Bits)bits;
+  /* weighted average of the bearings, stronger reflections count more */
+  weight = counts->left[0]+counts->left[1]+counts->right[1]+counts->right[2];
+  sum = counts->left[0]*PROX_ANGLE_LL + counts->left[1]*PROX_ANGLE_LM
+      + counts->right[1]*PROX_ANGLE_RM + counts->right[2]*PROX_ANGLE_RR;
+  if (weight==0) {
+    result->proximityFound = FALSE; /* nothing seen */
+    result->rawAngle = 0;
+  } else if (counts->left[1]==0 && counts->right[1]==0 && counts->left[0]>0 && counts->right[2]>0) {
+    result->proximityFound = FALSE; /* seen on both sides, but not in the middle: not a single target */
+    result->rawAngle = 0;
+  } else {
+    result->proximityFound = TRUE;
+    result->rawAngle = sum/weight;
+  }
+}
+
+/*!
+ * \brief Low pass filters intensities and bearing over the scans.
+ * \param result Decoded scan, the filtered values are stored into it
+ */
+static void PROX_FilterResult(PROX_Result *result) {
+  int32_t raw;
+  int i;
+
+  for(i=0;i<PROX_NOF_SENSORS;i++) {
+    raw = ((result->countsLeft[i]+result->countsRight[i])*100)/(2*PROX_NOF_LEVELS); /* percent */
+    raw <<= PROX_FILTER_SHIFT;
+    PROX_Filter.intensity[i] += (raw-PROX_Filter.intensity[i])>>PROX_FILTER_SHIFT;
+    result->intensity[i] = (uint8_t)(PROX_Filter.intensity[i]>>PROX_FILTER_SHIFT);
+  }
+  if (result->proximityFound) {
+    if (PROX_Filter.found) {
+      PROX_Filter.angle += (result->rawAngle-PROX_Filter.angle)/2;
+    } else { /* new target: no history */
+      PROX_Filter.angle = result->rawAngle;
+    }
+  }
+  PROX_Filter.found = result->proximityFound;
+  result->proximityAngle = PROX_Filter.angle;
+  result->scanNo = ++PROX_Filter.scanNo;
+}
+
+bool PROX_GetResult(PROX_Result *result, SBUS_Stamp *stamp) {
+  return SBUS_Read(&PROX_resultChannel, result, stamp);
+}
+
+uint8_t PROX_GetNofWithLeftLeds(uint8_t sensorIdx) {
+  PROX_Result result;
+
+  if (sensorIdx>=PROX_NOF_SENSORS) {
+    return 0; /* error */
+  }
+  (void)PROX_GetResult(&result, NULL);
+  return result.countsLeft[sensorIdx];
+}
+
+uint8_t PROX_GetNofWithRightLeds(uint8_t sensorIdx) {
+  PROX_Result result;
+
+  if (sensorIdx>=PROX_NOF_SENSORS) {
+    return 0; /* error */
+  }
+  (void)PROX_GetResult(&result, NULL);
+  return result.countsRight[sensorIdx];
 }
 
 bool PROX_HasTarget(void) {
-	return PROX_status.proximityFound;
+	PROX_Result result;
+
+	(void)PROX_GetResult(&result, NULL);
+	return result.proximityFound;
 }
 
 PROX_Bits PROX_GetProxBits(void) {
-	return PROX_status.proximityBits;
+	PROX_Result result;
+
+	(void)PROX_GetResult(&result, NULL);
+	return result.proximityBits;
 }
 
 int PROX_GetTargetAngle(void) {
-	return PROX_status.proximityAngle;
+	PROX_Result result;
+
+	(void)PROX_GetResult(&result, NULL);
+	return result.proximityAngle;
 }
 
 #if PL_CONFIG_HAS_SHELL
 uint8_t PROX_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
   uint8_t res=ERR_OK;
   uint8_t buf[24];
+  PROX_Result result;
+  SBUS_Stamp stamp;
+  int i;
 
   if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_HELP)==0 || McuUtility_strcmp((const char *)cmd, "prox help")==0) {
     McuShell_SendHelpStr((const unsigned char*)"prox", (const unsigned char*)"Prox command group\r\n", io->stdOut);
@@ -167,55 +304,120 @@ uint8_t PROX_ParseCommand(const unsigned char *cmd, bool *handled, const McuShel
     McuShell_SendHelpStr((const unsigned char*)"  reset", (const unsigned char*)"Reset the current position counter\r\n", io->stdOut);
     *handled = TRUE;
   } else if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_STATUS)==0 || McuUtility_strcmp((const char*)cmd, "prox status")==0) {
+    (void)PROX_GetResult(&result, &stamp);
     McuShell_SendStr((const unsigned char*)"  prox:\r\n", io->stdOut);
-    McuShell_SendStatusStr((unsigned char*)"  target:", PROX_HasTarget()?(unsigned char*)"yes\r\n":(unsigned char*)"no\r\n", io->stdOut);
-    McuUtility_strcpy(buf, sizeof(buf), (PROX_status.proximityBits&PROX_L_LEFT_BIT)?(uint8_t*)"L":(uint8_t*)".");
-   	McuUtility_strcat(buf, sizeof(buf), (PROX_status.proximityBits&PROX_L_MIDDLE_BIT)?(uint8_t*)"M|":(uint8_t*)".|");
-   	McuUtility_strcat(buf, sizeof(buf), (PROX_status.proximityBits&PROX_R_MIDDLE_BIT)?(uint8_t*)"M":(uint8_t*)".");
-   	McuUtility_strcat(buf, sizeof(buf), (PROX_status.proximityBits&PROX_R_RIGHT_BIT)?(uint8_t*)"R":(uint8_t*)".");
+    McuShell_SendStatusStr((unsigned char*)"  target:", result.proximityFound?(unsigned char*)"yes\r\n":(unsigned char*)"no\r\n", io->stdOut);
+    McuUtility_strcpy(buf, sizeof(buf), (result.proximityBits&PROX_L_LEFT_BIT)?(uint8_t*)"L":(uint8_t*)".");
+   	McuUtility_strcat(buf, sizeof(buf), (result.proximityBits&PROX_L_MIDDLE_BIT)?(uint8_t*)"M|":(uint8_t*)".|");
+   	McuUtility_strcat(buf, sizeof(buf), (result.proximityBits&PROX_R_MIDDLE_BIT)?(uint8_t*)"M":(uint8_t*)".");
+   	McuUtility_strcat(buf, sizeof(buf), (result.proximityBits&PROX_R_RIGHT_BIT)?(uint8_t*)"R":(uint8_t*)".");
     McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\r\n");
     McuShell_SendStatusStr((unsigned char*)"  IR:", buf, io->stdOut);
 
-    McuUtility_Num16sToStr(buf, sizeof(buf), PROX_status.proximityAngle);
-    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\r\n");
+    McuUtility_Num16sToStr(buf, sizeof(buf), result.proximityAngle);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)" (raw ");
+    McuUtility_strcatNum16s(buf, sizeof(buf), result.rawAngle);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)")\r\n");
     McuShell_SendStatusStr((unsigned char*)"  angle:", buf, io->stdOut);
+
+    buf[0] = '\0';
+    for(i=0;i<PROX_NOF_SENSORS;i++) {
+      McuUtility_strcatNum8u(buf, sizeof(buf), result.intensity[i]);
+      McuUtility_strcat(buf, sizeof(buf), i<PROX_NOF_SENSORS-1?(uint8_t*)"% ":(uint8_t*)"%\r\n");
+    }
+    McuShell_SendStatusStr((unsigned char*)"  intensity:", buf, io->stdOut);
+
+    McuUtility_Num32uToStr(buf, sizeof(buf), result.scanNo);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)", retries ");
+    McuUtility_strcatNum32u(buf, sizeof(buf), PROX_resultChannel.nofRetries);
+    McuUtility_strcat(buf, sizeof(buf), (uint8_t*)"\r\n");
+    McuShell_SendStatusStr((unsigned char*)"  scan:", buf, io->stdOut);
     *handled = TRUE;
   }
   return res;
 }
 #endif /* PL_CONFIG_HAS_SHELL */
 
+/*!
+ * \brief Decodes and publishes a complete scan, and tells the consumers about the target.
+ * \param counts Counts of the scan
+ */
+static void PROX_HandleScan(const PROX_Counts *counts) {
+  PROX_Result result;
+
+  PROX_Decode(counts, &result);
+  PROX_FilterResult(&result);
+  result.timestamp = counts->timestamp;
+  SBUS_Publish(&PROX_resultChannel, &result);
+#if PL_CONFIG_HAS_TRACKER
+  TRACK_OnProximity(&result); /* before notifying the consumers of the track */
+#endif
+#if PL_CONFIG_HAS_SUMO
+  if (result.proximityFound) {
+    SUMO_OnTarget();
+  }
+#endif
+}
+
+#if PL_CONFIG_HAS_EXEC
+void PROX_Process(void) {
+  PROX_Counts counts;
+
+  if (!PROX_scanning) { /* the timers are running now */
+    PROX_StartScanning();
+    PROX_scanning = TRUE;
+    return;
+  }
+  PROX_GetLastCounts(&counts);
+  if (counts.timestamp==PROX_handledTimestamp) {
+    return; /* no new scan since the last cycle */
+  }
+  PROX_handledTimestamp = counts.timestamp;
+  PROX_HandleScan(&counts);
+}
+#else
 static void ProxTask(void *pvParameters) {
-  int i, angle = 0;
-  uint8_t bits = 0;
+  PROX_Counts counts;
 
   (void)pvParameters; /* parameter not used */
-  PROX_status.proximityBits = 0;
-  PROX_status.proximityAngle = 0;
-  PROX_status.proximityFound = FALSE;
-  for(i=0;i<PROX_NOF_SENSORS;i++) { /* init */
-    PROX_status.countsLeft[i] = 0;
-    PROX_status.countsRight[i] = 0;
-  }
+#if PROX_CONFIG_USE_BURST_TIMER
+  PROX_StartScanning();
+#endif
   for(;;) {
-	  PROX_status.proximityFound = PROX_CheckProximity(&angle, &bits);
-	  PROX_status.proximityAngle = angle;
-	  PROX_status.proximityBits = bits;
-	  vTaskDelay(pdMS_TO_TICKS(100));
+#if PROX_CONFIG_USE_BURST_TIMER
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PROX_SCAN_PERIOD_MS))==0) {
+      continue; /* timeout, no scan completed */
+    }
+    PROX_GetLastCounts(&counts);
+#else
+    PROX_Scan(&counts);
+#endif
+    PROX_HandleScan(&counts);
+#if !PROX_CONFIG_USE_BURST_TIMER
+    vTaskDelay(pdMS_TO_TICKS(PROX_SCAN_PERIOD_MS));
+#endif
   }
 }
+#endif /* PL_CONFIG_HAS_EXEC */
 
 void PROX_Init(void) {
+  SBUS_InitChannel(&PROX_resultChannel, &PROX_resultBuf[0], &PROX_resultBuf[1], sizeof(PROX_Result));
+  memset(&PROX_Filter, 0, sizeof(PROX_Filter));
+#if PL_CONFIG_HAS_EXEC /* PROX_Process() runs in the executive */
+  PROX_scanning = FALSE;
+  PROX_handledTimestamp = 0;
+#else
   if (xTaskCreate(
 		ProxTask,  /* pointer to the task */
 		"ProxTask", /* task name for kernel awareness debugging */
-		(200+100)/sizeof(StackType_t), /* task stack size */
+		(300+100)/sizeof(StackType_t), /* task stack size */
 		(void*)NULL, /* optional task startup argument */
 		tskIDLE_PRIORITY+2,  /* initial priority */
-		(xTaskHandle*)NULL /* optional task handle to create */
+		&PROX_taskHndl /* optional task handle to create */
 	  ) != pdPASS) {
 	/*lint -e527 */
 	for(;;){}; /* error! probably out of memory */
 	/*lint +e527 */
   }
+#endif
 }
@@ -10,8 +10,13 @@
 #define SRC_PROXIMITY_H_
 
 #include "Platform.h"
+#include "SensorBus.h"
 #include <stdint.h>
 
+#ifndef PROX_CONFIG_USE_BURST_TIMER
+  #define PROX_CONFIG_USE_BURST_TIMER  (1) /* 1: IR bursts timed by a hardware timer interrupt; 0: busy waiting in the proximity task */
+#endif
+
 #if PL_CONFIG_HAS_SHELL
 #include "McuShell.h"
 /*!
@@ -39,6 +44,26 @@ PROX_Bits PROX_GetProxBits(void);
 
 #define PROX_NOF_SENSORS   (3)
 
+typedef struct {
+  uint32_t timestamp;    /*!< cycle counter at the end of the scan (last receiver sample) */
+  uint32_t scanNo;       /*!< number of the scan, incremented with each scan */
+  bool proximityFound;   /*!< if a target has been seen */
+  PROX_Bits proximityBits; /*!< sensor bits of the scan */
+  int proximityAngle;    /*!< filtered bearing of the target, see PROX_GetTargetAngle() */
+  int rawAngle;          /*!< bearing of the target from this scan only */
+  uint8_t intensity[PROX_NOF_SENSORS];   /*!< filtered reflection intensity for each receiver, 0..100% */
+  uint8_t countsLeft[PROX_NOF_SENSORS];  /*!< number of brightness levels seen with the left IR sender */
+  uint8_t countsRight[PROX_NOF_SENSORS]; /*!< number of brightness levels seen with the right IR sender */
+} PROX_Result;
+
+/*!
+ * \brief Returns a consistent copy of the last scan result, without disabling interrupts.
+ * \param result Where to store the result
+ * \param stamp Where to store version and publish timestamp of the result, can be NULL
+ * \return true if a result is available, false if nothing has been measured yet
+ */
+bool PROX_GetResult(PROX_Result *result, SBUS_Stamp *stamp);
+
 /* return number of brightness levels for each sensor */
 uint8_t PROX_GetNofWithLeftLeds(uint8_t sensorIdx);
 uint8_t PROX_GetNofWithRightLeds(uint8_t sensorIdx);
@@ -50,6 +75,21 @@ uint8_t PROX_GetNofWithRightLeds(uint8_t sensorIdx);
  */
 int PROX_GetTargetAngle(void);
 
+#if PROX_CONFIG_USE_BURST_TIMER
+/*!
+ * \brief Called from the burst timer interrupt at the end of each burst phase.
+ */
+void PROX_OnBurstTimerInterrupt(void);
+#endif
+
+#if PL_CONFIG_HAS_EXEC
+/*!
+ * \brief Sense stage of the executive: starts the burst timer at the first call, then decodes and
+ * publishes a scan completed since the last call.
+ */
+void PROX_Process(void);
+#endif
+
 void PROX_Init(void);
 
 #endif /* SRC_PROXIMITY_H_ */
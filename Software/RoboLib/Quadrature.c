@@ -10,6 +10,10 @@
 #include "McuLib.h"
 #include "Pin.h"
 #include "Quadrature.h"
+#include "McuArmTools.h"
+#include "CritSec.h"
+#include "SensorBus.h"
+#include "Span.h"
 #if PL_CONFIG_HAS_SHELL
   #include "McuShell.h"
   #include "McuUtility.h"
@@ -17,8 +21,8 @@
 
 #define Q4CLeft_SWAP_PINS  				0 /* 1: C1 and C2 are swapped */
 #define Q4CLeft_SWAP_PINS_AT_RUNTIME  	0 /* 1: C1 and C2 are swapped at runtime, if SwapPins() method is available */
-#define Q4CLeft_GET_C1_PIN()      		((HAL_GPIO_ReadPin(PIN_ENCL_A_PORT, PIN_ENCL_A_PIN)==GPIO_PIN_SET)?1:0)
-#define Q4CLeft_GET_C2_PIN()      		((HAL_GPIO_ReadPin(PIN_ENCL_B_PORT, PIN_ENCL_B_PIN)==GPIO_PIN_SET)?1:0)
+#define Q4CLeft_GET_C1_PIN()      		(PIN_ENCL_A_GET()?1:0)
+#define Q4CLeft_GET_C2_PIN()      		(PIN_ENCL_B_GET()?1:0)
 #if Q4CLeft_SWAP_PINS
   #define Q4CLeft_GET_C1_C2_PINS()               ((Q4CLeft_GET_C2_PIN()!=0?2:0)|(Q4CLeft_GET_C1_PIN()!=0?1:0))
   #define Q4CLeft_GET_C1_C2_PINS_SWAPPED()       ((Q4CLeft_GET_C1_PIN()!=0?2:0)|(Q4CLeft_GET_C2_PIN()!=0?1:0))
@@ -29,8 +33,8 @@
 
 #define Q4CRight_SWAP_PINS  				0 /* 1: C1 and C2 are swapped */
 #define Q4CRight_SWAP_PINS_AT_RUNTIME  		0 /* 1: C1 and C2 are swapped at runtime, if SwapPins() method is available */
-#define Q4CRight_GET_C1_PIN()      			((HAL_GPIO_ReadPin(PIN_ENCR_A_PORT, PIN_ENCR_A_PIN)==GPIO_PIN_SET)?1:0)
-#define Q4CRight_GET_C2_PIN()      			((HAL_GPIO_ReadPin(PIN_ENCR_B_PORT, PIN_ENCR_B_PIN)==GPIO_PIN_SET)?1:0)
+#define Q4CRight_GET_C1_PIN()      			(PIN_ENCR_A_GET()?1:0)
+#define Q4CRight_GET_C2_PIN()      			(PIN_ENCR_B_GET()?1:0)
 #if Q4CRight_SWAP_PINS
   #define Q4CRight_GET_C1_C2_PINS()               ((Q4CRight_GET_C2_PIN()!=0?2:0)|(Q4CRight_GET_C1_PIN()!=0?1:0))
   #define Q4CRight_GET_C1_C2_PINS_SWAPPED()       ((Q4CRight_GET_C1_PIN()!=0?2:0)|(Q4CRight_GET_C2_PIN()!=0?1:0))
@@ -73,9 +77,74 @@ static const signed char Quad_Table[4][4] =
 static uint8_t Q4CLeft_last_quadrature_value; /*! Value of C1&C2 during last round. */
 static uint8_t Q4CRight_last_quadrature_value; /*! Value of C1&C2 during last round. */
 
-static QUAD_QuadCntrType Q4CLeft_currPos, Q4CRight_currPos;
+static volatile QUAD_QuadCntrType Q4CLeft_currPos, Q4CRight_currPos;
+static uint32_t QUAD_posGeneration; /*!< incremented with each jump of the positions, not by the decoder */
 static uint32_t Q4CLeft_nofErrors, Q4CRight_nofErrors;
 
+typedef struct {
+  SBUS_SeqLock lock;       /*!< protects position and timing, written by the decoder interrupt */
+  uint32_t lastStepCycles; /*!< cycle counter value at the last step */
+  uint32_t periodCycles;   /*!< cycles between the last two steps in the same direction, 0 if not known */
+  int8_t dir;              /*!< direction of the last step: 1, -1 or 0 if no step yet */
+} QUAD_StepTiming;
+static QUAD_StepTiming Q4CLeft_timing, Q4CRight_timing;
+
+static void QUAD_UpdateTiming(QUAD_StepTiming *timing, signed char step) {
+  uint32_t now;
+
+  now = McuArmTools_GetCycleCounter();
+  if (step==timing->dir) {
+    timing->periodCycles = now-timing->lastStepCycles;
+  } else { /* first step or direction change: no valid period */
+    timing->periodCycles = 0;
+    timing->dir = step;
+  }
+  timing->lastStepCycles = now;
+}
+
+void QUAD_GetSnapshot(bool isLeft, QUAD_Snapshot *snapshot, SBUS_Stamp *stamp) {
+  QUAD_StepTiming *timing;
+  volatile QUAD_QuadCntrType *pos;
+  uint32_t seq;
+
+  if (isLeft) {
+    timing = &Q4CLeft_timing;
+    pos = &Q4CLeft_currPos;
+  } else {
+    timing = &Q4CRight_timing;
+    pos = &Q4CRight_currPos;
+  }
+  do { /* the decoder interrupt cannot be preempted by us: repeat only if it has been running in the meantime */
+    seq = SBUS_ReadBegin(&timing->lock);
+    snapshot->pos = *pos;
+    snapshot->periodCycles = timing->periodCycles;
+    snapshot->lastStepCycles = timing->lastStepCycles;
+    snapshot->dir = timing->dir;
+  } while (SBUS_ReadRetry(&timing->lock, seq));
+  if (stamp!=NULL) {
+    stamp->version = seq/2;
+    stamp->timestamp = snapshot->lastStepCycles;
+  }
+}
+
+static bool QUAD_GetTiming(bool isLeft, uint32_t *periodCycles, uint32_t *lastStepCycles, int8_t *dir) {
+  QUAD_Snapshot snapshot;
+
+  QUAD_GetSnapshot(isLeft, &snapshot, NULL);
+  *periodCycles = snapshot.periodCycles;
+  *lastStepCycles = snapshot.lastStepCycles;
+  *dir = snapshot.dir;
+  return *periodCycles!=0;
+}
+
+bool QUAD_GetLeftStepTiming(uint32_t *periodCycles, uint32_t *lastStepCycles, int8_t *dir) {
+  return QUAD_GetTiming(TRUE, periodCycles, lastStepCycles, dir);
+}
+
+bool QUAD_GetRightStepTiming(uint32_t *periodCycles, uint32_t *lastStepCycles, int8_t *dir) {
+  return QUAD_GetTiming(FALSE, periodCycles, lastStepCycles, dir);
+}
+
 uint32_t QUAD_NofLeftErrors(void) {
 	return Q4CLeft_nofErrors;
 }
@@ -91,6 +160,10 @@ QUAD_QuadCntrType QUAD_GetRightPos(void) {
 	return Q4CRight_currPos;
 }
 
+uint32_t QUAD_GetPosGeneration(void) {
+	return __atomic_load_n(&QUAD_posGeneration, __ATOMIC_ACQUIRE);
+}
+
 uint8_t Q4CLeft_GetVal(void) {
 #if Q4CLeft_SWAP_PINS_AT_RUNTIME
   if (Q4CLeft_swappedPins) {
@@ -125,7 +198,10 @@ static void QUAD_SampleLeft(void) {
   if (new_step == QUAD_ERROR) {
 	Q4CLeft_nofErrors++;
   } else if (new_step != 0) {
+	SBUS_WriteBegin(&Q4CLeft_timing.lock);
 	Q4CLeft_currPos += new_step;
+	QUAD_UpdateTiming(&Q4CLeft_timing, new_step);
+	SBUS_WriteEnd(&Q4CLeft_timing.lock);
   }
 }
 
@@ -139,90 +215,143 @@ static void QUAD_SampleRight(void) {
   if (new_step == QUAD_ERROR) {
 	Q4CRight_nofErrors++;
   } else if (new_step != 0) {
+	  SBUS_WriteBegin(&Q4CRight_timing.lock);
 	  Q4CRight_currPos += new_step;
+	  QUAD_UpdateTiming(&Q4CRight_timing, new_step);
+	  SBUS_WriteEnd(&Q4CRight_timing.lock);
   }
 }
 
 void QUAD_Sample(void) {
+	SPAN_BEGIN(SPAN_ID_QUAD_SAMPLE);
 	QUAD_SampleLeft();
 	QUAD_SampleRight();
+	SPAN_END(SPAN_ID_QUAD_SAMPLE);
+}
+
+void QUAD_OnEdgeInterrupt(bool isLeft) {
+	/* Same decoding table as for sampling, but running on every pin change:
+	 * a step is only lost if the second channel changes before the interrupt has been served. */
+	if (isLeft) {
+		QUAD_SampleLeft();
+	} else {
+		QUAD_SampleRight();
+	}
 }
 
 #if PL_CONFIG_HAS_SHELL
-uint8_t QUAD_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io)
-{
-  uint8_t res=ERR_OK;
-
-  if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_HELP)==0 || McuUtility_strcmp((const char *)cmd, "Quad help")==0) {
-    McuShell_SendHelpStr((const unsigned char*)"quad", (const unsigned char*)"Quadrature sensor command group\r\n", io->stdOut);
-    McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
-    McuShell_SendHelpStr((const unsigned char*)"  reset", (const unsigned char*)"Reset the current position counter\r\n", io->stdOut);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_STATUS)==0 || McuUtility_strcmp((const char*)cmd, "quad status")==0) {
-    McuShell_SendStr((const unsigned char*)"quad:\r\n", io->stdOut);
-    McuShell_SendStatusStr((const unsigned char*)"  pos", (const unsigned char*)"", io->stdOut);
-  #if QUAD_CNTR_BITS==16
-    McuShell_SendNum16s((int16_t)Q4CLeft_currPos, io->stdOut);
-    McuShell_SendStr((const unsigned char*)", ", io->stdOut);
-    McuShell_SendNum16s((int16_t)Q4CRight_currPos, io->stdOut);
-  #elif QUAD_CNTR_BITS==32
-    McuShell_SendNum32s((int32_t)Q4CLeft_currPos, io->stdOut);
-    McuShell_SendStr((const unsigned char*)", ", io->stdOut);
-    McuShell_SendNum32s((int32_t)Q4CRight_currPos, io->stdOut);
-  #else
-    #error "unknown counter size!"
-  #endif
-    McuShell_SendStr((const unsigned char*)"\r\n", io->stdOut);
-    McuShell_SendStatusStr((const unsigned char*)"  errors", (const unsigned char*)"", io->stdOut);
-    McuShell_SendNum16u(Q4CLeft_nofErrors, io->stdOut);
-    McuShell_SendStr((const unsigned char*)", ", io->stdOut);
-    McuShell_SendNum16u(Q4CRight_nofErrors, io->stdOut);
-    McuShell_SendStr((const unsigned char*)"\r\n", io->stdOut);
-    McuShell_SendStatusStr((const unsigned char*)"  C1 C2", (const unsigned char*)"", io->stdOut);
-    if (Q4CLeft_GET_C1_PIN()!=0) {
-      McuShell_SendStr((const unsigned char*)"[1,", io->stdOut);
-    } else {
-      McuShell_SendStr((const unsigned char*)"[0,", io->stdOut);
-    }
-    if (Q4CLeft_GET_C2_PIN()!=0) {
-      McuShell_SendStr((const unsigned char*)"1] ", io->stdOut);
-    } else {
-      McuShell_SendStr((const unsigned char*)"0] ", io->stdOut);
-    }
-    if (Q4CRight_GET_C1_PIN()!=0) {
-      McuShell_SendStr((const unsigned char*)"[1,", io->stdOut);
-    } else {
-      McuShell_SendStr((const unsigned char*)"[0,", io->stdOut);
-    }
-    if (Q4CRight_GET_C2_PIN()!=0) {
-      McuShell_SendStr((const unsigned char*)"1]\r\n", io->stdOut);
-    } else {
-      McuShell_SendStr((const unsigned char*)"0]\r\n", io->stdOut);
-    }
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((const char*)cmd, "quad reset")==0) {
-	QUAD_Reset();
-    *handled = TRUE;
+static void QUAD_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((const unsigned char*)"quad", (const unsigned char*)"Quadrature sensor command group\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  reset", (const unsigned char*)"Reset the current position counter\r\n", io->stdOut);
+}
+
+static void QUAD_PrintStatus(const McuShell_StdIOType *io) {
+  McuShell_SendStr((const unsigned char*)"quad:\r\n", io->stdOut);
+#if QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+  McuShell_SendStatusStr((const unsigned char*)"  decoder", (const unsigned char*)"pin edge interrupts\r\n", io->stdOut);
+#else
+  McuShell_SendStatusStr((const unsigned char*)"  decoder", (const unsigned char*)"sampled at 10 kHz\r\n", io->stdOut);
+#endif
+  McuShell_SendStatusStr((const unsigned char*)"  pos", (const unsigned char*)"", io->stdOut);
+#if QUAD_CNTR_BITS==16
+  McuShell_SendNum16s((int16_t)Q4CLeft_currPos, io->stdOut);
+  McuShell_SendStr((const unsigned char*)", ", io->stdOut);
+  McuShell_SendNum16s((int16_t)Q4CRight_currPos, io->stdOut);
+#elif QUAD_CNTR_BITS==32
+  McuShell_SendNum32s((int32_t)Q4CLeft_currPos, io->stdOut);
+  McuShell_SendStr((const unsigned char*)", ", io->stdOut);
+  McuShell_SendNum32s((int32_t)Q4CRight_currPos, io->stdOut);
+#else
+  #error "unknown counter size!"
+#endif
+  McuShell_SendStr((const unsigned char*)"\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  errors", (const unsigned char*)"", io->stdOut);
+  McuShell_SendNum16u(Q4CLeft_nofErrors, io->stdOut);
+  McuShell_SendStr((const unsigned char*)", ", io->stdOut);
+  McuShell_SendNum16u(Q4CRight_nofErrors, io->stdOut);
+  McuShell_SendStr((const unsigned char*)"\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  C1 C2", (const unsigned char*)"", io->stdOut);
+  if (Q4CLeft_GET_C1_PIN()!=0) {
+    McuShell_SendStr((const unsigned char*)"[1,", io->stdOut);
+  } else {
+    McuShell_SendStr((const unsigned char*)"[0,", io->stdOut);
   }
-  return res;
+  if (Q4CLeft_GET_C2_PIN()!=0) {
+    McuShell_SendStr((const unsigned char*)"1] ", io->stdOut);
+  } else {
+    McuShell_SendStr((const unsigned char*)"0] ", io->stdOut);
+  }
+  if (Q4CRight_GET_C1_PIN()!=0) {
+    McuShell_SendStr((const unsigned char*)"[1,", io->stdOut);
+  } else {
+    McuShell_SendStr((const unsigned char*)"[0,", io->stdOut);
+  }
+  if (Q4CRight_GET_C2_PIN()!=0) {
+    McuShell_SendStr((const unsigned char*)"1]\r\n", io->stdOut);
+  } else {
+    McuShell_SendStr((const unsigned char*)"0]\r\n", io->stdOut);
+  }
+}
+
+static uint8_t QUAD_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  QUAD_Reset();
+  return ERR_OK;
 }
+
+static const CMD_Command QUAD_Cmds[] = {
+  {"reset", "", QUAD_CmdReset},
+};
+
+const CMD_Group QUAD_CmdGroup = CMD_GROUP("quad", QUAD_PrintHelp, QUAD_PrintStatus, QUAD_Cmds);
 #endif /* PL_CONFIG_HAS_SHELL */
 
+/* Writers outside of the decoder interrupt: block the decoder while updating, so there is only one writer at a time */
 void QUAD_SetLeftPos(QUAD_QuadCntrType pos) {
+	CRIT_CriticalVariable()
+
+	CRIT_EnterCritical(CRIT_LEVEL_QUAD);
+	SBUS_WriteBegin(&Q4CLeft_timing.lock);
 	Q4CLeft_currPos = pos;
+	SBUS_WriteEnd(&Q4CLeft_timing.lock);
+	__atomic_fetch_add(&QUAD_posGeneration, 1, __ATOMIC_RELEASE);
+	CRIT_ExitCritical();
 }
 
 void QUAD_SetRightPos(QUAD_QuadCntrType pos) {
+	CRIT_CriticalVariable()
+
+	CRIT_EnterCritical(CRIT_LEVEL_QUAD);
+	SBUS_WriteBegin(&Q4CRight_timing.lock);
 	Q4CRight_currPos = pos;
+	SBUS_WriteEnd(&Q4CRight_timing.lock);
+	__atomic_fetch_add(&QUAD_posGeneration, 1, __ATOMIC_RELEASE);
+	CRIT_ExitCritical();
 }
 
 void QUAD_Reset(void) {
+	CRIT_CriticalVariable()
+
+	CRIT_EnterCritical(CRIT_LEVEL_QUAD);
+	SBUS_WriteBegin(&Q4CLeft_timing.lock);
 	Q4CLeft_currPos = 0;
 	Q4CLeft_nofErrors = 0;
+	Q4CLeft_timing.dir = 0;
+	Q4CLeft_timing.periodCycles = 0;
+	SBUS_WriteEnd(&Q4CLeft_timing.lock);
+	SBUS_WriteBegin(&Q4CRight_timing.lock);
 	Q4CRight_currPos = 0;
 	Q4CRight_nofErrors = 0;
+	Q4CRight_timing.dir = 0;
+	Q4CRight_timing.periodCycles = 0;
+	SBUS_WriteEnd(&Q4CRight_timing.lock);
+	__atomic_fetch_add(&QUAD_posGeneration, 1, __ATOMIC_RELEASE);
+	CRIT_ExitCritical();
 }
 
 void QUAD_Init(void) {
+	Q4CLeft_last_quadrature_value = Q4CLeft_GetVal(); /* start with current pin state, so the first change is not counted as error */
+	Q4CRight_last_quadrature_value = Q4CRight_GetVal();
 	QUAD_Reset();
 }
@@ -10,32 +10,80 @@
 #define SRC_QUADRATURE_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "Platform.h"
+#include "SensorBus.h"
+
+#define QUAD_CONFIG_DECODER_SAMPLED  (0) /* pins are sampled by a 10 kHz timer interrupt (TIM1) */
+#define QUAD_CONFIG_DECODER_EDGE     (1) /* decoder runs on every pin change (rising and falling edge pin interrupts) */
+
+#ifndef QUAD_CONFIG_DECODER
+  #define QUAD_CONFIG_DECODER  QUAD_CONFIG_DECODER_EDGE /* decoder backend, one of QUAD_CONFIG_DECODER_* */
+#endif
 
 #define QUAD_CNTR_BITS  (32)
 typedef uint32_t QUAD_QuadCntrType;
 
+/*!
+ * \brief Samples both encoders, called from the periodic quadrature timer interrupt.
+ */
 void QUAD_Sample(void);
 
+/*!
+ * \brief Decodes one encoder, called from the encoder pin interrupt on each pin change.
+ * \param isLeft true for the left encoder, false for the right one
+ */
+void QUAD_OnEdgeInterrupt(bool isLeft);
+
 void QUAD_Reset(void);
 void QUAD_SetLeftPos(QUAD_QuadCntrType pos);
 void QUAD_SetRightPos(QUAD_QuadCntrType pos);
 
 QUAD_QuadCntrType QUAD_GetLeftPos(void);
 QUAD_QuadCntrType QUAD_GetRightPos(void);
+
+/*!
+ * \brief Returns the number of position changes by QUAD_SetLeftPos(), QUAD_SetRightPos() and QUAD_Reset().
+ * A reader of the positions compares it before and after, and does not take a difference across a jump.
+ * \return Generation of the position counters
+ */
+uint32_t QUAD_GetPosGeneration(void);
 uint32_t QUAD_NofLeftErrors(void);
 uint32_t QUAD_NofRightErrors(void);
 
-#if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
+typedef struct {
+  QUAD_QuadCntrType pos;   /*!< position counter */
+  uint32_t periodCycles;   /*!< cycles between the last two steps in the same direction, 0 if not known */
+  uint32_t lastStepCycles; /*!< cycle counter value of the last step */
+  int8_t dir;              /*!< direction of the last step (1 or -1), 0 if there was no step yet */
+} QUAD_Snapshot;
+
+/*!
+ * \brief Returns position and step timing of one encoder as consistent copy, without disabling interrupts.
+ * \param isLeft true for the left encoder, false for the right one
+ * \param snapshot Where to store the data
+ * \param stamp Where to store the number of updates and the cycle counter of the last step, can be NULL
+ */
+void QUAD_GetSnapshot(bool isLeft, QUAD_Snapshot *snapshot, SBUS_Stamp *stamp);
+
 /*!
- * \brief Parses a command
- * \param cmd Command string to be parsed
- * \param handled Sets this variable to TRUE if command was handled
- * \param io I/O stream to be used for input/output
- * \return Error code, ERR_OK if everything was fine
+ * \brief Returns the timing of the last encoder steps, measured with the CPU cycle counter.
+ * \param periodCycles Where to store the number of cycles between the last two steps in the same direction
+ * \param lastStepCycles Where to store the cycle counter value of the last step
+ * \param dir Where to store the direction of the last step (1 or -1), 0 if there was no step yet
+ * \return true if the period is valid, false after a direction change or before the second step
  */
-uint8_t QUAD_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+bool QUAD_GetLeftStepTiming(uint32_t *periodCycles, uint32_t *lastStepCycles, int8_t *dir);
+
+/*!
+ * \brief Returns the timing of the last encoder steps, see QUAD_GetLeftStepTiming()
+ */
+bool QUAD_GetRightStepTiming(uint32_t *periodCycles, uint32_t *lastStepCycles, int8_t *dir);
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the quadrature decoder, registered in Shell.c */
+extern const CMD_Group QUAD_CmdGroup;
 #endif
 
 void QUAD_Init(void);
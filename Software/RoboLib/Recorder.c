@@ -0,0 +1,339 @@
+/**
+ * \file
+ * \brief Flight recorder
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Only the Drive task writes the ring buffer and the recorder state. Triggers from other tasks or
+ * interrupts are collected with an atomic OR and picked up with the next sample, arm requests
+ * with a flag. The buffer is only read while frozen, so neither side needs a lock.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_RECORDER
+#include "Recorder.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "McuArmTools.h"
+#include "McuUtility.h"
+#include "SensorBus.h"
+#include "Drive.h"
+#include "Motor.h"
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  #include "Proximity.h"
+#endif
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  #include "Tacho.h"
+#endif
+#if PL_CONFIG_HAS_QUADRATURE
+  #include "Quadrature.h"
+#endif
+#if PL_CONFIG_HAS_SUMO
+  #include "Sumo.h"
+#endif
+
+typedef struct {
+  uint16_t timeMs;    /* lower 16 bits of the tick count */
+  uint8_t whiteBits;  /* reflectance sensors seeing white */
+  uint8_t proxBits;   /* PROX_Bits of the last scan */
+  int8_t proxAngle;   /* filtered bearing of the opponent, 0 if none */
+  uint8_t state;      /* drive mode (bits 0..1), sumo behavior (bits 2..4), sumo state (bits 5..7) */
+  uint8_t marks;      /* REC_TRIGGER_xxx signaled since the previous sample */
+  uint8_t motorDir;   /* bit 0: left motor backward, bit 1: right motor backward */
+  int16_t set[2];     /* set value of the drive mode, left and right: speed, or the lower 16 bits of the position */
+  int16_t actual[2];  /* measured value of the drive mode, left and right: tacho speed or position */
+} REC_Sample_t;
+
+#if REC_CONFIG_USE_CCMRAM
+  static REC_Sample_t REC_buf[REC_CONFIG_NOF_SAMPLES] __attribute__((section(".ccmram"))); /* not initialized by the startup code */
+#else
+  static REC_Sample_t REC_buf[REC_CONFIG_NOF_SAMPLES];
+#endif
+static unsigned int REC_head;      /* index of the next sample to write */
+static unsigned int REC_nofSamples; /* number of valid samples in the buffer */
+static int REC_postLeft;           /* samples to record until freezing, -1 if not triggered */
+static unsigned int REC_divider;   /* counts the Drive task cycles for REC_CONFIG_SAMPLE_DIV */
+static volatile bool REC_frozen;   /* buffer is frozen and can be read */
+static volatile bool REC_armRequest; /* set by REC_Arm(), handled by the Drive task */
+static uint32_t REC_pending;       /* triggers not yet recorded, set with atomic operations */
+static volatile uint32_t REC_triggerMask = REC_TRIGGER_ALL; /* triggers which freeze the recording */
+static uint32_t REC_cause;         /* triggers which have frozen the recording */
+static uint32_t REC_cycles, REC_cyclesMax; /* time used for a sample */
+
+void REC_Trigger(uint32_t trigger) {
+  (void)__atomic_fetch_or(&REC_pending, trigger, __ATOMIC_RELEASE); /* exclusive load/store, no lock */
+}
+
+void REC_SetTriggerMask(uint32_t mask) {
+  REC_triggerMask = mask;
+}
+
+void REC_Arm(void) {
+  REC_armRequest = TRUE;
+}
+
+bool REC_IsFrozen(void) {
+  return REC_frozen;
+}
+
+static int16_t REC_Sat16(int32_t val) {
+  if (val>INT16_MAX) {
+    return INT16_MAX;
+  } else if (val<INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)val;
+}
+
+static void REC_Fill(REC_Sample_t *sample, uint32_t marks) {
+  DRV_Mode mode;
+  int32_t setL, setR;
+  uint8_t sumo = 0;
+#if PL_CONFIG_HAS_REFLECTANCE
+  REF_Snapshot ref;
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  PROX_Result prox;
+#endif
+
+  sample->timeMs = (uint16_t)(xTaskGetTickCount()*portTICK_PERIOD_MS);
+  sample->whiteBits = 0;
+#if PL_CONFIG_HAS_REFLECTANCE
+  if (REF_GetSnapshot(&ref, NULL)) {
+    sample->whiteBits = (uint8_t)ref.whiteBits;
+  }
+#endif
+  sample->proxBits = 0;
+  sample->proxAngle = 0;
+#if PL_CONFIG_HAS_PROXIMITY
+  if (PROX_GetResult(&prox, NULL) && prox.proximityFound) {
+    sample->proxBits = (uint8_t)prox.proximityBits;
+    sample->proxAngle = (int8_t)prox.proximityAngle; /* -90..90 */
+  }
+#endif
+  mode = DRV_GetMode();
+#if PL_CONFIG_HAS_SUMO
+  sumo = SUMO_GetStateInfo();
+#endif
+  sample->state = (uint8_t)((mode&0x3)|((sumo&0x7)<<2)|(((sumo>>4)&0x7)<<5));
+  sample->marks = (uint8_t)marks;
+  sample->motorDir = 0;
+  if (MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT))==MOT_DIR_BACKWARD) {
+    sample->motorDir |= 1;
+  }
+  if (MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_RIGHT))==MOT_DIR_BACKWARD) {
+    sample->motorDir |= 2;
+  }
+  DRV_GetSetValues(&setL, &setR);
+#if PL_CONFIG_HAS_QUADRATURE
+  if (mode==DRV_MODE_POS) {
+    sample->set[0] = (int16_t)setL; /* lower 16 bits, enough for the difference to the actual position */
+    sample->set[1] = (int16_t)setR;
+    sample->actual[0] = (int16_t)QUAD_GetLeftPos();
+    sample->actual[1] = (int16_t)QUAD_GetRightPos();
+    return;
+  }
+#endif
+  sample->set[0] = REC_Sat16(setL);
+  sample->set[1] = REC_Sat16(setR);
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  sample->actual[0] = REC_Sat16(TACHO_GetSpeed(TRUE));
+  sample->actual[1] = REC_Sat16(TACHO_GetSpeed(FALSE));
+#else
+  sample->actual[0] = sample->actual[1] = 0;
+#endif
+}
+
+void REC_Sample(void) {
+  uint32_t start, marks;
+
+  if (REC_armRequest) {
+    REC_armRequest = FALSE;
+    REC_head = 0;
+    REC_nofSamples = 0;
+    REC_postLeft = -1;
+    REC_cause = 0;
+    REC_divider = 0;
+    (void)__atomic_exchange_n(&REC_pending, 0, __ATOMIC_ACQUIRE); /* forget triggers from before */
+    REC_frozen = FALSE;
+  }
+  if (REC_frozen) {
+    return;
+  }
+  if (++REC_divider<REC_CONFIG_SAMPLE_DIV) {
+    return;
+  }
+  REC_divider = 0;
+  start = McuArmTools_GetCycleCounter();
+  marks = __atomic_exchange_n(&REC_pending, 0, __ATOMIC_ACQUIRE);
+  REC_Fill(&REC_buf[REC_head], marks);
+  REC_head++;
+  if (REC_head>=REC_CONFIG_NOF_SAMPLES) {
+    REC_head = 0;
+  }
+  if (REC_nofSamples<REC_CONFIG_NOF_SAMPLES) {
+    REC_nofSamples++;
+  }
+  if (REC_postLeft<0) {
+    if (marks&REC_triggerMask) {
+      REC_cause = marks&REC_triggerMask;
+      REC_postLeft = REC_CONFIG_POST_SAMPLES;
+    }
+  } else if (REC_postLeft>0) {
+    REC_postLeft--;
+  }
+  if (REC_postLeft==0) {
+    SBUS_MEMORY_BARRIER(); /* samples have to be written before the reader sees the freeze */
+    REC_frozen = TRUE;
+  }
+  REC_cycles = McuArmTools_GetCycleCounter()-start;
+  if (REC_cycles>REC_cyclesMax) {
+    REC_cyclesMax = REC_cycles;
+  }
+}
+
+uint8_t REC_Dump(const McuShell_StdIOType *io) {
+  unsigned int i, idx;
+  const REC_Sample_t *sample, *last;
+  uint8_t buf[64];
+
+  if (!REC_frozen) {
+    return ERR_BUSY;
+  }
+  SBUS_MEMORY_BARRIER();
+  McuShell_SendStr((unsigned char*)"ms,mode,behavior,state,white,prox,angle,dir,setL,setR,actL,actR,marks\r\n", io->stdOut);
+  if (REC_nofSamples==0) {
+    return ERR_OK;
+  }
+  last = &REC_buf[(REC_head+REC_CONFIG_NOF_SAMPLES-1)%REC_CONFIG_NOF_SAMPLES];
+  idx = (REC_head+REC_CONFIG_NOF_SAMPLES-REC_nofSamples)%REC_CONFIG_NOF_SAMPLES; /* oldest sample */
+  for(i=0; i<REC_nofSamples; i++) {
+    sample = &REC_buf[idx];
+    McuUtility_Num32sToStr(buf, sizeof(buf), (int16_t)(sample->timeMs-last->timeMs)); /* relative to the last sample */
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8u(buf, sizeof(buf), sample->state&0x3);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8u(buf, sizeof(buf), (sample->state>>2)&0x7);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8u(buf, sizeof(buf), (sample->state>>5)&0x7);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8Hex(buf, sizeof(buf), sample->whiteBits);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8Hex(buf, sizeof(buf), sample->proxBits);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8s(buf, sizeof(buf), sample->proxAngle);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8u(buf, sizeof(buf), sample->motorDir);
+    McuShell_SendStr(buf, io->stdOut);
+    McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)",");
+    McuUtility_strcatNum16s(buf, sizeof(buf), sample->set[0]);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum16s(buf, sizeof(buf), sample->set[1]);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum16s(buf, sizeof(buf), sample->actual[0]);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum16s(buf, sizeof(buf), sample->actual[1]);
+    McuUtility_chcat(buf, sizeof(buf), ',');
+    McuUtility_strcatNum8Hex(buf, sizeof(buf), sample->marks);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+    McuShell_SendStr(buf, io->stdOut);
+    idx++;
+    if (idx>=REC_CONFIG_NOF_SAMPLES) {
+      idx = 0;
+    }
+  }
+  return ERR_OK;
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void REC_PrintStatus(const McuShell_StdIOType *io) {
+  uint8_t buf[32];
+
+  McuShell_SendStatusStr((unsigned char*)"rec", (unsigned char*)"\r\n", io->stdOut);
+  if (REC_frozen) {
+    McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"frozen, cause 0x");
+    McuUtility_strcatNum8Hex(buf, sizeof(buf), (uint8_t)REC_cause);
+    McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  } else {
+    McuUtility_strcpy(buf, sizeof(buf), REC_postLeft>=0?(unsigned char*)"triggered\r\n":(unsigned char*)"recording\r\n");
+  }
+  McuShell_SendStatusStr((unsigned char*)"  state", buf, io->stdOut);
+
+  McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"0x");
+  McuUtility_strcatNum8Hex(buf, sizeof(buf), (uint8_t)REC_triggerMask);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" (border 1, stop 2, move 4, manual 8)\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  triggers", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), REC_nofSamples);
+  McuUtility_chcat(buf, sizeof(buf), '/');
+  McuUtility_strcatNum32u(buf, sizeof(buf), REC_CONFIG_NOF_SAMPLES);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), sizeof(REC_buf));
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" bytes\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  samples", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), REC_cycles);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" cycles (max ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), REC_cyclesMax);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  cost", buf, io->stdOut);
+}
+
+static void REC_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"rec", (unsigned char*)"Group of flight recorder commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows recorder help or status\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  arm", (unsigned char*)"Clears the buffer and starts recording\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  freeze", (unsigned char*)"Manual trigger\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  trigger <mask>", (unsigned char*)"Sets the triggers freezing the recording\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  dump", (unsigned char*)"Prints the frozen samples\r\n", io->stdOut);
+}
+
+static uint8_t REC_CmdArm(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  REC_Arm();
+  return ERR_OK;
+}
+
+static uint8_t REC_CmdFreeze(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  REC_Trigger(REC_TRIGGER_MANUAL);
+  return ERR_OK;
+}
+
+static uint8_t REC_CmdTrigger(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (args[0].i<0) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  REC_SetTriggerMask((uint32_t)args[0].i);
+  return ERR_OK;
+}
+
+static uint8_t REC_CmdDump(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  if (REC_Dump(io)!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"Not frozen, use 'rec freeze' first\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return ERR_OK;
+}
+
+static const CMD_Command REC_Cmds[] = {
+  {"arm",     "",  REC_CmdArm},
+  {"freeze",  "",  REC_CmdFreeze},
+  {"trigger", "i", REC_CmdTrigger},
+  {"dump",    "",  REC_CmdDump},
+};
+
+const CMD_Group REC_CmdGroup = CMD_GROUP("rec", REC_PrintHelp, REC_PrintStatus, REC_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void REC_Init(void) {
+  REC_cycles = REC_cyclesMax = 0;
+  REC_pending = 0;
+  REC_frozen = TRUE; /* REC_Sample() does nothing until the arm request is handled */
+  REC_Arm(); /* start recording */
+}
+#endif /* PL_CONFIG_HAS_RECORDER */
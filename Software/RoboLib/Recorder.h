@@ -0,0 +1,78 @@
+/**
+ * \file
+ * \brief Flight recorder
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This module records a snapshot of the robot state in a ring buffer with each Drive task cycle.
+ * A trigger (e.g. border or stop of the sumo run) freezes the recording after some more samples,
+ * so the buffer holds the history before and after the event until it gets dumped and re-armed.
+ */
+
+#ifndef SRC_RECORDER_H_
+#define SRC_RECORDER_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_RECORDER
+#include "McuShell.h"
+
+#define REC_CONFIG_NOF_SAMPLES    (100) /* number of samples in the ring buffer */
+#define REC_CONFIG_SAMPLE_DIV     (2)   /* record every n-th Drive task cycle: 100 samples every 10 ms cover one second */
+#define REC_CONFIG_POST_SAMPLES   (20)  /* samples recorded after the trigger before the recording freezes */
+#define REC_CONFIG_USE_CCMRAM     (1)   /* place the ring buffer into the CCM RAM, which is not used otherwise */
+
+/* triggers, can be combined */
+#define REC_TRIGGER_BORDER        (1<<0)  /* reflectance sensors have seen the border */
+#define REC_TRIGGER_SUMO_STOP     (1<<1)  /* sumo run has been stopped */
+#define REC_TRIGGER_MOVE_TIMEOUT  (1<<2)  /* TURN_MoveToPos() has timed out */
+#define REC_TRIGGER_MANUAL        (1<<3)  /* from the shell */
+#define REC_TRIGGER_ALL           (REC_TRIGGER_BORDER|REC_TRIGGER_SUMO_STOP|REC_TRIGGER_MOVE_TIMEOUT|REC_TRIGGER_MANUAL)
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the flight recorder, registered in Shell.c */
+extern const CMD_Group REC_CmdGroup;
+#endif
+
+/*!
+ * \brief Signals a trigger event. Can be called from any task or interrupt, does not block.
+ * \param trigger REC_TRIGGER_xxx bits
+ */
+void REC_Trigger(uint32_t trigger);
+
+/*!
+ * \brief Sets the triggers which freeze the recording.
+ * \param mask REC_TRIGGER_xxx bits
+ */
+void REC_SetTriggerMask(uint32_t mask);
+
+/*!
+ * \brief Clears the buffer and starts a new recording. Done with the next cycle of the Drive task.
+ */
+void REC_Arm(void);
+
+/*!
+ * \brief Checks if the recording has been frozen by a trigger.
+ * \return TRUE if frozen
+ */
+bool REC_IsFrozen(void);
+
+/*!
+ * \brief Prints the recorded samples, oldest first. Only possible while frozen.
+ * \param io I/O stream to be used for the output
+ * \return ERR_OK, or ERR_BUSY if the recorder is still running
+ */
+uint8_t REC_Dump(const McuShell_StdIOType *io);
+
+/*!
+ * \brief Records a sample, called by the Drive task at the end of each cycle.
+ */
+void REC_Sample(void);
+
+/*!
+ * \brief Module initialization.
+ */
+void REC_Init(void);
+
+#endif /* PL_CONFIG_HAS_RECORDER */
+
+#endif /* SRC_RECORDER_H_ */
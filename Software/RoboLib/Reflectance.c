@@ -11,84 +11,233 @@
 #include "McuShell.h"
 #include "McuUtility.h"
 #include "McuWait.h"
+#include "McuArmTools.h"
 #include "Pin.h"
 #include "Timer.h"
+#include "SensorBus.h"
+#include "Span.h"
 #if PL_CONFIG_HAS_LINE
   #include "Line.h"
 #endif
+#if PL_CONFIG_HAS_SUMO
+  #include "Sumo.h"
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
 
 #define REF_SENSOR_TIMEOUT_US  1000   /* after this time, consider no reflection (black). Must be smaller than the timeout period of the RefCnt timer! */
 #define REF_TIMEOUT_TICKS      0xa000
+#define REF_TIMER_TICKS_PER_US 64     /* reflectance timer is running with 64 MHz */
+#define REF_WHITE_MAX_VALUE    0x8000 /* raw values up to this are considered as white */
+
+static SBUS_Channel REF_snapshotChannel; /* measurements published by RefTask or the executive */
+static REF_Snapshot REF_snapshotBuf[2]; /* buffers of the channel */
+static uint32_t REF_maxBlockingTicks; /* longest time with interrupts masked (polling) or spent in the edge interrupt (capture), in timer ticks */
 
-static REF_SensorTimeType SensorRaw[REF_NOF_SENSORS]; /* raw sensor values */
+#if REF_CONFIG_USE_EDGE_CAPTURE
+#if PL_CONFIG_HAS_EXEC
+static bool REF_captureStarted; /* a capture runs from one cycle of the executive to the next */
+#else
+static TaskHandle_t RefTaskHandle;
+#define REF_CAPTURE_WAIT_TICKS  (2) /* RTOS ticks to wait for the capture set, as backup for the timer timeout interrupt */
+#endif
+static const Pin_PinId REF_EdgePins[REF_NOF_SENSORS] = {PIN_EDGE_L, PIN_EDGE_ML, PIN_EDGE_MR, PIN_EDGE_R};
+static volatile REF_SensorTimeType REF_CaptureTicks[REF_NOF_SENSORS]; /* timer value at the falling edge, written by the edge interrupt */
+static uint32_t REF_captureStartCycles; /* cycle counter at the start of the capture */
+#define REF_TIMEOUT_CYCLES  ((uint32_t)REF_TIMEOUT_TICKS*(configCPU_CLOCK_HZ/1000000)/REF_TIMER_TICKS_PER_US)
+static uint8_t REF_CapturePending; /* bit set of sensors not discharged yet, 0 if no measurement is running. Changed with atomic operations, the edge interrupts have different priorities */
+static uint32_t REF_nofWaitTimeouts; /* number of measurements not ended by the capture or timer interrupt */
+#endif
 
-#define EDGE_L_Get()     (HAL_GPIO_ReadPin(PIN_EDGE_L_PORT, PIN_EDGE_L_PIN)==GPIO_PIN_SET)
-#define EDGE_ML_Get()    (HAL_GPIO_ReadPin(PIN_EDGE_ML_PORT, PIN_EDGE_ML_PIN)==GPIO_PIN_SET)
-#define EDGE_MR_Get()    (HAL_GPIO_ReadPin(PIN_EDGE_MR_PORT, PIN_EDGE_MR_PIN)==GPIO_PIN_SET)
-#define EDGE_R_Get()     (HAL_GPIO_ReadPin(PIN_EDGE_R_PORT, PIN_EDGE_R_PIN)==GPIO_PIN_SET)
+bool REF_GetSnapshot(REF_Snapshot *snapshot, SBUS_Stamp *stamp) {
+  return SBUS_Read(&REF_snapshotChannel, snapshot, stamp);
+}
 
 REF_SensorTimeType REF_GetRawValue(unsigned int idx) {
+  REF_Snapshot snapshot;
+
   if (idx<REF_NOF_SENSORS) {
-    return SensorRaw[idx];
+    (void)REF_GetSnapshot(&snapshot, NULL);
+    return snapshot.raw[idx];
   }
   return 0; /* error case */
 }
 
 static void SetOutputHigh(void) {
-  GPIO_InitTypeDef GPIO_InitStruct;
-
-  GPIO_InitStruct.Alternate = 0; /* init to default value */
-  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP; /* configure as push/pull output pin */
-  GPIO_InitStruct.Pull = GPIO_NOPULL; /* no pull-up needed */
-  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-
-  HAL_GPIO_WritePin(PIN_EDGE_L_PORT, PIN_EDGE_L_PIN, GPIO_PIN_SET); /* HIGH */
-  GPIO_InitStruct.Pin = PIN_EDGE_L_PIN; HAL_GPIO_Init(PIN_EDGE_L_PORT, &GPIO_InitStruct); /* output */
-
-  HAL_GPIO_WritePin(PIN_EDGE_ML_PORT, PIN_EDGE_ML_PIN, GPIO_PIN_SET); /* HIGH */
-  GPIO_InitStruct.Pin = PIN_EDGE_ML_PIN; HAL_GPIO_Init(PIN_EDGE_ML_PORT, &GPIO_InitStruct); /* output */
-
-  HAL_GPIO_WritePin(PIN_EDGE_MR_PORT, PIN_EDGE_MR_PIN, GPIO_PIN_SET); /* HIGH */
-  GPIO_InitStruct.Pin = PIN_EDGE_MR_PIN; HAL_GPIO_Init(PIN_EDGE_MR_PORT, &GPIO_InitStruct); /* output */
-
-  HAL_GPIO_WritePin(PIN_EDGE_R_PORT, PIN_EDGE_R_PIN, GPIO_PIN_SET); /* HIGH */
-  GPIO_InitStruct.Pin = PIN_EDGE_R_PIN; HAL_GPIO_Init(PIN_EDGE_R_PORT, &GPIO_InitStruct); /* output */
+  PIN_SetHigh(PIN_EDGE_L); PIN_SetDirection(PIN_EDGE_L, true); /* HIGH output */
+  PIN_SetHigh(PIN_EDGE_ML); PIN_SetDirection(PIN_EDGE_ML, true); /* HIGH output */
+  PIN_SetHigh(PIN_EDGE_MR); PIN_SetDirection(PIN_EDGE_MR, true); /* HIGH output */
+  PIN_SetHigh(PIN_EDGE_R); PIN_SetDirection(PIN_EDGE_R, true); /* HIGH output */
 }
 
+#if !REF_CONFIG_USE_EDGE_CAPTURE
 static void SetInput(void) {
-  GPIO_InitTypeDef GPIO_InitStruct;
+  PIN_SetDirection(PIN_EDGE_L, false);
+  PIN_SetDirection(PIN_EDGE_ML, false);
+  PIN_SetDirection(PIN_EDGE_MR, false);
+  PIN_SetDirection(PIN_EDGE_R, false);
+}
+#endif
 
-  GPIO_InitStruct.Alternate = 0; /* init to default value */
-  GPIO_InitStruct.Mode = GPIO_MODE_INPUT; /* configure as push/pull output pin */
-  GPIO_InitStruct.Pull = GPIO_NOPULL; /* no pull-up needed */
-  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+uint32_t REF_IsWhite(void) {
+	REF_Snapshot snapshot;
 
-  GPIO_InitStruct.Pin = PIN_EDGE_L_PIN; HAL_GPIO_Init(PIN_EDGE_L_PORT, &GPIO_InitStruct);
-  GPIO_InitStruct.Pin = PIN_EDGE_ML_PIN; HAL_GPIO_Init(PIN_EDGE_ML_PORT, &GPIO_InitStruct);
-  GPIO_InitStruct.Pin = PIN_EDGE_MR_PIN; HAL_GPIO_Init(PIN_EDGE_MR_PORT, &GPIO_InitStruct);
-  GPIO_InitStruct.Pin = PIN_EDGE_R_PIN; HAL_GPIO_Init(PIN_EDGE_R_PORT, &GPIO_InitStruct);
+	if (!REF_GetSnapshot(&snapshot, NULL)) {
+		return 0; /* nothing measured yet */
+	}
+	return snapshot.whiteBits;
 }
 
-uint32_t REF_IsWhite(void) {
-	uint32_t val = 0;
+static void REF_Publish(const REF_SensorTimeType *raw) {
+	REF_Snapshot snapshot;
 	uint32_t mask = 1;
 	int i;
 
-	taskENTER_CRITICAL();
+	snapshot.whiteBits = 0;
 	for(i=0;i<REF_NOF_SENSORS;i++) {
-		if (SensorRaw[i] <= 0x8000/*White! REF_MIN_LINE_VAL*/){
-			val |= mask;
+		snapshot.raw[i] = raw[i];
+		if (raw[i] <= REF_WHITE_MAX_VALUE){
+			snapshot.whiteBits |= mask;
 		}
 		mask <<= 1;
 	}
-	taskEXIT_CRITICAL();
-	return val;
+	SBUS_Publish(&REF_snapshotChannel, &snapshot);
+#if PL_CONFIG_HAS_RECORDER
+	if (snapshot.whiteBits!=0) {
+		REC_Trigger(REC_TRIGGER_BORDER);
+	}
+#endif
+#if PL_CONFIG_HAS_SUMO
+	if (snapshot.whiteBits!=0) {
+		SUMO_OnBorder();
+	}
+#endif
+}
+
+void REF_DecodeCaptures(const REF_SensorTimeType *capture, REF_SensorTimeType *raw, size_t nofSensors, REF_SensorTimeType timeoutTicks) {
+  size_t i;
+
+  for(i=0;i<nofSensors;i++) {
+    if (capture[i]>timeoutTicks) { /* not discharged in time: no reflection (black) */
+      raw[i] = REF_MAX_SENSOR_VALUE;
+    } else {
+      raw[i] = capture[i];
+    }
+  }
 }
 
+#if REF_CONFIG_USE_EDGE_CAPTURE
+/* The edge interrupts run above the kernel (two of them share the vector with the encoder pins),
+ * so they do not use the RTOS API: the last edge ends the capture with the update interrupt of the
+ * timer, which runs at the kernel level. */
+void REF_OnFallingEdgeInterrupt(unsigned int idx) {
+  uint32_t timerValue, mask;
+  REF_SensorTimeType capture;
+
+  timerValue = TMRR_GetCounter();
+  mask = 1U<<idx;
+  PIN_DisableEdgeInterrupt(REF_EdgePins[idx]); /* only the first edge counts */
+  if ((__atomic_load_n(&REF_CapturePending, __ATOMIC_RELAXED)&mask)==0) {
+    return; /* not measuring, or already captured */
+  }
+  capture = (REF_SensorTimeType)timerValue;
+  if (McuArmTools_GetCycleCounter()-REF_captureStartCycles>REF_TIMEOUT_CYCLES) {
+    /* after the timeout: the timer may have wrapped around before the timeout interrupt could run */
+    capture = REF_MAX_SENSOR_VALUE;
+  }
+  REF_CaptureTicks[idx] = capture;
+  if (__atomic_and_fetch(&REF_CapturePending, (uint8_t)~mask, __ATOMIC_RELEASE)==0) { /* capture set complete */
+    TMRR_TriggerInterrupt(); /* REF_OnTimeoutInterrupt() */
+  }
+  timerValue = TMRR_GetCounter()-timerValue;
+  if (timerValue>REF_maxBlockingTicks) {
+    REF_maxBlockingTicks = timerValue;
+  }
+}
+
+void REF_OnTimeoutInterrupt(void) {
+#if !PL_CONFIG_HAS_EXEC /* the executive collects the capture itself */
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+#endif
+
+  TMRR_StopInterrupts();
+  /* end of the capture set or timeout: sensors not discharged are left with REF_MAX_SENSOR_VALUE */
+  __atomic_store_n(&REF_CapturePending, 0, __ATOMIC_RELEASE);
+#if !PL_CONFIG_HAS_EXEC
+  vTaskNotifyGiveFromISR(RefTaskHandle, &higherPriorityTaskWoken);
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+#endif
+}
+
+/*! \brief Charges the sensors and starts the capture of the discharge edges. */
+static void REF_StartCapture(void) {
+  int i;
+
+  for(i=0;i<REF_NOF_SENSORS;i++) {
+    REF_CaptureTicks[i] = REF_MAX_SENSOR_VALUE;
+  }
+  SetOutputHigh();
+  McuWait_Waitus(20); /* give time to charge */
+#if !PL_CONFIG_HAS_EXEC
+  (void)ulTaskNotifyTake(pdTRUE, 0); /* clear a notification left from a previous measurement */
+#endif
+  TMRR_SetCounter(0); /* reset timer */
+  REF_captureStartCycles = McuArmTools_GetCycleCounter();
+  __atomic_store_n(&REF_CapturePending, (1U<<REF_NOF_SENSORS)-1, __ATOMIC_RELEASE); /* all sensors */
+  TMRR_StartInterrupts(); /* start timer, overflow interrupt ends the measurement */
+  for(i=0;i<REF_NOF_SENSORS;i++) {
+    PIN_SetInputFallingEdgeInterrupt(REF_EdgePins[i]); /* starts discharging */
+  }
+}
+
+/*! \brief Ends the capture and publishes the measurement. */
+static void REF_FinishCapture(void) {
+  REF_SensorTimeType raw[REF_NOF_SENSORS];
+  int i;
+
+  __atomic_store_n(&REF_CapturePending, 0, __ATOMIC_RELEASE);
+  for(i=0;i<REF_NOF_SENSORS;i++) {
+    PIN_DisableEdgeInterrupt(REF_EdgePins[i]);
+    raw[i] = REF_CaptureTicks[i];
+  }
+  REF_DecodeCaptures(raw, raw, REF_NOF_SENSORS, REF_TIMEOUT_TICKS);
+  REF_Publish(raw);
+}
+
+#if PL_CONFIG_HAS_EXEC
+void REF_Sample(void) {
+  SPAN_BEGIN(SPAN_ID_REF_MEASURE);
+  if (REF_captureStarted) {
+    if (__atomic_load_n(&REF_CapturePending, __ATOMIC_ACQUIRE)!=0) { /* timer interrupt did not fire? */
+      TMRR_StopInterrupts();
+      REF_nofWaitTimeouts++;
+    }
+    REF_FinishCapture();
+  }
+  REF_StartCapture(); /* discharges until the next cycle, without waiting */
+  REF_captureStarted = TRUE;
+  SPAN_END(SPAN_ID_REF_MEASURE);
+}
+#else
 static void REF_MeasureRaw(void) {
+  SPAN_BEGIN(SPAN_ID_REF_MEASURE);
+  REF_StartCapture();
+  if (ulTaskNotifyTake(pdTRUE, REF_CAPTURE_WAIT_TICKS)==0) { /* timer interrupt did not fire? */
+    TMRR_StopInterrupts();
+    REF_nofWaitTimeouts++;
+  }
+  REF_FinishCapture();
+  SPAN_END(SPAN_ID_REF_MEASURE);
+}
+#endif /* PL_CONFIG_HAS_EXEC */
+#else
+static void REF_MeasureRaw(void) {
+	REF_SensorTimeType SensorRaw[REF_NOF_SENSORS];
 	int i;
 	uint32_t timerValue;
 
+	SPAN_BEGIN(SPAN_ID_REF_MEASURE);
 	for(i=0;i<REF_NOF_SENSORS;i++) {
 		SensorRaw[i] = REF_MAX_SENSOR_VALUE; /* init with 0xffff'ffff */
 	}
@@ -110,16 +259,16 @@ static void REF_MeasureRaw(void) {
 #endif
 			break; /* timeout */
 		}
-		if (SensorRaw[0]==REF_MAX_SENSOR_VALUE && EDGE_L_Get()==0) { /* discharged to low */
+		if (SensorRaw[0]==REF_MAX_SENSOR_VALUE && PIN_EDGE_L_GET()==0) { /* discharged to low */
 			SensorRaw[0] = timerValue;
 		}
-		if (SensorRaw[1]==REF_MAX_SENSOR_VALUE && EDGE_ML_Get()==0) { /* discharged to low */
+		if (SensorRaw[1]==REF_MAX_SENSOR_VALUE && PIN_EDGE_ML_GET()==0) { /* discharged to low */
 			SensorRaw[1] = timerValue;
 		}
-		if (SensorRaw[2]==REF_MAX_SENSOR_VALUE && EDGE_MR_Get()==0) { /* discharged to low */
+		if (SensorRaw[2]==REF_MAX_SENSOR_VALUE && PIN_EDGE_MR_GET()==0) { /* discharged to low */
 			SensorRaw[2] = timerValue;
 		}
-		if (SensorRaw[3]==REF_MAX_SENSOR_VALUE && EDGE_R_Get()==0) { /* discharged to low */
+		if (SensorRaw[3]==REF_MAX_SENSOR_VALUE && PIN_EDGE_R_GET()==0) { /* discharged to low */
 			SensorRaw[3] = timerValue;
 		}
 		if (       SensorRaw[0]!=REF_MAX_SENSOR_VALUE
@@ -131,10 +280,23 @@ static void REF_MeasureRaw(void) {
 			break; /* all sensors measured */
 		}
 	} /* for */
+	if (timerValue>REF_maxBlockingTicks) {
+		REF_maxBlockingTicks = timerValue;
+	}
 	taskEXIT_CRITICAL();
 	TMRR_Stop();
+	REF_Publish(SensorRaw);
+	SPAN_END(SPAN_ID_REF_MEASURE);
 }
+#endif /* REF_CONFIG_USE_EDGE_CAPTURE */
 
+#if PL_CONFIG_HAS_EXEC
+#if !REF_CONFIG_USE_EDGE_CAPTURE
+void REF_Sample(void) {
+  REF_MeasureRaw(); /* polls until all sensors are discharged */
+}
+#endif
+#else
 static void RefTask(void *pvParameters) {
   (void)pvParameters; /* parameter not used */
   for(;;) {
@@ -145,10 +307,13 @@ static void RefTask(void *pvParameters) {
     vTaskDelay(pdMS_TO_TICKS(10));
   }
 }
+#endif /* PL_CONFIG_HAS_EXEC */
 
 #if PL_CONFIG_HAS_SHELL
-static uint8_t PrintStatus(const McuShell_StdIOType *io) {
+static void REF_PrintStatus(const McuShell_StdIOType *io) {
   unsigned char buf[32];
+  REF_Snapshot snapshot;
+  SBUS_Stamp stamp;
   int i;
 
   McuShell_SendStatusStr((unsigned char*)"reflectance", (unsigned char*)"\r\n", io->stdOut);
@@ -159,6 +324,28 @@ static uint8_t PrintStatus(const McuShell_StdIOType *io) {
   McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" ticks\r\n");
   McuShell_SendStatusStr((unsigned char*)"  timeout", buf, io->stdOut);
 
+  McuUtility_Num32uToStr(buf, sizeof(buf), REF_maxBlockingTicks/REF_TIMER_TICKS_PER_US);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" us");
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" (edge ISR)\r\n");
+#else
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" (irq masked)\r\n");
+#endif
+  McuShell_SendStatusStr((unsigned char*)"  max block", buf, io->stdOut);
+
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  McuUtility_Num32uToStr(buf, sizeof(buf), REF_nofWaitTimeouts);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  wait tmout", buf, io->stdOut);
+#endif
+
+  (void)REF_GetSnapshot(&snapshot, &stamp);
+  McuUtility_Num32uToStr(buf, sizeof(buf), stamp.version);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", retries ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), REF_snapshotChannel.nofRetries);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  snapshot", buf, io->stdOut);
+
   McuShell_SendStatusStr((unsigned char*)"  raw val", (unsigned char*)"", io->stdOut);
   for (i=0;i<REF_NOF_SENSORS;i++) {
     if (i==0) {
@@ -166,41 +353,56 @@ static uint8_t PrintStatus(const McuShell_StdIOType *io) {
     } else {
       McuShell_SendStr((unsigned char*)" 0x", io->stdOut);
     }
-    buf[0] = '\0'; McuUtility_strcatNum16Hex(buf, sizeof(buf), SensorRaw[i]);
+    buf[0] = '\0'; McuUtility_strcatNum16Hex(buf, sizeof(buf), snapshot.raw[i]);
     McuShell_SendStr(buf, io->stdOut);
   }
   McuShell_SendStr((unsigned char*)"\r\n", io->stdOut);
+}
 
+static void REF_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((const unsigned char*)"ref", (const unsigned char*)"Reflectance command group\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  reset", (const unsigned char*)"Reset the blocking time statistics\r\n", io->stdOut);
+}
+
+static uint8_t REF_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  REF_maxBlockingTicks = 0;
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  REF_nofWaitTimeouts = 0;
+#endif
   return ERR_OK;
 }
 
-uint8_t REF_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-	  uint8_t res=ERR_OK;
-	  uint8_t buf[24];
+static const CMD_Command REF_Cmds[] = {
+  {"reset", "", REF_CmdReset},
+};
 
-	  if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_HELP)==0 || McuUtility_strcmp((const char *)cmd, "ref help")==0) {
-	    McuShell_SendHelpStr((const unsigned char*)"ref", (const unsigned char*)"Reflectance command group\r\n", io->stdOut);
-	    McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
-	    *handled = TRUE;
-	  } else if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_STATUS)==0 || McuUtility_strcmp((const char*)cmd, "ref status")==0) {
-	    *handled = TRUE;
-	    return PrintStatus(io);
-	  }
-	  return res;
-}
+const CMD_Group REF_CmdGroup = CMD_GROUP("ref", REF_PrintHelp, REF_PrintStatus, REF_Cmds);
 #endif
 
 void REF_Init(void) {
+  SBUS_InitChannel(&REF_snapshotChannel, &REF_snapshotBuf[0], &REF_snapshotBuf[1], sizeof(REF_Snapshot));
+#if PL_CONFIG_HAS_EXEC /* measured in the sense stage of the executive */
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  REF_captureStarted = FALSE;
+#endif
+#else
   if (xTaskCreate(
 		RefTask,  /* pointer to the task */
 		"RefTask", /* task name for kernel awareness debugging */
 		400/sizeof(StackType_t), /* task stack size */
 		(void*)NULL, /* optional task startup argument */
 		tskIDLE_PRIORITY+2,  /* initial priority */
+#if REF_CONFIG_USE_EDGE_CAPTURE
+		&RefTaskHandle /* optional task handle to create */
+#else
 		(xTaskHandle*)NULL /* optional task handle to create */
+#endif
 	  ) != pdPASS) {
 	/*lint -e527 */
 	for(;;){}; /* error! probably out of memory */
 	/*lint +e527 */
   }
+#endif
 }
@@ -10,22 +10,27 @@
 #define SRC_REFLECTANCE_H_
 
 #include "Platform.h"
+#include "SensorBus.h"
 #include <stdint.h>
+#include <stddef.h>
+
+#ifndef REF_CONFIG_USE_EDGE_CAPTURE
+  #define REF_CONFIG_USE_EDGE_CAPTURE  (1) /* 1: timestamp the discharge edges with pin interrupts; 0: poll the pins inside a critical section */
+#endif
 
 #define REF_NOF_SENSORS       (4)
 typedef uint16_t REF_SensorTimeType;
 #define REF_MAX_SENSOR_VALUE  ((REF_SensorTimeType)-1)
 
+typedef struct {
+  REF_SensorTimeType raw[REF_NOF_SENSORS]; /*!< raw sensor values, REF_MAX_SENSOR_VALUE for no reflection */
+  uint32_t whiteBits; /*!< bit set of sensors seeing 'white', bit 0 for the left sensor */
+} REF_Snapshot;
+
 #if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
-/*!
- * \brief Parses a command
- * \param cmd Command string to be parsed
- * \param handled Sets this variable to TRUE if command was handled
- * \param io I/O stream to be used for input/output
- * \return Error code, ERR_OK if everything was fine
- */
-uint8_t REF_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the reflectance sensors, registered in Shell.c */
+extern const CMD_Group REF_CmdGroup;
 #endif
 
 /*!
@@ -36,6 +41,42 @@ uint32_t REF_IsWhite(void);
 
 REF_SensorTimeType REF_GetRawValue(unsigned int idx);
 
+/*!
+ * \brief Returns a consistent copy of the last measurement, without disabling interrupts.
+ * \param snapshot Where to store the measurement
+ * \param stamp Where to store version and timestamp of the measurement, can be NULL
+ * \return true if a measurement is available, false if nothing has been measured yet
+ */
+bool REF_GetSnapshot(REF_Snapshot *snapshot, SBUS_Stamp *stamp);
+
+/*!
+ * \brief Converts captured discharge timestamps into raw sensor values. Does not access any hardware.
+ * \param capture Timer value at the discharge edge for each sensor, REF_MAX_SENSOR_VALUE if no edge was captured
+ * \param raw Where to store the raw values, can be the same as capture
+ * \param nofSensors Number of sensors in the arrays
+ * \param timeoutTicks Captures above this value are considered as no reflection and set to REF_MAX_SENSOR_VALUE
+ */
+void REF_DecodeCaptures(const REF_SensorTimeType *capture, REF_SensorTimeType *raw, size_t nofSensors, REF_SensorTimeType timeoutTicks);
+
+/*!
+ * \brief Called from the edge sensor pin interrupt when a sensor has discharged.
+ * \param idx Sensor index, 0 for the left sensor
+ */
+void REF_OnFallingEdgeInterrupt(unsigned int idx);
+
+/*!
+ * \brief Called from the reflectance timer overflow interrupt to end the measurement.
+ */
+void REF_OnTimeoutInterrupt(void);
+
+#if PL_CONFIG_HAS_EXEC
+/*!
+ * \brief Sense stage of the executive: publishes the measurement started in the previous cycle
+ * and starts the next one, which discharges while the other stages run.
+ */
+void REF_Sample(void);
+#endif
+
 void REF_Init(void);
 
 #endif /* SRC_REFLECTANCE_H_ */
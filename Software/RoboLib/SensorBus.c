@@ -0,0 +1,57 @@
+/**
+ * \file
+ * \brief Sensor snapshot bus
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Implementation of the double buffered snapshot channels.
+ */
+
+#include "SensorBus.h"
+#include "McuArmTools.h"
+#include <string.h>
+
+void SBUS_InitChannel(SBUS_Channel *ch, void *buf0, void *buf1, size_t size) {
+  ch->seq = 0;
+  ch->buf[0] = buf0;
+  ch->buf[1] = buf1;
+  ch->size = size;
+  memset(buf0, 0, size);
+  memset(buf1, 0, size);
+  memset(ch->stamp, 0, sizeof(ch->stamp));
+  ch->nofRetries = 0;
+}
+
+void SBUS_Publish(SBUS_Channel *ch, const void *data) {
+  uint32_t seq;
+  unsigned int idx;
+
+  seq = ch->seq+1;
+  idx = seq&1; /* buffer not visible to the readers */
+  memcpy(ch->buf[idx], data, ch->size);
+  ch->stamp[idx].version = seq;
+  ch->stamp[idx].timestamp = McuArmTools_GetCycleCounter();
+  SBUS_MEMORY_BARRIER(); /* snapshot has to be complete before it gets visible */
+  ch->seq = seq;
+}
+
+bool SBUS_Read(SBUS_Channel *ch, void *data, SBUS_Stamp *stamp) {
+  uint32_t seq;
+  unsigned int idx;
+
+  for(;;) { /* breaks */
+    seq = ch->seq;
+    SBUS_MEMORY_BARRIER();
+    idx = seq&1;
+    memcpy(data, ch->buf[idx], ch->size);
+    if (stamp!=NULL) {
+      *stamp = ch->stamp[idx];
+    }
+    SBUS_MEMORY_BARRIER();
+    if (ch->seq==seq) {
+      break; /* no publish in the meantime: the producer did not touch our buffer */
+    }
+    /* The producer has published, and might already write the next snapshot into the buffer we were reading. */
+    ch->nofRetries++;
+  }
+  return seq!=0;
+}
@@ -0,0 +1,112 @@
+/**
+ * \file
+ * \brief Sensor snapshot bus
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This module passes sensor data from one producer (task or interrupt) to its consumers without
+ * disabling interrupts. Each published snapshot gets a version number and a cycle counter timestamp.
+ *
+ * Two mechanisms are provided:
+ * - SBUS_Channel: double buffered channel for producer tasks. The producer writes into the buffer not
+ *   visible to the readers and then publishes it by incrementing the sequence counter. A reader
+ *   preempting the producer in the middle of a write still gets the previous consistent snapshot.
+ * - SBUS_SeqLock: in-place sequence lock for producers running in an interrupt. The consumer
+ *   (a task) can never preempt the producer, it only has to retry if the interrupt has updated the
+ *   data while the consumer was copying it.
+ */
+
+#ifndef SRC_SENSORBUS_H_
+#define SRC_SENSORBUS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Orders the data accesses against the sequence counter, for the compiler and the CPU */
+#if defined(__arm__)
+  #define SBUS_MEMORY_BARRIER()   __asm volatile("dmb" ::: "memory")
+#else /* host builds of the tools */
+  #define SBUS_MEMORY_BARRIER()   __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+typedef struct {
+  uint32_t version;   /*!< number of the snapshot, incremented with each publish, 0 if nothing has been published */
+  uint32_t timestamp; /*!< cycle counter value at the time of the publish */
+} SBUS_Stamp;
+
+typedef struct {
+  volatile uint32_t seq;  /*!< number of published snapshots, the lowest bit selects the buffer visible to the readers */
+  void *buf[2];           /*!< snapshot buffers, each of 'size' bytes */
+  size_t size;            /*!< size of one snapshot in bytes */
+  SBUS_Stamp stamp[2];    /*!< stamp for each buffer */
+  uint32_t nofRetries;    /*!< number of reads repeated because of a publish during the read */
+} SBUS_Channel;
+
+/*!
+ * \brief Initializes a double buffered channel.
+ * \param ch Channel to initialize
+ * \param buf0 First snapshot buffer
+ * \param buf1 Second snapshot buffer
+ * \param size Size of a snapshot (and of each buffer) in bytes
+ */
+void SBUS_InitChannel(SBUS_Channel *ch, void *buf0, void *buf1, size_t size);
+
+/*!
+ * \brief Publishes a new snapshot. Only one producer per channel is allowed.
+ * \param ch Channel
+ * \param data Snapshot data with the size of the channel
+ */
+void SBUS_Publish(SBUS_Channel *ch, const void *data);
+
+/*!
+ * \brief Reads the latest published snapshot, without disabling interrupts.
+ * \param ch Channel
+ * \param data Where to store the snapshot
+ * \param stamp Where to store the version and timestamp of the snapshot, can be NULL
+ * \return true if a snapshot has been published, false if the data is the initial one
+ */
+bool SBUS_Read(SBUS_Channel *ch, void *data, SBUS_Stamp *stamp);
+
+typedef struct {
+  volatile uint32_t seq; /*!< sequence counter, odd while the producer is writing */
+} SBUS_SeqLock;
+
+/*!
+ * \brief Starts an in-place update, called by the (interrupt) producer.
+ */
+static inline void SBUS_WriteBegin(SBUS_SeqLock *lock) {
+  lock->seq++;
+  SBUS_MEMORY_BARRIER();
+}
+
+/*!
+ * \brief Ends an in-place update, called by the (interrupt) producer.
+ */
+static inline void SBUS_WriteEnd(SBUS_SeqLock *lock) {
+  SBUS_MEMORY_BARRIER();
+  lock->seq++;
+}
+
+/*!
+ * \brief Starts reading data protected by the lock.
+ * \return Sequence value to be passed to SBUS_ReadRetry()
+ */
+static inline uint32_t SBUS_ReadBegin(const SBUS_SeqLock *lock) {
+  uint32_t seq;
+
+  seq = lock->seq;
+  SBUS_MEMORY_BARRIER();
+  return seq;
+}
+
+/*!
+ * \brief Checks if the data read since SBUS_ReadBegin() is consistent.
+ * \param seq Value returned by SBUS_ReadBegin()
+ * \return true if the producer was writing in the meantime and the read has to be repeated
+ */
+static inline bool SBUS_ReadRetry(const SBUS_SeqLock *lock, uint32_t seq) {
+  SBUS_MEMORY_BARRIER();
+  return (seq&1)!=0 || lock->seq!=seq;
+}
+
+#endif /* SRC_SENSORBUS_H_ */
@@ -43,10 +43,41 @@
 #if PL_CONFIG_HAS_TURN
   #include "Turn.h"
 #endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#if PL_CONFIG_HAS_TELEMETRY
+  #include "Telemetry.h"
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
+#if PL_CONFIG_HAS_SPAN
+  #include "Span.h"
+#endif
+#if PL_CONFIG_HAS_TRACKER
+  #include "Tracker.h"
+#endif
+#if PL_CONFIG_HAS_TRIGGER
+  #include "Trigger.h"
+#endif
 #if PL_CONFIG_HAS_LINE
   #include "Line.h"
 #endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+#endif
+#if PL_CONFIG_HAS_DLOG
+  #include "DLog.h"
+#endif
+#if PL_CONFIG_HAS_CRITSEC
+  #include "CritSec.h"
+#endif
+#if PL_CONFIG_HAS_EXEC
+  #include "Exec.h"
+#endif
 #include "McuArmTools.h"
+#include "CmdRegistry.h"
 
 static uint8_t SHELL_DefaultShellBuffer[McuShell_DEFAULT_SHELL_BUFFER_SIZE]; /* default buffer which can be used by the application */
 
@@ -61,51 +92,107 @@ static const SHELL_IODesc ios[] =
   {&McuShell_stdio, SHELL_DefaultShellBuffer, sizeof(SHELL_DefaultShellBuffer)},
 };
 
-static const McuShell_ParseCommandCallback CmdParserTable[] =
+/* groups of the command registry, help and status are printed in this order */
+#if McuRTOS_PARSE_COMMAND_ENABLED
+static const CMD_Group SHELL_RtosGroup = CMD_PARSER_GROUP("McuRTOS", McuRTOS_ParseCommand); /* FreeRTOS shell parser */
+#endif
+#if McuArmTools_CONFIG_PARSE_COMMAND_ENABLED
+static const CMD_Group SHELL_ArmToolsGroup = CMD_PARSER_GROUP("McuArmTools", McuArmTools_ParseCommand);
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+static const CMD_Group SHELL_ProxGroup = CMD_PARSER_GROUP("prox", PROX_ParseCommand);
+#endif
+#if PL_CONFIG_HAS_MOTOR_TACHO
+static const CMD_Group SHELL_TachoGroup = CMD_PARSER_GROUP("tacho", TACHO_ParseCommand);
+#endif
+#if PL_CONFIG_HAS_LINE_FOLLOW
+static const CMD_Group SHELL_LineFollowGroup = CMD_PARSER_GROUP("lf", LF_ParseCommand);
+#endif
+#if PL_CONFIG_HAS_LINE_MAZE
+static const CMD_Group SHELL_MazeGroup = CMD_PARSER_GROUP("maze", MAZE_ParseCommand);
+#endif
+
+static const CMD_Group *const SHELL_CmdGroups[] =
 {
-  McuShell_ParseCommand, /* Processor Expert Shell component, is first in list */
 #if McuRTOS_PARSE_COMMAND_ENABLED
-  McuRTOS_ParseCommand, /* FreeRTOS shell parser */
+  &SHELL_RtosGroup,
 #endif
 #if McuArmTools_CONFIG_PARSE_COMMAND_ENABLED
-  McuArmTools_ParseCommand,
+  &SHELL_ArmToolsGroup,
 #endif
 #if PL_CONFIG_HAS_REFLECTANCE
-  REF_ParseCommand,
+  &REF_CmdGroup,
 #endif
 #if PL_CONFIG_HAS_PROXIMITY
-  PROX_ParseCommand,
+  &SHELL_ProxGroup,
 #endif
 #if PL_CONFIG_HAS_MOTOR
-  MOT_ParseCommand,
+  &MOT_CmdGroup,
 #endif
 #if PL_CONFIG_HAS_QUADRATURE
-  QUAD_ParseCommand,
+  &QUAD_CmdGroup,
 #endif
 #if PL_CONFIG_HAS_MOTOR_TACHO
-  TACHO_ParseCommand,
+  &SHELL_TachoGroup,
 #endif
 #if PL_CONFIG_HAS_PID
-  PID_ParseCommand,
+  &PID_CmdGroup,
 #endif
 #if PL_CONFIG_HAS_DRIVE
-  DRV_ParseCommand,
+  &DRV_CmdGroup,
 #endif
 #if PL_CONFIG_HAS_TURN
-  TURN_ParseCommand,
+  &TURN_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  &ODO_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_TELEMETRY
+  &TELE_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  &REC_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_SPAN
+  &SPAN_CmdGroup,
 #endif
 #if PL_CONFIG_HAS_LINE
-  LINE_ParseCommand,
+  &LINE_CmdGroup,
 #endif
 #if PL_CONFIG_HAS_LINE_FOLLOW
-  LF_ParseCommand,
+  &SHELL_LineFollowGroup,
 #endif
 #if PL_CONFIG_HAS_LINE_MAZE
-  MAZE_ParseCommand,
+  &SHELL_MazeGroup,
 #endif
 #if PL_CONFIG_HAS_SUMO
-  SUMO_ParseCommand,
+  &SUMO_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_TRACKER
+  &TRACK_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  &NVMC_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_DLOG
+  &DLOG_CmdGroup,
 #endif
+#if PL_CONFIG_HAS_TRIGGER
+  &TRG_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_CRITSEC
+  &CRIT_CmdGroup,
+#endif
+#if PL_CONFIG_HAS_EXEC
+  &EXEC_CmdGroup,
+#endif
+  NULL /* Sentinel */
+};
+
+static const McuShell_ParseCommandCallback CmdParserTable[] =
+{
+  McuShell_ParseCommand, /* Processor Expert Shell component, is first in list */
+  CMD_ParseCommand, /* command registry with the groups above */
   NULL /* Sentinel */
 };
 
@@ -131,6 +218,9 @@ static void ShellTask(void *pvParameters) {
 #endif /* PL_CONFIG_HAS_RTOS */
 
 void SHELL_Init(void) {
+  if (CMD_Init(SHELL_CmdGroups)!=ERR_OK) {
+    for(;;){} /* error: increase CMD_CONFIG_HASH_SIZE */
+  }
 #if PL_CONFIG_USE_FREERTOS
   if (xTaskCreate(ShellTask, "Shell", 900/sizeof(StackType_t), NULL, tskIDLE_PRIORITY+1, NULL) != pdPASS) {
     for(;;){} /* error */
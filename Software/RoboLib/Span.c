@@ -0,0 +1,272 @@
+/**
+ * \file
+ * \brief Timing spans for the hot paths
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Each span is measured by one task or interrupt only, so its statistics have a single writer and
+ * need no lock. A reset is requested by incrementing a generation counter: the writer clears the
+ * statistics with its next measurement. Readers may see a measurement half added, which is fine
+ * for statistics.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_SPAN
+#include "Span.h"
+#include "McuUtility.h"
+#include <string.h>
+#if SPAN_CONFIG_HOST
+  #include <time.h>
+#else
+  #include "FreeRTOS.h"
+  #include "McuArmTools.h"
+#endif
+
+#if SPAN_CONFIG_HOST
+  #define SPAN_TICKS_PER_US    (1000) /* nanoseconds */
+
+static uint32_t SPAN_GetTicks(void) {
+  struct timespec ts;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec*1000000000ULL+(uint64_t)ts.tv_nsec);
+}
+#else
+  #define SPAN_TICKS_PER_US    (configCPU_CLOCK_HZ/1000000)
+  #define SPAN_GetTicks()      McuArmTools_GetCycleCounter()
+#endif
+
+typedef struct {
+  uint32_t start;      /* ticks at SPAN_Begin() */
+  uint32_t generation; /* statistics are cleared if this does not match SPAN_generation */
+  uint32_t count, min, max; /* ticks */
+  uint64_t sum;        /* ticks */
+  uint16_t bins[SPAN_CONFIG_NOF_BINS]; /* histogram, saturating */
+} SPAN_Data;
+
+#if SPAN_CONFIG_USE_CCMRAM
+  static SPAN_Data SPAN_data[SPAN_NOF_IDS] __attribute__((section(".ccmram"))); /* not initialized by the startup code */
+#else
+  static SPAN_Data SPAN_data[SPAN_NOF_IDS];
+#endif
+static volatile uint32_t SPAN_generation; /* incremented to reset the statistics */
+static uint32_t SPAN_overhead; /* ticks measured for an empty span, subtracted from each measurement */
+static uint32_t SPAN_cost; /* ticks of a SPAN_Begin()/SPAN_End() pair, what the markers add to the measured code */
+
+static const unsigned char *const SPAN_names[SPAN_NOF_IDS] = {
+  (const unsigned char*)"drive",
+  (const unsigned char*)"quad",
+  (const unsigned char*)"tacho",
+  (const unsigned char*)"pidSpeed",
+  (const unsigned char*)"pidPos",
+  (const unsigned char*)"pidLine",
+  (const unsigned char*)"ref",
+  (const unsigned char*)"line",
+  (const unsigned char*)"trg",
+};
+
+void SPAN_Begin(SPAN_Id id) {
+  SPAN_data[id].start = SPAN_GetTicks();
+}
+
+void SPAN_End(SPAN_Id id) {
+  uint32_t ticks = SPAN_GetTicks();
+  SPAN_Data *span = &SPAN_data[id];
+  unsigned int bin;
+
+  ticks -= span->start;
+  ticks = ticks>SPAN_overhead?ticks-SPAN_overhead:0;
+  if (span->generation!=SPAN_generation) { /* reset requested */
+    span->generation = SPAN_generation;
+    span->count = 0;
+    span->sum = 0;
+    span->min = UINT32_MAX;
+    span->max = 0;
+    memset(span->bins, 0, sizeof(span->bins));
+  }
+  span->count++;
+  span->sum += ticks;
+  if (ticks<span->min) {
+    span->min = ticks;
+  }
+  if (ticks>span->max) {
+    span->max = ticks;
+  }
+  bin = ticks==0?0:31-__builtin_clz(ticks); /* CLZ instruction */
+  if (bin>=SPAN_CONFIG_NOF_BINS) {
+    bin = SPAN_CONFIG_NOF_BINS-1;
+  }
+  if (span->bins[bin]!=UINT16_MAX) {
+    span->bins[bin]++;
+  }
+}
+
+static uint32_t SPAN_TicksToNs(uint64_t ticks) {
+  return (uint32_t)((ticks*1000)/SPAN_TICKS_PER_US);
+}
+
+bool SPAN_GetStats(SPAN_Id id, SPAN_Stats *stats) {
+  SPAN_Data *span;
+
+  memset(stats, 0, sizeof(SPAN_Stats));
+  if (id>=SPAN_NOF_IDS) {
+    return FALSE;
+  }
+  span = &SPAN_data[id];
+  if (span->generation!=SPAN_generation || span->count==0) {
+    return FALSE; /* not measured yet, or reset pending */
+  }
+  stats->count = span->count;
+  stats->minNs = SPAN_TicksToNs(span->min);
+  stats->maxNs = SPAN_TicksToNs(span->max);
+  stats->meanNs = SPAN_TicksToNs(span->sum/stats->count);
+  return TRUE;
+}
+
+void SPAN_GetOverhead(uint32_t *subtractedNs, uint32_t *costNs) {
+  *subtractedNs = SPAN_TicksToNs(SPAN_overhead);
+  *costNs = SPAN_TicksToNs(SPAN_cost);
+}
+
+const unsigned char *SPAN_GetName(SPAN_Id id) {
+  if (id>=SPAN_NOF_IDS) {
+    return (const unsigned char*)"?";
+  }
+  return SPAN_names[id];
+}
+
+void SPAN_Reset(void) {
+  SPAN_generation++;
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void SPAN_strcatUs(uint8_t *buf, size_t bufSize, uint32_t ns) {
+  McuUtility_strcatNum32u(buf, bufSize, ns/1000);
+  McuUtility_chcat(buf, bufSize, '.');
+  McuUtility_strcatNum32uFormatted(buf, bufSize, (ns%1000)/10, '0', 2);
+}
+
+static void SPAN_PrintStatus(const McuShell_StdIOType *io) {
+  uint8_t buf[64], name[16];
+  SPAN_Stats stats;
+  int i;
+
+  McuShell_SendStatusStr((unsigned char*)"span", (unsigned char*)"min/mean/max us, count\r\n", io->stdOut);
+  McuUtility_Num32uToStr(buf, sizeof(buf), SPAN_overhead);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" ticks subtracted, ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), SPAN_cost);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" ticks per begin/end\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  overhead", buf, io->stdOut);
+  for(i=0; i<SPAN_NOF_IDS; i++) {
+    McuUtility_strcpy(name, sizeof(name), (unsigned char*)"  ");
+    McuUtility_strcat(name, sizeof(name), SPAN_GetName((SPAN_Id)i));
+    if (SPAN_GetStats((SPAN_Id)i, &stats)) {
+      buf[0] = '\0';
+      SPAN_strcatUs(buf, sizeof(buf), stats.minNs);
+      McuUtility_chcat(buf, sizeof(buf), '/');
+      SPAN_strcatUs(buf, sizeof(buf), stats.meanNs);
+      McuUtility_chcat(buf, sizeof(buf), '/');
+      SPAN_strcatUs(buf, sizeof(buf), stats.maxNs);
+      McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+      McuUtility_strcatNum32u(buf, sizeof(buf), stats.count);
+      McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+    } else {
+      McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"-\r\n");
+    }
+    McuShell_SendStatusStr(name, buf, io->stdOut);
+  }
+}
+
+static uint8_t SPAN_PrintHistogram(const unsigned char *name, const McuShell_StdIOType *io) {
+  uint8_t buf[48];
+  SPAN_Data *span;
+  int i, id;
+
+  for(id=0; id<SPAN_NOF_IDS; id++) {
+    if (McuUtility_strcmp((const char*)name, (const char*)SPAN_names[id])==0) {
+      break;
+    }
+  }
+  if (id==SPAN_NOF_IDS) {
+    return ERR_FAILED;
+  }
+  span = &SPAN_data[id];
+  if (span->generation!=SPAN_generation) {
+    return ERR_OK; /* no measurements since the reset */
+  }
+  for(i=0; i<SPAN_CONFIG_NOF_BINS; i++) {
+    if (span->bins[i]!=0) {
+      McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)">= ");
+      SPAN_strcatUs(buf, sizeof(buf), SPAN_TicksToNs(i==0?0:1UL<<i));
+      McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" us: ");
+      McuUtility_strcatNum16u(buf, sizeof(buf), span->bins[i]);
+      McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+      McuShell_SendStr(buf, io->stdOut);
+    }
+  }
+  return ERR_OK;
+}
+
+static void SPAN_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"span", (unsigned char*)"Group of timing span commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows span help or min/mean/max of all spans\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  hist <name>", (unsigned char*)"Prints the histogram of a span\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Clears the statistics\r\n", io->stdOut);
+}
+
+static uint8_t SPAN_CmdHist(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (SPAN_PrintHistogram(args[0].str, io)!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"Unknown span\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return ERR_OK;
+}
+
+static uint8_t SPAN_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  SPAN_Reset();
+  return ERR_OK;
+}
+
+static const CMD_Command SPAN_Cmds[] = {
+  {"hist",  "s", SPAN_CmdHist},
+  {"reset", "",  SPAN_CmdReset},
+};
+
+const CMD_Group SPAN_CmdGroup = CMD_GROUP("span", SPAN_PrintHelp, SPAN_PrintStatus, SPAN_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void SPAN_Init(void) {
+  uint32_t start, ticks, read = UINT32_MAX;
+  int i;
+
+#if !SPAN_CONFIG_HOST
+  McuArmTools_InitCycleCounter(); /* already done by McuWait if it uses the cycle counter */
+  McuArmTools_EnableCycleCounter();
+#endif
+  memset(SPAN_data, 0, sizeof(SPAN_data));
+  SPAN_generation = 0;
+  /* Empty spans, the shortest of a few tries: the overhead is what an empty span measures, from the
+   * counter read in SPAN_Begin() to the one in SPAN_End(), with the calls. The cost is the whole pair,
+   * with the statistics update, as seen by the code around the markers, without the counter reads around it. */
+  SPAN_overhead = 0;
+  SPAN_cost = UINT32_MAX;
+  SPAN_Reset(); /* the first empty span initializes its statistics */
+  for(i=0; i<8; i++) {
+    start = SPAN_GetTicks();
+    ticks = SPAN_GetTicks()-start;
+    if (ticks<read) {
+      read = ticks;
+    }
+    start = SPAN_GetTicks();
+    SPAN_Begin(SPAN_ID_DRIVE_TASK);
+    SPAN_End(SPAN_ID_DRIVE_TASK);
+    ticks = SPAN_GetTicks()-start;
+    if (ticks<SPAN_cost) {
+      SPAN_cost = ticks;
+    }
+  }
+  SPAN_cost = SPAN_cost>read?SPAN_cost-read:0;
+  SPAN_overhead = SPAN_data[SPAN_ID_DRIVE_TASK].min;
+  SPAN_Reset(); /* statistics get initialized with the first measurement */
+}
+#endif /* PL_CONFIG_HAS_SPAN */
@@ -0,0 +1,111 @@
+/**
+ * \file
+ * \brief Timing spans for the hot paths
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This module measures the execution time of code sections (spans) with the DWT cycle counter.
+ * A span has a static ID and is marked with SPAN_BEGIN() and SPAN_END(). For each span the minimum,
+ * maximum and mean time are kept, plus a histogram with power-of-two bins. The markers expand to
+ * nothing if PL_CONFIG_HAS_SPAN is disabled. On a host (simulation) build clock_gettime() is used.
+ */
+
+#ifndef SRC_SPAN_H_
+#define SRC_SPAN_H_
+
+#include "Platform.h"
+
+typedef enum {
+  SPAN_ID_DRIVE_TASK,   /* one cycle of the Drive task */
+  SPAN_ID_QUAD_SAMPLE,  /* QUAD_Sample() */
+  SPAN_ID_TACHO_CALC,   /* TACHO_CalcSpeed() */
+  SPAN_ID_PID_SPEED,    /* PID_Speed() */
+  SPAN_ID_PID_POS,      /* PID_Pos() */
+  SPAN_ID_PID_LINE,     /* PID_Line() */
+  SPAN_ID_REF_MEASURE,  /* REF_MeasureRaw() */
+  SPAN_ID_LINE_STATE,   /* LINE_StateMachine() */
+  SPAN_ID_TRG_TICK,     /* TRG_AddTick() in the tick hook */
+  SPAN_NOF_IDS
+} SPAN_Id;
+
+#if PL_CONFIG_HAS_SPAN
+  #define SPAN_BEGIN(id)  SPAN_Begin(id)
+  #define SPAN_END(id)    SPAN_End(id)
+#else
+  #define SPAN_BEGIN(id)  /* nothing */
+  #define SPAN_END(id)    /* nothing */
+#endif
+
+#if PL_CONFIG_HAS_SPAN
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef SPAN_CONFIG_HOST
+  #if defined(__arm__)
+    #define SPAN_CONFIG_HOST      (0)
+  #else
+    #define SPAN_CONFIG_HOST      (1) /* simulation build on the host, uses clock_gettime() */
+  #endif
+#endif
+#define SPAN_CONFIG_NOF_BINS      (20)  /* histogram bin n counts durations of [2^n..2^(n+1)) ticks, the last one all above */
+#define SPAN_CONFIG_USE_CCMRAM    (1 && !SPAN_CONFIG_HOST) /* place the statistics into the CCM RAM */
+
+typedef struct {
+  uint32_t count;   /* number of measurements */
+  uint32_t minNs;   /* shortest duration */
+  uint32_t maxNs;   /* longest duration */
+  uint32_t meanNs;  /* average duration */
+} SPAN_Stats;
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the timing spans, registered in Shell.c */
+extern const CMD_Group SPAN_CmdGroup;
+#endif
+
+/*!
+ * \brief Starts a measurement. A span ID must only be used by one task or interrupt at a time.
+ * \param id Span ID
+ */
+void SPAN_Begin(SPAN_Id id);
+
+/*!
+ * \brief Ends the measurement started with SPAN_Begin() and adds it to the statistics.
+ * \param id Span ID
+ */
+void SPAN_End(SPAN_Id id);
+
+/*!
+ * \brief Returns the statistics of a span.
+ * \param id Span ID
+ * \param stats Where to store the statistics
+ * \return TRUE if the span has been measured at least once
+ */
+bool SPAN_GetStats(SPAN_Id id, SPAN_Stats *stats);
+
+/*!
+ * \brief Returns the overhead of the markers, measured by SPAN_Init() with empty spans.
+ * \param subtractedNs Where to store the time an empty span measures, subtracted from each measurement
+ * \param costNs Where to store the time a SPAN_BEGIN()/SPAN_END() pair adds to the measured code
+ */
+void SPAN_GetOverhead(uint32_t *subtractedNs, uint32_t *costNs);
+
+/*!
+ * \brief Returns the short name of a span.
+ * \param id Span ID
+ * \return Name, or "?" for an unknown ID
+ */
+const unsigned char *SPAN_GetName(SPAN_Id id);
+
+/*!
+ * \brief Clears the statistics of all spans. Done with the next measurement of each span.
+ */
+void SPAN_Reset(void);
+
+/*!
+ * \brief Module initialization.
+ */
+void SPAN_Init(void);
+
+#endif /* PL_CONFIG_HAS_SPAN */
+
+#endif /* SRC_SPAN_H_ */
@@ -18,16 +18,44 @@
 #include "Turn.h"
 #include "Reflectance.h"
 #include "Event.h"
+#if PL_CONFIG_HAS_TRACKER
+  #include "Tracker.h"
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
+#if PL_CONFIG_HAS_EXEC
+  #include "Exec.h"
+#endif
 
 #define SUMO_DRIVE_SPEED   (800)
 #define SUMO_CHASE_SPEED   (1400)
 #define SUMO_USE_PROXY     (1 && PL_CONFIG_HAS_PROXIMITY)
+#ifndef SUMO_USE_TRACKER
+  #define SUMO_USE_TRACKER (1 && SUMO_USE_PROXY && PL_CONFIG_HAS_TRACKER) /* use the predicted bearing of the tracker instead of the last scan */
+#endif
+#define SUMO_CHASE_DEADBAND_DEG  (15) /* opponent within this bearing: chase without turning */
 
-/* direct task notification bits */
+#define SUMO_COUNTDOWN_MS        (5000) /* delay after start before the robot starts moving */
+#define SUMO_IDLE_PERIOD_MS      (50)   /* wake up period without maneuver, for buttons, count down and chase */
+#define SUMO_LATENCY_PERIOD_MS   (5)    /* wake up period while waiting for the motors to reverse */
+
+/* direct task notification bits, or pending events for SUMO_Step() */
 #define SUMO_START_SUMO (1<<0)  /* start sumo mode */
 #define SUMO_STOP_SUMO  (1<<1)  /* stop stop sumo */
+#define SUMO_BORDER     (1<<2)  /* reflectance sensors have seen the white border */
+#define SUMO_TARGET     (1<<3)  /* proximity sensors have seen the opponent */
+#define SUMO_MOVE_DONE  (1<<4)  /* maneuver move has finished */
+#define SUMO_BUTTON     (1<<5)  /* button event without the LCD menu, checked with ButtonPressed() */
+#define SUMO_ALL_EVENTS (SUMO_START_SUMO|SUMO_STOP_SUMO|SUMO_BORDER|SUMO_TARGET|SUMO_MOVE_DONE|SUMO_BUTTON)
+#if PL_CONFIG_HAS_EXEC
+static uint32_t SUMO_pendingEvents; /* set from any task, taken by SUMO_Step() */
+static TickType_t SUMO_wakeUpTicks; /* tick count when SUMO_Step() runs without an event */
+#else
 static TaskHandle_t sumoTaskHndl;
+#endif
 static int16_t sumoCntDownMs = 0;
+static TickType_t sumoCntDownEndTicks; /* tick count at the end of the count down */
 
 typedef enum {
 	SUMO_STATE_IDLE,
@@ -39,13 +67,42 @@ typedef enum {
 
 static SUMO_State_t SUMO_state;
 
-static bool ButtonPressed(void) {
+/* While running, the robot executes one behavior at a time. Maneuvers are started without waiting,
+   so a border event can abort any of them immediately. */
+typedef enum {
+  SUMO_BEHAVIOR_SEARCH,      /* driving straight, searching for the opponent */
+  SUMO_BEHAVIOR_CHASE,       /* opponent in front: push with full speed */
+  SUMO_BEHAVIOR_BORDER_BACK, /* maneuver: step back from the border */
+  SUMO_BEHAVIOR_BORDER_TURN, /* maneuver: turn away from the border */
+  SUMO_BEHAVIOR_TARGET_TURN, /* maneuver: turn towards the opponent */
+} SUMO_Behavior_t;
+
+static SUMO_Behavior_t SUMO_behavior;
+static TickType_t SUMO_maneuverEndTicks; /* tick count when the running maneuver times out */
+static uint32_t SUMO_borderWhiteBits; /* sensors which have seen the border, for the turn direction */
+
+/* latency from the border measurement to the reversal of the motors */
+static bool SUMO_latencyPending; /* waiting for the motors to reverse */
+static uint32_t SUMO_borderCycles; /* cycle counter timestamp of the border measurement */
+static uint32_t SUMO_latencyLastUs, SUMO_latencyMinUs, SUMO_latencyMaxUs, SUMO_nofLatencies;
+static uint32_t SUMO_nofTargetTurns; /* number of turns towards the opponent in the current bout */
+
+static bool ButtonPressed(uint32_t events) {
 #if !PL_CONFIG_HAS_LCD_MENU /* sumo gets started and stopped through LCD menu */
+  (void)events;
   return EVNT_EventIsSetAutoClear(EVNT_SW1_RELEASED);
 #else
-  uint32_t notifcationValue;
-  (void)xTaskNotifyWait(0UL, SUMO_START_SUMO|SUMO_STOP_SUMO, &notifcationValue, 0); /* check flags */
-  return notifcationValue!=0;
+  return (events&(SUMO_START_SUMO|SUMO_STOP_SUMO))!=0;
+#endif
+}
+
+static void SUMO_Notify(uint32_t events) {
+#if PL_CONFIG_HAS_EXEC
+  (void)__atomic_fetch_or(&SUMO_pendingEvents, events, __ATOMIC_RELEASE);
+#else
+  if (sumoTaskHndl!=NULL) {
+    (void)xTaskNotify(sumoTaskHndl, events, eSetBits);
+  }
 #endif
 }
 
@@ -53,12 +110,20 @@ bool SUMO_IsDoingSumo(void) {
   return SUMO_state!=SUMO_STATE_IDLE;
 }
 
+uint8_t SUMO_GetStateInfo(void) {
+  return (uint8_t)((SUMO_state<<4)|(SUMO_behavior&0xF));
+}
+
+uint32_t SUMO_GetNofTargetTurns(void) {
+  return SUMO_nofTargetTurns;
+}
+
 void SUMO_StartSumo(void) {
-  (void)xTaskNotify(sumoTaskHndl, SUMO_START_SUMO, eSetBits);
+  SUMO_Notify(SUMO_START_SUMO);
 }
 
 void SUMO_StopSumo(void) {
-  (void)xTaskNotify(sumoTaskHndl, SUMO_STOP_SUMO, eSetBits);
+  SUMO_Notify(SUMO_STOP_SUMO);
 }
 
 void SUMO_StartStopSumo(void) {
@@ -73,79 +138,228 @@ int16_t SUMO_GetCountDownMs(void) {
   return sumoCntDownMs;
 }
 
-static void SumoStateMachine(void) {
-	uint32_t refVal;
-	uint8_t bits;
+void SUMO_OnBorder(void) {
+  if (SUMO_state==SUMO_STATE_RUNNING) {
+    SUMO_Notify(SUMO_BORDER);
+  }
+}
+
+void SUMO_OnTarget(void) {
+  if (SUMO_state==SUMO_STATE_RUNNING) {
+    SUMO_Notify(SUMO_TARGET);
+  }
+}
+
+static void SUMO_OnMoveDone(DRV_MoveResult result) {
+  /* called from the Drive task: only wake up the sumo task, it checks with TURN_IsTurnDone() if its maneuver has finished */
+  if (result!=DRV_MOVE_CANCELLED) {
+    SUMO_Notify(SUMO_MOVE_DONE);
+  }
+}
+
+static bool SUMO_IsManeuver(SUMO_Behavior_t behavior) {
+  return behavior==SUMO_BEHAVIOR_BORDER_BACK || behavior==SUMO_BEHAVIOR_BORDER_TURN || behavior==SUMO_BEHAVIOR_TARGET_TURN;
+}
+
+static void SUMO_StartBehavior(SUMO_Behavior_t behavior, int16_t angle) {
+  int32_t timeoutMs = 0;
+
+  switch(behavior) {
+    case SUMO_BEHAVIOR_SEARCH:
+      DRV_SetSpeed(SUMO_DRIVE_SPEED, SUMO_DRIVE_SPEED);
+      DRV_SetMode(DRV_MODE_SPEED);
+      break;
+    case SUMO_BEHAVIOR_CHASE:
+      DRV_SetSpeed(SUMO_CHASE_SPEED, SUMO_CHASE_SPEED);
+      DRV_SetMode(DRV_MODE_SPEED);
+      break;
+    case SUMO_BEHAVIOR_BORDER_BACK:
+      timeoutMs = TURN_StartTurn(TURN_STEP_BORDER_BW, SUMO_OnMoveDone);
+      break;
+    case SUMO_BEHAVIOR_BORDER_TURN:
+      if (SUMO_borderWhiteBits&0x3) { /* border seen on the left side */
+        timeoutMs = TURN_StartTurn(TURN_RIGHT90, SUMO_OnMoveDone);
+      } else {
+        timeoutMs = TURN_StartTurn(TURN_LEFT90, SUMO_OnMoveDone);
+      }
+      break;
+    case SUMO_BEHAVIOR_TARGET_TURN:
+      timeoutMs = TURN_StartTurnAngle(angle, SUMO_OnMoveDone);
+      SUMO_nofTargetTurns++;
+      break;
+    default:
+      break;
+  }
+  SUMO_maneuverEndTicks = xTaskGetTickCount()+pdMS_TO_TICKS(timeoutMs);
+  SUMO_behavior = behavior;
+}
+
+static void SUMO_UpdateLatency(void) {
+  uint32_t revL, revR, cycles, us;
+
+  revL = MOT_GetReverseCycles(MOT_GetMotorHandle(MOT_MOTOR_LEFT));
+  revR = MOT_GetReverseCycles(MOT_GetMotorHandle(MOT_MOTOR_RIGHT));
+  if ((int32_t)(revL-SUMO_borderCycles)<0 || (int32_t)(revR-SUMO_borderCycles)<0) {
+    return; /* not both motors reversed yet */
+  }
+  cycles = revL-SUMO_borderCycles;
+  if (revR-SUMO_borderCycles>cycles) {
+    cycles = revR-SUMO_borderCycles; /* the later of the two motors */
+  }
+  us = cycles/(configCPU_CLOCK_HZ/1000000);
+  SUMO_latencyLastUs = us;
+  if (SUMO_nofLatencies==0 || us<SUMO_latencyMinUs) {
+    SUMO_latencyMinUs = us;
+  }
+  if (us>SUMO_latencyMaxUs) {
+    SUMO_latencyMaxUs = us;
+  }
+  SUMO_nofLatencies++;
+  SUMO_latencyPending = FALSE;
+}
 
+static void SUMO_OnBorderEvent(void) {
+  REF_Snapshot ref;
+  SBUS_Stamp stamp;
+
+  if (!REF_GetSnapshot(&ref, &stamp) || ref.whiteBits==0) {
+    return; /* already back on black */
+  }
+  if (SUMO_behavior==SUMO_BEHAVIOR_BORDER_BACK
+      && MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT))==MOT_DIR_BACKWARD
+      && MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_RIGHT))==MOT_DIR_BACKWARD)
+  {
+    return; /* already stepping back, otherwise pushed or overshooting: start again */
+  }
+  SUMO_borderWhiteBits = ref.whiteBits;
+  SUMO_borderCycles = stamp.timestamp;
+  SUMO_latencyPending = MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT))==MOT_DIR_FORWARD
+                     || MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_RIGHT))==MOT_DIR_FORWARD;
+  SUMO_StartBehavior(SUMO_BEHAVIOR_BORDER_BACK, 0); /* aborts any other behavior */
+}
+
+#if SUMO_USE_PROXY
+static bool SUMO_HasTarget(void) {
+#if SUMO_USE_TRACKER
+  TRACK_Estimate track;
+
+  return TRACK_GetEstimate(&track);
+#else
+  return PROX_HasTarget();
+#endif
+}
+
+static void SUMO_OnTargetEvent(void) {
+#if SUMO_USE_TRACKER
+  TRACK_Estimate track;
+#else
+  PROX_Result prox;
+#endif
+  int angle;
+
+  if (SUMO_IsManeuver(SUMO_behavior)) {
+    return; /* finish the maneuver first */
+  }
+#if SUMO_USE_TRACKER
+  if (!TRACK_GetEstimate(&track)) {
+    return; /* not confirmed by enough scans yet */
+  }
+  angle = track.bearing;
+#else
+  if (!PROX_GetResult(&prox, NULL) || !prox.proximityFound) {
+    return;
+  }
+  angle = prox.proximityAngle;
+#endif
+  if (angle>=-SUMO_CHASE_DEADBAND_DEG && angle<=SUMO_CHASE_DEADBAND_DEG) { /* in front */
+    if (SUMO_behavior!=SUMO_BEHAVIOR_CHASE) {
+      SUMO_StartBehavior(SUMO_BEHAVIOR_CHASE, 0);
+    }
+  } else if (angle>=-90 && angle<=90) {
+    SUMO_StartBehavior(SUMO_BEHAVIOR_TARGET_TURN, (int16_t)angle);
+  }
+}
+#endif
+
+static void SUMO_RunBehavior(uint32_t events) {
+  if (events&SUMO_BORDER) { /* border has highest priority */
+    SUMO_OnBorderEvent();
+  }
+  if (SUMO_latencyPending) {
+    SUMO_UpdateLatency();
+  }
+  if (SUMO_IsManeuver(SUMO_behavior)) {
+    if (!TURN_IsTurnDone() && (int32_t)(xTaskGetTickCount()-SUMO_maneuverEndTicks)<0) {
+      return; /* maneuver still running */
+    }
+    SUMO_latencyPending = FALSE; /* motors did not reverse during the maneuver */
+    if (SUMO_behavior==SUMO_BEHAVIOR_BORDER_BACK) {
+      SUMO_StartBehavior(SUMO_BEHAVIOR_BORDER_TURN, 0);
+      return;
+    }
+    SUMO_StartBehavior(SUMO_BEHAVIOR_SEARCH, 0);
+  }
+#if SUMO_USE_PROXY
+  if (events&SUMO_TARGET) {
+    SUMO_OnTargetEvent();
+  } else if (SUMO_behavior==SUMO_BEHAVIOR_CHASE && !SUMO_HasTarget()) { /* lost the opponent */
+    SUMO_StartBehavior(SUMO_BEHAVIOR_SEARCH, 0);
+  }
+#endif
+}
+
+static void SumoStateMachine(uint32_t events) {
 	for(;;) { /* breaks */
 		switch(SUMO_state) {
 			case SUMO_STATE_IDLE:
-				if (ButtonPressed()) {
-					refVal = REF_IsWhite();
-					if (refVal==0) { /* all black */
+				if (ButtonPressed(events)) {
+					if (REF_IsWhite()==0) { /* all black */
+					  sumoCntDownEndTicks = xTaskGetTickCount()+pdMS_TO_TICKS(SUMO_COUNTDOWN_MS);
+					  sumoCntDownMs = SUMO_COUNTDOWN_MS;
 					  SUMO_state = SUMO_STATE_COUNTDOWN;
-					  continue;
 					}
 				}
 				break;
 
 			case SUMO_STATE_COUNTDOWN:
-			  sumoCntDownMs = 5000;
-			  while(sumoCntDownMs>0) { /* 5 seconds delay */
-			    vTaskDelay(pdMS_TO_TICKS(50));
-			    sumoCntDownMs -= 50;
-			    if (ButtonPressed()) {
-			      break; /* abort */
-			    }
+			  if (ButtonPressed(events)) {
+			    sumoCntDownMs = 0;
+			    SUMO_state = SUMO_STATE_IDLE; /* aborted */
+			    break;
 			  }
+			  sumoCntDownMs = (int16_t)((int32_t)(sumoCntDownEndTicks-xTaskGetTickCount())*portTICK_PERIOD_MS);
 			  if (sumoCntDownMs<=0) { /* count down expired */
+			    sumoCntDownMs = 0;
 			    SUMO_state = SUMO_STATE_START_RUNNING;
-			  } else {
-          SUMO_state = SUMO_STATE_IDLE; /* aborted */
+			    continue; /* advance to next state */
 			  }
-        sumoCntDownMs = 0;
 			  break;
 
 			case SUMO_STATE_START_RUNNING:
-				DRV_SetSpeed(SUMO_DRIVE_SPEED, SUMO_DRIVE_SPEED);
-				DRV_SetMode(DRV_MODE_SPEED);
+				SUMO_latencyPending = FALSE;
+				SUMO_nofTargetTurns = 0;
+#if SUMO_USE_TRACKER
+				TRACK_Reset(); /* do not use a track from before the bout */
+#endif
+#if PL_CONFIG_HAS_RECORDER
+				REC_Arm(); /* record the new bout */
+#endif
+				SUMO_StartBehavior(SUMO_BEHAVIOR_SEARCH, 0);
 				SUMO_state = SUMO_STATE_RUNNING;
-				continue; /* advance to next state */
+				break;
 			case SUMO_STATE_RUNNING:
-				if (ButtonPressed()) {
+				if (ButtonPressed(events)) {
 					SUMO_state = SUMO_STATE_STOP;
 					continue; /* advance to next state */
 				}
-				refVal = REF_IsWhite();
-				if (refVal!=0) { /* white? */
-				  TURN_Turn(TURN_STEP_BORDER_BW, NULL);
-				  if (refVal&0x3) {
-					TURN_Turn(TURN_RIGHT90, NULL);
-				  } else {
-				    TURN_Turn(TURN_LEFT90, NULL);
-				  }
-				  SUMO_state = SUMO_STATE_START_RUNNING;
-				  continue; /* advance to next state */
-				}
-#if SUMO_USE_PROXY
-				if (PROX_HasTarget()) {
-					int angle = PROX_GetTargetAngle();
-					if (angle==0) { /* in front */
-						DRV_SetSpeed(SUMO_CHASE_SPEED, SUMO_CHASE_SPEED);
-					} else if (angle>=-90 && angle<=90) {
-						TURN_TurnAngle(angle, NULL);
-						SUMO_state = SUMO_STATE_START_RUNNING;
-						continue; /* advance to next state */
-					}
-				}
-#endif
+				SUMO_RunBehavior(events);
 				break;
 			case SUMO_STATE_STOP:
+#if PL_CONFIG_HAS_RECORDER
+				REC_Trigger(REC_TRIGGER_SUMO_STOP);
+#endif
 				DRV_SetMode(DRV_MODE_STOP);
 				SUMO_state = SUMO_STATE_IDLE;
-				while (ButtonPressed()) {
-					vTaskDelay(pdMS_TO_TICKS(50));
-				}
 				break;
 			default:
 				break;
@@ -154,47 +368,131 @@ static void SumoStateMachine(void) {
 	} /* for */
 }
 
+static TickType_t SumoWaitTicks(void) {
+  TickType_t ticks;
+
+  if (SUMO_state==SUMO_STATE_RUNNING) {
+    if (SUMO_latencyPending) {
+      return pdMS_TO_TICKS(SUMO_LATENCY_PERIOD_MS);
+    }
+    if (SUMO_IsManeuver(SUMO_behavior)) { /* the end of the move wakes us up, otherwise its timeout */
+      ticks = SUMO_maneuverEndTicks-xTaskGetTickCount();
+      if ((int32_t)ticks<=0) {
+        return 0;
+      }
+      if (ticks<pdMS_TO_TICKS(SUMO_IDLE_PERIOD_MS)) {
+        return ticks;
+      }
+    }
+  }
+  return pdMS_TO_TICKS(SUMO_IDLE_PERIOD_MS);
+}
+
+#if PL_CONFIG_HAS_EXEC
+void SUMO_Step(void) {
+  uint32_t events;
+
+  events = __atomic_exchange_n(&SUMO_pendingEvents, 0, __ATOMIC_ACQUIRE);
+#if !PL_CONFIG_HAS_LCD_MENU
+  if (EVNT_EventIsSet(EVNT_SW1_RELEASED)) { /* polled instead of a subscription */
+    events |= SUMO_BUTTON;
+  }
+#endif
+  if (events==0 && (int32_t)(xTaskGetTickCount()-SUMO_wakeUpTicks)<0) {
+    return; /* nothing to do in this cycle */
+  }
+  SumoStateMachine(events);
+  SUMO_wakeUpTicks = xTaskGetTickCount()+SumoWaitTicks();
+}
+#else
 static void SumoTask(void *pvParameters) {
-  (void)pvParameters; /* parameter not used */
+  uint32_t events;
 
+  (void)pvParameters; /* parameter not used */
   SUMO_state = SUMO_STATE_IDLE;
   for(;;) {
-	  SumoStateMachine();
-	  vTaskDelay(pdMS_TO_TICKS(5));
+    events = 0;
+    (void)xTaskNotifyWait(0UL, SUMO_ALL_EVENTS, &events, SumoWaitTicks()); /* wait for an event or the period */
+    SumoStateMachine(events);
   }
 }
+#endif /* PL_CONFIG_HAS_EXEC */
 
 #if PL_CONFIG_HAS_SHELL
-uint8_t SUMO_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-  uint8_t res=ERR_OK;
-
-  if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_HELP)==0 || McuUtility_strcmp((const char *)cmd, "sumo help")==0) {
-    McuShell_SendHelpStr((const unsigned char*)"sumo", (const unsigned char*)"Sumo command group\r\n", io->stdOut);
-    McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_STATUS)==0 || McuUtility_strcmp((const char*)cmd, "sumo status")==0) {
-    McuShell_SendStr((const unsigned char*)"sumo:\r\n", io->stdOut);
-    McuShell_SendStatusStr((const unsigned char*)"  tbd", (const unsigned char*)"", io->stdOut);
-    McuShell_SendStr((const unsigned char*)"\r\n", io->stdOut);
-    *handled = TRUE;
+static const unsigned char *SUMO_BehaviorStr(SUMO_Behavior_t behavior) {
+  if (SUMO_state!=SUMO_STATE_RUNNING) {
+    return (const unsigned char*)"not running";
+  }
+  switch(behavior) {
+    case SUMO_BEHAVIOR_SEARCH:      return (const unsigned char*)"search";
+    case SUMO_BEHAVIOR_CHASE:       return (const unsigned char*)"chase";
+    case SUMO_BEHAVIOR_BORDER_BACK: return (const unsigned char*)"border back";
+    case SUMO_BEHAVIOR_BORDER_TURN: return (const unsigned char*)"border turn";
+    case SUMO_BEHAVIOR_TARGET_TURN: return (const unsigned char*)"target turn";
+    default:                        return (const unsigned char*)"unknown";
   }
-  return res;
 }
+
+static void SUMO_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((const unsigned char*)"sumo", (const unsigned char*)"Sumo command group\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  reset", (const unsigned char*)"Reset the border latency statistics\r\n", io->stdOut);
+}
+
+static void SUMO_PrintStatus(const McuShell_StdIOType *io) {
+  McuShell_SendStr((const unsigned char*)"sumo:\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  behavior", SUMO_BehaviorStr(SUMO_behavior), io->stdOut);
+  McuShell_SendStr((const unsigned char*)"\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  border lat", (const unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(SUMO_latencyLastUs, io->stdOut);
+  McuShell_SendStr((const unsigned char*)" us (min ", io->stdOut);
+  McuShell_SendNum32u(SUMO_latencyMinUs, io->stdOut);
+  McuShell_SendStr((const unsigned char*)", max ", io->stdOut);
+  McuShell_SendNum32u(SUMO_latencyMaxUs, io->stdOut);
+  McuShell_SendStr((const unsigned char*)", #", io->stdOut);
+  McuShell_SendNum32u(SUMO_nofLatencies, io->stdOut);
+  McuShell_SendStr((const unsigned char*)")\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  target turns", (const unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(SUMO_nofTargetTurns, io->stdOut);
+  McuShell_SendStr((const unsigned char*)" (this bout)\r\n", io->stdOut);
+}
+
+static uint8_t SUMO_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  SUMO_nofLatencies = 0;
+  SUMO_latencyLastUs = SUMO_latencyMinUs = SUMO_latencyMaxUs = 0;
+  return ERR_OK;
+}
+
+static const CMD_Command SUMO_Cmds[] = {
+  {"reset", "", SUMO_CmdReset},
+};
+
+const CMD_Group SUMO_CmdGroup = CMD_GROUP("sumo", SUMO_PrintHelp, SUMO_PrintStatus, SUMO_Cmds);
 #endif /* PL_CONFIG_HAS_SHELL */
 
 
 void SUMO_Init(void) {
+#if PL_CONFIG_HAS_EXEC /* SUMO_Step() runs in the executive */
+  SUMO_state = SUMO_STATE_IDLE;
+  SUMO_pendingEvents = 0;
+  SUMO_wakeUpTicks = 0;
+#else
   if (xTaskCreate(
     SumoTask,  /* pointer to the task */
         "SumoTask", /* task name for kernel awareness debugging */
-        (300+50)/sizeof(StackType_t), /* task stack size */
+        (300+100)/sizeof(StackType_t), /* task stack size */
         (void*)NULL, /* optional task startup argument */
-        tskIDLE_PRIORITY+1,  /* initial priority */
+        tskIDLE_PRIORITY+2,  /* initial priority, same as the sensor tasks so events are handled right after the measurement */
         &sumoTaskHndl /* optional task handle to create */
       ) != pdPASS) {
     /*lint -e527 */
     for(;;){}; /* error! probably out of memory */
     /*lint +e527 */
   }
+#if !PL_CONFIG_HAS_LCD_MENU && EVNT_CONFIG_NOF_SUBSCRIBERS>0
+  (void)EVNT_Subscribe(EVNT_SW1_RELEASED, sumoTaskHndl, SUMO_BUTTON); /* wake up for the button instead of the next period */
+#endif
+#endif /* PL_CONFIG_HAS_EXEC */
 }
 #endif /* PL_CONFIG_HAS_SUMO */
@@ -10,15 +10,9 @@
 #define SRC_ROBOT_SUMO_H_
 
 #if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
-/*!
- * \brief Parses a command
- * \param cmd Command string to be parsed
- * \param handled Sets this variable to TRUE if command was handled
- * \param io I/O stream to be used for input/output
- * \return Error code, ERR_OK if everything was fine
- */
-uint8_t SUMO_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the sumo strategy, registered in Shell.c */
+extern const CMD_Group SUMO_CmdGroup;
 #endif
 
 bool SUMO_IsDoingSumo(void);
@@ -31,6 +25,35 @@ void SUMO_StartStopSumo(void);
 
 int16_t SUMO_GetCountDownMs(void);
 
+/*!
+ * \brief Returns the state of the sumo logic, for diagnostics.
+ * \return State in the upper, behavior in the lower nibble
+ */
+uint8_t SUMO_GetStateInfo(void);
+
+/*!
+ * \brief Returns the number of turns towards the opponent, for diagnostics.
+ * \return Number of target turns since the start of the current bout
+ */
+uint32_t SUMO_GetNofTargetTurns(void);
+
+/*!
+ * \brief Called by the reflectance task after a measurement has seen the white border.
+ */
+void SUMO_OnBorder(void);
+
+/*!
+ * \brief Called by the proximity task after a measurement has seen the opponent.
+ */
+void SUMO_OnTarget(void);
+
+#if PL_CONFIG_HAS_EXEC
+/*!
+ * \brief Plan stage of the executive: runs the strategy if an event is pending or its period is due.
+ */
+void SUMO_Step(void);
+#endif
+
 void SUMO_Init(void);
 
 #endif /* SRC_ROBOT_SUMO_H_ */
@@ -15,7 +15,9 @@
 #endif
 #include "McuUtility.h"
 #include "FreeRTOS.h"
-#include "McuCriticalSection.h"
+#include "McuArmTools.h"
+#include "SensorBus.h"
+#include "Span.h"
 
 #define TACHO_SAMPLE_PERIOD_MS (5)     
   /*!< speed sample period in ms. Make sure that speed is sampled at the given rate. */
@@ -26,68 +28,150 @@ static volatile QUAD_QuadCntrType TACHO_LeftPosHistory[NOF_HISTORY], TACHO_Right
   /*!< for better accuracy, we calculate the speed over some samples */
 static volatile uint8_t TACHO_PosHistory_Index = 0;
   /*!< position index in history */
+static SBUS_SeqLock TACHO_PosHistory_Lock;
+  /*!< protects the history, written from the tick interrupt */
 
-static int32_t TACHO_currLeftSpeed = 0, TACHO_currRightSpeed = 0;
-  /*!< position index in history */
+#define TACHO_DELTA_MIN_STEPS    (8)
+  /*!< minimum number of steps in the window to use the position delta method */
+#define TACHO_DELTA_MAX_WINDOW   (4U)
+  /*!< longest window (in history samples) for the position delta method. If less than TACHO_DELTA_MIN_STEPS are in this window, the step period is used */
+#define TACHO_PERIOD_TIMEOUT_MS  (100)
+  /*!< if there was no encoder step within this time, the step period is not used any more */
+#define TACHO_STAT_SHIFT         (3)
+  /*!< running mean and variance filter factor, 1/(2^TACHO_STAT_SHIFT) */
+
+typedef struct {
+  int32_t speed;       /*!< current speed, steps/sec */
+  int32_t mean;        /*!< running mean of the speed, for the variance */
+  uint32_t variance;   /*!< running variance, (steps/sec)^2 */
+  uint32_t ageUs;      /*!< age of the information the speed is based on */
+  TACHO_Method method; /*!< method used for the speed */
+} TACHO_SpeedState;
+
+static TACHO_SpeedState TACHO_leftState, TACHO_rightState;
 
 int32_t TACHO_GetSpeed(bool isLeft) {
   if (isLeft) {
-    return TACHO_currLeftSpeed;
+    return TACHO_leftState.speed;
   } else {
-    return TACHO_currRightSpeed;
+    return TACHO_rightState.speed;
   }
 }
 
-void TACHO_CalcSpeed(void) {
-  /* we calculate the speed as follow:
-                              1000         
-  steps/sec =  delta * ----------------- 
-                       samplePeriod (ms) 
-  As this function may be called very frequently, it is important to make it as efficient as possible!
-   */
-  int32_t deltaLeft, deltaRight, newLeft, newRight, oldLeft, oldRight;
-  int32_t speedLeft, speedRight;
-  bool negLeft, negRight;
-  McuCriticalSection_CriticalVariable()
-
-  McuCriticalSection_EnterCritical();
-  oldLeft = (int32_t)TACHO_LeftPosHistory[TACHO_PosHistory_Index]; /* oldest left entry */
-  oldRight = (int32_t)TACHO_RightPosHistory[TACHO_PosHistory_Index]; /* oldest right entry */
-  if (TACHO_PosHistory_Index==0) { /* get newest entry */
-    newLeft = (int32_t)TACHO_LeftPosHistory[NOF_HISTORY-1];
-    newRight = (int32_t)TACHO_RightPosHistory[NOF_HISTORY-1];
+void TACHO_GetSpeedInfo(bool isLeft, TACHO_SpeedInfo *info) {
+  TACHO_SpeedState *state;
+
+  if (isLeft) {
+    state = &TACHO_leftState;
   } else {
-    newLeft = (int32_t)TACHO_LeftPosHistory[TACHO_PosHistory_Index-1];
-    newRight = (int32_t)TACHO_RightPosHistory[TACHO_PosHistory_Index-1];
+    state = &TACHO_rightState;
   }
-  McuCriticalSection_ExitCritical();
-  deltaLeft = oldLeft-newLeft; /* delta of oldest position and most recent one */
-  /* use unsigned arithmetic */
-  if (deltaLeft < 0) {
-    deltaLeft = -deltaLeft;
-    negLeft = TRUE;
-  } else {
-    negLeft = FALSE;
+  info->speed = state->speed;
+  info->variance = state->variance;
+  info->ageUs = state->ageUs;
+  info->method = state->method;
+}
+
+static void UpdateStatistics(TACHO_SpeedState *state, int32_t speed) {
+  int32_t diff;
+  uint32_t sqr;
+
+  diff = speed-state->mean;
+  state->mean += diff/(1<<TACHO_STAT_SHIFT);
+  if (diff<0) {
+    diff = -diff;
   }
-  deltaRight = oldRight-newRight; /* delta of oldest position and most recent one */
-  /* use unsigned arithmetic */
-  if (deltaRight < 0) {
-    deltaRight = -deltaRight;
-    negRight = TRUE;
-  } else {
-    negRight = FALSE;
+  if (diff>0xffff) { /* avoid overflow of the square */
+    diff = 0xffff;
+  }
+  sqr = (uint32_t)diff*(uint32_t)diff;
+  state->variance = state->variance-(state->variance>>TACHO_STAT_SHIFT)+(sqr>>TACHO_STAT_SHIFT);
+  state->speed = speed;
+}
+
+/*!
+ * \brief Calculates the speed of one wheel.
+ * \param state Speed state of the wheel
+ * \param pos Position history, pos[0] is the most recent sample, pos[NOF_HISTORY-1] the oldest one
+ * \param isLeft If this is the left wheel
+ */
+static void CalcWheelSpeed(TACHO_SpeedState *state, const int32_t *pos, bool isLeft) {
+  /* Position delta method: with enough steps in a short window, the speed is
+                                  1000
+     steps/sec =  delta * ----------------------
+                          n * samplePeriod (ms)
+     The window n is adapted to the speed: the faster, the shorter the window and the smaller the lag.
+     At low speed there are not enough steps for the delta method, so the time between the last
+     encoder steps (captured in the quadrature decoder) is used instead. */
+  uint32_t n, periodCycles, lastStepCycles, ageCycles, cyclesPerMs;
+  int32_t delta, speed;
+  int8_t dir;
+  bool periodValid;
+
+  for(n=1; n<=TACHO_DELTA_MAX_WINDOW; n++) {
+    delta = pos[0]-pos[n];
+    if (delta>=TACHO_DELTA_MIN_STEPS || delta<=-TACHO_DELTA_MIN_STEPS) {
+      speed = (delta*1000)/(int32_t)(n*TACHO_SAMPLE_PERIOD_MS);
+      state->ageUs = (n*TACHO_SAMPLE_PERIOD_MS*1000U)/2; /* a moving difference lags by half of its window */
+      state->method = TACHO_METHOD_DELTA;
+      UpdateStatistics(state, speed);
+      return;
+    }
+  }
+  delta = pos[0]-pos[NOF_HISTORY-1];
+  if (delta==0) { /* no movement in the whole history: standing still */
+    state->ageUs = ((NOF_HISTORY-1)*TACHO_SAMPLE_PERIOD_MS*1000U)/2;
+    state->method = TACHO_METHOD_DELTA;
+    UpdateStatistics(state, 0);
+    return;
   }
-  /* calculate speed. this is based on the delta and the time (number of samples or entries in the history table) */
-  speedLeft = (int32_t)(deltaLeft*1000U/(TACHO_SAMPLE_PERIOD_MS*(NOF_HISTORY-1)));
-  if (negLeft) {
-    speedLeft = -speedLeft;
+  if (isLeft) {
+    periodValid = QUAD_GetLeftStepTiming(&periodCycles, &lastStepCycles, &dir);
+  } else {
+    periodValid = QUAD_GetRightStepTiming(&periodCycles, &lastStepCycles, &dir);
   }
-  speedRight = (int32_t)(deltaRight*1000U/(TACHO_SAMPLE_PERIOD_MS*(NOF_HISTORY-1)));
-  if (negRight) {
-    speedRight = -speedRight;
+  cyclesPerMs = configCPU_CLOCK_HZ/1000;
+  ageCycles = McuArmTools_GetCycleCounter()-lastStepCycles;
+  if (periodValid && ageCycles<TACHO_PERIOD_TIMEOUT_MS*cyclesPerMs) {
+    if (ageCycles>periodCycles) { /* no step since longer than the last period: wheel is slowing down */
+      periodCycles = ageCycles;
+    }
+    speed = (int32_t)(configCPU_CLOCK_HZ/periodCycles);
+    if (dir<0) {
+      speed = -speed;
+    }
+    state->ageUs = (ageCycles*1000U)/cyclesPerMs;
+    state->method = TACHO_METHOD_PERIOD;
+  } else { /* very slow or direction change: use the whole history */
+    speed = (delta*1000)/(int32_t)((NOF_HISTORY-1)*TACHO_SAMPLE_PERIOD_MS);
+    state->ageUs = ((NOF_HISTORY-1)*TACHO_SAMPLE_PERIOD_MS*1000U)/2;
+    state->method = TACHO_METHOD_DELTA;
   }
-  TACHO_currLeftSpeed = -speedLeft; /* store current speed in global variable */
-  TACHO_currRightSpeed = -speedRight; /* store current speed in global variable */
+  UpdateStatistics(state, speed);
+}
+
+void TACHO_CalcSpeed(void) {
+  /* As this function may be called very frequently, it is important to make it as efficient as possible! */
+  int32_t left[NOF_HISTORY], right[NOF_HISTORY];
+  unsigned int i, idx;
+  uint32_t seq;
+
+  SPAN_BEGIN(SPAN_ID_TACHO_CALC);
+  do { /* the sampling interrupt cannot be preempted by us: repeat only if it has been running during the copy */
+    seq = SBUS_ReadBegin(&TACHO_PosHistory_Lock);
+    idx = TACHO_PosHistory_Index; /* index of the oldest entry */
+    for(i=0; i<NOF_HISTORY; i++) { /* copy the history, most recent entry first */
+      if (idx==0) {
+        idx = NOF_HISTORY;
+      }
+      idx--;
+      left[i] = (int32_t)TACHO_LeftPosHistory[idx];
+      right[i] = (int32_t)TACHO_RightPosHistory[idx];
+    }
+  } while (SBUS_ReadRetry(&TACHO_PosHistory_Lock, seq));
+  CalcWheelSpeed(&TACHO_leftState, left, TRUE);
+  CalcWheelSpeed(&TACHO_rightState, right, FALSE);
+  SPAN_END(SPAN_ID_TACHO_CALC);
 }
 
 void TACHO_Sample(void) {
@@ -100,28 +184,42 @@ void TACHO_Sample(void) {
   }
   cnt = 0; /* reset counter */
 #endif
-  /* left */
+  SBUS_WriteBegin(&TACHO_PosHistory_Lock);
   TACHO_LeftPosHistory[TACHO_PosHistory_Index] = QUAD_GetLeftPos();
   TACHO_RightPosHistory[TACHO_PosHistory_Index] = QUAD_GetRightPos();
   TACHO_PosHistory_Index++;
   if (TACHO_PosHistory_Index >= NOF_HISTORY) {
     TACHO_PosHistory_Index = 0;
   }
+  SBUS_WriteEnd(&TACHO_PosHistory_Lock);
 }
 
 #if PL_CONFIG_HAS_SHELL
+static void TACHO_PrintSpeedInfo(const unsigned char *title, bool isLeft, const McuShell_StdIOType *io) {
+  TACHO_SpeedInfo info;
+
+  TACHO_GetSpeedInfo(isLeft, &info);
+  McuShell_SendStatusStr(title, (unsigned char*)"", io->stdOut);
+  McuShell_SendNum32s(info.speed, io->stdOut);
+  if (info.method==TACHO_METHOD_PERIOD) {
+    McuShell_SendStr((unsigned char*)" steps/sec (period), var ", io->stdOut);
+  } else {
+    McuShell_SendStr((unsigned char*)" steps/sec (delta), var ", io->stdOut);
+  }
+  McuShell_SendNum32u(info.variance, io->stdOut);
+  McuShell_SendStr((unsigned char*)", age ", io->stdOut);
+  McuShell_SendNum32u(info.ageUs, io->stdOut);
+  McuShell_SendStr((unsigned char*)" us\r\n", io->stdOut);
+}
+
 /*!
  * \brief Prints the system low power status
  * \param io I/O channel to use for printing status
  */
 static void TACHO_PrintStatus(const McuShell_StdIOType *io) {
   McuShell_SendStatusStr((unsigned char*)"Tacho", (unsigned char*)"\r\n", io->stdOut);
-  McuShell_SendStatusStr((unsigned char*)"  L speed", (unsigned char*)"", io->stdOut);
-  McuShell_SendNum32s(TACHO_GetSpeed(TRUE), io->stdOut);
-  McuShell_SendStr((unsigned char*)" steps/sec\r\n", io->stdOut);
-  McuShell_SendStatusStr((unsigned char*)"  R speed", (unsigned char*)"", io->stdOut);
-  McuShell_SendNum32s(TACHO_GetSpeed(FALSE), io->stdOut);
-  McuShell_SendStr((unsigned char*)" steps/sec\r\n", io->stdOut);
+  TACHO_PrintSpeedInfo((unsigned char*)"  L speed", TRUE, io);
+  TACHO_PrintSpeedInfo((unsigned char*)"  R speed", FALSE, io);
 }
 
 /*! 
@@ -149,8 +247,10 @@ void TACHO_Deinit(void) {
 }
 
 void TACHO_Init(void) {
-  TACHO_currLeftSpeed = 0;
-  TACHO_currRightSpeed = 0;
+  TACHO_leftState.speed = 0;
+  TACHO_leftState.mean = 0;
+  TACHO_leftState.variance = 0;
+  TACHO_rightState = TACHO_leftState;
   TACHO_PosHistory_Index = 0;
 }
 
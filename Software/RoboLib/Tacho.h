@@ -10,6 +10,25 @@
 #include "Platform.h"
 
 #if PL_CONFIG_HAS_MOTOR_TACHO
+typedef enum {
+  TACHO_METHOD_DELTA,  /*!< position delta over an adaptive window */
+  TACHO_METHOD_PERIOD  /*!< time between the last encoder steps */
+} TACHO_Method;
+
+typedef struct {
+  int32_t speed;       /*!< speed in steps/sec, same as TACHO_GetSpeed() */
+  uint32_t variance;   /*!< running variance of the speed, in (steps/sec)^2 */
+  uint32_t ageUs;      /*!< age of the information the speed is based on, in micro seconds */
+  TACHO_Method method; /*!< method used for the speed */
+} TACHO_SpeedInfo;
+
+/*!
+ * \brief Returns the previously calculated speed of the motor together with its quality information.
+ * \param isLeft TRUE for left speed, FALSE for right speed.
+ * \param info Where to store the information
+ */
+void TACHO_GetSpeedInfo(bool isLeft, TACHO_SpeedInfo *info);
+
 /*!
  * \brief Returns the previously calculated speed of the motor.
  * \param isLeft TRUE for left speed, FALSE for right speed.
@@ -0,0 +1,257 @@
+/**
+ * \file
+ * \brief Binary telemetry over RTT
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The RTT buffer holds a whole number of frames, and only this module writes to it. So the write
+ * offset is always at a frame boundary and a frame never wraps around the end of the buffer: the
+ * frame is filled directly in the RTT buffer (reserve) and made visible to the host by moving the
+ * write offset (commit). No lock and no copy is needed.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_TELEMETRY
+#include "Telemetry.h"
+#include "SEGGER_RTT.h"
+#include "McuArmTools.h"
+#include "McuUtility.h"
+#include "SensorBus.h"
+#include "Drive.h"
+#include "Motor.h"
+#include <string.h>
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_LINE
+  #include "Line.h"
+#endif
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  #include "Tacho.h"
+#endif
+#if PL_CONFIG_HAS_PID
+  #include "Pid.h"
+#endif
+#if PL_CONFIG_HAS_SUMO
+  #include "Sumo.h"
+#endif
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+#endif
+
+static uint32_t TELE_buffer[(TELE_CONFIG_NOF_FRAMES*TELE_FRAME_SIZE)/sizeof(uint32_t)]; /* RTT buffer, word aligned */
+static bool TELE_isOn = FALSE;
+static uint16_t TELE_seq; /* sequence number of the next frame */
+static uint32_t TELE_nofFrames, TELE_nofDropped; /* statistics */
+static uint32_t TELE_cycles, TELE_cyclesMax; /* time used for a frame */
+
+/*!
+ * \brief Reserves space for a frame in the RTT buffer.
+ * \return Pointer to the frame in the RTT buffer, NULL if the buffer is full
+ */
+static TELE_Frame *TELE_Reserve(void) {
+  SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[TELE_CONFIG_RTT_CHANNEL];
+  unsigned wrOff, rdOff, avail;
+
+  wrOff = up->WrOff;
+  rdOff = up->RdOff; /* updated by the host */
+  if (rdOff>wrOff) {
+    avail = rdOff-wrOff-1;
+  } else {
+    avail = up->SizeOfBuffer-(wrOff-rdOff)-1; /* one byte stays unused to tell full from empty */
+  }
+  if (avail<TELE_FRAME_SIZE) {
+    return NULL;
+  }
+  return (TELE_Frame*)(up->pBuffer+wrOff);
+}
+
+/*!
+ * \brief Hands the reserved frame over to the host.
+ */
+static void TELE_Commit(void) {
+  SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[TELE_CONFIG_RTT_CHANNEL];
+  unsigned wrOff;
+
+  wrOff = up->WrOff+TELE_FRAME_SIZE;
+  if (wrOff>=up->SizeOfBuffer) {
+    wrOff = 0;
+  }
+  SBUS_MEMORY_BARRIER(); /* frame has to be complete before the host can see it */
+  up->WrOff = wrOff;
+}
+
+static int16_t TELE_Sat16(int32_t val) {
+  if (val>INT16_MAX) {
+    return INT16_MAX;
+  } else if (val<INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)val;
+}
+
+#if PL_CONFIG_HAS_PID
+static void TELE_SamplePID(TELE_Frame *frame, DRV_Mode mode) {
+  PID_Config *cfg;
+  PID_ConfigType left = PID_CONFIG_SPEED_LEFT, right = PID_CONFIG_SPEED_RIGHT;
+
+#if PL_CONFIG_HAS_QUADRATURE
+  if (mode==DRV_MODE_POS) {
+    left = PID_CONFIG_POS_LEFT;
+    right = PID_CONFIG_POS_RIGHT;
+  }
+#else
+  (void)mode;
+#endif
+  if (PID_GetPIDConfig(left, &cfg)==ERR_OK) {
+    frame->pidErr[0] = TELE_Sat16(cfg->lastError);
+    frame->pidInt[0] = cfg->integral;
+    frame->pidD[0] = TELE_Sat16(cfg->dFiltered);
+  }
+  if (PID_GetPIDConfig(right, &cfg)==ERR_OK) {
+    frame->pidErr[1] = TELE_Sat16(cfg->lastError);
+    frame->pidInt[1] = cfg->integral;
+    frame->pidD[1] = TELE_Sat16(cfg->dFiltered);
+  }
+}
+#endif
+
+void TELE_Sample(void) {
+  TELE_Frame *frame;
+  uint32_t start;
+  DRV_Mode mode;
+#if PL_CONFIG_HAS_REFLECTANCE
+  REF_Snapshot ref;
+  int i;
+#endif
+
+  if (!TELE_isOn) {
+    return;
+  }
+  start = McuArmTools_GetCycleCounter();
+  frame = TELE_Reserve();
+  if (frame==NULL) { /* host is not reading fast enough */
+    TELE_nofDropped++;
+    TELE_seq++; /* the host sees the gap */
+    return;
+  }
+  memset(frame, 0, sizeof(TELE_Frame));
+  frame->sync = TELE_FRAME_SYNC;
+  frame->version = TELE_FRAME_VERSION;
+  frame->seq = TELE_seq;
+  frame->timestamp = start;
+#if PL_CONFIG_HAS_REFLECTANCE
+  if (REF_GetSnapshot(&ref, NULL)) {
+    for(i=0; i<REF_NOF_SENSORS && i<(int)(sizeof(frame->ref)/sizeof(frame->ref[0])); i++) {
+      frame->ref[i] = ref.raw[i];
+    }
+    frame->whiteBits = (uint8_t)ref.whiteBits;
+  }
+#endif
+#if PL_CONFIG_HAS_LINE
+  frame->linePos = LINE_GetLinePos();
+#endif
+#if PL_CONFIG_HAS_SUMO
+  frame->sumo = SUMO_GetStateInfo();
+#endif
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  frame->speed[0] = TELE_Sat16(TACHO_GetSpeed(TRUE));
+  frame->speed[1] = TELE_Sat16(TACHO_GetSpeed(FALSE));
+#endif
+  mode = DRV_GetMode();
+  frame->driveMode = (uint8_t)mode;
+#if PL_CONFIG_HAS_PID
+  TELE_SamplePID(frame, mode);
+#endif
+  frame->pwm[0] = MOT_GetVal(MOT_GetMotorHandle(MOT_MOTOR_LEFT));
+  frame->pwm[1] = MOT_GetVal(MOT_GetMotorHandle(MOT_MOTOR_RIGHT));
+  if (MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT))==MOT_DIR_BACKWARD) {
+    frame->flags |= TELE_FLAGS_DIR_LEFT_BW;
+  }
+  if (MOT_GetDirection(MOT_GetMotorHandle(MOT_MOTOR_RIGHT))==MOT_DIR_BACKWARD) {
+    frame->flags |= TELE_FLAGS_DIR_RIGHT_BW;
+  }
+  frame->cycles = (uint16_t)(TELE_cycles>0xFFFF?0xFFFF:TELE_cycles);
+  TELE_Commit();
+  TELE_seq++;
+  TELE_nofFrames++;
+  TELE_cycles = McuArmTools_GetCycleCounter()-start;
+  if (TELE_cycles>TELE_cyclesMax) {
+    TELE_cyclesMax = TELE_cycles;
+  }
+}
+
+void TELE_Enable(bool on) {
+  TELE_isOn = on;
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void TELE_PrintStatus(const McuShell_StdIOType *io) {
+  uint8_t buf[32];
+
+  McuShell_SendStatusStr((unsigned char*)"tele", (unsigned char*)"\r\n", io->stdOut);
+  McuShell_SendStatusStr((unsigned char*)"  on", TELE_isOn?(unsigned char*)"yes\r\n":(unsigned char*)"no\r\n", io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), TELE_CONFIG_RTT_CHANNEL);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)", ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), TELE_FRAME_SIZE);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" bytes/frame\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  channel", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), TELE_nofFrames);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" sent, ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), TELE_nofDropped);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" dropped\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  frames", buf, io->stdOut);
+
+  McuUtility_Num32uToStr(buf, sizeof(buf), TELE_cycles);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" cycles (max ");
+  McuUtility_strcatNum32u(buf, sizeof(buf), TELE_cyclesMax);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)")\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  cost", buf, io->stdOut);
+}
+
+static void TELE_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"tele", (unsigned char*)"Group of telemetry commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows telemetry help or status\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  on|off", (unsigned char*)"Turns sending of frames on or off\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Resets the statistics\r\n", io->stdOut);
+}
+
+static uint8_t TELE_CmdOn(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  TELE_Enable(TRUE);
+  return ERR_OK;
+}
+
+static uint8_t TELE_CmdOff(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  TELE_Enable(FALSE);
+  return ERR_OK;
+}
+
+static uint8_t TELE_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  TELE_nofFrames = TELE_nofDropped = 0;
+  TELE_cyclesMax = 0;
+  return ERR_OK;
+}
+
+static const CMD_Command TELE_Cmds[] = {
+  {"on",    "", TELE_CmdOn},
+  {"off",   "", TELE_CmdOff},
+  {"reset", "", TELE_CmdReset},
+};
+
+const CMD_Group TELE_CmdGroup = CMD_GROUP("tele", TELE_PrintHelp, TELE_PrintStatus, TELE_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void TELE_Init(void) {
+  TELE_seq = 0;
+  TELE_nofFrames = TELE_nofDropped = 0;
+  TELE_cycles = TELE_cyclesMax = 0;
+  if (SEGGER_RTT_ConfigUpBuffer(TELE_CONFIG_RTT_CHANNEL, "Telemetry", TELE_buffer, sizeof(TELE_buffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP)<0) {
+    for(;;){} /* channel not available, check SEGGER_RTT_MAX_NUM_UP_BUFFERS */
+  }
+  TELE_isOn = TRUE; /* on by default, a frame costs nearly nothing if nobody is reading */
+}
+#endif /* PL_CONFIG_HAS_TELEMETRY */
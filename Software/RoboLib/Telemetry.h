@@ -0,0 +1,46 @@
+/**
+ * \file
+ * \brief Binary telemetry over RTT
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This module sends one binary frame (see TelemetryFrame.h) per Drive task cycle on its own RTT
+ * up-buffer. The frames are written in place into the RTT buffer, and dropped if the host does
+ * not read fast enough. Capture them e.g. with the J-Link RTT Logger on channel TELE_CONFIG_RTT_CHANNEL
+ * and convert them with the decoder in Tools/TelemetryDecoder.
+ */
+
+#ifndef SRC_TELEMETRY_H_
+#define SRC_TELEMETRY_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_TELEMETRY
+#include "TelemetryFrame.h"
+
+#define TELE_CONFIG_RTT_CHANNEL     (2)  /* RTT up-buffer, 0 is the terminal and 1 is SystemView */
+#define TELE_CONFIG_NOF_FRAMES      (16) /* number of frames in the RTT buffer */
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the telemetry, registered in Shell.c */
+extern const CMD_Group TELE_CmdGroup;
+#endif
+
+/*!
+ * \brief Samples the robot state and sends a frame. Called by the Drive task at the end of each cycle.
+ */
+void TELE_Sample(void);
+
+/*!
+ * \brief Turns the telemetry on or off.
+ * \param on TRUE to send frames
+ */
+void TELE_Enable(bool on);
+
+/*!
+ * \brief Module initialization, call after the RTT initialization.
+ */
+void TELE_Init(void);
+
+#endif /* PL_CONFIG_HAS_TELEMETRY */
+
+#endif /* SRC_TELEMETRY_H_ */
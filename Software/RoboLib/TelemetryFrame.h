@@ -0,0 +1,44 @@
+/**
+ * \file
+ * \brief Telemetry frame layout
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Layout of the binary telemetry frame sent over RTT. The header only depends on stdint.h, so
+ * it is shared by the firmware and the host decoder. All values are little endian, the struct
+ * has no padding. Change TELE_FRAME_VERSION with any change of the layout.
+ */
+
+#ifndef SRC_TELEMETRYFRAME_H_
+#define SRC_TELEMETRYFRAME_H_
+
+#include <stdint.h>
+
+#define TELE_FRAME_SYNC       0xA5 /* first byte of each frame */
+#define TELE_FRAME_VERSION    1    /* second byte of each frame */
+#define TELE_FRAME_SIZE       48   /* size of a frame in bytes */
+
+#define TELE_FLAGS_DIR_LEFT_BW    (1<<0) /* left motor is driving backward */
+#define TELE_FLAGS_DIR_RIGHT_BW   (1<<1) /* right motor is driving backward */
+
+typedef struct {
+  uint8_t sync;         /* TELE_FRAME_SYNC */
+  uint8_t version;      /* TELE_FRAME_VERSION */
+  uint16_t seq;         /* frame number, a gap means frames have been dropped */
+  uint32_t timestamp;   /* cycle counter at the start of the sample */
+  uint16_t ref[4];      /* raw reflectance sensor values, left to right */
+  uint16_t linePos;     /* line position, 0 if not available */
+  uint8_t whiteBits;    /* reflectance sensors seeing white, bit 0 is the left sensor */
+  uint8_t sumo;         /* sumo state in the upper, behavior in the lower nibble */
+  int16_t speed[2];     /* tacho speed left and right, steps/s */
+  int16_t pidErr[2];    /* last error of the speed or position PID, left and right */
+  int32_t pidInt[2];    /* integral of the PID, left and right */
+  int16_t pidD[2];      /* filtered derivative of the PID, left and right */
+  uint16_t pwm[2];      /* motor PWM register value left and right (low active) */
+  uint8_t flags;        /* TELE_FLAGS_xxx */
+  uint8_t driveMode;    /* DRV_Mode of the Drive task */
+  uint16_t cycles;      /* CPU cycles used for the previous frame */
+} TELE_Frame;
+
+typedef char TELE_FrameSizeCheck[(sizeof(TELE_Frame)==TELE_FRAME_SIZE)?1:-1]; /* compile time check of the layout */
+
+#endif /* SRC_TELEMETRYFRAME_H_ */
@@ -0,0 +1,197 @@
+/**
+ * \file
+ * \brief Opponent tracker
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Alpha-beta filter on the bearing of the opponent. The state is kept in a frame fixed to the ground
+ * (bearing relative to the proximity sensors plus the heading of the robot), so turning the robot
+ * does not look like a moving opponent. Angles are in centi-degrees, rates in centi-degrees/sec.
+ */
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_TRACKER
+#include "Tracker.h"
+#include "FreeRTOS.h"
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#else
+  #include "Quadrature.h"
+  #include "Turn.h"
+#endif
+#include "SensorBus.h"
+#include "McuArmTools.h"
+#include "McuUtility.h"
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+#endif
+
+#define TRACK_ALPHA_256         128   /* bearing correction gain (0.5) */
+#define TRACK_BETA_256          32    /* rate correction gain (0.125) */
+#define TRACK_RATE_MAX          36000 /* limit for the bearing rate */
+#define TRACK_GATE              6000  /* measurement further away from the prediction: treated as a new target */
+#define TRACK_MAX_GAP_US        200000 /* no update for this time: the track is lost */
+#define TRACK_CONFIDENCE_MIN    50    /* minimum confidence for a valid estimate */
+#define TRACK_HISTORY_BITS      8     /* number of scans used for the confidence */
+
+typedef struct {
+  int32_t bearing;     /* bearing of the opponent in the ground frame */
+  int32_t rate;        /* bearing rate */
+  uint8_t history;     /* one bit per scan, bit 0 is the latest: set if the opponent has been seen */
+  bool hasTrack;       /* if bearing and rate are initialized */
+  uint32_t timestamp;  /* cycle counter of the last update */
+} TRACK_State;
+
+static TRACK_State TRACK_state; /* only used by the proximity task */
+static SBUS_Channel TRACK_channel; /* state published for the consumers */
+static TRACK_State TRACK_channelBuf[2];
+static uint32_t TRACK_nofUpdates, TRACK_nofRestarts; /* statistics */
+static volatile bool TRACK_resetRequest = FALSE; /* set by TRACK_Reset(), handled by the proximity task */
+
+/*! \brief Returns the heading of the robot, positive is clockwise like the proximity bearing. */
+static int32_t TRACK_GetHeading(void) {
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_Pose pose;
+
+  ODO_GetPose(&pose);
+  return -pose.heading; /* odometry is counter-clockwise */
+#else
+  int32_t diff;
+
+  diff = (int32_t)(QUAD_GetLeftPos()-QUAD_GetRightPos());
+  return (int32_t)(((int64_t)diff*9000)/(2*TURN_GetSteps90()));
+#endif
+}
+
+/*! \brief Normalizes an angle into -180..180 degrees. */
+static int32_t TRACK_Normalize(int32_t angle) {
+  while (angle>18000) {
+    angle -= 36000;
+  }
+  while (angle<-18000) {
+    angle += 36000;
+  }
+  return angle;
+}
+
+static uint8_t TRACK_Confidence(uint8_t history) {
+  int nof = 0;
+
+  while (history!=0) {
+    nof += history&1;
+    history >>= 1;
+  }
+  return (uint8_t)((nof*100)/TRACK_HISTORY_BITS);
+}
+
+void TRACK_OnProximity(const PROX_Result *result) {
+  int32_t measured, residual, dtUs;
+
+  if (TRACK_resetRequest) {
+    TRACK_resetRequest = FALSE;
+    TRACK_state.hasTrack = FALSE;
+    TRACK_state.history = 0;
+  }
+  TRACK_state.history <<= 1;
+  dtUs = (int32_t)((result->timestamp-TRACK_state.timestamp)/(configCPU_CLOCK_HZ/1000000));
+  if (TRACK_state.hasTrack) {
+    if (dtUs>TRACK_MAX_GAP_US || dtUs<=0) {
+      TRACK_state.hasTrack = FALSE; /* too old */
+      TRACK_state.history = 0; /* the scans before the gap do not confirm a new target */
+    } else { /* predict */
+      TRACK_state.bearing += (int32_t)(((int64_t)TRACK_state.rate*dtUs)/1000000);
+    }
+  }
+  if (result->proximityFound) {
+    TRACK_state.history |= 1;
+    measured = result->rawAngle*100+TRACK_GetHeading();
+    residual = TRACK_Normalize(measured-TRACK_state.bearing);
+    if (!TRACK_state.hasTrack || residual>TRACK_GATE || residual<-TRACK_GATE) { /* new target */
+      TRACK_state.bearing = measured;
+      TRACK_state.rate = 0;
+      TRACK_state.hasTrack = TRUE;
+      TRACK_nofRestarts++;
+    } else { /* correct */
+      TRACK_state.bearing += (residual*TRACK_ALPHA_256)/256;
+      TRACK_state.rate += (int32_t)(((int64_t)residual*TRACK_BETA_256*1000000)/(256*(int64_t)dtUs));
+      if (TRACK_state.rate>TRACK_RATE_MAX) {
+        TRACK_state.rate = TRACK_RATE_MAX;
+      } else if (TRACK_state.rate<-TRACK_RATE_MAX) {
+        TRACK_state.rate = -TRACK_RATE_MAX;
+      }
+    }
+  }
+  if (TRACK_state.history==0) {
+    TRACK_state.hasTrack = FALSE; /* not seen in the recent scans */
+  }
+  TRACK_state.bearing = TRACK_Normalize(TRACK_state.bearing); /* the heading wraps around */
+  TRACK_state.timestamp = result->timestamp;
+  TRACK_nofUpdates++;
+  SBUS_Publish(&TRACK_channel, &TRACK_state);
+}
+
+bool TRACK_GetEstimate(TRACK_Estimate *estimate) {
+  TRACK_State state;
+  int32_t bearing, dtUs;
+
+  (void)SBUS_Read(&TRACK_channel, &state, NULL);
+  estimate->confidence = TRACK_Confidence(state.history);
+  estimate->timestamp = state.timestamp;
+  estimate->valid = state.hasTrack && estimate->confidence>=TRACK_CONFIDENCE_MIN;
+  if (!state.hasTrack) {
+    estimate->bearing = 0;
+    estimate->rate = 0;
+    return FALSE;
+  }
+  dtUs = (int32_t)((McuArmTools_GetCycleCounter()-state.timestamp)/(configCPU_CLOCK_HZ/1000000));
+  if (dtUs>TRACK_MAX_GAP_US) {
+    dtUs = TRACK_MAX_GAP_US;
+  }
+  bearing = state.bearing+(int32_t)(((int64_t)state.rate*dtUs)/1000000); /* predict to now */
+  bearing = TRACK_Normalize(bearing-TRACK_GetHeading()); /* relative to the robot */
+  estimate->bearing = (int16_t)(bearing/100);
+  estimate->rate = (int16_t)(state.rate/100);
+  return estimate->valid;
+}
+
+void TRACK_Reset(void) {
+  TRACK_resetRequest = TRUE; /* the state is owned by the proximity task, it drops the track with the next scan */
+}
+
+#if PL_CONFIG_HAS_SHELL
+static void TRACK_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((const unsigned char*)"track", (const unsigned char*)"Opponent tracker command group\r\n", io->stdOut);
+  McuShell_SendHelpStr((const unsigned char*)"  help|status", (const unsigned char*)"Print help or status information\r\n", io->stdOut);
+}
+
+static void TRACK_PrintStatus(const McuShell_StdIOType *io) {
+  TRACK_Estimate estimate;
+
+  (void)TRACK_GetEstimate(&estimate);
+  McuShell_SendStr((const unsigned char*)"track:\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  valid", estimate.valid?(const unsigned char*)"yes\r\n":(const unsigned char*)"no\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  bearing", (const unsigned char*)"", io->stdOut);
+  McuShell_SendNum16s(estimate.bearing, io->stdOut);
+  McuShell_SendStr((const unsigned char*)" deg, rate ", io->stdOut);
+  McuShell_SendNum16s(estimate.rate, io->stdOut);
+  McuShell_SendStr((const unsigned char*)" deg/s\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  confidence", (const unsigned char*)"", io->stdOut);
+  McuShell_SendNum8u(estimate.confidence, io->stdOut);
+  McuShell_SendStr((const unsigned char*)"%\r\n", io->stdOut);
+  McuShell_SendStatusStr((const unsigned char*)"  updates", (const unsigned char*)"", io->stdOut);
+  McuShell_SendNum32u(TRACK_nofUpdates, io->stdOut);
+  McuShell_SendStr((const unsigned char*)", new targets ", io->stdOut);
+  McuShell_SendNum32u(TRACK_nofRestarts, io->stdOut);
+  McuShell_SendStr((const unsigned char*)"\r\n", io->stdOut);
+}
+
+const CMD_Group TRACK_CmdGroup = { "track", TRACK_PrintHelp, TRACK_PrintStatus, NULL, 0, NULL }; /* help and status only */
+#endif /* PL_CONFIG_HAS_SHELL */
+
+void TRACK_Init(void) {
+  TRACK_state.hasTrack = FALSE;
+  TRACK_state.history = 0;
+  TRACK_nofUpdates = TRACK_nofRestarts = 0;
+  TRACK_resetRequest = FALSE;
+  SBUS_InitChannel(&TRACK_channel, &TRACK_channelBuf[0], &TRACK_channelBuf[1], sizeof(TRACK_State));
+}
+#endif /* PL_CONFIG_HAS_TRACKER */
@@ -0,0 +1,57 @@
+/**
+ * \file
+ * \brief Opponent tracker
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This module tracks the bearing of the opponent over the proximity scans. The proximity bearing is
+ * combined with the heading of the robot, so the own turns do not disturb the track. An alpha-beta
+ * filter estimates bearing and bearing rate, and predicts the bearing for the time it is used.
+ */
+
+#ifndef SRC_TRACKER_H_
+#define SRC_TRACKER_H_
+
+#include "Platform.h"
+#if PL_CONFIG_HAS_TRACKER
+#include "Proximity.h"
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the opponent tracker, registered in Shell.c */
+extern const CMD_Group TRACK_CmdGroup;
+#endif
+
+typedef struct {
+  bool valid;          /*!< if the confidence is high enough to use the estimate */
+  int16_t bearing;     /*!< predicted bearing of the opponent relative to the robot in degrees, negative is left */
+  int16_t rate;        /*!< change of the bearing in degrees/sec, independent of the own turns */
+  uint8_t confidence;  /*!< confidence in percent, based on the recent scans which have seen the opponent */
+  uint32_t timestamp;  /*!< cycle counter of the proximity scan used for the last update */
+} TRACK_Estimate;
+
+/*!
+ * \brief Returns the estimate of the opponent, predicted to the current time.
+ * \param estimate Where to store the estimate
+ * \return TRUE if the estimate is valid
+ */
+bool TRACK_GetEstimate(TRACK_Estimate *estimate);
+
+/*!
+ * \brief Updates the track with a proximity scan, called by the proximity task.
+ * \param result Result of the scan
+ */
+void TRACK_OnProximity(const PROX_Result *result);
+
+/*!
+ * \brief Drops the track, e.g. at the start of a bout.
+ */
+void TRACK_Reset(void);
+
+/*!
+ * \brief Module initialization.
+ */
+void TRACK_Init(void);
+
+#endif /* PL_CONFIG_HAS_TRACKER */
+
+#endif /* SRC_TRACKER_H_ */
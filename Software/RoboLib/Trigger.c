@@ -4,79 +4,220 @@
  * \author Erich Styger, erich.styger@hslu.ch
  *
  * This module implements a trigger module.
- * Triggers are special events which are triggered in a given time in the future
+ * Triggers are special events which are triggered in a given time in the future.
+ * The armed triggers are in a singly linked list sorted by expiry, and the ticks of an entry are
+ * relative to the previous entry. TRG_AddTick() only decrements the first entry with ticks left,
+ * and fires the entries at the head of the list which have zero ticks. Arming and cancelling walk
+ * the list, which is short, inside a critical section at the kernel level: the quadrature
+ * interrupt is not blocked.
  */
 #include "Platform.h"
 #if PL_CONFIG_HAS_TRIGGER
 #include "Trigger.h"
-#include "McuCriticalSection.h"
+#include "CritSec.h"
+#include "Span.h"
 #include <stddef.h> /* for NULL */
+#if PL_CONFIG_HAS_SHELL
+  #include "McuShell.h"
+  #include "McuUtility.h"
+#endif
+
+#define TRG_NONE  ((uint8_t)TRG_NOF_TRIGGERS) /*!< end of the list */
 
 /*! \brief Descriptor for a trigger. */
 typedef struct TRG_TriggerDesc {
-  TRG_TriggerTime ticks;    /*!< tick count until trigger */
+  TRG_TriggerTime ticks;    /*!< tick count until trigger, relative to the previous trigger in the list */
+  TRG_TriggerTime period;   /*!< ticks to re-arm after the trigger, 0 for a single shot */
+  uint8_t next;             /*!< next trigger in the list, or TRG_NONE */
+  bool armed;               /*!< if the trigger is in the list */
   TRG_Callback callback;    /*!< callback function */
   TRG_CallBackDataPtr data; /*!< additional data pointer for callback */
 } TRG_TriggerDesc;
 
 static TRG_TriggerDesc TRG_Triggers[TRG_NOF_TRIGGERS];  /*!< Array of triggers */
+static uint8_t TRG_head = TRG_NONE; /*!< first armed trigger */
+static uint32_t TRG_nofFired; /*!< number of callbacks, for the statistics */
 
-uint8_t TRG_SetTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data) {
-  McuCriticalSection_CriticalVariable()
-  
-  McuCriticalSection_EnterCritical();
-  TRG_Triggers[trigger].ticks = ticks;
+/*!
+ * \brief Removes a trigger from the list, call inside a critical section.
+ * \param trigger Trigger to be removed
+ */
+static void Unlink(TRG_TriggerKind trigger) {
+  uint8_t *p = &TRG_head;
+  TRG_TriggerDesc *desc = &TRG_Triggers[trigger];
+
+  if (!desc->armed) {
+    return;
+  }
+  while (*p!=(uint8_t)trigger) {
+    if (*p>=TRG_NONE) { /* end of the list: not linked, do not write through the end */
+      desc->armed = FALSE;
+      return;
+    }
+    p = &TRG_Triggers[*p].next;
+  }
+  *p = desc->next;
+  if (desc->next!=TRG_NONE) {
+    TRG_Triggers[desc->next].ticks += desc->ticks; /* the following trigger keeps its expiry */
+  }
+  desc->armed = FALSE;
+}
+
+/*!
+ * \brief Inserts a trigger into the list, after the triggers with the same expiry. Call inside a critical section.
+ * \param trigger Trigger to be inserted, must not be in the list
+ * \param ticks Ticks from now
+ */
+static void Insert(TRG_TriggerKind trigger, TRG_TriggerTime ticks) {
+  uint8_t *p = &TRG_head;
+  TRG_TriggerDesc *desc = &TRG_Triggers[trigger];
+
+  while (*p!=TRG_NONE && TRG_Triggers[*p].ticks<=ticks) {
+    ticks -= TRG_Triggers[*p].ticks;
+    p = &TRG_Triggers[*p].next;
+  }
+  desc->ticks = ticks;
+  desc->next = *p;
+  if (*p!=TRG_NONE) {
+    TRG_Triggers[*p].ticks -= ticks;
+  }
+  *p = (uint8_t)trigger;
+  desc->armed = TRUE;
+}
+
+uint8_t TRG_SetPeriodicTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_TriggerTime period, TRG_Callback callback, TRG_CallBackDataPtr data) {
+  CRIT_CriticalVariable()
+
+  if (trigger>=TRG_NOF_TRIGGERS) {
+    return ERR_RANGE;
+  }
+  CRIT_EnterCritical(CRIT_LEVEL_KERNEL);
+  Unlink(trigger);
+  TRG_Triggers[trigger].period = period;
   TRG_Triggers[trigger].callback = callback;
   TRG_Triggers[trigger].data = data;
-  McuCriticalSection_ExitCritical();
+  if (callback!=NULL) {
+    Insert(trigger, ticks);
+  }
+  CRIT_ExitCritical();
   return ERR_OK;
 }
 
+uint8_t TRG_SetTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data) {
+  return TRG_SetPeriodicTrigger(trigger, ticks, 0, callback, data);
+}
+
+void TRG_CancelTrigger(TRG_TriggerKind trigger) {
+  CRIT_CriticalVariable()
+
+  if (trigger>=TRG_NOF_TRIGGERS) {
+    return;
+  }
+  CRIT_EnterCritical(CRIT_LEVEL_KERNEL);
+  Unlink(trigger);
+  CRIT_ExitCritical();
+}
+
 /*!
- * \brief Goes through the list of triggers and returns TRUE in case we have to call a callback.
- * \return Returns TRUE if we have called a callback.
+ * \brief Removes the first trigger from the list if it is due, and re-arms it if it is periodic.
+ * \param callback Where to store the callback
+ * \param data Where to store the callback data
+ * \return Returns TRUE if a callback has to be called.
  */
-static bool CheckCallbacks(void) {
-  TRG_TriggerKind i;
+static bool NextCallback(TRG_Callback *callback, TRG_CallBackDataPtr *data) {
+  TRG_TriggerDesc *desc;
+  CRIT_CriticalVariable()
+
+  CRIT_EnterCritical(CRIT_LEVEL_KERNEL);
+  if (TRG_head==TRG_NONE || TRG_Triggers[TRG_head].ticks!=0) {
+    CRIT_ExitCritical();
+    return FALSE;
+  }
+  desc = &TRG_Triggers[TRG_head];
+  TRG_head = desc->next;
+  desc->armed = FALSE;
+  *callback = desc->callback; /* get a copy, as the callback might setup this trigger again */
+  *data = desc->data;
+  if (desc->period!=0) {
+    Insert((TRG_TriggerKind)(desc-TRG_Triggers), desc->period);
+  }
+  CRIT_ExitCritical();
+  return TRUE;
+}
+
+void TRG_AddTick(void) {
+  uint8_t i;
   TRG_Callback callback;
   TRG_CallBackDataPtr data;
-  bool calledCallBack = FALSE;
-  McuCriticalSection_CriticalVariable()
+  CRIT_CriticalVariable()
 
-  for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
-    McuCriticalSection_EnterCritical();
-    if (TRG_Triggers[i].ticks==0 && TRG_Triggers[i].callback != NULL) { /* trigger! */
-      callback = TRG_Triggers[i].callback; /* get a copy */
-      data = TRG_Triggers[i].data; /* get backup of data, as we overwrite it below */
-      /* reset trigger structure, as callback might setup this trigger again */
-      TRG_Triggers[i].callback = NULL; /* NULL callback prevents that we are called again */
-      McuCriticalSection_ExitCritical();
-      callback(data);
-      calledCallBack = TRUE; /* callback may have set a trigger at the current time: rescan trigger list */
-    } else {
-      McuCriticalSection_ExitCritical();
-    }
-  } /* for */
-  return calledCallBack;
+  SPAN_BEGIN(SPAN_ID_TRG_TICK);
+  CRIT_EnterCritical(CRIT_LEVEL_KERNEL);
+  i = TRG_head;
+  while (i!=TRG_NONE && TRG_Triggers[i].ticks==0) { /* skip triggers set with zero ticks, they fire now */
+    i = TRG_Triggers[i].next;
+  }
+  if (i!=TRG_NONE) {
+    TRG_Triggers[i].ticks--; /* all following triggers are relative to this one */
+  }
+  CRIT_ExitCritical();
+  while (NextCallback(&callback, &data)) { /* callbacks may set a trigger at the current time */
+    TRG_nofFired++;
+    callback(data);
+  }
+  SPAN_END(SPAN_ID_TRG_TICK);
 }
 
-void TRG_AddTick(void) {
-  TRG_TriggerKind i;
-  uint8_t res;
-  McuCriticalSection_CriticalVariable()
+#if PL_CONFIG_HAS_SHELL
+static void TRG_PrintHelp(const McuShell_StdIOType *io) {
+  McuShell_SendHelpStr((unsigned char*)"trg", (unsigned char*)"Group of trigger commands\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  help|status", (unsigned char*)"Shows trigger help or the armed triggers\r\n", io->stdOut);
+  McuShell_SendHelpStr((unsigned char*)"  reset", (unsigned char*)"Clears the number of callbacks\r\n", io->stdOut);
+}
 
-  McuCriticalSection_EnterCritical();
-  for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
-    if (TRG_Triggers[i].ticks!=0) { /* prevent underflow */
-      TRG_Triggers[i].ticks--;
+static void TRG_PrintStatus(const McuShell_StdIOType *io) {
+  uint8_t buf[48];
+  uint8_t i, nofArmed = 0;
+  uint32_t ticks = 0;
+  CRIT_CriticalVariable()
+
+  McuShell_SendStatusStr((unsigned char*)"trg", (unsigned char*)"\r\n", io->stdOut);
+  buf[0] = '\0';
+  CRIT_EnterCritical(CRIT_LEVEL_KERNEL);
+  for(i=TRG_head; i!=TRG_NONE; i=TRG_Triggers[i].next) {
+    ticks += TRG_Triggers[i].ticks;
+    if (nofArmed<4) { /* the first ones with their ticks until the callback */
+      McuUtility_strcatNum8u(buf, sizeof(buf), i);
+      McuUtility_chcat(buf, sizeof(buf), ':');
+      McuUtility_strcatNum32u(buf, sizeof(buf), ticks);
+      McuUtility_chcat(buf, sizeof(buf), ' ');
     }
-  } /* for */
-  McuCriticalSection_ExitCritical();
-  do {
-    res = CheckCallbacks(); /* while there are callbacks, re-iterate */
-  } while(res);
+    nofArmed++;
+  }
+  CRIT_ExitCritical();
+  if (nofArmed==0) {
+    McuUtility_strcpy(buf, sizeof(buf), (unsigned char*)"none");
+  }
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)"\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  armed", buf, io->stdOut);
+  McuUtility_Num32uToStr(buf, sizeof(buf), TRG_nofFired);
+  McuUtility_strcat(buf, sizeof(buf), (unsigned char*)" callbacks\r\n");
+  McuShell_SendStatusStr((unsigned char*)"  fired", buf, io->stdOut);
+}
+
+static uint8_t TRG_CmdReset(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  TRG_nofFired = 0;
+  return ERR_OK;
 }
 
+static const CMD_Command TRG_Cmds[] = {
+  {"reset", "", TRG_CmdReset},
+};
+
+const CMD_Group TRG_CmdGroup = CMD_GROUP("trg", TRG_PrintHelp, TRG_PrintStatus, TRG_Cmds);
+#endif /* PL_CONFIG_HAS_SHELL */
+
 void TRG_Deinit(void) {
   /* nothing to do */
 }
@@ -86,9 +227,14 @@ void TRG_Init(void) {
 
   for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
     TRG_Triggers[i].ticks = 0;
+    TRG_Triggers[i].period = 0;
+    TRG_Triggers[i].next = TRG_NONE;
+    TRG_Triggers[i].armed = FALSE;
     TRG_Triggers[i].callback = NULL;
     TRG_Triggers[i].data = NULL;
   }
+  TRG_head = TRG_NONE;
+  TRG_nofFired = 0;
 }
 
 #endif /* PL_CONFIG_HAS_TRIGGER */
@@ -5,6 +5,8 @@
  *
  * This module implements Trigger module.
  * Triggers are used to callback functions or hooks with a given relative time delay.
+ * The armed triggers are kept in a list sorted by expiry, each with the ticks relative to the
+ * previous one (delta list), so a tick only decrements the first entry of the list.
  */
 
 #ifndef TRIGGER_H_
@@ -20,6 +22,10 @@
 typedef enum {
   /*! \todo Extend the list of triggers as needed */
   TRG_KEYPRESS, /*!< key debounce */
+#ifdef TRG_CONFIG_NOF_APP_TRIGGERS
+  TRG_APP_FIRST, /*!< first of TRG_CONFIG_NOF_APP_TRIGGERS triggers of the application, e.g. for a host test */
+  TRG_APP_LAST = TRG_APP_FIRST+TRG_CONFIG_NOF_APP_TRIGGERS-1,
+#endif
   TRG_NOF_TRIGGERS /*!< Must be last! */
 } TRG_TriggerKind;
 
@@ -42,9 +48,32 @@ typedef uint16_t TRG_TriggerTime;
  */
 uint8_t TRG_SetTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data);
 
+/*!
+ * \brief Adds a new periodic trigger. Can be called from an interrupt or from a trigger callback.
+ * \param trigger Trigger to be added, an armed trigger is replaced
+ * \param ticks Ticks until the first callback. The time is relative from the current time.
+ * \param period Ticks between the following callbacks, 0 for a single callback
+ * \param callback Callback to be called when the trigger fires, NULL cancels the trigger
+ * \param data Optional pointer to data
+ * \return error code, ERR_OK if everything is fine
+ */
+uint8_t TRG_SetPeriodicTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_TriggerTime period, TRG_Callback callback, TRG_CallBackDataPtr data);
+
+/*!
+ * \brief Cancels a trigger. Nothing happens if the trigger is not armed.
+ * \param trigger Trigger to be cancelled
+ */
+void TRG_CancelTrigger(TRG_TriggerKind trigger);
+
 /*! \brief Called from interrupt service routine with a period of TRG_TICKS_MS. */
 void TRG_AddTick(void);
 
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the triggers, registered in Shell.c */
+extern const CMD_Group TRG_CmdGroup;
+#endif
+
 /*!\brief De-initializes the module. */
 void TRG_Deinit(void);
 
@@ -24,6 +24,20 @@
 #if PL_CONFIG_HAS_DRIVE
   #include "Drive.h"
 #endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
+#if PL_CONFIG_HAS_CONFIG_NVM
+  #include "NVM_Config.h"
+#endif
+#define TURN_USE_MOVE_PROFILE  (PL_CONFIG_HAS_QUADRATURE && PL_CONFIG_HAS_DRIVE && PL_CONFIG_HAS_POS_PID)
+  /*!< turns are done with the speed profiles of the Drive task */
+#if TURN_USE_MOVE_PROFILE
+  #include "FreeRTOS.h"
+  #include "semphr.h"
+
+  #define TURN_CANCEL_WAIT_MS  20 /* time for the Drive task to acknowledge a cancel */
+#endif
 
 #if PL_CONFIG_HAS_QUADRATURE
   #if PL_CONFIG_IS_DAC_ROBOT
@@ -175,6 +189,35 @@ void TURN_SetStepsLine(int32_t stepsLine, int32_t stepsPostLine) {
   TURN_StepsPostLine = stepsPostLine;
 }
 
+#if PL_CONFIG_HAS_CONFIG_NVM && PL_CONFIG_HAS_QUADRATURE
+typedef struct {
+  int32_t steps90;
+  int32_t stepsLine;
+  int32_t stepsPostLine;
+} TURN_StoredSteps; /* steps stored in the flash */
+
+uint8_t TURN_SaveConfig(void) {
+  TURN_StoredSteps steps;
+
+  steps.steps90 = TURN_Steps90;
+  steps.stepsLine = TURN_StepsLine;
+  steps.stepsPostLine = TURN_StepsPostLine;
+  return NVMC_Save(NVMC_KEY_TURN, &steps, sizeof(steps));
+}
+
+static void TURN_LoadConfig(void) {
+  const TURN_StoredSteps *steps;
+  size_t size;
+
+  steps = NVMC_Get(NVMC_KEY_TURN, &size);
+  if (steps!=NULL && size==sizeof(TURN_StoredSteps)) {
+    TURN_Steps90 = steps->steps90;
+    TURN_StepsLine = steps->stepsLine;
+    TURN_StepsPostLine = steps->stepsPostLine;
+  }
+}
+#endif
+
 /*!
  * \brief Translate a turn kind into a string
  * \return Returns a descriptive string
@@ -212,6 +255,51 @@ uint8_t TURN_SetDutyPercent(uint8_t duty) {
 #endif
 
 #if PL_CONFIG_HAS_QUADRATURE
+#if TURN_USE_MOVE_PROFILE
+static SemaphoreHandle_t TURN_MoveDoneSem; /* given by the Drive task at the end of a move */
+
+static void TURN_OnMoveDone(DRV_MoveResult result) {
+  (void)result;
+  (void)xSemaphoreGive(TURN_MoveDoneSem);
+}
+
+void TURN_MoveToPos(int32_t targetLPos, int32_t targetRPos, bool wait, TURN_StopFct stopIt, int32_t timeoutMs) {
+  TickType_t endTicks, ticks;
+
+  if (!wait) {
+    (void)DRV_StartMove(targetLPos-(int32_t)QUAD_GetLeftPos(), targetRPos-(int32_t)QUAD_GetRightPos(), NULL);
+    return;
+  }
+  (void)xSemaphoreTake(TURN_MoveDoneSem, 0); /* clear a completion of an earlier move */
+  (void)DRV_StartMove(targetLPos-(int32_t)QUAD_GetLeftPos(), targetRPos-(int32_t)QUAD_GetRightPos(), TURN_OnMoveDone);
+  endTicks = xTaskGetTickCount()+pdMS_TO_TICKS(timeoutMs);
+  for(;;) { /* breaks */
+    ticks = endTicks-xTaskGetTickCount();
+    if ((int32_t)ticks<=0) {
+      break; /* timeout */
+    }
+    if (stopIt!=NULL && ticks>pdMS_TO_TICKS(1)) {
+      ticks = pdMS_TO_TICKS(1); /* check the stop condition every millisecond */
+    }
+    if (xSemaphoreTake(TURN_MoveDoneSem, ticks)==pdTRUE) {
+      return; /* move finished */
+    }
+    if (stopIt!=NULL && stopIt()) {
+      break;
+    }
+  } /* for */
+  (void)DRV_CancelMove(); /* stay where we are */
+  (void)xSemaphoreTake(TURN_MoveDoneSem, pdMS_TO_TICKS(TURN_CANCEL_WAIT_MS)); /* consume the completion of the cancelled move */
+  if ((int32_t)(endTicks-xTaskGetTickCount())<=0) {
+#if PL_CONFIG_HAS_RECORDER
+    REC_Trigger(REC_TRIGGER_MOVE_TIMEOUT);
+#endif
+#if PL_CONFIG_HAS_SHELL
+    McuShell_SendStr((unsigned char*)"MoveToPos Timeout.\r\n", McuShell_GetStdio()->stdErr);
+#endif
+  }
+}
+#else
 void TURN_MoveToPos(int32_t targetLPos, int32_t targetRPos, bool wait, TURN_StopFct stopIt, int32_t timeoutMs) {
 #if PL_CONFIG_HAS_DRIVE
   (void)DRV_SetPos(targetLPos, targetRPos);
@@ -241,12 +329,16 @@ void TURN_MoveToPos(int32_t targetLPos, int32_t targetRPos, bool wait, TURN_Stop
       break;
     }
   } /* for */
-#if PL_CONFIG_HAS_SHELL
   if (timeoutMs<=0) {
+#if PL_CONFIG_HAS_RECORDER
+    REC_Trigger(REC_TRIGGER_MOVE_TIMEOUT);
+#endif
+#if PL_CONFIG_HAS_SHELL
     McuShell_SendStr((unsigned char*)"MoveToPos Timeout.\r\n", McuShell_GetStdio()->stdErr);
-  }
 #endif
+  }
 }
+#endif /* TURN_USE_MOVE_PROFILE */
 
 static void StepsTurn(int32_t stepsL, int32_t stepsR, TURN_StopFct stopIt, int32_t timeOutMS) {
   int32_t currLPos, currRPos, targetLPos, targetRPos;
@@ -280,6 +372,82 @@ static void StepsTurn(int32_t stepsL, int32_t stepsR, TURN_StopFct stopIt, int32
   targetRPos = currRPos+stepsR;
   TURN_MoveToPos(targetLPos, targetRPos, TRUE, stopIt, timeOutMS); /* go to final position */
 }
+
+/*!
+ * \brief Returns the wheel steps for a turn.
+ * \param kind Kind of turn
+ * \param stepsL Where to store the steps for the left wheel
+ * \param stepsR Where to store the steps for the right wheel
+ * \param timeoutMs Where to store the timeout for the turn
+ * \return TRUE if the turn is done with the position control, FALSE otherwise (e.g. stopping a motor)
+ */
+static bool TURN_GetSteps(TURN_Kind kind, int32_t *stepsL, int32_t *stepsR, int32_t *timeoutMs) {
+  switch(kind) {
+    case TURN_LEFT45:
+      *stepsL = -TURN_Steps90/2; *stepsR = TURN_Steps90/2; *timeoutMs = TURN_STEPS_90_TIMEOUT_MS/2;
+      return TRUE;
+    case TURN_RIGHT45:
+      *stepsL = TURN_Steps90/2; *stepsR = -TURN_Steps90/2; *timeoutMs = TURN_STEPS_90_TIMEOUT_MS/2;
+      return TRUE;
+    case TURN_LEFT90:
+      *stepsL = -TURN_Steps90; *stepsR = TURN_Steps90; *timeoutMs = TURN_STEPS_90_TIMEOUT_MS;
+      return TRUE;
+    case TURN_RIGHT90:
+      *stepsL = TURN_Steps90; *stepsR = -TURN_Steps90; *timeoutMs = TURN_STEPS_90_TIMEOUT_MS;
+      return TRUE;
+    case TURN_LEFT180:
+      *stepsL = -(2*TURN_Steps90); *stepsR = 2*TURN_Steps90; *timeoutMs = TURN_STEPS_90_TIMEOUT_MS*2;
+      return TRUE;
+    case TURN_RIGHT180:
+      *stepsL = 2*TURN_Steps90; *stepsR = -(2*TURN_Steps90); *timeoutMs = TURN_STEPS_90_TIMEOUT_MS*2;
+      return TRUE;
+    case TURN_STEP_BORDER_BW:
+      *stepsL = -(3*TURN_StepsLine); *stepsR = -(3*TURN_StepsLine); *timeoutMs = TURN_STEPS_LINE_TIMEOUT_MS;
+      return TRUE;
+    case TURN_STEP_LINE_FW:
+      *stepsL = TURN_StepsLine; *stepsR = TURN_StepsLine; *timeoutMs = TURN_STEPS_LINE_TIMEOUT_MS;
+      return TRUE;
+    case TURN_STEP_LINE_BW:
+      *stepsL = -TURN_StepsLine; *stepsR = -TURN_StepsLine; *timeoutMs = TURN_STEPS_LINE_TIMEOUT_MS;
+      return TRUE;
+    case TURN_STEP_POST_LINE_FW:
+      *stepsL = TURN_StepsPostLine; *stepsR = TURN_StepsPostLine; *timeoutMs = TURN_STEPS_POST_LINE_TIMEOUT_MS;
+      return TRUE;
+    case TURN_STEP_POST_LINE_BW:
+      *stepsL = -TURN_StepsPostLine; *stepsR = -TURN_StepsPostLine; *timeoutMs = TURN_STEPS_POST_LINE_TIMEOUT_MS;
+      return TRUE;
+    case TURN_STEP_LINE_FW_POST_LINE: /* combination of TURN_STEP_LINE_FW and TURN_STEP_POST_LINE_FW */
+      *stepsL = TURN_StepsLine+TURN_StepsPostLine; *stepsR = *stepsL; *timeoutMs = TURN_STEPS_LINE_TIMEOUT_MS+TURN_STEPS_POST_LINE_TIMEOUT_MS;
+      return TRUE;
+    case TURN_STEP_LINE_BW_POST_LINE: /* combination of TURN_STEP_LINE_BW and TURN_STEP_POST_LINE_BW */
+      *stepsL = -TURN_StepsLine-TURN_StepsPostLine; *stepsR = *stepsL; *timeoutMs = TURN_STEPS_LINE_TIMEOUT_MS+TURN_STEPS_POST_LINE_TIMEOUT_MS;
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+static void TURN_GetAngleSteps(int16_t angle, int32_t *stepsL, int32_t *stepsR, int32_t *timeoutMs) {
+  bool isLeft = angle<0;
+  int32_t steps;
+
+  if (isLeft) {
+    angle = -angle; /* make it positive */
+  }
+  angle %= 360; /* keep it inside 360 */
+  steps = (angle*TURN_Steps90)/90;
+  if (isLeft) {
+    *stepsL = -steps; *stepsR = steps;
+  } else {
+    *stepsL = steps; *stepsR = -steps;
+  }
+  *timeoutMs = ((angle/90)+1)*TURN_STEPS_90_TIMEOUT_MS;
+}
+
+int32_t TURN_GetSteps90(void) {
+  return TURN_Steps90;
+}
+
 #endif
 
 static void PostTurn(void) {
@@ -309,106 +477,96 @@ static void TimeTurn(bool isLeft, uint8_t duty, uint16_t val) {
 #endif
 
 void TURN_Turn(TURN_Kind kind, TURN_StopFct stopIt) {
+#if PL_CONFIG_HAS_QUADRATURE
+  int32_t stepsL, stepsR, timeoutMs;
+
+  if (TURN_GetSteps(kind, &stepsL, &stepsR, &timeoutMs)) {
+#if TURN_USE_MOVE_PROFILE
+    timeoutMs = DRV_GetMoveTimeMs(stepsL, stepsR)+TURN_CANCEL_WAIT_MS; /* the profile tells how long it takes */
+#endif
+    StepsTurn(stepsL, stepsR, stopIt, timeoutMs);
+    /*lint -save  -e522 Highest operation, function 'PostTurn', lacks side-effect. */
+    PostTurn(); /* perform post-turn action */
+    /*lint -restore Highest operation, function 'PostTurn', lacks side-effect. */
+    return;
+  }
+#endif
   switch(kind) {
     case TURN_LEFT45:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(-TURN_Steps90/2, TURN_Steps90/2, stopIt, TURN_STEPS_90_TIMEOUT_MS/2);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       TimeTurn(TRUE, TURN_DutyPercent, TURN_Time90ms/2);
 #endif
       break;
     case TURN_RIGHT45:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(TURN_Steps90/2, -TURN_Steps90/2, stopIt, TURN_STEPS_90_TIMEOUT_MS/2);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       TimeTurn(FALSE, TURN_DutyPercent, TURN_Time90ms/2);
 #endif
       break;
     case TURN_LEFT90:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(-TURN_Steps90, TURN_Steps90, stopIt, TURN_STEPS_90_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), -TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), TURN_DutyPercent);
       McuWait_WaitOSms(TURN_Time90ms); /* only use waiting time */
 #endif
       break;
     case TURN_RIGHT90:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(TURN_Steps90, -TURN_Steps90, stopIt, TURN_STEPS_90_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), -TURN_DutyPercent);
       McuWait_WaitOSms(TURN_Time90ms); /* only use waiting time */
 #endif
       break;
     case TURN_LEFT180:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(-(2*TURN_Steps90), 2*TURN_Steps90, stopIt, TURN_STEPS_90_TIMEOUT_MS*2);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), -TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), TURN_DutyPercent);
       McuWait_WaitOSms(2*TURN_Time90ms);
 #endif
      break;
     case TURN_RIGHT180:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(2*TURN_Steps90, -(2*TURN_Steps90), stopIt, TURN_STEPS_90_TIMEOUT_MS*2);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), -TURN_DutyPercent);
       McuWait_WaitOSms(2*TURN_Time90ms);
 #endif
      break;
     case TURN_STEP_BORDER_BW:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(-(3*TURN_StepsLine), -(3*TURN_StepsLine), stopIt, TURN_STEPS_LINE_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), -TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), -TURN_DutyPercent);
       McuWait_WaitOSms(3*TURN_StepLineMs);
 #endif
       break;
     case TURN_STEP_LINE_FW:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(TURN_StepsLine, TURN_StepsLine, stopIt, TURN_STEPS_LINE_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), TURN_DutyPercent);
       McuWait_WaitOSms(TURN_StepLineMs);
 #endif
       break;
     case TURN_STEP_LINE_BW:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(-TURN_StepsLine, -TURN_StepsLine, stopIt, TURN_STEPS_LINE_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), -TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), -TURN_DutyPercent);
       McuWait_WaitOSms(TURN_StepLineMs);
 #endif
       break;
     case TURN_STEP_POST_LINE_FW:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(TURN_StepsPostLine, TURN_StepsPostLine, stopIt, TURN_STEPS_POST_LINE_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), TURN_DutyPercent);
       McuWait_WaitOSms(TURN_StepPostLineMs);
 #endif
       break;
     case TURN_STEP_POST_LINE_BW:
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(-TURN_StepsPostLine, -TURN_StepsPostLine, stopIt, TURN_STEPS_POST_LINE_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), -TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), -TURN_DutyPercent);
       McuWait_WaitOSms(TURN_StepPostLineMs);
 #endif
       break;
     case TURN_STEP_LINE_FW_POST_LINE: /* combination of TURN_STEP_LINE_FW and TURN_STEP_POST_LINE_FW */
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(TURN_StepsLine+TURN_StepsPostLine, TURN_StepsLine+TURN_StepsPostLine, stopIt, TURN_STEPS_LINE_TIMEOUT_MS+TURN_STEPS_POST_LINE_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), TURN_DutyPercent);
       McuWait_WaitOSms(TURN_StepLineMs);
@@ -419,9 +577,7 @@ void TURN_Turn(TURN_Kind kind, TURN_StopFct stopIt) {
 #endif
       break;
     case TURN_STEP_LINE_BW_POST_LINE: /* combination of TURN_STEP_LINE_BW and TURN_STEP_POST_LINE_BW */
-#if PL_CONFIG_HAS_QUADRATURE
-      StepsTurn(-TURN_StepsLine-TURN_StepsPostLine, -TURN_StepsLine-TURN_StepsPostLine, stopIt, TURN_STEPS_LINE_TIMEOUT_MS+TURN_STEPS_POST_LINE_TIMEOUT_MS);
-#else
+#if !PL_CONFIG_HAS_QUADRATURE /* see TURN_GetSteps() */
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), -TURN_DutyPercent);
       MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), -TURN_DutyPercent);
       McuWait_WaitOSms(TURN_StepLineMs);
@@ -450,44 +606,67 @@ void TURN_Turn(TURN_Kind kind, TURN_StopFct stopIt) {
 }
 
 void TURN_TurnAngle(int16_t angle, TURN_StopFct stopIt) {
-  bool isLeft = angle<0;
 #if PL_CONFIG_HAS_QUADRATURE
-  int32_t steps;
+  int32_t stepsL, stepsR, timeoutMs;
+
+  TURN_GetAngleSteps(angle, &stepsL, &stepsR, &timeoutMs);
+#if TURN_USE_MOVE_PROFILE
+  timeoutMs = DRV_GetMoveTimeMs(stepsL, stepsR)+TURN_CANCEL_WAIT_MS;
+#endif
+  StepsTurn(stepsL, stepsR, stopIt, timeoutMs);
 #else
+  bool isLeft = angle<0;
   uint32_t time;
-#endif
-  
+
   if (isLeft) {
     angle = -angle; /* make it positive */
   }
   angle %= 360; /* keep it inside 360 */
-#if PL_CONFIG_HAS_QUADRATURE
-  steps = (angle*TURN_Steps90)/90;
-#else
   time = (angle*TURN_Time90ms)/90;
-#endif
   if (isLeft) {
-#if PL_CONFIG_HAS_QUADRATURE
-    StepsTurn(-steps, steps, stopIt, ((angle/90)+1)*TURN_STEPS_90_TIMEOUT_MS);
-#else
     MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), -TURN_DutyPercent);
     MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), TURN_DutyPercent);
     McuWait_WaitOSms(time);
-#endif
   } else { /* right */
-#if PL_CONFIG_HAS_QUADRATURE
-    StepsTurn(steps, -steps, stopIt, ((angle/90)+1)*TURN_STEPS_90_TIMEOUT_MS);
-#else
     MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), TURN_DutyPercent);
     MOT_SetSpeedPercent(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), -TURN_DutyPercent);
     McuWait_WaitOSms(time);
-#endif
   }
+#endif
   /*lint -save  -e522 Highest operation, function 'PostTurn', lacks side-effect. */
   PostTurn(); /* perform post-turn action */
   /*lint -restore Highest operation, function 'PostTurn', lacks side-effect. */
 }
 
+#if TURN_USE_MOVE_PROFILE
+int32_t TURN_StartTurn(TURN_Kind kind, DRV_MoveDoneFct done) {
+  int32_t stepsL, stepsR, timeoutMs;
+
+  if (TURN_GetSteps(kind, &stepsL, &stepsR, &timeoutMs)) {
+    (void)DRV_StartMove(stepsL, stepsR, done);
+    return DRV_GetMoveTimeMs(stepsL, stepsR)+TURN_CANCEL_WAIT_MS;
+  }
+  TURN_Turn(kind, NULL); /* stop commands: nothing to wait for */
+  return 0;
+}
+
+int32_t TURN_StartTurnAngle(int16_t angle, DRV_MoveDoneFct done) {
+  int32_t stepsL, stepsR, timeoutMs;
+
+  TURN_GetAngleSteps(angle, &stepsL, &stepsR, &timeoutMs);
+  (void)DRV_StartMove(stepsL, stepsR, done);
+  return DRV_GetMoveTimeMs(stepsL, stepsR)+TURN_CANCEL_WAIT_MS;
+}
+
+void TURN_CancelTurn(void) {
+  (void)DRV_CancelMove();
+}
+
+bool TURN_IsTurnDone(void) {
+  return DRV_HasTurned();
+}
+#endif
+
 #if PL_CONFIG_HAS_SHELL
 static void TURN_PrintHelp(const McuShell_StdIOType *io) {
   McuShell_SendHelpStr((unsigned char*)"turn", (unsigned char*)"Group of turning commands\r\n", io->stdOut);
@@ -500,6 +679,9 @@ static void TURN_PrintHelp(const McuShell_StdIOType *io) {
   McuShell_SendHelpStr((unsigned char*)"  steps90 <steps>", (unsigned char*)"Number of steps for a 90 degree turn\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  stepsline <steps>", (unsigned char*)"Number of steps for stepping over line\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  stepspostline <steps>", (unsigned char*)"Number of steps for a step post the line\r\n", io->stdOut);
+#if PL_CONFIG_HAS_CONFIG_NVM
+  McuShell_SendHelpStr((unsigned char*)"  save", (unsigned char*)"Stores the steps in flash, used with the next start\r\n", io->stdOut);
+#endif
 #else
   McuShell_SendHelpStr((unsigned char*)"  duty <percent>", (unsigned char*)"Turning motor PWM duty percent\r\n", io->stdOut);
   McuShell_SendHelpStr((unsigned char*)"  time90 <ms>", (unsigned char*)"Time in milli-seconds for 90 degree\r\n", io->stdOut);
@@ -555,122 +737,134 @@ static void TURN_PrintStatus(const McuShell_StdIOType *io) {
 #endif
 }
 
-static bool isNumberStart(uint8_t ch) {
-  if (ch=='-') { /* negative number start */
-    return TRUE;
-  } else if (ch>='0' && ch<='9') {
-    return TRUE;
+static uint8_t TURN_CmdAngle(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)io;
+  TURN_TurnAngle((int16_t)args[0].i, NULL);
+  TURN_Turn(TURN_STOP, NULL);
+  return ERR_OK;
+}
+
+static uint8_t TURN_CmdForwardPostLine(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  TURN_Turn(TURN_STEP_LINE_FW_POST_LINE, NULL);
+  TURN_Turn(TURN_STOP, NULL);
+  return ERR_OK;
+}
+
+static uint8_t TURN_CmdForward(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  TURN_Turn(TURN_STEP_LINE_FW, NULL);
+  TURN_Turn(TURN_STOP, NULL);
+  return ERR_OK;
+}
+
+static uint8_t TURN_CmdBackward(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args; (void)io;
+  TURN_Turn(TURN_STEP_LINE_BW, NULL);
+  TURN_Turn(TURN_STOP, NULL);
+  return ERR_OK;
+}
+
+/* checks the range of a 16bit argument */
+static bool TURN_Is16u(const CMD_Arg *arg, const McuShell_StdIOType *io) {
+  if (arg->u>0xffff) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return FALSE;
   }
-  return FALSE;
+  return TRUE;
 }
 
-uint8_t TURN_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
-  uint8_t res = ERR_OK;
-  const unsigned char *p;
-#if !PL_CONFIG_HAS_QUADRATURE
-  uint8_t val8u;
-#endif
-  uint16_t val16u;
-
-  if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_HELP)==0 || McuUtility_strcmp((char*)cmd, (char*)"turn help")==0) {
-    TURN_PrintHelp(io);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)McuShell_CMD_STATUS)==0 || McuUtility_strcmp((char*)cmd, (char*)"turn status")==0) {
-    TURN_PrintStatus(io);
-    *handled = TRUE;
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn ", sizeof("turn ")-1)==0 && isNumberStart(cmd[sizeof("turn ")-1])) {
-    int32_t angle;
-
-    p = cmd+sizeof("turn ")-1;
-    if (McuUtility_xatoi(&p, &angle)==ERR_OK) {
-      TURN_TurnAngle((int16_t)angle, NULL);
-      TURN_Turn(TURN_STOP, NULL);
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strcmp((char*)cmd, (char*)"turn forward postline")==0) {
-    TURN_Turn(TURN_STEP_LINE_FW_POST_LINE, NULL);
-    TURN_Turn(TURN_STOP, NULL);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)"turn forward")==0) {
-    TURN_Turn(TURN_STEP_LINE_FW, NULL);
-    TURN_Turn(TURN_STOP, NULL);
-    *handled = TRUE;
-  } else if (McuUtility_strcmp((char*)cmd, (char*)"turn backward")==0) {
-    TURN_Turn(TURN_STEP_LINE_BW, NULL);
-    TURN_Turn(TURN_STOP, NULL);
-    *handled = TRUE;
 #if PL_CONFIG_HAS_QUADRATURE
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn steps90 ", sizeof("turn steps90 ")-1)==0) {
-    p = cmd+sizeof("turn steps90");
-    if (McuUtility_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
-      TURN_Steps90 = val16u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn stepspostline ", sizeof("turn stepspostline ")-1)==0) {
-    p = cmd+sizeof("turn stepspostline");
-    if (McuUtility_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
-      TURN_StepsPostLine = val16u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn stepsline ", sizeof("turn stepsline ")-1)==0) {
-    p = cmd+sizeof("turn stepsline");
-    if (McuUtility_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
-      TURN_StepsLine = val16u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-#else
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn duty ", sizeof("turn duty ")-1)==0) {
-    p = cmd+sizeof("turn duty");
-    if (McuUtility_ScanDecimal8uNumber(&p, &val8u)==ERR_OK && val8u<=100) {
-      TURN_DutyPercent = val8u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument, must be in the range 0..100\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn time90 ", sizeof("turn time90 ")-1)==0) {
-    p = cmd+sizeof("turn time90");
-    if (McuUtility_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
-      TURN_Time90ms = val16u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn timeline ", sizeof("turn timeline ")-1)==0) {
-    p = cmd+sizeof("turn timeline");
-    if (McuUtility_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
-      TURN_StepLineMs = val16u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
-  } else if (McuUtility_strncmp((char*)cmd, (char*)"turn timepostline ", sizeof("turn timepostline ")-1)==0) {
-    p = cmd+sizeof("turn timepostline");
-    if (McuUtility_ScanDecimal16uNumber(&p, &val16u)==ERR_OK) {
-      TURN_StepPostLineMs = val16u;
-      *handled = TRUE;
-    } else {
-      McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
-      res = ERR_FAILED;
-    }
+#if PL_CONFIG_HAS_CONFIG_NVM
+static uint8_t TURN_CmdSave(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  (void)args;
+  if (TURN_SaveConfig()!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"ERROR: failed storing steps\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return ERR_OK;
+}
 #endif
+
+static uint8_t TURN_CmdSteps90(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (!TURN_Is16u(&args[0], io)) {
+    return ERR_FAILED;
+  }
+  TURN_Steps90 = (uint16_t)args[0].u;
+  return ERR_OK;
+}
+
+static uint8_t TURN_CmdStepsPostLine(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (!TURN_Is16u(&args[0], io)) {
+    return ERR_FAILED;
+  }
+  TURN_StepsPostLine = (uint16_t)args[0].u;
+  return ERR_OK;
+}
+
+static uint8_t TURN_CmdStepsLine(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (!TURN_Is16u(&args[0], io)) {
+    return ERR_FAILED;
+  }
+  TURN_StepsLine = (uint16_t)args[0].u;
+  return ERR_OK;
+}
+#else
+static uint8_t TURN_CmdDuty(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (args[0].u>100) {
+    McuShell_SendStr((unsigned char*)"Wrong argument, must be in the range 0..100\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  TURN_DutyPercent = (uint8_t)args[0].u;
+  return ERR_OK;
+}
+
+static uint8_t TURN_CmdTime90(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (!TURN_Is16u(&args[0], io)) {
+    return ERR_FAILED;
+  }
+  TURN_Time90ms = (uint16_t)args[0].u;
+  return ERR_OK;
+}
+
+static uint8_t TURN_CmdTimeLine(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (!TURN_Is16u(&args[0], io)) {
+    return ERR_FAILED;
   }
-  return res;
+  TURN_StepLineMs = (uint16_t)args[0].u;
+  return ERR_OK;
 }
+
+static uint8_t TURN_CmdTimePostLine(const CMD_Arg *args, const McuShell_StdIOType *io) {
+  if (!TURN_Is16u(&args[0], io)) {
+    return ERR_FAILED;
+  }
+  TURN_StepPostLineMs = (uint16_t)args[0].u;
+  return ERR_OK;
+}
+#endif
+
+static const CMD_Command TURN_Cmds[] = {
+  {"",                 "i", TURN_CmdAngle}, /* 'turn <angle>' */
+  {"forward postline", "",  TURN_CmdForwardPostLine},
+  {"forward",          "",  TURN_CmdForward},
+  {"backward",         "",  TURN_CmdBackward},
+#if PL_CONFIG_HAS_QUADRATURE
+#if PL_CONFIG_HAS_CONFIG_NVM
+  {"save",             "",  TURN_CmdSave},
+#endif
+  {"steps90",          "u", TURN_CmdSteps90},
+  {"stepspostline",    "u", TURN_CmdStepsPostLine},
+  {"stepsline",        "u", TURN_CmdStepsLine},
+#else
+  {"duty",             "u", TURN_CmdDuty},
+  {"time90",           "u", TURN_CmdTime90},
+  {"timeline",         "u", TURN_CmdTimeLine},
+  {"timepostline",     "u", TURN_CmdTimePostLine},
+#endif
+};
+
+const CMD_Group TURN_CmdGroup = CMD_GROUP("turn", TURN_PrintHelp, TURN_PrintStatus, TURN_Cmds);
 #endif /* PL_CONFIG_HAS_SHELL */
 
 void TURN_Init(void) {
@@ -678,6 +872,16 @@ void TURN_Init(void) {
   TURN_Steps90 = TURN_STEPS_90;
   TURN_StepsPostLine = TURN_STEPS_POST_LINE;
   TURN_StepsLine = TURN_STEPS_LINE;
+#if PL_CONFIG_HAS_CONFIG_NVM
+  TURN_LoadConfig(); /* steps stored with 'turn save' replace the defaults */
+#endif
+#if TURN_USE_MOVE_PROFILE
+  TURN_MoveDoneSem = xSemaphoreCreateBinary();
+  if (TURN_MoveDoneSem==NULL) {
+    for(;;){} /* out of memory? */
+  }
+  vQueueAddToRegistry(TURN_MoveDoneSem, "TurnDone");
+#endif
 #else
   TURN_DutyPercent = TURN_MOTOR_DUTY_PERCENT;
   TURN_Time90ms = TURN_90_WAIT_TIME_MS;
@@ -13,6 +13,9 @@
 #if PL_CONFIG_HAS_TURN
 
 #include "Reflectance.h"
+#if PL_CONFIG_HAS_DRIVE
+  #include "Drive.h"
+#endif
 
 typedef enum {
   TURN_LEFT45,   /* turn 45 degree left and stop */
@@ -75,17 +78,59 @@ void TURN_MoveToPos(int32_t targetLPos, int32_t targetRPos, bool wait, TURN_Stop
  */
 void TURN_TurnAngle(int16_t angle, TURN_StopFct stopIt);
 
+#if PL_CONFIG_HAS_QUADRATURE && PL_CONFIG_HAS_DRIVE && PL_CONFIG_HAS_POS_PID
+/*!
+ * \brief Starts a turn and returns without waiting for it. The Drive task moves the wheels with a speed profile.
+ * Use the callback or TURN_IsTurnDone() to check if the turn has finished.
+ * A new turn or drive command replaces a turn in progress, its callback gets DRV_MOVE_CANCELLED.
+ * \param kind How much the robot has to turn.
+ * \param done Callback at the end of the turn, called from the Drive task, or NULL
+ * \return Timeout for the turn in milliseconds, 0 if there is nothing to wait for
+ */
+int32_t TURN_StartTurn(TURN_Kind kind, DRV_MoveDoneFct done);
+
+/*!
+ * \brief Starts a turn by angle and returns without waiting for it, see TURN_StartTurn().
+ * \param angle Angle, negative angle means left turn, positive means right turn
+ * \param done Callback at the end of the turn, called from the Drive task, or NULL
+ * \return Timeout for the turn in milliseconds
+ */
+int32_t TURN_StartTurnAngle(int16_t angle, DRV_MoveDoneFct done);
+
+/*!
+ * \brief Cancels a turn in progress, the robot stops where it is.
+ */
+void TURN_CancelTurn(void);
+
+/*!
+ * \brief Checks if a turn started with TURN_StartTurn() or TURN_StartTurnAngle() has finished.
+ * \return TRUE if the robot is in position
+ */
+bool TURN_IsTurnDone(void);
+#endif
+
+#if PL_CONFIG_HAS_QUADRATURE
+/*!
+ * \brief Returns the number of wheel steps for a 90 degree turn (each wheel, in opposite directions).
+ * \return Number of steps
+ */
+int32_t TURN_GetSteps90(void);
+#endif
+
 void TURN_SetStepsLine(int32_t stepsLine, int32_t stepsPostLine);
 
-#if PL_CONFIG_HAS_SHELL
-#include "McuShell.h"
+#if PL_CONFIG_HAS_CONFIG_NVM && PL_CONFIG_HAS_QUADRATURE
 /*!
- * \brief Shell command line parser.
- * \param[in] cmd Pointer to command string
- * \param[out] handled If command is handled by the parser
- * \param[in] io Std I/O handler of shell
+ * \brief Stores the steps for the 90 degree turn, the line and post the line in the flash.
+ * \return ERR_OK if stored
  */
-uint8_t TURN_ParseCommand(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+uint8_t TURN_SaveConfig(void);
+#endif
+
+#if PL_CONFIG_HAS_SHELL
+#include "CmdRegistry.h"
+/*! \brief Shell commands of the turning, registered in Shell.c */
+extern const CMD_Group TURN_CmdGroup;
 #endif
 
 /*!
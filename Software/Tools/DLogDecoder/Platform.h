@@ -0,0 +1,30 @@
+/**
+ * \file
+ * \brief Host platform configuration for the deferred log stress test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/DLog.c: no RTOS and no shell. The format
+ * strings go into the section dlog_fmt, the linker provides its start address.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRUE   true
+#define FALSE  false
+
+#define ERR_OK        0x00U
+#define ERR_FAILED    0x1BU
+
+#define PL_CONFIG_USE_FREERTOS  (0)
+#define PL_CONFIG_HAS_SHELL     (0)
+#define PL_CONFIG_HAS_DLOG      (1)
+
+extern const char __start_dlog_fmt[];
+#define DLOG_CONFIG_FMT_SECTION  "dlog_fmt"
+#define DLOG_CONFIG_FMT_BASE     (__start_dlog_fmt)
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,23 @@
+/**
+ * \file
+ * \brief Host stubs of the cycle counter and of RTT for the deferred log stress test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of McuArmTools.h and
+ * SEGGER_RTT.h, so RoboLib/DLog.c is compiled unchanged. The functions are implemented in dlog_stress.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define __McuArmTools_H
+#define SEGGER_RTT_H
+#define SEGGER_RTT_MODE_NO_BLOCK_SKIP  (0)
+
+uint32_t McuArmTools_GetCycleCounter(void);
+unsigned SEGGER_RTT_WriteSkipNoLock(unsigned BufferIndex, const void *pBuffer, unsigned NumBytes);
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags);
+
+#endif /* SIMSTUBS_H_ */
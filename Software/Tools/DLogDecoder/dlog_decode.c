@@ -0,0 +1,261 @@
+/**
+ * \file
+ * \brief Host decoder for the deferred binary log
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Reads the format strings from the section .dlog_fmt of the ELF file of the application, and
+ * prints the records of a captured RTT log stream (see RoboLib/DLog.h) as text lines with the
+ * time in microseconds. The decoder synchronizes on the record header, so it can start in the
+ * middle of a capture and skips over garbage.
+ *
+ * Build: gcc -O2 -Wall -o dlog_decode dlog_decode.c
+ * Usage: dlog_decode [-f cpuHz] <app.elf> <capture.bin> [out.txt]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* same values as in DLog.h, which cannot be included without the target platform */
+#define DLOG_HEADER_MAGIC         (0xD10u<<4)
+#define DLOG_HEADER_MAGIC_MASK    (0xFFF0u)
+#define DLOG_ID_DROPPED           (0xFFFFu)
+#define DLOG_MAX_ARGS             (4)
+
+typedef struct {
+  const char *fmt;      /* format section */
+  size_t fmtSize;
+  uint32_t cpuHz;       /* clock of the cycle counter */
+  uint64_t time;        /* unwrapped cycle counter */
+  uint32_t lastStamp;   /* cycle counter of the previous record */
+  int hasLast;          /* if lastStamp is valid */
+  unsigned long nofRecords, nofDropped, nofSkippedBytes, nofUnknown; /* statistics */
+} Decoder;
+
+static uint16_t Get16(const uint8_t *p) {
+  return (uint16_t)(p[0]|(p[1]<<8));
+}
+
+static uint32_t Get32(const uint8_t *p) {
+  return (uint32_t)p[0]|((uint32_t)p[1]<<8)|((uint32_t)p[2]<<16)|((uint32_t)p[3]<<24);
+}
+
+static uint64_t Get64(const uint8_t *p) {
+  return (uint64_t)Get32(p)|((uint64_t)Get32(p+4)<<32);
+}
+
+static uint8_t *ReadFile(const char *name, size_t *size) {
+  FILE *f;
+  uint8_t *buf;
+  long len;
+
+  f = fopen(name, "rb");
+  if (f==NULL) {
+    perror(name);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  buf = malloc((size_t)len+1);
+  if (buf==NULL || fread(buf, 1, (size_t)len, f)!=(size_t)len) {
+    fprintf(stderr, "%s: read error\n", name);
+    free(buf);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  *size = (size_t)len;
+  return buf;
+}
+
+/*!
+ * \brief Finds the format section in a little endian ELF32 (target) or ELF64 (host test) file.
+ * \return 0 if found
+ */
+static int FindFormatSection(const uint8_t *elf, size_t size, Decoder *dec) {
+  int is64;
+  uint64_t shOff, off, secSize, strOff;
+  unsigned shEntSize, shNum, shStrNdx, i;
+  const uint8_t *sh;
+  const char *name;
+
+  if (size<64 || memcmp(elf, "\177ELF", 4)!=0 || elf[5]!=1) {
+    return -1; /* not a little endian ELF file */
+  }
+  is64 = elf[4]==2;
+  if (is64) {
+    shOff = Get64(elf+0x28); shEntSize = Get16(elf+0x3A); shNum = Get16(elf+0x3C); shStrNdx = Get16(elf+0x3E);
+  } else {
+    shOff = Get32(elf+0x20); shEntSize = Get16(elf+0x2E); shNum = Get16(elf+0x30); shStrNdx = Get16(elf+0x32);
+  }
+  if (shOff+(uint64_t)shNum*shEntSize>size || shStrNdx>=shNum) {
+    return -1;
+  }
+  sh = elf+shOff+(uint64_t)shStrNdx*shEntSize;
+  strOff = is64 ? Get64(sh+0x18) : Get32(sh+0x10);
+  for(i=0; i<shNum; i++) {
+    sh = elf+shOff+(uint64_t)i*shEntSize;
+    if (strOff+Get32(sh)>=size) {
+      continue;
+    }
+    name = (const char*)elf+strOff+Get32(sh);
+    if (strcmp(name, ".dlog_fmt")!=0 && strcmp(name, "dlog_fmt")!=0) { /* host builds use a name without dot for __start_dlog_fmt */
+      continue;
+    }
+    off = is64 ? Get64(sh+0x18) : Get32(sh+0x10);
+    secSize = is64 ? Get64(sh+0x20) : Get32(sh+0x14);
+    if (off+secSize>size) {
+      return -1;
+    }
+    dec->fmt = (const char*)elf+off;
+    dec->fmtSize = (size_t)secSize;
+    return 0;
+  }
+  return -1;
+}
+
+/* prints the format string with the arguments, only integer conversions */
+static void PrintMessage(const char *fmt, const uint32_t *args, unsigned nofArgs, FILE *out) {
+  char spec[32];
+  size_t n;
+  unsigned arg = 0;
+  char conv;
+
+  while (*fmt!='\0') {
+    if (*fmt!='%') {
+      fputc(*fmt++, out);
+      continue;
+    }
+    if (fmt[1]=='%') {
+      fputc('%', out);
+      fmt += 2;
+      continue;
+    }
+    n = 0;
+    spec[n++] = *fmt++;
+    while (*fmt!='\0' && strchr("-+ #0123456789.", *fmt)!=NULL && n<sizeof(spec)-2) {
+      spec[n++] = *fmt++;
+    }
+    while (*fmt!='\0' && strchr("hlLqjzt", *fmt)!=NULL) {
+      fmt++; /* the arguments are 32bit */
+    }
+    conv = *fmt;
+    if (conv=='\0') {
+      break;
+    }
+    fmt++;
+    spec[n++] = conv;
+    spec[n] = '\0';
+    if (arg>=nofArgs) {
+      fputs("<missing>", out);
+    } else if (conv=='d' || conv=='i') {
+      fprintf(out, spec, (int)(int32_t)args[arg++]);
+    } else if (strchr("uxXoc", conv)!=NULL) {
+      fprintf(out, spec, (unsigned)args[arg++]);
+    } else {
+      fprintf(out, "<%%%c?>", conv);
+      arg++;
+    }
+  }
+  fputc('\n', out);
+}
+
+static int IsRecordStart(const uint8_t *p, size_t avail) {
+  return avail>=8 && (Get32(p)&DLOG_HEADER_MAGIC_MASK)==DLOG_HEADER_MAGIC && (Get32(p)&0xF)<=DLOG_MAX_ARGS;
+}
+
+static void Decode(Decoder *dec, const uint8_t *buf, size_t size, FILE *out) {
+  uint32_t header, stamp, args[DLOG_MAX_ARGS], id;
+  size_t pos = 0, len;
+  unsigned i, nofArgs;
+
+  while (size-pos>=8) {
+    if (!IsRecordStart(buf+pos, size-pos)) {
+      pos++; /* resynchronize */
+      dec->nofSkippedBytes++;
+      continue;
+    }
+    header = Get32(buf+pos);
+    nofArgs = header&0xF;
+    len = 8+4*nofArgs;
+    if (size-pos<len) {
+      break;
+    }
+    id = header>>16;
+    stamp = Get32(buf+pos+4);
+    for(i=0; i<nofArgs; i++) {
+      args[i] = Get32(buf+pos+8+4*i);
+    }
+    pos += len;
+    if (id==DLOG_ID_DROPPED && nofArgs==1) { /* time stamp of the reader, older records follow */
+      fprintf(out, "%10llu <%u records dropped>\n", (unsigned long long)(dec->time*1000000ULL/dec->cpuHz), args[0]);
+      dec->nofDropped += args[0];
+      continue;
+    }
+    if (dec->hasLast) {
+      dec->time += (uint32_t)(stamp-dec->lastStamp); /* cycle counter wraps around */
+    } else {
+      dec->time = 0;
+    }
+    dec->lastStamp = stamp;
+    dec->hasLast = 1;
+    fprintf(out, "%10llu ", (unsigned long long)(dec->time*1000000ULL/dec->cpuHz));
+    if (id<dec->fmtSize && memchr(dec->fmt+id, '\0', dec->fmtSize-id)!=NULL) {
+      PrintMessage(dec->fmt+id, args, nofArgs, out);
+      dec->nofRecords++;
+    } else {
+      fprintf(out, "<unknown format 0x%04x>\n", id);
+      dec->nofUnknown++;
+    }
+  }
+  dec->nofSkippedBytes += size-pos;
+}
+
+int main(int argc, char *argv[]) {
+  Decoder dec;
+  FILE *out;
+  uint8_t *elf, *capture;
+  size_t elfSize, captureSize;
+  int arg = 1;
+
+  memset(&dec, 0, sizeof(dec));
+  dec.cpuHz = 64000000;
+  if (arg+1<argc && strcmp(argv[arg], "-f")==0) {
+    dec.cpuHz = (uint32_t)strtoul(argv[arg+1], NULL, 0);
+    arg += 2;
+  }
+  if (arg+1>=argc || dec.cpuHz==0) {
+    fprintf(stderr, "usage: %s [-f cpuHz] <app.elf> <capture.bin> [out.txt]\n", argv[0]);
+    return 1;
+  }
+  elf = ReadFile(argv[arg], &elfSize);
+  if (elf==NULL) {
+    return 1;
+  }
+  if (FindFormatSection(elf, elfSize, &dec)!=0) {
+    fprintf(stderr, "%s: no .dlog_fmt section\n", argv[arg]);
+    return 1;
+  }
+  capture = ReadFile(argv[arg+1], &captureSize);
+  if (capture==NULL) {
+    return 1;
+  }
+  out = stdout;
+  if (arg+2<argc) {
+    out = fopen(argv[arg+2], "w");
+    if (out==NULL) {
+      perror(argv[arg+2]);
+      return 1;
+    }
+  }
+  Decode(&dec, capture, captureSize, out);
+  fprintf(stderr, "%lu records, %lu dropped, %lu unknown, %lu bytes skipped\n", dec.nofRecords, dec.nofDropped, dec.nofUnknown, dec.nofSkippedBytes);
+  if (out!=stdout) {
+    fclose(out);
+  }
+  free(elf);
+  free(capture);
+  return 0;
+}
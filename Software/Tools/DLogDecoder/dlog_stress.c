@@ -0,0 +1,227 @@
+/**
+ * \file
+ * \brief Host stress test of the deferred log ring buffer
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/DLog.c (compiled unchanged) with several writer threads and one thread calling
+ * DLOG_Drain() into a simulated RTT buffer, which is full now and then. Each writer logs records
+ * with its thread number and a sequence number. The captured stream is checked: no torn record, the
+ * sequence numbers of each writer are increasing, and the records received plus the records
+ * reported as dropped are all records written. The stream is written to a file, so it can be
+ * decoded with dlog_decode and the ELF file of this program.
+ * Before, DLOG_LogBench() runs as at the startup of the target, and its result has to arrive in the
+ * stream as a record with the format string of the benchmark.
+ *
+ * Build: gcc -O2 -Wall -pthread -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config -I../../McuLib/SEGGER_RTT
+ *          -o dlog_stress dlog_stress.c ../../RoboLib/DLog.c ../../McuLib/src/McuXFormat.c
+ * Usage: dlog_stress [capture.bin]; dlog_decode dlog_stress capture.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Platform.h"
+#include "DLog.h"
+
+#define NOF_WRITERS      (4)
+#define NOF_PER_WRITER   (20000)
+#define WRITER_BURST     (4)  /* records of a writer before it yields */
+
+static uint8_t *capture;
+static size_t captureSize, captureMax;
+static unsigned long nofWrites, nofFull;
+static volatile int writersDone;
+
+static uint32_t cycles;
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return __atomic_add_fetch(&cycles, 64, __ATOMIC_RELAXED); /* one microsecond per call, cheaper than the clock */
+}
+
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags) {
+  (void)BufferIndex; (void)sName; (void)pBuffer; (void)BufferSize; (void)Flags;
+  return 0;
+}
+
+unsigned SEGGER_RTT_WriteSkipNoLock(unsigned BufferIndex, const void *pBuffer, unsigned NumBytes) {
+  (void)BufferIndex;
+  nofWrites++;
+  if (nofWrites%13==0) { /* host is slow: all or nothing like in skip mode */
+    nofFull++;
+    return 0;
+  }
+  if (captureSize+NumBytes>captureMax) {
+    captureMax = 2*captureMax+NumBytes;
+    capture = realloc(capture, captureMax);
+  }
+  memcpy(capture+captureSize, pBuffer, NumBytes);
+  captureSize += NumBytes;
+  return NumBytes;
+}
+
+static double NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec*1e9+(double)ts.tv_nsec;
+}
+
+static void *Writer(void *arg) {
+  uint32_t t = (uint32_t)(uintptr_t)arg, n;
+
+  for(n=1; n<=NOF_PER_WRITER; n++) {
+    if (n%WRITER_BURST==0) {
+      sched_yield(); /* like a task waiting for its next period, otherwise nearly all records are dropped */
+    }
+    switch(n%4) {
+      case 0: DLOG("writer %u seq %u", t, n); break;
+      case 1: DLOG("writer %u seq %u check %d", t, n, -(int32_t)n); break;
+      case 2: DLOG("writer %u seq %u check %d %x", t, n, -(int32_t)n, n*3); break;
+      default: DLOG("tick"); break;
+    }
+  }
+  return NULL;
+}
+
+static void *Reader(void *arg) {
+  int idle;
+
+  (void)arg;
+  while (!writersDone) {
+    (void)DLOG_Drain();
+  }
+  for(idle=0; idle<3;) { /* until empty: a simulated full buffer returns 0 only once */
+    idle = DLOG_Drain()==0 ? idle+1 : 0;
+  }
+  return NULL;
+}
+
+static uint32_t Get32(const uint8_t *p) {
+  uint32_t val;
+
+  memcpy(&val, p, sizeof(val));
+  return val;
+}
+
+/* Checks that the result of DLOG_LogBench() is in the captured stream, returns the number of errors */
+static int CheckBench(void) {
+  static const char benchFmt[] = "log bench cycles/call:";
+  uint32_t header, id;
+  size_t pos = 0;
+  unsigned nofArgs;
+
+  while (pos+8<=captureSize) {
+    header = Get32(capture+pos);
+    nofArgs = header&0xF;
+    id = header>>16;
+    if (nofArgs==4 && id!=DLOG_ID_DROPPED && strncmp(__start_dlog_fmt+id, benchFmt, sizeof(benchFmt)-1)==0) {
+      printf("log bench cycles/call (host cycle counter): 0 args %u, 2 args %u, 4 args %u, xsnprintf %u\n",
+        Get32(capture+pos+8), Get32(capture+pos+12), Get32(capture+pos+16), Get32(capture+pos+20));
+      return 0;
+    }
+    pos += 8+4*nofArgs;
+  }
+  printf("FAILED: no result of the log bench\n");
+  return 1;
+}
+
+/* Checks the captured stream, returns the number of errors */
+static int CheckCapture(unsigned long *received, unsigned long *dropped) {
+  uint32_t lastSeq[NOF_WRITERS], header, a[DLOG_CONFIG_MAX_ARGS];
+  size_t pos = 0;
+  unsigned i, nofArgs;
+  int errors = 0;
+
+  memset(lastSeq, 0, sizeof(lastSeq));
+  *received = *dropped = 0;
+  while (pos+8<=captureSize) {
+    header = Get32(capture+pos);
+    nofArgs = header&0xF;
+    if ((header&DLOG_HEADER_MAGIC_MASK)!=DLOG_HEADER_MAGIC || nofArgs>DLOG_CONFIG_MAX_ARGS || pos+8+4*nofArgs>captureSize) {
+      printf("FAILED: broken record at %lu\n", (unsigned long)pos);
+      return errors+1;
+    }
+    for(i=0; i<nofArgs; i++) {
+      a[i] = Get32(capture+pos+8+4*i);
+    }
+    pos += 8+4*nofArgs;
+    if ((header>>16)==DLOG_ID_DROPPED) {
+      *dropped += a[0];
+      continue;
+    }
+    (*received)++;
+    if (nofArgs<2) {
+      continue; /* tick */
+    }
+    if (a[0]>=NOF_WRITERS || a[1]<=lastSeq[a[0]] || (nofArgs>=3 && a[2]!=(uint32_t)-(int32_t)a[1]) || (nofArgs==4 && a[3]!=a[1]*3)) {
+      if (errors<10) {
+        printf("FAILED: wrong record writer %u seq %u\n", a[0], a[1]);
+      }
+      errors++;
+    }
+    if (a[0]<NOF_WRITERS) {
+      lastSeq[a[0]] = a[1];
+    }
+  }
+  return errors;
+}
+
+int main(int argc, char *argv[]) {
+  const char *fileName = "dlog_stress.bin";
+  pthread_t writers[NOF_WRITERS], reader;
+  unsigned long received, dropped, total;
+  double start;
+  int i, errors, benchErrors;
+  FILE *f;
+
+  if (argc>1) {
+    fileName = argv[1];
+  }
+  /* single writer: time per call */
+  DLOG_Init();
+  start = NowNs();
+  for(i=0; i<DLOG_CONFIG_RING_WORDS/6; i++) {
+    DLOG("bench %d %d %d %d", i, i, i, i);
+  }
+  printf("log call with 4 arguments: %.1f ns\n", (NowNs()-start)/(DLOG_CONFIG_RING_WORDS/6));
+  /* benchmark of the startup, output through the log */
+  DLOG_Init();
+  captureSize = 0;
+  DLOG_LogBench();
+  for(i=0; i<3;) { /* until empty */
+    i = DLOG_Drain()==0 ? i+1 : 0;
+  }
+  benchErrors = CheckBench();
+  DLOG_Init();
+  captureSize = 0;
+  nofWrites = nofFull = 0;
+
+  writersDone = 0;
+  pthread_create(&reader, NULL, Reader, NULL);
+  for(i=0; i<NOF_WRITERS; i++) {
+    pthread_create(&writers[i], NULL, Writer, (void*)(uintptr_t)i);
+  }
+  for(i=0; i<NOF_WRITERS; i++) {
+    pthread_join(writers[i], NULL);
+  }
+  writersDone = 1;
+  pthread_join(reader, NULL);
+
+  errors = benchErrors+CheckCapture(&received, &dropped);
+  total = (unsigned long)NOF_WRITERS*NOF_PER_WRITER;
+  printf("%lu records written, %lu received, %lu dropped, %lu bytes, RTT full %lu times\n", total, received, dropped, (unsigned long)captureSize, nofFull);
+  if (received+dropped!=total) {
+    printf("FAILED: %lu records lost\n", total-received-dropped);
+    errors++;
+  }
+  f = fopen(fileName, "wb");
+  if (f!=NULL) {
+    fwrite(capture, 1, captureSize, f);
+    fclose(f);
+  }
+  printf("%d failed\n", errors);
+  return errors==0 ? 0 : 1;
+}
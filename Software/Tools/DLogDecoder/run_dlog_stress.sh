@@ -0,0 +1,17 @@
+#!/bin/sh
+# Builds and runs the deferred log stress test, then decodes its capture with dlog_decode and the
+# ELF file of the stress test.
+# Usage: ./run_dlog_stress.sh [capture.bin]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -pthread -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/SEGGER_RTT"
+SRC="dlog_stress.c $R/DLog.c $M/src/McuXFormat.c"
+CAPTURE=${1:-$OUT/dlog_capture.bin}
+
+gcc -O2 -Wall -o $OUT/dlog_decode dlog_decode.c
+gcc $CFLAGS -o $OUT/dlog_stress $SRC
+$OUT/dlog_stress "$CAPTURE"
+$OUT/dlog_decode $OUT/dlog_stress "$CAPTURE" $OUT/dlog_capture.txt
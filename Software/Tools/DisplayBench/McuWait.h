@@ -0,0 +1,16 @@
+/**
+ * \file
+ * \brief Host replacement of McuWait for the display benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The real McuWait.h pulls in the STM32 HAL and RTT. This header is force-included with '-include',
+ * so its include guard hides the real one. The benchmark does not need to wait for the display.
+ */
+
+#ifndef __McuWait_H
+#define __McuWait_H
+
+#define McuWait_Waitms(ms)  /* nothing */
+#define McuWait_Waitus(us)  /* nothing */
+
+#endif /* __McuWait_H */
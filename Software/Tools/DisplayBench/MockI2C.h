@@ -0,0 +1,27 @@
+/**
+ * \file
+ * \brief Mock I2C driver for the display benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces McuGenericI2C for the host build of McuSSD1306. Nothing is sent, the mock only counts the
+ * bytes on the bus (device address, register address and data) and the number of transactions.
+ */
+
+#ifndef MOCKI2C_H_
+#define MOCKI2C_H_
+
+#include <stdint.h>
+
+#define McuGenericI2C_WRITE_BUFFER_SIZE  (32) /* same as on the target */
+
+typedef struct {
+  unsigned long nofBytes;        /* bytes on the bus, including address bytes */
+  unsigned long nofTransactions; /* number of start/stop sequences */
+} MockI2C_Counters;
+
+extern MockI2C_Counters MockI2C_counters;
+
+uint8_t McuGenericI2C_WriteByteAddress8(uint8_t i2cAddr, uint8_t memAddr, uint8_t data);
+uint8_t McuGenericI2C_WriteAddress(uint8_t i2cAddr, uint8_t *memAddr, uint8_t memAddrSize, uint8_t *data, uint16_t dataSize);
+
+#endif /* MOCKI2C_H_ */
@@ -0,0 +1,34 @@
+/**
+ * \file
+ * \brief Host platform configuration for the display benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/LCD.c and RoboLib/LCDMenu.c: display,
+ * menu and the screens of the sensors, without the shell. The modules behind the screens are not
+ * built, display_bench.c provides their functions.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS      (1)
+#define PL_CONFIG_HAS_SHELL         (0)
+#define PL_CONFIG_HAS_EVENTS        (1)
+#define PL_CONFIG_HAS_KEYS          (1)
+#define PL_CONFIG_NOF_KEYS          (1)
+#define PL_CONFIG_HAS_LCD           (1)
+#define PL_CONFIG_HAS_LCD_MENU      (1)
+#define PL_CONFIG_HAS_LCD_HEADER    (1)
+#define PL_CONFIG_HAS_QUADRATURE    (1)
+#define PL_CONFIG_HAS_REFLECTANCE   (1)
+#define PL_CONFIG_HAS_LINE          (1)
+#define PL_CONFIG_HAS_PROXIMITY     (1)
+#define PL_CONFIG_HAS_ODOMETRY      (1)
+#define PL_CONFIG_HAS_SPAN          (1)
+#define PL_CONFIG_HAS_SUMO          (1)
+
+#endif /* SRC_PLATFORM_H_ */
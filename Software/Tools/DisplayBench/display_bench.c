@@ -0,0 +1,397 @@
+/**
+ * \file
+ * \brief Host benchmark for the SSD1306 display update
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs the LCD task of RoboLib/LCD.c with the menu of RoboLib/LCDMenu.c (both compiled unchanged)
+ * on the McuLib display and font drivers, with a mock I2C driver which counts the bytes on the bus.
+ * The task is started directly, each wait for the next frame (xTaskNotifyWait()) ends a frame: the
+ * script below presses the key there to move through the robot menu and to open each screen, and
+ * the values behind the screens change from frame to frame while a screen is open. For the menu and
+ * for each screen it reports the bytes and I2C transactions per frame. The mock also keeps the
+ * display RAM, so each frame is checked against the display buffer.
+ * Build it twice, with the update of the changed regions (default) and with the full update
+ * (-DMcuSSD1306_CONFIG_PARTIAL_UPDATE=0), run_display_bench.sh does this and compares the two.
+ *
+ * Build: gcc -O2 -include McuWait.h -I. -IStubs -I../RoboSim -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -I../../McuLib/config/fonts -I../../McuLib/fonts -I../../McuLib/FreeRTOS/Source/include
+ *          -DMcuSSD1306_CONFIG_I2C_HEADER_FILE='"MockI2C.h"' -o display_bench display_bench.c
+ *          ../../RoboLib/LCD.c ../../RoboLib/LCDMenu.c ../../McuLib/src/McuUtility.c ../../McuLib/src/McuSSD1306.c
+ *          ../../McuLib/src/McuGDisplaySSD1306.c ../../McuLib/src/McuFontDisplay.c ../../McuLib/fonts/McuFontHelv08Normal.c
+ *          ../../McuLib/fonts/McuFontCour08Normal.c
+ * Usage: display_bench [nofFrames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "Platform.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MockI2C.h"
+#include "McuSSD1306.h"
+#include "McuGDisplaySSD1306.h"
+#include "LCD.h"
+#include "LCDMenu.h"
+#include "Event.h"
+#include "Quadrature.h"
+#include "Odometry.h"
+#include "Reflectance.h"
+#include "Line.h"
+#include "Proximity.h"
+#include "Sumo.h"
+#include "Span.h"
+
+MockI2C_Counters MockI2C_counters;
+
+/* display RAM of the SSD1306 in horizontal addressing mode, to check the updates */
+static uint8_t displayRam[McuSSD1306_DISPLAY_HW_NOF_PAGES][McuSSD1306_DISPLAY_HW_NOF_COLUMNS];
+static uint8_t winCol0, winCol1 = McuSSD1306_DISPLAY_HW_NOF_COLUMNS-1, winPage0, winPage1 = McuSSD1306_DISPLAY_HW_NOF_PAGES-1;
+static uint8_t ramCol, ramPage;
+
+static void MockDisplayCommands(const uint8_t *cmds, uint16_t size) {
+  if (size==6 && cmds[0]==0x21 && cmds[3]==0x22) { /* window set by SSD1306_SetWindow() */
+    winCol0 = cmds[1]; winCol1 = cmds[2];
+    winPage0 = cmds[4]; winPage1 = cmds[5];
+    ramCol = winCol0;
+    ramPage = winPage0;
+  } else if (size==1 && (cmds[0]&0xF8)==0xB0) { /* page start, full update without the partial one */
+    ramPage = cmds[0]&0x07;
+  } else if (size==1 && (cmds[0]&0xF0)==0x10) { /* column start, high nibble */
+    ramCol = (uint8_t)((ramCol&0x0F)|((cmds[0]&0x0F)<<4));
+  } else if (size==1 && (cmds[0]&0xF0)==0x00) { /* column start, low nibble */
+    ramCol = (uint8_t)((ramCol&0xF0)|cmds[0]);
+  } /* other commands do not change the content */
+}
+
+static void MockDisplayData(const uint8_t *data, uint16_t size) {
+  while (size>0) {
+    displayRam[ramPage][ramCol] = *data++;
+    size--;
+    if (ramCol<winCol1) {
+      ramCol++;
+    } else {
+      ramCol = winCol0;
+      ramPage = ramPage<winPage1 ? ramPage+1 : winPage0;
+    }
+  }
+}
+
+uint8_t McuGenericI2C_WriteByteAddress8(uint8_t i2cAddr, uint8_t memAddr, uint8_t data) {
+  (void)i2cAddr;
+  MockI2C_counters.nofBytes += 1+1+1;
+  MockI2C_counters.nofTransactions++;
+  if (memAddr==0x40) {
+    MockDisplayData(&data, 1);
+  } else {
+    MockDisplayCommands(&data, 1);
+  }
+  return 0;
+}
+
+uint8_t McuGenericI2C_WriteAddress(uint8_t i2cAddr, uint8_t *memAddr, uint8_t memAddrSize, uint8_t *data, uint16_t dataSize) {
+  (void)i2cAddr;
+  MockI2C_counters.nofBytes += 1+memAddrSize+dataSize;
+  MockI2C_counters.nofTransactions++;
+  if (memAddrSize==1 && *memAddr==0x40) {
+    MockDisplayData(data, dataSize);
+  } else {
+    MockDisplayCommands(data, dataSize);
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* script of the key presses, as the events of the debounced key which LCD_Task() handles */
+#define KEY_NONE   EVNT_NOF_EVENTS
+#define KEY_DOWN   EVNT_SW1_RELEASED
+#define KEY_UP     EVNT_SW1_LRELEASED
+#define KEY_ENTER  EVNT_SW1_LLRELEASED
+#define KEY_EXIT   EVNT_SW1_RELEASED   /* any key leaves a screen */
+
+typedef enum {
+  PHASE_MENU,
+  PHASE_ENCODER,
+  PHASE_REFLECTANCE,
+  PHASE_CALIBRATE,
+  PHASE_PROXIMITY,
+  PHASE_SUMO,
+  PHASE_TIMING,
+  PHASE_NOF
+} Phase;
+
+static const char *const phaseNames[PHASE_NOF] = {
+  "menu", "encoder", "reflectance", "calibrate", "proximity", "sumo", "timing"
+};
+
+typedef struct {
+  EVNT_Handle key;  /* key event at the start of the step */
+  Phase phase;      /* what the display shows during the step */
+  int nofFrames;    /* 0: nofFrames of the command line */
+} Step;
+
+static const Step script[] = {
+  {KEY_DOWN,  PHASE_MENU, 1},        /* main menu: General -> Robot */
+  {KEY_ENTER, PHASE_MENU, 1},        /* robot menu, on BACK */
+  {KEY_DOWN,  PHASE_MENU, 1},        /* Start Sumo */
+  {KEY_DOWN,  PHASE_MENU, 1},        /* Encoder */
+  {KEY_ENTER, PHASE_ENCODER, 0},
+  {KEY_EXIT,  PHASE_MENU, 1},
+  {KEY_DOWN,  PHASE_MENU, 1},        /* Reflectance */
+  {KEY_ENTER, PHASE_REFLECTANCE, 0},
+  {KEY_EXIT,  PHASE_MENU, 1},
+  {KEY_DOWN,  PHASE_MENU, 1},        /* Start Line Calibration */
+  {KEY_ENTER, PHASE_CALIBRATE, 0},
+  {KEY_EXIT,  PHASE_MENU, 1},        /* stops the calibration */
+  {KEY_DOWN,  PHASE_MENU, 1},        /* Proximity */
+  {KEY_ENTER, PHASE_PROXIMITY, 0},
+  {KEY_EXIT,  PHASE_MENU, 1},
+  {KEY_DOWN,  PHASE_MENU, 1},        /* Timing */
+  {KEY_ENTER, PHASE_TIMING, 0},
+  {KEY_EXIT,  PHASE_MENU, 1},
+  {KEY_UP,    PHASE_MENU, 1},        /* back to Start Sumo */
+  {KEY_UP,    PHASE_MENU, 1},
+  {KEY_UP,    PHASE_MENU, 1},
+  {KEY_UP,    PHASE_MENU, 1},
+  {KEY_UP,    PHASE_MENU, 1},
+  {KEY_ENTER, PHASE_SUMO, 0},        /* countdown, then running */
+  {KEY_EXIT,  PHASE_MENU, 1},        /* stops the sumo */
+};
+#define NOF_STEPS  (sizeof(script)/sizeof(script[0]))
+
+typedef struct {
+  unsigned long nofFrames;
+  MockI2C_Counters counters;
+} PhaseStats;
+
+static PhaseStats stats[PHASE_NOF];
+static int nofScreenFrames = 50;
+static unsigned int stepIdx;    /* current step of the script */
+static int stepFrame;           /* frame within the step */
+static EVNT_Handle pendingKey = KEY_NONE;
+static int dataNo;              /* changes the values shown, only while a screen is open */
+static int nofErrors;
+static jmp_buf scriptDone;
+
+static int StepFrames(unsigned int idx) {
+  return script[idx].nofFrames>0 ? script[idx].nofFrames : nofScreenFrames;
+}
+
+/* end of a frame of the LCD task: counts it, then sets up the next one */
+static void OnFrameEnd(void) {
+  PhaseStats *s = &stats[script[stepIdx].phase];
+
+  s->nofFrames++;
+  s->counters.nofBytes += MockI2C_counters.nofBytes;
+  s->counters.nofTransactions += MockI2C_counters.nofTransactions;
+  MockI2C_counters.nofBytes = 0;
+  MockI2C_counters.nofTransactions = 0;
+  if (memcmp(displayRam, McuSSD1306_DisplayBuf, sizeof(displayRam))!=0) {
+    nofErrors++; /* display does not show the buffer content */
+  }
+  stepFrame++;
+  if (stepFrame>=StepFrames(stepIdx)) {
+    stepIdx++;
+    stepFrame = 0;
+    if (stepIdx>=NOF_STEPS) {
+      longjmp(scriptDone, 1);
+    }
+  }
+  if (stepFrame==0) {
+    pendingKey = script[stepIdx].key;
+  } else if (script[stepIdx].phase!=PHASE_MENU) {
+    dataNo++; /* not in the menu, the encoder values would move the cursor */
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* the one task of the benchmark, started from main() */
+static TaskFunction_t lcdTask;
+static bool firstFrame = TRUE;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char * const pcName, const configSTACK_DEPTH_TYPE usStackDepth,
+    void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask) {
+  (void)pcName; (void)usStackDepth; (void)pvParameters; (void)uxPriority;
+  lcdTask = pxTaskCode;
+  *pxCreatedTask = NULL;
+  return pdPASS;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+  (void)xTicksToDelay; /* inside the key handling, not the end of a frame */
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return 0; /* the time does not advance, each wait ends with the timeout of the update period */
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit, uint32_t *pulNotificationValue, TickType_t xTicksToWait) {
+  (void)ulBitsToClearOnEntry; (void)ulBitsToClearOnExit; (void)pulNotificationValue; (void)xTicksToWait;
+  if (firstFrame) { /* initial menu, not counted */
+    firstFrame = FALSE;
+    MockI2C_counters.nofBytes = 0;
+    MockI2C_counters.nofTransactions = 0;
+    pendingKey = script[0].key;
+  } else {
+    OnFrameEnd();
+  }
+  return pdFALSE; /* timeout: the next screen update */
+}
+
+bool EVNT_EventIsSetAutoClear(EVNT_Handle event) {
+  if (pendingKey==event) {
+    pendingKey = KEY_NONE;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+uint8_t EVNT_Subscribe(EVNT_Handle event, TaskHandle_t task, uint32_t notifyBits) {
+  (void)event; (void)task; (void)notifyBits;
+  return ERR_OK;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* values behind the screens */
+static bool isCalibrating, isDoingSumo;
+static int sumoStartNo;
+
+QUAD_QuadCntrType QUAD_GetLeftPos(void) {
+  return 1000+dataNo*37;
+}
+
+QUAD_QuadCntrType QUAD_GetRightPos(void) {
+  return 1000+dataNo*35;
+}
+
+void ODO_GetPose(ODO_Pose *pose) {
+  memset(pose, 0, sizeof(*pose));
+  pose->x = dataNo*3;
+  pose->y = dataNo/2;
+  pose->heading = (dataNo*25)%36000;
+}
+
+REF_SensorTimeType REF_GetRawValue(unsigned int idx) {
+  return (REF_SensorTimeType)(0x0200+idx*0x100+((dataNo*7+idx*3)&0xF)); /* noise in the low digits */
+}
+
+bool REF_GetSnapshot(REF_Snapshot *snapshot, SBUS_Stamp *stamp) {
+  unsigned int i;
+
+  (void)stamp;
+  for(i=0; i<REF_NOF_SENSORS; i++) {
+    snapshot->raw[i] = REF_GetRawValue(i);
+  }
+  snapshot->whiteBits = 0;
+  return TRUE;
+}
+
+REF_SensorTimeType LINE_Get1kValue(unsigned int idx) {
+  return (REF_SensorTimeType)((dataNo*11+idx*250)%1000);
+}
+
+REF_SensorTimeType LINE_GetMinValue(unsigned int idx) {
+  return (REF_SensorTimeType)(0x0100+idx*0x10-(dataNo/8)%16);
+}
+
+REF_SensorTimeType LINE_GetMaxValue(unsigned int idx) {
+  return (REF_SensorTimeType)(0x0800+idx*0x10+(dataNo/8)%16);
+}
+
+uint16_t LINE_GetLinePos(void) {
+  return (uint16_t)(1500+(dataNo*20)%1000);
+}
+
+bool LINE_IsCalibrating(void) {
+  return isCalibrating;
+}
+
+void LINE_CalibrateStartStop(void) {
+  isCalibrating = !isCalibrating;
+}
+
+PROX_Bits PROX_GetProxBits(void) {
+  return (PROX_Bits)((dataNo*7)&0x3F);
+}
+
+bool PROX_GetResult(PROX_Result *result, SBUS_Stamp *stamp) {
+  int i;
+
+  (void)stamp;
+  memset(result, 0, sizeof(*result));
+  result->proximityFound = dataNo%4!=0;
+  result->proximityBits = PROX_GetProxBits();
+  result->proximityAngle = (dataNo*13)%180-90;
+  for(i=0; i<PROX_NOF_SENSORS; i++) {
+    result->countsLeft[i] = (uint8_t)((dataNo+i)%5);
+    result->countsRight[i] = (uint8_t)((dataNo+2*i)%7);
+  }
+  return TRUE;
+}
+
+bool SUMO_IsDoingSumo(void) {
+  return isDoingSumo;
+}
+
+void SUMO_StopSumo(void) {
+  isDoingSumo = FALSE;
+}
+
+void SUMO_StartStopSumo(void) {
+  isDoingSumo = !isDoingSumo;
+  sumoStartNo = dataNo;
+}
+
+int16_t SUMO_GetCountDownMs(void) {
+  int ms = 1000-(dataNo-sumoStartNo)*50; /* frames of 50 ms */
+
+  return (int16_t)(isDoingSumo && ms>0 ? ms : 0);
+}
+
+bool SPAN_GetStats(SPAN_Id id, SPAN_Stats *stats) {
+  stats->count = 1000;
+  stats->minNs = 10000*(id+1);
+  stats->meanNs = stats->minNs+1000*((dataNo+id)%3);
+  stats->maxNs = stats->meanNs+1000*((dataNo*3+id)%17);
+  return TRUE;
+}
+
+const unsigned char *SPAN_GetName(SPAN_Id id) {
+  static const char *const names[SPAN_NOF_IDS] = {
+    "drive", "quad", "tacho", "pidSpeed", "pidPos", "pidLine", "ref", "line", "trg"
+  };
+
+  return (const unsigned char*)(id<SPAN_NOF_IDS ? names[id] : "?");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+int main(int argc, char *argv[]) {
+  int i;
+
+  if (argc>1) {
+    nofScreenFrames = atoi(argv[1]);
+  }
+  if (nofScreenFrames<=0) {
+    fprintf(stderr, "usage: %s [nofFrames]\n", argv[0]);
+    return 1;
+  }
+  McuSSD1306_Init(); /* as Platform.c */
+  McuGDisplaySSD1306_Init();
+  LCD_Init();
+  LCDMenu_Init();
+  if (setjmp(scriptDone)==0) {
+    lcdTask(NULL); /* returns with the end of the script */
+  }
+  printf("# %s\n", McuSSD1306_CONFIG_PARTIAL_UPDATE ? "dirty update" : "full update");
+  printf("%-12s %8s %12s %12s\n", "screen", "frames", "B/frame", "tx/frame");
+  for(i=0; i<PHASE_NOF; i++) {
+    printf("%-12s %8lu %12lu %12lu\n", phaseNames[i], stats[i].nofFrames,
+      stats[i].counters.nofBytes/stats[i].nofFrames, stats[i].counters.nofTransactions/stats[i].nofFrames);
+  }
+  if (nofErrors>0) {
+    fprintf(stderr, "%d frames with wrong display content\n", nofErrors);
+    return 1;
+  }
+  return 0;
+}
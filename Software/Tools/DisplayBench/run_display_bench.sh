@@ -0,0 +1,22 @@
+#!/bin/sh
+# Builds the display benchmark with the update of the changed regions and with the full update,
+# runs both and reports the bytes saved on the I2C bus for the menu and each screen.
+# Usage: ./run_display_bench.sh [nofFrames]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include McuWait.h -I. -IStubs -I../RoboSim -I$R -I$M/src -I$M/config -I$M/config/fonts -I$M/fonts -I$M/FreeRTOS/Source/include"
+SRC="display_bench.c $R/LCD.c $R/LCDMenu.c $M/src/McuUtility.c $M/src/McuSSD1306.c $M/src/McuGDisplaySSD1306.c \
+  $M/src/McuFontDisplay.c $M/fonts/McuFontHelv08Normal.c $M/fonts/McuFontCour08Normal.c"
+
+gcc $CFLAGS -DMcuSSD1306_CONFIG_I2C_HEADER_FILE='"MockI2C.h"' -o $OUT/display_bench_dirty $SRC
+gcc $CFLAGS -DMcuSSD1306_CONFIG_I2C_HEADER_FILE='"MockI2C.h"' -DMcuSSD1306_CONFIG_PARTIAL_UPDATE=0 -o $OUT/display_bench_full $SRC
+$OUT/display_bench_full "$@" >$OUT/display_bench_full.txt
+$OUT/display_bench_dirty "$@" >$OUT/display_bench_dirty.txt
+cat $OUT/display_bench_full.txt $OUT/display_bench_dirty.txt
+echo "# saved"
+awk '!/^#/ && $1!="screen" {
+  if (FNR==NR) { full[$1] = $3 } else if (full[$1]>0) { printf("%-12s %7d%%\n", $1, 100-($3*100)/full[$1]) }
+}' $OUT/display_bench_full.txt $OUT/display_bench_dirty.txt
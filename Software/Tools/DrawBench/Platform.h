@@ -0,0 +1,18 @@
+/**
+ * \file
+ * \brief Host platform configuration for the drawing benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/LCDMenu.c.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_HAS_LCD_MENU    (1)
+#define PL_CONFIG_HAS_LCD_HEADER  (1)
+
+#endif /* SRC_PLATFORM_H_ */
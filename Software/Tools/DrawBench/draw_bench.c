@@ -0,0 +1,205 @@
+/**
+ * \file
+ * \brief Host benchmark for the drawing into the SSD1306 display buffer
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Renders the proximity and the sumo screen of RoboLib/LCD.c and the menu of RoboLib/LCDMenu.c
+ * (compiled unchanged) with changing values, and reports the time per frame. The I2C driver is a
+ * no-op, so the time is spent in the drawing and the compare of the dirty update. A checksum of the
+ * rendered frames allows to compare the output of two builds.
+ * Build it twice, with the page blits (default) and with the pixel path
+ * (-DMcuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT=0 -DMcuFontDisplay_CONFIG_USE_GLYPH_BLIT=0),
+ * run_draw_bench.sh does this and compares the two.
+ *
+ * Build: gcc -O2 -include McuWait.h -I. -I../DisplayBench -I../../McuLib/src -I../../McuLib/config -I../../McuLib/config/fonts
+ *          -I../../McuLib/fonts -I../../RoboLib -DMcuSSD1306_CONFIG_I2C_HEADER_FILE='"MockI2C.h"' -o draw_bench draw_bench.c
+ *          ../../RoboLib/LCDMenu.c ../../McuLib/src/McuSSD1306.c ../../McuLib/src/McuGDisplaySSD1306.c
+ *          ../../McuLib/src/McuFontDisplay.c ../../McuLib/fonts/McuFontHelv08Normal.c
+ * Usage: draw_bench [nofFrames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "MockI2C.h"
+#include "LCDMenu.h"
+#include "McuSSD1306.h"
+#include "McuGDisplaySSD1306.h"
+#include "McuFontDisplay.h"
+#include "McuFontHelv08Normal.h"
+
+#define GET_FONT()        McuFontHelv08Normal_GetFont()
+#define GET_FONT_FIXED()  GET_FONT() /* same as on the target */
+
+MockI2C_Counters MockI2C_counters;
+
+uint8_t McuGenericI2C_WriteByteAddress8(uint8_t i2cAddr, uint8_t memAddr, uint8_t data) {
+  (void)i2cAddr; (void)memAddr; (void)data;
+  return 0;
+}
+
+uint8_t McuGenericI2C_WriteAddress(uint8_t i2cAddr, uint8_t *memAddr, uint8_t memAddrSize, uint8_t *data, uint16_t dataSize) {
+  (void)i2cAddr; (void)memAddr; (void)memAddrSize; (void)data; (void)dataSize;
+  return 0;
+}
+
+static int frameNo; /* changes the values shown */
+
+/* ShowProxDataGraph() with the sensor bits of the frame */
+static void ShowProxDataGraph(McuFontDisplay_PixelDim x, McuFontDisplay_PixelDim y) {
+  #define LCD_PROX_BOX_HEIGHT   (8)
+  #define LCD_PROX_BOX_WIDTH    (10)
+  #define LCD_PROX_BOX_BORDER   (2)
+  int bits = frameNo*7;
+  int i;
+
+  for(i=0; i<6; i++) {
+    if (bits&(1<<i)) {
+      McuGDisplaySSD1306_DrawFilledBox(x, y, LCD_PROX_BOX_WIDTH, LCD_PROX_BOX_HEIGHT, McuGDisplaySSD1306_COLOR_BLUE);
+    } else {
+      McuGDisplaySSD1306_DrawBox(x, y, LCD_PROX_BOX_WIDTH, LCD_PROX_BOX_HEIGHT, 1, McuGDisplaySSD1306_COLOR_BLUE);
+    }
+    x += LCD_PROX_BOX_BORDER+LCD_PROX_BOX_WIDTH;
+    if (i==2) { /* gap between left and right sensors */
+      x += LCD_PROX_BOX_WIDTH;
+    }
+  }
+}
+
+/* ShowProximityScreen() */
+static void DrawProximity(void) {
+  McuFontDisplay_PixelDim x, y;
+  char buf[32];
+
+  McuGDisplaySSD1306_Clear();
+  McuGDisplaySSD1306_DrawBox(0, 0, McuGDisplaySSD1306_GetWidth(), McuGDisplaySSD1306_GetHeight(), 1, McuGDisplaySSD1306_COLOR_BLUE);
+  x = 2; y = 2;
+  McuFontDisplay_WriteString((uint8_t*)"Proximity:\n", McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT());
+  if (frameNo%4!=0) {
+    snprintf(buf, sizeof(buf), "Target: yes, at %d\n", (frameNo*13)%180-90);
+  } else {
+    snprintf(buf, sizeof(buf), "Target: no\n");
+  }
+  x = 2;
+  y = LCDMENU_CONFIG_LCD_HEADER_HEIGHT;
+  McuFontDisplay_WriteString((uint8_t*)buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+  snprintf(buf, sizeof(buf), "L#: %d, %d, %d R#: %d, %d, %d\n", frameNo%5, frameNo%7, frameNo%3, frameNo%4, frameNo%6, frameNo%2);
+  x = 2;
+  McuFontDisplay_WriteString((uint8_t*)buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+  ShowProxDataGraph(x, y);
+  McuGDisplaySSD1306_UpdateDirty();
+}
+
+/* ShowSumoScreen() */
+static void DrawSumo(void) {
+  McuFontDisplay_PixelDim x, y;
+  char buf[24];
+
+  McuGDisplaySSD1306_Clear();
+  McuGDisplaySSD1306_DrawBox(0, 0, McuGDisplaySSD1306_GetWidth(), McuGDisplaySSD1306_GetHeight(), 1, McuGDisplaySSD1306_COLOR_BLUE);
+  x = 2; y = 2;
+  McuFontDisplay_WriteString((uint8_t*)"Sumo:\n", McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT());
+  x = 2;
+  y = LCDMENU_CONFIG_LCD_HEADER_HEIGHT;
+  if (frameNo%2==0) {
+    snprintf(buf, sizeof(buf), "Countdown: %d\n", 5000-(frameNo*50)%5000);
+    McuFontDisplay_WriteString((uint8_t*)buf, McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+  } else {
+    McuFontDisplay_WriteString((uint8_t*)"Running Sumo....\nPress button to abort.", McuGDisplaySSD1306_COLOR_BLUE, &x, &y, GET_FONT_FIXED());
+  }
+  x = 2;
+  ShowProxDataGraph(x, y);
+  McuGDisplaySSD1306_UpdateDirty();
+}
+
+/* robot menu of LCD.c, in the root group so the cursor can move over all items */
+static LCDMenu_StatusFlags HeaderHandler(const struct LCDMenu_MenuItem_ *item, LCDMenu_EventType event, void **dataP) {
+  static char buf[16];
+
+  (void)item;
+  if (event==LCDMENU_EVENT_GET_HEADER_TEXT && dataP!=NULL) {
+    snprintf(buf, sizeof(buf), "Robot %d", frameNo%100);
+    *dataP = buf;
+    return LCDMENU_STATUS_FLAGS_HANDLED;
+  }
+  return LCDMENU_STATUS_FLAGS_NONE;
+}
+
+static const LCDMenu_MenuItem menus[] = {
+  {1, LCDMENU_GROUP_ROOT, 0, LCDMENU_ID_NONE, LCDMENU_ID_NONE, "BACK",                   HeaderHandler, LCDMENU_MENU_FLAGS_NONE},
+  {2, LCDMENU_GROUP_ROOT, 1, LCDMENU_ID_NONE, LCDMENU_ID_NONE, "Start Sumo",             HeaderHandler, LCDMENU_MENU_FLAGS_NONE},
+  {3, LCDMENU_GROUP_ROOT, 2, LCDMENU_ID_NONE, 9,               "Encoder",                HeaderHandler, LCDMENU_MENU_FLAGS_NONE},
+  {4, LCDMENU_GROUP_ROOT, 3, LCDMENU_ID_NONE, LCDMENU_ID_NONE, "Reflectance",            HeaderHandler, LCDMENU_MENU_FLAGS_NONE},
+  {5, LCDMENU_GROUP_ROOT, 4, LCDMENU_ID_NONE, LCDMENU_ID_NONE, "Start Line Calibration", HeaderHandler, LCDMENU_MENU_FLAGS_NONE},
+  {6, LCDMENU_GROUP_ROOT, 5, LCDMENU_ID_NONE, LCDMENU_ID_NONE, "Proximity",              HeaderHandler, LCDMENU_MENU_FLAGS_NONE},
+  {7, LCDMENU_GROUP_ROOT, 6, LCDMENU_ID_NONE, LCDMENU_ID_NONE, "Timing",                 HeaderHandler, LCDMENU_MENU_FLAGS_NONE},
+};
+
+/* LCDMenu_Draw() with the selection moving over the visible items */
+static void DrawMenu(void) {
+  LCDMenu_InitMenu(menus, sizeof(menus)/sizeof(menus[0]), (uint8_t)(1+frameNo%3));
+  LCDMenu_OnEvent(LCDMENU_EVENT_DRAW, NULL);
+}
+
+typedef void (*DrawFn)(void);
+
+static const struct {
+  const char *name;
+  DrawFn draw;
+} screens[] = {
+  {"proximity", DrawProximity},
+  {"sumo", DrawSumo},
+  {"menu", DrawMenu},
+};
+
+/* FNV-1a over the display buffer */
+static uint32_t Checksum(uint32_t hash) {
+  const uint8_t *p = &McuSSD1306_DisplayBuf[0][0];
+  size_t i;
+
+  for(i=0; i<sizeof(McuSSD1306_DisplayBuf); i++) {
+    hash = (hash^p[i])*16777619u;
+  }
+  return hash;
+}
+
+static double NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec*1e9+(double)ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+  int nofFrames = 20000;
+  size_t i;
+  double start, ns;
+  uint32_t hash;
+
+  if (argc>1) {
+    nofFrames = atoi(argv[1]);
+  }
+  if (nofFrames<=0) {
+    fprintf(stderr, "usage: %s [nofFrames]\n", argv[0]);
+    return 1;
+  }
+  McuSSD1306_Init();
+  McuGDisplaySSD1306_Init();
+  printf("# %s\n", McuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT ? "page blits" : "pixel path");
+  printf("%-12s %12s %10s\n", "screen", "ns/frame", "checksum");
+  for(i=0; i<sizeof(screens)/sizeof(screens[0]); i++) {
+    hash = 2166136261u;
+    for(frameNo=0; frameNo<16; frameNo++) { /* checksum of a few frames, also warms up */
+      screens[i].draw();
+      hash = Checksum(hash);
+    }
+    start = NowNs();
+    for(frameNo=0; frameNo<nofFrames; frameNo++) {
+      screens[i].draw();
+    }
+    ns = (NowNs()-start)/nofFrames;
+    printf("%-12s %12.0f   %08lx\n", screens[i].name, ns, (unsigned long)hash);
+  }
+  return 0;
+}
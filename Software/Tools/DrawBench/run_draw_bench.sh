@@ -0,0 +1,20 @@
+#!/bin/sh
+# Builds the drawing benchmark with the pixel path and with the page blits, runs both and
+# checks that they render the same frames.
+# Usage: ./run_draw_bench.sh [nofFrames]
+set -e
+cd "$(dirname "$0")"
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include McuWait.h -I. -I../DisplayBench -I$M/src -I$M/config -I$M/config/fonts -I$M/fonts -I../../RoboLib"
+SRC="draw_bench.c ../../RoboLib/LCDMenu.c $M/src/McuSSD1306.c $M/src/McuGDisplaySSD1306.c $M/src/McuFontDisplay.c $M/fonts/McuFontHelv08Normal.c"
+
+gcc $CFLAGS -DMcuSSD1306_CONFIG_I2C_HEADER_FILE='"MockI2C.h"' \
+  -DMcuGDisplaySSD1306_CONFIG_USE_PAGE_BLIT=0 -DMcuFontDisplay_CONFIG_USE_GLYPH_BLIT=0 -o $OUT/draw_bench_pixel $SRC
+gcc $CFLAGS -DMcuSSD1306_CONFIG_I2C_HEADER_FILE='"MockI2C.h"' -o $OUT/draw_bench_blit $SRC
+$OUT/draw_bench_pixel "$@" | tee $OUT/draw_bench_pixel.txt
+$OUT/draw_bench_blit "$@" | tee $OUT/draw_bench_blit.txt
+if [ "$(awk '!/^#/{print $1, $3}' $OUT/draw_bench_pixel.txt)" != "$(awk '!/^#/{print $1, $3}' $OUT/draw_bench_blit.txt)" ]; then
+  echo "different frames rendered" >&2
+  exit 1
+fi
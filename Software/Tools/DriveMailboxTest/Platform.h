@@ -0,0 +1,39 @@
+/**
+ * \file
+ * \brief Host platform configuration for the drive mailbox test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Drive.c: drive task with tacho, speed
+ * and position PID, without the shell and the logging modules. With -DPL_CONFIG_HAS_EXEC=1 the
+ * control runs in the control stage of an executive emulated by the test instead of the drive task.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (1)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (0)
+#define PL_CONFIG_HAS_DLOG           (0)
+#define PL_CONFIG_HAS_CRITSEC        (0)
+#ifndef PL_CONFIG_HAS_EXEC
+  #define PL_CONFIG_HAS_EXEC         (0)
+#endif
+#define PL_CONFIG_HAS_MOTOR          (1)
+#define PL_CONFIG_HAS_QUADRATURE     (1)
+#define PL_CONFIG_HIGH_RES_ENCODER   (1)
+#define PL_CONFIG_HAS_MOTOR_TACHO    (1)
+#define PL_CONFIG_HAS_PID            (1)
+#define PL_CONFIG_HAS_SPEED_PID      (1)
+#define PL_CONFIG_HAS_POS_PID        (1)
+#define PL_CONFIG_HAS_DRIVE          (1)
+#define PL_CONFIG_HAS_ODOMETRY       (0)
+#define PL_CONFIG_HAS_TELEMETRY      (0)
+#define PL_CONFIG_HAS_RECORDER       (0)
+#define PL_CONFIG_HAS_CONFIG_NVM     (0)
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,64 @@
+/**
+ * \file
+ * \brief Host stubs of FreeRTOS, the cycle counter and the critical section for the drive mailbox test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of FreeRTOS.h,
+ * McuArmTools.h, McuWait.h and McuCriticalSection.h, so RoboLib/Drive.c is compiled unchanged. Only
+ * the part of the RTOS used by the drive task is there: tasks are threads started by
+ * SIM_StartScheduler(), the tick is the monotonic clock in milliseconds, and critical sections lock
+ * one recursive mutex. The functions are implemented in drive_mailbox_test.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define INC_FREERTOS_H
+#define __McuArmTools_H
+#define __McuWait_H
+#define __McuCriticalSection_H
+
+/* FreeRTOS */
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+typedef long BaseType_t;
+typedef struct SIM_Task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define configCPU_CLOCK_HZ     (64000000) /* the cycle counter runs with this clock */
+#define portTICK_PERIOD_MS     (1)
+#define pdMS_TO_TICKS(ms)      ((TickType_t)(ms))
+#define pdTRUE                 (1)
+#define pdFALSE                (0)
+#define pdPASS                 (1)
+#define tskIDLE_PRIORITY       (0)
+#define taskENTER_CRITICAL()   SIM_EnterCritical()
+#define taskEXIT_CRITICAL()    SIM_ExitCritical()
+
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskCreate(TaskFunction_t fct, const char *name, uint32_t stackDepth, void *param, uint32_t prio, TaskHandle_t *handle);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+/* McuArmTools */
+#define McuArmTools_InitCycleCounter()    /* nothing */
+#define McuArmTools_EnableCycleCounter()  /* nothing */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+/* McuWait */
+void McuWait_WaitOSms(uint16_t ms);
+
+/* McuCriticalSection */
+#define McuCriticalSection_CriticalVariable()  /* nothing needed */
+#define McuCriticalSection_EnterCritical()     SIM_EnterCritical()
+#define McuCriticalSection_ExitCritical()      SIM_ExitCritical()
+
+void SIM_EnterCritical(void);
+void SIM_ExitCritical(void);
+
+/*! \brief Starts the threads of the tasks created so far. */
+void SIM_StartScheduler(void);
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,434 @@
+/**
+ * \file
+ * \brief Host test of the setpoint mailbox of the drive task
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Drive.c (compiled unchanged) with the drive task as a thread. The PID stubs record
+ * the setpoints which reach the PWM, with the time. With PL_CONFIG_HAS_EXEC, the thread is a
+ * minimal executive instead: a 1 ms cycle which runs DRV_Control() every 5 cycles, and
+ * DRV_ApplyCmds() in the next cycle if a command has requested the control stage (EXEC_RequestStage()).
+ * - order: commands posted before the task runs. A move replaced by a mode is cancelled by the
+ *   caller and never started, a position after a move cancels the move in the drive task.
+ * - bursts: the main thread posts bursts of speed setpoints with increasing values, with random
+ *   pauses. The applied values have to increase, the last value of each burst has to be applied,
+ *   and no value may reach the PWM later than one control period (5 ms) after it has been posted.
+ *   With the executive, the limit is the first cycle which starts after the value has been posted.
+ *   A setpoint applied between the control periods must not step the PIDs: there are no more PID
+ *   steps than control periods.
+ *
+ * Build: gcc -O2 -Wall -pthread -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src
+ *          -I../../McuLib/config -I../../McuLib/FreeRTOS/Source/include
+ *          -o drive_mailbox_test drive_mailbox_test.c ../../RoboLib/Drive.c
+ *        add -DPL_CONFIG_HAS_EXEC=1 for the executive.
+ * Usage: drive_mailbox_test [nofBursts]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "Platform.h"
+#include "Drive.h"
+#include "Pid.h"
+#include "Tacho.h"
+#include "Quadrature.h"
+#include "Motor.h"
+#if PL_CONFIG_HAS_EXEC
+  #include "Exec.h"
+#endif
+
+#define PERIOD_US        (5000) /* control period of the drive task */
+#define MAX_BURST        (8)    /* setpoints per burst */
+#define MAX_PAUSE_US     (7000) /* between the bursts */
+#define MAX_VALUES       (1u<<20)
+#define EXEC_CYCLE_US    (1000) /* EXEC_CONFIG_CYCLE_US */
+#define EXEC_CONTROL_RATE (5)   /* EXEC_CONFIG_CONTROL_RATE */
+
+/*------------------------------------------------------------------------------------------------*/
+/* RTOS stubs */
+struct SIM_Task {
+  TaskFunction_t fct;
+  void *param;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t notify;
+};
+
+static struct SIM_Task simTask; /* only the drive task, not used with the executive */
+static bool simTaskCreated;
+static pthread_mutex_t simCritical;
+static struct timespec simStart;
+
+static uint64_t NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)(ts.tv_sec-simStart.tv_sec)*1000000000ull+(uint64_t)ts.tv_nsec-(uint64_t)simStart.tv_nsec;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)(NowNs()/1000000u);
+}
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return (uint32_t)(NowNs()*(configCPU_CLOCK_HZ/1000000)/1000u);
+}
+
+void McuWait_WaitOSms(uint16_t ms) {
+  struct timespec ts = {ms/1000, (ms%1000)*1000000L};
+
+  nanosleep(&ts, NULL);
+}
+
+void SIM_EnterCritical(void) {
+  pthread_mutex_lock(&simCritical);
+}
+
+void SIM_ExitCritical(void) {
+  pthread_mutex_unlock(&simCritical);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fct, const char *name, uint32_t stackDepth, void *param, uint32_t prio, TaskHandle_t *handle) {
+  pthread_condattr_t attr;
+
+  (void)name; (void)stackDepth; (void)prio;
+  if (simTaskCreated) {
+    return pdFALSE;
+  }
+  simTask.fct = fct;
+  simTask.param = param;
+  simTask.notify = 0;
+  pthread_mutex_init(&simTask.lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); /* the timeouts of ulTaskNotifyTake() */
+  pthread_cond_init(&simTask.cond, &attr);
+  simTaskCreated = true;
+  if (handle!=NULL) {
+    *handle = &simTask;
+  }
+  return pdPASS;
+}
+
+#if !PL_CONFIG_HAS_EXEC
+static void *SimTaskThread(void *arg) {
+  struct SIM_Task *task = (struct SIM_Task*)arg;
+
+  task->fct(task->param);
+  return NULL;
+}
+#endif
+
+#if PL_CONFIG_HAS_EXEC
+static atomic_uint execRequests; /* stages requested out of their rate */
+static atomic_uint execCycle;    /* number of the running cycle */
+
+void EXEC_RequestStage(EXEC_Stage stage) {
+  atomic_fetch_or(&execRequests, 1u<<stage);
+}
+
+/* the control stage of EXEC_RunCycle(), the other stages have no effect on the drive */
+static void *ExecThread(void *arg) {
+  struct timespec next;
+  uint8_t countdown = 1;
+
+  (void)arg;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for(;;) {
+    next.tv_nsec += EXEC_CYCLE_US*1000L;
+    if (next.tv_nsec>=1000000000L) {
+      next.tv_nsec -= 1000000000L;
+      next.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL); /* released by the cycle timer */
+    atomic_fetch_add(&execCycle, 1);
+    if (countdown>1) {
+      countdown--;
+      if ((atomic_fetch_and(&execRequests, ~(1u<<EXEC_STAGE_CONTROL))&(1u<<EXEC_STAGE_CONTROL))!=0) {
+        DRV_ApplyCmds(); /* requested run, the rate stays */
+      }
+    } else {
+      atomic_fetch_and(&execRequests, ~(1u<<EXEC_STAGE_CONTROL));
+      countdown = EXEC_CONTROL_RATE;
+      DRV_Control();
+    }
+  }
+  return NULL;
+}
+#endif
+
+void SIM_StartScheduler(void) {
+#if PL_CONFIG_HAS_EXEC
+  pthread_t thread;
+
+  pthread_create(&thread, NULL, ExecThread, NULL);
+#else
+  if (simTaskCreated) {
+    pthread_create(&simTask.thread, NULL, SimTaskThread, &simTask);
+  }
+#endif
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  struct SIM_Task *task = &simTask; /* the only task which waits */
+  uint64_t endNs;
+  struct timespec ts;
+  uint32_t value;
+
+  endNs = (uint64_t)(xTaskGetTickCount()+ticksToWait)*1000000u; /* timeouts end at a tick */
+  endNs += (uint64_t)simStart.tv_sec*1000000000ull+(uint64_t)simStart.tv_nsec;
+  ts.tv_sec = (time_t)(endNs/1000000000u);
+  ts.tv_nsec = (long)(endNs%1000000000u);
+  pthread_mutex_lock(&task->lock);
+  while (task->notify==0) {
+    if (pthread_cond_timedwait(&task->cond, &task->lock, &ts)==ETIMEDOUT) {
+      break;
+    }
+  }
+  value = task->notify;
+  if (clearOnExit) {
+    task->notify = 0;
+  } else if (value>0) {
+    task->notify--;
+  }
+  pthread_mutex_unlock(&task->lock);
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  pthread_mutex_lock(&task->lock);
+  task->notify++;
+  pthread_cond_signal(&task->cond);
+  pthread_mutex_unlock(&task->lock);
+  return pdPASS;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* stubs of the control path, called by the drive task */
+static uint64_t *postedNs;           /* time each speed value has been posted */
+#if PL_CONFIG_HAS_EXEC
+static uint32_t *postedCycle;        /* cycle running when each speed value has been posted */
+#endif
+static atomic_int appliedSpeed = -1; /* latest speed value which reached the PWM */
+static atomic_uint nofPidPos, nofCancelled, nofMoveDone;
+static atomic_uint nofPidSteps;      /* PID_Speed() calls which step the left PID */
+static uint32_t nofApplied, nofOrderErrors, nofLate;
+static uint64_t maxLatencyNs, sumLatencyNs;
+
+void PID_Speed(int32_t currSpeed, int32_t setSpeed, bool isLeft, bool step) {
+  uint64_t ns;
+  int prev;
+
+  (void)currSpeed;
+  if (isLeft && step) {
+    atomic_fetch_add(&nofPidSteps, 1);
+  }
+  if (!isLeft || setSpeed<0 || (uint32_t)setSpeed>=MAX_VALUES) {
+    return;
+  }
+  prev = atomic_load(&appliedSpeed);
+  if (setSpeed==prev) {
+    return; /* same setpoint as in the previous control step */
+  }
+  if (setSpeed<prev) {
+    nofOrderErrors++; /* an older setpoint after a newer one */
+  }
+  ns = NowNs()-postedNs[setSpeed];
+  if (ns>maxLatencyNs) {
+    maxLatencyNs = ns;
+  }
+#if PL_CONFIG_HAS_EXEC
+  if (atomic_load(&execCycle)>postedCycle[setSpeed]+1) {
+    nofLate++; /* not in the next cycle */
+  }
+#else
+  if (ns>PERIOD_US*1000ull) {
+    nofLate++;
+  }
+#endif
+  sumLatencyNs += ns;
+  nofApplied++;
+  atomic_store(&appliedSpeed, setSpeed);
+}
+
+void PID_Pos(int32_t currPos, int32_t setPos, bool isLeft, bool step) {
+  (void)currPos; (void)setPos; (void)isLeft; (void)step;
+  atomic_fetch_add(&nofPidPos, 1);
+}
+
+void PID_Start(void) {
+}
+
+uint8_t PID_GetPIDConfig(PID_ConfigType config, PID_Config **confP) {
+  static PID_Config posConfig[2]; /* moves switch the position PIDs to their settings */
+
+  if (config!=PID_CONFIG_POS_LEFT && config!=PID_CONFIG_POS_RIGHT) {
+    return ERR_FAILED;
+  }
+  *confP = &posConfig[config==PID_CONFIG_POS_LEFT?0:1];
+  return ERR_OK;
+}
+
+void PID_ConfigChanged(PID_Config *config) {
+  (void)config;
+}
+
+int32_t TACHO_GetSpeed(bool isLeft) {
+  (void)isLeft;
+  return 0;
+}
+
+void TACHO_CalcSpeed(void) {
+}
+
+QUAD_QuadCntrType QUAD_GetLeftPos(void) {
+  return 0;
+}
+
+QUAD_QuadCntrType QUAD_GetRightPos(void) {
+  return 0;
+}
+
+MOT_MotorDevice *MOT_GetMotorHandle(MOT_MotorSide side) {
+  (void)side;
+  return NULL;
+}
+
+void MOT_SetSpeedPercent(MOT_MotorDevice *motor, MOT_SpeedPercent percent) {
+  (void)motor; (void)percent; /* the wheels stand still: moves do not brake */
+}
+
+static void MoveDone(DRV_MoveResult result) {
+  if (result==DRV_MOVE_CANCELLED) {
+    atomic_fetch_add(&nofCancelled, 1);
+  } else {
+    atomic_fetch_add(&nofMoveDone, 1);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void SleepUs(uint32_t us) {
+  struct timespec ts = {us/1000000, (long)(us%1000000)*1000L};
+
+  nanosleep(&ts, NULL);
+}
+
+static int Check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    return 1;
+  }
+  return 0;
+}
+
+static int TestOrder(void) {
+  int32_t left, right;
+  int errors = 0;
+
+  /* the drive task does not run yet */
+  errors += Check(DRV_StartMove(1000, 1000, MoveDone)==ERR_OK, "order: move posted");
+  errors += Check(DRV_SetMode(DRV_MODE_SPEED)==ERR_OK, "order: mode posted");
+  errors += Check(atomic_load(&nofCancelled)==1, "order: replaced move cancelled by the caller");
+  postedNs[0] = NowNs();
+#if PL_CONFIG_HAS_EXEC
+  postedCycle[0] = 0;
+#endif
+  (void)DRV_SetSpeed(0, 0);
+  SIM_StartScheduler();
+  SleepUs(3*PERIOD_US);
+  errors += Check(DRV_GetMode()==DRV_MODE_SPEED, "order: speed mode");
+  errors += Check(atomic_load(&nofPidPos)==0, "order: replaced move never started");
+  errors += Check(atomic_load(&appliedSpeed)==0, "order: speed applied");
+  /* a position posted after a move cancels it, whatever the drive task has taken in between */
+  (void)DRV_StartMove(400, 400, MoveDone);
+  (void)DRV_SetPos(50, 60);
+  SleepUs(3*PERIOD_US);
+  DRV_GetSetValues(&left, &right);
+  errors += Check(DRV_GetMode()==DRV_MODE_POS && left==50 && right==60, "order: position after the move");
+  errors += Check(atomic_load(&nofCancelled)==2 && atomic_load(&nofMoveDone)==0, "order: move cancelled by the position");
+  errors += Check(!DRV_IsMoving(), "order: no move running");
+  printf("order: %d failed\n", errors);
+  return errors;
+}
+
+static int TestBursts(uint32_t nofBursts) {
+  uint32_t rnd = 1, burst, i, n, value = 0, nofPosted = 0, nofMissed = 0;
+  uint32_t nofSteps, nofPeriods, burstSteps;
+  uint64_t startNs;
+  int errors = 0;
+
+  (void)DRV_SetMode(DRV_MODE_SPEED);
+  startNs = NowNs();
+  nofSteps = atomic_load(&nofPidSteps);
+  for(burst=0; burst<nofBursts && value+MAX_BURST<MAX_VALUES; burst++) {
+    rnd ^= rnd<<13; rnd ^= rnd>>17; rnd ^= rnd<<5;
+    n = 1+rnd%MAX_BURST;
+    for(i=0; i<n; i++) {
+      value++;
+      postedNs[value] = NowNs(); /* before the drive task can see it */
+#if PL_CONFIG_HAS_EXEC
+      postedCycle[value] = atomic_load(&execCycle);
+#endif
+      (void)DRV_SetSpeed((int32_t)value, (int32_t)value);
+      nofPosted++;
+    }
+    burstSteps = atomic_load(&nofPidSteps);
+    SleepUs(PERIOD_US+rnd%MAX_PAUSE_US); /* at least one control period */
+    while (atomic_load(&nofPidSteps)-burstSteps<2) { /* the host may delay the drive thread: wait for a full control period */
+      SleepUs(1000);
+    }
+    if (atomic_load(&appliedSpeed)!=(int)value) {
+      if (nofMissed<10) {
+        printf("FAILED: bursts: %d applied instead of %u\n", atomic_load(&appliedSpeed), value);
+      }
+      nofMissed++;
+    }
+  }
+  nofSteps = atomic_load(&nofPidSteps)-nofSteps;
+  nofPeriods = (uint32_t)((NowNs()-startNs)/(PERIOD_US*1000ull));
+  errors = (int)(nofMissed+nofOrderErrors+nofLate);
+  errors += Check(nofSteps<=nofPeriods+1, "bursts: PID stepped in the control period only");
+  printf("bursts: %u bursts, %u setpoints posted, %u applied, %u replaced\n", burst, nofPosted, nofApplied, nofPosted-nofApplied);
+  printf("bursts: post to PWM mean %.1f us, max %.1f us (%s %u us), %u late, %u out of order, %u last missing\n",
+    nofApplied==0 ? 0.0 : sumLatencyNs/1000.0/nofApplied, maxLatencyNs/1000.0,
+    PL_CONFIG_HAS_EXEC ? "cycle" : "period", PL_CONFIG_HAS_EXEC ? EXEC_CYCLE_US : PERIOD_US,
+    nofLate, nofOrderErrors, nofMissed);
+  printf("bursts: %u PID steps in %u control periods\n", nofSteps, nofPeriods);
+  printf("bursts: %d failed\n", errors);
+  return errors;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t nofBursts = 2000;
+  pthread_mutexattr_t attr;
+  int errors = 0;
+
+  if (argc>1) {
+    nofBursts = strtoul(argv[1], NULL, 0);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &simStart);
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&simCritical, &attr);
+  postedNs = calloc(MAX_VALUES, sizeof(*postedNs));
+  if (postedNs==NULL) {
+    return 1;
+  }
+#if PL_CONFIG_HAS_EXEC
+  postedCycle = calloc(MAX_VALUES, sizeof(*postedCycle));
+  if (postedCycle==NULL) {
+    return 1;
+  }
+  printf("drive mailbox test: executive, control stage every %u cycles of %u us\n", EXEC_CONTROL_RATE, EXEC_CYCLE_US);
+#else
+  printf("drive mailbox test: drive task, period %u us\n", PERIOD_US);
+#endif
+  DRV_Init();
+  errors += TestOrder();
+  errors += TestBursts(nofBursts);
+  printf("%d failed\n", errors);
+  return errors==0 ? 0 : 1;
+}
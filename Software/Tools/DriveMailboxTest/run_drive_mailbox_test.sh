@@ -0,0 +1,15 @@
+#!/bin/sh
+# Builds and runs the drive command mailbox test, with the Drive task and with the executive.
+# Usage: ./run_drive_mailbox_test.sh [nofBursts]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -pthread -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/FreeRTOS/Source/include"
+SRC="drive_mailbox_test.c $R/Drive.c"
+
+gcc $CFLAGS -o $OUT/drive_mailbox_test_task $SRC
+gcc $CFLAGS -DPL_CONFIG_HAS_EXEC=1 -o $OUT/drive_mailbox_test_exec $SRC
+$OUT/drive_mailbox_test_task "$@"
+$OUT/drive_mailbox_test_exec "$@"
@@ -0,0 +1,23 @@
+/**
+ * \file
+ * \brief Host platform configuration for the event test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Event.c: events only, without keys
+ * and without FreeRTOS, with additional application events for the test.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+
+#define PL_CONFIG_USE_FREERTOS       (0)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_KEYS           (0)
+#define PL_CONFIG_HAS_EVENTS         (1)
+
+#define EVNT_CONFIG_NOF_APP_EVENTS   (47) /* with EVNT_STARTUP two memory units */
+
+#endif /* SRC_PLATFORM_H_ */
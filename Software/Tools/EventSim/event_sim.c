@@ -0,0 +1,291 @@
+/**
+ * \file
+ * \brief Host test and benchmark of the event module
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Event.c (compiled unchanged) on the host. Threads take the role of the interrupts
+ * which set events, the main thread is the task which handles them. The bookkeeping of the test
+ * uses C11 atomics.
+ * - priority: random sets of events have to be handled in the order of their number.
+ * - set/handle: each 'interrupt' thread owns some events and sets one again after it has been
+ *   handled. The events share the memory units, so a lost update of a bit stops the test.
+ * - queue: the threads add values with EVNT_SetEventData(), which have to arrive in order per
+ *   thread, and received plus overflows has to be the number sent.
+ * - benchmark: time from EVNT_SetEvent() to the handler for the first and the last event, with a
+ *   copy of the former implementation (critical section and a scan of all events) for comparison.
+ *
+ * Build: gcc -O2 -Wall -pthread -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -o event_sim event_sim.c ../../RoboLib/Event.c
+ * Usage: event_sim [nofRounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "Platform.h"
+#include "Event.h"
+
+#define NOF_THREADS  (4)
+
+static atomic_ulong handled[EVNT_NOF_EVENTS]; /* handler calls per event */
+static atomic_ulong sent[EVNT_NOF_EVENTS];    /* EVNT_SetEvent() per event */
+static atomic_int stop;
+static unsigned long nofRounds = 200000;
+static EVNT_Handle lastHandled;
+
+static void Handler(EVNT_Handle event) {
+  lastHandled = event;
+  atomic_fetch_add_explicit(&handled[event], 1, memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static int TestPriority(void) {
+  uint32_t rnd = 1;
+  unsigned long round;
+  int e, expected, errors = 0;
+  bool set[EVNT_NOF_EVENTS];
+
+  EVNT_Init();
+  for(round=0; round<nofRounds/10; round++) {
+    for(e=0; e<EVNT_NOF_EVENTS; e++) {
+      rnd = rnd*1103515245u+12345u;
+      set[e] = (rnd>>16)%4==0;
+      if (set[e]) {
+        EVNT_SetEvent((EVNT_Handle)e);
+      }
+    }
+    expected = 0;
+    for(;;) {
+      while (expected<EVNT_NOF_EVENTS && !set[expected]) {
+        expected++;
+      }
+      lastHandled = EVNT_NOF_EVENTS;
+      EVNT_HandleEvent(Handler, TRUE);
+      if (lastHandled!=(EVNT_Handle)expected) {
+        if (errors<10) {
+          printf("FAILED: priority: event %d instead of %d\n", lastHandled, expected);
+        }
+        errors++;
+        break;
+      }
+      if (expected==EVNT_NOF_EVENTS) {
+        break; /* all handled, nothing pending */
+      }
+      expected++;
+    }
+  }
+  printf("priority: %lu rounds, %d failed\n", nofRounds/10, errors);
+  return errors;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* 'interrupt': sets each of its events again as soon as it has been handled */
+static void *SetThread(void *arg) {
+  int t = (int)(uintptr_t)arg, e;
+  unsigned long n = 0;
+
+  while (!atomic_load(&stop)) {
+    for(e=t; e<EVNT_NOF_EVENTS; e+=NOF_THREADS) {
+      if (atomic_load_explicit(&handled[e], memory_order_acquire)==atomic_load_explicit(&sent[e], memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&sent[e], 1, memory_order_relaxed);
+        EVNT_SetEvent((EVNT_Handle)e);
+      }
+    }
+    if (++n%64==0) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static int TestSetHandle(void) {
+  pthread_t threads[NOF_THREADS];
+  unsigned long total = 0, nofSent = 0;
+  int i, errors = 0;
+  struct timespec start, now;
+
+  EVNT_Init();
+  atomic_store(&stop, 0);
+  for(i=0; i<EVNT_NOF_EVENTS; i++) {
+    atomic_store(&handled[i], 0);
+    atomic_store(&sent[i], 0);
+  }
+  for(i=0; i<NOF_THREADS; i++) {
+    pthread_create(&threads[i], NULL, SetThread, (void*)(uintptr_t)i);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (total<nofRounds*10) {
+    lastHandled = EVNT_NOF_EVENTS;
+    EVNT_HandleEvent(Handler, TRUE);
+    if (lastHandled!=EVNT_NOF_EVENTS) {
+      total++;
+    } else {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if (now.tv_sec-start.tv_sec>20) { /* an event set by the threads got lost */
+        printf("FAILED: set/handle: no event after %lu handled\n", total);
+        errors++;
+        break;
+      }
+      sched_yield();
+    }
+  }
+  atomic_store(&stop, 1);
+  for(i=0; i<NOF_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  while (lastHandled=EVNT_NOF_EVENTS, EVNT_HandleEvent(Handler, TRUE), lastHandled!=EVNT_NOF_EVENTS) {
+  }
+  for(i=0; i<EVNT_NOF_EVENTS; i++) {
+    nofSent += atomic_load(&sent[i]);
+    if (atomic_load(&handled[i])!=atomic_load(&sent[i])) {
+      if (errors<10) {
+        printf("FAILED: set/handle: event %d set %lu, handled %lu\n", i, atomic_load(&sent[i]), atomic_load(&handled[i]));
+      }
+      errors++;
+    }
+  }
+  printf("set/handle: %d threads, %lu events set, %d failed\n", NOF_THREADS, nofSent, errors);
+  return errors;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static atomic_ulong queueSent[NOF_THREADS], queueOverflows[NOF_THREADS];
+
+/* 'interrupt': adds its sequence number as value of its event */
+static void *DataThread(void *arg) {
+  int t = (int)(uintptr_t)arg;
+  unsigned long n;
+
+  for(n=0; n<nofRounds; n++) {
+    if (EVNT_SetEventData((EVNT_Handle)(EVNT_APP_FIRST+t), (uint16_t)n)!=ERR_OK) {
+      atomic_fetch_add(&queueOverflows[t], 1);
+    }
+    atomic_fetch_add(&queueSent[t], 1);
+    if (n%4==0) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static int TestQueue(void) {
+  pthread_t threads[NOF_THREADS];
+  unsigned long received = 0, overflows = 0, done, nofSent;
+  uint32_t next[NOF_THREADS];
+  EVNT_Handle event;
+  uint16_t data;
+  int i, t, errors = 0;
+
+  EVNT_Init();
+  memset(next, 0, sizeof(next));
+  for(i=0; i<NOF_THREADS; i++) {
+    atomic_store(&queueSent[i], 0);
+    atomic_store(&queueOverflows[i], 0);
+    pthread_create(&threads[i], NULL, DataThread, (void*)(uintptr_t)i);
+  }
+  do {
+    done = 0;
+    for(i=0; i<NOF_THREADS; i++) {
+      done += atomic_load(&queueSent[i]);
+    }
+    while (EVNT_GetEventData(&event, &data)) {
+      t = event-EVNT_APP_FIRST;
+      if (t<0 || t>=NOF_THREADS || (uint16_t)(data-next[t])>=0x8000) { /* sequence has to increase, gaps are overflows */
+        if (errors<10) {
+          printf("FAILED: queue: event %d value %u\n", event, data);
+        }
+        errors++;
+      } else {
+        next[t] = (uint16_t)(data+1);
+      }
+      received++;
+    }
+    sched_yield();
+  } while (done<NOF_THREADS*nofRounds);
+  for(i=0; i<NOF_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  while (EVNT_GetEventData(&event, &data)) {
+    received++;
+  }
+  nofSent = (unsigned long)NOF_THREADS*nofRounds;
+  for(i=0; i<NOF_THREADS; i++) {
+    overflows += atomic_load(&queueOverflows[i]);
+  }
+  if (received+overflows!=nofSent) {
+    printf("FAILED: queue: %lu received, %lu overflows of %lu\n", received, overflows, nofSent);
+    errors++;
+  }
+  printf("queue: %lu values, %lu received, %lu overflows, %d failed\n", nofSent, received, overflows, errors);
+  return errors;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* former implementation: bit set changed in a critical section, HandleEvent() tests every event */
+static uint32_t LEG_Events[((EVNT_NOF_EVENTS-1)/32)+1];
+static pthread_mutex_t LEG_lock = PTHREAD_MUTEX_INITIALIZER; /* critical section */
+
+#define LEG_MASK(event)  ((1u<<31)>>((event)%32))
+
+static void LEG_SetEvent(EVNT_Handle event) {
+  pthread_mutex_lock(&LEG_lock);
+  LEG_Events[event/32] |= LEG_MASK(event);
+  pthread_mutex_unlock(&LEG_lock);
+}
+
+static void LEG_HandleEvent(void (*callback)(EVNT_Handle), bool clearEvent) {
+  EVNT_Handle event;
+
+  pthread_mutex_lock(&LEG_lock);
+  for (event=(EVNT_Handle)0; event<EVNT_NOF_EVENTS; event++) {
+    if (LEG_Events[event/32]&LEG_MASK(event)) {
+      if (clearEvent) {
+        LEG_Events[event/32] &= ~LEG_MASK(event);
+      }
+      break;
+    }
+  }
+  pthread_mutex_unlock(&LEG_lock);
+  if (event != EVNT_NOF_EVENTS) {
+    callback(event);
+  }
+}
+
+static double BenchNs(bool legacy, EVNT_Handle event) {
+  struct timespec start, end;
+  unsigned long i, n = nofRounds*10;
+
+  EVNT_Init();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(i=0; i<n; i++) {
+    if (legacy) {
+      LEG_SetEvent(event);
+      LEG_HandleEvent(Handler, TRUE);
+    } else {
+      EVNT_SetEvent(event);
+      EVNT_HandleEvent(Handler, TRUE);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((end.tv_sec-start.tv_sec)*1e9+(end.tv_nsec-start.tv_nsec))/n;
+}
+
+int main(int argc, char *argv[]) {
+  int errors = 0;
+
+  if (argc>1) {
+    nofRounds = strtoul(argv[1], NULL, 0);
+  }
+  printf("%d events\n", EVNT_NOF_EVENTS);
+  errors += TestPriority();
+  errors += TestSetHandle();
+  errors += TestQueue();
+  printf("set to handler, first event: scan %.1f ns, CLZ %.1f ns\n", BenchNs(TRUE, EVNT_STARTUP), BenchNs(FALSE, EVNT_STARTUP));
+  printf("set to handler, last event:  scan %.1f ns, CLZ %.1f ns\n", BenchNs(TRUE, EVNT_APP_LAST), BenchNs(FALSE, EVNT_APP_LAST));
+  printf("%d failed\n", errors);
+  return errors==0 ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the event module test with concurrent setters.
+# Usage: ./run_event_sim.sh [nofRounds]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -pthread -I. -I$R -I$M/src -I$M/config"
+SRC="event_sim.c $R/Event.c"
+
+gcc $CFLAGS -o $OUT/event_sim $SRC
+$OUT/event_sim "$@"
@@ -0,0 +1,588 @@
+/**
+ * \file
+ * \brief Host simulation of the sensor to motor latency, tasks versus executive
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Simulates the CPU of the robot in steps of 1 us: a preemptive scheduler with priorities and time
+ * slicing like FreeRTOS, the RTOS tick, the encoder pin interrupts of the edge decoder
+ * (QUAD_CONFIG_DECODER_EDGE) at the step rate of a fast forward move, the reflectance and
+ * proximity interrupts, and the tasks of the control path with their CPU times. Two layouts are compared:
+ * - tasks: RefTask every 10 ms (waits for the capture), ProxTask notified at the end of each 10 ms
+ *   proximity scan, SumoTask notified by both, DriveTask every 5 ms, which takes the commands of
+ *   the sumo task from its queue.
+ * - exec: the executive task released by its cycle timer (TIM6, not synchronized to the tick),
+ *   with the stages and rates of Exec.h. The
+ *   reflectance capture started in a cycle is collected in the next one, a drive command of the
+ *   plan stage runs the control stage in the same cycle. That requested run only applies the
+ *   command, the periodic control runs keep their 5 cycles for the PIDs.
+ * The robot crosses the border or sees the opponent at random times. For each event the time
+ * from the event, and from the sample which has seen it, to the PWM write of the reaction is
+ * measured. The CPU times are estimates, the structure of the layouts dominates the result. In the
+ * task layout RefTask and DriveTask are locked to the tick, so their phase after the startup
+ * decides the sample to PWM time.
+ *
+ * Build: gcc -O2 -Wall -o exec_sim exec_sim.c
+ * Usage: exec_sim [nofEvents]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TICK_US            (1000)  /* configTICK_RATE_HZ 1000 */
+#define ENC_L_PERIOD_US    (263)   /* one encoder edge per step, about 3800 steps/s */
+#define ENC_R_PERIOD_US    (291)   /* the wheels do not run exactly at the same speed */
+#define EXEC_PERIOD_US     (1000)  /* EXEC_CONFIG_CYCLE_US */
+#define EXEC_PHASE_US      (337)   /* TIM6 is not synchronized to the tick */
+#define SCAN_US            (10000) /* proximity scan: 10 slots of 1 ms, by the burst timer */
+#define SCAN_PHASE_US      (373)   /* the burst timer is not synchronized to the tick */
+#define REF_CAPTURE_US     (640)   /* discharge until the capture timeout (REF_TIMEOUT_TICKS) */
+
+/* CPU times in us */
+#define COST_TICK_ISR      (3)
+#define COST_ENC_ISR       (2)     /* EXTI: read both pins, table step */
+#define COST_EVENT_ISR     (3)     /* capture complete, end of scan */
+#define COST_REF_CHARGE    (25)    /* includes 20 us charging */
+#define COST_REF_FINISH    (20)    /* decode and publish */
+#define COST_LINE          (30)
+#define COST_PROX_CHECK    (5)
+#define COST_PROX_SCAN     (60)    /* decode, filter, publish, tracker */
+#define COST_TACHO         (5)
+#define COST_SUMO_IDLE     (15)
+#define COST_SUMO_EVENT    (60)    /* starts the maneuver, sends the drive command */
+#define COST_ESTIMATE      (40)    /* speed, odometry */
+#define COST_CONTROL       (50)    /* commands, PID, PWM */
+#define COST_RECORD        (30)
+
+#define EVENT_TIMEOUT_US   (200000)
+
+typedef enum {
+  LAYOUT_TASKS,
+  LAYOUT_EXEC,
+  NOF_LAYOUTS
+} Layout;
+
+typedef enum {
+  EVENT_BORDER,
+  EVENT_TARGET,
+  NOF_EVENTS
+} EventKind;
+
+static const char *const layoutNames[NOF_LAYOUTS] = {"tasks", "exec"};
+static const char *const eventNames[NOF_EVENTS] = {"border", "target"};
+
+/*------------------------------------------------------------------------------------------------*/
+/* scheduler */
+typedef struct Task {
+  const char *name;
+  int prio;
+  bool ready;
+  uint32_t seq;        /* order among the ready tasks of the same priority */
+  uint32_t work;       /* CPU time left in the current segment, 0: call onDone() when it runs */
+  void (*onDone)(struct Task *task); /* end of the segment: sets the next one or blocks */
+  uint32_t wakeTick;   /* blocked until this tick count, UINT32_MAX without timeout */
+  bool waitNotify;     /* blocked, a notification wakes it up */
+  uint32_t notify;     /* notification bits */
+} Task;
+
+#define MAX_TASKS  (4)
+static Task tasks[MAX_TASKS];
+static int nofTasks;
+static uint32_t seqCounter;
+static Task *running;      /* last task which got the CPU */
+static uint32_t now;       /* us */
+static uint32_t tickCount;
+static uint32_t isrBusy;   /* CPU time left in interrupts */
+static uint64_t busyUs, isrUs;
+
+static Task *NewTask(const char *name, int prio, void (*start)(Task *task)) {
+  Task *task = &tasks[nofTasks++];
+
+  memset(task, 0, sizeof(*task));
+  task->name = name;
+  task->prio = prio;
+  task->ready = true;
+  task->seq = seqCounter++;
+  task->onDone = start;
+  return task;
+}
+
+static void Run(Task *task, uint32_t work, void (*onDone)(Task *task)) {
+  task->work = work;
+  task->onDone = onDone;
+}
+
+static void Block(Task *task, uint32_t ticks, bool waitNotify, void (*onWake)(Task *task)) {
+  task->ready = false;
+  task->wakeTick = ticks==UINT32_MAX ? UINT32_MAX : tickCount+ticks;
+  task->waitNotify = waitNotify;
+  Run(task, 0, onWake);
+}
+
+static void Wake(Task *task) {
+  task->ready = true;
+  task->seq = seqCounter++; /* at the end of its priority */
+  task->waitNotify = false;
+}
+
+static void Notify(Task *task, uint32_t bits) {
+  task->notify |= bits;
+  if (!task->ready && task->waitNotify) {
+    Wake(task);
+  }
+}
+
+static Task *Pick(void) {
+  Task *best = NULL;
+  int i;
+
+  for(i=0; i<nofTasks; i++) {
+    if (tasks[i].ready && (best==NULL || tasks[i].prio>best->prio || (tasks[i].prio==best->prio && tasks[i].seq<best->seq))) {
+      best = &tasks[i];
+    }
+  }
+  return best;
+}
+
+static void OnTick(void) {
+  int i;
+
+  tickCount++;
+  for(i=0; i<nofTasks; i++) {
+    if (!tasks[i].ready && tasks[i].wakeTick==tickCount) {
+      Wake(&tasks[i]);
+    }
+  }
+  if (running!=NULL && running->ready) { /* time slicing */
+    for(i=0; i<nofTasks; i++) {
+      if (&tasks[i]!=running && tasks[i].ready && tasks[i].prio==running->prio) {
+        running->seq = seqCounter++;
+        break;
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* the robot */
+typedef struct {
+  uint32_t n, min, max;
+  uint64_t sum;
+} Stats;
+
+typedef struct {
+  EventKind kind;
+  uint32_t time;       /* border crossed or opponent in sight */
+  uint32_t sample;     /* sample which has seen it: start of the discharge, end of the scan */
+  bool detected;       /* a sensor task or stage has seen it */
+  bool active;
+} Event;
+
+static Layout layout;
+static uint32_t rnd = 1;
+static Event ev;
+static uint32_t nextEventTime;
+static Stats eventStats[NOF_EVENTS], sampleStats[NOF_EVENTS];
+static uint32_t nofMissed, nofDone;
+
+static bool refCapturing;         /* discharge running or not collected yet */
+static uint32_t refSampleTime;    /* start of the discharge */
+static uint32_t scanEnd;          /* end of the last complete proximity scan */
+static uint32_t scanHandled;      /* end of the last scan decoded */
+static bool cmdQueued, cmdTaken;  /* drive command of the reaction */
+
+static Task *refTask, *proxTask, *sumoTask, *driveTask, *execTask;
+
+#define SUMO_EVENT  (1<<0)
+
+static uint32_t Random(void) {
+  rnd ^= rnd<<13; rnd ^= rnd>>17; rnd ^= rnd<<5;
+  return rnd;
+}
+
+static void AddStats(Stats *stats, uint32_t us) {
+  if (stats->n==0 || us<stats->min) {
+    stats->min = us;
+  }
+  if (us>stats->max) {
+    stats->max = us;
+  }
+  stats->sum += us;
+  stats->n++;
+}
+
+static void NextEvent(void) {
+  ev.active = false;
+  nextEventTime = now+20000+Random()%30000;
+}
+
+/* the reflectance sample started at refSampleTime has been decoded */
+static bool RefSeesBorder(void) {
+  if (ev.active && !ev.detected && ev.kind==EVENT_BORDER && (int32_t)(refSampleTime-ev.time)>=0) {
+    ev.detected = true;
+    ev.sample = refSampleTime;
+    return true;
+  }
+  return false;
+}
+
+/* the scan which ended at scanEnd has been decoded */
+static bool ProxSeesTarget(void) {
+  if (ev.active && !ev.detected && ev.kind==EVENT_TARGET && (int32_t)(scanEnd-SCAN_US-ev.time)>=0) {
+    ev.detected = true;
+    ev.sample = scanEnd;
+    return true;
+  }
+  return false;
+}
+
+static void WritePwm(void) {
+  if (cmdTaken) {
+    cmdTaken = false;
+    AddStats(&eventStats[ev.kind], now-ev.time);
+    AddStats(&sampleStats[ev.kind], now-ev.sample);
+    nofDone++;
+    NextEvent();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* layout 'tasks' */
+static void RefStart(Task *task);
+
+static void RefDelay(Task *task) {
+  Block(task, 10, false, RefStart); /* vTaskDelay(10) */
+}
+
+static void RefFinished(Task *task) {
+  refCapturing = false;
+  if (RefSeesBorder()) {
+    Notify(sumoTask, SUMO_EVENT); /* SUMO_OnBorder() */
+  }
+  Run(task, COST_LINE, RefDelay);
+}
+
+static void RefCollect(Task *task) {
+  Run(task, COST_REF_FINISH, RefFinished);
+}
+
+static void RefCharged(Task *task) {
+  refSampleTime = now;
+  refCapturing = true;
+  Block(task, 2, true, RefCollect); /* REF_CAPTURE_WAIT_TICKS */
+}
+
+static void RefStart(Task *task) {
+  Run(task, COST_REF_CHARGE, RefCharged);
+}
+
+static void ProxWait(Task *task);
+
+static void ProxDone(Task *task) {
+  scanHandled = scanEnd;
+  if (ProxSeesTarget()) {
+    Notify(sumoTask, SUMO_EVENT); /* SUMO_OnTarget() */
+  }
+  ProxWait(task);
+}
+
+static void ProxScan(Task *task) {
+  Run(task, COST_PROX_SCAN, ProxDone);
+}
+
+static void ProxWait(Task *task) {
+  Block(task, UINT32_MAX, true, ProxScan);
+}
+
+static void SumoWait(Task *task);
+
+static void SumoDone(Task *task) {
+  if (task->notify&SUMO_EVENT) {
+    cmdQueued = true; /* DRV_SendCmd(), the drive task is waiting for its period */
+  }
+  task->notify = 0;
+  SumoWait(task);
+}
+
+static void SumoRun(Task *task) {
+  Run(task, (task->notify&SUMO_EVENT) ? COST_SUMO_EVENT : COST_SUMO_IDLE, SumoDone);
+}
+
+static void SumoWait(Task *task) {
+  Block(task, 50, true, SumoRun); /* SUMO_IDLE_PERIOD_MS */
+}
+
+static uint32_t driveLastWake;
+static void DriveStart(Task *task);
+
+static void DriveDelay(Task *task) {
+  driveLastWake += 5; /* vTaskDelayUntil() */
+  Block(task, driveLastWake-tickCount, false, DriveStart);
+}
+
+static void DriveControlled(Task *task) {
+  WritePwm();
+  Run(task, COST_RECORD, DriveDelay);
+}
+
+static void DriveStart(Task *task) {
+  if (cmdQueued) {
+    cmdQueued = false;
+    cmdTaken = true;
+  }
+  Run(task, COST_ESTIMATE+COST_CONTROL, DriveControlled);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* layout 'exec', stages and rates as in Exec.h */
+#define EXEC_STAGE_SENSE     (0)
+#define EXEC_STAGE_ESTIMATE  (1)
+#define EXEC_STAGE_PLAN      (2)
+#define EXEC_STAGE_CONTROL   (3)
+#define EXEC_STAGE_RECORD    (4)
+#define EXEC_NOF_STAGES      (5)
+
+static const uint8_t execRates[EXEC_NOF_STAGES] = {1, 5, 1, 5, 5};
+static uint8_t execCountdown[EXEC_NOF_STAGES];
+static uint32_t execRequests;
+static int execStage;
+static bool execSumoEvent, execScanNew;
+static uint32_t execNofMissed, execMaxCycleUs, execReleaseTime;
+static uint32_t execNofCycles, execLastControlCycle; /* releases, and the one of the last periodic control run */
+static uint32_t execNofRequestedRuns, execNofIrregular; /* control runs out of the rate, periodic runs not 5 cycles apart */
+
+static void ExecNextStage(Task *task);
+
+static void ExecWait(Task *task) {
+  uint32_t us = now-execReleaseTime;
+
+  if (us>execMaxCycleUs) {
+    execMaxCycleUs = us;
+  }
+  task->notify = 0;
+  Block(task, UINT32_MAX, true, ExecNextStage);
+  execStage = -1;
+}
+
+static void ExecStageDone(Task *task) {
+  switch(execStage) {
+    case EXEC_STAGE_SENSE:
+      if (execScanNew) { /* PROX_Process() */
+        scanHandled = scanEnd;
+        if (ProxSeesTarget()) {
+          execSumoEvent = true;
+        }
+      }
+      if (refCapturing && RefSeesBorder()) { /* REF_Sample() collects the previous capture */
+        execSumoEvent = true;
+      }
+      refSampleTime = now; /* and starts the next one */
+      refCapturing = true;
+      break;
+    case EXEC_STAGE_PLAN:
+      if (execSumoEvent) {
+        execSumoEvent = false;
+        cmdQueued = true;
+        execRequests |= 1u<<EXEC_STAGE_CONTROL; /* DRV_SendCmd() */
+      }
+      break;
+    case EXEC_STAGE_CONTROL:
+      WritePwm();
+      break;
+    default:
+      break;
+  }
+  ExecNextStage(task);
+}
+
+static void ExecNextStage(Task *task) {
+  uint32_t cost = 0;
+
+  for(;;) {
+    execStage++;
+    if (execStage==EXEC_NOF_STAGES) {
+      ExecWait(task);
+      return;
+    }
+    if (execCountdown[execStage]>1) {
+      execCountdown[execStage]--;
+      if ((execRequests&(1u<<execStage))==0) {
+        continue;
+      }
+      execRequests &= ~(1u<<execStage);
+      if (execStage==EXEC_STAGE_CONTROL) {
+        execNofRequestedRuns++; /* between the periods, the rate stays */
+      }
+      break;
+    }
+    execRequests &= ~(1u<<execStage);
+    execCountdown[execStage] = execRates[execStage];
+    if (execStage==EXEC_STAGE_CONTROL) {
+      if (execLastControlCycle!=0 && execNofCycles-execLastControlCycle!=execRates[EXEC_STAGE_CONTROL]) {
+        execNofIrregular++;
+      }
+      execLastControlCycle = execNofCycles;
+    }
+    break;
+  }
+  switch(execStage) {
+    case EXEC_STAGE_SENSE:
+      execScanNew = scanEnd!=scanHandled;
+      cost = COST_TACHO+COST_PROX_CHECK+(execScanNew ? COST_PROX_SCAN : 0)+(refCapturing ? COST_REF_FINISH : 0)+COST_REF_CHARGE;
+      break;
+    case EXEC_STAGE_ESTIMATE:
+      cost = COST_ESTIMATE+COST_LINE;
+      break;
+    case EXEC_STAGE_PLAN:
+      cost = execSumoEvent ? COST_SUMO_EVENT : COST_SUMO_IDLE;
+      break;
+    case EXEC_STAGE_CONTROL:
+      if (cmdQueued) { /* DRV_Control() drains the queue */
+        cmdQueued = false;
+        cmdTaken = true;
+      }
+      cost = COST_CONTROL;
+      break;
+    case EXEC_STAGE_RECORD:
+      cost = COST_RECORD;
+      break;
+  }
+  Run(task, cost, ExecStageDone);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void Hardware(void) {
+  if (now%TICK_US==0 && now>0) {
+    isrBusy += COST_TICK_ISR;
+    OnTick();
+  }
+  if (layout==LAYOUT_EXEC && now%EXEC_PERIOD_US==EXEC_PHASE_US) { /* EXEC_OnCycleInterrupt() */
+    isrBusy += COST_EVENT_ISR;
+    if (execTask->ready) {
+      execNofMissed++;
+    } else {
+      execReleaseTime = now;
+      execNofCycles++;
+      Notify(execTask, 1);
+    }
+  }
+  if (now%ENC_L_PERIOD_US==0 && now>0) {
+    isrBusy += COST_ENC_ISR;
+  }
+  if (now%ENC_R_PERIOD_US==0 && now>0) {
+    isrBusy += COST_ENC_ISR;
+  }
+  if (now%SCAN_US==SCAN_PHASE_US && now>=SCAN_US) {
+    isrBusy += COST_EVENT_ISR;
+    scanEnd = now;
+    if (layout==LAYOUT_TASKS) {
+      Notify(proxTask, 1);
+    }
+  }
+  if (layout==LAYOUT_TASKS && refCapturing && now==refSampleTime+REF_CAPTURE_US) {
+    isrBusy += COST_EVENT_ISR; /* capture timeout interrupt */
+    Notify(refTask, 1);
+  }
+  if (!ev.active && now==nextEventTime) {
+    ev.kind = (EventKind)(Random()%NOF_EVENTS);
+    ev.time = now;
+    ev.detected = false;
+    ev.active = true;
+    cmdQueued = cmdTaken = false;
+  }
+  if (ev.active && now-ev.time>EVENT_TIMEOUT_US) {
+    nofMissed++;
+    NextEvent();
+  }
+}
+
+static void Simulate(Layout l, uint32_t nofEvents) {
+  Task *task;
+
+  layout = l;
+  nofTasks = 0;
+  seqCounter = 0;
+  running = NULL;
+  now = tickCount = isrBusy = 0;
+  busyUs = isrUs = 0;
+  rnd = 1; /* same seed for both layouts */
+  memset(&ev, 0, sizeof(ev));
+  memset(eventStats, 0, sizeof(eventStats));
+  memset(sampleStats, 0, sizeof(sampleStats));
+  nofMissed = nofDone = 0;
+  refCapturing = cmdQueued = cmdTaken = false;
+  scanEnd = scanHandled = 0;
+  nextEventTime = 50000;
+  if (layout==LAYOUT_TASKS) {
+    driveTask = NewTask("Drive", 3, DriveStart);
+    refTask = NewTask("Ref", 2, RefStart);
+    proxTask = NewTask("Prox", 2, ProxWait);
+    sumoTask = NewTask("Sumo", 2, SumoWait);
+    driveLastWake = 0;
+  } else {
+    execTask = NewTask("Exec", 4, ExecWait);
+    memset(execCountdown, 0, sizeof(execCountdown));
+    execRequests = 0;
+    execStage = -1;
+    execSumoEvent = false;
+    execNofMissed = execMaxCycleUs = 0;
+    execNofCycles = execLastControlCycle = 0;
+    execNofRequestedRuns = execNofIrregular = 0;
+  }
+  for(now=0; nofDone+nofMissed<nofEvents; now++) {
+    Hardware();
+    if (isrBusy>0) {
+      isrBusy--;
+      isrUs++;
+      continue;
+    }
+    task = Pick();
+    while (task!=NULL && task->work==0) {
+      task->onDone(task);
+      task = Pick();
+    }
+    if (task==NULL) {
+      continue; /* idle, the shell and the display */
+    }
+    running = task;
+    busyUs++;
+    if (--task->work==0) {
+      task->onDone(task);
+    }
+  }
+}
+
+static void PrintStats(const char *name, const Stats *stats) {
+  if (stats->n==0) {
+    printf("  %-18s -\n", name);
+    return;
+  }
+  printf("  %-18s min %6.2f  mean %6.2f  max %6.2f ms\n", name, stats->min/1000.0, (double)stats->sum/stats->n/1000.0, stats->max/1000.0);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t nofEvents = 5000;
+  char name[32];
+  int l, e;
+
+  if (argc>1) {
+    nofEvents = strtoul(argv[1], NULL, 0);
+  }
+  for(l=0; l<NOF_LAYOUTS; l++) {
+    Simulate((Layout)l, nofEvents);
+    printf("%s: %u events, %u missed, %.1f s, CPU %.1f%% tasks, %.1f%% interrupts\n", layoutNames[l], nofDone, nofMissed, now/1e6, busyUs*100.0/now, isrUs*100.0/now);
+    for(e=0; e<NOF_EVENTS; e++) {
+      snprintf(name, sizeof(name), "%s->PWM", eventNames[e]);
+      PrintStats(name, &eventStats[e]);
+      snprintf(name, sizeof(name), "%s sample->PWM", eventNames[e]);
+      PrintStats(name, &sampleStats[e]);
+    }
+    if (l==LAYOUT_EXEC) {
+      printf("  cycle: max %u us from the release, %u releases missed\n", execMaxCycleUs, execNofMissed);
+      printf("  control: %u requested runs, %u periodic runs not %u cycles apart\n", execNofRequestedRuns, execNofIrregular, execRates[EXEC_STAGE_CONTROL]);
+    }
+  }
+  return nofMissed==0 && execNofIrregular==0 ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Builds and runs the simulation of the control executive against the task based pipeline.
+# Usage: ./run_exec_sim.sh [nofEvents]
+set -e
+cd "$(dirname "$0")"
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall"
+SRC="exec_sim.c"
+
+gcc $CFLAGS -o $OUT/exec_sim $SRC
+$OUT/exec_sim "$@"
@@ -0,0 +1,65 @@
+/**
+ * \file
+ * \brief Host replacements for the asynchronous I2C simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include' for all sources of the simulation. It defines the
+ * include guards of the target headers (RTOS, wait, critical section, platform and the low level
+ * I2C drivers), so McuGenericI2C.c and McuSSD1306.c are compiled unchanged against the simulated
+ * I2C peripheral in i2c_async_sim.c. Waiting lets simulated time pass, which completes the transfer
+ * on the bus like the DMA interrupt does on the target.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Platform.h: hardware I2C, which has the asynchronous transfers */
+#define SRC_PLATFORM_H_
+#define PL_CONFIG_HAS_SW_I2C  (0)
+#define PL_CONFIG_HAS_HW_I2C  (1)
+
+/* McuWait.h */
+#define __McuWait_H
+void Sim_Wait(unsigned int ms);
+#define McuWait_WaitOSms(ms)  Sim_Wait(ms)
+#define McuWait_Waitms(ms)    Sim_Wait(ms)
+#define McuWait_Waitus(us)    /* nothing */
+
+/* McuRTOS.h: one task only, the bus mutex is always available */
+#define __McuRTOS_H
+typedef void *xSemaphoreHandle;
+#define portMAX_DELAY                          (0xffffffffu)
+#define xSemaphoreCreateRecursiveMutex()       ((xSemaphoreHandle)1)
+#define xSemaphoreTakeRecursive(sem, ticks)    ((void)(sem), (void)(ticks), 1)
+#define xSemaphoreGiveRecursive(sem)           ((void)(sem), 1)
+#define vQueueAddToRegistry(sem, name)         /* nothing */
+#define vQueueUnregisterQueue(sem)             /* nothing */
+#define vSemaphoreDelete(sem)                  /* nothing */
+#define taskSCHEDULER_RUNNING                  (2)
+#define xTaskGetSchedulerState()               (taskSCHEDULER_RUNNING)
+
+/* McuCriticalSection.h: the simulated interrupt only runs while waiting */
+#define __McuCriticalSection_H
+#define McuCriticalSection_CriticalVariable()  /* nothing */
+#define McuCriticalSection_EnterCritical()     /* nothing */
+#define McuCriticalSection_ExitCritical()      /* nothing */
+
+/* McuGenericSWI2C.h: not used */
+#define __McuGenericSWI2C_H
+
+/* McuSTM32HALI2C.h: implemented by the simulated peripheral */
+#define __McuSTM32HALI2C_H
+#define McuSTM32HALI2C_CONFIG_USE_ASYNC          (1)
+#define McuSTM32HALI2C_RECVBLOCKCUSTOM_AVAILABLE (0)
+uint8_t McuSTM32HALI2C_SendBlock(void *Ptr, uint16_t Siz, uint16_t *Snt);
+uint8_t McuSTM32HALI2C_RecvBlock(void *Ptr, uint16_t Siz, uint16_t *Rcv);
+uint8_t McuSTM32HALI2C_SendStop(void);
+uint8_t McuSTM32HALI2C_SelectSlave(uint8_t Slv);
+uint8_t McuSTM32HALI2C_RecvBlockCustom(void *Ptr, uint16_t Siz, uint16_t *Rcv, uint8_t flagsStart, uint8_t flagsAck);
+uint8_t McuSTM32HALI2C_WriteAddressAsync(uint8_t i2cAddr, uint8_t memAddr, uint8_t *data, uint16_t dataSize);
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,387 @@
+/**
+ * \file
+ * \brief Host simulation of the asynchronous I2C transfers
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs the unchanged McuGenericI2C.c and McuSSD1306.c against a simulated I2C peripheral. A started
+ * asynchronous transfer stays on the bus until simulated time passes (McuWait_WaitOSms()), then the
+ * peripheral completes it and calls McuGenericI2C_OnAsyncDone() like the DMA interrupt on the target.
+ * If a transfer is queued, the interrupt raises McuGenericI2C_OnAsyncReady(), and the notified task
+ * starts it with McuGenericI2C_ProcessAsync() as soon as the interrupt returns.
+ * The peripheral logs every transaction on the bus, detects a blocking transfer started while an
+ * asynchronous one is still running, and can fail the start or the transfer of a given device.
+ * It also keeps the display RAM of the SSD1306, so the frames handed off asynchronously are checked
+ * against the display buffer.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../McuLib/src -I../../McuLib/config -I../../McuLib/config/fonts
+ *          -I../../McuLib/fonts -I../../Projects/F303K8/Board -o i2c_async_sim i2c_async_sim.c ../../McuLib/src/McuGenericI2C.c
+ *          ../../McuLib/src/McuSSD1306.c ../../McuLib/src/McuGDisplaySSD1306.c
+ * Usage: i2c_async_sim, returns 0 if all checks pass
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "McuGenericI2C.h"
+#include "McuSSD1306.h"
+#include "McuGDisplaySSD1306.h"
+
+#define SIM_LOG_SIZE  (64)
+
+static int nofChecks, nofFails;
+
+#define CHECK(cond) \
+  do { \
+    nofChecks++; \
+    if (!(cond)) { \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+      nofFails++; \
+    } \
+  } while(0)
+
+/* simulated peripheral */
+static struct {
+  bool busy;                /* asynchronous transfer on the bus */
+  uint8_t i2cAddr, memAddr; /* of the asynchronous transfer */
+  uint8_t *data;
+  uint16_t dataSize;
+  uint8_t selected;         /* slave of the blocking transfer */
+  uint8_t failStartAddr;    /* start of an asynchronous transfer to this device fails, 0 for none */
+  uint8_t failBusAddr;      /* transfers to this device fail on the bus, 0 for none */
+  int nofCollisions;        /* blocking transfers started during an asynchronous one */
+  int nofErrorEvents;       /* McuGenericI2C_OnError() calls */
+  bool inIsr;               /* in the completion interrupt */
+  bool readyPending;        /* task notified by McuGenericI2C_OnAsyncReady() */
+  bool taskBlocked;         /* the notified task does not run */
+  int nofReadyEvents;       /* McuGenericI2C_OnAsyncReady() calls */
+  int nofIsrStarts;         /* asynchronous transfers started from the interrupt */
+  int logSize;
+  uint8_t log[SIM_LOG_SIZE]; /* device address of the transactions, in bus order */
+  uint16_t lastAsyncSize;   /* size of the last asynchronous transfer to the display */
+} sim;
+
+/* display RAM of the SSD1306 in horizontal addressing mode */
+static uint8_t displayRam[McuSSD1306_DISPLAY_HW_NOF_PAGES][McuSSD1306_DISPLAY_HW_NOF_COLUMNS];
+static uint8_t winCol0, winCol1, winPage0, winPage1, ramCol, ramPage;
+
+static void SimDisplayWrite(uint8_t memAddr, const uint8_t *data, uint16_t size) {
+  if (memAddr!=0x40) { /* commands */
+    if (size==6 && data[0]==0x21 && data[3]==0x22) { /* window set by SSD1306_SetWindow() */
+      winCol0 = data[1]; winCol1 = data[2];
+      winPage0 = data[4]; winPage1 = data[5];
+      ramCol = winCol0;
+      ramPage = winPage0;
+    } /* other commands do not change the content */
+    return;
+  }
+  while (size>0) {
+    displayRam[ramPage][ramCol] = *data++;
+    size--;
+    if (ramCol<winCol1) {
+      ramCol++;
+    } else {
+      ramCol = winCol0;
+      ramPage = ramPage<winPage1 ? ramPage+1 : winPage0;
+    }
+  }
+}
+
+static void SimLog(uint8_t i2cAddr) {
+  if (sim.logSize<SIM_LOG_SIZE) {
+    sim.log[sim.logSize++] = i2cAddr;
+  }
+}
+
+/* interrupt of the simulated peripheral: the asynchronous transfer is done */
+static void SimComplete(void) {
+  uint8_t res = ERR_OK;
+
+  sim.busy = FALSE;
+  if (sim.i2cAddr==sim.failBusAddr) {
+    res = ERR_FAILED; /* e.g. NACK */
+  } else if (sim.i2cAddr==McuSSD1306_CONFIG_SSD1306_I2C_ADDR) {
+    SimDisplayWrite(sim.memAddr, sim.data, sim.dataSize);
+  }
+  sim.inIsr = TRUE;
+  McuGenericI2C_OnAsyncDone(res);
+  sim.inIsr = FALSE;
+  if (sim.readyPending && !sim.taskBlocked) { /* the notified task runs */
+    sim.readyPending = FALSE;
+    McuGenericI2C_ProcessAsync();
+  }
+}
+
+void Sim_Wait(unsigned int ms) {
+  while (ms>0) {
+    if (sim.busy) {
+      SimComplete();
+    }
+    ms--;
+  }
+}
+
+uint8_t McuSTM32HALI2C_WriteAddressAsync(uint8_t i2cAddr, uint8_t memAddr, uint8_t *data, uint16_t dataSize) {
+  if (sim.busy) {
+    sim.nofCollisions++;
+  }
+  if (sim.inIsr) {
+    sim.nofIsrStarts++; /* would poll the bus in the interrupt */
+  }
+  if (i2cAddr==sim.failStartAddr) {
+    return ERR_FAILED; /* e.g. no ACK for the address */
+  }
+  sim.busy = TRUE;
+  sim.i2cAddr = i2cAddr;
+  sim.memAddr = memAddr;
+  sim.data = data;
+  sim.dataSize = dataSize;
+  if (i2cAddr==McuSSD1306_CONFIG_SSD1306_I2C_ADDR && memAddr==0x40) {
+    sim.lastAsyncSize = dataSize;
+  }
+  SimLog(i2cAddr);
+  return ERR_OK;
+}
+
+uint8_t McuSTM32HALI2C_SelectSlave(uint8_t Slv) {
+  sim.selected = Slv;
+  return ERR_OK;
+}
+
+uint8_t McuSTM32HALI2C_SendBlock(void *Ptr, uint16_t Siz, uint16_t *Snt) {
+  uint8_t *p = (uint8_t*)Ptr;
+
+  if (sim.busy) {
+    sim.nofCollisions++;
+  }
+  SimLog(sim.selected);
+  if (sim.selected==McuSSD1306_CONFIG_SSD1306_I2C_ADDR && Siz>0) {
+    SimDisplayWrite(p[0], p+1, (uint16_t)(Siz-1));
+  }
+  *Snt = Siz;
+  return ERR_OK;
+}
+
+uint8_t McuSTM32HALI2C_RecvBlock(void *Ptr, uint16_t Siz, uint16_t *Rcv) {
+  memset(Ptr, 0, Siz);
+  *Rcv = Siz;
+  return ERR_OK;
+}
+
+uint8_t McuSTM32HALI2C_SendStop(void) {
+  return ERR_OK;
+}
+
+uint8_t McuSTM32HALI2C_RecvBlockCustom(void *Ptr, uint16_t Siz, uint16_t *Rcv, uint8_t flagsStart, uint8_t flagsAck) {
+  (void)flagsStart;
+  (void)flagsAck;
+  return McuSTM32HALI2C_RecvBlock(Ptr, Siz, Rcv);
+}
+
+void McuGenericI2C_OnRequestBus(void) {
+}
+
+void McuGenericI2C_OnReleaseBus(void) {
+}
+
+void McuGenericI2C_OnError(void) {
+  sim.nofErrorEvents++;
+}
+
+void McuGenericI2C_OnAsyncReady(void) {
+  CHECK(sim.inIsr);
+  sim.nofReadyEvents++;
+  sim.readyPending = TRUE;
+}
+
+/* test transfers, the device address identifies them */
+static McuGenericI2C_AsyncTransfer xfers[4];
+static uint8_t xferData[4][8];
+static uint8_t doneLog[SIM_LOG_SIZE];
+static int doneLogSize;
+
+static void OnDone(McuGenericI2C_AsyncTransfer *xfer) {
+  if (doneLogSize<SIM_LOG_SIZE) {
+    doneLog[doneLogSize++] = xfer->i2cAddr;
+  }
+}
+
+/* queues another transfer from the completion callback, i.e. from the interrupt */
+static void OnDoneChain(McuGenericI2C_AsyncTransfer *xfer) {
+  OnDone(xfer);
+  if (xfer==&xfers[0]) {
+    CHECK(McuGenericI2C_WriteAddressAsync(&xfers[1])==ERR_OK);
+  }
+}
+
+static void Reset(void) {
+  int i;
+
+  Sim_Wait(100); /* finish what is on the bus */
+  memset(&sim, 0, sizeof(sim));
+  doneLogSize = 0;
+  for(i=0; i<4; i++) {
+    xfers[i].i2cAddr = (uint8_t)(0x10+i);
+    xfers[i].memAddr = 0;
+    xfers[i].data = xferData[i];
+    xfers[i].dataSize = sizeof(xferData[i]);
+    xfers[i].done = OnDone;
+    xfers[i].arg = NULL;
+  }
+}
+
+static void TestOrder(void) {
+  int i;
+
+  printf("order and completion\n");
+  Reset();
+  for(i=0; i<3; i++) {
+    CHECK(McuGenericI2C_WriteAddressAsync(&xfers[i])==ERR_OK);
+  }
+  CHECK(sim.logSize==1 && sim.log[0]==0x10); /* only the first one is on the bus */
+  CHECK(xfers[0].res==ERR_BUSY && xfers[1].res==ERR_BUSY && xfers[2].res==ERR_BUSY);
+  CHECK(!McuGenericI2C_IsAsyncIdle());
+  Sim_Wait(1);
+  CHECK(xfers[0].res==ERR_OK && xfers[1].res==ERR_BUSY);
+  CHECK(doneLogSize==1 && sim.logSize==2 && sim.log[1]==0x11); /* next one started by the notified task */
+  CHECK(sim.nofReadyEvents==1);
+  Sim_Wait(2);
+  CHECK(McuGenericI2C_IsAsyncIdle());
+  CHECK(doneLogSize==3 && doneLog[0]==0x10 && doneLog[1]==0x11 && doneLog[2]==0x12);
+  CHECK(xfers[1].res==ERR_OK && xfers[2].res==ERR_OK);
+  CHECK(sim.nofCollisions==0 && sim.nofErrorEvents==0);
+  CHECK(sim.nofReadyEvents==2 && sim.nofIsrStarts==0); /* none after the last one */
+}
+
+static void TestBusy(void) {
+  printf("descriptor in use\n");
+  Reset();
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[0])==ERR_OK);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[1])==ERR_OK);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[0])==ERR_BUSY); /* on the bus */
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[1])==ERR_BUSY); /* queued */
+  Sim_Wait(2);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[0])==ERR_OK); /* can be reused after completion */
+  Sim_Wait(1);
+  CHECK(doneLogSize==3 && sim.logSize==3);
+  CHECK(McuGenericI2C_IsAsyncIdle());
+}
+
+static void TestErrors(void) {
+  printf("errors\n");
+  Reset();
+  sim.failStartAddr = 0x11;
+  sim.failBusAddr = 0x12;
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[0])==ERR_OK);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[1])==ERR_OK);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[2])==ERR_OK);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[3])==ERR_OK);
+  Sim_Wait(1); /* first done, second fails to start, third starts */
+  CHECK(xfers[0].res==ERR_OK && xfers[1].res==ERR_FAILED && xfers[2].res==ERR_BUSY);
+  Sim_Wait(2);
+  CHECK(xfers[2].res==ERR_FAILED && xfers[3].res==ERR_OK); /* queue continues after a failed transfer */
+  CHECK(doneLogSize==4 && doneLog[1]==0x11 && doneLog[2]==0x12);
+  CHECK(sim.nofErrorEvents==2);
+  McuGenericI2C_OnAsyncDone(ERR_OK); /* spurious interrupt, nothing running */
+  CHECK(doneLogSize==4 && McuGenericI2C_IsAsyncIdle());
+}
+
+static void TestBlocking(void) {
+  uint8_t val = 0;
+
+  printf("blocking transfers\n");
+  Reset();
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[0])==ERR_OK);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[1])==ERR_OK);
+  CHECK(McuGenericI2C_WriteByteAddress8(0x50, 0x01, 0x55)==ERR_OK); /* waits for the running one */
+  CHECK(xfers[0].res==ERR_OK && xfers[1].res==ERR_BUSY);
+  CHECK(sim.logSize==3 && sim.log[0]==0x10 && sim.log[1]==0x50 && sim.log[2]==0x11); /* queue restarted after it */
+  McuGenericI2C_RequestBus(); /* e.g. a read sequence */
+  CHECK(xfers[1].res==ERR_OK && !sim.busy);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[2])==ERR_OK);
+  CHECK(!sim.busy); /* held while the bus is requested */
+  CHECK(McuGenericI2C_ReadByteAddress8(0x51, 0x02, &val)==ERR_OK);
+  CHECK(sim.logSize==4 && sim.log[3]==0x51 && !sim.busy);
+  McuGenericI2C_ReleaseBus(); /* restarts the queue */
+  CHECK(sim.busy && sim.i2cAddr==0x12);
+  Sim_Wait(1);
+  CHECK(McuGenericI2C_IsAsyncIdle() && xfers[2].res==ERR_OK);
+  CHECK(sim.nofCollisions==0 && sim.nofIsrStarts==0);
+}
+
+static void TestChain(void) {
+  printf("queue from the completion callback\n");
+  Reset();
+  xfers[0].done = OnDoneChain;
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[0])==ERR_OK);
+  Sim_Wait(1);
+  CHECK(xfers[0].res==ERR_OK && xfers[1].res==ERR_BUSY && sim.busy);
+  Sim_Wait(1);
+  CHECK(xfers[1].res==ERR_OK && doneLogSize==2);
+  CHECK(sim.nofCollisions==0 && sim.nofIsrStarts==0);
+}
+
+static void TestTaskBlocked(void) {
+  printf("notified task blocked\n");
+  Reset();
+  sim.taskBlocked = TRUE;
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[0])==ERR_OK);
+  CHECK(McuGenericI2C_WriteAddressAsync(&xfers[1])==ERR_OK);
+  Sim_Wait(3);
+  CHECK(xfers[0].res==ERR_OK && xfers[1].res==ERR_BUSY && !sim.busy); /* waits for the task */
+  CHECK(sim.nofReadyEvents==1 && sim.nofIsrStarts==0);
+  McuGenericI2C_ProcessAsync(); /* e.g. a task waiting for its transfer */
+  CHECK(sim.busy && sim.i2cAddr==0x11);
+  sim.readyPending = FALSE;
+  Sim_Wait(1);
+  CHECK(McuGenericI2C_IsAsyncIdle() && xfers[1].res==ERR_OK);
+}
+
+static bool DisplayMatches(void) {
+  return memcmp(displayRam, McuSSD1306_DisplayBuf, sizeof(displayRam))==0;
+}
+
+static void TestDisplay(void) {
+  int i;
+
+  printf("display flush\n");
+  Reset();
+  McuSSD1306_Init();
+  McuGDisplaySSD1306_Init();
+  McuGDisplaySSD1306_Clear();
+  McuGDisplaySSD1306_DrawBox(0, 0, McuGDisplaySSD1306_GetWidth(), McuGDisplaySSD1306_GetHeight(), 1, McuGDisplaySSD1306_COLOR_BLUE);
+  McuSSD1306_UpdateFull();
+  CHECK(sim.busy); /* returns while the window commands are on the bus */
+  Sim_Wait(1);
+  CHECK(sim.busy && sim.lastAsyncSize==sizeof(McuSSD1306_DisplayBuf)); /* one transfer for the frame */
+  McuSSD1306_WaitIdle();
+  CHECK(!sim.busy && DisplayMatches());
+  for(i=1; i<=20; i++) {
+    McuGDisplaySSD1306_Clear(); /* waits for the previous frame */
+    McuGDisplaySSD1306_DrawBox(0, 0, McuGDisplaySSD1306_GetWidth(), McuGDisplaySSD1306_GetHeight(), 1, McuGDisplaySSD1306_COLOR_BLUE);
+    McuGDisplaySSD1306_DrawFilledBox((McuGDisplaySSD1306_PixelDim)(2+(i*5)%100), (McuGDisplaySSD1306_PixelDim)(2+(i*3)%50), 10, 8, McuGDisplaySSD1306_COLOR_BLUE);
+    if (i==10) {
+      sim.failBusAddr = McuSSD1306_CONFIG_SSD1306_I2C_ADDR; /* lose this update */
+    }
+    McuSSD1306_UpdateDirty();
+    McuSSD1306_WaitIdle();
+    if (i==10) {
+      sim.failBusAddr = 0;
+      CHECK(!DisplayMatches());
+    } else {
+      CHECK(DisplayMatches()); /* after a failed one a full update is done */
+    }
+  }
+  CHECK(sim.nofCollisions==0 && sim.nofIsrStarts==0);
+}
+
+int main(void) {
+  McuGenericI2C_Init();
+  TestOrder();
+  TestBusy();
+  TestErrors();
+  TestBlocking();
+  TestChain();
+  TestTaskBlocked();
+  TestDisplay();
+  printf("%d checks, %d failed\n", nofChecks, nofFails);
+  return nofFails==0 ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Builds and runs the simulation of the asynchronous I2C transfers of the display.
+# Usage: ./run_i2c_async_sim.sh
+set -e
+cd "$(dirname "$0")"
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$M/src -I$M/config -I$M/config/fonts -I$M/fonts -I../../Projects/F303K8/Board"
+SRC="i2c_async_sim.c $M/src/McuGenericI2C.c $M/src/McuSSD1306.c $M/src/McuGDisplaySSD1306.c"
+
+gcc $CFLAGS -o $OUT/i2c_async_sim $SRC
+$OUT/i2c_async_sim "$@"
@@ -0,0 +1,32 @@
+/**
+ * \file
+ * \brief Host platform configuration for the NVM simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/NVM_Config.c: no RTOS and no shell,
+ * and the flash pages are a memory mapped file with the flash driver in nvm_sim.c.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRUE   true
+#define FALSE  false
+
+#define ERR_OK        0x00U
+#define ERR_RANGE     0x02U
+#define ERR_OVERFLOW  0x04U
+#define ERR_FAILED    0x1BU
+
+#define PL_CONFIG_USE_FREERTOS    (0)
+#define PL_CONFIG_HAS_SHELL       (0)
+#define PL_CONFIG_HAS_CONFIG_NVM  (1)
+
+extern uint8_t *NvmSim_flash; /* start of the mapped file */
+#define NVMC_CONFIG_FLASH_START_ADDR  ((uintptr_t)NvmSim_flash)
+#define NVMC_CONFIG_USE_HAL_FLASH     (0)
+
+#endif /* SRC_PLATFORM_H_ */
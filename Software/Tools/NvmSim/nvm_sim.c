@@ -0,0 +1,257 @@
+/**
+ * \file
+ * \brief Host simulation of the flash configuration storage with power failures
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/NVM_Config.c (compiled unchanged) on flash pages in a memory mapped file. The flash
+ * driver behaves like the STM32F303 flash: a half word can only be programmed if it is erased.
+ * A series of saves is first run without failure to count the flash operations. Then for each of
+ * these operations a child process runs the same series and dies at that operation, like with a
+ * power failure: a half word gets partially programmed or a page partially erased. The file keeps
+ * the flash content, and the parent mounts it again and checks that each key has either the
+ * previous or the new value, and that new values can be stored.
+ *
+ * Build: gcc -O2 -Wall -I. -I../../RoboLib -o nvm_sim nvm_sim.c ../../RoboLib/NVM_Config.c
+ * Usage: nvm_sim [file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "Platform.h"
+#include "NVM_Config.h"
+
+#define NOF_STEPS        (150) /* saves of the series */
+#define FLASH_SIZE       (NVMC_CONFIG_NOF_PAGES*NVMC_CONFIG_PAGE_SIZE)
+#define EXIT_POWER_FAIL  (3)   /* child died at the simulated power failure */
+#define EXIT_SAVE_FAILED (4)   /* NVMC_Save() failed without power failure */
+
+uint8_t *NvmSim_flash;
+static int nofOps; /* flash operations so far */
+static int failAtOp; /* operation with the power failure, 0 for none */
+static unsigned long nofErases[NVMC_CONFIG_NOF_PAGES];
+
+typedef struct {
+  int completed;  /* last step where NVMC_Save() has returned */
+  int inProgress; /* step in NVMC_Save() */
+} Progress; /* shared between child and parent */
+
+static bool PowerFails(void) {
+  nofOps++;
+  return failAtOp!=0 && nofOps==failAtOp;
+}
+
+uint8_t NVMC_OnErasePage(uintptr_t pageAddr) {
+  if (PowerFails()) {
+    memset((void*)pageAddr, 0xFF, NVMC_CONFIG_PAGE_SIZE/2); /* erase stopped half way */
+    _exit(EXIT_POWER_FAIL);
+  }
+  memset((void*)pageAddr, 0xFF, NVMC_CONFIG_PAGE_SIZE);
+  nofErases[(pageAddr-(uintptr_t)NvmSim_flash)/NVMC_CONFIG_PAGE_SIZE]++;
+  return ERR_OK;
+}
+
+uint8_t NVMC_OnProgramHalfWord(uintptr_t addr, uint16_t data) {
+  uint16_t *p = (uint16_t*)addr;
+
+  if (*p!=0xFFFF) {
+    return ERR_FAILED; /* PGERR on the STM32 */
+  }
+  if (PowerFails()) {
+    *p &= data|0x5555; /* only some of the bits are programmed */
+    _exit(EXIT_POWER_FAIL);
+  }
+  *p = data;
+  return ERR_OK;
+}
+
+/* key and value of a step of the series */
+static NVMC_Key StepKey(int step) {
+  return (NVMC_Key)((step*3+step/NVMC_KEY_NOF)%NVMC_KEY_NOF); /* each key once in NVMC_KEY_NOF steps */
+}
+
+static size_t StepValue(int step, uint8_t *buf) {
+  size_t i, size;
+
+  size = 4+((size_t)StepKey(step)*5+(size_t)step)%37;
+  for(i=0; i<size; i++) {
+    buf[i] = (uint8_t)(step*7+i*13+1);
+  }
+  return size;
+}
+
+static bool HasValue(NVMC_Key key, int step) {
+  uint8_t buf[NVMC_CONFIG_MAX_DATA_SIZE];
+  const void *data;
+  size_t size, stored;
+
+  data = NVMC_Get(key, &stored);
+  if (step<0) {
+    return data==NULL;
+  }
+  size = StepValue(step, buf);
+  return data!=NULL && stored==size && memcmp(data, buf, size)==0;
+}
+
+static void RunSeries(volatile Progress *progress) {
+  uint8_t buf[NVMC_CONFIG_MAX_DATA_SIZE];
+  size_t size;
+  int step;
+
+  for(step=0; step<NOF_STEPS; step++) {
+    progress->inProgress = step;
+    size = StepValue(step, buf);
+    if (NVMC_Save(StepKey(step), buf, size)!=ERR_OK) {
+      _exit(EXIT_SAVE_FAILED);
+    }
+    progress->completed = step;
+  }
+}
+
+/* Mounts the flash after the failure and checks the values. Returns the number of errors. */
+static int CheckAfterFailure(const Progress *progress) {
+  uint8_t buf[NVMC_CONFIG_MAX_DATA_SIZE];
+  int errors = 0, key, step, last;
+  size_t size;
+
+  NVMC_Init();
+  for(key=0; key<NVMC_KEY_NOF; key++) {
+    last = -1; /* last completed save of the key */
+    for(step=0; step<=progress->completed; step++) {
+      if ((int)StepKey(step)==key) {
+        last = step;
+      }
+    }
+    if (HasValue((NVMC_Key)key, last)) {
+      continue;
+    }
+    if (progress->inProgress>progress->completed && (int)StepKey(progress->inProgress)==key && HasValue((NVMC_Key)key, progress->inProgress)) {
+      continue; /* new value has been committed */
+    }
+    errors++;
+  }
+  /* the storage needs to work after the failure */
+  for(key=0; key<NVMC_KEY_NOF; key++) {
+    step = NOF_STEPS+key;
+    while ((int)StepKey(step)!=key) {
+      step++;
+    }
+    size = StepValue(step, buf);
+    if (NVMC_Save((NVMC_Key)key, buf, size)!=ERR_OK) {
+      errors++;
+    }
+  }
+  NVMC_Init(); /* mount again */
+  for(key=0; key<NVMC_KEY_NOF; key++) {
+    step = NOF_STEPS+key;
+    while ((int)StepKey(step)!=key) {
+      step++;
+    }
+    if (!HasValue((NVMC_Key)key, step)) {
+      errors++;
+    }
+  }
+  return errors;
+}
+
+static double NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec*1e9+(double)ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+  const char *fileName = "nvm_sim.bin";
+  Progress *progress;
+  int fd, i, op, total, status, nofFailed = 0, nofChecked = 0;
+  double start;
+  uint8_t buf[NVMC_CONFIG_MAX_DATA_SIZE];
+  size_t size;
+  pid_t pid;
+
+  if (argc>1) {
+    fileName = argv[1];
+  }
+  fd = open(fileName, O_RDWR|O_CREAT, 0644);
+  if (fd<0 || ftruncate(fd, FLASH_SIZE)!=0) {
+    perror(fileName);
+    return 1;
+  }
+  NvmSim_flash = mmap(NULL, FLASH_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  progress = mmap(NULL, sizeof(Progress), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if (NvmSim_flash==MAP_FAILED || progress==MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+
+  /* series without failure */
+  memset(NvmSim_flash, 0xFF, FLASH_SIZE);
+  NVMC_Init();
+  nofOps = 0;
+  failAtOp = 0;
+  RunSeries(progress);
+  total = nofOps;
+  printf("%d saves, %d flash operations, erases per page:", NOF_STEPS, total);
+  for(i=0; i<NVMC_CONFIG_NOF_PAGES; i++) {
+    printf(" %lu", nofErases[i]);
+  }
+  printf("\n");
+  size = StepValue(NOF_STEPS-1, buf);
+  op = nofOps;
+  (void)NVMC_Save(StepKey(NOF_STEPS-1), buf, size);
+  if (nofOps!=op) {
+    printf("FAILED: saving the same value writes the flash\n");
+    nofFailed++;
+  }
+  start = NowNs();
+  for(i=0; i<1000; i++) {
+    NVMC_Init();
+  }
+  printf("mount: %.0f ns, get: ", (NowNs()-start)/1000);
+  start = NowNs();
+  for(i=0; i<100000; i++) {
+    if (NVMC_Get((NVMC_Key)(i%NVMC_KEY_NOF), &size)==NULL) {
+      nofFailed++;
+    }
+  }
+  printf("%.1f ns\n", (NowNs()-start)/100000);
+
+  /* power failure at each operation of the series */
+  for(op=1; op<=total; op++) {
+    memset(NvmSim_flash, 0xFF, FLASH_SIZE);
+    progress->completed = -1;
+    progress->inProgress = -1;
+    pid = fork();
+    if (pid<0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid==0) { /* child: runs the series until the power fails */
+      nofOps = 0;
+      failAtOp = op;
+      NVMC_Init();
+      RunSeries(progress);
+      _exit(0);
+    }
+    if (waitpid(pid, &status, 0)!=pid || !WIFEXITED(status) || WEXITSTATUS(status)!=EXIT_POWER_FAIL) {
+      printf("FAILED: power failure at operation %d, child status 0x%x\n", op, status);
+      nofFailed++;
+      continue;
+    }
+    nofChecked++;
+    if (CheckAfterFailure(progress)!=0) {
+      printf("FAILED: wrong values after power failure at operation %d (step %d)\n", op, progress->inProgress);
+      nofFailed++;
+    }
+  }
+  printf("%d power failures checked, %d failed\n", nofChecked, nofFailed);
+  munmap(NvmSim_flash, FLASH_SIZE);
+  close(fd);
+  return nofFailed==0 ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the simulation of the flash configuration storage with power failures.
+# Usage: ./run_nvm_sim.sh [file]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -I. -I$R"
+SRC="nvm_sim.c $R/NVM_Config.c"
+FLASH=${1:-$OUT/nvm_sim.bin}
+
+gcc $CFLAGS -o $OUT/nvm_sim $SRC
+$OUT/nvm_sim "$FLASH"
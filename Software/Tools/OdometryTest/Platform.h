@@ -0,0 +1,27 @@
+/**
+ * \file
+ * \brief Host platform configuration for the odometry drift test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Odometry.c and RoboLib/Quadrature.c:
+ * edge decoder and odometry, without the critical section module, the shell and the spans.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (1)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (0)
+#define PL_CONFIG_HAS_DLOG           (0)
+#define PL_CONFIG_HAS_CRITSEC        (0)
+#define PL_CONFIG_HAS_EXEC           (0)
+#define PL_CONFIG_HAS_QUADRATURE     (1)
+#define PL_CONFIG_HIGH_RES_ENCODER   (1)
+#define PL_CONFIG_HAS_ODOMETRY       (1)
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,220 @@
+/**
+ * \file
+ * \brief Host drift test of the odometry with simulated encoders
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Odometry.c and RoboLib/Quadrature.c (compiled unchanged). A wheel model drives the
+ * encoder pins with one quadrature step per edge and calls the edge decoder, the odometry is
+ * updated every 5 ms as in the Drive task or the executive. The exact pose of the wheel model is
+ * compared with the pose of the odometry:
+ * - straight: 1 m forward and back
+ * - circle: one lap on a 300 mm radius, both directions
+ * - spin: turns on the spot
+ * - reset: the counters are set to zero while driving, with updates between the two wheels and
+ *   before ODO_Reset(), as 'drive pos reset' does. The pose must not jump, ODO_Reset() sets it to zero.
+ * - quad reset: QUAD_Reset() without ODO_Reset(), the pose has to continue without a jump.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src
+ *          -I../../McuLib/config -I../../McuLib/FreeRTOS/Source/include -I../../Projects/F303K8/Board
+ *          -o odometry_test odometry_test.c ../../RoboLib/Odometry.c ../../RoboLib/Quadrature.c
+ *          ../../RoboLib/SensorBus.c -lm
+ * Usage: odometry_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Platform.h"
+#include "Odometry.h"
+#include "Quadrature.h"
+
+#define TICKS_PER_M       (8985)    /* as ODO_CONFIG_TICKS_PER_M */
+#define WHEEL_BASE_MM     (85.0)    /* as ODO_CONFIG_WHEEL_BASE_UM */
+#define SIM_STEP_US       (50)      /* wheel model step, at most one encoder step per wheel */
+#define UPDATE_US         (5000)    /* odometry update period */
+
+/* drift limits per path */
+#define MAX_POS_ERR_MM    (3.0)
+#define MAX_HEADING_ERR   (1.0)     /* degree */
+
+uint8_t SIM_encPins[2];
+static uint64_t simTimeUs;
+
+static const uint8_t grayCode[4] = {0, 1, 3, 2}; /* pin states for counting up */
+
+typedef struct {
+  double dist[2];   /* wheel distance in mm, left and right */
+  int32_t steps[2]; /* encoder steps output on the pins */
+  double x, y, heading; /* exact pose in mm and radians */
+} SimRobot;
+
+static SimRobot robot;
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return (uint32_t)(simTimeUs*(configCPU_CLOCK_HZ/1000000));
+}
+
+/*! \brief Outputs the encoder steps up to the wheel distance, one pin change each */
+static void SimEncoders(void) {
+  int wheel;
+  int32_t target;
+
+  for(wheel=0; wheel<2; wheel++) {
+    target = (int32_t)floor(robot.dist[wheel]*TICKS_PER_M/1000.0);
+    while (robot.steps[wheel]!=target) {
+      robot.steps[wheel] += target>robot.steps[wheel] ? 1 : -1;
+      SIM_encPins[wheel] = grayCode[robot.steps[wheel]&3];
+      QUAD_OnEdgeInterrupt(wheel==0);
+    }
+  }
+}
+
+static double WrapDeg(double deg) {
+  while (deg>180.0) {
+    deg -= 360.0;
+  }
+  while (deg<=-180.0) {
+    deg += 360.0;
+  }
+  return deg;
+}
+
+/*!
+ * \brief Drives with constant wheel speeds, updating the odometry with its period
+ * \param speedL Left wheel speed in mm/s
+ * \param speedR Right wheel speed in mm/s
+ * \param timeUs Duration
+ */
+static void Drive(double speedL, double speedR, uint32_t timeUs) {
+  uint32_t t;
+  double dL, dR, ds, dh;
+
+  for(t=0; t<timeUs; t+=SIM_STEP_US) {
+    dL = speedL*SIM_STEP_US/1e6;
+    dR = speedR*SIM_STEP_US/1e6;
+    robot.dist[0] += dL;
+    robot.dist[1] += dR;
+    ds = (dL+dR)/2.0;
+    dh = (dR-dL)/WHEEL_BASE_MM;
+    robot.x += ds*cos(robot.heading+dh/2.0);
+    robot.y += ds*sin(robot.heading+dh/2.0);
+    robot.heading += dh;
+    simTimeUs += SIM_STEP_US;
+    SimEncoders();
+    if (simTimeUs%UPDATE_US==0) {
+      ODO_Update();
+    }
+  }
+}
+
+/*! \brief Sets the pose of the model to zero, with ODO_Reset() */
+static void ResetPose(void) {
+  ODO_Reset();
+  ODO_Update();
+  robot.x = robot.y = robot.heading = 0.0;
+}
+
+static int CheckPose(const char *name) {
+  ODO_Pose pose;
+  double errPos, errHeading;
+
+  ODO_Update(); /* the steps since the last period */
+  ODO_GetPose(&pose);
+  errPos = hypot(pose.x-robot.x, pose.y-robot.y);
+  errHeading = WrapDeg(pose.heading/100.0-robot.heading*180.0/M_PI);
+  printf("%-12s model %8.1f %8.1f %7.2f deg, odometry %6d %6d %7.2f deg, error %5.2f mm %5.2f deg\n",
+    name, robot.x, robot.y, WrapDeg(robot.heading*180.0/M_PI), (int)pose.x, (int)pose.y, pose.heading/100.0,
+    errPos, errHeading);
+  if (errPos>MAX_POS_ERR_MM || fabs(errHeading)>MAX_HEADING_ERR) {
+    printf("FAILED: %s: drift\n", name);
+    return 1;
+  }
+  return 0;
+}
+
+static int TestStraight(void) {
+  int errors = 0;
+
+  ResetPose();
+  Drive(300.0, 300.0, 3333333);
+  errors += CheckPose("straight");
+  Drive(-300.0, -300.0, 3333333);
+  errors += CheckPose("back");
+  return errors;
+}
+
+static int TestCircle(void) {
+  const double radius = 300.0, speed = 300.0;
+  uint32_t lapUs = (uint32_t)(2.0*M_PI*radius/speed*1e6);
+  int errors = 0;
+
+  ResetPose();
+  Drive(speed*(radius-WHEEL_BASE_MM/2)/radius, speed*(radius+WHEEL_BASE_MM/2)/radius, lapUs);
+  errors += CheckPose("circle ccw");
+  Drive(speed*(radius+WHEEL_BASE_MM/2)/radius, speed*(radius-WHEEL_BASE_MM/2)/radius, lapUs);
+  errors += CheckPose("circle cw");
+  return errors;
+}
+
+static int TestSpin(void) {
+  double speed = 200.0;
+  uint32_t turnUs = (uint32_t)(M_PI*WHEEL_BASE_MM/speed*1e6); /* 360 degree */
+  int errors = 0;
+
+  ResetPose();
+  Drive(-speed, speed, 3*turnUs/4);
+  errors += CheckPose("spin 270");
+  Drive(speed, -speed, 5*turnUs);
+  errors += CheckPose("spin back 5");
+  return errors;
+}
+
+/*! \brief Counters to zero in the middle of a drive, as 'drive pos reset': the pose must not jump */
+static int TestReset(void) {
+  ODO_Pose before, pose;
+  int errors = 0;
+
+  ResetPose();
+  Drive(300.0, 250.0, 2000000);
+  ODO_Update();
+  ODO_GetPose(&before);
+  QUAD_SetLeftPos(0);
+  ODO_Update(); /* the executive can run between the two counters */
+  QUAD_SetRightPos(0);
+  ODO_Update(); /* and before ODO_Reset() */
+  ODO_GetPose(&pose);
+  printf("%-12s before %6d %6d %7.2f deg, after the counters %6d %6d %7.2f deg\n", "reset",
+    (int)before.x, (int)before.y, before.heading/100.0, (int)pose.x, (int)pose.y, pose.heading/100.0);
+  if (pose.x!=before.x || pose.y!=before.y || pose.heading!=before.heading) {
+    printf("FAILED: reset: pose jumped with the counters\n");
+    errors++;
+  }
+  ResetPose();
+  ODO_GetPose(&pose);
+  if (pose.x!=0 || pose.y!=0 || pose.heading!=0) {
+    printf("FAILED: reset: pose not zero\n");
+    errors++;
+  }
+  Drive(300.0, 300.0, 1000000);
+  errors += CheckPose("after reset");
+  /* QUAD_Reset() alone, e.g. 'quad reset': the odometry continues */
+  Drive(200.0, 300.0, 1000000);
+  QUAD_Reset();
+  Drive(200.0, 300.0, 1000000);
+  errors += CheckPose("quad reset");
+  return errors;
+}
+
+int main(void) {
+  int errors = 0;
+
+  QUAD_Init();
+  ODO_Init();
+  ODO_Update(); /* sets the origin */
+  errors += TestStraight();
+  errors += TestCircle();
+  errors += TestSpin();
+  errors += TestReset();
+  printf("%d failed\n", errors);
+  return errors==0 ? 0 : 1;
+}
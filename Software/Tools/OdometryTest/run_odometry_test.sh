@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the odometry drift test.
+# Usage: ./run_odometry_test.sh
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/FreeRTOS/Source/include -I../../Projects/F303K8/Board"
+SRC="odometry_test.c $R/Odometry.c $R/Quadrature.c $R/SensorBus.c"
+
+gcc $CFLAGS -o $OUT/odometry_test $SRC -lm
+$OUT/odometry_test "$@"
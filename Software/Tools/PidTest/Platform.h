@@ -0,0 +1,33 @@
+/**
+ * \file
+ * \brief Host platform configuration for the PID test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Pid.c: the position, speed and line loops
+ * as on the robot, without the shell, the spans, the deferred log and the flash configuration.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (0)
+#define PL_CONFIG_HAS_DLOG           (0)
+#define PL_CONFIG_HAS_CONFIG_NVM     (0)
+#define PL_CONFIG_HAS_QUADRATURE     (1)
+#define PL_CONFIG_HAS_REFLECTANCE    (1)
+#define PL_CONFIG_HAS_MOTOR          (1)
+#define PL_CONFIG_HIGH_RES_ENCODER   (1 && PL_CONFIG_HAS_QUADRATURE)
+#define PL_CONFIG_HAS_PID            (1 && PL_CONFIG_HAS_MOTOR)
+#define PL_CONFIG_HAS_SPEED_PID      (1 && PL_CONFIG_HAS_PID)
+#define PL_CONFIG_HAS_POS_PID        (1 && PL_CONFIG_HAS_PID)
+#define PL_CONFIG_HAS_LINE_PID       (1 && PL_CONFIG_HAS_PID)
+#define PL_CONFIG_GO_DEADEND_BW      (0) /* NYI */
+#define PL_APP_LINE_FOLLOWING        (1)
+#define PL_APP_LINE_MAZE             (0)
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,20 @@
+/**
+ * \file
+ * \brief Host stubs of the cycle counter for the PID test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guard of McuArmTools.h, so
+ * RoboLib/Pid.c is compiled unchanged. The cycle counter is in pid_test.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define __McuArmTools_H
+
+/* McuArmTools */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,527 @@
+/**
+ * \file
+ * \brief Host unit tests and benchmark of the fixed point PID
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Pid.c (compiled unchanged) through PID_Speed(), PID_Pos() and PID_Line(), with stubs
+ * of the motors which keep the PWM value and the direction. The unit tests check each part of the
+ * controller core:
+ * - P, I with the anti-windup limits, D on the measurement without kick on set value changes,
+ *   the low pass filter of the D part, the feed-forward and the back-calculation anti-windup.
+ * - the transformation of the three loops: reset of the speed PID for a zero set value, scaling,
+ *   dead band and speed limit of the position PID, differential speed of the line PID.
+ * - random sequences against a floating point model of the same controller. The filtered D part of
+ *   the fixed point one can be up to 2^dFilterShift lower, as the shift rounds down.
+ * - with the default settings (no feed-forward, filter and output limit) and a constant set value,
+ *   the result has to be the one of the previous integer PID, up to the rounding of the gains.
+ * The benchmark runs the three loops with the settings of Application.c, once with the previous
+ * integer core (below, as in the 'pid bench' command) and once with the fixed point core, and prints
+ * the time per iteration. On the robot, 'pid bench' prints the cycles and 'pid status' the longest
+ * PID calculation.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -o pid_test pid_test.c ../../RoboLib/Pid.c -lm
+ * Usage: pid_test [nofIterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "Platform.h"
+#include "Pid.h"
+#include "Motor.h"
+
+static int nofIterations = 1000000;
+static unsigned int nofFailed = 0;
+static uint32_t cycleCounter;
+static MOT_MotorDevice motors[2];
+static volatile int32_t sink; /* so the benchmark is not optimized away */
+
+/*------------------------------------------------------------------------------------------------*/
+/* stubs */
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return cycleCounter++; /* as cheap as reading the DWT counter on the robot */
+}
+
+MOT_MotorDevice *MOT_GetMotorHandle(MOT_MotorSide side) {
+  return &motors[side];
+}
+
+void MOT_SetVal(MOT_MotorDevice *motor, uint16_t val) {
+  motor->currPWMvalue = val;
+}
+
+void MOT_SetDirection(MOT_MotorDevice *motor, MOT_Direction dir) {
+  motor->currDir = dir;
+}
+
+void MOT_UpdatePercent(MOT_MotorDevice *motor, MOT_Direction dir) {
+  (void)motor; (void)dir;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void Check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    nofFailed++;
+  }
+}
+
+static void CheckVal(int32_t val, int32_t expected, const char *what) {
+  if (val!=expected) {
+    printf("FAILED: %s: %ld instead of %ld\n", what, (long)val, (long)expected);
+    nofFailed++;
+  }
+}
+
+/* output of the speed and position PID, negative is backward */
+static int32_t Out(MOT_MotorSide side) {
+  return motors[side].currDir==MOT_DIR_BACKWARD?-(int32_t)motors[side].currPWMvalue:(int32_t)motors[side].currPWMvalue;
+}
+
+static PID_Config *SetConfig(PID_ConfigType type, int32_t p, int32_t i, int32_t d, int32_t windup, int32_t ff, int32_t limit, uint8_t shift, uint8_t maxSpeed) {
+  PID_Config *config;
+
+  (void)PID_GetPIDConfig(type, &config);
+  config->pFactor100 = p;
+  config->iFactor100 = i;
+  config->dFactor100 = d;
+  config->iAntiWindup = windup;
+  config->ffFactor100 = ff;
+  config->outLimit = limit;
+  config->dFilterShift = shift;
+  config->maxSpeedPercent = maxSpeed;
+  config->lastError = 0;
+  config->integral = 0;
+  config->dFiltered = 0;
+  PID_ConfigChanged(config);
+  return config;
+}
+
+static int32_t Speed(int32_t curr, int32_t set) {
+  PID_Speed(curr, set, TRUE, TRUE);
+  return Out(MOT_MOTOR_LEFT);
+}
+
+/* new set value between the control periods */
+static int32_t SpeedUpdate(int32_t curr, int32_t set) {
+  PID_Speed(curr, set, TRUE, FALSE);
+  return Out(MOT_MOTOR_LEFT);
+}
+
+static int32_t Pos(int32_t curr, int32_t set) {
+  PID_Pos(curr, set, TRUE, TRUE);
+  return Out(MOT_MOTOR_LEFT);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void TestP(void) {
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 100, 0, 0, 100000, 0, 0, 0, 100);
+  CheckVal(Speed(0, 1000), 1000, "P 1.0");
+  CheckVal(Speed(0, -1000), -1000, "P 1.0 backward");
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 250, 0, 0, 100000, 0, 0, 0, 100);
+  CheckVal(Speed(600, 1000), 1000, "P 2.5");
+}
+
+static void TestI(void) {
+  PID_Config *config;
+  int k;
+
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 0, 100, 0, 100000, 0, 0, 0, 100);
+  for(k=1; k<=5; k++) {
+    CheckVal(Speed(900, 1000), 100*k, "I sums the error of each period");
+  }
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 0, 100, 0, 250, 0, 0, 0, 100);
+  for(k=1; k<=5; k++) {
+    (void)Speed(900, 1000);
+  }
+  CheckVal(Speed(900, 1000), 250, "I limited by iAntiWindup");
+  config = SetConfig(PID_CONFIG_SPEED_LEFT, 0, 1, 0, 1000000, 0, 0, 0, 100);
+  for(k=1; k<=5; k++) {
+    (void)Speed(0, 30000);
+  }
+  CheckVal(config->integral, 0xffff, "integral limited to the PWM range");
+}
+
+static void TestD(void) {
+  PID_Config *config;
+
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 0, 0, 100, 100000, 0, 0, 0, 100);
+  CheckVal(Speed(0, 500), 0, "D: no kick in the first iteration");
+  CheckVal(Speed(0, 2000), 0, "D: no kick on a set value change");
+  CheckVal(Speed(50, 2000), -50, "D on the measurement");
+  CheckVal(Speed(50, 2000), 0, "D with constant measurement");
+  config = SetConfig(PID_CONFIG_SPEED_LEFT, 0, 0, 100, 100000, 0, 0, 2, 100);
+  (void)Speed(0, 500);
+  CheckVal(Speed(400, 500), -100, "filtered D, 1/4 of the step");
+  CheckVal(Speed(400, 500), -75, "filtered D, decaying");
+  CheckVal(Speed(400, 500), -57, "filtered D, decaying");
+  CheckVal(config->dFiltered, -57, "filtered D in the configuration");
+}
+
+static void TestFeedForward(void) {
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 0, 0, 0, 100000, 50, 0, 0, 100);
+  CheckVal(Speed(2000, 2000), 1000, "feed-forward of the set value");
+  CheckVal(Speed(2000, -2000), -1000, "feed-forward backward");
+}
+
+static void TestBackCalculation(void) {
+  int k;
+  int32_t out;
+
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 100, 100, 0, 100000, 0, 1000, 0, 100);
+  for(k=0; k<20; k++) {
+    out = Speed(0, 5000);
+  }
+  CheckVal(out, 1000, "output limited by outLimit");
+  Check(Speed(5500, 5000)<=0, "back-calculation: output follows the error at once");
+  (void)SetConfig(PID_CONFIG_SPEED_LEFT, 100, 100, 0, 100000, 0, 0, 0, 100);
+  for(k=0; k<20; k++) {
+    (void)Speed(0, 5000);
+  }
+  Check(Speed(5500, 5000)>0, "without output limit the integral winds up");
+}
+
+static void TestSetValueUpdate(void) {
+  PID_Config *config;
+
+  config = SetConfig(PID_CONFIG_SPEED_LEFT, 100, 100, 100, 100000, 0, 0, 0, 100);
+  (void)Speed(900, 1000);
+  (void)Speed(900, 1000);
+  CheckVal(SpeedUpdate(900, 2000), 1100+200, "update: P of the new set value, I of the last period");
+  CheckVal(SpeedUpdate(900, 2000), 1100+200, "update: integral not advanced");
+  Check(config->integral==200 && config->lastValue==900, "update: PID state stays");
+  CheckVal(Speed(950, 2000), 1050+1250-50, "update: next period integrates and takes the D part from the last period");
+}
+
+static void TestSpeedLoop(void) {
+  PID_Config *config;
+
+  config = SetConfig(PID_CONFIG_SPEED_LEFT, 100, 100, 100, 100000, 0, 0, 0, 100);
+  (void)Speed(100, 1000);
+  (void)Speed(200, 1000);
+  CheckVal(Speed(300, 0), 0, "speed: zero set value stops");
+  Check(config->integral==0 && config->lastError==0 && config->dFiltered==0 && config->lastValue==300, "speed: zero set value resets the PID");
+  CheckVal(Speed(0, 100000), 0xffff, "speed: output limited to the PWM range");
+}
+
+static void TestPosLoop(void) {
+  (void)SetConfig(PID_CONFIG_POS_LEFT, 100, 0, 0, 200, 0, 0, 0, 40);
+  CheckVal(Pos(0, 20), 20*1000*40/100, "pos: scaled by 1000 and limited to maxSpeedPercent");
+  CheckVal(Pos(0, 5), 0, "pos: dead band of the high resolution encoder");
+  CheckVal(Pos(100, 0), -0xffff*40/100, "pos: limited to the PWM range, backward");
+  (void)SetConfig(PID_CONFIG_POS_RIGHT, 100, 0, 0, 200, 0, 0, 0, 40);
+  PID_Pos(0, 20, FALSE, TRUE);
+  Check(Out(MOT_MOTOR_RIGHT)==20*1000*40/100 && Out(MOT_MOTOR_LEFT)==-0xffff*40/100, "pos: right wheel");
+}
+
+static void TestLineLoop(void) {
+  int32_t speed = 50*(0xffff/100);
+
+  (void)SetConfig(PID_CONFIG_LINE_FW, 100, 0, 0, 100000, 0, 0, 0, 50);
+  PID_Line(2800, 3000, 1000, TRUE);
+  CheckVal(0xffff-motors[MOT_MOTOR_LEFT].currPWMvalue, speed-200, "line: left slower");
+  CheckVal(0xffff-motors[MOT_MOTOR_RIGHT].currPWMvalue, speed+200, "line: right faster");
+  Check(motors[MOT_MOTOR_LEFT].currDir==MOT_DIR_FORWARD && motors[MOT_MOTOR_RIGHT].currDir==MOT_DIR_FORWARD, "line: forward");
+  (void)SetConfig(PID_CONFIG_LINE_FW, 5500, 0, 0, 100000, 0, 0, 0, 50);
+  PID_Line(6000, 0, 1000, TRUE);
+  CheckVal(motors[MOT_MOTOR_LEFT].currPWMvalue, 0, "line: left at full speed");
+  CheckVal(motors[MOT_MOTOR_RIGHT].currPWMvalue, 0xffff, "line: right stopped");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* floating point model of the controller in Pid.c, with a period of PID_REF_PERIOD_US */
+typedef struct {
+  double integral, lastValue, dFiltered;
+  bool first;
+} Model;
+
+static double ModelPID(Model *m, const PID_Config *c, double curr, double set) {
+  double error = set-curr, pid, d, sat;
+
+  if (m->first) {
+    m->lastValue = curr;
+    m->first = false;
+  }
+  pid = error*c->pFactor100/100.0;
+  m->integral += error;
+  m->integral = fmax(fmin(m->integral, c->iAntiWindup), -c->iAntiWindup);
+  m->integral = fmax(fmin(m->integral, 0xffff), -0xffff);
+  pid += m->integral*c->iFactor100/100.0;
+  d = (m->lastValue-curr)*c->dFactor100/100.0;
+  m->dFiltered += (d-m->dFiltered)/(1<<c->dFilterShift);
+  pid += m->dFiltered;
+  pid += set*c->ffFactor100/100.0;
+  if (c->outLimit!=0) {
+    sat = fmax(fmin(pid, c->outLimit), -c->outLimit);
+    if (c->iFactor100!=0) {
+      m->integral -= (pid-sat)*100.0/c->iFactor100;
+    }
+    pid = sat;
+  }
+  m->lastValue = curr;
+  return pid;
+}
+
+static void TestModel(void) {
+  PID_Config *config;
+  Model model;
+  double ref, diff, maxDiff = 0;
+  int32_t out, curr, set;
+  int trial, k;
+
+  srand(5);
+  for(trial=0; trial<500; trial++) {
+    config = SetConfig(PID_CONFIG_SPEED_LEFT, rand()%3000, rand()%200, rand()%400, 1000+rand()%100000,
+      rand()%100, (rand()%2)!=0?1000+rand()%60000:0, (uint8_t)(rand()%5), 100);
+    memset(&model, 0, sizeof(model));
+    model.first = true;
+    set = 1+rand()%4000;
+    curr = 0;
+    for(k=0; k<200; k++) {
+      if (rand()%20==0) {
+        set = 1+rand()%4000; /* not zero: that stops the speed PID */
+      }
+      curr += (set-curr)/4+rand()%201-100;
+      out = Speed(curr, set);
+      ref = ModelPID(&model, config, curr, set);
+      ref = fmax(fmin(ref, 0xffff), -0xffff); /* PWM range of the speed PID */
+      diff = fabs(out-ref);
+      if (diff>maxDiff) {
+        maxDiff = diff;
+      }
+      if (diff>4+(1<<config->dFilterShift)+0.002*fabs(ref)) { /* the shift of the filter rounds down */
+        printf("FAILED: model, trial %d iteration %d: %ld instead of %.1f (p %ld i %ld d %ld ff %ld limit %ld shift %u)\n",
+          trial, k, (long)out, ref, (long)config->pFactor100, (long)config->iFactor100, (long)config->dFactor100,
+          (long)config->ffFactor100, (long)config->outLimit, config->dFilterShift);
+        nofFailed++;
+        return;
+      }
+    }
+  }
+  printf("model: largest difference %.2f over 500 random configurations\n", maxDiff);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* previous integer PID, as in the 'pid bench' command of Pid.c */
+static int32_t PID_Integer(int32_t currVal, int32_t setVal, PID_Config *config) {
+  int32_t error;
+  int32_t pid;
+
+  error = setVal-currVal; /* calculate error */
+  pid = (error*config->pFactor100)/100; /* P part */
+  config->integral += error; /* integrate error */
+  if (config->integral>config->iAntiWindup) {
+    config->integral = config->iAntiWindup;
+  } else if (config->integral<-config->iAntiWindup) {
+    config->integral = -config->iAntiWindup;
+  }
+  if (config->integral > 0xffff) {
+    config->integral = 0xffff;
+  } else if (config->integral < -0xffff) {
+    config->integral = -0xffff;
+  }
+  pid += (config->integral*config->iFactor100)/100; /* add I part */
+  pid += ((error-config->lastError)*config->dFactor100)/100; /* add D part */
+  config->lastError = error; /* remember for next iteration of D part */
+  return pid;
+}
+
+static void TestIntegerEquivalence(void) {
+  PID_Config *config, old;
+  int32_t out, outOld, curr, set, maxDiff = 0;
+  int trial, k;
+
+  srand(7);
+  for(trial=0; trial<500; trial++) {
+    config = SetConfig(PID_CONFIG_SPEED_LEFT, rand()%3000, rand()%200, rand()%400, 1000+rand()%100000, 0, 0, 0, 100);
+    old = *config;
+    set = 1+rand()%4000;
+    curr = set;
+    (void)Speed(curr, set); /* the new one has no D kick in the first iteration, the old one none with no error */
+    (void)PID_Integer(curr, set, &old);
+    for(k=0; k<200; k++) {
+      curr += rand()%101-50;
+      out = Speed(curr, set);
+      outOld = PID_Integer(curr, set, &old);
+      if (outOld>0xffff) {
+        outOld = 0xffff;
+      } else if (outOld<-0xffff) {
+        outOld = -0xffff;
+      }
+      if (abs(out-outOld)>maxDiff) {
+        maxDiff = abs(out-outOld);
+      }
+      if (abs(out-outOld)>3) {
+        printf("FAILED: integer PID, trial %d iteration %d: %ld instead of %ld\n", trial, k, (long)out, (long)outOld);
+        nofFailed++;
+        return;
+      }
+    }
+  }
+  printf("integer PID: largest difference %ld over 500 random configurations\n", (long)maxDiff);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* previous loops with the integer core, the transformation as in Pid.c */
+static void OldPos(int32_t currPos, int32_t setPos, PID_Config *config) {
+  int32_t speed, error;
+  MOT_Direction direction;
+
+  error = setPos-currPos;
+  if (error>-10 && error<10) {
+    setPos = currPos;
+  }
+  speed = PID_Integer(currPos, setPos, config)*1000;
+  if (speed>=0) {
+    direction = MOT_DIR_FORWARD;
+  } else {
+    speed = -speed;
+    direction = MOT_DIR_BACKWARD;
+  }
+  if (speed>0xFFFF) {
+    speed = 0xFFFF;
+  }
+  speed = (speed*config->maxSpeedPercent)/100;
+  MOT_SetVal(MOT_GetMotorHandle(MOT_MOTOR_LEFT), speed);
+  MOT_SetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT), direction);
+  MOT_UpdatePercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), direction);
+}
+
+static void OldSpeed(int32_t currSpeed, int32_t setSpeed, PID_Config *config) {
+  int32_t speed;
+  MOT_Direction direction;
+
+  if (setSpeed==0) {
+    speed = 0;
+    config->integral = 0;
+    config->lastError = 0;
+  } else {
+    speed = PID_Integer(currSpeed, setSpeed, config);
+  }
+  if (speed>=0) {
+    direction = MOT_DIR_FORWARD;
+  } else {
+    speed = -speed;
+    direction = MOT_DIR_BACKWARD;
+  }
+  if (speed>0xFFFF) {
+    speed = 0xFFFF;
+  }
+  MOT_SetVal(MOT_GetMotorHandle(MOT_MOTOR_LEFT), speed);
+  MOT_SetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT), direction);
+  MOT_UpdatePercent(MOT_GetMotorHandle(MOT_MOTOR_LEFT), direction);
+}
+
+static void OldLine(uint16_t currLine, uint16_t setLine, PID_Config *config) {
+  int32_t pid, speed, speedL, speedR;
+
+  pid = PID_Integer(currLine, setLine, config);
+  speed = ((int32_t)config->maxSpeedPercent)*(0xffff/100);
+  speedR = speed+pid;
+  speedL = speed-pid;
+  if (speedL>0xFFFF) {
+    speedL = 0xFFFF;
+  } else if (speedL<0) {
+    speedL = 0;
+  }
+  if (speedR>0xFFFF) {
+    speedR = 0xFFFF;
+  } else if (speedR<0) {
+    speedR = 0;
+  }
+  MOT_SetVal(MOT_GetMotorHandle(MOT_MOTOR_LEFT), 0xFFFF-speedL);
+  MOT_SetDirection(MOT_GetMotorHandle(MOT_MOTOR_LEFT), MOT_DIR_FORWARD);
+  MOT_SetVal(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), 0xFFFF-speedR);
+  MOT_SetDirection(MOT_GetMotorHandle(MOT_MOTOR_RIGHT), MOT_DIR_FORWARD);
+}
+
+static double NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec*1e9+(double)ts.tv_nsec;
+}
+
+/* synthetic measurement around the set value, as in 'pid bench' */
+#define BENCH_VAL(i, amplitude)  ((((i)*37)%(2*(amplitude)+1))-(amplitude))
+
+static void Bench(void) {
+  PID_Config *config, old;
+  double start, tOld, tNew;
+  int i;
+
+  printf("ns per iteration, previous integer and fixed point core:\n");
+  config = SetConfig(PID_CONFIG_POS_LEFT, 100, 5, 0, 200, 0, 0xffff/1000, 0, 40); /* as in Application.c */
+  old = *config;
+  start = NowNs();
+  for(i=0; i<nofIterations; i++) {
+    OldPos(BENCH_VAL(i, 500), 0, &old);
+    sink += motors[MOT_MOTOR_LEFT].currPWMvalue;
+  }
+  tOld = (NowNs()-start)/nofIterations;
+  start = NowNs();
+  for(i=0; i<nofIterations; i++) {
+    PID_Pos(BENCH_VAL(i, 500), 0, TRUE, TRUE);
+    sink += motors[MOT_MOTOR_LEFT].currPWMvalue;
+  }
+  tNew = (NowNs()-start)/nofIterations;
+  printf("  pos:   %6.2f %6.2f\n", tOld, tNew);
+
+  config = SetConfig(PID_CONFIG_SPEED_LEFT, 2000, 80, 0, 120000, 0, 0xffff, 0, 100);
+  old = *config;
+  start = NowNs();
+  for(i=0; i<nofIterations; i++) {
+    OldSpeed(BENCH_VAL(i, 3000), 1000, &old);
+    sink += motors[MOT_MOTOR_LEFT].currPWMvalue;
+  }
+  tOld = (NowNs()-start)/nofIterations;
+  start = NowNs();
+  for(i=0; i<nofIterations; i++) {
+    PID_Speed(BENCH_VAL(i, 3000), 1000, TRUE, TRUE);
+    sink += motors[MOT_MOTOR_LEFT].currPWMvalue;
+  }
+  tNew = (NowNs()-start)/nofIterations;
+  printf("  speed: %6.2f %6.2f\n", tOld, tNew);
+
+  config = SetConfig(PID_CONFIG_LINE_FW, 5500, 15, 100, 100000, 0, 0xffff, 0, 50);
+  old = *config;
+  start = NowNs();
+  for(i=0; i<nofIterations; i++) {
+    OldLine((uint16_t)(3000+BENCH_VAL(i, 2000)), 3000, &old);
+    sink += motors[MOT_MOTOR_LEFT].currPWMvalue;
+  }
+  tOld = (NowNs()-start)/nofIterations;
+  start = NowNs();
+  for(i=0; i<nofIterations; i++) {
+    PID_Line((uint16_t)(3000+BENCH_VAL(i, 2000)), 3000, 1000, TRUE);
+    sink += motors[MOT_MOTOR_LEFT].currPWMvalue;
+  }
+  tNew = (NowNs()-start)/nofIterations;
+  printf("  line:  %6.2f %6.2f\n", tOld, tNew);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc>1) {
+    nofIterations = atoi(argv[1]);
+  }
+  PID_Init();
+  TestP();
+  TestI();
+  TestD();
+  TestFeedForward();
+  TestBackCalculation();
+  TestSetValueUpdate();
+  TestSpeedLoop();
+  TestPosLoop();
+  TestLineLoop();
+  TestModel();
+  TestIntegerEquivalence();
+  if (nofFailed==0) {
+    Bench();
+  }
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0?0:1;
+}
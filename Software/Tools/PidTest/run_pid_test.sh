@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds and runs the unit tests of the fixed point PID and the benchmark against the previous
+# integer PID, for the position, speed and line loops.
+# Usage: ./run_pid_test.sh [nofIterations]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$R -I$M/src -I$M/config"
+SRC="pid_test.c $R/Pid.c"
+
+gcc $CFLAGS -o $OUT/pid_test $SRC -lm
+$OUT/pid_test "$@"
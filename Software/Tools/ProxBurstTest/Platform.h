@@ -0,0 +1,27 @@
+/**
+ * \file
+ * \brief Host platform configuration for the proximity burst decoder test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Proximity.c: the scan is run by the burst
+ * timer interrupt and decoded by PROX_Process() as in the executive, without the RTOS tasks, the
+ * shell and the consumers of the result.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (0)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (0)
+#define PL_CONFIG_HAS_DLOG           (0)
+#define PL_CONFIG_HAS_EXEC           (1)
+#define PL_CONFIG_HAS_PROXIMITY      (1)
+#define PL_CONFIG_HAS_TRACKER        (0)
+#define PL_CONFIG_HAS_SUMO           (0)
+
+#endif /* SRC_PLATFORM_H_ */
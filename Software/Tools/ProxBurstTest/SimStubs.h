@@ -0,0 +1,29 @@
+/**
+ * \file
+ * \brief Host stubs of FreeRTOS and the cycle counter for the proximity burst decoder test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of FreeRTOS.h and
+ * McuArmTools.h, so RoboLib/Proximity.c is compiled unchanged with the pin and timer interface of
+ * Tools/RoboSim. The cycle counter, the pins and the burst timer are implemented in
+ * prox_burst_test.c on its own virtual time.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define INC_FREERTOS_H
+#define __McuArmTools_H
+
+/* FreeRTOS: what the burst timer interrupt uses, there is no task to wake up in the executive */
+#define configCPU_CLOCK_HZ     (64000000) /* the cycle counter runs with this clock */
+typedef long BaseType_t;
+#define pdFALSE                (0)
+#define portYIELD_FROM_ISR(x)  (void)(x)
+
+/* McuArmTools */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,288 @@
+/**
+ * \file
+ * \brief Host test of the proximity burst decoder with synthetic receiver traces
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Proximity.c (compiled unchanged) on a virtual time in microseconds, with models of
+ * the IR sender select pin, of the three receivers and of the burst timer (TIM17). The burst timer
+ * interrupt runs when it is due, PROX_Process() is called every ms as in the executive.
+ * A receiver sees the reflection (active LOW) once the selected sender has been on for the
+ * threshold of the sender/receiver pair, so a pair counts the burst levels at least as long as its
+ * threshold: the shorter the threshold, the stronger the reflection.
+ * - Scenes: scripted thresholds (nothing, ahead, left, right, both sides but not in the middle,
+ *   only the crossed pairs) for several scans each. The counts, bits, raw bearing and if a target
+ *   has been found have to match the scene, the filtered bearing and intensities the low pass
+ *   filter of the module.
+ * - Noise: thresholds with jitter and random ambient IR glitches, the filtered bearing has to
+ *   follow the filter and vary less than the raw bearing.
+ * - Timing: the burst durations and senders seen at the receiver samples, the scan timestamp, no
+ *   lost scan and the delay until PROX_GetResult() returns the scan.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../RoboSim -I../../RoboLib -I../../McuLib/src
+ *          -I../../McuLib/config -o prox_burst_test prox_burst_test.c ../../RoboLib/Proximity.c
+ *          ../../RoboLib/SensorBus.c -lm
+ * Usage: prox_burst_test [seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Platform.h"
+#include "Proximity.h"
+#include "Pin.h"
+#include "Timer.h"
+
+#define CYCLES_PER_US      (configCPU_CLOCK_HZ/1000000)
+#define US_PER_MS          (1000)
+#define NOF_LEVELS         (5)               /* PROX_NOF_LEVELS of Proximity.c */
+#define SLOT_US            (1000)            /* PROX_SLOT_US of Proximity.c */
+#define SCAN_US            (2*NOF_LEVELS*SLOT_US)
+#define SCANS_PER_SCENE    (8)
+#define NOF_NOISE_SCANS    (200)
+#define NOISE_JITTER_US    (60)              /* threshold jitter of the noise scene, +/- */
+#define NOISE_GLITCH_PCT   (2)               /* probability of an ambient IR glitch per receiver sample */
+#define NEVER              (0xffff)          /* no reflection */
+#define SENDER_LEFT        (0)
+#define SENDER_RIGHT       (1)
+
+static const uint16_t levelsUs[NOF_LEVELS] = {50, 100, 200, 350, 500}; /* PROX_durationBurstUs */
+
+typedef struct {
+  const char *name;
+  uint16_t thresholdUs[2][PROX_NOF_SENSORS]; /* [sender][receiver]: burst needed to see the reflection */
+  bool found;     /* expected result of the scan */
+  int rawAngle;
+  int bits;
+} Scene;
+
+static const Scene scenes[] = {
+  {"nothing",    {{NEVER, NEVER, NEVER}, {NEVER, NEVER, NEVER}}, false,   0, 0},
+  {"ahead",      {{NEVER,    40, NEVER}, {NEVER,    40, NEVER}}, true,    0, PROX_L_MIDDLE_BIT|PROX_R_MIDDLE_BIT},
+  {"left",       {{  150,   400, NEVER}, {NEVER, NEVER, NEVER}}, true,  -70, PROX_L_LEFT_BIT|PROX_L_MIDDLE_BIT},
+  {"half left",  {{  100,   200, NEVER}, {NEVER,   400, NEVER}}, true,  -47, PROX_L_LEFT_BIT|PROX_L_MIDDLE_BIT|PROX_R_MIDDLE_BIT},
+  {"right",      {{NEVER, NEVER, NEVER}, {NEVER,   250,    75}}, true,   63, PROX_R_MIDDLE_BIT|PROX_R_RIGHT_BIT},
+  {"both sides", {{   40, NEVER, NEVER}, {NEVER, NEVER,    40}}, false,   0, PROX_L_LEFT_BIT|PROX_R_RIGHT_BIT},
+  {"crossed",    {{NEVER, NEVER,    40}, {   40, NEVER, NEVER}}, false,   0, PROX_L_RIGHT_BIT|PROX_R_LEFT_BIT},
+  {"nothing",    {{NEVER, NEVER, NEVER}, {NEVER, NEVER, NEVER}}, false,   0, 0},
+};
+#define NOF_SCENES  (sizeof(scenes)/sizeof(scenes[0]))
+
+static const Scene noise = /* target ahead, a bit to the left */
+  {"noise",      {{NEVER,   150, NEVER}, {NEVER,   250, NEVER}}, true,    0, 0};
+
+static unsigned int nofFailed = 0;
+
+/* virtual time */
+static uint64_t simUs;
+
+/* sender select pin and receivers */
+static int sender;             /* selected sender */
+static uint64_t senderOnUs;    /* time when the sender has been selected */
+static uint64_t lastSampleUs;  /* time of the last receiver sample */
+static unsigned int nofBursts; /* bursts sampled in the current scan */
+static unsigned int nofBadBursts;
+
+/* burst timer */
+static bool tmrpEnabled;
+static uint64_t tmrpDueUs;
+
+/* reference model of the low pass filter of Proximity.c */
+static struct {
+  bool found;
+  int angle;
+  int32_t intensity[PROX_NOF_SENSORS];
+} model;
+
+static void Check(bool ok, const char *what, const char *scene, unsigned int scanNo) {
+  if (!ok) {
+    printf("FAILED: %s: scan %u: %s\n", scene, scanNo, what);
+    nofFailed++;
+  }
+}
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return (uint32_t)(simUs*CYCLES_PER_US);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* scene of the scan running at the virtual time, the scenes change at the scan boundaries */
+static const Scene *SceneAt(uint64_t us) {
+  uint64_t scan = us/SCAN_US;
+
+  if (scan<NOF_SCENES*SCANS_PER_SCENE) {
+    return &scenes[scan/SCANS_PER_SCENE];
+  }
+  return &noise;
+}
+
+static int Receiver(Pin_PinId pin) {
+  switch(pin) {
+    case PIN_PROX_L: return 0;
+    case PIN_PROX_M: return 1;
+    case PIN_PROX_R: return 2;
+    default: return -1;
+  }
+}
+
+void PIN_SetHigh(Pin_PinId pin) {
+  if (pin==PIN_PROX_IR_SELECT) {
+    sender = SENDER_LEFT;
+    senderOnUs = simUs;
+  }
+}
+
+void PIN_SetLow(Pin_PinId pin) {
+  if (pin==PIN_PROX_IR_SELECT) {
+    sender = SENDER_RIGHT;
+    senderOnUs = simUs;
+  }
+}
+
+bool PIN_IsPinLow(Pin_PinId pin) {
+  const Scene *scene = SceneAt(simUs);
+  uint64_t onUs = simUs-senderOnUs;
+  int rx = Receiver(pin), threshold;
+
+  if (rx<0) {
+    return false;
+  }
+  if (simUs!=lastSampleUs) { /* first receiver of a new burst: check duration and sender */
+    lastSampleUs = simUs;
+    if (onUs!=levelsUs[(nofBursts/2)%NOF_LEVELS] || sender!=(int)(nofBursts%2)) {
+      nofBadBursts++;
+    }
+    nofBursts++;
+  }
+  threshold = scene->thresholdUs[sender][rx];
+  if (scene==&noise) {
+    if (rand()%100<NOISE_GLITCH_PCT) {
+      return true; /* ambient IR */
+    }
+    if (threshold!=NEVER) {
+      threshold += rand()%(2*NOISE_JITTER_US+1)-NOISE_JITTER_US;
+    }
+  }
+  return onUs>=(uint64_t)threshold;
+}
+
+void TMRP_StartInterrupts(uint16_t us) {
+  tmrpEnabled = true;
+  tmrpDueUs = simUs+us;
+}
+
+void TMRP_StopInterrupts(void) {
+  tmrpEnabled = false;
+}
+
+void TMRP_SetInterval(uint16_t us) { /* called from the interrupt: next event after 'us' */
+  tmrpDueUs = simUs+us;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static uint8_t ExpectedCount(uint16_t thresholdUs) {
+  uint8_t count = 0;
+  int i;
+
+  for(i=0; i<NOF_LEVELS; i++) {
+    if (levelsUs[i]>=thresholdUs) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/* the filter of Proximity.c, applied to the counts of the result */
+static void ModelFilter(const PROX_Result *result) {
+  int32_t raw;
+  int i;
+
+  for(i=0; i<PROX_NOF_SENSORS; i++) {
+    raw = ((result->countsLeft[i]+result->countsRight[i])*100)/(2*NOF_LEVELS);
+    model.intensity[i] += ((raw<<2)-model.intensity[i])>>2;
+  }
+  if (result->proximityFound) {
+    model.angle = model.found?model.angle+(result->rawAngle-model.angle)/2:result->rawAngle;
+  }
+  model.found = result->proximityFound;
+}
+
+static void CheckScan(const PROX_Result *result, const SBUS_Stamp *stamp, unsigned int scanNo) {
+  const Scene *scene = SceneAt((uint64_t)(scanNo-1)*SCAN_US);
+  bool counts = true, intensity = true;
+  int i;
+
+  Check(result->scanNo==scanNo && stamp->version==scanNo, "scan number or version", scene->name, scanNo);
+  Check(result->timestamp==(uint32_t)((uint64_t)scanNo*SCAN_US*CYCLES_PER_US), "timestamp not at the end of the scan", scene->name, scanNo);
+  Check(simUs-result->timestamp/CYCLES_PER_US<US_PER_MS, "result later than one cycle after the scan", scene->name, scanNo);
+  ModelFilter(result);
+  for(i=0; i<PROX_NOF_SENSORS; i++) {
+    if (scene!=&noise && (result->countsLeft[i]!=ExpectedCount(scene->thresholdUs[SENDER_LEFT][i])
+                       || result->countsRight[i]!=ExpectedCount(scene->thresholdUs[SENDER_RIGHT][i]))) {
+      counts = false;
+    }
+    if (result->intensity[i]!=(uint8_t)(model.intensity[i]>>2)) {
+      intensity = false;
+    }
+  }
+  if (scene!=&noise) {
+    Check(counts, "counts", scene->name, scanNo);
+    Check(result->proximityBits==scene->bits, "bits", scene->name, scanNo);
+    Check(result->proximityFound==scene->found, "target found", scene->name, scanNo);
+    Check(result->rawAngle==scene->rawAngle, "raw bearing", scene->name, scanNo);
+  }
+  Check(intensity, "filtered intensity", scene->name, scanNo);
+  Check(result->proximityAngle==model.angle, "filtered bearing", scene->name, scanNo);
+}
+
+int main(int argc, char *argv[]) {
+  const uint64_t endUs = (uint64_t)(NOF_SCENES*SCANS_PER_SCENE+NOF_NOISE_SCANS)*SCAN_US;
+  PROX_Result result;
+  SBUS_Stamp stamp;
+  uint32_t lastVersion = 0;
+  unsigned int nofScans = 0, nofNoise = 0, nofNoiseFound = 0;
+  double rawSum = 0, rawSum2 = 0, filtSum = 0, filtSum2 = 0, rawStd, filtStd;
+
+  srand(argc>1?(unsigned int)atoi(argv[1]):1);
+  memset(&model, 0, sizeof(model));
+  PROX_Init();
+  Check(!PROX_GetResult(&result, &stamp) && stamp.version==0, "result before the first scan", "init", 0);
+  for(simUs=0; simUs<=endUs; simUs++) {
+    if (tmrpEnabled && simUs==tmrpDueUs) {
+      PROX_OnBurstTimerInterrupt();
+    }
+    if (simUs%US_PER_MS!=0) {
+      continue;
+    }
+    PROX_Process(); /* sense stage of the executive */
+    if (!PROX_GetResult(&result, &stamp) || stamp.version==lastVersion) {
+      continue;
+    }
+    nofScans++;
+    Check(stamp.version==lastVersion+1, "scan lost", SceneAt(simUs-1)->name, nofScans);
+    lastVersion = stamp.version;
+    CheckScan(&result, &stamp, nofScans);
+    if (SceneAt(simUs-1)==&noise) {
+      nofNoise++;
+      if (result.proximityFound) {
+        nofNoiseFound++;
+      }
+      rawSum += result.rawAngle;
+      rawSum2 += (double)result.rawAngle*result.rawAngle;
+      filtSum += result.proximityAngle;
+      filtSum2 += (double)result.proximityAngle*result.proximityAngle;
+    }
+  }
+  rawStd = sqrt(rawSum2/nofNoise-(rawSum/nofNoise)*(rawSum/nofNoise));
+  filtStd = sqrt(filtSum2/nofNoise-(filtSum/nofNoise)*(filtSum/nofNoise));
+  printf("%u scans in %u ms (%u scans/s), %u bursts, %u with a wrong duration or sender\n",
+      nofScans, (unsigned int)(endUs/US_PER_MS), (unsigned int)(nofScans*1000ULL*US_PER_MS/endUs), nofBursts, nofBadBursts);
+  printf("noise: %u scans, target found in %u, bearing mean %.1f, std deviation raw %.1f, filtered %.1f\n",
+      nofNoise, nofNoiseFound, filtSum/nofNoise, rawStd, filtStd);
+  Check(nofScans==NOF_SCENES*SCANS_PER_SCENE+NOF_NOISE_SCANS, "number of scans", "all", nofScans);
+  Check(nofBadBursts==0, "burst duration or sender", "all", nofScans);
+  Check(nofNoiseFound==nofNoise, "target lost in the noise", noise.name, nofScans);
+  Check(filtStd<rawStd, "filtered bearing not steadier than the raw one", noise.name, nofScans);
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0?0:1;
+}
@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the proximity burst decoder test with synthetic receiver traces.
+# Usage: ./run_prox_burst_test.sh [seed]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I../RoboSim -I$R -I$M/src -I$M/config"
+SRC="prox_burst_test.c $R/Proximity.c $R/SensorBus.c"
+
+gcc $CFLAGS -o $OUT/prox_burst_test $SRC -lm
+$OUT/prox_burst_test "$@"
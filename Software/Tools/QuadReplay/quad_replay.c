@@ -0,0 +1,371 @@
+/**
+ * \file
+ * \brief Replay of encoder recordings through the sampled and the edge quadrature decoder
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Quadrature.c (compiled unchanged) with a recording of the C1 and C2 pins of the left
+ * encoder, once as QUAD_CONFIG_DECODER_SAMPLED does it (QUAD_Sample() every 100 us) and once as
+ * QUAD_CONFIG_DECODER_EDGE does it (QUAD_OnEdgeInterrupt() for each pin change). The position of
+ * each decoder is compared with the position of the recording, the difference are the missed steps.
+ *
+ * The recordings are generated from a motor with a magnetic encoder of 12 steps per revolution
+ * (75:1 gear and 32 mm wheels, about the 8985 steps per meter of the odometry): it accelerates to
+ * the given RPM, holds it, decelerates and reverses to the half of it, then stops, with a ripple of
+ * 2% on the speed. The channels are
+ * not ideal: C1 is 0.08 periods late and has 3% more duty cycle, so the shortest time between two
+ * edges is 0.14 periods instead of 0.25.
+ * The edge interrupts are modeled as on the robot: each pin has its own interrupt line, one line is
+ * served at a time, starting ISR_ENTRY_NS after the edge or after the previous one, the pins are read
+ * ISR_READ_NS later and the line is busy for ISR_NS. Every ms the interrupts are masked for
+ * MASKED_NS, by a critical section on the level of the encoder interrupts.
+ *
+ * Without a file, the RPM are swept and the missed steps of both decoders are printed. The edge
+ * decoder must not miss a step at any speed, the sampled one not up to the top speed of the robot
+ * (about 4000 steps per second, 20000 RPM).
+ * A recording is a CSV file 'time_s,C1,C2' as the logic analyzers export it, lines which do not
+ * start with a number (headers) are skipped.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src
+ *          -I../../McuLib/config -I../../McuLib/FreeRTOS/Source/include -I../../Projects/F303K8/Board
+ *          -o quad_replay quad_replay.c ../../RoboLib/Quadrature.c ../../RoboLib/SensorBus.c -lm
+ * Usage: quad_replay                   RPM sweep with generated recordings
+ *        quad_replay -w <file> <rpm>   writes the generated recording of one RPM
+ *        quad_replay <file>            replays a recording
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Platform.h"
+#include "Quadrature.h"
+
+#define STEPS_PER_REV     (12)      /* encoder steps per motor revolution */
+#define PHASE_ERR         (0.08)    /* C1 is late by this part of a period */
+#define DUTY_ERR          (0.03)    /* C1 is high longer by this part of a period */
+#define RIPPLE            (0.02)    /* speed ripple of the motor... */
+#define RIPPLE_HZ         (37.0)    /* ...with this frequency, so the steps do not lock to the sampling */
+#define GEN_STEP_NS       (100)     /* resolution of the generated recordings */
+
+#define SAMPLE_NS         (100000)  /* 10 kHz sampling timer */
+#define ISR_ENTRY_NS      (200)     /* interrupt entry, with the tail chaining of the NVIC */
+#define ISR_READ_NS       (250)     /* from the entry to the read of the pins */
+#define ISR_NS            (900)     /* interrupt line busy, entry to return */
+#define MASKED_PERIOD_NS  (1000000) /* masked every ms... */
+#define MASKED_NS         (2000)    /* ...for this time */
+
+#define ROBOT_MAX_RPM     (20000)   /* top speed of the robot, about 4000 steps per second */
+
+typedef struct {
+  uint64_t ns;   /* time of the change */
+  uint8_t pins;  /* bit 1 is C1, bit 0 is C2, after the change */
+} Edge;
+
+typedef struct {
+  Edge *edges;
+  size_t nofEdges, size;
+  uint8_t startPins;  /* pins before the first edge */
+  int32_t pos;        /* position at the end, counted from the recording */
+} Recording;
+
+typedef struct {
+  int32_t missed;      /* steps difference to the recording at the end */
+  uint32_t errors;     /* errors counted by the decoder */
+  uint64_t maxLatency; /* edge decoder: longest time from an edge to the read of the pins */
+} Result;
+
+uint8_t SIM_encPins[2];
+static uint64_t simNs; /* replay time */
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return (uint32_t)(simNs*(configCPU_CLOCK_HZ/1000000)/1000);
+}
+
+/* quadrature index of the pins, in the counting direction of the decoder */
+static int QuadIndex(uint8_t pins) {
+  static const int index[4] = {0, 1, 3, 2}; /* 00, 01, 11, 10 */
+
+  return index[pins&3];
+}
+
+static void AddEdge(Recording *rec, uint64_t ns, uint8_t pins) {
+  uint8_t prev = rec->nofEdges==0?rec->startPins:rec->edges[rec->nofEdges-1].pins;
+  int diff;
+
+  if (pins==prev) {
+    return;
+  }
+  if (rec->nofEdges==rec->size) {
+    rec->size = rec->size==0?1024:rec->size*2;
+    rec->edges = realloc(rec->edges, rec->size*sizeof(Edge));
+    if (rec->edges==NULL) {
+      perror("quad_replay");
+      exit(1);
+    }
+  }
+  rec->edges[rec->nofEdges].ns = ns;
+  rec->edges[rec->nofEdges].pins = pins;
+  rec->nofEdges++;
+  diff = (QuadIndex(pins)-QuadIndex(prev))&3;
+  if (diff==1) {
+    rec->pos++;
+  } else if (diff==3) {
+    rec->pos--;
+  } /* both channels at once: not a step, the decoders count an error */
+}
+
+/* pins of the encoder at a position, in steps */
+static uint8_t EncoderPins(double pos) {
+  double f = pos/4.0-floor(pos/4.0); /* part of the period */
+  uint8_t pins = 0;
+
+  if (f<0.5) {
+    pins |= 1; /* C2 */
+  }
+  if (f>=0.25+PHASE_ERR && f<0.75+PHASE_ERR+DUTY_ERR) {
+    pins |= 2; /* C1 */
+  }
+  return pins;
+}
+
+/* speed profile in RPM: up, hold, down and reverse to the half, hold, stop */
+static double ProfileRpm(double rpm, double t) {
+  if (t<0.04) {
+    return rpm*t/0.04;
+  } else if (t<0.14) {
+    return rpm;
+  } else if (t<0.20) {
+    return rpm-1.5*rpm*(t-0.14)/0.06;
+  } else if (t<0.24) {
+    return -rpm/2;
+  } else if (t<0.26) {
+    return -rpm/2+rpm/2*(t-0.24)/0.02;
+  }
+  return 0;
+}
+
+static void Generate(Recording *rec, double rpm) {
+  double pos = 0.5; /* in the middle of a step */
+  uint64_t ns;
+
+  memset(rec, 0, sizeof(*rec));
+  rec->startPins = EncoderPins(pos);
+  for(ns=0; ns<270000000ULL; ns+=GEN_STEP_NS) {
+    pos += ProfileRpm(rpm, ns*1e-9)*(1.0+RIPPLE*sin(2*M_PI*RIPPLE_HZ*ns*1e-9))*STEPS_PER_REV/60.0*GEN_STEP_NS*1e-9;
+    AddEdge(rec, ns, EncoderPins(pos));
+  }
+}
+
+static int Read(Recording *rec, const char *fileName) {
+  FILE *f = fopen(fileName, "r");
+  char line[256];
+  double t;
+  int c1, c2;
+  bool first = true;
+
+  if (f==NULL) {
+    perror(fileName);
+    return -1;
+  }
+  memset(rec, 0, sizeof(*rec));
+  while (fgets(line, sizeof(line), f)!=NULL) {
+    if (sscanf(line, "%lf,%d,%d", &t, &c1, &c2)!=3) {
+      continue; /* header */
+    }
+    if (first) {
+      rec->startPins = (uint8_t)((c1!=0?2:0)|(c2!=0?1:0));
+      first = false;
+    }
+    AddEdge(rec, (uint64_t)llround(t*1e9), (uint8_t)((c1!=0?2:0)|(c2!=0?1:0)));
+  }
+  fclose(f);
+  if (first) {
+    fprintf(stderr, "%s: no samples\n", fileName);
+    return -1;
+  }
+  return 0;
+}
+
+static int Write(const Recording *rec, const char *fileName) {
+  FILE *f = fopen(fileName, "w");
+  size_t i;
+
+  if (f==NULL) {
+    perror(fileName);
+    return -1;
+  }
+  fprintf(f, "time_s,C1,C2\n");
+  fprintf(f, "0.000000000,%d,%d\n", (rec->startPins>>1)&1, rec->startPins&1);
+  for(i=0; i<rec->nofEdges; i++) {
+    fprintf(f, "%.9f,%d,%d\n", rec->edges[i].ns*1e-9, (rec->edges[i].pins>>1)&1, rec->edges[i].pins&1);
+  }
+  fclose(f);
+  return 0;
+}
+
+static void StartDecoder(const Recording *rec) {
+  simNs = 0;
+  SIM_encPins[0] = rec->startPins;
+  SIM_encPins[1] = 0;
+  QUAD_Init(); /* takes the pins as the last state */
+}
+
+static void EndDecoder(const Recording *rec, Result *res) {
+  res->missed = (int32_t)(rec->pos-(int32_t)QUAD_GetLeftPos());
+  if (res->missed<0) {
+    res->missed = -res->missed;
+  }
+  res->errors = QUAD_NofLeftErrors();
+}
+
+static void ReplaySampled(const Recording *rec, Result *res) {
+  size_t i = 0;
+  uint64_t end = rec->nofEdges==0?0:rec->edges[rec->nofEdges-1].ns;
+
+  memset(res, 0, sizeof(*res));
+  StartDecoder(rec);
+  for(simNs=SAMPLE_NS; simNs<=end+SAMPLE_NS; simNs+=SAMPLE_NS) {
+    while (i<rec->nofEdges && rec->edges[i].ns<=simNs) {
+      SIM_encPins[0] = rec->edges[i].pins;
+      i++;
+    }
+    QUAD_Sample();
+  }
+  EndDecoder(rec, res);
+}
+
+/* start of an interrupt, not in a masked window */
+static uint64_t IsrStart(uint64_t ns) {
+  if (ns%MASKED_PERIOD_NS<MASKED_NS) {
+    ns += MASKED_NS-ns%MASKED_PERIOD_NS;
+  }
+  return ns;
+}
+
+static void ReplayEdge(const Recording *rec, Result *res) {
+  uint64_t pendingNs[2]; /* C1 and C2 interrupt lines: time of the first edge not served yet */
+  bool pending[2] = {false, false};
+  uint64_t busyUntil = 0, start;
+  size_t i = 0;
+  int line;
+
+  memset(res, 0, sizeof(*res));
+  StartDecoder(rec);
+  for(;;) {
+    /* next line to serve: the one with the oldest edge, C1 first */
+    line = -1;
+    if (pending[0] && (!pending[1] || pendingNs[0]<=pendingNs[1])) {
+      line = 0;
+    } else if (pending[1]) {
+      line = 1;
+    }
+    start = 0;
+    if (line>=0) {
+      start = pendingNs[line]+ISR_ENTRY_NS;
+      if (start<busyUntil) {
+        start = busyUntil;
+      }
+      start = IsrStart(start);
+    }
+    if (line>=0 && (i==rec->nofEdges || start+ISR_READ_NS<rec->edges[i].ns)) {
+      pending[line] = false; /* cleared at the entry */
+      simNs = start+ISR_READ_NS;
+      if (simNs-pendingNs[line]>res->maxLatency) {
+        res->maxLatency = simNs-pendingNs[line];
+      }
+      QUAD_OnEdgeInterrupt(true);
+      busyUntil = start+ISR_NS;
+    } else if (i<rec->nofEdges) { /* next edge, before the next read of the pins */
+      uint8_t changed = (uint8_t)(SIM_encPins[0]^rec->edges[i].pins);
+
+      SIM_encPins[0] = rec->edges[i].pins;
+      if ((changed&2) && !pending[0]) {
+        pending[0] = true;
+        pendingNs[0] = rec->edges[i].ns;
+      }
+      if ((changed&1) && !pending[1]) {
+        pending[1] = true;
+        pendingNs[1] = rec->edges[i].ns;
+      }
+      i++;
+    } else {
+      break;
+    }
+  }
+  EndDecoder(rec, res);
+}
+
+static void PrintHeader(void) {
+  printf("  rpm  steps/s    pos  | sampled: missed  errors | edge: missed  errors  max latency\n");
+}
+
+static void PrintResult(double rpm, const Recording *rec, const Result *sampled, const Result *edge) {
+  if (rpm>0) {
+    printf("%6.0f %7.0f", rpm, rpm*STEPS_PER_REV/60.0);
+  } else { /* recording from a file */
+    printf("     -       -");
+  }
+  printf(" %6ld  |          %6ld  %6lu |       %6ld  %6lu  %8.2f us\n",
+    (long)rec->pos,
+    (long)sampled->missed, (unsigned long)sampled->errors,
+    (long)edge->missed, (unsigned long)edge->errors, edge->maxLatency/1000.0);
+}
+
+static int Sweep(void) {
+  static const double rpms[] = {5000, 10000, 15000, 20000, 25000, 30000, 40000, 60000, 80000};
+  Recording rec;
+  Result sampled, edge;
+  unsigned int i, nofFailed = 0;
+  double sampledLimit = 0;
+  bool sampledMissed = false;
+
+  PrintHeader();
+  for(i=0; i<sizeof(rpms)/sizeof(rpms[0]); i++) {
+    Generate(&rec, rpms[i]);
+    ReplaySampled(&rec, &sampled);
+    ReplayEdge(&rec, &edge);
+    PrintResult(rpms[i], &rec, &sampled, &edge);
+    if (edge.missed!=0 || edge.errors!=0) {
+      printf("FAILED: edge decoder missed steps at %.0f RPM\n", rpms[i]);
+      nofFailed++;
+    }
+    if (rpms[i]<=ROBOT_MAX_RPM && (sampled.missed!=0 || sampled.errors!=0)) {
+      printf("FAILED: sampled decoder missed steps at %.0f RPM\n", rpms[i]);
+      nofFailed++;
+    }
+    if (sampled.missed!=0 || sampled.errors!=0) {
+      sampledMissed = true;
+    } else if (!sampledMissed) {
+      sampledLimit = rpms[i];
+    }
+    free(rec.edges);
+  }
+  printf("sampled decoder without missed steps up to %.0f RPM, edge decoder up to %.0f RPM\n",
+    sampledLimit, rpms[i-1]);
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0?0:1;
+}
+
+int main(int argc, char *argv[]) {
+  Recording rec;
+  Result sampled, edge;
+
+  if (argc==1) {
+    return Sweep();
+  } else if (argc==4 && strcmp(argv[1], "-w")==0) {
+    Generate(&rec, atof(argv[3]));
+    return Write(&rec, argv[2])==0?0:1;
+  } else if (argc==2 && argv[1][0]!='-') {
+    if (Read(&rec, argv[1])!=0) {
+      return 1;
+    }
+    ReplaySampled(&rec, &sampled);
+    ReplayEdge(&rec, &edge);
+    printf("%lu edges, %.3f s\n", (unsigned long)rec.nofEdges, rec.nofEdges==0?0.0:rec.edges[rec.nofEdges-1].ns*1e-9);
+    PrintHeader();
+    PrintResult(0, &rec, &sampled, &edge);
+    return 0;
+  }
+  fprintf(stderr, "usage: %s [-w <file> <rpm> | <file>]\n", argv[0]);
+  return 1;
+}
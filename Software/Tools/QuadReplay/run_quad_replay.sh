@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds and runs the replay of generated encoder recordings through the sampled and the edge
+# quadrature decoder, with the missed steps over the RPM.
+# Usage: ./run_quad_replay.sh [-w <file> <rpm> | <file>]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/FreeRTOS/Source/include -I../../Projects/F303K8/Board"
+SRC="quad_replay.c $R/Quadrature.c $R/SensorBus.c"
+
+gcc $CFLAGS -o $OUT/quad_replay $SRC -lm
+$OUT/quad_replay "$@"
@@ -0,0 +1,32 @@
+/**
+ * \file
+ * \brief Host platform configuration for the flight recorder test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Recorder.c: all the modules recorded
+ * are enabled, their state is provided by recorder_test.c. There is no shell, REC_Dump() prints
+ * to the I/O of the test.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (0)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (0)
+#define PL_CONFIG_HAS_EXEC           (0)
+#define PL_CONFIG_HAS_RECORDER       (1)
+#define PL_CONFIG_HAS_DRIVE          (1)
+#define PL_CONFIG_HAS_MOTOR          (1)
+#define PL_CONFIG_HAS_MOTOR_TACHO    (1)
+#define PL_CONFIG_HAS_QUADRATURE     (1)
+#define PL_CONFIG_HAS_POS_PID        (0)
+#define PL_CONFIG_HAS_REFLECTANCE    (1)
+#define PL_CONFIG_HAS_PROXIMITY      (1)
+#define PL_CONFIG_HAS_SUMO           (1)
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,41 @@
+/**
+ * \file
+ * \brief Host stubs of FreeRTOS, the cycle counter and the shell I/O for the flight recorder test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of FreeRTOS.h,
+ * task.h, McuArmTools.h and McuShell.h, so RoboLib/Recorder.c is compiled unchanged. The tick
+ * count, the cycle counter and McuShell_SendStr() are implemented in recorder_test.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define INC_FREERTOS_H
+#define INC_TASK_H
+#define __McuArmTools_H
+#define __McuShell_H
+
+/* FreeRTOS */
+#define configCPU_CLOCK_HZ     (64000000) /* the cycle counter runs with this clock */
+#define portTICK_PERIOD_MS     (1)
+typedef uint32_t TickType_t;
+TickType_t xTaskGetTickCount(void);
+
+/* McuArmTools */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+/* McuShell: output only */
+typedef void (*McuShell_StdIO_OutErr_FctType)(uint8_t);
+typedef struct {
+  void (*stdIn)(uint8_t *);
+  McuShell_StdIO_OutErr_FctType stdOut;
+  McuShell_StdIO_OutErr_FctType stdErr;
+  bool (*keyPressed)(void);
+} McuShell_StdIOType;
+void McuShell_SendStr(const uint8_t *str, McuShell_StdIO_OutErr_FctType io);
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,423 @@
+/**
+ * \file
+ * \brief Host test of the flight recorder and benchmark of the cost per sample
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Recorder.c (compiled unchanged) with the modules it records replaced by a robot
+ * state computed from the Drive task cycle number, so each dumped line can be checked against the
+ * cycle it has been recorded in. REC_Sample() is called once per cycle of 5 ms, as by the Drive task.
+ * - Startup: nothing can be dumped while recording.
+ * - Wrap and freeze: after several rounds of the ring buffer a trigger records REC_CONFIG_POST_SAMPLES
+ *   more samples, then the buffer is frozen: further cycles do not change it, the dump has the
+ *   samples oldest first with the trigger mark at its place.
+ * - Trigger mask and partial buffer: a masked trigger is marked but does not freeze.
+ * - Re-arming forgets the triggers from before.
+ * - Saturation of the speeds to 16 bits, and the lower 16 bits of the positions in position mode.
+ * - Benchmark: host time of REC_Sample() per sample, including the two reads of the host clock for
+ *   the cycle counter. The target reports its cycles with 'rec status'.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -I../../McuLib/FreeRTOS/Source/include
+ *          -o recorder_test recorder_test.c ../../RoboLib/Recorder.c ../../McuLib/src/McuUtility.c
+ * Usage: recorder_test [nofBenchSamples]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Platform.h"
+#include "Recorder.h"
+#include "Drive.h"
+#include "Motor.h"
+#include "Tacho.h"
+#include "Quadrature.h"
+#include "Reflectance.h"
+#include "Proximity.h"
+#include "Sumo.h"
+
+#define CYCLE_MS          (5)     /* period of the Drive task */
+#define DUMP_BUF_SIZE     (16*1024)
+#define HIST_BIN_NS       (10)    /* benchmark histogram: bins of 10 ns... */
+#define HIST_NOF_BINS     (1000)  /* ...up to 10 us, longer ones are preemptions of the host */
+#define MAX_FREEZE_CYCLES (REC_CONFIG_SAMPLE_DIV*(REC_CONFIG_POST_SAMPLES+1)) /* from the trigger until frozen */
+
+typedef enum {
+  STATE_SPEED,    /* speed mode, values within 16 bits */
+  STATE_SATURATE, /* speed mode, values outside of 16 bits */
+  STATE_POS,      /* position mode with positions outside of 16 bits */
+} StateKind;
+
+typedef struct { /* a line of the dump */
+  int ms;
+  unsigned int mode, behavior, state, white, prox, dir, marks;
+  int angle, set[2], actual[2];
+} Line;
+
+static unsigned int nofFailed = 0;
+static unsigned int cycle;      /* Drive task cycle */
+static StateKind kind;
+static MOT_MotorDevice motors[2];
+static char dump[DUMP_BUF_SIZE];
+static size_t dumpLen;
+static Line lines[REC_CONFIG_NOF_SAMPLES+1];
+
+static void Check(bool ok, const char *test, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s: %s\n", test, what);
+    nofFailed++;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* robot state at the current cycle */
+TickType_t xTaskGetTickCount(void) {
+  return cycle*CYCLE_MS;
+}
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((ts.tv_sec*1000000000ULL+ts.tv_nsec)*(configCPU_CLOCK_HZ/1000000)/1000);
+}
+
+bool REF_GetSnapshot(REF_Snapshot *snapshot, SBUS_Stamp *stamp) {
+  (void)stamp;
+  if (cycle%7==0) {
+    return false; /* no measurement yet */
+  }
+  snapshot->whiteBits = cycle&0xf;
+  return true;
+}
+
+bool PROX_GetResult(PROX_Result *result, SBUS_Stamp *stamp) {
+  (void)stamp;
+  result->proximityFound = cycle%3!=0;
+  result->proximityBits = (PROX_Bits)(cycle&0x3f);
+  result->proximityAngle = (int)(cycle%181)-90;
+  return true;
+}
+
+DRV_Mode DRV_GetMode(void) {
+  return kind==STATE_POS?DRV_MODE_POS:DRV_MODE_SPEED;
+}
+
+static int32_t SetValue(unsigned int c, bool left) {
+  switch(kind) {
+    case STATE_SATURATE: return left?100000+(int32_t)c:-100000-(int32_t)c;
+    case STATE_POS:      return left?0x12340000+(int32_t)c:-0x12340000-(int32_t)c;
+    default:             return left?(int32_t)c*3-500:-(int32_t)c;
+  }
+}
+
+static int32_t ActualValue(unsigned int c, bool left) {
+  switch(kind) {
+    case STATE_SATURATE: return left?40000:-40000;
+    case STATE_POS:      return SetValue(c, left)-(left?3:-3);
+    default:             return left?(int32_t)c*2:-(int32_t)c*2;
+  }
+}
+
+void DRV_GetSetValues(int32_t *left, int32_t *right) {
+  *left = SetValue(cycle, true);
+  *right = SetValue(cycle, false);
+}
+
+uint8_t SUMO_GetStateInfo(void) {
+  return (uint8_t)((cycle*5)&0x77);
+}
+
+MOT_MotorDevice *MOT_GetMotorHandle(MOT_MotorSide side) {
+  return &motors[side];
+}
+
+MOT_Direction MOT_GetDirection(MOT_MotorDevice *motor) {
+  unsigned int bit = motor==&motors[MOT_MOTOR_LEFT]?1:2;
+
+  return (cycle&bit)?MOT_DIR_BACKWARD:MOT_DIR_FORWARD;
+}
+
+int32_t TACHO_GetSpeed(bool isLeft) {
+  return ActualValue(cycle, isLeft);
+}
+
+QUAD_QuadCntrType QUAD_GetLeftPos(void) {
+  return (QUAD_QuadCntrType)ActualValue(cycle, true);
+}
+
+QUAD_QuadCntrType QUAD_GetRightPos(void) {
+  return (QUAD_QuadCntrType)ActualValue(cycle, false);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* dump */
+static void DumpOut(uint8_t ch) {
+  if (dumpLen<sizeof(dump)-1) {
+    dump[dumpLen++] = (char)ch;
+    dump[dumpLen] = '\0';
+  }
+}
+
+static const McuShell_StdIOType dumpIO = {NULL, DumpOut, DumpOut, NULL};
+
+void McuShell_SendStr(const uint8_t *str, McuShell_StdIO_OutErr_FctType io) {
+  while (*str!='\0') {
+    io(*str++);
+  }
+}
+
+/* dumps and parses the recording, returns the number of lines or -1 */
+static int Dump(void) {
+  char *p;
+  int n = 0;
+  Line *l;
+
+  dumpLen = 0;
+  dump[0] = '\0';
+  if (REC_Dump(&dumpIO)!=ERR_OK) {
+    return -1;
+  }
+  p = strstr(dump, "\r\n");
+  while (p!=NULL && p[2]!='\0' && n<=REC_CONFIG_NOF_SAMPLES) {
+    l = &lines[n];
+    if (sscanf(p+2, "%d,%u,%u,%u,%x,%x,%d,%u,%d,%d,%d,%d,%x", &l->ms, &l->mode, &l->behavior, &l->state,
+          &l->white, &l->prox, &l->angle, &l->dir, &l->set[0], &l->set[1], &l->actual[0], &l->actual[1], &l->marks)!=13) {
+      return -1;
+    }
+    n++;
+    p = strstr(p+2, "\r\n");
+  }
+  return n;
+}
+
+/* checks the dumped lines against the state of their cycles, the last line is from lastCycle */
+static void CheckLines(const char *test, int n, unsigned int lastCycle) {
+  unsigned int c, sumo;
+  bool ok = true;
+  int i;
+
+  for(i=0; i<n; i++) {
+    c = lastCycle-REC_CONFIG_SAMPLE_DIV*(n-1-i);
+    sumo = (c*5)&0x77;
+    if (lines[i].ms!=-(int)((lastCycle-c)*CYCLE_MS)
+        || lines[i].mode!=(kind==STATE_POS?DRV_MODE_POS:DRV_MODE_SPEED)
+        || lines[i].behavior!=(sumo&0x7) || lines[i].state!=((sumo>>4)&0x7)
+        || lines[i].white!=(c%7==0?0:(c&0xf))
+        || lines[i].prox!=(c%3!=0?(c&0x3f):0)
+        || lines[i].angle!=(c%3!=0?(int)(c%181)-90:0)
+        || lines[i].dir!=(c&3)
+        || lines[i].set[0]!=(kind==STATE_SATURATE?INT16_MAX:(kind==STATE_POS?(int16_t)SetValue(c, true):SetValue(c, true)))
+        || lines[i].set[1]!=(kind==STATE_SATURATE?INT16_MIN:(kind==STATE_POS?(int16_t)SetValue(c, false):SetValue(c, false)))
+        || lines[i].actual[0]!=(kind==STATE_SATURATE?INT16_MAX:(kind==STATE_POS?(int16_t)ActualValue(c, true):ActualValue(c, true)))
+        || lines[i].actual[1]!=(kind==STATE_SATURATE?INT16_MIN:(kind==STATE_POS?(int16_t)ActualValue(c, false):ActualValue(c, false)))) {
+      ok = false;
+    }
+  }
+  Check(ok, test, "dumped samples do not match the state of their cycles");
+}
+
+/* index of the line with the marks, -1 if none, -2 if other marks are found */
+static int MarkLine(int n, unsigned int marks) {
+  int i, found = -1;
+
+  for(i=0; i<n; i++) {
+    if (lines[i].marks==marks && found==-1) {
+      found = i;
+    } else if (lines[i].marks!=0) {
+      return -2;
+    }
+  }
+  return found;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void Cycle(void) {
+  cycle++;
+  REC_Sample();
+}
+
+/* runs cycles until frozen, returns the number of cycles or -1 */
+static int RunUntilFrozen(void) {
+  int i;
+
+  for(i=1; i<=MAX_FREEZE_CYCLES; i++) {
+    Cycle();
+    if (REC_IsFrozen()) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void Arm(void) {
+  REC_Arm();
+  Cycle(); /* the Drive task handles the request */
+}
+
+static void TestStartup(void) {
+  REC_Init();
+  Cycle();
+  Check(!REC_IsFrozen(), "startup", "not recording after the first cycle");
+  Check(Dump()==-1, "startup", "dump possible while recording");
+}
+
+static void TestWrapAndFreeze(void) {
+  char before[DUMP_BUF_SIZE];
+  unsigned int trigCycle;
+  int i, n, cycles;
+
+  kind = STATE_SPEED;
+  REC_SetTriggerMask(REC_TRIGGER_ALL);
+  Arm();
+  for(i=0; i<3*REC_CONFIG_SAMPLE_DIV*REC_CONFIG_NOF_SAMPLES+1; i++) {
+    Cycle();
+  }
+  Check(!REC_IsFrozen(), "wrap", "frozen without trigger");
+  trigCycle = cycle+1;
+  REC_Trigger(REC_TRIGGER_BORDER);
+  cycles = RunUntilFrozen();
+  Check(cycles>=REC_CONFIG_SAMPLE_DIV*REC_CONFIG_POST_SAMPLES+1, "wrap", "frozen too early or not at all");
+  n = Dump();
+  Check(n==REC_CONFIG_NOF_SAMPLES, "wrap", "not a full buffer");
+  if (n<=0) {
+    return;
+  }
+  CheckLines("wrap", n, cycle);
+  Check(MarkLine(n, REC_TRIGGER_BORDER)==n-1-REC_CONFIG_POST_SAMPLES, "wrap", "trigger mark not before the post samples");
+  Check(cycle-REC_CONFIG_SAMPLE_DIV*REC_CONFIG_POST_SAMPLES-trigCycle<REC_CONFIG_SAMPLE_DIV, "wrap", "trigger not recorded with the next sample");
+  memcpy(before, dump, dumpLen+1);
+  for(i=0; i<REC_CONFIG_NOF_SAMPLES; i++) {
+    Cycle();
+  }
+  REC_Trigger(REC_TRIGGER_MANUAL);
+  Cycle();
+  Check(REC_IsFrozen() && Dump()==n && strcmp(before, dump)==0, "wrap", "frozen buffer has changed");
+}
+
+static void TestMaskAndPartial(void) {
+  unsigned int armCycle;
+  int i, n, manual;
+
+  REC_SetTriggerMask(REC_TRIGGER_BORDER);
+  Arm();
+  armCycle = cycle;
+  for(i=0; i<10; i++) {
+    Cycle();
+  }
+  REC_Trigger(REC_TRIGGER_MANUAL); /* masked: marked only */
+  for(i=0; i<2*MAX_FREEZE_CYCLES; i++) {
+    Cycle();
+  }
+  Check(!REC_IsFrozen(), "mask", "frozen by a masked trigger");
+  REC_Trigger(REC_TRIGGER_BORDER|REC_TRIGGER_MANUAL);
+  Check(RunUntilFrozen()>0, "mask", "not frozen by the trigger");
+  n = Dump();
+  Check(n>0 && n<REC_CONFIG_NOF_SAMPLES, "mask", "not a partial buffer");
+  if (n<=0) {
+    return;
+  }
+  Check(n==(int)(cycle-armCycle+1)/REC_CONFIG_SAMPLE_DIV, "mask", "samples lost since the arm");
+  CheckLines("mask", n, cycle);
+  Check(lines[n-1-REC_CONFIG_POST_SAMPLES].marks==(REC_TRIGGER_BORDER|REC_TRIGGER_MANUAL), "mask", "trigger mark");
+  manual = -1;
+  for(i=0; i<n-1-REC_CONFIG_POST_SAMPLES; i++) {
+    if (lines[i].marks!=0) {
+      Check(manual==-1 && lines[i].marks==REC_TRIGGER_MANUAL, "mask", "unexpected marks");
+      manual = i;
+    }
+  }
+  Check(manual==(10+1)/REC_CONFIG_SAMPLE_DIV, "mask", "masked trigger not marked");
+}
+
+static void TestRearm(void) {
+  int i, n;
+
+  REC_SetTriggerMask(REC_TRIGGER_ALL);
+  REC_Trigger(REC_TRIGGER_BORDER); /* while frozen: forgotten by the arm */
+  Arm();
+  for(i=0; i<2*MAX_FREEZE_CYCLES; i++) {
+    Cycle();
+  }
+  Check(!REC_IsFrozen(), "rearm", "frozen by a trigger from before the arm");
+  REC_Trigger(REC_TRIGGER_SUMO_STOP);
+  Check(RunUntilFrozen()>0, "rearm", "not frozen by the trigger");
+  n = Dump();
+  if (n<=0) {
+    Check(false, "rearm", "dump");
+    return;
+  }
+  CheckLines("rearm", n, cycle);
+  Check(MarkLine(n, REC_TRIGGER_SUMO_STOP)==n-1-REC_CONFIG_POST_SAMPLES, "rearm", "marks");
+}
+
+static void TestValues(StateKind k, const char *test) {
+  int n;
+
+  kind = k;
+  Arm();
+  REC_Trigger(REC_TRIGGER_MOVE_TIMEOUT);
+  Check(RunUntilFrozen()>0, test, "not frozen by the trigger");
+  n = Dump();
+  Check(n==REC_CONFIG_POST_SAMPLES+1, test, "number of samples");
+  if (n>0) {
+    CheckLines(test, n, cycle);
+  }
+}
+
+/* time in ns below which the part 'permille' of the samples of the histogram are */
+static unsigned int Percentile(const unsigned int *hist, unsigned int nofSamples, unsigned int permille) {
+  unsigned int i, sum = 0;
+
+  for(i=0; i<HIST_NOF_BINS; i++) {
+    sum += hist[i];
+    if (sum*1000ULL>=(unsigned long long)nofSamples*permille) {
+      return (i+1)*HIST_BIN_NS;
+    }
+  }
+  return HIST_NOF_BINS*HIST_BIN_NS;
+}
+
+static void Bench(unsigned int nofSamples) {
+  static unsigned int hist[HIST_NOF_BINS];
+  struct timespec t0, t1;
+  uint64_t ns;
+  unsigned int i;
+
+  kind = STATE_SPEED;
+  REC_SetTriggerMask(0); /* never freezes */
+  Arm();
+  for(i=0; i<nofSamples; i++) {
+    cycle++;
+    REC_Sample(); /* divider only */
+    cycle++;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    REC_Sample();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = (t1.tv_sec-t0.tv_sec)*1000000000ULL+t1.tv_nsec-t0.tv_nsec;
+    hist[ns/HIST_BIN_NS<HIST_NOF_BINS?ns/HIST_BIN_NS:HIST_NOF_BINS-1]++;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(i=0; i<nofSamples; i++) {
+    Cycle();
+    Cycle();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns = (t1.tv_sec-t0.tv_sec)*1000000000ULL+t1.tv_nsec-t0.tv_nsec;
+  printf("cost per sample (host): %.1f ns average over two cycles, recording cycle median %u ns, 99.9%% %u ns\n",
+      (double)ns/nofSamples, Percentile(hist, nofSamples, 500), Percentile(hist, nofSamples, 999));
+  printf("buffer: %u samples, one every %u ms, %u ms history\n",
+      REC_CONFIG_NOF_SAMPLES, REC_CONFIG_SAMPLE_DIV*CYCLE_MS, REC_CONFIG_NOF_SAMPLES*REC_CONFIG_SAMPLE_DIV*CYCLE_MS);
+}
+
+int main(int argc, char *argv[]) {
+  TestStartup();
+  TestWrapAndFreeze();
+  TestMaskAndPartial();
+  TestRearm();
+  TestValues(STATE_SATURATE, "saturate");
+  TestValues(STATE_POS, "position");
+  Bench(argc>1?(unsigned int)atoi(argv[1]):1000000);
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0?0:1;
+}
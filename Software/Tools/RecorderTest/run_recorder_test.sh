@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the flight recorder test with the benchmark of the cost per sample.
+# Usage: ./run_recorder_test.sh [nofBenchSamples]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/FreeRTOS/Source/include"
+SRC="recorder_test.c $R/Recorder.c $M/src/McuUtility.c"
+
+gcc $CFLAGS -o $OUT/recorder_test $SRC
+$OUT/recorder_test "$@"
@@ -0,0 +1,27 @@
+/**
+ * \file
+ * \brief Host platform configuration for the reflectance capture test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Reflectance.c: the measurement is driven
+ * by REF_Sample() as in the executive, without the RTOS tasks, the shell and the modules which use
+ * the measurement. REF_CONFIG_USE_EDGE_CAPTURE selects the edge capture or the polling path.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (0)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (0)
+#define PL_CONFIG_HAS_EXEC           (1)
+#define PL_CONFIG_HAS_REFLECTANCE    (1)
+#define PL_CONFIG_HAS_LINE           (0)
+#define PL_CONFIG_HAS_SUMO           (0)
+#define PL_CONFIG_HAS_RECORDER       (0)
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,35 @@
+/**
+ * \file
+ * \brief Host stubs of the cycle counter, McuWait and the critical section for the reflectance capture test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of McuArmTools.h and
+ * McuWait.h, so RoboLib/Reflectance.c is compiled unchanged with the pin and timer interface of
+ * Tools/RoboSim. The functions, the pins and the timer are implemented in ref_capture_test.c on
+ * its own virtual time.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define __McuArmTools_H
+#define __McuWait_H
+
+/* FreeRTOS */
+#define configCPU_CLOCK_HZ     (64000000) /* the cycle counter runs with this clock */
+
+/* McuArmTools */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+/* McuWait */
+void McuWait_Waitus(uint16_t us);
+
+/* FreeRTOS critical section of the polling path: masks the interrupts of the test */
+void SIM_EnterCritical(void);
+void SIM_ExitCritical(void);
+#define taskENTER_CRITICAL()  SIM_EnterCritical()
+#define taskEXIT_CRITICAL()   SIM_ExitCritical()
+
+#endif /* SIMSTUBS_H_ */
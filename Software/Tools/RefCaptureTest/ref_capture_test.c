@@ -0,0 +1,455 @@
+/**
+ * \file
+ * \brief Host test of the reflectance measurement and interrupt latency benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Reflectance.c (compiled unchanged) on a virtual time, with models of the sensor
+ * pins, of the reflectance timer (TIM3) and of the 10 kHz interrupt of the sampled quadrature
+ * decoder. As in the robot simulation, the code runs in zero time and the time only advances in
+ * McuWait_Waitus() and between the calls of REF_Sample(). The polling loop is the only code which
+ * reads the timer with the interrupts masked: each read advances the time by one loop iteration.
+ *
+ * - REF_DecodeCaptures() gets captures around the timeout, in place and into another array.
+ * - The measurement is checked with a script of discharge times for the four sensors: white,
+ *   black (no edge at all), on the white and timeout limits, at the timer overflow, and random ones. The published raw
+ *   values and white bits have to be the timer ticks at the discharge edge, or REF_MAX_SENSOR_VALUE.
+ *   With edge capture the measurement started by REF_Sample() is published by the next call.
+ * - Benchmark: the latency of the 10 kHz interrupt, i.e. the time from its timer event until it
+ *   runs, and the time with the interrupts masked. With edge capture the interrupts are never
+ *   masked, instead the time of the edge and timeout interrupts of the module is measured on
+ *   the host. The target reports its own numbers with 'ref status'.
+ *
+ * Build: see run_ref_capture_test.sh, with -DREF_CONFIG_USE_EDGE_CAPTURE=0 for the polling path
+ * Usage: ref_capture_test [nofMeasurements]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Platform.h"
+#include "Reflectance.h"
+#include "Pin.h"
+#include "Timer.h"
+
+#define NS_PER_US           (1000ull)
+#define CYCLE_NS            (2000*NS_PER_US) /* REF_Sample() period */
+#define QUAD_PERIOD_NS      (100*NS_PER_US)  /* 10 kHz interrupt of the sampled quadrature decoder */
+#define POLL_LOOP_NS        (250)            /* one iteration of the polling loop on the target, about 16 cycles */
+#define TMRR_TICKS_PER_US   (64)
+#define TMRR_PERIOD_TICKS   (10*6400)        /* 1 ms, as htim3 */
+#define TIMEOUT_TICKS       (0xa000)         /* REF_TIMEOUT_TICKS of Reflectance.c */
+#define WHITE_MAX_TICKS     (0x8000)         /* REF_WHITE_MAX_VALUE of Reflectance.c */
+#define NEVER_NS            (1000000*NS_PER_US) /* no reflection at all */
+
+static int nofMeasurements = 2000;
+static unsigned int nofFailed = 0;
+
+/* virtual time and interrupt mask */
+static uint64_t simNs;
+static bool masked, inIsr;
+static uint64_t maskedSinceNs, maskedNs, maskedMaxNs;
+
+/* sensor pins: discharge after dischargeNs once switched to input */
+static uint64_t dischargeNs[REF_NOF_SENSORS]; /* of the measurement running, from the script */
+static bool isOutput[PIN_NOF_PINS], level[PIN_NOF_PINS];
+static bool discharging[REF_NOF_SENSORS], edgeDone[REF_NOF_SENSORS];
+static uint64_t dischargeStartNs[REF_NOF_SENSORS];
+static bool edgeIrqEnabled[REF_NOF_SENSORS], edgeIrqPending[REF_NOF_SENSORS];
+
+/* reflectance timer */
+static bool tmrrRunning, tmrrIrqEnabled, tmrrIrqPending;
+static uint64_t tmrrZeroNs; /* time when the counter was zero, while running */
+static uint32_t tmrrCounter; /* while stopped */
+
+/* 10 kHz interrupt */
+static uint64_t quadNextNs, quadDueNs;
+static bool quadPending;
+static uint64_t quadLatencyMaxNs, quadLatencySumNs;
+static unsigned long quadCount;
+
+/* time of the interrupts of Reflectance.c on the host */
+static uint64_t isrHostMaxNs, isrHostSumNs;
+static unsigned long isrCount;
+
+/*------------------------------------------------------------------------------------------------*/
+/* interrupts and virtual time */
+#if REF_CONFIG_USE_EDGE_CAPTURE
+static uint64_t HostNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000ull+(uint64_t)ts.tv_nsec;
+}
+
+static void RunIsr(void (*isr)(unsigned int), unsigned int arg, void (*isrVoid)(void)) {
+  uint64_t start = HostNs(), ns;
+
+  inIsr = true;
+  if (isr!=NULL) {
+    isr(arg);
+  } else {
+    isrVoid();
+  }
+  inIsr = false;
+  ns = HostNs()-start;
+  isrHostSumNs += ns;
+  if (ns>isrHostMaxNs) {
+    isrHostMaxNs = ns;
+  }
+  isrCount++;
+}
+#endif
+
+/* serves the pending interrupts, if not masked. Interrupts do not preempt each other. */
+static void Dispatch(void) {
+  bool served;
+  uint64_t latency;
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  int i;
+#endif
+
+  if (masked || inIsr) {
+    return;
+  }
+  do {
+    served = false;
+    if (quadPending) {
+      quadPending = false;
+      latency = simNs-quadDueNs;
+      quadLatencySumNs += latency;
+      if (latency>quadLatencyMaxNs) {
+        quadLatencyMaxNs = latency;
+      }
+      quadCount++;
+      served = true;
+    }
+#if REF_CONFIG_USE_EDGE_CAPTURE /* the polling path has no interrupts */
+    for(i=0; i<REF_NOF_SENSORS; i++) {
+      if (edgeIrqPending[i]) {
+        edgeIrqPending[i] = false;
+        RunIsr(REF_OnFallingEdgeInterrupt, (unsigned int)i, NULL);
+        served = true;
+      }
+    }
+    if (tmrrIrqPending) {
+      tmrrIrqPending = false;
+      RunIsr(NULL, 0, REF_OnTimeoutInterrupt);
+      served = true;
+    }
+#endif
+  } while (served);
+}
+
+static uint64_t TicksToNs(uint32_t ticks) {
+  return (uint64_t)ticks*NS_PER_US/TMRR_TICKS_PER_US;
+}
+
+/* advances the time to toNs and runs the events of the models on the way */
+static void Advance(uint64_t toNs) {
+  uint64_t next, t;
+  int i, edge;
+
+  for(;;) {
+    next = toNs+1;
+    edge = -1;
+    for(i=0; i<REF_NOF_SENSORS; i++) {
+      if (discharging[i] && !edgeDone[i] && dischargeNs[i]!=NEVER_NS) {
+        t = dischargeStartNs[i]+dischargeNs[i];
+        if (t<next) {
+          next = t;
+          edge = i;
+        }
+      }
+    }
+    if (tmrrRunning && tmrrIrqEnabled && tmrrZeroNs+TicksToNs(TMRR_PERIOD_TICKS)<next) {
+      next = tmrrZeroNs+TicksToNs(TMRR_PERIOD_TICKS);
+      edge = -2;
+    }
+    if (quadNextNs<next) {
+      next = quadNextNs;
+      edge = -3;
+    }
+    if (next>toNs) {
+      break;
+    }
+    if (next>simNs) {
+      simNs = next;
+    }
+    if (edge>=0) { /* falling edge of a sensor */
+      edgeDone[edge] = true;
+      if (edgeIrqEnabled[edge]) {
+        edgeIrqPending[edge] = true;
+      }
+    } else if (edge==-2) { /* timer overflow */
+      tmrrZeroNs = next;
+      tmrrIrqPending = true;
+    } else { /* 10 kHz timer */
+      if (!quadPending) {
+        quadPending = true;
+        quadDueNs = next;
+      }
+      quadNextNs += QUAD_PERIOD_NS;
+    }
+    Dispatch();
+  }
+  simNs = toNs;
+  Dispatch();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* stubs */
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return (uint32_t)(simNs*TMRR_TICKS_PER_US/NS_PER_US); /* 64 MHz */
+}
+
+void McuWait_Waitus(uint16_t us) {
+  Advance(simNs+us*NS_PER_US);
+}
+
+void SIM_EnterCritical(void) {
+  masked = true;
+  maskedSinceNs = simNs;
+}
+
+void SIM_ExitCritical(void) {
+  uint64_t ns = simNs-maskedSinceNs;
+
+  maskedNs += ns;
+  if (ns>maskedMaxNs) {
+    maskedMaxNs = ns;
+  }
+  masked = false;
+  Dispatch();
+}
+
+static int EdgeIdx(Pin_PinId pin) {
+  return (int)pin-(int)PIN_EDGE_L;
+}
+
+bool PIN_IsPinHigh(Pin_PinId pin) {
+  int idx = EdgeIdx(pin);
+
+  if (isOutput[pin]) {
+    return level[pin];
+  }
+  return discharging[idx] && simNs<dischargeStartNs[idx]+dischargeNs[idx];
+}
+
+void PIN_SetHigh(Pin_PinId pin) {
+  level[pin] = true;
+}
+
+void PIN_SetDirection(Pin_PinId pin, bool isOut) {
+  int idx = EdgeIdx(pin);
+
+  if (isOut) {
+    isOutput[pin] = true;
+    discharging[idx] = false;
+  } else if (isOutput[pin]) {
+    isOutput[pin] = false;
+    discharging[idx] = level[pin]; /* charged if it was high */
+    dischargeStartNs[idx] = simNs;
+    edgeDone[idx] = false;
+  }
+}
+
+void PIN_SetInputFallingEdgeInterrupt(Pin_PinId pin) {
+  int idx = EdgeIdx(pin);
+
+  PIN_SetDirection(pin, false);
+  edgeIrqPending[idx] = false;
+  edgeIrqEnabled[idx] = true;
+}
+
+void PIN_DisableEdgeInterrupt(Pin_PinId pin) {
+  int idx = EdgeIdx(pin);
+
+  edgeIrqEnabled[idx] = false;
+  edgeIrqPending[idx] = false;
+}
+
+uint32_t TMRR_GetCounter(void) {
+  if (masked) { /* polling loop: one iteration */
+    Advance(simNs+POLL_LOOP_NS);
+  }
+  if (!tmrrRunning) {
+    return tmrrCounter;
+  }
+  return (uint32_t)(((simNs-tmrrZeroNs)*TMRR_TICKS_PER_US/NS_PER_US)%TMRR_PERIOD_TICKS);
+}
+
+static void TMRR_Run(bool interrupts) {
+  tmrrRunning = true;
+  tmrrIrqEnabled = interrupts;
+  tmrrZeroNs = simNs-TicksToNs(tmrrCounter);
+}
+
+void TMRR_Start(void) {
+  TMRR_Run(false);
+}
+
+void TMRR_Stop(void) {
+  tmrrCounter = TMRR_GetCounter();
+  tmrrRunning = false;
+}
+
+void TMRR_StartInterrupts(void) {
+  tmrrIrqPending = false;
+  TMRR_Run(true);
+}
+
+void TMRR_StopInterrupts(void) {
+  TMRR_Stop();
+  tmrrIrqEnabled = false;
+  tmrrIrqPending = false;
+}
+
+void TMRR_TriggerInterrupt(void) {
+  if (tmrrIrqEnabled) {
+    tmrrIrqPending = true;
+  }
+}
+
+uint32_t TMRR_SetCounter(uint32_t value) {
+  tmrrCounter = value%TMRR_PERIOD_TICKS;
+  if (tmrrRunning) {
+    TMRR_Run(tmrrIrqEnabled);
+  }
+  return tmrrCounter;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void CheckDecoder(void) {
+  static const REF_SensorTimeType capture[] = {0, 1, 0x8000, TIMEOUT_TICKS-1, TIMEOUT_TICKS, TIMEOUT_TICKS+1, 0xfffe, REF_MAX_SENSOR_VALUE};
+  static const REF_SensorTimeType expected[] = {0, 1, 0x8000, TIMEOUT_TICKS-1, TIMEOUT_TICKS, REF_MAX_SENSOR_VALUE, REF_MAX_SENSOR_VALUE, REF_MAX_SENSOR_VALUE};
+  REF_SensorTimeType raw[8], inPlace[8];
+  unsigned int i;
+
+  for(i=0; i<8; i++) {
+    raw[i] = 0x1234;
+    inPlace[i] = capture[i];
+  }
+  REF_DecodeCaptures(capture, raw, 6, TIMEOUT_TICKS); /* only the first six */
+  REF_DecodeCaptures(inPlace, inPlace, 8, TIMEOUT_TICKS);
+  for(i=0; i<8; i++) {
+    if ((i<6 && raw[i]!=expected[i]) || (i>=6 && raw[i]!=0x1234) || inPlace[i]!=expected[i]) {
+      printf("FAILED: decode of capture 0x%04x\n", capture[i]);
+      nofFailed++;
+    }
+  }
+}
+
+/* discharge times of a measurement */
+static void Script(int k, uint64_t *ns) {
+  static const uint64_t fixed[][REF_NOF_SENSORS] = {
+    {150*NS_PER_US, 150*NS_PER_US, 150*NS_PER_US, 150*NS_PER_US}, /* white */
+    {NEVER_NS, NEVER_NS, NEVER_NS, NEVER_NS}, /* black */
+    {0, 512*NS_PER_US, 512*NS_PER_US+16, NEVER_NS}, /* immediate, white limit */
+    {640*NS_PER_US-16, 640*NS_PER_US, 640*NS_PER_US+16, 999*NS_PER_US}, /* timeout of the measurement */
+    {1000*NS_PER_US, 1500*NS_PER_US, 80*NS_PER_US, 81*NS_PER_US}, /* after the timer timeout */
+  };
+  int i;
+
+  for(i=0; i<REF_NOF_SENSORS; i++) {
+    if (k<(int)(sizeof(fixed)/sizeof(fixed[0]))) {
+      ns[i] = fixed[k][i];
+    } else if (rand()%10==0) {
+      ns[i] = NEVER_NS;
+    } else {
+      ns[i] = (uint64_t)(50000+rand()%1150000); /* 50 us to 1.2 ms */
+    }
+  }
+}
+
+/* raw value the measurement has to report for a discharge time */
+static REF_SensorTimeType Expected(uint64_t ns) {
+  uint64_t ticks;
+
+  if (ns>=NEVER_NS) {
+    return REF_MAX_SENSOR_VALUE;
+  }
+#if !REF_CONFIG_USE_EDGE_CAPTURE
+  ns = (ns+POLL_LOOP_NS-1)/POLL_LOOP_NS*POLL_LOOP_NS; /* first loop iteration which sees the pin low */
+  if (ns==0) {
+    ns = POLL_LOOP_NS;
+  }
+#endif
+  if (ns>=TicksToNs(TMRR_PERIOD_TICKS)) {
+    return REF_MAX_SENSOR_VALUE; /* timer timeout interrupt first */
+  }
+  ticks = ns*TMRR_TICKS_PER_US/NS_PER_US;
+  return ticks>TIMEOUT_TICKS ? REF_MAX_SENSOR_VALUE : (REF_SensorTimeType)ticks;
+}
+
+static void CheckMeasurement(int k, const uint64_t *ns) {
+  REF_Snapshot snapshot;
+  REF_SensorTimeType raw;
+  uint32_t white = 0;
+  bool ok;
+  int i;
+
+  ok = REF_GetSnapshot(&snapshot, NULL);
+  for(i=0; i<REF_NOF_SENSORS; i++) {
+    raw = Expected(ns[i]);
+    if (raw<=WHITE_MAX_TICKS) {
+      white |= 1u<<i;
+    }
+    ok = ok && snapshot.raw[i]==raw;
+  }
+  if (!ok || snapshot.whiteBits!=white) {
+    printf("FAILED: measurement %d:", k);
+    for(i=0; i<REF_NOF_SENSORS; i++) {
+      printf(" %llu ns 0x%04x (0x%04x)", (unsigned long long)ns[i], snapshot.raw[i], Expected(ns[i]));
+    }
+    printf(", white 0x%x (0x%x)\n", (unsigned)snapshot.whiteBits, (unsigned)white);
+    nofFailed++;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t ns[REF_NOF_SENSORS];
+  int k, i;
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  uint64_t prev[REF_NOF_SENSORS];
+#endif
+
+  if (argc>1) {
+    nofMeasurements = atoi(argv[1]);
+  }
+  srand(1);
+  CheckDecoder();
+  REF_Init();
+  quadNextNs = QUAD_PERIOD_NS/3; /* not in phase with the measurement */
+  for(k=0; k<nofMeasurements; k++) {
+    Script(k, ns);
+    for(i=0; i<REF_NOF_SENSORS; i++) {
+      dischargeNs[i] = ns[i];
+    }
+    REF_Sample();
+#if REF_CONFIG_USE_EDGE_CAPTURE
+    if (k>0) {
+      CheckMeasurement(k-1, prev); /* started by the previous call */
+    }
+    for(i=0; i<REF_NOF_SENSORS; i++) {
+      prev[i] = ns[i];
+    }
+#else
+    CheckMeasurement(k, ns);
+#endif
+    Advance((uint64_t)(k+1)*CYCLE_NS);
+  }
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  printf("edge capture: %d measurements", nofMeasurements);
+#else
+  printf("polling:      %d measurements", nofMeasurements);
+#endif
+  printf(", 10 kHz interrupt latency: mean %.2f us, max %.2f us, masked %.1f%% of the time (max %.1f us)\n",
+    quadCount==0 ? 0.0 : (double)quadLatencySumNs/quadCount/1000.0, (double)quadLatencyMaxNs/1000.0,
+    100.0*(double)maskedNs/(double)simNs, (double)maskedMaxNs/1000.0);
+  if (isrCount!=0) {
+    printf("              %lu interrupts of the module, on the host: mean %.0f ns, max %llu ns\n",
+      isrCount, (double)isrHostSumNs/isrCount, (unsigned long long)isrHostMaxNs);
+  }
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0 ? 0 : 1;
+}
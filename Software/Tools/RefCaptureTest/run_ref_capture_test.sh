@@ -0,0 +1,16 @@
+#!/bin/sh
+# Builds and runs the reflectance measurement test with the edge capture and with the polling
+# path (REF_CONFIG_USE_EDGE_CAPTURE=0), which prints the interrupt latency before and after.
+# Usage: ./run_ref_capture_test.sh [nofMeasurements]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I../RoboSim -I$R -I$M/src -I$M/config -I$M/SEGGER_RTT -I$M/FreeRTOS/Source/include"
+SRC="ref_capture_test.c $R/Reflectance.c $R/SensorBus.c"
+
+gcc $CFLAGS -o $OUT/ref_capture_test_edge $SRC
+gcc $CFLAGS -DREF_CONFIG_USE_EDGE_CAPTURE=0 -o $OUT/ref_capture_test_poll $SRC
+$OUT/ref_capture_test_poll "$@"
+$OUT/ref_capture_test_edge "$@"
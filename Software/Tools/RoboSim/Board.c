@@ -0,0 +1,60 @@
+/**
+ * \file
+ * \brief Board of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Board.c, Board/PWM.c and Board/Led.c for the host build: no clock and GPIO setup,
+ * the motor PWM goes to the robot model and the LED is a variable.
+ */
+
+#include "Platform.h"
+#include "Board.h"
+#include "Pin.h"
+#include "PWM.h"
+#include "Led.h"
+#include "RoboModel.h"
+
+static bool LED_on;
+
+void PWM_SetValue16(uint16_t value, uint32_t channel) {
+  MODEL_OnPwm(channel==PWM_CHANNEL_1, value);
+}
+
+void PWM_Init(void) {
+  PWM_SetValue16(0, PWM_CHANNEL_1);
+  PWM_SetValue16(0, PWM_CHANNEL_2);
+}
+
+void LED_On(LED_LedId led) {
+  (void)led;
+  LED_on = true;
+}
+
+void LED_Off(LED_LedId led) {
+  (void)led;
+  LED_on = false;
+}
+
+void LED_Neg(LED_LedId led) {
+  (void)led;
+  LED_on = !LED_on;
+}
+
+bool LED_Get(LED_LedId led) {
+  (void)led;
+  return LED_on;
+}
+
+void LED_Put(LED_LedId led, bool on) {
+  (void)led;
+  LED_on = on;
+}
+
+void LED_Init(void) {
+  LED_on = false;
+}
+
+void BOARD_Init(void) {
+  LED_Init();
+  PIN_Init();
+}
@@ -0,0 +1,97 @@
+/**
+ * \file
+ * \brief FreeRTOS configuration of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces McuLib/config/FreeRTOSConfig.h for the host build: same tick, clock, priorities and
+ * hooks as the target, with the malloc() heap, without tickless idle and without the run time
+ * statistics. The idle hook of the application is called by the one of the simulation, which
+ * advances the virtual time while the robot has nothing to do.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include "McuLib.h" /* SDK and API used */
+#include "McuRTOSconfig.h" /* extra configuration settings not part of the original FreeRTOS ports */
+
+#define configINCLUDE_FREERTOS_TASK_C_ADDITIONS_H 0
+#define configGENERATE_RUN_TIME_STATS             0
+#define configUSE_PREEMPTION                      1
+#define configUSE_TIME_SLICING                    1
+#define configUSE_IDLE_HOOK                       1
+#define configUSE_IDLE_HOOK_NAME                  SIM_IdleHook /* calls McuRTOS_vApplicationIdleHook() */
+#define configUSE_TICK_HOOK                       1
+#define configUSE_TICK_HOOK_NAME                  McuRTOS_vApplicationTickHook
+#define configUSE_MALLOC_FAILED_HOOK              1
+#define configUSE_MALLOC_FAILED_HOOK_NAME         McuRTOS_vApplicationMallocFailedHook
+#define configTICK_RATE_HZ                        (1000)
+#define configCPU_CLOCK_HZ                        (64000000) /* the cycle counter runs with the virtual time */
+#define configSYSTICK_CLOCK_HZ                    configCPU_CLOCK_HZ
+#define configMINIMAL_STACK_SIZE                  (200)
+#define configUSE_HEAP_SCHEME                     3 /* malloc() */
+#define configTOTAL_HEAP_SIZE                     (8192) /* not used by heap_3.c */
+#define configAPPLICATION_ALLOCATED_HEAP          0
+#define configSUPPORT_DYNAMIC_ALLOCATION          1
+#define configSUPPORT_STATIC_ALLOCATION           0
+#define configUSE_NEWLIB_REENTRANT                0
+#define configMAX_TASK_NAME_LEN                   12
+#define configUSE_TRACE_FACILITY                  0
+#define configUSE_STATS_FORMATTING_FUNCTIONS      0
+#define configUSE_16_BIT_TICKS                    0
+#define configIDLE_SHOULD_YIELD                   1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION   0
+#define configUSE_CO_ROUTINES                     0
+#define configUSE_MUTEXES                         1
+#define configCHECK_FOR_STACK_OVERFLOW            0 /* host stacks, see port.c */
+#define configUSE_RECURSIVE_MUTEXES               1
+#define configQUEUE_REGISTRY_SIZE                 5
+#define configUSE_QUEUE_SETS                      0
+#define configUSE_COUNTING_SEMAPHORES             1
+#define configUSE_APPLICATION_TASK_TAG            0
+#define configUSE_TICKLESS_IDLE                   0 /* the simulation skips the idle time itself */
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS   0
+#define configMAX_PRIORITIES                      6
+#define configMAX_CO_ROUTINE_PRIORITIES           2
+#define configRECORD_STACK_HIGH_ADDRESS           0
+
+/* Software timer definitions. */
+#define configUSE_TIMERS                          0
+#define configTIMER_TASK_PRIORITY                 (configMAX_PRIORITIES-1U)
+#define configTIMER_QUEUE_LENGTH                  10U
+#define configTIMER_TASK_STACK_DEPTH              (configMINIMAL_STACK_SIZE)
+#define INCLUDE_xEventGroupSetBitFromISR          0
+#define INCLUDE_xTimerPendFunctionCall            0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK        0
+
+/* Set the following definitions to 1 to include the API function, or zero to exclude the API function. */
+#define INCLUDE_vTaskEndScheduler                 1 /* ends a bout */
+#define INCLUDE_vTaskPrioritySet                  1
+#define INCLUDE_uxTaskPriorityGet                 1
+#define INCLUDE_vTaskDelete                       0
+#define INCLUDE_vTaskCleanUpResources             1
+#define INCLUDE_vTaskSuspend                      1
+#define INCLUDE_vTaskDelayUntil                   1
+#define INCLUDE_vTaskDelay                        1
+#define INCLUDE_uxTaskGetStackHighWaterMark       0
+#define INCLUDE_xTaskGetSchedulerState            1
+#define INCLUDE_xQueueGetMutexHolder              1
+#define INCLUDE_xTaskGetHandle                    1
+#define INCLUDE_xTaskAbortDelay                   1
+#define INCLUDE_xTaskGetCurrentTaskHandle         1 /* used by the port */
+#define INCLUDE_xTaskGetIdleTaskHandle            1
+#define INCLUDE_xTaskResumeFromISR                1
+#define INCLUDE_eTaskGetState                     1
+#define INCLUDE_pcTaskGetTaskName                 1
+
+/* the interrupt priorities are not used, the port masks all simulated interrupts */
+#define configPRIO_BITS                           4
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY   15
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY 5
+#define configKERNEL_INTERRUPT_PRIORITY           (configLIBRARY_LOWEST_INTERRUPT_PRIORITY<<(8-configPRIO_BITS))
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY      (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY<<(8-configPRIO_BITS))
+
+void SIM_AssertFailed(const char *file, int line);
+#define configASSERT(x) if((x)==0) { SIM_AssertFailed(__FILE__, __LINE__); }
+
+#endif /* FREERTOS_CONFIG_H */
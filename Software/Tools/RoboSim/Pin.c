@@ -0,0 +1,131 @@
+/**
+ * \file
+ * \brief Pins of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The output levels are kept here and passed to the robot model, the inputs are read from the
+ * model. The model sets the pin interrupts pending, their handlers dispatch as
+ * HAL_GPIO_EXTI_Callback() in Board/Pin.c.
+ */
+
+#include "Platform.h"
+#include "Pin.h"
+#include "RoboModel.h"
+#include "Sim.h"
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_QUADRATURE
+  #include "Quadrature.h"
+#endif
+
+static bool PIN_isOutput[PIN_NOF_PINS];
+static bool PIN_level[PIN_NOF_PINS]; /* of the outputs */
+
+static bool PIN_IsEdgePin(Pin_PinId pin) {
+  return pin==PIN_EDGE_L || pin==PIN_EDGE_ML || pin==PIN_EDGE_MR || pin==PIN_EDGE_R;
+}
+
+static void PIN_Put(Pin_PinId pin, bool isHigh) {
+  if (pin!=PIN_PROX_IR_SELECT && pin!=PIN_DIR_L && pin!=PIN_DIR_R && !PIN_IsEdgePin(pin)) {
+    return; /* no output on the board */
+  }
+  if (PIN_level[pin]!=isHigh) {
+    PIN_level[pin] = isHigh;
+    if (PIN_isOutput[pin]) {
+      MODEL_OnOutput(pin, isHigh);
+    }
+  }
+}
+
+void PIN_SetDirection(Pin_PinId pin, bool isOutput) {
+  if (!PIN_IsEdgePin(pin)) {
+    for(;;) {} /* error! */
+  }
+  if (isOutput) {
+    PIN_isOutput[pin] = true;
+    MODEL_OnOutput(pin, PIN_level[pin]);
+  } else if (PIN_isOutput[pin]) {
+    PIN_isOutput[pin] = false;
+    MODEL_OnEdgeDischarge(pin);
+  }
+}
+
+void PIN_SetInputFallingEdgeInterrupt(Pin_PinId pin) {
+  if (!PIN_IsEdgePin(pin)) {
+    for(;;) {} /* error! */
+  }
+  if (PIN_isOutput[pin]) {
+    PIN_isOutput[pin] = false;
+    MODEL_OnEdgeDischarge(pin);
+  }
+  SIM_ClearIrq(SIM_IRQ_EDGE_L+(pin-PIN_EDGE_L)); /* clear any pending edge from a previous measurement */
+  MODEL_OnEdgeInterrupt(pin, true);
+}
+
+void PIN_DisableEdgeInterrupt(Pin_PinId pin) {
+  if (!PIN_IsEdgePin(pin)) {
+    for(;;) {} /* error! */
+  }
+  MODEL_OnEdgeInterrupt(pin, false);
+  SIM_ClearIrq(SIM_IRQ_EDGE_L+(pin-PIN_EDGE_L));
+}
+
+bool PIN_IsPinHigh(Pin_PinId pin) {
+  if (pin>=PIN_NOF_PINS) {
+    return false;
+  }
+  if (PIN_isOutput[pin]) {
+    return PIN_level[pin];
+  }
+  return MODEL_GetInput(pin);
+}
+
+bool PIN_IsPinLow(Pin_PinId pin) {
+  return !PIN_IsPinHigh(pin);
+}
+
+void PIN_SetHigh(Pin_PinId pin) {
+  PIN_Put(pin, true);
+}
+
+void PIN_SetLow(Pin_PinId pin) {
+  /* as on the target, the edge pins are only set high */
+  if (!PIN_IsEdgePin(pin)) {
+    PIN_Put(pin, false);
+  }
+}
+
+void PIN_Toggle(Pin_PinId pin) {
+  if (!PIN_IsEdgePin(pin)) {
+    PIN_Put(pin, !PIN_level[pin]);
+  }
+}
+
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
+static void PIN_OnEdgeL(void)  { REF_OnFallingEdgeInterrupt(0); }
+static void PIN_OnEdgeML(void) { REF_OnFallingEdgeInterrupt(1); }
+static void PIN_OnEdgeMR(void) { REF_OnFallingEdgeInterrupt(2); }
+static void PIN_OnEdgeR(void)  { REF_OnFallingEdgeInterrupt(3); }
+#endif
+
+#if PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+static void PIN_OnEncL(void) { QUAD_OnEdgeInterrupt(true); }
+static void PIN_OnEncR(void) { QUAD_OnEdgeInterrupt(false); }
+#endif
+
+void PIN_Init(void) {
+  PIN_isOutput[PIN_PROX_IR_SELECT] = true;
+  PIN_isOutput[PIN_DIR_L] = true;
+  PIN_isOutput[PIN_DIR_R] = true;
+#if PL_CONFIG_HAS_REFLECTANCE && REF_CONFIG_USE_EDGE_CAPTURE
+  SIM_SetIrqHandler(SIM_IRQ_EDGE_L, PIN_OnEdgeL);
+  SIM_SetIrqHandler(SIM_IRQ_EDGE_ML, PIN_OnEdgeML);
+  SIM_SetIrqHandler(SIM_IRQ_EDGE_MR, PIN_OnEdgeMR);
+  SIM_SetIrqHandler(SIM_IRQ_EDGE_R, PIN_OnEdgeR);
+#endif
+#if PL_CONFIG_HAS_QUADRATURE && QUAD_CONFIG_DECODER==QUAD_CONFIG_DECODER_EDGE
+  SIM_SetIrqHandler(SIM_IRQ_ENC_L, PIN_OnEncL);
+  SIM_SetIrqHandler(SIM_IRQ_ENC_R, PIN_OnEncR);
+#endif
+}
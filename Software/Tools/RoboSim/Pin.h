@@ -0,0 +1,58 @@
+/**
+ * \file
+ * \brief Pins of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Pin.h for the host build: same pin identifiers and functions. The input levels
+ * come from the robot model (robo_sim.c), the outputs go to it, see RoboModel.h.
+ */
+
+#ifndef BOARD_PIN_H_
+#define BOARD_PIN_H_
+
+#include <stdbool.h>
+
+/* Direct pin read access, as on the target */
+#define PIN_ENCL_A_GET()  PIN_IsPinHigh(PIN_ENCL_A)
+#define PIN_ENCL_B_GET()  PIN_IsPinHigh(PIN_ENCL_B)
+#define PIN_ENCR_A_GET()  PIN_IsPinHigh(PIN_ENCR_A)
+#define PIN_ENCR_B_GET()  PIN_IsPinHigh(PIN_ENCR_B)
+
+#define PIN_EDGE_L_GET()  PIN_IsPinHigh(PIN_EDGE_L)
+#define PIN_EDGE_ML_GET() PIN_IsPinHigh(PIN_EDGE_ML)
+#define PIN_EDGE_MR_GET() PIN_IsPinHigh(PIN_EDGE_MR)
+#define PIN_EDGE_R_GET()  PIN_IsPinHigh(PIN_EDGE_R)
+
+/*!
+ * \brief Identifiers for the Pins on the board
+ */
+typedef enum {
+  PIN_SW3, /*!< User Switch SW3 */
+  PIN_ENCL_A,
+  PIN_ENCL_B,
+  PIN_ENCR_A,
+  PIN_ENCR_B,
+  PIN_PROX_IR_SELECT,
+  PIN_PROX_L,
+  PIN_PROX_M,
+  PIN_PROX_R,
+  PIN_EDGE_L,
+  PIN_EDGE_ML,
+  PIN_EDGE_MR,
+  PIN_EDGE_R,
+  PIN_DIR_L,
+  PIN_DIR_R,
+  PIN_NOF_PINS
+} Pin_PinId;
+
+bool PIN_IsPinHigh(Pin_PinId pin);
+bool PIN_IsPinLow(Pin_PinId pin);
+void PIN_SetHigh(Pin_PinId pin);
+void PIN_SetLow(Pin_PinId pin);
+void PIN_Toggle(Pin_PinId pin);
+void PIN_SetDirection(Pin_PinId pin, bool isOutput);
+void PIN_SetInputFallingEdgeInterrupt(Pin_PinId pin);
+void PIN_DisableEdgeInterrupt(Pin_PinId pin);
+void PIN_Init(void);
+
+#endif /* BOARD_PIN_H_ */
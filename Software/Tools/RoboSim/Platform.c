@@ -0,0 +1,170 @@
+/**
+ * \file
+ * \brief Platform initialization of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Same order as Board/Platform.c, without McuRTOS_Init() (the port masks the interrupts until the
+ * scheduler starts), I2C, display, flash and RTT. The cycle counter and the busy waits declared
+ * in SimStubs.h run with the virtual time of port.c, the console of the shell goes to stderr.
+ */
+
+#include "Platform.h"
+#include "Board.h"
+#include "McuUtility.h"
+#include "McuRTT.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Sim.h"
+#if PL_CONFIG_HAS_MOTOR
+  #include "Motor.h"
+  #include "PWM.h"
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  #include "Proximity.h"
+#endif
+#if PL_CONFIG_HAS_QUADRATURE
+  #include "Quadrature.h"
+#endif
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_TIMER
+  #include "Timer.h"
+#endif
+#if PL_CONFIG_HAS_PID
+  #include "Pid.h"
+#endif
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  #include "Tacho.h"
+#endif
+#if PL_CONFIG_HAS_DRIVE
+  #include "Drive.h"
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  #include "Odometry.h"
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  #include "Recorder.h"
+#endif
+#if PL_CONFIG_HAS_SPAN
+  #include "Span.h"
+#endif
+#if PL_CONFIG_HAS_TURN
+  #include "Turn.h"
+#endif
+#if PL_CONFIG_HAS_TRACKER
+  #include "Tracker.h"
+#endif
+#if PL_CONFIG_HAS_EVENTS
+  #include "Event.h"
+#endif
+#if PL_CONFIG_HAS_TRIGGER
+  #include "Trigger.h"
+#endif
+#if PL_CONFIG_HAS_DEBOUNCE
+  #include "Debounce.h"
+  #include "KeyDebounce.h"
+#endif
+#if PL_CONFIG_HAS_KEYS
+  #include "Keys.h"
+#endif
+#if PL_CONFIG_HAS_LINE
+  #include "Line.h"
+#endif
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return (uint32_t)(SIM_GetTimeNs()*(configCPU_CLOCK_HZ/1000000)/SIM_NS_PER_US);
+}
+
+void McuWait_Init(void) {
+  /* nothing needed */
+}
+
+void McuWait_Waitns(uint32_t ns) {
+  SIM_WaitNs(ns);
+}
+
+void McuWait_Waitus(uint16_t us) {
+  SIM_WaitNs(us*SIM_NS_PER_US);
+}
+
+void McuWait_Waitms(uint16_t ms) {
+  SIM_WaitNs(ms*SIM_NS_PER_MS);
+}
+
+/* console of the shell, instead of RTT */
+uint8_t McuRTT_SendChar(uint8_t ch) {
+  (void)fputc(ch, stderr);
+  return ERR_OK;
+}
+
+uint8_t McuRTT_RecvChar(uint8_t *c) {
+  *c = '\0';
+  return ERR_RXEMPTY;
+}
+
+int SEGGER_RTT_HasKey(void) {
+  return 0;
+}
+
+void PL_Init(void) {
+  BOARD_Init();
+  McuWait_Init();
+  McuUtility_Init();
+#if PL_CONFIG_HAS_EVENTS
+  EVNT_Init();
+#endif
+#if PL_CONFIG_HAS_TRIGGER
+  TRG_Init();
+#endif
+#if PL_CONFIG_HAS_KEYS
+  KEY_Init();
+#endif
+#if PL_CONFIG_HAS_DEBOUNCE
+  DBNC_Init();
+  KEYDBNC_Init();
+#endif
+#if PL_CONFIG_HAS_SPAN
+  SPAN_Init(); /* before the modules with spans */
+#endif
+#if PL_CONFIG_HAS_MOTOR
+  PWM_Init();
+  MOT_Init();
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  PROX_Init();
+#endif
+#if PL_CONFIG_HAS_QUADRATURE
+  QUAD_Init();
+#endif
+#if PL_CONFIG_HAS_REFLECTANCE
+  REF_Init();
+#endif
+#if PL_CONFIG_HAS_TIMER
+  TMR_Init();
+#endif
+#if PL_CONFIG_HAS_MOTOR_TACHO
+  TACHO_Init();
+#endif
+#if PL_CONFIG_HAS_PID
+  PID_Init();
+#endif
+#if PL_CONFIG_HAS_DRIVE
+  DRV_Init();
+#endif
+#if PL_CONFIG_HAS_ODOMETRY
+  ODO_Init();
+#endif
+#if PL_CONFIG_HAS_RECORDER
+  REC_Init();
+#endif
+#if PL_CONFIG_HAS_TURN
+  TURN_Init();
+#endif
+#if PL_CONFIG_HAS_TRACKER
+  TRACK_Init();
+#endif
+#if PL_CONFIG_HAS_LINE
+  LINE_Init();
+#endif
+}
@@ -0,0 +1,31 @@
+/**
+ * \file
+ * \brief Platform of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build: standard I/O of the host instead of RTT, the
+ * configuration is in the Platform_local.h of the simulation.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* include standard types */
+#include <stdint.h>
+#include <stdio.h>
+#include "McuShell.h" /* as on the target, its standard I/O goes to the host, see Platform.c */
+
+#include "Platform_local.h"
+
+#define PL_CONFIG_BOARD_ID_STM32_NUCLEO   1  /*!< Board is the STM32 Nucleo Board */
+#define PL_CONFIG_BOARD   PL_CONFIG_BOARD_ID_STM32_NUCLEO  /*!< the simulated board */
+
+#define PL_CONFIG_USE_FREERTOS         (1)
+	/*!< Set to 1 if using FreeRTOS, 0 otherwise */
+
+/*!
+ * \brief Platform initialization.
+ */
+void PL_Init(void);
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,102 @@
+/**
+ * \file
+ * \brief Configuration of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Same as Src/Platform_local.h of the target, without the modules which need more of the board
+ * (shell, display, flash, RTT). The quadrature interrupts are at the kernel level (no CritSec.c).
+ * PL_CONFIG_HAS_EXEC can be set on the command line, to compare the executive with the tasks,
+ * PL_CONFIG_HAS_SHELL for the shell benchmark with the real command groups.
+ */
+
+#ifndef SRC_PLATFORM_LOCAL_H_
+#define SRC_PLATFORM_LOCAL_H_
+
+#define PL_CONFIG_IS_DAC_ROBOT      (1)
+  /*!< 1: is DAC Sumo robot */
+
+#define PL_CONFIG_HAS_TIMER         (1)
+  /*!< 1: enable timer module */
+#ifndef PL_CONFIG_HAS_SHELL
+  #define PL_CONFIG_HAS_SHELL       (0)
+  /*!< 1: enable shell module, set by Tools/ShellBench for the command groups, without Shell.c */
+#endif
+#define PL_CONFIG_HAS_EVENTS        (1)
+  /*!< 1: enable events module */
+#define PL_CONFIG_HAS_MOTOR         (1)
+  /*!< 1: enable motor module */
+
+#define PL_CONFIG_HAS_KEYS          (1)
+  /*!< 1: enable handling of keys/push buttons */
+#define PL_CONFIG_NOF_KEYS          (1)
+  /*!< number of available keys/push buttons */
+#define PL_CONFIG_HAS_KBI           (0) /* NYI */
+#define PL_CONFIG_HAS_TRIGGER       (1)
+#define PL_CONFIG_HAS_DEBOUNCE      (1 && PL_CONFIG_HAS_TRIGGER)
+
+#define PL_CONFIG_HAS_PROXIMITY     (1)
+#define PL_CONFIG_HAS_REFLECTANCE 	(1)
+#define PL_CONFIG_HAS_LINE          (1 && PL_CONFIG_HAS_REFLECTANCE)
+
+#define PL_CONFIG_HAS_QUADRATURE    (1 && PL_CONFIG_HAS_MOTOR)
+#define PL_CONFIG_HIGH_RES_ENCODER  (1 && PL_CONFIG_HAS_QUADRATURE)
+#define PL_CONFIG_HAS_MOTOR_TACHO   (1 && PL_CONFIG_HAS_QUADRATURE)
+
+#define PL_CONFIG_HAS_PID           (1 && PL_CONFIG_HAS_MOTOR)
+#define PL_CONFIG_HAS_SPEED_PID     (1 && PL_CONFIG_HAS_PID)
+#define PL_CONFIG_HAS_POS_PID       (1 && PL_CONFIG_HAS_PID)
+#define PL_CONFIG_HAS_LINE_PID      (1 && PL_CONFIG_HAS_PID)
+#define PL_CONFIG_GO_DEADEND_BW     (0) /* NYI */
+
+#define PL_CONFIG_HAS_DRIVE         (1 && PL_CONFIG_HAS_QUADRATURE)
+#define PL_CONFIG_HAS_TURN          (1 && PL_CONFIG_HAS_QUADRATURE)
+#define PL_CONFIG_HAS_ODOMETRY      (1 && PL_CONFIG_HAS_QUADRATURE && PL_CONFIG_HAS_DRIVE)
+#define PL_CONFIG_HAS_TRACKER       (1 && PL_CONFIG_HAS_PROXIMITY && PL_CONFIG_HAS_TURN)
+#define PL_CONFIG_HAS_TELEMETRY     (0 && PL_CONFIG_HAS_DRIVE)
+#define PL_CONFIG_HAS_RECORDER      (1 && PL_CONFIG_HAS_DRIVE)
+#define PL_CONFIG_HAS_SPAN          (1) /* timing of the hot paths, 0 removes all markers */
+#define PL_CONFIG_HAS_DLOG          (0) /* deferred binary log over RTT */
+#define PL_CONFIG_HAS_CRITSEC       (0 && PL_CONFIG_USE_FREERTOS) /* critical sections with BASEPRI, quadrature interrupt above the kernel */
+
+#define PL_CONFIG_HAS_UART          (0) /* NYI */
+#define PL_CONFIG_HAS_CONFIG_NVM    (0) /* calibration, PID and turn parameters in flash */
+
+#define PL_CONFIG_HAS_I2C           (0)
+#define PL_CONFIG_HAS_HW_I2C        (1 && PL_CONFIG_HAS_I2C) /* otherwise uses SW I2C */
+#define PL_CONFIG_HAS_SW_I2C        (!PL_CONFIG_HAS_HW_I2C && PL_CONFIG_HAS_I2C) /* otherwise uses SW I2C */
+
+#define PL_CONFIG_HAS_LCD           (1 && PL_CONFIG_HAS_I2C)
+#define PL_CONFIG_HAS_LCD_MENU      (1 && PL_CONFIG_HAS_LCD && PL_CONFIG_HAS_DEBOUNCE)
+#define PL_CONFIG_HAS_LCD_HEADER    (1 && PL_CONFIG_HAS_LCD_MENU)
+
+#define PL_CONFIG_HAS_LINE_FOLLOW   (0 && PL_CONFIG_HAS_MOTOR && PL_CONFIG_HAS_LINE && PL_CONFIG_HAS_LINE_PID)
+#define PL_CONFIG_HAS_LINE_MAZE     (0 && PL_CONFIG_HAS_LINE_FOLLOW)
+#define PL_CONFIG_HAS_SUMO          (1 && PL_CONFIG_HAS_DRIVE && PL_CONFIG_HAS_TURN)
+#ifndef PL_CONFIG_HAS_EXEC
+  #define PL_CONFIG_HAS_EXEC        (1 && PL_CONFIG_USE_FREERTOS && PL_CONFIG_HAS_DRIVE) /* sensors, strategy and motors in one 1 ms executive instead of their tasks */
+#endif
+
+#define PL_APP_LINE_FOLLOWING 1
+#define PL_APP_LINE_MAZE      0
+#define PL_DO_MINT            0
+#define PL_IS_ZUMO_ROBOT      0
+#define PL_IS_MOTOR_1_100     0
+#define PL_IS_ROUND_ROBOT     0
+#define PL_IS_TRACK_ROBOT     0
+#define PL_IS_INTRO_ZUMO_ROBOT  0
+#define PL_IS_INTRO_ZUMO_K22    0
+#define PL_HAS_LIPO       		0
+#define PL_IS_INTRO_ZUMO_ROBOT2 0
+#define PL_IS_INTRO_ZUMO_K22    0
+#define PL_SLOWER_SPEED         0
+
+/* enable one of the below */
+#define PL_CONGIG_DO_SUMO      (0 && PL_CONFIG_HAS_SUMO)
+#define PL_CONFIG_DO_TEST_IR   (0 && PL_CONFIG_HAS_PROXIMITY && PL_CONFIG_HAS_TURN)
+#define PL_CONFIG_DO_TEST_PUSH (0 && PL_CONFIG_HAS_MOTOR)
+
+#if (PL_CONGIG_DO_SUMO+PL_CONFIG_DO_TEST_IR+PL_CONFIG_DO_TEST_PUSH)>1
+  #error "Only one can be active!"
+#endif
+
+#endif /* SRC_PLATFORM_LOCAL_H_ */
@@ -0,0 +1,36 @@
+/**
+ * \file
+ * \brief Interface of the board stand-ins to the robot model
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The pins and the PWM of the simulated board call these functions, they are implemented by the
+ * physics model in robo_sim.c.
+ */
+
+#ifndef ROBOMODEL_H_
+#define ROBOMODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "Pin.h"
+
+/*! \return Level of an input pin at the current virtual time */
+bool MODEL_GetInput(Pin_PinId pin);
+
+/*! \brief An output pin has changed its level */
+void MODEL_OnOutput(Pin_PinId pin, bool isHigh);
+
+/*! \brief A reflectance pin has changed from output high to input, its capacitor discharges */
+void MODEL_OnEdgeDischarge(Pin_PinId pin);
+
+/*! \brief The falling edge interrupt of a reflectance pin is enabled or disabled */
+void MODEL_OnEdgeInterrupt(Pin_PinId pin, bool enabled);
+
+/*!
+ * \brief New PWM duty of a motor
+ * \param isLeft Left or right motor
+ * \param value 0..0xffff, high active
+ */
+void MODEL_OnPwm(bool isLeft, uint16_t value);
+
+#endif /* ROBOMODEL_H_ */
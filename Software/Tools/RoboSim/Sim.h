@@ -0,0 +1,92 @@
+/**
+ * \file
+ * \brief Virtual time, events and interrupts of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The simulated microcontroller: the virtual time only advances while the robot waits (McuWait
+ * busy waits) or is idle (idle task). In between the code runs in zero time. Hardware models
+ * schedule events at points of the virtual time, the events set interrupts pending, and the
+ * pending interrupts run as soon as they are not masked, as with the NVIC. Implemented in port.c.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_NS_PER_US     (1000ull)
+#define SIM_NS_PER_MS     (1000000ull)
+
+/*! \brief Events of the hardware models, at most one pending per ID */
+typedef enum {
+  SIM_EVENT_TICK,       /* SysTick */
+  SIM_EVENT_PHYSICS,    /* step of the robot and arena model */
+  SIM_EVENT_ENC_L,      /* next edge of the left encoder */
+  SIM_EVENT_ENC_R,      /* next edge of the right encoder */
+  SIM_EVENT_EDGE_L,     /* discharge of the reflectance sensors */
+  SIM_EVENT_EDGE_ML,
+  SIM_EVENT_EDGE_MR,
+  SIM_EVENT_EDGE_R,
+  SIM_EVENT_TMRR,       /* TIM3 update, reflectance timeout */
+  SIM_EVENT_TMRP,       /* TIM17 update, proximity bursts */
+  SIM_EVENT_TMRE,       /* TIM6 update, cycle of the executive */
+  SIM_NOF_EVENTS
+} SIM_EventId;
+
+/*! \brief Interrupt lines, a lower number is served first if several are pending */
+typedef enum {
+  SIM_IRQ_ENC_L,        /* EXTI0/1, encoder pins */
+  SIM_IRQ_ENC_R,        /* EXTI9_5, encoder pins */
+  SIM_IRQ_EDGE_L,       /* EXTI lines of the reflectance sensors */
+  SIM_IRQ_EDGE_ML,
+  SIM_IRQ_EDGE_MR,
+  SIM_IRQ_EDGE_R,
+  SIM_IRQ_TIM17,        /* proximity bursts */
+  SIM_IRQ_TIM3,         /* reflectance timeout */
+  SIM_IRQ_TIM6,         /* executive cycle */
+  SIM_IRQ_SYSTICK,      /* RTOS tick */
+  SIM_NOF_IRQS
+} SIM_Irq;
+
+typedef void (*SIM_Callback)(void);
+
+/*! \return Virtual time in nanoseconds since the start of the simulation */
+uint64_t SIM_GetTimeNs(void);
+
+/*!
+ * \brief Busy wait of the running code: the time advances and unmasked interrupts are served.
+ * \param ns Time to wait
+ */
+void SIM_WaitNs(uint64_t ns);
+
+/*!
+ * \brief Schedules an event, replaces a pending one with the same ID.
+ * \param id Event ID
+ * \param timeNs Virtual time of the event, not before the current time
+ * \param fct Called at that time, from the model, not as interrupt
+ */
+void SIM_Schedule(SIM_EventId id, uint64_t timeNs, SIM_Callback fct);
+
+/*! \brief Removes a pending event */
+void SIM_Cancel(SIM_EventId id);
+
+/*! \return If the event is pending */
+bool SIM_IsScheduled(SIM_EventId id);
+
+/*! \brief Sets the interrupt service routine of an interrupt line */
+void SIM_SetIrqHandler(SIM_Irq irq, SIM_Callback handler);
+
+/*! \brief Makes an interrupt pending, it runs when it is not masked */
+void SIM_PendIrq(SIM_Irq irq);
+
+/*! \brief Clears a pending interrupt */
+void SIM_ClearIrq(SIM_Irq irq);
+
+/*! \brief Ends the scheduler, vTaskStartScheduler() returns */
+void SIM_Stop(void);
+
+/*! \brief Idle hook of the simulation, advances the time to the next event */
+void SIM_IdleHook(void);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,47 @@
+/**
+ * \file
+ * \brief Host stand-ins of the cycle counter, the busy waits and the critical section for the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of McuArmTools.h,
+ * McuWait.h and McuCriticalSection.h, so RoboLib is compiled unchanged. The cycle counter runs
+ * at 64 MHz with the virtual time, the busy waits advance it, and the critical section masks the
+ * simulated interrupts as the port does. Implemented in Platform.c and port.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define __McuArmTools_H
+#define __McuWait_H
+#define __McuCriticalSection_H
+
+/* McuArmTools */
+#define McuArmTools_InitCycleCounter()    /* nothing */
+#define McuArmTools_EnableCycleCounter()  /* nothing */
+#define McuArmTools_DisableCycleCounter() /* nothing */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+/* McuWait */
+void McuWait_Init(void);
+void McuWait_Waitns(uint32_t ns);
+void McuWait_Waitus(uint16_t us);
+void McuWait_Waitms(uint16_t ms);
+#define McuWait_WaitOSms(ms) vTaskDelay(pdMS_TO_TICKS(ms)) /* use FreeRTOS API */
+
+/* McuCriticalSection: BASEPRI as taskENTER_CRITICAL_FROM_ISR(), also in interrupts */
+unsigned long uxPortSetInterruptMask(void);
+void vPortClearInterruptMask(unsigned long ulNewMask);
+
+#define McuCriticalSection_CriticalVariable()  unsigned long cpuSR;
+#define McuCriticalSection_EnterCritical()     do { cpuSR = uxPortSetInterruptMask(); } while(0)
+#define McuCriticalSection_ExitCritical()      vPortClearInterruptMask(cpuSR)
+
+/* RTOS header files, as included by McuWait.h */
+#include "McuRTOS.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,154 @@
+/**
+ * \file
+ * \brief Timers of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The counters are computed from the virtual time at which they were zero, the update events are
+ * scheduled at the overflow and make the timer interrupt pending, as in Board/Timer.c.
+ */
+
+#include "Platform.h"
+#include "Timer.h"
+#include "Sim.h"
+#if PL_CONFIG_HAS_REFLECTANCE
+  #include "Reflectance.h"
+#endif
+#if PL_CONFIG_HAS_PROXIMITY
+  #include "Proximity.h"
+#endif
+#if PL_CONFIG_HAS_EXEC
+  #include "Exec.h"
+#endif
+
+#if PL_CONFIG_HAS_REFLECTANCE
+#define TMRR_PERIOD_TICKS   (10*6400) /* 10*6400 ticks @ 64 MHz ==> 1 ms, as htim3 */
+#define TMRR_TICKS_PER_US   (64)
+
+static bool TMRR_running, TMRR_interrupts;
+static uint64_t TMRR_zeroNs;    /* virtual time when the counter was zero, while running */
+static uint32_t TMRR_counter;   /* counter while stopped */
+
+static uint64_t TMRR_TicksToNs(uint32_t ticks) {
+  return (uint64_t)ticks*SIM_NS_PER_US/TMRR_TICKS_PER_US;
+}
+
+static void TMRR_OnUpdate(void) {
+  TMRR_zeroNs = SIM_GetTimeNs();
+  SIM_Schedule(SIM_EVENT_TMRR, TMRR_zeroNs+TMRR_TicksToNs(TMRR_PERIOD_TICKS), TMRR_OnUpdate);
+  SIM_PendIrq(SIM_IRQ_TIM3);
+}
+
+static void TMRR_Run(bool interrupts) {
+  TMRR_running = true;
+  TMRR_interrupts = interrupts;
+  TMRR_zeroNs = SIM_GetTimeNs()-TMRR_TicksToNs(TMRR_counter);
+  if (interrupts) {
+    SIM_Schedule(SIM_EVENT_TMRR, TMRR_zeroNs+TMRR_TicksToNs(TMRR_PERIOD_TICKS), TMRR_OnUpdate);
+  } else {
+    SIM_Cancel(SIM_EVENT_TMRR); /* the counter wraps, without an interrupt */
+  }
+}
+
+void TMRR_Start(void) {
+  TMRR_Run(false);
+}
+
+void TMRR_Stop(void) {
+  TMRR_counter = TMRR_GetCounter();
+  TMRR_running = false;
+  SIM_Cancel(SIM_EVENT_TMRR);
+}
+
+void TMRR_StartInterrupts(void) {
+  SIM_ClearIrq(SIM_IRQ_TIM3); /* clear flag set by a previous run */
+  TMRR_Run(true);
+}
+
+void TMRR_StopInterrupts(void) {
+  TMRR_Stop();
+  TMRR_interrupts = false;
+  SIM_ClearIrq(SIM_IRQ_TIM3);
+}
+
+void TMRR_TriggerInterrupt(void) {
+  if (TMRR_interrupts) {
+    SIM_PendIrq(SIM_IRQ_TIM3);
+  }
+}
+
+uint32_t TMRR_SetCounter(uint32_t value) {
+  TMRR_counter = value%TMRR_PERIOD_TICKS;
+  if (TMRR_running) {
+    TMRR_Run(TMRR_interrupts);
+  }
+  return TMRR_counter;
+}
+
+uint32_t TMRR_GetCounter(void) {
+  if (!TMRR_running) {
+    return TMRR_counter;
+  }
+  return (uint32_t)(((SIM_GetTimeNs()-TMRR_zeroNs)*TMRR_TICKS_PER_US/SIM_NS_PER_US)%TMRR_PERIOD_TICKS);
+}
+
+static void TMRR_OnInterrupt(void) {
+#if REF_CONFIG_USE_EDGE_CAPTURE
+  REF_OnTimeoutInterrupt();
+#endif
+}
+#endif /* PL_CONFIG_HAS_REFLECTANCE */
+
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+static uint64_t TMRP_updateNs; /* last update, the counter restarts from 0 */
+
+static void TMRP_OnUpdate(void);
+
+static void TMRP_Schedule(uint16_t us) {
+  SIM_Schedule(SIM_EVENT_TMRP, TMRP_updateNs+us*SIM_NS_PER_US, TMRP_OnUpdate);
+}
+
+static void TMRP_OnUpdate(void) {
+  uint64_t intervalNs = SIM_GetTimeNs()-TMRP_updateNs;
+
+  TMRP_updateNs = SIM_GetTimeNs();
+  TMRP_Schedule((uint16_t)(intervalNs/SIM_NS_PER_US)); /* same period, unless changed by the interrupt */
+  SIM_PendIrq(SIM_IRQ_TIM17);
+}
+
+void TMRP_StartInterrupts(uint16_t us) {
+  SIM_ClearIrq(SIM_IRQ_TIM17);
+  TMRP_updateNs = SIM_GetTimeNs();
+  TMRP_Schedule(us);
+}
+
+void TMRP_StopInterrupts(void) {
+  SIM_Cancel(SIM_EVENT_TMRP);
+  SIM_ClearIrq(SIM_IRQ_TIM17);
+}
+
+void TMRP_SetInterval(uint16_t us) {
+  TMRP_Schedule(us); /* counter has just restarted from 0 */
+}
+#endif
+
+#if PL_CONFIG_HAS_EXEC
+#define TMRE_PHASE_US   (337) /* the cycle is not synchronous to the RTOS tick */
+
+static void TMRE_OnUpdate(void) {
+  SIM_Schedule(SIM_EVENT_TMRE, SIM_GetTimeNs()+EXEC_CONFIG_CYCLE_US*SIM_NS_PER_US, TMRE_OnUpdate);
+  SIM_PendIrq(SIM_IRQ_TIM6);
+}
+#endif
+
+void TMR_Init(void) {
+#if PL_CONFIG_HAS_REFLECTANCE
+  SIM_SetIrqHandler(SIM_IRQ_TIM3, TMRR_OnInterrupt);
+#endif
+#if PL_CONFIG_HAS_PROXIMITY && PROX_CONFIG_USE_BURST_TIMER
+  SIM_SetIrqHandler(SIM_IRQ_TIM17, PROX_OnBurstTimerInterrupt);
+#endif
+#if PL_CONFIG_HAS_EXEC
+  SIM_SetIrqHandler(SIM_IRQ_TIM6, EXEC_OnCycleInterrupt);
+  SIM_Schedule(SIM_EVENT_TMRE, SIM_GetTimeNs()+TMRE_PHASE_US*SIM_NS_PER_US, TMRE_OnUpdate);
+#endif
+}
@@ -0,0 +1,33 @@
+/**
+ * \file
+ * \brief Timers of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Timer.h for the host build: the reflectance timer (TIM3, 64 MHz, 1 ms period),
+ * the proximity burst timer (TIM17, 1 us) and the cycle timer of the executive (TIM6) run with
+ * the virtual time. There is no quadrature
+ * timer, the simulation uses the edge decoder.
+ */
+
+#ifndef BOARD_TIMER_H_
+#define BOARD_TIMER_H_
+
+#include <stdint.h>
+
+/* reflectance sensor timer */
+void TMRR_Start(void);
+void TMRR_Stop(void);
+void TMRR_StartInterrupts(void);
+void TMRR_StopInterrupts(void);
+void TMRR_TriggerInterrupt(void);
+uint32_t TMRR_SetCounter(uint32_t value);
+uint32_t TMRR_GetCounter(void);
+
+/* proximity IR burst timer, counting microseconds */
+void TMRP_StartInterrupts(uint16_t us);
+void TMRP_StopInterrupts(void);
+void TMRP_SetInterval(uint16_t us);
+
+void TMR_Init(void);
+
+#endif /* BOARD_TIMER_H_ */
@@ -0,0 +1,287 @@
+/**
+ * \file
+ * \brief FreeRTOS port and virtual time of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Each task runs on its own host stack as a ucontext coroutine, all in one host thread. The
+ * FreeRTOS stack of a task only holds the pointer to its context, at the top of stack which the
+ * kernel keeps in the TCB. A context switch is vTaskSwitchContext() and swapcontext(): it runs
+ * when the running code is not in a critical section and not in an interrupt, otherwise it is
+ * pending until then, as PendSV on the target.
+ *
+ * The time is virtual and only advances in busy waits and in the idle task. Events of the
+ * hardware models make interrupt lines pending, which are served in the order of the lines when
+ * the interrupts are not masked. Interrupts do not preempt each other.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Sim.h"
+
+#define SIM_TASK_STACK_SIZE   (256*1024) /* host stack of each task */
+
+typedef struct {
+  ucontext_t ctx;
+  TaskFunction_t fct;
+  void *param;
+} SIM_Context;
+
+typedef struct {
+  uint64_t timeNs;
+  SIM_Callback fct;
+  bool pending;
+} SIM_Event;
+
+static uint64_t SIM_timeNs;
+static SIM_Event SIM_events[SIM_NOF_EVENTS];
+static SIM_Callback SIM_irqHandlers[SIM_NOF_IRQS];
+static uint32_t SIM_pendingIrqs;
+
+static ucontext_t SIM_schedulerCtx; /* vTaskStartScheduler() */
+static SIM_Context *SIM_currentCtx;
+static UBaseType_t SIM_criticalNesting = 0xaaaaaaaa; /* interrupts stay masked until the scheduler starts */
+static UBaseType_t SIM_masked = 1; /* BASEPRI */
+static bool SIM_inIsr;
+static bool SIM_yieldPending; /* PendSV */
+
+void SIM_AssertFailed(const char *file, int line) {
+  fprintf(stderr, "assertion failed: %s:%d\n", file, line);
+  abort();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* context switch */
+static SIM_Context *SIM_TaskContext(void) {
+  /* first member of the TCB: top of stack, which holds the context */
+  return (SIM_Context*)**(StackType_t**)xTaskGetCurrentTaskHandle();
+}
+
+static void SIM_SwitchContext(void) {
+  SIM_Context *from = SIM_currentCtx;
+
+  SIM_yieldPending = false;
+  vTaskSwitchContext();
+  SIM_currentCtx = SIM_TaskContext();
+  if (SIM_currentCtx!=from) {
+    (void)swapcontext(&from->ctx, &SIM_currentCtx->ctx);
+  }
+}
+
+static void SIM_TaskEntry(void) {
+  SIM_currentCtx->fct(SIM_currentCtx->param);
+  SIM_AssertFailed(__FILE__, __LINE__); /* tasks must not return */
+}
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters) {
+  SIM_Context *ctx;
+
+  ctx = malloc(sizeof(SIM_Context));
+  configASSERT(ctx!=NULL);
+  ctx->fct = pxCode;
+  ctx->param = pvParameters;
+  (void)getcontext(&ctx->ctx);
+  ctx->ctx.uc_stack.ss_sp = malloc(SIM_TASK_STACK_SIZE);
+  configASSERT(ctx->ctx.uc_stack.ss_sp!=NULL);
+  ctx->ctx.uc_stack.ss_size = SIM_TASK_STACK_SIZE;
+  ctx->ctx.uc_link = NULL;
+  makecontext(&ctx->ctx, SIM_TaskEntry, 0);
+  *pxTopOfStack = (StackType_t)ctx;
+  return pxTopOfStack;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* interrupts */
+static void SIM_DispatchIrqs(void) {
+  SIM_Irq irq;
+
+  for(;;) {
+    if (SIM_masked || SIM_inIsr) {
+      return; /* served when unmasked */
+    }
+    while (SIM_pendingIrqs!=0) {
+      irq = (SIM_Irq)__builtin_ctz(SIM_pendingIrqs);
+      SIM_pendingIrqs &= ~(1u<<irq);
+      if (SIM_irqHandlers[irq]!=NULL) {
+        SIM_inIsr = true;
+        SIM_irqHandlers[irq]();
+        SIM_inIsr = false;
+      }
+    }
+    if (!SIM_yieldPending) {
+      return;
+    }
+    SIM_SwitchContext(); /* back here when this task runs again */
+  }
+}
+
+void SIM_SetIrqHandler(SIM_Irq irq, SIM_Callback handler) {
+  SIM_irqHandlers[irq] = handler;
+}
+
+void SIM_PendIrq(SIM_Irq irq) {
+  SIM_pendingIrqs |= 1u<<irq;
+}
+
+void SIM_ClearIrq(SIM_Irq irq) {
+  SIM_pendingIrqs &= ~(1u<<irq);
+}
+
+void vPortYield(void) {
+  SIM_yieldPending = true;
+  SIM_DispatchIrqs();
+}
+
+void vPortYieldFromISR(void) {
+  SIM_yieldPending = true; /* after the interrupt */
+}
+
+void vPortDisableInterrupts(void) {
+  SIM_masked = 1;
+}
+
+void vPortEnableInterrupts(void) {
+  SIM_masked = 0;
+  SIM_DispatchIrqs();
+}
+
+void vPortEnterCritical(void) {
+  SIM_masked = 1;
+  SIM_criticalNesting++;
+}
+
+void vPortExitCritical(void) {
+  configASSERT(SIM_criticalNesting!=0);
+  SIM_criticalNesting--;
+  if (SIM_criticalNesting==0) {
+    vPortEnableInterrupts();
+  }
+}
+
+UBaseType_t uxPortSetInterruptMask(void) {
+  UBaseType_t old = SIM_masked;
+
+  SIM_masked = 1;
+  return old;
+}
+
+void vPortClearInterruptMask(UBaseType_t ulNewMask) {
+  SIM_masked = ulNewMask;
+  SIM_DispatchIrqs();
+}
+
+BaseType_t xPortIsInsideInterrupt(void) {
+  return SIM_inIsr ? pdTRUE : pdFALSE;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* virtual time */
+uint64_t SIM_GetTimeNs(void) {
+  return SIM_timeNs;
+}
+
+void SIM_Schedule(SIM_EventId id, uint64_t timeNs, SIM_Callback fct) {
+  configASSERT(timeNs>=SIM_timeNs);
+  SIM_events[id].timeNs = timeNs;
+  SIM_events[id].fct = fct;
+  SIM_events[id].pending = true;
+}
+
+void SIM_Cancel(SIM_EventId id) {
+  SIM_events[id].pending = false;
+}
+
+bool SIM_IsScheduled(SIM_EventId id) {
+  return SIM_events[id].pending;
+}
+
+/*! \return ID of the next event, SIM_NOF_EVENTS if there is none */
+static int SIM_NextEvent(void) {
+  int i, next = SIM_NOF_EVENTS;
+
+  for(i=0; i<SIM_NOF_EVENTS; i++) {
+    if (SIM_events[i].pending && (next==SIM_NOF_EVENTS || SIM_events[i].timeNs<SIM_events[next].timeNs)) {
+      next = i;
+    }
+  }
+  return next;
+}
+
+/*! \brief Runs the events up to a time, the interrupts set pending are not served */
+static void SIM_AdvanceTo(uint64_t timeNs) {
+  int next;
+
+  for(;;) {
+    next = SIM_NextEvent();
+    if (next==SIM_NOF_EVENTS || SIM_events[next].timeNs>timeNs) {
+      break;
+    }
+    SIM_timeNs = SIM_events[next].timeNs;
+    SIM_events[next].pending = false;
+    SIM_events[next].fct();
+  }
+  SIM_timeNs = timeNs;
+}
+
+void SIM_WaitNs(uint64_t ns) {
+  uint64_t endNs = SIM_timeNs+ns;
+  int next;
+
+  while (SIM_timeNs<endNs) {
+    next = SIM_NextEvent();
+    if (next!=SIM_NOF_EVENTS && SIM_events[next].timeNs<endNs) {
+      SIM_AdvanceTo(SIM_events[next].timeNs);
+    } else {
+      SIM_AdvanceTo(endNs);
+    }
+    SIM_DispatchIrqs(); /* can switch to another task, its time counts for the wait */
+  }
+}
+
+void SIM_IdleHook(void) {
+  extern void McuRTOS_vApplicationIdleHook(void);
+  int next;
+
+  McuRTOS_vApplicationIdleHook();
+  next = SIM_NextEvent();
+  configASSERT(next!=SIM_NOF_EVENTS); /* at least the tick */
+  SIM_AdvanceTo(SIM_events[next].timeNs);
+  SIM_DispatchIrqs();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* scheduler */
+static void SIM_OnTickEvent(void) {
+  SIM_Schedule(SIM_EVENT_TICK, SIM_timeNs+SIM_NS_PER_MS*1000/configTICK_RATE_HZ, SIM_OnTickEvent);
+  SIM_PendIrq(SIM_IRQ_SYSTICK);
+}
+
+static void SIM_SysTickHandler(void) {
+  UBaseType_t mask;
+
+  mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  if (xTaskIncrementTick()!=pdFALSE) {
+    vPortYieldFromISR();
+  }
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+BaseType_t xPortStartScheduler(void) {
+  SIM_SetIrqHandler(SIM_IRQ_SYSTICK, SIM_SysTickHandler);
+  SIM_Schedule(SIM_EVENT_TICK, SIM_timeNs+SIM_NS_PER_MS*1000/configTICK_RATE_HZ, SIM_OnTickEvent);
+  SIM_criticalNesting = 0;
+  SIM_masked = 0;
+  SIM_currentCtx = SIM_TaskContext();
+  (void)swapcontext(&SIM_schedulerCtx, &SIM_currentCtx->ctx);
+  return pdFALSE; /* vTaskEndScheduler() */
+}
+
+void vPortEndScheduler(void) {
+  (void)setcontext(&SIM_schedulerCtx);
+}
+
+void SIM_Stop(void) {
+  vTaskEndScheduler();
+}
@@ -0,0 +1,86 @@
+/**
+ * \file
+ * \brief FreeRTOS port macros of the robot simulation
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Port of the vendored kernel (McuLib/FreeRTOS) for the host simulation. The tasks are coroutines
+ * (ucontext) in one host thread, so the kernel runs as on the single core of the target: the
+ * interrupt mask of the port corresponds to BASEPRI at configMAX_SYSCALL_INTERRUPT_PRIORITY, a
+ * yield inside a critical section or an interrupt is pending until it ends, as PendSV. Time is
+ * virtual, see port.c.
+ */
+
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "FreeRTOSConfig.h"
+#include "projdefs.h" /* for pdFALSE, pdTRUE */
+
+/* Type definitions. */
+#define portCHAR               char
+#define portFLOAT              float
+#define portDOUBLE             double
+#define portLONG               long
+#define portSHORT              short
+#define portSTACK_TYPE         uintptr_t
+#define portBASE_TYPE          long
+#define portPOINTER_SIZE_TYPE  uintptr_t
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if( configUSE_16_BIT_TICKS == 1 )
+  typedef uint16_t TickType_t;
+  #define portMAX_DELAY        ( TickType_t ) 0xffff
+#else
+  typedef uint32_t TickType_t;
+  #define portMAX_DELAY        ( TickType_t ) 0xffffffffUL
+  #define portTICK_TYPE_IS_ATOMIC  1 /* one host thread */
+#endif
+
+/* Architecture specifics. */
+#define portSTACK_GROWTH       ( -1 )
+#define portTICK_PERIOD_MS     ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define portBYTE_ALIGNMENT     8
+#define portNOP()              /* nothing */
+#define portINLINE             __inline
+#define portFORCE_INLINE       inline __attribute__(( always_inline))
+
+/* Scheduler utilities. */
+void vPortYield(void);
+void vPortYieldFromISR(void);
+#define portYIELD()                     vPortYield()
+#define portEND_SWITCHING_ISR(xSwitchRequired) do { if( (xSwitchRequired) != pdFALSE ) { vPortYieldFromISR(); } } while(0)
+#define portYIELD_FROM_ISR(x)           portEND_SWITCHING_ISR(x)
+
+/* Critical section management. */
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+void vPortDisableInterrupts(void);
+void vPortEnableInterrupts(void);
+UBaseType_t uxPortSetInterruptMask(void);
+void vPortClearInterruptMask(UBaseType_t ulNewMask);
+BaseType_t xPortIsInsideInterrupt(void);
+
+#define portSET_INTERRUPT_MASK_FROM_ISR()       uxPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)    vPortClearInterruptMask(x)
+#define portDISABLE_INTERRUPTS()                vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()                 vPortEnableInterrupts()
+#define portENTER_CRITICAL()                    vPortEnterCritical()
+#define portEXIT_CRITICAL()                     vPortExitCritical()
+
+/* Task function macros as described on the FreeRTOS.org WEB site. */
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PORTMACRO_H */
@@ -0,0 +1,838 @@
+/**
+ * \file
+ * \brief Host simulation of the sumo robot in the dohyo
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs the firmware (RoboLib, compiled unchanged, with the vendored FreeRTOS kernel) against a
+ * physics model of the robot, its sensors and an opponent, in virtual time (port.c):
+ * - motors: DIR pin and PWM, first order to the wheel speed
+ * - encoders: one quadrature edge per step at the exact time, as pin interrupts
+ * - reflectance: the capacitor discharges fast over the white border ring, slow over black
+ * - proximity: the receivers see the opponent if it is in the cones of the selected sender and
+ *   of the receiver, the closer, the shorter the burst needed
+ * - opponent: drives towards the robot and turns back at the border; in contact the motors of
+ *   both robots work against the force of the other one, see ContactLoads()
+ * Each bout runs in its own process (the firmware has static state): SW3 is pressed, the bout
+ * starts after the count down of 5 s and ends when a robot leaves the dohyo, or after 60 s.
+ *
+ * With -p, each proximity scan of the bouts is written to a text file, the input of
+ * Tools/TrackerReplay: '# bout <seed>' starts a bout, then one line per scan with the cycle counter
+ * of the scan, found (0/1), raw and filtered bearing in degrees and the odometry heading in
+ * centi-degrees, counter-clockwise.
+ *
+ * Build: see run_robo_sim.sh, PL_CONFIG_HAS_EXEC=0 builds the variant with the tasks,
+ *        SUMO_USE_TRACKER=0 the one which turns to the last scan instead of the tracker estimate
+ * Usage: robo_sim [-n <bouts>] [-s <seed>] [-v] [-t] [-b] [-p <file>], -v prints each bout, -t the
+ *        poses every 50 ms, -b runs the turn benchmark instead of bouts, with -n turns of each kind,
+ *        -p records the proximity scans
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Platform.h"
+#include "Application.h"
+#include "Pin.h"
+#include "Quadrature.h"
+#include "Drive.h"
+#include "Turn.h"
+#include "Proximity.h"
+#include "Odometry.h"
+#include "Sumo.h"
+#include "Span.h"
+#include "Sim.h"
+#include "RoboModel.h"
+
+#define PHYSICS_STEP_NS     (250*SIM_NS_PER_US)
+#define STEPS_PER_MM        (8.985)   /* as ODO_CONFIG_TICKS_PER_M */
+#define WHEEL_BASE_MM       (85.0)    /* as ODO_CONFIG_WHEEL_BASE_UM */
+#define MOTOR_VMAX_MM_S     (445.0)   /* wheel speed at full PWM, about 4000 steps/s */
+#define MOTOR_TAU_S         (0.030)   /* time constant of the motor with the robot */
+#define ROBOT_RADIUS_MM     (55.0)    /* for the collision */
+
+#define DOHYO_RADIUS_MM     (385.0)   /* mini sumo */
+#define DOHYO_BORDER_MM     (25.0)    /* white ring inside the radius */
+#define EDGE_WHITE_NS       (150*SIM_NS_PER_US) /* discharge time of the reflectance sensors */
+#define EDGE_BLACK_NS       (1500*SIM_NS_PER_US) /* after the timeout of the measurement */
+#define BORDER_FORWARD_MM_S (50.0)    /* wheel speeds to measure the border to reversal latency */
+
+#ifndef SUMO_USE_TRACKER
+  #define SUMO_USE_TRACKER    PL_CONFIG_HAS_TRACKER /* default of Sumo.c */
+#endif
+
+#define PROX_RANGE_MM       (600.0)   /* distance to the opponent, from the front of the robot */
+#define PROX_SENDER_DEG     (30.0)    /* direction of the IR senders, left +, right - */
+#define PROX_SENDER_HALF    (45.0)
+#define PROX_RECEIVER_DEG   (60.0)    /* direction of the left and right receiver, the middle one at 0 */
+#define PROX_RECEIVER_HALF  (35.0)
+#define PROX_CONE_JITTER    (10.0)    /* the edges of the cones vary with the surface of the opponent, +/- deg */
+#define PROX_BURST_JITTER   (0.3)     /* so does the burst needed for a reflection, +/- fraction */
+
+#define BOUT_PRESS_NS       (500*SIM_NS_PER_MS)   /* SW3 is pressed for 100 ms */
+#define BOUT_RELEASE_NS     (600*SIM_NS_PER_MS)
+#define BOUT_START_NS       (BOUT_RELEASE_NS+5000*SIM_NS_PER_MS) /* count down of the robot */
+#define BOUT_MAX_NS         (BOUT_START_NS+60000*SIM_NS_PER_MS)
+
+typedef enum {
+  BOUT_DRAW,
+  BOUT_WIN,       /* the opponent left the dohyo */
+  BOUT_LOSS       /* the robot left the dohyo */
+} BoutResult;
+
+/*! \brief Statistics of a latency in the virtual time */
+typedef struct {
+  uint32_t count;
+  uint32_t minUs, maxUs;
+  uint64_t sumUs;
+} Latency;
+
+typedef struct {
+  BoutResult result;
+  uint32_t timeMs;          /* from the start of the bout */
+  uint32_t nofBorders;      /* reflectance sensors reaching the white ring */
+  uint32_t nofEncErrors;    /* should be 0 */
+  Latency reversal;         /* from a sensor reaching the white ring while driving forward to both DIR pins backward */
+  uint32_t nofNoReversal;   /* back on black without a reversal */
+  uint32_t nofTargetTurns;  /* turns towards the opponent, see SUMO_GetNofTargetTurns() */
+  SPAN_Stats spans[SPAN_NOF_IDS];
+} BoutReport;
+
+typedef struct {
+  double x, y, heading;     /* mm, radians, heading 0 along x, counter clockwise */
+} Pose;
+
+/* the robot running the firmware */
+static struct {
+  Pose pose;
+  double speed[2];          /* wheel speeds in mm/s, left and right */
+  uint16_t pwm[2];
+  bool dirForward[2];
+  double pos[2];            /* wheel positions in steps at posNs */
+  uint64_t posNs;
+  int32_t steps[2];         /* steps output on the encoder pins */
+  uint64_t edgeDischargeNs[4]; /* start of the discharge of the reflectance sensors, 0: charging */
+  bool edgeIrqEnabled[4];
+  bool onWhite;             /* a sensor is over the white ring */
+  uint64_t whiteNs;         /* reached the white ring driving forward, 0: no reversal pending */
+  uint64_t selectNs;        /* last change of the IR sender selection */
+  bool selectLeft;
+} robot;
+
+/* the opponent */
+static struct {
+  Pose pose;
+  double duty;              /* PWM duty, 0..1 */
+  double turnRate;          /* rad/s */
+} opponent;
+
+static BoutReport report;
+static bool verbose, trace, turnBench;
+static FILE *proxLog;       /* -p: proximity scans, NULL if not recorded */
+static uint32_t proxLogScanNo;
+
+static const double edgeSensorX[4] = {45.0, 45.0, 45.0, 45.0}; /* L, ML, MR, R in the robot frame, mm */
+static const double edgeSensorY[4] = {40.0, 12.0, -12.0, -40.0};
+static const uint8_t grayCode[4] = {0, 1, 3, 2}; /* pin states A<<1|B for counting up */
+
+static double Sq(double x) {
+  return x*x;
+}
+
+static double WrapRad(double a) {
+  while (a>M_PI) {
+    a -= 2.0*M_PI;
+  }
+  while (a<=-M_PI) {
+    a += 2.0*M_PI;
+  }
+  return a;
+}
+
+static double Rnd(double min, double max) {
+  return min+(max-min)*((double)rand()/RAND_MAX);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* dohyo and reflectance sensors */
+static bool IsWhite(double x, double y) {
+  double r = hypot(x, y);
+
+  return r>=DOHYO_RADIUS_MM-DOHYO_BORDER_MM && r<=DOHYO_RADIUS_MM; /* off the dohyo is black */
+}
+
+static void EdgeSensorPos(int idx, double *x, double *y) {
+  double c = cos(robot.pose.heading), s = sin(robot.pose.heading);
+
+  *x = robot.pose.x+edgeSensorX[idx]*c-edgeSensorY[idx]*s;
+  *y = robot.pose.y+edgeSensorX[idx]*s+edgeSensorY[idx]*c;
+}
+
+static uint64_t EdgeDischargeNs(int idx) {
+  double x, y;
+
+  EdgeSensorPos(idx, &x, &y);
+  return IsWhite(x, y) ? EDGE_WHITE_NS : EDGE_BLACK_NS;
+}
+
+static void OnEdgeEvent(int idx) {
+  if (robot.edgeIrqEnabled[idx]) {
+    SIM_PendIrq(SIM_IRQ_EDGE_L+idx);
+  }
+}
+
+static void OnEdgeEventL(void)  { OnEdgeEvent(0); }
+static void OnEdgeEventML(void) { OnEdgeEvent(1); }
+static void OnEdgeEventMR(void) { OnEdgeEvent(2); }
+static void OnEdgeEventR(void)  { OnEdgeEvent(3); }
+
+static const SIM_Callback edgeEvents[4] = {OnEdgeEventL, OnEdgeEventML, OnEdgeEventMR, OnEdgeEventR};
+
+/*------------------------------------------------------------------------------------------------*/
+/* encoders */
+static double WheelPos(int wheel, uint64_t timeNs) {
+  return robot.pos[wheel]+robot.speed[wheel]*STEPS_PER_MM*(double)(timeNs-robot.posNs)/1e9;
+}
+
+static void ScheduleEdge(int wheel);
+
+static void OnEncoderEdge(int wheel) {
+  if (robot.speed[wheel]>0.0) {
+    robot.steps[wheel]++;
+  } else {
+    robot.steps[wheel]--;
+  }
+  SIM_PendIrq(wheel==0 ? SIM_IRQ_ENC_L : SIM_IRQ_ENC_R);
+  ScheduleEdge(wheel);
+}
+
+static void OnEncoderEdgeL(void) { OnEncoderEdge(0); }
+static void OnEncoderEdgeR(void) { OnEncoderEdge(1); }
+
+/*! \brief Schedules the next step of a wheel at constant speed, one step of hysteresis at reversals */
+static void ScheduleEdge(int wheel) {
+  SIM_EventId id = wheel==0 ? SIM_EVENT_ENC_L : SIM_EVENT_ENC_R;
+  double v = robot.speed[wheel]*STEPS_PER_MM, p = WheelPos(wheel, SIM_GetTimeNs()), dt;
+
+  if (fabs(v)<1e-3) {
+    SIM_Cancel(id);
+    return;
+  }
+  dt = v>0.0 ? (robot.steps[wheel]+1-p)/v : (robot.steps[wheel]-1-p)/v;
+  if (dt<0.0) {
+    dt = 0.0;
+  }
+  SIM_Schedule(id, SIM_GetTimeNs()+(uint64_t)(dt*1e9)+1, wheel==0 ? OnEncoderEdgeL : OnEncoderEdgeR);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* proximity */
+static bool InCone(double bearingDeg, double dirDeg, double halfDeg) {
+  return fabs(bearingDeg-dirDeg)<=halfDeg;
+}
+
+/*! \return If the receiver sees the opponent with the selected sender */
+static bool ProxReceiver(double receiverDeg) {
+  double dx = opponent.pose.x-robot.pose.x, dy = opponent.pose.y-robot.pose.y;
+  double bearing = WrapRad(atan2(dy, dx)-robot.pose.heading)*180.0/M_PI;
+  double d = hypot(dx, dy)-2.0*ROBOT_RADIUS_MM, needUs, burstUs;
+
+  if (d>PROX_RANGE_MM) {
+    return false;
+  }
+  if (!InCone(bearing, robot.selectLeft ? PROX_SENDER_DEG : -PROX_SENDER_DEG,
+        PROX_SENDER_HALF+Rnd(-PROX_CONE_JITTER, PROX_CONE_JITTER))
+      || !InCone(bearing, receiverDeg, PROX_RECEIVER_HALF+Rnd(-PROX_CONE_JITTER, PROX_CONE_JITTER)))
+  {
+    return false;
+  }
+  if (d<50.0) {
+    d = 50.0;
+  }
+  needUs = 40.0+460.0*Sq((d-50.0)/(PROX_RANGE_MM-50.0)); /* weaker reflection needs a longer burst */
+  needUs *= 1.0+Rnd(-PROX_BURST_JITTER, PROX_BURST_JITTER);
+  burstUs = (double)(SIM_GetTimeNs()-robot.selectNs)/SIM_NS_PER_US;
+  return burstUs>=needUs;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* interface to the board */
+bool MODEL_GetInput(Pin_PinId pin) {
+  switch(pin) {
+    case PIN_SW3: /* high while pressed */
+      return !turnBench && SIM_GetTimeNs()>=BOUT_PRESS_NS && SIM_GetTimeNs()<BOUT_RELEASE_NS;
+    case PIN_ENCL_A: return (grayCode[robot.steps[0]&3]&2)!=0;
+    case PIN_ENCL_B: return (grayCode[robot.steps[0]&3]&1)!=0;
+    case PIN_ENCR_A: return (grayCode[robot.steps[1]&3]&2)!=0;
+    case PIN_ENCR_B: return (grayCode[robot.steps[1]&3]&1)!=0;
+    case PIN_PROX_L: return !ProxReceiver(PROX_RECEIVER_DEG); /* active low */
+    case PIN_PROX_M: return !ProxReceiver(0.0);
+    case PIN_PROX_R: return !ProxReceiver(-PROX_RECEIVER_DEG);
+    case PIN_EDGE_L:
+    case PIN_EDGE_ML:
+    case PIN_EDGE_MR:
+    case PIN_EDGE_R: {
+      int idx = pin-PIN_EDGE_L;
+      return robot.edgeDischargeNs[idx]==0 || SIM_GetTimeNs()<robot.edgeDischargeNs[idx]+EdgeDischargeNs(idx);
+    }
+    default:
+      return false;
+  }
+}
+
+static void OnReversal(void);
+
+void MODEL_OnOutput(Pin_PinId pin, bool isHigh) {
+  switch(pin) {
+    case PIN_PROX_IR_SELECT:
+      robot.selectLeft = isHigh;
+      robot.selectNs = SIM_GetTimeNs();
+      break;
+    case PIN_DIR_L:
+    case PIN_DIR_R:
+      robot.dirForward[pin==PIN_DIR_L ? 0 : 1] = isHigh;
+      if (!robot.dirForward[0] && !robot.dirForward[1]) {
+        OnReversal();
+      }
+      break;
+    case PIN_EDGE_L:
+    case PIN_EDGE_ML:
+    case PIN_EDGE_MR:
+    case PIN_EDGE_R:
+      robot.edgeDischargeNs[pin-PIN_EDGE_L] = 0; /* charging */
+      break;
+    default:
+      break;
+  }
+}
+
+void MODEL_OnEdgeDischarge(Pin_PinId pin) {
+  robot.edgeDischargeNs[pin-PIN_EDGE_L] = SIM_GetTimeNs();
+}
+
+void MODEL_OnEdgeInterrupt(Pin_PinId pin, bool enabled) {
+  int idx = pin-PIN_EDGE_L;
+  uint64_t lowNs;
+
+  robot.edgeIrqEnabled[idx] = enabled;
+  if (!enabled) {
+    SIM_Cancel(SIM_EVENT_EDGE_L+idx);
+    return;
+  }
+  lowNs = robot.edgeDischargeNs[idx]+EdgeDischargeNs(idx);
+  if (robot.edgeDischargeNs[idx]!=0 && lowNs>=SIM_GetTimeNs()) { /* no edge if already low */
+    SIM_Schedule(SIM_EVENT_EDGE_L+idx, lowNs, edgeEvents[idx]);
+  }
+}
+
+void MODEL_OnPwm(bool isLeft, uint16_t value) {
+  robot.pwm[isLeft ? 0 : 1] = value;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* physics */
+static void Move(Pose *pose, double dL, double dR) {
+  double ds = (dL+dR)/2.0, dh = (dR-dL)/WHEEL_BASE_MM;
+
+  pose->x += ds*cos(pose->heading+dh/2.0);
+  pose->y += ds*sin(pose->heading+dh/2.0);
+  pose->heading = WrapRad(pose->heading+dh);
+}
+
+/*!
+ * \brief Pushing match: the motors work against the force of the other robot along the line
+ * between them, as a load in PWM duty units. The wheels do not slip, so the encoders of the robot
+ * see the slow down and the speed controller increases the PWM.
+ * \param robotLoad Load on the wheels of the robot, in their forward direction
+ * \param opponentLoad Load on the opponent, in its forward direction
+ */
+static void ContactLoads(double *robotLoad, double *opponentLoad) {
+  double dx = opponent.pose.x-robot.pose.x, dy = opponent.pose.y-robot.pose.y, d = hypot(dx, dy);
+  double robotDir, opponentDir, robotForce, opponentForce;
+
+  *robotLoad = *opponentLoad = 0.0;
+  if (d>2.0*ROBOT_RADIUS_MM+1.0 || d<1e-6) {
+    return;
+  }
+  robotDir = (cos(robot.pose.heading)*dx+sin(robot.pose.heading)*dy)/d; /* towards the opponent */
+  opponentDir = -(cos(opponent.pose.heading)*dx+sin(opponent.pose.heading)*dy)/d;
+  robotForce = ((robot.dirForward[0] ? 1.0 : -1.0)*robot.pwm[0]+(robot.dirForward[1] ? 1.0 : -1.0)*robot.pwm[1])
+               /2.0/0xffff*robotDir;
+  opponentForce = opponent.duty*opponentDir;
+  if (opponentForce>0.0) {
+    *robotLoad = opponentForce*robotDir;
+  }
+  if (robotForce>0.0) {
+    *opponentLoad = robotForce*opponentDir;
+  }
+}
+
+static void MoveOpponent(double dt, double load) {
+  double toRobot, toCenter, want, turn, r, speed;
+
+  if (SIM_GetTimeNs()<BOUT_START_NS) {
+    return;
+  }
+  r = hypot(opponent.pose.x, opponent.pose.y);
+  toRobot = atan2(robot.pose.y-opponent.pose.y, robot.pose.x-opponent.pose.x);
+  toCenter = atan2(-opponent.pose.y, -opponent.pose.x);
+  want = r>DOHYO_RADIUS_MM-DOHYO_BORDER_MM-20.0 && fabs(WrapRad(toRobot-toCenter))>M_PI/2 ? toCenter : toRobot;
+  turn = WrapRad(want-opponent.pose.heading);
+  if (fabs(turn)>opponent.turnRate*dt) {
+    turn = turn>0.0 ? opponent.turnRate*dt : -opponent.turnRate*dt;
+  }
+  opponent.pose.heading = WrapRad(opponent.pose.heading+turn);
+  speed = (opponent.duty-load)*MOTOR_VMAX_MM_S;
+  opponent.pose.x += speed*dt*cos(opponent.pose.heading);
+  opponent.pose.y += speed*dt*sin(opponent.pose.heading);
+}
+
+/*! \brief Pushes the robots apart if they still overlap after the step, both by the same distance */
+static void Collide(void) {
+  double dx = opponent.pose.x-robot.pose.x, dy = opponent.pose.y-robot.pose.y;
+  double d = hypot(dx, dy), overlap = 2.0*ROBOT_RADIUS_MM-d;
+
+  if (overlap<=0.0 || d<1e-6) {
+    return;
+  }
+  dx /= d;
+  dy /= d;
+  robot.pose.x -= dx*overlap/2.0;
+  robot.pose.y -= dy*overlap/2.0;
+  opponent.pose.x += dx*overlap/2.0;
+  opponent.pose.y += dy*overlap/2.0;
+}
+
+static void AddLatency(Latency *l, uint32_t us) {
+  if (l->count==0 || us<l->minUs) {
+    l->minUs = us;
+  }
+  if (us>l->maxUs) {
+    l->maxUs = us;
+  }
+  l->sumUs += us;
+  l->count++;
+}
+
+static void MergeLatency(Latency *sum, const Latency *l) {
+  if (l->count==0) {
+    return;
+  }
+  if (sum->count==0 || l->minUs<sum->minUs) {
+    sum->minUs = l->minUs;
+  }
+  if (l->maxUs>sum->maxUs) {
+    sum->maxUs = l->maxUs;
+  }
+  sum->sumUs += l->sumUs;
+  sum->count += l->count;
+}
+
+/*! \brief The firmware reversed both motors: ends a pending border to reversal measurement */
+static void OnReversal(void) {
+  if (robot.whiteNs!=0) {
+    AddLatency(&report.reversal, (uint32_t)((SIM_GetTimeNs()-robot.whiteNs)/SIM_NS_PER_US));
+    robot.whiteNs = 0;
+  }
+}
+
+/*!
+ * \brief Checks if a reflectance sensor is over the white ring, once per physics step: the border
+ * to reversal latency has a resolution of PHYSICS_STEP_NS.
+ */
+static void UpdateBorder(void) {
+  double x, y;
+  bool white = false;
+  int i;
+
+  for(i=0; i<4; i++) {
+    EdgeSensorPos(i, &x, &y);
+    white |= IsWhite(x, y);
+  }
+  if (white && !robot.onWhite) {
+    report.nofBorders++;
+    if (robot.dirForward[0] && robot.dirForward[1] && robot.pwm[0]!=0 && robot.pwm[1]!=0
+        && robot.speed[0]>BORDER_FORWARD_MM_S && robot.speed[1]>BORDER_FORWARD_MM_S) { /* driving forward */
+      robot.whiteNs = SIM_GetTimeNs();
+    }
+  } else if (!white && robot.onWhite && robot.whiteNs!=0) {
+    report.nofNoReversal++;
+    robot.whiteNs = 0;
+  }
+  robot.onWhite = white;
+}
+
+static void EndBout(BoutResult result) {
+  int i;
+
+  report.result = result;
+  report.timeMs = (uint32_t)((SIM_GetTimeNs()-BOUT_START_NS)/SIM_NS_PER_MS);
+  report.nofEncErrors = QUAD_NofLeftErrors()+QUAD_NofRightErrors();
+  report.nofTargetTurns = SUMO_GetNofTargetTurns();
+  for(i=0; i<SPAN_NOF_IDS; i++) {
+    (void)SPAN_GetStats((SPAN_Id)i, &report.spans[i]);
+  }
+  SIM_Stop();
+}
+
+/*! \brief Writes a new proximity scan to the log, with the heading of the odometry */
+static void LogScan(void) {
+  PROX_Result scan;
+  ODO_Pose pose;
+
+  if (SIM_GetTimeNs()<BOUT_START_NS || !PROX_GetResult(&scan, NULL) || scan.scanNo==proxLogScanNo) {
+    return;
+  }
+  proxLogScanNo = scan.scanNo;
+  ODO_GetPose(&pose);
+  fprintf(proxLog, "%u %d %d %d %d\n", (unsigned)scan.timestamp, scan.proximityFound ? 1 : 0,
+    scan.rawAngle, scan.proximityAngle, (int)pose.heading);
+}
+
+/* turn benchmark: steps past the target and peak speed of the wheels, measured by the physics */
+static struct {
+  bool active;
+  double start[2], steps[2];  /* wheel positions at the start of the turn, steps to turn */
+  double overshoot, peakSpeed; /* steps, steps/sec */
+} benchTrack;
+
+static void BenchTrack(void) {
+  double past, v;
+  int i;
+
+  for(i=0; i<2; i++) {
+    past = robot.pos[i]-benchTrack.start[i]-benchTrack.steps[i];
+    if (benchTrack.steps[i]<0) {
+      past = -past;
+    }
+    if (past>benchTrack.overshoot) {
+      benchTrack.overshoot = past;
+    }
+    v = fabs(robot.speed[i])*STEPS_PER_MM;
+    if (v>benchTrack.peakSpeed) {
+      benchTrack.peakSpeed = v;
+    }
+  }
+}
+
+static void OnPhysics(void) {
+  double dt = (double)PHYSICS_STEP_NS/1e9, k = 1.0-exp(-dt/MOTOR_TAU_S), target, p[2];
+  double robotLoad, opponentLoad;
+  int i;
+
+  SIM_Schedule(SIM_EVENT_PHYSICS, SIM_GetTimeNs()+PHYSICS_STEP_NS, OnPhysics);
+  for(i=0; i<2; i++) { /* wheel positions so far, with the speed of the last step */
+    p[i] = WheelPos(i, SIM_GetTimeNs());
+  }
+  Move(&robot.pose, (p[0]-robot.pos[0])/STEPS_PER_MM, (p[1]-robot.pos[1])/STEPS_PER_MM);
+  robot.posNs = SIM_GetTimeNs();
+  ContactLoads(&robotLoad, &opponentLoad);
+  for(i=0; i<2; i++) {
+    robot.pos[i] = p[i];
+    target = MOTOR_VMAX_MM_S*robot.pwm[i]/0xffff;
+    if (!robot.dirForward[i]) {
+      target = -target;
+    }
+    target -= MOTOR_VMAX_MM_S*robotLoad;
+    robot.speed[i] += (target-robot.speed[i])*k;
+    ScheduleEdge(i);
+  }
+  if (turnBench) {
+    if (benchTrack.active) {
+      BenchTrack();
+    }
+    return; /* no opponent, ends with the benchmark */
+  }
+  MoveOpponent(dt, opponentLoad);
+  Collide();
+  UpdateBorder();
+  if (proxLog!=NULL) {
+    LogScan();
+  }
+  if (trace && SIM_GetTimeNs()%(50*SIM_NS_PER_MS)==0) {
+    printf("%6u ms robot %6.1f %6.1f %6.1f deg %6.1f %6.1f mm/s dir %d%d, opponent %6.1f %6.1f\n",
+      (unsigned int)(SIM_GetTimeNs()/SIM_NS_PER_MS), robot.pose.x, robot.pose.y, robot.pose.heading*180.0/M_PI,
+      robot.speed[0], robot.speed[1], robot.dirForward[0], robot.dirForward[1], opponent.pose.x, opponent.pose.y);
+  }
+  if (hypot(robot.pose.x, robot.pose.y)>DOHYO_RADIUS_MM) {
+    EndBout(BOUT_LOSS);
+  } else if (hypot(opponent.pose.x, opponent.pose.y)>DOHYO_RADIUS_MM) {
+    EndBout(BOUT_WIN);
+  } else if (SIM_GetTimeNs()>=BOUT_MAX_NS) {
+    EndBout(BOUT_DRAW);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* bouts */
+static void SetupBout(unsigned int seed) {
+  double a;
+
+  srand(seed);
+  memset(&robot, 0, sizeof(robot));
+  a = Rnd(-M_PI, M_PI);
+  robot.pose.x = 150.0*cos(a);
+  robot.pose.y = 150.0*sin(a);
+  robot.pose.heading = Rnd(-M_PI, M_PI);
+  robot.dirForward[0] = robot.dirForward[1] = true;
+  opponent.pose.x = -robot.pose.x;
+  opponent.pose.y = -robot.pose.y;
+  opponent.pose.heading = Rnd(-M_PI, M_PI);
+  opponent.duty = Rnd(0.3, 0.6);
+  opponent.turnRate = Rnd(1.0, 4.0);
+  SIM_Schedule(SIM_EVENT_PHYSICS, PHYSICS_STEP_NS, OnPhysics);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* turn benchmark */
+#define BENCH_SETTLE_MS     500   /* after a turn, before the error is measured */
+
+typedef struct {
+  const char *name;
+  TURN_Kind kind;
+  int32_t steps90;          /* steps of the right wheel, in TURN_GetSteps90() */
+  double deg;               /* change of the heading, counter clockwise */
+} BenchTurn;
+
+static const BenchTurn benchTurns[] = {
+  {"left 90",   TURN_LEFT90,    1,   90.0},
+  {"right 90",  TURN_RIGHT90,  -1,  -90.0},
+  {"left 180",  TURN_LEFT180,   2,  180.0},
+  {"right 180", TURN_RIGHT180, -2, -180.0},
+};
+
+static unsigned int benchRuns;
+
+/*!
+ * \brief Turn as StepsTurn() did before the move profiles: the position setpoints jump to the target,
+ * then DRV_HasTurned() is polled every millisecond, with the timeout of TURN_STEPS_90_TIMEOUT_MS.
+ */
+static void JumpTurn(int32_t stepsL, int32_t stepsR, int32_t timeoutMs) {
+  (void)DRV_SetPos((int32_t)QUAD_GetLeftPos()+stepsL, (int32_t)QUAD_GetRightPos()+stepsR);
+  (void)DRV_SetMode(DRV_MODE_POS);
+  for(;;) {
+    vTaskDelay(pdMS_TO_TICKS(1));
+    timeoutMs--;
+    if (timeoutMs<=0 || DRV_HasTurned()) {
+      break;
+    }
+  }
+}
+
+static void BenchTask(void *pvParameters) {
+  static const char *const methodStr[] = {"jump", "profile"};
+  const BenchTurn *turn;
+  int32_t stepsR, targetL, targetR, err, errL, errR;
+  double heading, deg;
+  uint64_t startNs;
+  unsigned int i, j, method;
+  Latency time, steps, angle, overshoot, peak; /* angle in 1/100 degree */
+
+  (void)pvParameters;
+  vTaskDelay(pdMS_TO_TICKS(1000)); /* initialization of the robot */
+  printf("turn        method     time ms (min/mean/max)  error steps (mean/max)  error deg (mean/max)  overshoot steps (mean/max)  peak steps/s\n");
+  for(i=0; i<sizeof(benchTurns)/sizeof(benchTurns[0]); i++) {
+    turn = &benchTurns[i];
+    stepsR = turn->steps90*TURN_GetSteps90();
+    for(method=0; method<2; method++) {
+      memset(&time, 0, sizeof(time));
+      memset(&steps, 0, sizeof(steps));
+      memset(&angle, 0, sizeof(angle));
+      memset(&overshoot, 0, sizeof(overshoot));
+      memset(&peak, 0, sizeof(peak));
+      for(j=0; j<benchRuns; j++) {
+        heading = robot.pose.heading;
+        targetL = (int32_t)QUAD_GetLeftPos()-stepsR;
+        targetR = (int32_t)QUAD_GetRightPos()+stepsR;
+        benchTrack.start[0] = robot.pos[0];
+        benchTrack.start[1] = robot.pos[1];
+        benchTrack.steps[0] = -stepsR;
+        benchTrack.steps[1] = stepsR;
+        benchTrack.overshoot = benchTrack.peakSpeed = 0.0;
+        benchTrack.active = true;
+        startNs = SIM_GetTimeNs();
+        if (method==0) {
+          JumpTurn(-stepsR, stepsR, 1000*(stepsR<0 ? -turn->steps90 : turn->steps90));
+        } else {
+          TURN_Turn(turn->kind, NULL);
+        }
+        AddLatency(&time, (uint32_t)((SIM_GetTimeNs()-startNs)/SIM_NS_PER_US));
+        vTaskDelay(pdMS_TO_TICKS(BENCH_SETTLE_MS)); /* holding the position */
+        benchTrack.active = false;
+        AddLatency(&overshoot, (uint32_t)benchTrack.overshoot);
+        AddLatency(&peak, (uint32_t)benchTrack.peakSpeed);
+        errL = targetL-(int32_t)QUAD_GetLeftPos();
+        errR = targetR-(int32_t)QUAD_GetRightPos();
+        err = abs(errL)>abs(errR) ? abs(errL) : abs(errR);
+        AddLatency(&steps, (uint32_t)err);
+        deg = WrapRad(robot.pose.heading-heading-turn->deg*M_PI/180.0)*180.0/M_PI;
+        AddLatency(&angle, (uint32_t)(fabs(deg)*100.0));
+      }
+      printf("%-10s  %-8s %7.1f %7.1f %7.1f  %10.1f %10u  %10.2f %10.2f  %12.1f %12u  %12u\n", turn->name, methodStr[method],
+        time.minUs/1000.0, time.sumUs/1000.0/time.count, time.maxUs/1000.0,
+        (double)steps.sumUs/steps.count, (unsigned)steps.maxUs,
+        angle.sumUs/100.0/angle.count, angle.maxUs/100.0,
+        (double)overshoot.sumUs/overshoot.count, (unsigned)overshoot.maxUs, (unsigned)peak.maxUs);
+    }
+  }
+  fflush(stdout);
+  SIM_Stop();
+}
+
+/*!
+ * \brief Compares the turns with the move profiles against the setpoint jump of the former
+ * StepsTurn(), standing in the middle of the dohyo without an opponent.
+ */
+static void RunTurnBench(unsigned int runs) {
+  memset(&robot, 0, sizeof(robot));
+  robot.dirForward[0] = robot.dirForward[1] = true;
+  opponent.pose.x = 10*DOHYO_RADIUS_MM; /* out of sight */
+  benchRuns = runs;
+  SIM_Schedule(SIM_EVENT_PHYSICS, PHYSICS_STEP_NS, OnPhysics);
+  if (xTaskCreate(BenchTask, "Bench", 800/sizeof(StackType_t), NULL, tskIDLE_PRIORITY+1, NULL)!=pdPASS) {
+    SIM_AssertFailed(__FILE__, __LINE__);
+  }
+  APP_Run(); /* returns with SIM_Stop() */
+}
+
+/*! \brief Runs one bout in this process */
+static void RunBout(unsigned int seed) {
+  memset(&report, 0, sizeof(report));
+  if (proxLog!=NULL) {
+    fprintf(proxLog, "# bout %u\n", seed);
+  }
+  SetupBout(seed);
+  APP_Run(); /* returns with SIM_Stop() */
+}
+
+/*! \brief Runs one bout in a child process, the firmware starts with its initial state */
+static int ForkBout(unsigned int seed, BoutReport *result) {
+  int fds[2], status;
+  pid_t pid;
+
+  if (pipe(fds)!=0) {
+    return -1;
+  }
+  fflush(NULL); /* not written twice by the child */
+  pid = fork();
+  if (pid==0) {
+    close(fds[0]);
+    RunBout(seed);
+    fflush(NULL); /* trace and log, _exit() does not flush */
+    if (write(fds[1], &report, sizeof(report))!=(ssize_t)sizeof(report)) {
+      _exit(1);
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  if (pid<0 || read(fds[0], result, sizeof(*result))!=(ssize_t)sizeof(*result)) {
+    close(fds[0]);
+    return -1;
+  }
+  close(fds[0]);
+  (void)waitpid(pid, &status, 0);
+  return 0;
+}
+
+static void AddSpans(SPAN_Stats *sum, const SPAN_Stats *stats) {
+  int i;
+
+  for(i=0; i<SPAN_NOF_IDS; i++) {
+    if (stats[i].count==0) {
+      continue;
+    }
+    if (sum[i].count==0 || stats[i].minNs<sum[i].minNs) {
+      sum[i].minNs = stats[i].minNs;
+    }
+    if (stats[i].maxNs>sum[i].maxNs) {
+      sum[i].maxNs = stats[i].maxNs;
+    }
+    sum[i].meanNs = (uint32_t)(((uint64_t)sum[i].meanNs*sum[i].count+(uint64_t)stats[i].meanNs*stats[i].count)
+                    /(sum[i].count+stats[i].count));
+    sum[i].count += stats[i].count;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  static const char *const resultStr[] = {"draw", "win", "loss"};
+  unsigned int nofBouts = 20, seed = 1, i, nof[3] = {0, 0, 0}, nofErrors = 0, nofNoReversal = 0;
+  unsigned int nofTurns = 0, minTurns = 0, maxTurns = 0;
+  uint64_t sumMs = 0;
+  Latency reversal;
+  SPAN_Stats spans[SPAN_NOF_IDS];
+  BoutReport bout;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:vtbp:"))!=-1) {
+    switch(opt) {
+      case 'n': nofBouts = (unsigned int)atoi(optarg); break;
+      case 's': seed = (unsigned int)atoi(optarg); break;
+      case 'v': verbose = true; break;
+      case 't': trace = true; break;
+      case 'b': turnBench = true; break;
+      case 'p':
+        proxLog = fopen(optarg, "w");
+        if (proxLog==NULL) {
+          perror(optarg);
+          return 2;
+        }
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n <bouts>] [-s <seed>] [-v] [-t] [-b] [-p <file>]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (turnBench) {
+    printf("robo_sim: %s, turn benchmark, %u turns each\n", PL_CONFIG_HAS_EXEC ? "executive" : "tasks", nofBouts);
+    RunTurnBench(nofBouts);
+    return 0;
+  }
+  memset(spans, 0, sizeof(spans));
+  memset(&reversal, 0, sizeof(reversal));
+  printf("robo_sim: %s, %s, %u bouts, seed %u\n", PL_CONFIG_HAS_EXEC ? "executive" : "tasks",
+    SUMO_USE_TRACKER ? "tracker" : "last scan", nofBouts, seed);
+  for(i=0; i<nofBouts; i++) {
+    if (ForkBout(seed+i, &bout)!=0) {
+      printf("FAILED: bout %u did not complete\n", i);
+      return 1;
+    }
+    nof[bout.result]++;
+    sumMs += bout.timeMs;
+    nofErrors += bout.nofEncErrors;
+    AddSpans(spans, bout.spans);
+    MergeLatency(&reversal, &bout.reversal);
+    nofNoReversal += bout.nofNoReversal;
+    nofTurns += bout.nofTargetTurns;
+    if (i==0 || bout.nofTargetTurns<minTurns) {
+      minTurns = bout.nofTargetTurns;
+    }
+    if (bout.nofTargetTurns>maxTurns) {
+      maxTurns = bout.nofTargetTurns;
+    }
+    if (verbose) {
+      printf("bout %3u: %-4s after %6u ms, %u borders, %u target turns\n", i, resultStr[bout.result], bout.timeMs,
+        bout.nofBorders, bout.nofTargetTurns);
+    }
+  }
+  printf("wins %u, losses %u, draws %u, mean bout %u ms, encoder errors %u\n",
+    nof[BOUT_WIN], nof[BOUT_LOSS], nof[BOUT_DRAW], nofBouts==0 ? 0 : (unsigned int)(sumMs/nofBouts), nofErrors);
+  printf("border to reversal: %u times, min %u us, mean %u us, max %u us, %u times no reversal\n",
+    (unsigned)reversal.count, (unsigned)reversal.minUs,
+    reversal.count==0 ? 0 : (unsigned)(reversal.sumUs/reversal.count), (unsigned)reversal.maxUs, nofNoReversal);
+  printf("target turns per bout: min %u, mean %.1f, max %u\n", minTurns,
+    nofBouts==0 ? 0.0 : (double)nofTurns/nofBouts, maxTurns);
+  printf("span         count     min ns    mean ns     max ns (host time)\n");
+  for(i=0; i<SPAN_NOF_IDS; i++) {
+    if (spans[i].count!=0) {
+      printf("%-10s %7u %10u %10u %10u\n", (const char*)SPAN_GetName((SPAN_Id)i),
+        (unsigned)spans[i].count, (unsigned)spans[i].minNs, (unsigned)spans[i].meanNs, (unsigned)spans[i].maxNs);
+    }
+  }
+  if (nofErrors!=0) {
+    printf("FAILED: encoder errors\n");
+    return 1;
+  }
+  return 0;
+}
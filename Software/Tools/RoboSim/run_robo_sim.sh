@@ -0,0 +1,26 @@
+#!/bin/sh
+# Builds the robot simulation with the executive, with the tasks (PL_CONFIG_HAS_EXEC=0) and with
+# the executive turning to the last scan instead of the tracker (SUMO_USE_TRACKER=0), and runs the
+# same bouts with all of them.
+# Usage: ./run_robo_sim.sh [robo_sim options], e.g. -n 50 -v, or -b -n 5 for the turn benchmark
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+F=$M/FreeRTOS/Source
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -g -Wall -include SimStubs.h -I. -I$R -I../../Projects/F303K8/Board -I$M/src -I$M/config -I$F/include -I$M/SEGGER_RTT"
+SRC="robo_sim.c port.c Pin.c Timer.c Board.c Platform.c \
+  $R/Application.c $R/Event.c $R/Trigger.c $R/Debounce.c $R/KeyDebounce.c $R/Keys.c \
+  $R/Motor.c $R/PWML.c $R/PWMR.c $R/DIRL.c $R/DIRR.c $R/Quadrature.c $R/Tacho.c $R/Pid.c \
+  $R/Drive.c $R/Turn.c $R/Odometry.c $R/Tracker.c $R/Reflectance.c $R/Line.c $R/Proximity.c \
+  $R/Sumo.c $R/Exec.c $R/SensorBus.c $R/Span.c $R/McuRTOShooks.c $R/Recorder.c \
+  $M/src/McuUtility.c $M/src/McuShell.c $M/src/McuXFormat.c \
+  $F/tasks.c $F/list.c $F/queue.c $F/portable/MemMang/heap_3.c"
+
+gcc $CFLAGS -o $OUT/robo_sim_exec $SRC -lm
+gcc $CFLAGS -DPL_CONFIG_HAS_EXEC=0 -o $OUT/robo_sim_tasks $SRC -lm
+gcc $CFLAGS -DSUMO_USE_TRACKER=0 -o $OUT/robo_sim_last $SRC -lm
+$OUT/robo_sim_exec "$@" 2>/dev/null
+$OUT/robo_sim_tasks "$@" 2>/dev/null
+$OUT/robo_sim_last "$@" 2>/dev/null
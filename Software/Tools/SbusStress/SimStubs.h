@@ -0,0 +1,20 @@
+/**
+ * \file
+ * \brief Host stubs of the cycle counter for the snapshot bus stress test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guard of McuArmTools.h, so
+ * RoboLib/SensorBus.c is compiled unchanged. The cycle counter is in sbus_stress.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define __McuArmTools_H
+
+/* McuArmTools */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+#endif /* SIMSTUBS_H_ */
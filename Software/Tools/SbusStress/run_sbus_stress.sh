@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the stress test of the sensor snapshot bus with POSIX threads.
+# Usage: ./run_sbus_stress.sh [ms]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -pthread -include SimStubs.h -I$R -I$M/src"
+SRC="sbus_stress.c $R/SensorBus.c"
+
+gcc $CFLAGS -o $OUT/sbus_stress $SRC
+$OUT/sbus_stress "$@"
@@ -0,0 +1,248 @@
+/**
+ * \file
+ * \brief Host stress test of the sensor snapshot bus with POSIX threads
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/SensorBus.c (compiled unchanged) with one producer thread per mechanism and several
+ * reader threads hammering it:
+ * - SBUS_Channel: the producer publishes snapshots as the RefTask and the ProxTask do.
+ * - SBUS_SeqLock: the producer updates the data in place as the quadrature interrupt does, the
+ *   readers copy it with SBUS_ReadBegin()/SBUS_ReadRetry() as TACHO_CalcSpeed() does.
+ * Each snapshot is filled from its number only, so a reader can check that all words belong to the
+ * same snapshot. The readers also check that the versions and the timestamps never go back. No torn
+ * read is allowed, and the readers have to retry, otherwise the test did not overlap reads and
+ * writes. A control reader copies the in-place data without the lock and counts its torn reads, to
+ * show that the test would detect them (on a single CPU only a preemption during the copy tears).
+ *
+ * Build: gcc -O2 -Wall -pthread -include SimStubs.h -I../../RoboLib -I../../McuLib/src
+ *          -o sbus_stress sbus_stress.c ../../RoboLib/SensorBus.c
+ * Usage: sbus_stress [ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "SensorBus.h"
+
+#define NOF_WORDS         (256)  /* 1 KByte snapshots, longer than a sensor snapshot: more overlaps */
+#define NOF_READERS       (3)    /* readers per mechanism */
+#define YIELD_EVERY       (64)   /* the producers yield now and then, so the readers run in between */
+
+typedef struct {
+  uint32_t nr;              /* snapshot number */
+  uint32_t data[NOF_WORDS]; /* words depending on the number */
+} Snapshot;
+
+typedef struct {
+  unsigned long reads, retries, torn, backwards;
+} ReaderStats;
+
+static SBUS_Channel channel;
+static Snapshot chBuf[2];
+static SBUS_SeqLock lock;
+static Snapshot inPlace;        /* written in place, protected by 'lock' */
+static volatile uint32_t lastNr; /* last number published on the channel */
+static volatile bool stop;
+static uint32_t cycles;          /* cycle counter */
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return __atomic_add_fetch(&cycles, 1, __ATOMIC_RELAXED);
+}
+
+static uint32_t Word(uint32_t nr, unsigned int i) {
+  uint32_t val = nr*2654435761U+i;
+
+  return val^(val>>15);
+}
+
+static void Fill(Snapshot *s, uint32_t nr) {
+  unsigned int i;
+
+  s->nr = nr;
+  for(i=0; i<NOF_WORDS; i++) {
+    s->data[i] = Word(nr, i);
+  }
+}
+
+static bool Consistent(const Snapshot *s) {
+  unsigned int i;
+
+  for(i=0; i<NOF_WORDS; i++) {
+    if (s->data[i]!=Word(s->nr, i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void *ChannelProducer(void *arg) {
+  Snapshot s;
+  uint32_t nr = 0;
+
+  (void)arg;
+  while (!stop) {
+    nr++;
+    Fill(&s, nr);
+    SBUS_Publish(&channel, &s);
+    if (nr%YIELD_EVERY==0) {
+      sched_yield();
+    }
+  }
+  lastNr = nr;
+  return NULL;
+}
+
+static void *ChannelReader(void *arg) {
+  ReaderStats *stats = (ReaderStats*)arg;
+  Snapshot s;
+  SBUS_Stamp stamp, prev = {0, 0};
+
+  while (!stop) {
+    (void)SBUS_Read(&channel, &s, &stamp);
+    stats->reads++;
+    if (!Consistent(&s) || stamp.version!=s.nr) {
+      stats->torn++;
+    }
+    if (stamp.version<prev.version || (int32_t)(stamp.timestamp-prev.timestamp)<0) {
+      stats->backwards++;
+    }
+    prev = stamp;
+  }
+  return NULL;
+}
+
+static void *SeqLockProducer(void *arg) {
+  uint32_t nr = 0;
+
+  (void)arg;
+  while (!stop) {
+    nr++;
+    SBUS_WriteBegin(&lock);
+    Fill(&inPlace, nr);
+    SBUS_WriteEnd(&lock);
+    if (nr%YIELD_EVERY==0) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static void *SeqLockReader(void *arg) {
+  ReaderStats *stats = (ReaderStats*)arg;
+  Snapshot s;
+  uint32_t seq, prevNr = 0;
+
+  while (!stop) {
+    for(;;) {
+      seq = SBUS_ReadBegin(&lock);
+      memcpy(&s, &inPlace, sizeof(s));
+      if (!SBUS_ReadRetry(&lock, seq)) {
+        break;
+      }
+      stats->retries++;
+    }
+    stats->reads++;
+    if (!Consistent(&s)) {
+      stats->torn++;
+    }
+    if (s.nr<prevNr) {
+      stats->backwards++;
+    }
+    prevNr = s.nr;
+  }
+  return NULL;
+}
+
+/* control: copies the in-place data without the lock */
+static void *UnlockedReader(void *arg) {
+  ReaderStats *stats = (ReaderStats*)arg;
+  Snapshot s;
+
+  while (!stop) {
+    memcpy(&s, &inPlace, sizeof(s));
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    stats->reads++;
+    if (!Consistent(&s)) {
+      stats->torn++;
+    }
+  }
+  return NULL;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static unsigned int Report(const char *name, const ReaderStats *stats, unsigned long retries) {
+  unsigned long reads = 0, torn = 0, backwards = 0;
+  unsigned int i, nofFailed = 0;
+
+  for(i=0; i<NOF_READERS; i++) {
+    reads += stats[i].reads;
+    retries += stats[i].retries;
+    torn += stats[i].torn;
+    backwards += stats[i].backwards;
+  }
+  printf("%-9s %10lu reads, %8lu retries, %lu torn, %lu backwards\n", name, reads, retries, torn, backwards);
+  if (torn!=0 || backwards!=0) {
+    printf("FAILED: %s: torn reads or versions going back\n", name);
+    nofFailed++;
+  }
+  if (retries==0) {
+    printf("FAILED: %s: no read overlapped with a write, the test proves nothing\n", name);
+    nofFailed++;
+  }
+  return nofFailed;
+}
+
+int main(int argc, char *argv[]) {
+  pthread_t chProducer, slProducer, chReaders[NOF_READERS], slReaders[NOF_READERS], control;
+  ReaderStats chStats[NOF_READERS], slStats[NOF_READERS], controlStats;
+  Snapshot s;
+  SBUS_Stamp stamp;
+  struct timespec duration;
+  long ms = 2000;
+  unsigned int i, nofFailed = 0;
+
+  if (argc>1) {
+    ms = atol(argv[1]);
+  }
+  SBUS_InitChannel(&channel, &chBuf[0], &chBuf[1], sizeof(Snapshot));
+  if (SBUS_Read(&channel, &s, &stamp) || stamp.version!=0) {
+    printf("FAILED: read before the first publish\n");
+    nofFailed++;
+  }
+  memset(chStats, 0, sizeof(chStats));
+  memset(slStats, 0, sizeof(slStats));
+  memset(&controlStats, 0, sizeof(controlStats));
+  Fill(&inPlace, 0);
+  pthread_create(&chProducer, NULL, ChannelProducer, NULL);
+  pthread_create(&slProducer, NULL, SeqLockProducer, NULL);
+  for(i=0; i<NOF_READERS; i++) {
+    pthread_create(&chReaders[i], NULL, ChannelReader, &chStats[i]);
+    pthread_create(&slReaders[i], NULL, SeqLockReader, &slStats[i]);
+  }
+  pthread_create(&control, NULL, UnlockedReader, &controlStats);
+  duration.tv_sec = ms/1000;
+  duration.tv_nsec = (ms%1000)*1000000L;
+  nanosleep(&duration, NULL);
+  stop = true;
+  pthread_join(chProducer, NULL);
+  pthread_join(slProducer, NULL);
+  for(i=0; i<NOF_READERS; i++) {
+    pthread_join(chReaders[i], NULL);
+    pthread_join(slReaders[i], NULL);
+  }
+  pthread_join(control, NULL);
+
+  nofFailed += Report("channel", chStats, channel.nofRetries);
+  nofFailed += Report("seqlock", slStats, 0);
+  printf("%-9s %10lu reads, %lu torn (control without the lock)\n", "unlocked", controlStats.reads, controlStats.torn);
+  if (!SBUS_Read(&channel, &s, &stamp) || s.nr!=lastNr || stamp.version!=lastNr || !Consistent(&s)) {
+    printf("FAILED: latest snapshot after the producer has stopped\n");
+    nofFailed++;
+  }
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0?0:1;
+}
@@ -0,0 +1,31 @@
+/**
+ * \file
+ * \brief Host stub of the McuShell interface used by the command registry
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Only the types, defines and send functions needed by RoboLib/CmdRegistry.c, the output is
+ * discarded by shell_bench.c.
+ */
+
+#ifndef McuShell_H
+#define McuShell_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void (*McuShell_StdIO_OutErr_FctType)(uint8_t);
+
+typedef struct {
+  McuShell_StdIO_OutErr_FctType stdOut;
+  McuShell_StdIO_OutErr_FctType stdErr;
+} McuShell_StdIOType;
+
+typedef uint8_t (*McuShell_ParseCommandCallback)(const uint8_t *cmd, bool *handled, const McuShell_StdIOType *io);
+
+#define McuShell_DEFAULT_SHELL_BUFFER_SIZE  (48) /* McuShell_CONFIG_DEFAULT_SHELL_BUFFER_SIZE of the robot */
+#define McuShell_CMD_HELP   "help"
+#define McuShell_CMD_STATUS "status"
+
+void McuShell_SendStr(const uint8_t *str, McuShell_StdIO_OutErr_FctType io);
+
+#endif /* McuShell_H */
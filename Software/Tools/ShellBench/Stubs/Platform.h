@@ -0,0 +1,19 @@
+/**
+ * \file
+ * \brief Host platform configuration for the shell dispatch benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/CmdRegistry.c: shell only,
+ * with the McuShell interface from the McuShell.h stub in this folder.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+
+#define PL_CONFIG_USE_FREERTOS  (0)
+#define PL_CONFIG_HAS_SHELL     (1)
+
+#endif /* SRC_PLATFORM_H_ */
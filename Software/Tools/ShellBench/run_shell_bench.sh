@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds and runs the shell dispatch benchmarks: shell_bench with the model of the parsers and the
+# command tables, shell_bench_robot with the real groups of the firmware on the host port of RoboSim.
+# Usage: ./run_shell_bench.sh [nofRounds]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+F=$M/FreeRTOS/Source
+S=../RoboSim
+OUT=${TMPDIR:-/tmp}
+SRC="$S/port.c $S/Pin.c $S/Timer.c $S/Board.c $S/Platform.c \
+  $R/Application.c $R/Event.c $R/Trigger.c $R/Debounce.c $R/KeyDebounce.c $R/Keys.c \
+  $R/Motor.c $R/PWML.c $R/PWMR.c $R/DIRL.c $R/DIRR.c $R/Quadrature.c $R/Tacho.c $R/Pid.c \
+  $R/Drive.c $R/Turn.c $R/Odometry.c $R/Tracker.c $R/Reflectance.c $R/Line.c $R/Proximity.c \
+  $R/Sumo.c $R/Exec.c $R/SensorBus.c $R/Span.c $R/McuRTOShooks.c $R/Recorder.c $R/CmdRegistry.c \
+  $M/src/McuUtility.c $M/src/McuShell.c $M/src/McuXFormat.c \
+  $F/tasks.c $F/list.c $F/queue.c $F/portable/MemMang/heap_3.c"
+
+gcc -O2 -Wall -IStubs -I$R -I$M/src -I$M/config -o $OUT/shell_bench shell_bench.c $R/CmdRegistry.c $M/src/McuUtility.c
+gcc -O2 -Wall -DPL_CONFIG_HAS_SHELL=1 -include SimStubs.h -I$S -I$R -I../../Projects/F303K8/Board -I$M/src -I$M/config \
+  -I$F/include -I$M/SEGGER_RTT -o $OUT/shell_bench_robot shell_bench_robot.c $SRC -lm
+$OUT/shell_bench "$@"
+$OUT/shell_bench_robot "$@" 2>/dev/null
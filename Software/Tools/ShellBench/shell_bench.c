@@ -0,0 +1,368 @@
+/**
+ * \file
+ * \brief Host benchmark of the shell command dispatch
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The table below has the commands of all RoboLib shell groups with their argument types. Each
+ * command line is dispatched three ways, with no-op handlers:
+ * - parsers: each group has a parser like the ParseCommand() functions of the modules, with a chain
+ *   of string compares, and all parsers get called for each line like McuShell_ParseWithCommandTable().
+ * - registry: all groups have command tables in RoboLib/CmdRegistry.c (compiled unchanged).
+ * - robot: the groups with command tables on the robot are in the registry, prox and tacho are
+ *   registered with their parser.
+ * All three have to call the same command with the same arguments, then the time per line is reported.
+ * The modules of the robot have no string compare parsers any more, so these are the reference for
+ * the time before the command tables. shell_bench_robot.c times the real groups of the firmware.
+ *
+ * Build: gcc -O2 -Wall -IStubs -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -o shell_bench shell_bench.c ../../RoboLib/CmdRegistry.c ../../McuLib/src/McuUtility.c
+ *        or run_shell_bench.sh, which builds and runs both benchmarks
+ * Usage: shell_bench [nofRounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Platform.h"
+#include "CmdRegistry.h"
+#include "McuUtility.h"
+
+typedef struct {
+  const char *group;
+  const char *name; /* path after the group name, "" for arguments only */
+  const char *args; /* CMD_ARG_xxx signature */
+} BenchCmd;
+
+/* Longer paths first if a path is the prefix of another one, as the parsers do it. */
+static const BenchCmd cmds[] = {
+  {"ref",   "reset", ""},
+  {"prox",  "reset", ""},
+  {"motor", "L forward", ""}, {"motor", "L backward", ""}, {"motor", "L duty", "i"},
+  {"motor", "R forward", ""}, {"motor", "R backward", ""}, {"motor", "R duty", "i"},
+  {"quad",  "reset", ""},
+  {"pid",   "save", ""}, {"pid", "bench", ""},
+  {"pid",   "pos", "su"}, {"pid", "speed L", "su"}, {"pid", "speed R", "su"}, {"pid", "fw", "su"}, {"pid", "bw", "su"},
+  {"drive", "mode", "s"}, {"drive", "speed", "ii"}, {"drive", "pos reset", ""}, {"drive", "pos", "ii"},
+  {"drive", "move cancel", ""}, {"drive", "move speed", "i"}, {"drive", "move acc", "i"}, {"drive", "move", "ii"},
+  {"turn",  "forward postline", ""}, {"turn", "forward", ""}, {"turn", "backward", ""}, {"turn", "save", ""},
+  {"turn",  "steps90", "u"}, {"turn", "stepspostline", "u"}, {"turn", "stepsline", "u"}, {"turn", "", "i"},
+  {"odo",   "reset", ""}, {"odo", "ticks", "i"}, {"odo", "base", "i"},
+  {"tele",  "on", ""}, {"tele", "off", ""}, {"tele", "reset", ""},
+  {"rec",   "arm", ""}, {"rec", "freeze", ""}, {"rec", "trigger", "i"}, {"rec", "dump", ""},
+  {"span",  "hist", "s"}, {"span", "reset", ""},
+  {"line",  "calib start", ""}, {"line", "calib stop", ""},
+  {"sumo",  "reset", ""},
+  {"nvm",   "erase", ""},
+};
+#define NOF_CMDS    (sizeof(cmds)/sizeof(cmds[0]))
+#define NOF_GROUPS  (20)
+
+static const char *const robotGroups[] = {"ref", "motor", "quad", "pid", "drive", "turn", "odo", "tele", "rec", "span", "line", "sumo", "track", "nvm", NULL};
+static const char *const groupNames[] = {"ref", "prox", "motor", "quad", "tacho", "pid", "drive", "turn", "odo", "tele", "rec", "span", "line", "sumo", "track", "nvm", NULL};
+
+/* last called command and its arguments */
+static int hitCmd;
+static CMD_Arg hitArgs[CMD_CONFIG_MAX_ARGS];
+static unsigned long nofOutputs;
+
+void McuShell_SendStr(const uint8_t *str, McuShell_StdIO_OutErr_FctType io) {
+  (void)str; (void)io;
+  nofOutputs++;
+}
+
+static void NoOut(uint8_t ch) {
+  (void)ch;
+}
+
+static const McuShell_StdIOType io = {NoOut, NoOut};
+
+static uint8_t Hit(int cmd, const CMD_Arg *args) {
+  hitCmd = cmd;
+  memcpy(hitArgs, args, sizeof(hitArgs));
+  return ERR_OK;
+}
+
+/* one handler per command, as the handler has no context */
+#define H(n)    static uint8_t Hit##n(const CMD_Arg *a, const McuShell_StdIOType *io) { (void)io; return Hit(n, a); }
+#define H10(d)  H(d##0) H(d##1) H(d##2) H(d##3) H(d##4) H(d##5) H(d##6) H(d##7) H(d##8) H(d##9)
+#define P(n)    Hit##n,
+#define P10(d)  P(d##0) P(d##1) P(d##2) P(d##3) P(d##4) P(d##5) P(d##6) P(d##7) P(d##8) P(d##9)
+H10() H10(1) H10(2) H10(3) H10(4) H10(5) H10(6) H10(7) H10(8) H10(9)
+static const CMD_Handler handlers[] = { P10() P10(1) P10(2) P10(3) P10(4) P10(5) P10(6) P10(7) P10(8) P10(9) };
+
+/* --------------------------------------------------------------------------------------------- */
+/* parsers with string compares, like the ParseCommand() of the modules */
+static char fullNames[NOF_CMDS][40]; /* "group name" */
+static char helpNames[NOF_GROUPS][24], statusNames[NOF_GROUPS][24];
+static int groupCmdIdx[NOF_GROUPS][64], groupNofCmds[NOF_GROUPS]; /* commands of the group */
+
+static void NoHelp(const McuShell_StdIOType *io) {
+  McuShell_SendStr((const uint8_t*)"", io->stdOut);
+}
+
+static uint8_t ParseArgs(int cmd, const unsigned char *p, const McuShell_StdIOType *io) {
+  static unsigned char words[CMD_CONFIG_MAX_ARGS][16];
+  CMD_Arg args[CMD_CONFIG_MAX_ARGS];
+  const char *sig = cmds[cmd].args;
+  uint8_t res = ERR_OK;
+  size_t n;
+  int i;
+
+  memset(args, 0, sizeof(args));
+  for(i=0; sig[i]!='\0' && res==ERR_OK; i++) {
+    if (sig[i]==CMD_ARG_INT) {
+      res = McuUtility_xatoi(&p, &args[i].i);
+    } else if (sig[i]==CMD_ARG_UINT) {
+      res = McuUtility_ScanDecimal32uNumber(&p, &args[i].u);
+    } else { /* one word */
+      while (*p==' ') {
+        p++;
+      }
+      for(n=0; p[n]!='\0' && p[n]!=' ' && n<sizeof(words[i])-1; n++) {
+        words[i][n] = p[n];
+      }
+      words[i][n] = '\0';
+      args[i].str = words[i];
+      p += n;
+    }
+  }
+  if (res!=ERR_OK) {
+    McuShell_SendStr((unsigned char*)"Wrong argument\r\n", io->stdErr);
+    return ERR_FAILED;
+  }
+  return Hit(cmd, args);
+}
+
+static uint8_t GroupParser(int group, const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
+  size_t len;
+  int c, i;
+
+  if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_HELP)==0 || McuUtility_strcmp((const char*)cmd, helpNames[group])==0) {
+    NoHelp(io);
+    *handled = TRUE;
+  } else if (McuUtility_strcmp((const char*)cmd, McuShell_CMD_STATUS)==0 || McuUtility_strcmp((const char*)cmd, statusNames[group])==0) {
+    NoHelp(io);
+    *handled = TRUE;
+  } else {
+    for(c=0; c<groupNofCmds[group]; c++) {
+      i = groupCmdIdx[group][c];
+      if (cmds[i].args[0]=='\0') {
+        if (McuUtility_strcmp((const char*)cmd, fullNames[i])==0) {
+          *handled = TRUE;
+          return Hit(i, hitArgs);
+        }
+      } else {
+        len = strlen(fullNames[i]);
+        if (McuUtility_strncmp((const char*)cmd, fullNames[i], len)==0) {
+          if (cmds[i].name[0]=='\0' && !(cmd[len]=='-' || (cmd[len]>='0' && cmd[len]<='9'))) {
+            continue; /* 'turn <angle>' */
+          }
+          *handled = TRUE;
+          return ParseArgs(i, cmd+len, io);
+        }
+      }
+    }
+  }
+  return ERR_OK;
+}
+
+#define G(n)    static uint8_t Parser##n(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) { return GroupParser(n, cmd, handled, io); }
+#define GP(n)   Parser##n,
+G(0) G(1) G(2) G(3) G(4) G(5) G(6) G(7) G(8) G(9) G(10) G(11) G(12) G(13) G(14) G(15)
+static const McuShell_ParseCommandCallback parsers[] = { GP(0) GP(1) GP(2) GP(3) GP(4) GP(5) GP(6) GP(7) GP(8) GP(9) GP(10) GP(11) GP(12) GP(13) GP(14) GP(15) };
+
+/* like McuShell_ParseWithCommandTable(): all parsers get called */
+static uint8_t ParseWithParsers(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io) {
+  uint8_t res = ERR_OK;
+  int i;
+
+  for(i=0; groupNames[i]!=NULL; i++) {
+    if (parsers[i](cmd, handled, io)!=ERR_OK) {
+      res = ERR_FAILED;
+    }
+  }
+  return res;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* registry groups */
+static CMD_Command groupCmds[NOF_GROUPS][64];
+static CMD_Group allGroups[NOF_GROUPS], robotGroupsTab[NOF_GROUPS];
+static const CMD_Group *allTable[NOF_GROUPS+1], *robotTable[NOF_GROUPS+1];
+
+static bool IsRobotGroup(const char *name) {
+  int i;
+
+  for(i=0; robotGroups[i]!=NULL; i++) {
+    if (strcmp(robotGroups[i], name)==0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static void BuildTables(void) {
+  int g, i, n;
+
+  for(g=0; groupNames[g]!=NULL; g++) {
+    snprintf(helpNames[g], sizeof(helpNames[g]), "%s help", groupNames[g]);
+    snprintf(statusNames[g], sizeof(statusNames[g]), "%s status", groupNames[g]);
+    n = 0;
+    for(i=0; i<(int)NOF_CMDS; i++) {
+      if (strcmp(cmds[i].group, groupNames[g])==0) {
+        groupCmds[g][n].name = cmds[i].name;
+        groupCmds[g][n].args = cmds[i].args;
+        groupCmds[g][n].handler = handlers[i];
+        groupCmdIdx[g][n] = i;
+        n++;
+      }
+    }
+    groupNofCmds[g] = n;
+    allGroups[g] = (CMD_Group){groupNames[g], NoHelp, NoHelp, groupCmds[g], (uint8_t)n, NULL};
+    if (IsRobotGroup(groupNames[g])) {
+      robotGroupsTab[g] = allGroups[g];
+    } else {
+      robotGroupsTab[g] = (CMD_Group)CMD_PARSER_GROUP(groupNames[g], parsers[g]);
+    }
+    allTable[g] = &allGroups[g];
+    robotTable[g] = &robotGroupsTab[g];
+  }
+  for(i=0; i<(int)NOF_CMDS; i++) {
+    if (cmds[i].name[0]=='\0') {
+      snprintf(fullNames[i], sizeof(fullNames[i]), "%s ", cmds[i].group);
+    } else if (cmds[i].args[0]=='\0') {
+      snprintf(fullNames[i], sizeof(fullNames[i]), "%s %s", cmds[i].group, cmds[i].name);
+    } else {
+      snprintf(fullNames[i], sizeof(fullNames[i]), "%s %s ", cmds[i].group, cmds[i].name);
+    }
+  }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+static char lines[NOF_CMDS][48];
+
+static void BuildLines(void) {
+  static const char *const argValues[] = {"-90", "1200", "7"};
+  char *p;
+  int i, a;
+
+  for(i=0; i<(int)NOF_CMDS; i++) {
+    p = lines[i];
+    p += sprintf(p, "%s", cmds[i].group);
+    if (cmds[i].name[0]!='\0') {
+      p += sprintf(p, " %s", cmds[i].name);
+    }
+    for(a=0; cmds[i].args[a]!='\0'; a++) {
+      if (cmds[i].args[a]==CMD_ARG_STRING) {
+        p += sprintf(p, " %s", strcmp(cmds[i].group, "span")==0 ? "drive" : strcmp(cmds[i].group, "pid")==0 ? "limit" : "stop");
+      } else if (cmds[i].args[a]==CMD_ARG_UINT) {
+        p += sprintf(p, " %s", argValues[1+a%2]);
+      } else {
+        p += sprintf(p, " %s", argValues[a%3]);
+      }
+    }
+  }
+}
+
+static bool SameArgs(int cmd, const CMD_Arg *a, const CMD_Arg *b) {
+  int i;
+
+  for(i=0; cmds[cmd].args[i]!='\0'; i++) {
+    if (cmds[cmd].args[i]==CMD_ARG_STRING ? strcmp((const char*)a[i].str, (const char*)b[i].str)!=0 : a[i].u!=b[i].u) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static double NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec*1e9+(double)ts.tv_nsec;
+}
+
+typedef uint8_t (*DispatchFct)(const unsigned char *cmd, bool *handled, const McuShell_StdIOType *io);
+
+static double TimeDispatch(DispatchFct dispatch, int nofRounds) {
+  double start;
+  bool handled;
+  int r, i;
+
+  start = NowNs();
+  for(r=0; r<nofRounds; r++) {
+    for(i=0; i<(int)NOF_CMDS; i++) {
+      handled = FALSE;
+      (void)dispatch((const unsigned char*)lines[i], &handled, &io);
+    }
+  }
+  return (NowNs()-start)/((double)nofRounds*NOF_CMDS);
+}
+
+int main(int argc, char *argv[]) {
+  static const char *const badLines[] = {"odo ticks x", "turn steps90 -1", "drive speed 10", "turn forward 3", "Quad help", "unknown cmd", NULL};
+  CMD_Arg refArgs[CMD_CONFIG_MAX_ARGS];
+  int nofRounds = 20000, i, refCmd, nofFailed = 0;
+  double tParsers, tRegistry, tRobot;
+  bool handled;
+
+  if (argc>1) {
+    nofRounds = atoi(argv[1]);
+  }
+  BuildTables();
+  BuildLines();
+  if (CMD_Init(allTable)!=ERR_OK) {
+    printf("FAILED: hash index too small\n");
+    return 1;
+  }
+  /* all three dispatch the same command with the same arguments */
+  for(i=0; i<(int)NOF_CMDS; i++) {
+    hitCmd = -1; handled = FALSE;
+    (void)ParseWithParsers((const unsigned char*)lines[i], &handled, &io);
+    refCmd = hitCmd;
+    memcpy(refArgs, hitArgs, sizeof(refArgs));
+    if (refCmd!=i || !handled) {
+      printf("FAILED: parsers dispatch '%s' to %d\n", lines[i], refCmd);
+      nofFailed++;
+    }
+    hitCmd = -1; handled = FALSE;
+    (void)CMD_ParseCommand((const unsigned char*)lines[i], &handled, &io);
+    if (hitCmd!=refCmd || !handled || !SameArgs(i, hitArgs, refArgs)) {
+      printf("FAILED: registry dispatch '%s' to %d\n", lines[i], hitCmd);
+      nofFailed++;
+    }
+  }
+  /* wrong arguments must not call a handler */
+  for(i=0; badLines[i]!=NULL; i++) {
+    hitCmd = -1; handled = FALSE;
+    (void)CMD_ParseCommand((const unsigned char*)badLines[i], &handled, &io);
+    if (hitCmd!=-1) {
+      printf("FAILED: registry calls %d for '%s'\n", hitCmd, badLines[i]);
+      nofFailed++;
+    }
+  }
+  tRegistry = TimeDispatch(CMD_ParseCommand, nofRounds);
+  tParsers = TimeDispatch(ParseWithParsers, nofRounds);
+
+  if (CMD_Init(robotTable)!=ERR_OK) {
+    printf("FAILED: hash index too small\n");
+    return 1;
+  }
+  for(i=0; i<(int)NOF_CMDS; i++) {
+    hitCmd = -1; handled = FALSE;
+    (void)CMD_ParseCommand((const unsigned char*)lines[i], &handled, &io);
+    if (hitCmd!=i || !handled) {
+      printf("FAILED: robot dispatch '%s' to %d\n", lines[i], hitCmd);
+      nofFailed++;
+    }
+  }
+  tRobot = TimeDispatch(CMD_ParseCommand, nofRounds);
+
+  printf("%d commands in %d groups, ns per command line:\n", (int)NOF_CMDS, (int)(sizeof(groupNames)/sizeof(groupNames[0])-1));
+  printf("  parsers:  %7.1f\n", tParsers);
+  printf("  registry: %7.1f (%.1fx)\n", tRegistry, tParsers/tRegistry);
+  printf("  robot:    %7.1f (%.1fx)\n", tRobot, tParsers/tRobot);
+  printf("%d failed\n", nofFailed);
+  return nofFailed==0 ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+/**
+ * \file
+ * \brief Host benchmark of the shell command dispatch with the real RoboLib groups
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Counterpart of shell_bench.c with the firmware instead of the model: RoboLib and the vendored
+ * FreeRTOS kernel run on the host port of Tools/RoboSim, with PL_CONFIG_HAS_SHELL=1 and a robot
+ * which stands still (no physics, see the MODEL_xxx() functions below). The groups are registered
+ * in the order of Shell.c, with the command tables of the modules and the McuShell parsers of
+ * prox and tacho, and CMD_Init() has to fit them into the default CMD_CONFIG_HASH_SIZE.
+ *
+ * The command lines below are dispatched from a task, first once to check that each one gets
+ * handled without error, together with 'help' and 'status' of all groups, then timed in rounds
+ * with the host clock:
+ * - registry: CMD_ParseCommand(), the lookup, the argument parsing and the real handler.
+ * - shell: McuShell_ParseWithCommandTable() with the table of the shell task, McuShell_ParseCommand()
+ *   first, so what a line costs on the robot after it has been read.
+ * Only commands which return at once are in the list: the turns and the line calibration need the
+ * control loops to run between the commands, and the output of help, status and dumps is discarded.
+ *
+ * Build: see run_shell_bench.sh, the sources of RoboSim without robo_sim.c, with RoboLib/CmdRegistry.c
+ * Usage: shell_bench_robot [nofRounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Platform.h"
+#include "Application.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "Sim.h"
+#include "RoboModel.h"
+#include "CmdRegistry.h"
+#include "McuShell.h"
+#include "Reflectance.h"
+#include "Proximity.h"
+#include "Motor.h"
+#include "Quadrature.h"
+#include "Tacho.h"
+#include "Pid.h"
+#include "Drive.h"
+#include "Turn.h"
+#include "Odometry.h"
+#include "Recorder.h"
+#include "Span.h"
+#include "Line.h"
+#include "Sumo.h"
+#include "Tracker.h"
+#include "Trigger.h"
+#include "Exec.h"
+
+/* groups of Shell.c which are enabled in the configuration of the simulation, in the same order */
+static const CMD_Group proxGroup = CMD_PARSER_GROUP("prox", PROX_ParseCommand);
+static const CMD_Group tachoGroup = CMD_PARSER_GROUP("tacho", TACHO_ParseCommand);
+
+static const CMD_Group *const groups[] = {
+  &REF_CmdGroup, &proxGroup, &MOT_CmdGroup, &QUAD_CmdGroup, &tachoGroup, &PID_CmdGroup, &DRV_CmdGroup,
+  &TURN_CmdGroup, &ODO_CmdGroup, &REC_CmdGroup, &SPAN_CmdGroup, &LINE_CmdGroup, &SUMO_CmdGroup,
+  &TRACK_CmdGroup, &TRG_CmdGroup, &EXEC_CmdGroup,
+  NULL
+};
+
+static const char *const checkLines[] = {McuShell_CMD_HELP, McuShell_CMD_STATUS, NULL}; /* checked, not timed */
+
+static const char *const lines[] = {
+  "ref reset",
+  "prox status",
+  "motor L forward", "motor R backward", "motor L duty 20", "motor R duty -20",
+  "quad reset",
+  "tacho status",
+  "pid pos p 7", "pid pos limit 1200", "pid speed L ff 50", "pid speed R i 3", "pid fw filter 2",
+  "drive mode stop", "drive speed 0 0", "drive pos reset", "drive pos 0 0",
+  "drive move speed 1200", "drive move acc 3000", "drive move cancel",
+  "turn steps90 1200", "turn stepspostline 100", "turn stepsline 60",
+  "odo reset", "odo ticks 12000", "odo base 84000",
+  "rec arm", "rec freeze", "rec trigger 7",
+  "span reset",
+  "sumo reset",
+  "trg reset",
+  "exec reset",
+};
+#define NOF_LINES  (sizeof(lines)/sizeof(lines[0]))
+
+static McuShell_ConstParseCommandCallback shellTable[] = {
+  McuShell_ParseCommand, /* as in Shell.c */
+  CMD_ParseCommand,
+  NULL
+};
+
+static int nofRounds = 20000;
+static int exitCode = 1;
+
+/*------------------------------------------------------------------------------------------------*/
+/* robot standing still: no key pressed, no encoder steps, no target, black floor */
+bool MODEL_GetInput(Pin_PinId pin) {
+  switch(pin) {
+    case PIN_PROX_L:
+    case PIN_PROX_M:
+    case PIN_PROX_R:
+      return true; /* active low */
+    default:
+      return false;
+  }
+}
+
+void MODEL_OnOutput(Pin_PinId pin, bool isHigh) {
+  (void)pin; (void)isHigh;
+}
+
+void MODEL_OnEdgeDischarge(Pin_PinId pin) {
+  (void)pin;
+}
+
+void MODEL_OnEdgeInterrupt(Pin_PinId pin, bool enabled) {
+  (void)pin; (void)enabled;
+}
+
+void MODEL_OnPwm(bool isLeft, uint16_t value) {
+  (void)isLeft; (void)value;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static void NoOut(uint8_t ch) {
+  (void)ch;
+}
+
+static void NoIn(uint8_t *ch) {
+  *ch = '\0';
+}
+
+static bool NoKey(void) {
+  return FALSE;
+}
+
+static const McuShell_StdIOType io = {NoIn, NoOut, NoOut, NoKey};
+
+static double NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec*1e9+(double)ts.tv_nsec;
+}
+
+static double TimeRegistry(void) {
+  double start;
+  bool handled;
+  int r;
+  unsigned int i;
+
+  start = NowNs();
+  for(r=0; r<nofRounds; r++) {
+    for(i=0; i<NOF_LINES; i++) {
+      handled = FALSE;
+      (void)CMD_ParseCommand((const unsigned char*)lines[i], &handled, &io);
+    }
+  }
+  return (NowNs()-start)/((double)nofRounds*NOF_LINES);
+}
+
+static double TimeShell(void) {
+  double start;
+  int r;
+  unsigned int i;
+
+  start = NowNs();
+  for(r=0; r<nofRounds; r++) {
+    for(i=0; i<NOF_LINES; i++) {
+      (void)McuShell_ParseWithCommandTable((const uint8_t*)lines[i], &io, shellTable);
+    }
+  }
+  return (NowNs()-start)/((double)nofRounds*NOF_LINES);
+}
+
+static void BenchTask(void *pvParameters) {
+  double tRegistry, tShell;
+  unsigned int i, nofFailed = 0;
+  bool handled;
+
+  (void)pvParameters;
+  vTaskDelay(pdMS_TO_TICKS(100)); /* initialization of the robot */
+  if (CMD_Init(groups)!=ERR_OK) {
+    printf("FAILED: hash index with %d entries too small\n", CMD_CONFIG_HASH_SIZE);
+    SIM_Stop();
+  }
+  for(i=0; i<NOF_LINES; i++) {
+    handled = FALSE;
+    if (CMD_ParseCommand((const unsigned char*)lines[i], &handled, &io)!=ERR_OK || !handled) {
+      printf("FAILED: '%s'\n", lines[i]);
+      nofFailed++;
+    }
+  }
+  for(i=0; checkLines[i]!=NULL; i++) {
+    handled = FALSE;
+    if (McuShell_ParseWithCommandTable((const uint8_t*)checkLines[i], &io, shellTable)!=ERR_OK) {
+      printf("FAILED: '%s'\n", checkLines[i]);
+      nofFailed++;
+    }
+  }
+  if (nofFailed==0) {
+    tRegistry = TimeRegistry();
+    tShell = TimeShell();
+    printf("%u command lines of the real groups, ns per command line:\n", (unsigned)NOF_LINES);
+    printf("  registry: %7.1f\n", tRegistry);
+    printf("  shell:    %7.1f\n", tShell);
+    exitCode = 0;
+  }
+  printf("%u failed\n", nofFailed);
+  fflush(stdout);
+  SIM_Stop();
+}
+
+int main(int argc, char *argv[]) {
+  if (argc>1) {
+    nofRounds = atoi(argv[1]);
+  }
+  if (xTaskCreate(BenchTask, "Bench", 800/sizeof(StackType_t), NULL, tskIDLE_PRIORITY+1, NULL)!=pdPASS) {
+    SIM_AssertFailed(__FILE__, __LINE__);
+  }
+  APP_Run(); /* returns with SIM_Stop() */
+  return exitCode;
+}
@@ -0,0 +1,21 @@
+/**
+ * \file
+ * \brief Host platform configuration for the timing span benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Span.c: spans with the clock_gettime()
+ * implementation of the simulation, without the RTOS and without the shell.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (0)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (1)
+
+#endif /* SRC_PLATFORM_H_ */
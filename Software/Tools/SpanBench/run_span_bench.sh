@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the benchmark of the span instrumentation.
+# Usage: ./run_span_bench.sh [nofRounds]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -I. -I$R -I$M/src -I$M/config"
+SRC="span_bench.c $R/Span.c"
+
+gcc $CFLAGS -o $OUT/span_bench $SRC
+$OUT/span_bench "$@"
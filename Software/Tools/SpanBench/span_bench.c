@@ -0,0 +1,160 @@
+/**
+ * \file
+ * \brief Host test and benchmark of the timing spans
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Span.c (compiled unchanged) with its host implementation, which reads clock_gettime().
+ * The checks:
+ * - overhead: empty spans have to measure close to zero, as SPAN_Init() subtracts the overhead.
+ * - durations: busy waits of a known length have to be measured with it, the shortest one not more
+ *   than a few percent off.
+ * - reset: the statistics are gone after SPAN_Reset() and start again with the next measurement.
+ * - the IDs out of range are rejected.
+ * Then the cost of the markers is measured: a loop with a few hundred ns of work, with and without a
+ * SPAN_BEGIN()/SPAN_END() pair around the work. The difference is what the markers add to the hot
+ * paths, and is printed with the overhead measured by SPAN_Init(). On the target it is the same code
+ * with the cycle counter, see 'span status'.
+ *
+ * Build: gcc -O2 -Wall -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -o span_bench span_bench.c ../../RoboLib/Span.c
+ * Usage: span_bench [nofRounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Platform.h"
+#include "Span.h"
+
+static int nofRounds = 1000000;
+static unsigned int nofFailed = 0;
+static volatile uint32_t work; /* result of the work, so it is not optimized away */
+
+static uint64_t NowNs(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec*1000000000ULL+(uint64_t)ts.tv_nsec;
+}
+
+static void BusyWaitNs(uint64_t ns) {
+  uint64_t start = NowNs();
+
+  while (NowNs()-start<ns) {
+    /* wait */
+  }
+}
+
+/* some work of the size of a small hot path, e.g. PID_Speed() */
+static void Work(void) {
+  uint32_t val = work;
+  int i;
+
+  for(i=0; i<32; i++) {
+    val = val*1664525U+1013904223U;
+  }
+  work = val;
+}
+
+static void Check(bool ok, const char *what) {
+  if (!ok) {
+    printf("FAILED: %s\n", what);
+    nofFailed++;
+  }
+}
+
+static void CheckEmpty(void) {
+  SPAN_Stats stats;
+  int i;
+
+  for(i=0; i<100000; i++) {
+    SPAN_BEGIN(SPAN_ID_PID_SPEED);
+    SPAN_END(SPAN_ID_PID_SPEED);
+  }
+  Check(SPAN_GetStats(SPAN_ID_PID_SPEED, &stats) && stats.count==100000, "empty span count");
+  printf("empty span:  min %5u ns, mean %5u ns, max %7u ns\n", (unsigned)stats.minNs, (unsigned)stats.meanNs, (unsigned)stats.maxNs);
+  Check(stats.minNs<100, "empty span has to measure close to zero");
+}
+
+static void CheckDuration(SPAN_Id id, uint32_t us) {
+  SPAN_Stats stats;
+  uint32_t ns = us*1000;
+  char what[64];
+  int i;
+
+  for(i=0; i<50; i++) {
+    SPAN_BEGIN(id);
+    BusyWaitNs(ns);
+    SPAN_END(id);
+  }
+  snprintf(what, sizeof(what), "busy wait of %u us", (unsigned)us);
+  Check(SPAN_GetStats(id, &stats) && stats.count==50, what);
+  printf("%5u us wait: min %8u ns, mean %8u ns\n", (unsigned)us, (unsigned)stats.minNs, (unsigned)stats.meanNs);
+  Check(stats.minNs>=ns-ns/50 && stats.minNs<=ns+ns/20+2000, what);
+}
+
+static void CheckReset(void) {
+  SPAN_Stats stats;
+
+  SPAN_BEGIN(SPAN_ID_LINE_STATE);
+  SPAN_END(SPAN_ID_LINE_STATE);
+  SPAN_Reset();
+  Check(!SPAN_GetStats(SPAN_ID_LINE_STATE, &stats) && stats.count==0, "statistics after reset");
+  SPAN_BEGIN(SPAN_ID_LINE_STATE);
+  BusyWaitNs(1000);
+  SPAN_END(SPAN_ID_LINE_STATE);
+  Check(SPAN_GetStats(SPAN_ID_LINE_STATE, &stats) && stats.count==1 && stats.minNs==stats.maxNs, "first measurement after reset");
+  Check(!SPAN_GetStats(SPAN_NOF_IDS, &stats), "statistics of an unknown span");
+  Check(strcmp((const char*)SPAN_GetName(SPAN_NOF_IDS), "?")==0, "name of an unknown span");
+}
+
+/* time per round of Work(), with or without the markers around it, the fastest of a few tries */
+static double TimeWork(bool withSpan) {
+  double best = 0, ns;
+  uint64_t start;
+  int t, r;
+
+  for(t=0; t<5; t++) {
+    start = NowNs();
+    if (withSpan) {
+      for(r=0; r<nofRounds; r++) {
+        SPAN_BEGIN(SPAN_ID_PID_POS);
+        Work();
+        SPAN_END(SPAN_ID_PID_POS);
+      }
+    } else {
+      for(r=0; r<nofRounds; r++) {
+        Work();
+      }
+    }
+    ns = (double)(NowNs()-start)/nofRounds;
+    if (t==0 || ns<best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t subtractedNs, costNs;
+  double tWithout, tWith;
+
+  if (argc>1) {
+    nofRounds = atoi(argv[1]);
+  }
+  SPAN_Init();
+  SPAN_GetOverhead(&subtractedNs, &costNs);
+  printf("SPAN_Init(): %u ns subtracted, %u ns per begin/end\n", (unsigned)subtractedNs, (unsigned)costNs);
+  CheckEmpty();
+  CheckDuration(SPAN_ID_QUAD_SAMPLE, 10);
+  CheckDuration(SPAN_ID_TACHO_CALC, 100);
+  CheckDuration(SPAN_ID_REF_MEASURE, 1000);
+  CheckReset();
+  tWithout = TimeWork(false);
+  tWith = TimeWork(true);
+  printf("work: %.1f ns without, %.1f ns with the markers, %.1f ns per SPAN_BEGIN()/SPAN_END()\n",
+    tWithout, tWith, tWith-tWithout);
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0?0:1;
+}
@@ -0,0 +1,41 @@
+/**
+ * \file
+ * \brief Host stubs of FreeRTOS, the cycle counter, the critical section and the encoder pins for the tacho benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of FreeRTOS.h,
+ * McuArmTools.h, McuCriticalSection.h and Board/Pin.h, so RoboLib/Tacho.c and
+ * RoboLib/Quadrature.c are compiled unchanged. The cycle counter is the simulated time, the encoder
+ * pins are variables set by the wheel model. Both are in tacho_bench.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define INC_FREERTOS_H
+#define __McuArmTools_H
+#define __McuCriticalSection_H
+#define BOARD_PIN_H_
+
+/* FreeRTOS */
+#define configCPU_CLOCK_HZ     (64000000) /* the cycle counter runs with this clock */
+#define portTICK_PERIOD_MS     (1)        /* TACHO_Sample() is called every tick */
+
+/* McuArmTools */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+/* McuCriticalSection: one thread, the decoder 'interrupt' and the sampling are called by the wheel model */
+#define McuCriticalSection_CriticalVariable()  /* nothing needed */
+#define McuCriticalSection_EnterCritical()     /* nothing needed */
+#define McuCriticalSection_ExitCritical()      /* nothing needed */
+
+/* encoder pins, bit 1 is A (C1) and bit 0 is B (C2) */
+extern uint8_t SIM_encPins[2];
+#define PIN_ENCL_A_GET()   ((SIM_encPins[0]&2)!=0)
+#define PIN_ENCL_B_GET()   ((SIM_encPins[0]&1)!=0)
+#define PIN_ENCR_A_GET()   ((SIM_encPins[1]&2)!=0)
+#define PIN_ENCR_B_GET()   ((SIM_encPins[1]&1)!=0)
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds and runs the benchmark of the tacho speed estimation with synthetic encoder streams, with
+# the lag and the RMS error of the new and of the old tacho.
+# Usage: ./run_tacho_bench.sh
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/FreeRTOS/Source/include -I../../Projects/F303K8/Board"
+SRC="tacho_bench.c $R/Tacho.c $R/Quadrature.c $R/SensorBus.c"
+
+gcc $CFLAGS -o $OUT/tacho_bench $SRC -lm
+$OUT/tacho_bench "$@"
@@ -0,0 +1,220 @@
+/**
+ * \file
+ * \brief Host benchmark of the tacho speed estimation against the wheel speed
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Tacho.c and RoboLib/Quadrature.c (compiled unchanged) with synthetic encoder streams:
+ * a wheel model moves along a speed profile, drives the pins of the left encoder and calls the edge
+ * decoder for each step. Every ms TACHO_Sample() and TACHO_CalcSpeed() are called, as the executive
+ * does, and the speed is compared with the speed of the wheel model. For comparison, the old tacho
+ * (a fixed window of 16 samples of 5 ms, 80 ms) is computed from the same positions.
+ * Each profile prints for both:
+ * - lag: the delay of the estimate, the shift of the wheel speed with the smallest RMS error.
+ * - rms: the RMS error without shift, what the speed PID sees.
+ * The new estimate has to be better than the old one for the profiles with changing speed. At a
+ * constant speed the long window of the old one averages more steps, there the new one has to stay
+ * within STEADY_MAX_ERR of the speed.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src
+ *          -I../../McuLib/config -I../../McuLib/FreeRTOS/Source/include -I../../Projects/F303K8/Board
+ *          -o tacho_bench tacho_bench.c ../../RoboLib/Tacho.c ../../RoboLib/Quadrature.c
+ *          ../../RoboLib/SensorBus.c -lm
+ * Usage: tacho_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Platform.h"
+#include "Tacho.h"
+#include "Quadrature.h"
+
+#define SIM_STEP_NS      (1000)    /* wheel model step, at most one encoder step per model step */
+#define CYCLE_MS         (1)       /* TACHO_Sample() and TACHO_CalcSpeed() period, as in the executive */
+#define PROFILE_MS       (1500)    /* length of each profile */
+#define MAX_LAG_MS       (150)     /* longest lag searched */
+#define RIPPLE           (0.03)    /* speed ripple of the wheel (gear, motor poles)... */
+#define RIPPLE_STEPS     (24.0)    /* ...once per this many steps */
+#define STEADY_MAX_ERR   (0.05)    /* largest RMS error at a constant speed, part of the speed */
+#define OLD_PERIOD_MS    (5)       /* old tacho: history sampled every 5 ms... */
+#define OLD_NOF_HISTORY  (17)      /* ...with this many entries */
+
+typedef struct {
+  const char *name;
+  double (*speed)(double t); /* wheel speed in steps/sec at time t in seconds */
+  bool steady;               /* constant speed: no lag, the error is the noise of the estimate */
+} Profile;
+
+uint8_t SIM_encPins[2];
+static uint64_t simNs;
+
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return (uint32_t)(simNs*(configCPU_CLOCK_HZ/1000000)/1000);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* speed profiles, the robot runs at most about 4000 steps/sec */
+static double Constant(double t) {
+  (void)t;
+  return 2000;
+}
+
+static double Crawl(double t) {
+  (void)t;
+  return 60;
+}
+
+static double Step(double t) {
+  return t<0.3?0:(t<0.9?3000:500);
+}
+
+static double Ramp(double t) {
+  if (t<0.5) {
+    return 8000*t;
+  } else if (t<1.0) {
+    return 4000-8000*(t-0.5);
+  }
+  return 0;
+}
+
+static double Reverse(double t) {
+  if (t<0.5) {
+    return 2000;
+  } else if (t<0.6) {
+    return 2000-40000*(t-0.5);
+  }
+  return -2000;
+}
+
+static double Brake(double t) {
+  if (t<0.2) {
+    return 15000*t;
+  } else if (t<0.7) {
+    return 3000;
+  } else if (t<0.75) {
+    return 3000-60000*(t-0.7);
+  }
+  return 0;
+}
+
+static double Slow(double t) {
+  return 200+150*sin(2*M_PI*2*t);
+}
+
+static const Profile profiles[] = {
+  {"constant", Constant, true},
+  {"crawl", Crawl, true},
+  {"step", Step, false},
+  {"ramp", Ramp, false},
+  {"reverse", Reverse, false},
+  {"brake", Brake, false},
+  {"slow sine", Slow, false},
+};
+#define NOF_PROFILES  (sizeof(profiles)/sizeof(profiles[0]))
+
+/*------------------------------------------------------------------------------------------------*/
+/* pins of the encoder at a position in steps, 00, 01, 11, 10 counts up */
+static uint8_t EncoderPins(double pos) {
+  static const uint8_t pins[4] = {0, 1, 3, 2};
+
+  return pins[((long)floor(pos))&3];
+}
+
+/* RMS error of the estimate against the wheel speed delayed by lagMs */
+static double Rms(const double *est, const double *truth, int nofMs, int lagMs) {
+  double sum = 0, d;
+  int i;
+
+  for(i=MAX_LAG_MS; i<nofMs; i++) {
+    d = est[i]-truth[i-lagMs];
+    sum += d*d;
+  }
+  return sqrt(sum/(nofMs-MAX_LAG_MS));
+}
+
+static int BestLag(const double *est, const double *truth, int nofMs) {
+  int lag, best = 0;
+  double rms, bestRms = 0;
+
+  for(lag=0; lag<=MAX_LAG_MS; lag++) {
+    rms = Rms(est, truth, nofMs, lag);
+    if (lag==0 || rms<bestRms-0.01) {
+      bestRms = rms;
+      best = lag;
+    }
+  }
+  return best;
+}
+
+static unsigned int RunProfile(const Profile *profile) {
+  static double truth[PROFILE_MS], estNew[PROFILE_MS], estOld[PROFILE_MS];
+  int32_t oldHistory[OLD_NOF_HISTORY];
+  int oldIdx = 0, ms = 0, lagNew, lagOld;
+  double pos = 0.5, v, rmsNew, rmsOld;
+  uint8_t pins;
+  unsigned int nofFailed = 0;
+
+  simNs = 0;
+  SIM_encPins[0] = SIM_encPins[1] = EncoderPins(pos);
+  QUAD_Init();
+  TACHO_Init();
+  memset(oldHistory, 0, sizeof(oldHistory));
+  for(simNs=SIM_STEP_NS; ms<PROFILE_MS; simNs+=SIM_STEP_NS) {
+    v = profile->speed(simNs*1e-9);
+    v *= 1.0+RIPPLE*sin(2*M_PI*pos/RIPPLE_STEPS);
+    pos += v*SIM_STEP_NS*1e-9;
+    pins = EncoderPins(pos);
+    if (pins!=SIM_encPins[0]) {
+      SIM_encPins[0] = pins;
+      QUAD_OnEdgeInterrupt(true);
+    }
+    if (simNs%(CYCLE_MS*1000000ULL)==0) {
+      TACHO_Sample();
+      TACHO_CalcSpeed();
+      if (ms%OLD_PERIOD_MS==0) { /* old tacho: fixed window over the whole history */
+        oldHistory[oldIdx] = (int32_t)QUAD_GetLeftPos();
+        oldIdx = (oldIdx+1)%OLD_NOF_HISTORY; /* now the oldest entry */
+      }
+      estOld[ms] = (oldHistory[(oldIdx+OLD_NOF_HISTORY-1)%OLD_NOF_HISTORY]-oldHistory[oldIdx])*1000.0/((OLD_NOF_HISTORY-1)*OLD_PERIOD_MS);
+      estNew[ms] = TACHO_GetSpeed(true);
+      truth[ms] = v;
+      ms++;
+    }
+  }
+  lagNew = BestLag(estNew, truth, PROFILE_MS);
+  lagOld = BestLag(estOld, truth, PROFILE_MS);
+  rmsNew = Rms(estNew, truth, PROFILE_MS, 0);
+  rmsOld = Rms(estOld, truth, PROFILE_MS, 0);
+  if (profile->steady) {
+    printf("%-10s |      -  %7.1f |      -  %7.1f\n", profile->name, rmsNew, rmsOld);
+    if (rmsNew>STEADY_MAX_ERR*fabs(profile->speed(0))) {
+      printf("FAILED: %s: RMS error too large\n", profile->name);
+      nofFailed++;
+    }
+    return nofFailed;
+  }
+  printf("%-10s | %3d ms  %7.1f | %3d ms  %7.1f\n", profile->name, lagNew, rmsNew, lagOld, rmsOld);
+  if (rmsNew>rmsOld) {
+    printf("FAILED: %s: RMS error not better than the old tacho\n", profile->name);
+    nofFailed++;
+  }
+  if (lagNew>lagOld) {
+    printf("FAILED: %s: lag not better than the old tacho\n", profile->name);
+    nofFailed++;
+  }
+  return nofFailed;
+}
+
+int main(void) {
+  unsigned int i, nofFailed = 0;
+
+  printf("steps/sec, error against the wheel speed\n");
+  printf("profile    |    new tacho    |   old (80 ms)\n");
+  printf("           |    lag      rms |    lag      rms\n");
+  for(i=0; i<NOF_PROFILES; i++) {
+    nofFailed += RunProfile(&profiles[i]);
+  }
+  printf("%u failed\n", nofFailed);
+  return nofFailed==0?0:1;
+}
@@ -0,0 +1,32 @@
+/**
+ * \file
+ * \brief Host platform configuration for the telemetry round trip test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Telemetry.c: all modules which deliver
+ * values for a frame are enabled, without the shell. Their functions are stubs in tele_test.c.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (0)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_EXEC           (0)
+#define PL_CONFIG_HAS_CONFIG_NVM     (0)
+#define PL_CONFIG_HAS_TELEMETRY      (1)
+#define PL_CONFIG_HAS_REFLECTANCE    (1)
+#define PL_CONFIG_HAS_LINE           (1)
+#define PL_CONFIG_HAS_SUMO           (1)
+#define PL_CONFIG_HAS_MOTOR          (1)
+#define PL_CONFIG_HAS_MOTOR_TACHO    (1)
+#define PL_CONFIG_HAS_QUADRATURE     (1)
+#define PL_CONFIG_HAS_PID            (1)
+#define PL_CONFIG_HAS_POS_PID        (1)
+#define PL_CONFIG_HAS_DRIVE          (1)
+
+#endif /* SRC_PLATFORM_H_ */
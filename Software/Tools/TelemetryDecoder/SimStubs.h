@@ -0,0 +1,39 @@
+/**
+ * \file
+ * \brief Host stubs of the cycle counter and of the RTT control block for the telemetry round trip test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of McuArmTools.h and
+ * SEGGER_RTT.h, so RoboLib/Telemetry.c is compiled unchanged and writes its frames into the up-buffer
+ * below, with the fields of the real control block. The host side of RTT is in tele_test.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define __McuArmTools_H
+#define SEGGER_RTT_H
+#define SEGGER_RTT_MODE_NO_BLOCK_SKIP  (0)
+#define SEGGER_RTT_MAX_NUM_UP_BUFFERS  (3)
+
+typedef struct {
+  const char *sName;
+  char *pBuffer;
+  unsigned SizeOfBuffer;
+  volatile unsigned WrOff; /* written by the target */
+  volatile unsigned RdOff; /* written by the host */
+  unsigned Flags;
+} SEGGER_RTT_BUFFER_UP;
+
+typedef struct {
+  SEGGER_RTT_BUFFER_UP aUp[SEGGER_RTT_MAX_NUM_UP_BUFFERS];
+} SEGGER_RTT_CB;
+
+extern SEGGER_RTT_CB _SEGGER_RTT;
+
+uint32_t McuArmTools_GetCycleCounter(void);
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags);
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds and runs the telemetry round trip test: tele_test writes a capture with the frames of
+# RoboLib/Telemetry.c and the expected CSV, tele_decode has to produce the same CSV and statistics.
+# Usage: ./run_tele_test.sh
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/SEGGER_RTT"
+
+gcc -O2 -Wall -I$R -o $OUT/tele_decode tele_decode.c
+gcc $CFLAGS -o $OUT/tele_test tele_test.c $R/Telemetry.c
+$OUT/tele_test $OUT/tele_capture.bin $OUT/tele_expected.csv > $OUT/tele_expected.txt
+$OUT/tele_decode $OUT/tele_capture.bin $OUT/tele_decoded.csv 2> $OUT/tele_decoded.txt
+cat $OUT/tele_decoded.txt
+diff $OUT/tele_expected.txt $OUT/tele_decoded.txt
+diff $OUT/tele_expected.csv $OUT/tele_decoded.csv
+echo "round trip ok"
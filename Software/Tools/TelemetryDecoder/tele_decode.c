@@ -0,0 +1,171 @@
+/**
+ * \file
+ * \brief Host decoder for the binary telemetry stream
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Reads a captured RTT telemetry stream (see RoboLib/Telemetry.h) and writes one CSV line per frame.
+ * The decoder synchronizes on the frame header, so it can start in the middle of a capture and skips
+ * over garbage. Dropped frames are detected with the sequence number.
+ * run_tele_test.sh checks the decoder with the frames of RoboLib/Telemetry.c, see tele_test.c.
+ *
+ * Build: gcc -O2 -I../../RoboLib -o tele_decode tele_decode.c
+ * Usage: tele_decode [-f cpuHz] <capture.bin> [out.csv]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "TelemetryFrame.h"
+
+typedef struct {
+  uint32_t cpuHz;       /* clock of the cycle counter */
+  uint64_t time;        /* unwrapped cycle counter */
+  uint32_t lastStamp;   /* cycle counter of the previous frame */
+  uint16_t lastSeq;     /* sequence number of the previous frame */
+  int hasLast;          /* if lastStamp and lastSeq are valid */
+  unsigned long nofFrames, nofDropped, nofSkippedBytes; /* statistics */
+} Decoder;
+
+static uint16_t Get16(const uint8_t *p) {
+  return (uint16_t)(p[0]|(p[1]<<8));
+}
+
+static uint32_t Get32(const uint8_t *p) {
+  return (uint32_t)p[0]|((uint32_t)p[1]<<8)|((uint32_t)p[2]<<16)|((uint32_t)p[3]<<24);
+}
+
+/* Decodes a frame from the little endian stream, independent of the host byte order and struct packing */
+static void DecodeFrame(const uint8_t *p, TELE_Frame *f) {
+  int i;
+
+  f->sync = p[0];
+  f->version = p[1];
+  f->seq = Get16(p+2);
+  f->timestamp = Get32(p+4);
+  for(i=0; i<4; i++) {
+    f->ref[i] = Get16(p+8+2*i);
+  }
+  f->linePos = Get16(p+16);
+  f->whiteBits = p[18];
+  f->sumo = p[19];
+  for(i=0; i<2; i++) {
+    f->speed[i] = (int16_t)Get16(p+20+2*i);
+    f->pidErr[i] = (int16_t)Get16(p+24+2*i);
+    f->pidInt[i] = (int32_t)Get32(p+28+4*i);
+    f->pidD[i] = (int16_t)Get16(p+36+2*i);
+    f->pwm[i] = Get16(p+40+2*i);
+  }
+  f->flags = p[44];
+  f->driveMode = p[45];
+  f->cycles = Get16(p+46);
+}
+
+static int IsFrameStart(const uint8_t *p, size_t avail) {
+  return avail>=2 && p[0]==TELE_FRAME_SYNC && p[1]==TELE_FRAME_VERSION;
+}
+
+static void WriteHeader(FILE *out) {
+  fprintf(out, "seq,time_us,refL,refML,refMR,refR,linePos,whiteBits,sumoState,sumoBehavior,"
+               "speedL,speedR,pidErrL,pidErrR,pidIntL,pidIntR,pidDL,pidDR,pwmL,pwmR,dirL,dirR,driveMode,cycles\n");
+}
+
+static void WriteFrame(Decoder *dec, const TELE_Frame *f, FILE *out) {
+  if (dec->hasLast) {
+    dec->time += (uint32_t)(f->timestamp-dec->lastStamp); /* cycle counter wraps around */
+    dec->nofDropped += (uint16_t)(f->seq-dec->lastSeq-1);
+  } else {
+    dec->time = 0;
+  }
+  dec->lastStamp = f->timestamp;
+  dec->lastSeq = f->seq;
+  dec->hasLast = 1;
+  dec->nofFrames++;
+  fprintf(out, "%u,%llu,%u,%u,%u,%u,%u,%u,%u,%u,%d,%d,%d,%d,%ld,%ld,%d,%d,%u,%u,%d,%d,%u,%u\n",
+    f->seq, (unsigned long long)(dec->time*1000000ULL/dec->cpuHz),
+    f->ref[0], f->ref[1], f->ref[2], f->ref[3], f->linePos, f->whiteBits, f->sumo>>4, f->sumo&0xF,
+    f->speed[0], f->speed[1], f->pidErr[0], f->pidErr[1], (long)f->pidInt[0], (long)f->pidInt[1],
+    f->pidD[0], f->pidD[1], f->pwm[0], f->pwm[1],
+    (f->flags&TELE_FLAGS_DIR_LEFT_BW)?-1:1, (f->flags&TELE_FLAGS_DIR_RIGHT_BW)?-1:1,
+    f->driveMode, f->cycles);
+}
+
+/*!
+ * \brief Decodes a buffer with captured data.
+ * \return Number of bytes consumed, the rest has to be passed again with more data
+ */
+static size_t Decode(Decoder *dec, const uint8_t *buf, size_t size, int atEnd, FILE *out) {
+  size_t pos = 0;
+  TELE_Frame frame;
+
+  while (size-pos>=TELE_FRAME_SIZE) {
+    /* a frame is accepted if it is followed by another frame header, or if it is the last complete one */
+    if (IsFrameStart(buf+pos, size-pos)
+        && (IsFrameStart(buf+pos+TELE_FRAME_SIZE, size-pos-TELE_FRAME_SIZE) || (atEnd && size-pos<2*TELE_FRAME_SIZE)))
+    {
+      DecodeFrame(buf+pos, &frame);
+      WriteFrame(dec, &frame, out);
+      pos += TELE_FRAME_SIZE;
+    } else if (!atEnd && size-pos<2*TELE_FRAME_SIZE) {
+      break; /* need the next header to decide */
+    } else {
+      pos++; /* resynchronize */
+      dec->nofSkippedBytes++;
+    }
+  }
+  if (atEnd) {
+    dec->nofSkippedBytes += size-pos;
+    pos = size;
+  }
+  return pos;
+}
+
+int main(int argc, char *argv[]) {
+  Decoder dec;
+  FILE *in, *out;
+  uint8_t buf[64*1024];
+  size_t len = 0, n, used;
+  int arg = 1;
+
+  memset(&dec, 0, sizeof(dec));
+  dec.cpuHz = 64000000;
+  if (arg+1<argc && strcmp(argv[arg], "-f")==0) {
+    dec.cpuHz = (uint32_t)strtoul(argv[arg+1], NULL, 0);
+    arg += 2;
+  }
+  if (arg>=argc || dec.cpuHz==0) {
+    fprintf(stderr, "usage: %s [-f cpuHz] <capture.bin> [out.csv]\n", argv[0]);
+    return 1;
+  }
+  in = fopen(argv[arg], "rb");
+  if (in==NULL) {
+    perror(argv[arg]);
+    return 1;
+  }
+  out = stdout;
+  if (arg+1<argc) {
+    out = fopen(argv[arg+1], "w");
+    if (out==NULL) {
+      perror(argv[arg+1]);
+      fclose(in);
+      return 1;
+    }
+  }
+  WriteHeader(out);
+  for(;;) {
+    n = fread(buf+len, 1, sizeof(buf)-len, in);
+    len += n;
+    used = Decode(&dec, buf, len, n==0, out);
+    memmove(buf, buf+used, len-used);
+    len -= used;
+    if (n==0) {
+      break;
+    }
+  }
+  fprintf(stderr, "%lu frames, %lu dropped, %lu bytes skipped\n", dec.nofFrames, dec.nofDropped, dec.nofSkippedBytes);
+  fclose(in);
+  if (out!=stdout) {
+    fclose(out);
+  }
+  return 0;
+}
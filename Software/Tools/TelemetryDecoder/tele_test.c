@@ -0,0 +1,257 @@
+/**
+ * \file
+ * \brief Host round trip test of the telemetry frames and of the decoder
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Telemetry.c (compiled unchanged) with stubs of the sensors, the PIDs and the motors,
+ * which return different values for each sample, and reads the RTT up-buffer as the J-Link RTT Logger
+ * does. The capture is written to a file, together with the CSV lines tele_decode has to produce from
+ * it, computed from the stub values and not from the frames. The capture has the cases the decoder
+ * has to handle:
+ * - the logger starts in the middle of a frame, which has to be skipped.
+ * - garbage with a frame header is in the stream once, the decoder has to resynchronize.
+ * - the host does not read for a while, so the buffer gets full and the frames in between are dropped.
+ * - the cycle counter wraps around, the speeds and the PID errors are saturated to 16 bit.
+ * - the capture is larger than the read buffer of the decoder.
+ * The statistics tele_decode has to print are written to stdout, run_tele_test.sh compares both.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config -I../../McuLib/SEGGER_RTT
+ *          -o tele_test tele_test.c ../../RoboLib/Telemetry.c
+ * Usage: tele_test <capture.bin> <expected.csv>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Platform.h"
+#include "Telemetry.h"
+#include "Reflectance.h"
+#include "Line.h"
+#include "Sumo.h"
+#include "Tacho.h"
+#include "Pid.h"
+#include "Drive.h"
+#include "Motor.h"
+
+#define NOF_SAMPLES        (3000)       /* more than 64 KByte of frames */
+#define CPU_HZ             (64000000)   /* default clock of tele_decode */
+#define CYCLES_PER_SAMPLE  (CPU_HZ/200) /* Drive task runs every 5 ms */
+#define START_CYCLES       (0xFFF00000) /* cycle counter wraps around after a few samples */
+#define START_OFFSET       (20)         /* logger starts in the middle of the first frame */
+#define GARBAGE_AT         (100)        /* garbage after this sample */
+#define STALL_FROM         (1000)       /* host does not read from this sample... */
+#define STALL_TO           (1030)       /* ...to this one */
+
+static const uint8_t garbage[] = {TELE_FRAME_SYNC, TELE_FRAME_VERSION, 0x12, 0x34, 0x00, 0xFF, TELE_FRAME_SYNC, 0x00, 0x55, 0xAA, 0x01, 0x02, 0x03};
+
+SEGGER_RTT_CB _SEGGER_RTT;
+static uint32_t cycles;        /* cycle counter */
+static uint32_t sampleCycles;  /* cycles used by TELE_Sample() */
+static int sample;             /* current sample number, all stub values depend on it */
+static unsigned long nofCaptured; /* bytes read from the RTT buffer */
+
+/*------------------------------------------------------------------------------------------------*/
+/* stubs */
+uint32_t McuArmTools_GetCycleCounter(void) {
+  uint32_t val = cycles;
+
+  cycles += sampleCycles; /* start and end of TELE_Sample() */
+  return val;
+}
+
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags) {
+  SEGGER_RTT_BUFFER_UP *up;
+
+  if (BufferIndex>=SEGGER_RTT_MAX_NUM_UP_BUFFERS) {
+    return -1;
+  }
+  up = &_SEGGER_RTT.aUp[BufferIndex];
+  up->sName = sName;
+  up->pBuffer = (char*)pBuffer;
+  up->SizeOfBuffer = BufferSize;
+  up->WrOff = up->RdOff = 0;
+  up->Flags = Flags;
+  return 0;
+}
+
+bool REF_GetSnapshot(REF_Snapshot *snapshot, SBUS_Stamp *stamp) {
+  int i;
+
+  (void)stamp;
+  if (sample%10==9) {
+    return false; /* no reflectance data yet, the frame has zeros */
+  }
+  for(i=0; i<REF_NOF_SENSORS; i++) {
+    snapshot->raw[i] = (REF_SensorTimeType)(sample*7+i*1000);
+  }
+  snapshot->whiteBits = (uint32_t)(sample&0xF);
+  return true;
+}
+
+uint16_t LINE_GetLinePos(void) {
+  return (uint16_t)((sample*3)%6001);
+}
+
+uint8_t SUMO_GetStateInfo(void) {
+  return (uint8_t)((((sample/50)%6)<<4)|(sample%4));
+}
+
+int32_t TACHO_GetSpeed(bool isLeft) {
+  int32_t speed = (sample%200)*300-30000;
+
+  if (sample%97==0) {
+    speed = 50000; /* saturated */
+  }
+  return isLeft?speed:-speed;
+}
+
+DRV_Mode DRV_GetMode(void) {
+  return ((sample/100)%2)!=0?DRV_MODE_POS:DRV_MODE_SPEED;
+}
+
+static PID_Config pidConfig[PID_CONFIG_SPEED_RIGHT+1];
+
+uint8_t PID_GetPIDConfig(PID_ConfigType config, PID_Config **confP) {
+  PID_Config *cfg = &pidConfig[config];
+  int c = (int)config;
+
+  cfg->lastError = (c==PID_CONFIG_POS_LEFT)?sample*100-100000:sample*10+c*1000-20000; /* position error saturates */
+  cfg->integral = sample*12345-c;
+  cfg->dFiltered = (sample%50)-25+c;
+  *confP = cfg;
+  return ERR_OK;
+}
+
+static MOT_MotorDevice motor[2];
+
+MOT_MotorDevice *MOT_GetMotorHandle(MOT_MotorSide side) {
+  return &motor[side];
+}
+
+uint16_t MOT_GetVal(MOT_MotorDevice *m) {
+  return (uint16_t)(0xFFFF-sample*31-(m==&motor[MOT_MOTOR_RIGHT]?7:0));
+}
+
+MOT_Direction MOT_GetDirection(MOT_MotorDevice *m) {
+  int period = (m==&motor[MOT_MOTOR_LEFT])?3:5;
+
+  return ((sample/period)%2)!=0?MOT_DIR_BACKWARD:MOT_DIR_FORWARD;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static int16_t Sat16(int32_t val) {
+  return val>INT16_MAX?INT16_MAX:(val<INT16_MIN?INT16_MIN:(int16_t)val);
+}
+
+/* CSV line of the current sample, in the format of tele_decode, from the stub values */
+static void WriteExpected(FILE *out, uint16_t seq, unsigned long long timeUs, uint16_t lastCycles) {
+  REF_Snapshot ref;
+  bool hasRef;
+  int i, l, r;
+  PID_Config *cfgL, *cfgR;
+  uint8_t sumo = SUMO_GetStateInfo();
+  DRV_Mode mode = DRV_GetMode();
+
+  hasRef = REF_GetSnapshot(&ref, NULL);
+  if (!hasRef) {
+    memset(&ref, 0, sizeof(ref));
+  }
+  l = mode==DRV_MODE_POS?PID_CONFIG_POS_LEFT:PID_CONFIG_SPEED_LEFT;
+  r = mode==DRV_MODE_POS?PID_CONFIG_POS_RIGHT:PID_CONFIG_SPEED_RIGHT;
+  (void)PID_GetPIDConfig((PID_ConfigType)l, &cfgL);
+  (void)PID_GetPIDConfig((PID_ConfigType)r, &cfgR);
+  fprintf(out, "%u,%llu", seq, timeUs);
+  for(i=0; i<REF_NOF_SENSORS; i++) {
+    fprintf(out, ",%u", ref.raw[i]);
+  }
+  fprintf(out, ",%u,%u,%u,%u,%d,%d,%d,%d,%ld,%ld,%d,%d,%u,%u,%d,%d,%u,%u\n",
+    LINE_GetLinePos(), (unsigned)ref.whiteBits, sumo>>4, sumo&0xF,
+    Sat16(TACHO_GetSpeed(true)), Sat16(TACHO_GetSpeed(false)),
+    Sat16(cfgL->lastError), Sat16(cfgR->lastError), (long)cfgL->integral, (long)cfgR->integral,
+    Sat16(cfgL->dFiltered), Sat16(cfgR->dFiltered),
+    MOT_GetVal(&motor[MOT_MOTOR_LEFT]), MOT_GetVal(&motor[MOT_MOTOR_RIGHT]),
+    MOT_GetDirection(&motor[MOT_MOTOR_LEFT])==MOT_DIR_BACKWARD?-1:1,
+    MOT_GetDirection(&motor[MOT_MOTOR_RIGHT])==MOT_DIR_BACKWARD?-1:1,
+    (unsigned)mode, lastCycles);
+}
+
+/* writes the bytes read by the host to the capture, without the ones before the start of the logger */
+static void Capture(FILE *f, const void *data, unsigned size) {
+  unsigned skip = 0;
+
+  if (nofCaptured<START_OFFSET) {
+    skip = START_OFFSET-nofCaptured;
+    if (skip>size) {
+      skip = size;
+    }
+  }
+  nofCaptured += size;
+  fwrite((const uint8_t*)data+skip, 1, size-skip, f);
+}
+
+/* host side of RTT: reads all frames from the up-buffer */
+static void ReadRTT(FILE *f) {
+  SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[TELE_CONFIG_RTT_CHANNEL];
+  unsigned wrOff = up->WrOff, rdOff = up->RdOff, n;
+
+  while (rdOff!=wrOff) {
+    n = (wrOff>rdOff?wrOff:up->SizeOfBuffer)-rdOff;
+    Capture(f, up->pBuffer+rdOff, n);
+    rdOff += n;
+    if (rdOff>=up->SizeOfBuffer) {
+      rdOff = 0;
+    }
+  }
+  up->RdOff = rdOff;
+}
+
+int main(int argc, char *argv[]) {
+  FILE *capture, *expected;
+  unsigned wrOff;
+  uint16_t lastCycles = 0; /* cycles of the previous frame sent */
+  int firstDecoded = -1; /* first complete frame in the capture */
+  unsigned long nofFrames = 0, nofDropped = 0;
+
+  if (argc!=3) {
+    fprintf(stderr, "usage: %s <capture.bin> <expected.csv>\n", argv[0]);
+    return 1;
+  }
+  capture = fopen(argv[1], "wb");
+  expected = fopen(argv[2], "w");
+  if (capture==NULL || expected==NULL) {
+    perror("tele_test");
+    return 1;
+  }
+  fprintf(expected, "seq,time_us,refL,refML,refMR,refR,linePos,whiteBits,sumoState,sumoBehavior,"
+                    "speedL,speedR,pidErrL,pidErrR,pidIntL,pidIntR,pidDL,pidDR,pwmL,pwmR,dirL,dirR,driveMode,cycles\n");
+  TELE_Init();
+  for(sample=0; sample<NOF_SAMPLES; sample++) {
+    cycles = START_CYCLES+(uint32_t)sample*CYCLES_PER_SAMPLE;
+    sampleCycles = 200+(uint32_t)(sample%37);
+    wrOff = _SEGGER_RTT.aUp[TELE_CONFIG_RTT_CHANNEL].WrOff;
+    TELE_Sample();
+    if (_SEGGER_RTT.aUp[TELE_CONFIG_RTT_CHANNEL].WrOff!=wrOff) { /* frame sent */
+      if (firstDecoded<0 && sample>0) { /* the first frame is cut by START_OFFSET */
+        firstDecoded = sample;
+      }
+      if (firstDecoded>=0) {
+        WriteExpected(expected, (uint16_t)sample, (unsigned long long)(sample-firstDecoded)*CYCLES_PER_SAMPLE*1000000ULL/CPU_HZ, lastCycles);
+        nofFrames++;
+      }
+      lastCycles = (uint16_t)sampleCycles;
+    } else {
+      nofDropped++;
+    }
+    if (sample<STALL_FROM || sample>STALL_TO) {
+      ReadRTT(capture);
+    }
+    if (sample==GARBAGE_AT) {
+      fwrite(garbage, 1, sizeof(garbage), capture);
+    }
+  }
+  ReadRTT(capture);
+  fclose(capture);
+  fclose(expected);
+  printf("%lu frames, %lu dropped, %lu bytes skipped\n", nofFrames, nofDropped,
+    (unsigned long)(TELE_FRAME_SIZE-START_OFFSET+sizeof(garbage)));
+  return nofDropped>0?0:1; /* the stall has to drop frames */
+}
@@ -0,0 +1,23 @@
+/**
+ * \file
+ * \brief Host platform configuration for the tracker replay test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Tracker.c and RoboLib/SensorBus.c: the
+ * tracker with the odometry heading, without the shell.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PL_CONFIG_USE_FREERTOS       (1)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_PROXIMITY      (1)
+#define PL_CONFIG_HAS_ODOMETRY       (1)
+#define PL_CONFIG_HAS_TRACKER        (1)
+
+#endif /* SRC_PLATFORM_H_ */
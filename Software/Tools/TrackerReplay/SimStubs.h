@@ -0,0 +1,26 @@
+/**
+ * \file
+ * \brief Host stubs of FreeRTOS and the cycle counter for the tracker replay test
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * This header is force-included with '-include'. It defines the include guards of FreeRTOS.h and
+ * McuArmTools.h, so RoboLib/Tracker.c and RoboLib/SensorBus.c are compiled unchanged. The cycle
+ * counter is the time of the replay, the odometry pose is the heading of the trace. Both are in
+ * tracker_replay.c.
+ */
+
+#ifndef SIMSTUBS_H_
+#define SIMSTUBS_H_
+
+#include <stdint.h>
+
+#define INC_FREERTOS_H
+#define __McuArmTools_H
+
+/* FreeRTOS */
+#define configCPU_CLOCK_HZ     (64000000) /* the cycle counter runs with this clock */
+
+/* McuArmTools */
+uint32_t McuArmTools_GetCycleCounter(void);
+
+#endif /* SIMSTUBS_H_ */
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds and runs the replay test of the opponent tracker, with the synthetic traces and the
+# recorded traces given.
+# Usage: ./run_tracker_replay.sh [trace files]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -include SimStubs.h -I. -I$R -I$M/src -I$M/config -I$M/FreeRTOS/Source/include"
+SRC="tracker_replay.c $R/Tracker.c $R/SensorBus.c"
+
+gcc $CFLAGS -o $OUT/tracker_replay $SRC -lm
+$OUT/tracker_replay "$@"
@@ -0,0 +1,366 @@
+/**
+ * \file
+ * \brief Replay test of the opponent tracker
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Tracker.c (compiled unchanged) on traces of proximity scans with the heading of the
+ * robot. The synthetic traces know the true bearing of the opponent; the sensor returns the
+ * bearings of the PROX_Decode() table with jitter to the neighbor entry and missed scans:
+ * - static: opponent standing still, the estimate has to be valid and close to it
+ * - own turn: the robot turns, the opponent stands still, the bearing rate has to stay near zero
+ * - moving: the opponent moves around the robot, the rate has to follow
+ * - lost: the track is dropped when the target has not been seen for 8 scans
+ * - new target: a jump of more than the gate restarts the track at the new bearing
+ * - ahead: opponent inside the chase deadband, the jitter of the sensor must not cause more turns
+ * - gap: a scan after a gap of more than 200 ms is a new target, not confirmed yet
+ * Recorded traces (robo_sim -p, see RoboSim/robo_sim.c for the format) given on the command line
+ * are replayed as well. Both recorded and synthetic traces count the turn commands of the rule of
+ * SUMO_OnTargetEvent(), with the last scan (filtered bearing) and with the tracker estimate: a
+ * turn is started if the bearing is outside of +/-15 degrees, and no further turn before it ends
+ * (duration of the profile turns measured with robo_sim -b). The replay is open loop: the heading
+ * of a recorded trace is the one of the recording, not of the turns counted here.
+ *
+ * Build: gcc -O2 -Wall -include SimStubs.h -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -I../../McuLib/FreeRTOS/Source/include -o tracker_replay tracker_replay.c
+ *          ../../RoboLib/Tracker.c ../../RoboLib/SensorBus.c -lm
+ * Usage: tracker_replay [trace files]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Platform.h"
+#include "Tracker.h"
+#include "Odometry.h"
+#include "McuArmTools.h"
+
+#define SCAN_PERIOD_US        (10000) /* proximity scan period of the firmware */
+#define CYCLES_PER_US         (configCPU_CLOCK_HZ/1000000)
+#define CHASE_DEADBAND_DEG    (15)    /* SUMO_CHASE_DEADBAND_DEG */
+#define TURN_BASE_MS          (300)   /* duration of a profile turn: 90 deg 700 ms, 180 deg 1100 ms */
+#define TURN_MS_PER_DEG       (4.5)
+#define REVERSAL_MS           (1000)  /* turn to the other side within this time: counted as reversal */
+#define MAX_SCANS             (1u<<20)
+
+typedef struct {
+  uint32_t cycles;          /* cycle counter at the end of the scan */
+  bool found;
+  int rawAngle;             /* bearing of this scan, degrees, negative is left */
+  int filteredAngle;        /* PROX_Result.proximityAngle */
+  int32_t heading;          /* odometry heading, centi-degrees, counter-clockwise */
+} Scan;
+
+/*! \brief Turn commands of one strategy */
+typedef struct {
+  unsigned int nofTurns;
+  unsigned int nofReversals;
+  uint32_t busyUntil;       /* cycle counter at the end of the current turn */
+  uint32_t lastTurn;
+  int lastSign;
+} Turns;
+
+static uint32_t replayCycles;
+static int32_t replayHeading;
+static Scan scans[MAX_SCANS];
+
+/*------------------------------------------------------------------------------------------------*/
+/* stubs */
+uint32_t McuArmTools_GetCycleCounter(void) {
+  return replayCycles;
+}
+
+void ODO_GetPose(ODO_Pose *pose) {
+  memset(pose, 0, sizeof(*pose));
+  pose->heading = replayHeading;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* replay */
+static void Decide(Turns *turns, int angle, uint32_t now) {
+  int sign;
+
+  if ((int32_t)(now-turns->busyUntil)<0) {
+    return; /* finish the maneuver first */
+  }
+  if (angle>=-CHASE_DEADBAND_DEG && angle<=CHASE_DEADBAND_DEG) {
+    return; /* chase */
+  }
+  if (angle<-90 || angle>90) {
+    return;
+  }
+  sign = angle<0 ? -1 : 1;
+  if (turns->nofTurns!=0 && sign!=turns->lastSign && now-turns->lastTurn<(uint32_t)REVERSAL_MS*1000*CYCLES_PER_US) {
+    turns->nofReversals++;
+  }
+  turns->nofTurns++;
+  turns->lastSign = sign;
+  turns->lastTurn = now;
+  turns->busyUntil = now+(uint32_t)((TURN_BASE_MS+TURN_MS_PER_DEG*abs(angle))*1000*CYCLES_PER_US);
+}
+
+/*! \brief Feeds one scan to the tracker and counts the turn commands of both strategies */
+static void ReplayScan(const Scan *scan, Turns *last, Turns *track, TRACK_Estimate *estimate) {
+  PROX_Result result;
+
+  memset(&result, 0, sizeof(result));
+  result.timestamp = scan->cycles;
+  result.proximityFound = scan->found;
+  result.rawAngle = scan->rawAngle;
+  result.proximityAngle = scan->filteredAngle;
+  replayCycles = scan->cycles;
+  replayHeading = scan->heading;
+  TRACK_OnProximity(&result);
+  (void)TRACK_GetEstimate(estimate);
+  if (scan->found) { /* SUMO_OnTarget() */
+    Decide(last, scan->filteredAngle, scan->cycles);
+    if (estimate->valid) {
+      Decide(track, estimate->bearing, scan->cycles);
+    }
+  }
+}
+
+static void PrintTurns(const char *name, unsigned int nofScans, const Turns *last, const Turns *track) {
+  printf("%-14s %6u scans, turns: last scan %4u (%3u reversals), tracker %4u (%3u reversals)\n",
+    name, nofScans, last->nofTurns, last->nofReversals, track->nofTurns, track->nofReversals);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* synthetic traces */
+static double Rnd(void) {
+  return (double)rand()/RAND_MAX;
+}
+
+static double WrapDeg(double a) {
+  while (a>180.0) {
+    a -= 360.0;
+  }
+  while (a<=-180.0) {
+    a += 360.0;
+  }
+  return a;
+}
+
+/*!
+ * \brief Creates a trace.
+ * \param nof Number of scans
+ * \param bearing Returns the true bearing relative to the robot at a time in seconds, >180: not visible
+ * \param heading Returns the heading of the robot at a time, degrees counter-clockwise
+ * \param jitter Probability that the sensor reports a neighbor entry of the bearing table
+ * \param miss Probability that a visible target is not seen
+ */
+static void Synthesize(unsigned int nof, double (*bearing)(double), double (*heading)(double), double jitter, double miss) {
+  static const int table[] = {-90, -50, -10, 10, 50, 90}; /* bearings of single and neighbor receivers */
+  int n = sizeof(table)/sizeof(table[0]);
+  unsigned int i;
+  int j, best, filtered = 0;
+  bool wasFound = false;
+  double t, b;
+
+  for(i=0; i<nof; i++) {
+    t = (double)i*SCAN_PERIOD_US/1e6;
+    b = bearing(t);
+    scans[i].cycles = (uint32_t)(1000+i)*SCAN_PERIOD_US*CYCLES_PER_US;
+    scans[i].heading = (int32_t)lround(WrapDeg(heading(t))*100.0);
+    scans[i].found = b>=-100.0 && b<=100.0 && Rnd()>=miss;
+    scans[i].rawAngle = 0;
+    if (scans[i].found) {
+      best = 0;
+      for(j=1; j<n; j++) {
+        if (fabs(table[j]-b)<fabs(table[best]-b)) {
+          best = j;
+        }
+      }
+      if (Rnd()<jitter) {
+        best += (Rnd()<0.5 && best>0) || best==n-1 ? -1 : 1;
+      }
+      scans[i].rawAngle = table[best];
+      filtered = wasFound ? filtered+(scans[i].rawAngle-filtered)/2 : scans[i].rawAngle; /* PROX_FilterResult() */
+    }
+    wasFound = scans[i].found;
+    scans[i].filteredAngle = filtered;
+  }
+}
+
+static double StandStill(double t) {
+  (void)t;
+  return 0.0;
+}
+
+static double Static50(double t) {
+  (void)t;
+  return 50.0;
+}
+
+static double TurnLeft(double t) {
+  return t<1.0 ? 30.0*t : 30.0; /* 30 deg/s for one second */
+}
+
+static double GroundRight30(double t) {
+  return WrapDeg(30.0+TurnLeft(t)); /* fixed on the ground, the robot turns away */
+}
+
+static double Circling(double t) {
+  return -60.0+40.0*t; /* 40 deg/s from left to right */
+}
+
+static double Vanishing(double t) {
+  return t<1.0 ? 30.0 : 999.0;
+}
+
+static double Jumping(double t) {
+  return t<1.0 ? -50.0 : 50.0;
+}
+
+static double Ahead(double t) {
+  (void)t;
+  return 8.0;
+}
+
+/*! \brief Replays the synthetic trace, checks the estimate in the last 'check' scans */
+static int RunSynthetic(const char *name, unsigned int nof, unsigned int check, double (*bearing)(double),
+    double (*heading)(double), double jitter, double miss, double maxBearingErr, double rate, double maxRateErr) {
+  Turns last, track;
+  TRACK_Estimate estimate;
+  unsigned int i, nofInvalid = 0;
+  double t, sumErr = 0.0, bearingErr = 0.0, rateErr = 0.0, sumRate = 0.0;
+  int errors = 0;
+
+  Synthesize(nof, bearing, heading, jitter, miss);
+  TRACK_Init();
+  memset(&last, 0, sizeof(last));
+  memset(&track, 0, sizeof(track));
+  for(i=0; i<nof; i++) {
+    ReplayScan(&scans[i], &last, &track, &estimate);
+    if (i>=nof-check) {
+      t = (double)i*SCAN_PERIOD_US/1e6;
+      if (!estimate.valid) {
+        nofInvalid++;
+        continue;
+      }
+      sumErr += fabs(WrapDeg(estimate.bearing-bearing(t)));
+      sumRate += estimate.rate;
+    }
+  }
+  if (check!=nofInvalid) {
+    bearingErr = sumErr/(check-nofInvalid);
+    rateErr = fabs(sumRate/(check-nofInvalid)-rate);
+  }
+  PrintTurns(name, nof, &last, &track);
+  printf("%-14s valid %3u/%3u, mean bearing error %5.1f deg, mean rate error %5.1f deg/s\n", "",
+    check-nofInvalid, check, bearingErr, rateErr);
+  if (maxBearingErr<0.0) { /* the track has to be dropped */
+    if (nofInvalid!=check) {
+      printf("FAILED: %s: track not dropped\n", name);
+      errors++;
+    }
+    return errors;
+  }
+  if (nofInvalid>check/10) {
+    printf("FAILED: %s: estimate not valid\n", name);
+    errors++;
+  }
+  if (bearingErr>maxBearingErr) {
+    printf("FAILED: %s: bearing error\n", name);
+    errors++;
+  }
+  if (rateErr>maxRateErr) {
+    printf("FAILED: %s: rate error\n", name);
+    errors++;
+  }
+  if (track.nofTurns>last.nofTurns) {
+    printf("FAILED: %s: more turns with the tracker\n", name);
+    errors++;
+  }
+  return errors;
+}
+
+static int TestGap(void) {
+  Turns last, track;
+  TRACK_Estimate estimate;
+  Scan scan;
+  unsigned int i;
+  int errors = 0;
+
+  Synthesize(100, Static50, StandStill, 0.0, 0.0);
+  TRACK_Init();
+  memset(&last, 0, sizeof(last));
+  memset(&track, 0, sizeof(track));
+  for(i=0; i<100; i++) {
+    ReplayScan(&scans[i], &last, &track, &estimate);
+  }
+  scan = scans[99];
+  scan.cycles += 250000*CYCLES_PER_US; /* no scan for 250 ms, e.g. the proximity task blocked */
+  scan.rawAngle = scan.filteredAngle = -50;
+  ReplayScan(&scan, &last, &track, &estimate);
+  printf("%-14s after a gap of 250 ms: %s\n", "gap", estimate.valid ? "valid" : "dropped");
+  if (estimate.valid) {
+    printf("FAILED: gap: track not dropped\n");
+    errors++;
+  }
+  return errors;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+/* recorded traces */
+static int ReplayFile(const char *fileName, unsigned int *sumLast, unsigned int *sumTrack) {
+  FILE *f;
+  char line[128];
+  unsigned int nof = 0, nofBouts = 0, cycles;
+  int found, raw, filtered, heading;
+  Turns last, track;
+  TRACK_Estimate estimate;
+
+  f = fopen(fileName, "r");
+  if (f==NULL) {
+    perror(fileName);
+    return 1;
+  }
+  memset(&last, 0, sizeof(last));
+  memset(&track, 0, sizeof(track));
+  while (fgets(line, sizeof(line), f)!=NULL) {
+    if (strncmp(line, "# bout", 6)==0) { /* the firmware starts again */
+      TRACK_Init();
+      last.busyUntil = track.busyUntil = 0;
+      nofBouts++;
+    } else if (line[0]!='#' && sscanf(line, "%u %d %d %d %d", &cycles, &found, &raw, &filtered, &heading)==5) {
+      scans[0].cycles = cycles;
+      scans[0].found = found!=0;
+      scans[0].rawAngle = raw;
+      scans[0].filteredAngle = filtered;
+      scans[0].heading = heading;
+      ReplayScan(&scans[0], &last, &track, &estimate);
+      nof++;
+    }
+  }
+  fclose(f);
+  PrintTurns(fileName, nof, &last, &track);
+  printf("%-14s %u bouts, turns per bout: last scan %.1f, tracker %.1f\n", "", nofBouts,
+    nofBouts==0 ? 0.0 : (double)last.nofTurns/nofBouts, nofBouts==0 ? 0.0 : (double)track.nofTurns/nofBouts);
+  *sumLast += last.nofTurns;
+  *sumTrack += track.nofTurns;
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int sumLast = 0, sumTrack = 0;
+  int i, errors = 0;
+
+  srand(1);
+  errors += RunSynthetic("static", 300, 200, Static50, StandStill, 0.05, 0.2, 10.0, 0.0, 15.0);
+  errors += RunSynthetic("own turn", 200, 100, GroundRight30, TurnLeft, 0.05, 0.1, 15.0, 0.0, 15.0);
+  errors += RunSynthetic("moving", 300, 150, Circling, StandStill, 0.0, 0.1, 15.0, 40.0, 15.0);
+  errors += RunSynthetic("lost", 150, 40, Vanishing, StandStill, 0.0, 0.0, -1.0, 0.0, 0.0);
+  errors += RunSynthetic("new target", 200, 90, Jumping, StandStill, 0.0, 0.0, 10.0, 0.0, 10.0);
+  errors += RunSynthetic("ahead", 1000, 900, Ahead, StandStill, 0.05, 0.2, 15.0, 0.0, 15.0);
+  errors += TestGap();
+  for(i=1; i<argc; i++) {
+    errors += ReplayFile(argv[i], &sumLast, &sumTrack);
+  }
+  if (argc>1) {
+    printf("recorded traces: %u turns with the last scan, %u with the tracker (%+.0f%%)\n", sumLast, sumTrack,
+      sumLast==0 ? 0.0 : 100.0*((double)sumTrack-sumLast)/sumLast);
+  }
+  printf("%d failed\n", errors);
+  return errors==0 ? 0 : 1;
+}
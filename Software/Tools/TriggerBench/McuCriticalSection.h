@@ -0,0 +1,16 @@
+/**
+ * \file
+ * \brief Host stub of the critical section for the trigger benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * The benchmark has no interrupts and no threads, so the critical section is empty.
+ */
+
+#ifndef __McuCriticalSection_H
+#define __McuCriticalSection_H
+
+#define McuCriticalSection_CriticalVariable()  /* nothing needed */
+#define McuCriticalSection_EnterCritical()     do {} while(0)
+#define McuCriticalSection_ExitCritical()      do {} while(0)
+
+#endif /* __McuCriticalSection_H */
@@ -0,0 +1,25 @@
+/**
+ * \file
+ * \brief Host platform configuration for the trigger benchmark
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Replaces Board/Platform.h for the host build of RoboLib/Trigger.c: triggers only, with
+ * additional application triggers for the test.
+ */
+
+#ifndef SRC_PLATFORM_H_
+#define SRC_PLATFORM_H_
+
+#include "McuLib.h"  /* ERR_xxx, TRUE and FALSE */
+#include <stdint.h>
+
+#define PL_CONFIG_USE_FREERTOS       (0)
+#define PL_CONFIG_HAS_SHELL          (0)
+#define PL_CONFIG_HAS_SPAN           (0)
+#define PL_CONFIG_HAS_TRIGGER        (1)
+
+#ifndef TRG_CONFIG_NOF_APP_TRIGGERS
+  #define TRG_CONFIG_NOF_APP_TRIGGERS  (15) /* plus TRG_KEYPRESS */
+#endif
+
+#endif /* SRC_PLATFORM_H_ */
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Builds and runs the trigger scheduler benchmark, with the triggers of the application and with
+# a single application trigger.
+# Usage: ./run_trigger_bench.sh [nofTicks]
+set -e
+cd "$(dirname "$0")"
+R=../../RoboLib
+M=../../McuLib
+OUT=${TMPDIR:-/tmp}
+CFLAGS="-O2 -Wall -I. -I$R -I$M/src -I$M/config"
+SRC="trigger_bench.c $R/Trigger.c"
+
+gcc $CFLAGS -o $OUT/trigger_bench $SRC
+gcc $CFLAGS -DTRG_CONFIG_NOF_APP_TRIGGERS=1 -o $OUT/trigger_bench_1 $SRC
+$OUT/trigger_bench "$@"
+$OUT/trigger_bench_1 "$@"
@@ -0,0 +1,270 @@
+/**
+ * \file
+ * \brief Host test and benchmark of the trigger scheduler
+ * \author Erich Styger, erich.styger@hslu.ch
+ *
+ * Runs RoboLib/Trigger.c (compiled unchanged, delta list) against a copy of the former
+ * implementation, which decremented all triggers and scanned the table on each tick. Both get the
+ * same randomized load: the 'application' arms and cancels triggers between the ticks, and the
+ * callbacks re-arm their trigger with pseudo random ticks, zero included. One trigger is periodic;
+ * the former implementation re-arms it in the callback. First both run in lock step, and the
+ * triggers fired in each tick have to be the same. Then each runs alone for the time per tick.
+ *
+ * Build: gcc -O2 -Wall -I. -I../../RoboLib -I../../McuLib/src -I../../McuLib/config
+ *          -o trigger_bench trigger_bench.c ../../RoboLib/Trigger.c
+ *        (-DTRG_CONFIG_NOF_APP_TRIGGERS=n for another number of triggers)
+ * Usage: trigger_bench [nofTicks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Platform.h"
+#include "Trigger.h"
+
+#define MAX_TICKS        (300)          /* random trigger times are below this */
+#define PERIODIC         (TRG_APP_FIRST) /* the periodic trigger */
+#define PERIOD           (7)
+#define MAX_FIRED        (4*TRG_NOF_TRIGGERS) /* per tick */
+
+typedef enum {
+  IMPL_LEGACY,
+  IMPL_NEW,
+  IMPL_NOF
+} Impl;
+
+/* state of the load, the same for both implementations */
+typedef struct {
+  uint32_t rnd;                          /* xorshift state */
+  uint32_t nofFired[TRG_NOF_TRIGGERS];   /* callbacks of each trigger */
+  uint8_t fired[MAX_FIRED];              /* triggers fired in the current tick */
+  unsigned nofFiredTick;
+  unsigned long total;
+} Load;
+
+static Load loads[IMPL_NOF];
+static bool recordFired;
+
+/*------------------------------------------------------------------------------------------------*/
+/* former implementation: down counter for each trigger, rescan of the table after each callback */
+typedef struct {
+  TRG_TriggerTime ticks;
+  TRG_Callback callback;
+  TRG_CallBackDataPtr data;
+} LEG_TriggerDesc;
+
+static LEG_TriggerDesc LEG_Triggers[TRG_NOF_TRIGGERS];
+
+static void LEG_SetTrigger(TRG_TriggerKind trigger, TRG_TriggerTime ticks, TRG_Callback callback, TRG_CallBackDataPtr data) {
+  LEG_Triggers[trigger].ticks = ticks;
+  LEG_Triggers[trigger].callback = callback;
+  LEG_Triggers[trigger].data = data;
+}
+
+static bool LEG_CheckCallbacks(void) {
+  TRG_TriggerKind i;
+  TRG_Callback callback;
+  bool calledCallBack = FALSE;
+
+  for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
+    if (LEG_Triggers[i].ticks==0 && LEG_Triggers[i].callback != NULL) {
+      callback = LEG_Triggers[i].callback;
+      LEG_Triggers[i].callback = NULL;
+      callback(LEG_Triggers[i].data);
+      calledCallBack = TRUE;
+    }
+  }
+  return calledCallBack;
+}
+
+static void LEG_AddTick(void) {
+  TRG_TriggerKind i;
+
+  for(i=(TRG_TriggerKind)0;i<TRG_NOF_TRIGGERS;i++) {
+    if (LEG_Triggers[i].ticks!=0) {
+      LEG_Triggers[i].ticks--;
+    }
+  }
+  while (LEG_CheckCallbacks()) {
+  }
+}
+
+static void LEG_Init(void) {
+  memset(LEG_Triggers, 0, sizeof(LEG_Triggers));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+static uint32_t Random(uint32_t *state) {
+  uint32_t x = *state;
+
+  x ^= x<<13;
+  x ^= x>>17;
+  x ^= x<<5;
+  *state = x;
+  return x;
+}
+
+/* pseudo random value from the trigger and its number of callbacks, the same for both implementations */
+static uint32_t Hash(uint32_t trigger, uint32_t n) {
+  uint32_t h = (trigger*0x9E3779B1u)^(n*0x85EBCA6Bu);
+
+  h ^= h>>15;
+  h *= 0x2C1B3C6Du;
+  h ^= h>>12;
+  return h;
+}
+
+/*!
+ * \brief Records a callback and decides about re-arming the trigger.
+ * \return Ticks to re-arm the trigger, or -1
+ */
+static int Fired(Impl impl, TRG_TriggerKind trigger) {
+  Load *load = &loads[impl];
+  uint32_t h;
+
+  load->total++;
+  h = Hash(trigger, load->nofFired[trigger]++);
+  if (recordFired && load->nofFiredTick<MAX_FIRED) {
+    load->fired[load->nofFiredTick++] = (uint8_t)trigger;
+  }
+  if (trigger==PERIODIC) {
+    return impl==IMPL_LEGACY ? PERIOD : -1; /* the new one is re-armed by the scheduler */
+  }
+  if ((h&3)==0) {
+    return -1; /* not re-armed in one of four callbacks */
+  }
+  return (int)((h>>8)%MAX_TICKS); /* zero fires again in the same tick */
+}
+
+static void LegCallback(TRG_CallBackDataPtr data) {
+  TRG_TriggerKind trigger = (TRG_TriggerKind)(uintptr_t)data;
+  int ticks = Fired(IMPL_LEGACY, trigger);
+
+  if (ticks>=0) {
+    LEG_SetTrigger(trigger, (TRG_TriggerTime)ticks, LegCallback, data);
+  }
+}
+
+static void NewCallback(TRG_CallBackDataPtr data) {
+  TRG_TriggerKind trigger = (TRG_TriggerKind)(uintptr_t)data;
+  int ticks = Fired(IMPL_NEW, trigger);
+
+  if (ticks>=0) {
+    (void)TRG_SetTrigger(trigger, (TRG_TriggerTime)ticks, NewCallback, data);
+  }
+}
+
+/* the application between two ticks: arms or cancels a random trigger now and then */
+static void Application(Impl impl) {
+  Load *load = &loads[impl];
+  uint32_t r = Random(&load->rnd);
+  TRG_TriggerKind trigger;
+  TRG_TriggerTime ticks;
+
+  if ((r&7)>1) {
+    return; /* nothing in most ticks */
+  }
+  trigger = (TRG_TriggerKind)((r>>8)%TRG_NOF_TRIGGERS);
+  if (trigger==PERIODIC) {
+    return;
+  }
+  ticks = (TRG_TriggerTime)((r>>16)%MAX_TICKS);
+  if ((r&7)==0) { /* cancel */
+    if (impl==IMPL_LEGACY) {
+      LEG_Triggers[trigger].callback = NULL;
+    } else {
+      TRG_CancelTrigger(trigger);
+    }
+  } else if (impl==IMPL_LEGACY) {
+    LEG_SetTrigger(trigger, ticks, LegCallback, (void*)(uintptr_t)trigger);
+  } else {
+    (void)TRG_SetTrigger(trigger, ticks, NewCallback, (void*)(uintptr_t)trigger);
+  }
+}
+
+static void Start(Impl impl) {
+  memset(&loads[impl], 0, sizeof(Load));
+  loads[impl].rnd = 0x12345678;
+  if (impl==IMPL_LEGACY) {
+    LEG_Init();
+    LEG_SetTrigger(PERIODIC, PERIOD, LegCallback, (void*)(uintptr_t)PERIODIC);
+  } else {
+    TRG_Init();
+    (void)TRG_SetPeriodicTrigger(PERIODIC, PERIOD, PERIOD, NewCallback, (void*)(uintptr_t)PERIODIC);
+  }
+}
+
+static void Tick(Impl impl) {
+  Application(impl);
+  loads[impl].nofFiredTick = 0;
+  if (impl==IMPL_LEGACY) {
+    LEG_AddTick();
+  } else {
+    TRG_AddTick();
+  }
+}
+
+static int CompareU8(const void *a, const void *b) {
+  return *(const uint8_t*)a-*(const uint8_t*)b;
+}
+
+/* both implementations in lock step, returns the number of errors */
+static int Verify(unsigned long nofTicks) {
+  unsigned long t;
+  Load *leg = &loads[IMPL_LEGACY], *new = &loads[IMPL_NEW];
+  int errors = 0;
+
+  recordFired = TRUE;
+  Start(IMPL_LEGACY);
+  Start(IMPL_NEW);
+  for(t=0; t<nofTicks; t++) {
+    Tick(IMPL_LEGACY);
+    Tick(IMPL_NEW);
+    qsort(leg->fired, leg->nofFiredTick, 1, CompareU8); /* the order inside a tick may differ */
+    qsort(new->fired, new->nofFiredTick, 1, CompareU8);
+    if (leg->nofFiredTick!=new->nofFiredTick || memcmp(leg->fired, new->fired, leg->nofFiredTick)!=0) {
+      if (errors<10) {
+        printf("FAILED: tick %lu: %u callbacks instead of %u\n", t, new->nofFiredTick, leg->nofFiredTick);
+      }
+      errors++;
+    }
+  }
+  printf("verify: %lu ticks, %lu callbacks, periodic %u of %lu\n", nofTicks, new->total, new->nofFired[PERIODIC], nofTicks/PERIOD);
+  if (new->nofFired[PERIODIC]!=nofTicks/PERIOD) {
+    printf("FAILED: periodic trigger\n");
+    errors++;
+  }
+  recordFired = FALSE;
+  return errors;
+}
+
+static double Measure(Impl impl, unsigned long nofTicks) {
+  struct timespec start, end;
+  unsigned long t;
+
+  Start(impl);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(t=0; t<nofTicks; t++) {
+    Tick(impl);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((end.tv_sec-start.tv_sec)*1e9+(end.tv_nsec-start.tv_nsec))/nofTicks;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long nofTicks = 5000000;
+  double legNs, newNs;
+  int errors;
+
+  if (argc>1) {
+    nofTicks = strtoul(argv[1], NULL, 0);
+  }
+  printf("%d triggers\n", TRG_NOF_TRIGGERS);
+  errors = Verify(nofTicks);
+  legNs = Measure(IMPL_LEGACY, nofTicks);
+  newNs = Measure(IMPL_NEW, nofTicks);
+  printf("time per tick: scan %.1f ns, delta list %.1f ns (with the load)\n", legNs, newNs);
+  printf("%d failed\n", errors);
+  return errors==0 ? 0 : 1;
+}